@@ -1,6 +1,11 @@
 #include <cassert>
+#include <chrono>
+#include <cstdarg>
+#include <cstdlib>
+#include <cstring>
 #include <map>
 #include <string>
+#include <Color.h>
 #include "convar.h"
 
 #ifdef USE_METAMOD
@@ -16,6 +21,21 @@
 #include "cl_dll.h"
 #endif
 
+static void ConPrintf(const char *fmt, ...)
+{
+	char buf[1024];
+	va_list args;
+	va_start(args, fmt);
+	vsnprintf(buf, sizeof(buf), fmt, args);
+	va_end(args);
+
+#ifdef SERVER_DLL
+	g_engfuncs.pfnServerPrint(buf);
+#else
+	gEngfuncs.Con_Printf("%s", buf);
+#endif
+}
+
 //---------------------------------------------------
 // ConItemBase
 //---------------------------------------------------
@@ -128,6 +148,88 @@ void ConVar::SetValue(const char *val)
 #endif
 }
 
+unsigned int ConVar::GetVersion()
+{
+	const char *str = GetCvar() ? GetString() : nullptr;
+
+	if (!str)
+		str = "";
+
+	// Engine frees and allocates the string on change, the pointer may stay the same
+	if (m_LastString != str)
+	{
+		m_LastString = str;
+		m_uVersion++;
+	}
+
+	return m_uVersion;
+}
+
+bool ConVar::GetColor(Color &color)
+{
+	unsigned int version = GetVersion();
+
+	if (m_uColorVersion != version)
+	{
+		Color newColor;
+		m_bColorValid = ParseColor(m_LastString.c_str(), newColor);
+
+		if (m_bColorValid)
+		{
+			for (int i = 0; i < 4; i++)
+				m_CachedColor[i] = newColor[i];
+		}
+
+		m_uColorVersion = version;
+		m_iParseCount++;
+	}
+
+	if (!m_bColorValid)
+		return false;
+
+	color = Color(m_CachedColor[0], m_CachedColor[1], m_CachedColor[2], m_CachedColor[3]);
+	return true;
+}
+
+bool ConVar::GetVector(Vector &vec)
+{
+	unsigned int version = GetVersion();
+
+	if (m_uVectorVersion != version)
+	{
+		const char *value = m_LastString.c_str();
+		int count = 0;
+
+		for (; count < 3; count++)
+		{
+			char *end;
+			m_flCachedVector[count] = strtof(value, &end);
+
+			if (end == value)
+				break;
+
+			value = end;
+		}
+
+		m_iVectorCount = count;
+		m_uVectorVersion = version;
+		m_iParseCount++;
+	}
+
+	if (m_iVectorCount == 0)
+		return false;
+
+	for (int i = 0; i < m_iVectorCount; i++)
+		vec[i] = m_flCachedVector[i];
+
+	return true;
+}
+
+int ConVar::GetParseCount()
+{
+	return m_iParseCount;
+}
+
 //---------------------------------------------------
 // ConVarRef
 //---------------------------------------------------
@@ -356,3 +458,84 @@ ConVar *CvarSystem::FindCvar(cvar_t *cvar)
 	else
 		return it->second;
 }
+
+void CvarSystem::PrintParseStats()
+{
+	static auto lastTime = std::chrono::steady_clock::now();
+	auto now = std::chrono::steady_clock::now();
+	double seconds = std::chrono::duration<double>(now - lastTime).count();
+	lastTime = now;
+
+	ConPrintf("%-32s %8s %10s\n", "Cvar", "Total", "Per second");
+
+	for (ConItemBase *item = ConItemBase::m_pFirstItem; item; item = item->m_pNextItem)
+	{
+		if (item->GetType() != ConItemType::ConVar)
+			continue;
+
+		ConVar *cvar = static_cast<ConVar *>(item);
+
+		if (cvar->m_iParseCount == 0)
+			continue;
+
+		int count = cvar->m_iParseCount - cvar->m_iReportedParseCount;
+		cvar->m_iReportedParseCount = cvar->m_iParseCount;
+
+		ConPrintf("%-32s %8d %10.2f\n", cvar->GetName(), cvar->m_iParseCount, seconds > 0 ? count / seconds : 0.0);
+	}
+}
+
+CON_COMMAND(cvar_parse_stats, "Shows how many times per second cvars were parsed since the previous call")
+{
+	CvarSystem::PrintParseStats();
+}
+
+bool ParseColor(const char *string, Color &color)
+{
+	Color newColor;
+	const char *value = string;
+
+	// Red
+	{
+		while (*value == ' ')
+			value++;
+
+		if (*value < '0' || *value > '9')
+			return false;
+
+		newColor[0] = atoi(value);
+
+		value = strchr(value, ' ');
+		if (value == NULL)
+			return false;
+	}
+
+	// Green
+	{
+		while (*value == ' ')
+			value++;
+
+		if (*value < '0' || *value > '9')
+			return false;
+
+		newColor[1] = atoi(value);
+		value = strchr(value, ' ');
+		if (value == NULL)
+			return false;
+	}
+
+	// Blue
+	{
+		while (*value == ' ')
+			value++;
+
+		if (*value < '0' || *value > '9')
+			return false;
+
+		newColor[2] = atoi(value);
+	}
+
+	newColor[3] = 255;
+	color = newColor;
+	return true;
+}
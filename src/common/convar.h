@@ -1,7 +1,11 @@
 #ifndef CONVAR_H
 #define CONVAR_H
+#include <string>
 #include <cvardef.h>
 
+class Color;
+class Vector;
+
 enum class ConItemType
 {
 	ConVar,
@@ -56,12 +60,54 @@ public:
 	void SetValue(int val);
 	void SetValue(const char *val);
 
+	/**
+	 * Returns a number that is increased every time the string of the cvar changes.
+	 * Engine doesn't notify about changes so the string is compared with a copy.
+	 */
+	unsigned int GetVersion();
+
+	/**
+	 * Returns the string parsed as a color (see ParseColor). It is only parsed again when it changes.
+	 * @param	color	Output color (unchanged if returned false)
+	 * @return	Whether or not string was parsed successfully.
+	 */
+	bool GetColor(Color &color);
+
+	/**
+	 * Returns the string parsed as a vector "X Y Z". It is only parsed again when it changes.
+	 * Missing components are left unchanged, so vec can be filled with defaults.
+	 * @param	vec		Output vector (unchanged if returned false)
+	 * @return	Whether or not string was parsed successfully.
+	 */
+	bool GetVector(Vector &vec);
+
+	/**
+	 * Returns how many times typed values were parsed from the string.
+	 */
+	int GetParseCount();
+
 	cvar_t *GetCvar();
 
 private:
 	const char *m_pDefVal;
 	int m_iFlags;
 
+	// Change detection
+	std::string m_LastString;
+	unsigned int m_uVersion = 1;
+
+	// Typed values, parsed when version changes
+	unsigned int m_uColorVersion = 0;
+	bool m_bColorValid = false;
+	unsigned char m_CachedColor[4] = {};
+
+	unsigned int m_uVectorVersion = 0;
+	int m_iVectorCount = 0; //!< Number of parsed components
+	float m_flCachedVector[3] = {};
+
+	int m_iParseCount = 0;
+	int m_iReportedParseCount = 0;
+
 #ifdef SERVER_DLL
 	cvar_t m_Cvar = {};
 #else
@@ -150,6 +196,19 @@ public:
 	static ConItemBase *FindItem(const char *name);
 	static ConVar *FindCvar(const char *name);
 	static ConVar *FindCvar(cvar_t *cvar);
+
+	/**
+	 * Prints how many times per second each cvar was parsed since the previous call.
+	 */
+	static void PrintParseStats();
 };
 
+/**
+ * Parses a string in format "RRR GGG BBB" where each component is integer [0; 255].
+ * @param	string	Input string
+ * @param	color	Output color (unchanged if returned false)
+ * @return	Whether or not string was parsed successfully.
+ */
+bool ParseColor(const char *string, Color &color);
+
 #endif
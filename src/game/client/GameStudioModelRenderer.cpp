@@ -61,6 +61,16 @@ CON_COMMAND(dev_model_debug, "Prints debug info for model enforcement")
 	g_StudioRenderer.PrintDebugInfo();
 }
 
+CON_COMMAND(dev_shadow_benchmark, "Rebuilds shadow data of all loaded models and prints timings")
+{
+	g_StudioRenderer.m_bBenchmarkShadowData = true;
+}
+
+CON_COMMAND(dev_shadow_stats, "Prints shadow data lookup counters")
+{
+	g_StudioRenderer.PrintShadowStats();
+}
+
 /*
 ====================
 CGameStudioModelRenderer
@@ -44,7 +44,7 @@ PFNGLLOCKARRAYSEXTPROC glLockArraysEXT;
 PFNGLUNLOCKARRAYSEXTPROC glUnlockArraysEXT;
 
 Vector vertexdata[MaxShadowFaceCount * 5];
-GLushort indexdata[MaxShadowFaceCount * 3 * 5];
+GLushort indexdata[MaxShadowFaceCount * 3 * 6 + 6];
 
 bool g_bShadows;
 extern ConVar cl_shadows;
@@ -168,6 +168,8 @@ void CStudioModelRenderer::Init(void)
 	sv_skyvec_y = gEngfuncs.pfnGetCvarPointer("sv_skyvec_y");
 	sv_skyvec_z = gEngfuncs.pfnGetCvarPointer("sv_skyvec_z");
 
+	m_ShadowKernel = ShadowGetBestKernel();
+
 	const GLubyte *str = glGetString(GL_RENDERER);
 	if (IEngineStudio.IsHardware() && str)
 	{
@@ -203,6 +205,12 @@ CStudioModelRenderer::CStudioModelRenderer(void)
 	m_pSubModel = NULL;
 	m_pPlayerInfo = NULL;
 	m_pRenderModel = NULL;
+	m_pCurretExtraData = NULL;
+	m_iRenderModelIndex = -1;
+	m_bCacheShadowData = false;
+	m_bBenchmarkShadowData = false;
+	m_bIgnoreShadowCache = false;
+	m_ShadowKernel = ShadowKernel::Scalar;
 }
 
 /*
@@ -1232,10 +1240,18 @@ int CStudioModelRenderer::StudioDrawModel(int flags)
 {
 	if (m_bCacheShadowData)
 	{
+		// Model indexes are only valid for one map
+		ResetShadowModelSlots();
 		StudioWriteDataAll();
 		m_bCacheShadowData = false;
 	}
 
+	if (m_bBenchmarkShadowData)
+	{
+		StudioBenchmarkData();
+		m_bBenchmarkShadowData = false;
+	}
+
 	alight_t lighting;
 	Vector dir;
 
@@ -1277,6 +1293,7 @@ int CStudioModelRenderer::StudioDrawModel(int flags)
 	}
 
 	m_pRenderModel = m_pCurrentEntity->model;
+	m_iRenderModelIndex = m_pCurrentEntity->curstate.modelindex;
 	m_pStudioHeader = (studiohdr_t *)IEngineStudio.Mod_Extradata(m_pRenderModel);
 	IEngineStudio.StudioSetHeader(m_pStudioHeader);
 	IEngineStudio.SetRenderModel(m_pRenderModel);
@@ -1574,6 +1591,7 @@ int CStudioModelRenderer::StudioDrawPlayer(int flags, entity_state_t *pplayer)
 		return 0;
 
 	m_pRenderModel = GetPlayerModel(m_nPlayerIndex);
+	m_iRenderModelIndex = -1; // model may be replaced, shadow data is looked up by player index
 	if (m_pRenderModel == NULL)
 		return 0;
 
@@ -1686,6 +1704,7 @@ int CStudioModelRenderer::StudioDrawPlayer(int flags, entity_state_t *pplayer)
 			IEngineStudio.StudioSetHeader(m_pStudioHeader);
 
 			m_pRenderModel = pweaponmodel; // buz
+			m_iRenderModelIndex = pplayer->weaponmodel;
 
 			StudioMergeBones(pweaponmodel);
 
@@ -1697,6 +1716,7 @@ int CStudioModelRenderer::StudioDrawPlayer(int flags, entity_state_t *pplayer)
 
 			*m_pCurrentEntity = saveent;
 			m_pRenderModel = savedmdl; // buz
+			m_iRenderModelIndex = -1;
 		}
 	}
 
@@ -1967,159 +1987,49 @@ void CStudioModelRenderer::StudioRenderFinal(void)
 
 /*
 ====================
-BuildFaces
+BuildSubModel
 ====================
 */
-void CStudioModelRenderer::BuildFaces(SubModelData &dst, mstudiomodel_t *src)
+void CStudioModelRenderer::BuildSubModel(SubModelData &dst, mstudiomodel_t *src)
 {
-	// get number of triangles in all meshes
-	int i, n = 0;
 	mstudiomesh_t *pmeshes = (mstudiomesh_t *)((byte *)m_pStudioHeader + src->meshindex);
-	for (i = 0; i < src->nummesh; i++)
-	{
-		int j;
-		short *ptricmds = (short *)((byte *)m_pStudioHeader + pmeshes[i].triindex);
-		while (j = *(ptricmds++))
-		{
-			if (j < 0)
-				j *= -1;
-			n += (j - 2);
-			ptricmds += 4 * j;
-		}
-	}
-
-	if (n == 0)
-		return;
+	std::vector<const short *> tricmds(src->nummesh);
 
-	dst.faces.reserve(n);
+	for (int i = 0; i < src->nummesh; i++)
+		tricmds[i] = (short *)((byte *)m_pStudioHeader + pmeshes[i].triindex);
 
-	for (i = 0; i < src->nummesh; i++)
-	{
-		short *ptricmds = (short *)((byte *)m_pStudioHeader + pmeshes[i].triindex);
-
-		int j;
-		while (j = *(ptricmds++))
-		{
-			if (j > 0)
-			{
-				// convert triangle strip
-				j -= 3;
-				assert(j >= 0);
-
-				short indices[3];
-				indices[0] = ptricmds[0];
-				ptricmds += 4;
-				indices[1] = ptricmds[0];
-				ptricmds += 4;
-				indices[2] = ptricmds[0];
-				ptricmds += 4;
-				dst.faces.push_back(Face(indices[0], indices[1], indices[2]));
-
-				bool reverse = false;
-				for (; j > 0; j--, ptricmds += 4)
-				{
-					indices[0] = indices[1];
-					indices[1] = indices[2];
-					indices[2] = ptricmds[0];
-
-					if (!reverse)
-						dst.faces.push_back(Face(indices[2], indices[1], indices[0]));
-					else
-						dst.faces.push_back(Face(indices[0], indices[1], indices[2]));
-					reverse = !reverse;
-				}
-			}
-			else
-			{
-				// convert triangle fan
-				j = -j - 3;
-				assert(j >= 0);
-
-				short indices[3];
-				indices[0] = ptricmds[0];
-				ptricmds += 4;
-				indices[1] = ptricmds[0];
-				ptricmds += 4;
-				indices[2] = ptricmds[0];
-				ptricmds += 4;
-				dst.faces.push_back(Face(indices[0], indices[1], indices[2]));
-
-				for (; j > 0; j--, ptricmds += 4)
-				{
-					indices[1] = indices[2];
-					indices[2] = ptricmds[0];
-					dst.faces.push_back(Face(indices[0], indices[1], indices[2]));
-				}
-			}
-		}
-	}
+	ShadowBuildSubModel(dst, tricmds.data(), src->nummesh);
 }
 
 /*
 ====================
-BuildEdges
+GetSubModelCount
 ====================
 */
-void CStudioModelRenderer::BuildEdges(SubModelData &dst, mstudiomodel_t *src)
+int CStudioModelRenderer::GetSubModelCount(void)
 {
-	if (dst.faces.size() == 0)
-		return;
-
-	dst.edges.reserve(dst.faces.size() * 3); // this is maximum
-	for (size_t i = 0; i < dst.faces.size(); i++)
-	{
-		Face &f = dst.faces[i];
-		AddEdge(dst, i, f.vertex0, f.vertex1);
-		AddEdge(dst, i, f.vertex1, f.vertex2);
-		AddEdge(dst, i, f.vertex2, f.vertex0);
-	}
+	int n = 0;
+	mstudiobodyparts_t *bp = (mstudiobodyparts_t *)((byte *)m_pStudioHeader + m_pStudioHeader->bodypartindex);
+	for (int i = 0; i < m_pStudioHeader->numbodyparts; i++)
+		n += bp[i].nummodels;
 
-	dst.edges.resize(dst.edges.size()); // can i free unused memory by doing this?
+	return n;
 }
 
 /*
 ====================
-AddEdge
+GetSubModelVertCounts
 ====================
 */
-void CStudioModelRenderer::AddEdge(SubModelData &dst, int face, int v0, int v1)
-{
-	// first look for face's neighbour
-	for (size_t i = 0; i < dst.edges.size(); i++)
-	{
-		Edge &e = dst.edges[i];
-		if ((e.vertex0 == v1) && (e.vertex1 == v0) && (e.face1 == -1))
-		{
-			e.face1 = face;
-			return;
-		}
-	}
-
-	// add new edge to list
-	Edge e;
-	e.face0 = face;
-	e.face1 = -1;
-	e.vertex0 = v0;
-	e.vertex1 = v1;
-	dst.edges.push_back(e);
-}
-
-void SpecialProcess(SubModelData &dst)
+void CStudioModelRenderer::GetSubModelVertCounts(std::vector<int> &numVerts)
 {
-	size_t i;
-	for (i = 0; i < dst.faces.size(); i++)
-	{
-		Face &f = dst.faces[i];
-		f.vertex0 *= 2;
-		f.vertex1 *= 2;
-		f.vertex2 *= 2;
-	}
-
-	for (i = 0; i < dst.edges.size(); i++)
+	numVerts.clear();
+	mstudiobodyparts_t *bp = (mstudiobodyparts_t *)((byte *)m_pStudioHeader + m_pStudioHeader->bodypartindex);
+	for (int i = 0; i < m_pStudioHeader->numbodyparts; i++)
 	{
-		Edge &e = dst.edges[i];
-		e.vertex0 *= 2;
-		e.vertex1 *= 2;
+		mstudiomodel_t *sm = (mstudiomodel_t *)((byte *)m_pStudioHeader + bp[i].modelindex);
+		for (int j = 0; j < bp[i].nummodels; j++)
+			numVerts.push_back(sm[j].numverts);
 	}
 }
 
@@ -2130,23 +2040,43 @@ SetupModelExtraData
 */
 void CStudioModelRenderer::SetupModelExtraData(void)
 {
-	m_pCurretExtraData = &m_ExtraData[m_pRenderModel->name];
+	m_ShadowStats.lookups++;
+
+	ShadowModelSlot *pSlot = GetShadowModelSlot();
 
-	if (StudioReadData())
+	if (pSlot && pSlot->model == m_pRenderModel && pSlot->data)
+	{
+		m_ShadowStats.slotHits++;
+		m_pCurretExtraData = pSlot->data;
 		return;
+	}
+
+	// Slow path: look up by name, only happens once per model and slot
+	m_ShadowStats.nameLookups++;
+	m_pCurretExtraData = &m_ExtraData[m_pRenderModel->name];
+
+	if (pSlot)
+	{
+		pSlot->model = m_pRenderModel;
+		pSlot->data = m_pCurretExtraData;
+	}
 
 	if (m_pCurretExtraData->submodels.size() > 0)
 		return;
 
+	if (!m_bIgnoreShadowCache && StudioReadData())
+	{
+		m_ShadowStats.cacheLoads++;
+		return;
+	}
+
 	// generate extra data for this model
 	gEngfuncs.Con_DPrintf("Generating extra data for model %s\n", m_pRenderModel->name);
 
 	// get number of submodels
 	int i = 0;
-	size_t n = 0;
+	size_t n = GetSubModelCount();
 	mstudiobodyparts_t *bp = (mstudiobodyparts_t *)((byte *)m_pStudioHeader + m_pStudioHeader->bodypartindex);
-	for (i = 0; i < m_pStudioHeader->numbodyparts; i++)
-		n += bp[i].nummodels;
 
 	if (n == 0)
 	{
@@ -2170,9 +2100,7 @@ void CStudioModelRenderer::SetupModelExtraData(void)
 				return;
 			}
 
-			BuildFaces(m_pCurretExtraData->submodels[n], &sm[j]);
-			BuildEdges(m_pCurretExtraData->submodels[n], &sm[j]);
-			SpecialProcess(m_pCurretExtraData->submodels[n]);
+			BuildSubModel(m_pCurretExtraData->submodels[n], &sm[j]);
 
 			facecounter += m_pCurretExtraData->submodels[n].faces.size();
 			edgecounter += m_pCurretExtraData->submodels[n].edges.size();
@@ -2182,9 +2110,66 @@ void CStudioModelRenderer::SetupModelExtraData(void)
 	}
 
 	gEngfuncs.Con_DPrintf("Done (%d polys, %d edges)\n", facecounter, edgecounter);
+	m_ShadowStats.builds++;
 	StudioWriteData();
 }
 
+/*
+====================
+GetShadowModelSlot
+====================
+*/
+ShadowModelSlot *CStudioModelRenderer::GetShadowModelSlot(void)
+{
+	if (m_pPlayerInfo)
+	{
+		// Player body, model depends on the player
+		if (m_nPlayerIndex >= 0 && m_nPlayerIndex < MAX_PLAYERS)
+			return &m_ShadowPlayerSlots[m_nPlayerIndex];
+
+		return NULL;
+	}
+
+	if (m_iRenderModelIndex <= 0 || m_iRenderModelIndex >= MaxShadowModelSlots)
+		return NULL;
+
+	if (m_iRenderModelIndex >= (int)m_ShadowModelSlots.size())
+		m_ShadowModelSlots.resize(m_iRenderModelIndex + 1);
+
+	return &m_ShadowModelSlots[m_iRenderModelIndex];
+}
+
+/*
+====================
+ResetShadowModelSlots
+====================
+*/
+void CStudioModelRenderer::ResetShadowModelSlots(void)
+{
+	m_ShadowModelSlots.clear();
+
+	for (int i = 0; i < MAX_PLAYERS; i++)
+		m_ShadowPlayerSlots[i] = ShadowModelSlot();
+
+	m_ShadowStats = ShadowStats();
+}
+
+/*
+====================
+PrintShadowStats
+====================
+*/
+void CStudioModelRenderer::PrintShadowStats(void)
+{
+	ConPrintf("Shadow data lookups since map start: %u\n", m_ShadowStats.lookups);
+	ConPrintf("  by model/player index: %u\n", m_ShadowStats.slotHits);
+	ConPrintf("  by model name: %u\n", m_ShadowStats.nameLookups);
+	ConPrintf("Models loaded from cache: %u\n", m_ShadowStats.cacheLoads);
+	ConPrintf("Models built: %u\n", m_ShadowStats.builds);
+	ConPrintf("Model slots: %d\n", (int)m_ShadowModelSlots.size());
+	ConPrintf("Shadow volume kernel: %s\n", ShadowGetKernelName(m_ShadowKernel));
+}
+
 /*
 ====================
 DrawShadowsForEnt
@@ -2208,7 +2193,7 @@ void CStudioModelRenderer::DrawShadowsForEnt(void)
 
 	SetupModelExtraData();
 
-	if (!m_pCurretExtraData)
+	if (!m_pCurretExtraData || m_pCurretExtraData->submodels.empty())
 		return;
 
 	glDepthMask(GL_FALSE);
@@ -2227,6 +2212,9 @@ void CStudioModelRenderer::DrawShadowsForEnt(void)
 		int index = m_pCurrentEntity->curstate.body / bp[i].base;
 		index = index % bp[i].nummodels;
 
+		if ((size_t)(index + baseindex) >= m_pCurretExtraData->submodels.size())
+			break;
+
 		mstudiomodel_t *sm = (mstudiomodel_t *)((byte *)m_pStudioHeader + bp[i].modelindex) + index;
 		DrawShadowVolume(m_pCurretExtraData->submodels[index + baseindex], sm);
 		baseindex += bp[i].nummodels;
@@ -2243,94 +2231,53 @@ DrawShadowVolume
 ====================
 */
 
-bool facelight[MaxShadowFaceCount];
+uint8_t facelight[ShadowFaceLightSize];
 
 void CStudioModelRenderer::DrawShadowVolume(SubModelData &data, mstudiomodel_t *model)
 {
 	if ((data.faces.size() == 0) || (data.faces.size() > MaxShadowFaceCount))
 		return;
 
+	if (model->numverts * 2 > MaxShadowFaceCount * 5)
+		return;
+
 	GetShadowVector(m_ShadowDir);
 
 	Vector d;
 	VectorScale(m_ShadowDir, 256, d);
 
-	// transform vertices by bone matrices
-
-	// get pointer to untransformed vertices
-	Vector *pstudioverts = (Vector *)((byte *)m_pStudioHeader + model->vertindex);
+	// transform vertices by bone matrices and find silhouette edges
+	ShadowVolumeParams params;
+	params.verts = (const float(*)[3])((byte *)m_pStudioHeader + model->vertindex);
+	params.vertBones = (byte *)m_pStudioHeader + model->vertinfoindex;
+	params.numVerts = model->numverts;
+	params.bones = *m_pbonetransform;
+	params.numBones = m_pStudioHeader->numbones;
+	VectorCopy(m_ShadowDir, params.lightDir);
+	VectorCopy(d, params.extrude);
 
-	// get pointer to bone index for each vertex
-	byte *pvertbone = ((byte *)m_pStudioHeader + model->vertinfoindex);
+	int numIndexes = ShadowBuildVolume(m_ShadowKernel, params, data, (float(*)[3])vertexdata, indexdata, facelight);
 
-	int i, j;
-	for (i = 0, j = 0; i < model->numverts; i++, j += 2)
-	{
-		VectorTransform(pstudioverts[i], (*m_pbonetransform)[pvertbone[i]], vertexdata[j]);
-		VectorSubtract(vertexdata[j], d, vertexdata[j + 1]);
-	}
+	if (numIndexes == 0)
+		return;
 
 	glLockArraysEXT(0, model->numverts * 2);
 
-	int facecount = 0;
-	GLushort *inddata = indexdata;
-
-	std::vector<Face>::iterator f;
-	for (f = data.faces.begin(), i = 0; f < data.faces.end(); ++f, ++i)
-	{
-		Vector v1, v2, norm;
-		VectorSubtract(vertexdata[f->vertex1], vertexdata[f->vertex0], v1);
-		VectorSubtract(vertexdata[f->vertex2], vertexdata[f->vertex1], v2);
-		CrossProduct(v2, v1, norm);
-		facelight[i] = (DotProduct(norm, m_ShadowDir) >= 0);
-	}
-
-	std::vector<Edge>::iterator e;
-	for (e = data.edges.begin(); e < data.edges.end(); ++e)
-	{
-		if (facelight[e->face0])
-		{
-			if ((e->face1 != -1) && facelight[e->face1])
-				continue;
-
-			inddata[0] = e->vertex0;
-			inddata[1] = e->vertex1;
-		}
-		else
-		{
-			if ((e->face1 == -1) || !facelight[e->face1])
-				continue;
-
-			inddata[0] = e->vertex1;
-			inddata[1] = e->vertex0;
-		}
-
-		inddata[2] = inddata[0] + 1;
-		inddata[3] = inddata[2];
-		inddata[4] = inddata[1];
-		inddata[5] = inddata[1] + 1;
-
-		inddata += 6;
-
-		facecount += 2;
-	}
-
-	assert((facecount * 3) <= (MaxShadowFaceCount * 5));
-
 	// z-pass method
 
 	// draw front faces incrementing stencil values
 	glStencilOp(GL_KEEP, GL_KEEP, GL_INCR);
 	glCullFace(GL_BACK);
-	glDrawElements(GL_TRIANGLES, facecount * 3, GL_UNSIGNED_SHORT, indexdata);
+	glDrawElements(GL_TRIANGLES, numIndexes, GL_UNSIGNED_SHORT, indexdata);
 	// draw back faces decrementing stencil values
 	glStencilOp(GL_KEEP, GL_KEEP, GL_DECR);
 	glCullFace(GL_FRONT);
-	glDrawElements(GL_TRIANGLES, facecount * 3, GL_UNSIGNED_SHORT, indexdata);
+	glDrawElements(GL_TRIANGLES, numIndexes, GL_UNSIGNED_SHORT, indexdata);
 
 	glUnlockArraysEXT();
 
-	g_shadowpolycounter += facecount * 2;
+	// Volume is drawn twice, once per stencil pass
+	g_shadowpolycounter += numIndexes / 3 * 2;
 }
 
 /*
@@ -2356,12 +2303,23 @@ void CStudioModelRenderer::GetShadowVector(Vector &vecOut)
 	VectorNormalize(vecOut);
 }
 
+#include <chrono>
 #include <fstream>
-#include <iostream>
-#include <filesystem>
+#include "mapped_file.h"
 
 using std::ios_base;
 
+//====================
+// GetShadowCacheFileName
+//
+// Returns path to the shadow cache file of current model.
+//====================
+void CStudioModelRenderer::GetShadowCacheFileName(char *buf, size_t size)
+{
+	std::string filename(m_pRenderModel->name);
+	snprintf(buf, size, "%s/%s/%s.dat", gEngfuncs.pfnGetGameDirectory(), "models/shadowcache", filename.substr(0, filename.rfind('.')).c_str() + 7);
+}
+
 //====================
 // StudioLoadData
 //
@@ -2370,56 +2328,26 @@ using std::ios_base;
 
 bool CStudioModelRenderer::StudioReadData(void)
 {
-	auto it = std::find(m_CachedInfos.begin(), m_CachedInfos.end(), m_pRenderModel->name);
-
-	if (it != m_CachedInfos.end())
-		return true;
-
-	int i;
 	char szFile[256];
+	GetShadowCacheFileName(szFile, sizeof(szFile));
 
-	std::string filename(m_pRenderModel->name);
-	sprintf(szFile, "%s/%s/%s.dat", gEngfuncs.pfnGetGameDirectory(), "models/shadowcache", filename.substr(0, filename.rfind('.')).c_str() + 7);
+	CMappedFile file;
 
-	std::ifstream fin(szFile, ios_base::in | ios_base::binary);
+	if (!file.Open(szFile))
+		return false;
 
-	if (fin.is_open())
-	{
-		int iSubmodelCount;
-		fin.read((char *)&iSubmodelCount, sizeof(int));
-		m_pCurretExtraData->submodels.resize(iSubmodelCount);
+	std::vector<int> numVerts;
+	GetSubModelVertCounts(numVerts);
 
-		for (i = 0; i < iSubmodelCount; i++)
-		{
-			int iTriangleCount;
-			int iEdgeCount;
-
-			Face m_fTriangles[MAXSTUDIOTRIANGLES];
-			Edge m_fEdges[MAXSTUDIOTRIANGLES];
-
-			SubModelData &m_pSubModel = m_pCurretExtraData->submodels[i];
-			fin.read((char *)&iTriangleCount, sizeof(int));
-			fin.read((char *)&m_fTriangles, sizeof(Face) * iTriangleCount);
-
-			fin.read((char *)&iEdgeCount, sizeof(int));
-			fin.read((char *)&m_fEdges, sizeof(Edge) * iEdgeCount);
-
-			m_pSubModel.faces.reserve(iTriangleCount);
-			for (int k = 0; k < iTriangleCount; k++)
-				m_pSubModel.faces.push_back(Face(m_fTriangles[k].vertex0, m_fTriangles[k].vertex1, m_fTriangles[k].vertex2));
-			m_pSubModel.edges.reserve(iEdgeCount);
-			for (int j = 0; j < iEdgeCount; j++)
-				m_pSubModel.edges.push_back(Edge(m_fEdges[j]));
-		}
-		gEngfuncs.Con_Printf("Loaded extra data for %s\n", m_pRenderModel->name);
-		fin.close();
+	if (!ShadowCacheRead(file.GetData(), file.GetSize(), m_pStudioHeader->length, numVerts, *m_pCurretExtraData))
+	{
+		gEngfuncs.Con_DPrintf("Extra data for %s is outdated or corrupted\n", m_pRenderModel->name);
+		return false;
+	}
 
-		m_CachedInfos.push_back(m_pRenderModel->name);
+	gEngfuncs.Con_Printf("Loaded extra data for %s\n", m_pRenderModel->name);
 
-		return true;
-	}
-	//gEngfuncs.Con_Printf("Error loading extra data for %s!\n", m_pRenderModel->name);
-	return false;
+	return true;
 }
 
 //====================
@@ -2429,34 +2357,17 @@ bool CStudioModelRenderer::StudioReadData(void)
 //====================
 void CStudioModelRenderer::StudioWriteData(void)
 {
-	size_t i;
 	char szFile[256];
+	GetShadowCacheFileName(szFile, sizeof(szFile));
+
+	std::vector<uint8_t> data;
+	ShadowCacheWrite(*m_pCurretExtraData, m_pStudioHeader->length, data);
 
-	std::string filename(m_pRenderModel->name);
-	sprintf(szFile, "%s/%s/%s.dat", gEngfuncs.pfnGetGameDirectory(), "models/shadowcache", filename.substr(0, filename.rfind('.')).c_str() + 7);
 	std::ofstream fout(szFile, ios_base::out | ios_base::binary | ios_base::trunc);
 
 	if (fout.is_open())
 	{
-		int iSubmodelCount = m_pCurretExtraData->submodels.size();
-		fout.write((const char *)&iSubmodelCount, sizeof(int));
-
-		for (i = 0; i < m_pCurretExtraData->submodels.size(); i++)
-		{
-			SubModelData &m_pSubModel = m_pCurretExtraData->submodels[i];
-			int iTriangleCount = m_pSubModel.faces.size();
-
-			if (iTriangleCount == 0)
-				continue;
-
-			fout.write((const char *)&iTriangleCount, sizeof(int));
-			fout.write((const char *)&m_pSubModel.faces[0], sizeof(Face) * iTriangleCount);
-
-			int iEdgeCount = m_pSubModel.edges.size();
-
-			fout.write((const char *)&iEdgeCount, sizeof(int));
-			fout.write((const char *)&m_pSubModel.edges[0], sizeof(Edge) * iEdgeCount);
-		}
+		fout.write((const char *)data.data(), data.size());
 		gEngfuncs.Con_DPrintf("Writing extra data for %s\n", m_pRenderModel->name);
 		fout.close();
 	}
@@ -2480,9 +2391,58 @@ void CStudioModelRenderer::StudioWriteDataAll()
 			continue;
 		}
 		m_pStudioHeader = (studiohdr_t *)IEngineStudio.Mod_Extradata(m_pRenderModel);
+		m_iRenderModelIndex = z;
 		SetupModelExtraData();
 
 		z++;
 		m_pRenderModel = IEngineStudio.GetModelByIndex(z);
 	}
 }
+
+//====================
+// StudioBenchmarkData
+//
+// Times shadow data precompute and cache loading for all loaded models.
+//====================
+void CStudioModelRenderer::StudioBenchmarkData()
+{
+	using Clock = std::chrono::high_resolution_clock;
+
+	// Precompute everything from scratch
+	ResetShadowModelSlots();
+	m_ExtraData.clear();
+	m_bIgnoreShadowCache = true;
+
+	auto startTime = Clock::now();
+	StudioWriteDataAll();
+	auto buildTime = Clock::now();
+
+	m_bIgnoreShadowCache = false;
+
+	// Load everything back from the cache
+	ResetShadowModelSlots();
+	m_ExtraData.clear();
+
+	auto loadStartTime = Clock::now();
+	StudioWriteDataAll();
+	auto loadTime = Clock::now();
+
+	size_t submodels = 0, faces = 0, edges = 0;
+	for (auto &i : m_ExtraData)
+	{
+		submodels += i.second.submodels.size();
+
+		for (SubModelData &sm : i.second.submodels)
+		{
+			faces += sm.faces.size();
+			edges += sm.edges.size();
+		}
+	}
+
+	std::chrono::duration<double, std::milli> buildMs = buildTime - startTime;
+	std::chrono::duration<double, std::milli> loadMs = loadTime - loadStartTime;
+
+	ConPrintf("Shadow data: %d models, %d submodels, %d faces, %d edges\n", (int)m_ExtraData.size(), (int)submodels, (int)faces, (int)edges);
+	ConPrintf("Precompute and write: %.3f ms\n", buildMs.count());
+	ConPrintf("Load from cache: %.3f ms\n", loadMs.count());
+}
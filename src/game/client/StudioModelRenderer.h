@@ -16,6 +16,7 @@
 // buz start
 // disable "identifier was truncated to '255' characters in the browser information" messages
 #include "opengl.h"
+#include "studio_shadow.h"
 
 #include <assert.h>
 #include <vector>
@@ -24,43 +25,18 @@
 
 const int MaxShadowFaceCount = 10000;
 
-// some precomputed data about model, for shadow volumes optimization
-
-struct Edge
-{
-	GLushort vertex0;
-	GLushort vertex1;
-	GLushort face0;
-	GLushort face1;
-};
-
-struct Face
-{
-	Face() { }
-	Face(GLushort v0, GLushort v1, GLushort v2)
-	    : vertex0(v0)
-	    , vertex1(v1)
-	    , vertex2(v2)
-	{
-	}
-	GLushort vertex0;
-	GLushort vertex1;
-	GLushort vertex2;
-};
+typedef std::map<std::string, ModelExtraData> ExtraDataMap;
 
-struct SubModelData
-{
-	std::vector<Face> faces;
-	std::vector<Edge> edges;
-};
+// Upper limit of model indexes that get a shadow data slot
+const int MaxShadowModelSlots = 4096;
 
-struct ModelExtraData
+// Shadow data resolved for a model or player index
+struct ShadowModelSlot
 {
-	std::vector<SubModelData> submodels;
+	model_t *model = nullptr;
+	ModelExtraData *data = nullptr;
 };
 
-typedef std::map<std::string, ModelExtraData> ExtraDataMap;
-
 // buz end
 
 /*
@@ -256,12 +232,38 @@ private:
 	ExtraDataMap m_ExtraData;
 	ModelExtraData *m_pCurretExtraData;
 
+	// Shadow data of models, indexed by model index. Reset on map change.
+	std::vector<ShadowModelSlot> m_ShadowModelSlots;
+
+	// Shadow data of player bodies, indexed by player index. Reset on map change.
+	ShadowModelSlot m_ShadowPlayerSlots[MAX_PLAYERS];
+
+	// Model index of m_pRenderModel, -1 if unknown or drawing a player body
+	int m_iRenderModelIndex;
+
+	struct ShadowStats
+	{
+		unsigned lookups = 0;
+		unsigned slotHits = 0;
+		unsigned nameLookups = 0;
+		unsigned cacheLoads = 0;
+		unsigned builds = 0;
+	};
+
+	ShadowStats m_ShadowStats;
+
 	Vector m_ShadowDir;
 
+	// Shadow volume kernel, the fastest one the CPU supports
+	ShadowKernel m_ShadowKernel;
+
 	void SetupModelExtraData(void);
-	void BuildFaces(SubModelData &dst, mstudiomodel_t *src);
-	void BuildEdges(SubModelData &dst, mstudiomodel_t *src);
-	void AddEdge(SubModelData &dst, int face, int v0, int v1);
+	ShadowModelSlot *GetShadowModelSlot(void);
+	void ResetShadowModelSlots(void);
+	void BuildSubModel(SubModelData &dst, mstudiomodel_t *src);
+	int GetSubModelCount(void);
+	void GetSubModelVertCounts(std::vector<int> &numVerts);
+	void GetShadowCacheFileName(char *buf, size_t size);
 
 	void DrawShadowsForEnt(void);
 	void DrawShadowVolume(SubModelData &data, mstudiomodel_t *model);
@@ -277,9 +279,17 @@ public:
 	bool StudioReadData();
 	void StudioWriteDataAll();
 
+	// Rebuilds shadow data of all loaded models and prints timings.
+	void StudioBenchmarkData();
+
+	// Prints shadow data lookup counters.
+	void PrintShadowStats(void);
+
 	bool m_bCacheShadowData;
+	bool m_bBenchmarkShadowData;
 
-	std::vector<std::string> m_CachedInfos;
+	// Don't read shadow data from models/shadowcache
+	bool m_bIgnoreShadowCache;
 };
 
 #endif // STUDIOMODELRENDERER_H
@@ -0,0 +1,193 @@
+#include <algorithm>
+#include <chrono>
+#include "async_log_writer.h"
+
+CAsyncLogWriter::CAsyncLogWriter(size_t bufferSize)
+{
+	size_t size = 1;
+
+	while (size < bufferSize)
+		size <<= 1;
+
+	m_pBuffer = std::make_unique<char[]>(size);
+	m_uBufferMask = size - 1;
+}
+
+CAsyncLogWriter::~CAsyncLogWriter()
+{
+	Shutdown();
+}
+
+void CAsyncLogWriter::Open(const char *path)
+{
+	Close();
+	StartWorker();
+
+	std::lock_guard<std::mutex> lock(m_FileMutex);
+	m_Path = path;
+	m_bIsOpen = true;
+}
+
+void CAsyncLogWriter::Close()
+{
+	if (!m_bIsOpen)
+		return;
+
+	Flush();
+
+	std::lock_guard<std::mutex> lock(m_FileMutex);
+
+	if (m_pFile)
+	{
+		fclose(m_pFile);
+		m_pFile = nullptr;
+	}
+
+	m_Path.clear();
+	m_bIsOpen = false;
+}
+
+bool CAsyncLogWriter::Write(const char *text, size_t len)
+{
+	if (!m_bIsOpen)
+		return false;
+
+	size_t size = m_uBufferMask + 1;
+	size_t writePos = m_uWritePos.load(std::memory_order_relaxed);
+	size_t used = writePos - m_uReadPos.load(std::memory_order_acquire);
+
+	if (len > size - used)
+	{
+		// Buffer is full, the worker can't keep up with the disk
+		m_Stats.droppedLines++;
+		m_Stats.droppedBytes += len;
+		WakeWorker();
+		return false;
+	}
+
+	size_t offset = writePos & m_uBufferMask;
+	size_t first = std::min(len, size - offset);
+	memcpy(m_pBuffer.get() + offset, text, first);
+	memcpy(m_pBuffer.get(), text + first, len - first);
+
+	m_uWritePos.store(writePos + len, std::memory_order_release);
+
+	m_Stats.writtenLines++;
+	m_Stats.writtenBytes += len;
+	m_Stats.maxUsage = std::max(m_Stats.maxUsage, used + len);
+
+	// Don't wait for the timer if the buffer is filling up quickly
+	if (used + len > size / 2)
+		WakeWorker();
+
+	return true;
+}
+
+void CAsyncLogWriter::Flush()
+{
+	if (!m_WorkerThread.joinable())
+		return;
+
+	std::unique_lock<std::mutex> lock(m_Mutex);
+	uint64_t request = ++m_uFlushRequest;
+	m_WakeCondVar.notify_all();
+	m_FlushCondVar.wait(lock, [&]() { return m_uFlushDone >= request; });
+}
+
+void CAsyncLogWriter::Shutdown()
+{
+	Close();
+
+	std::unique_lock<std::mutex> lock(m_Mutex);
+	m_bShutdown = true;
+	m_WakeCondVar.notify_all();
+	lock.unlock();
+
+	if (m_WorkerThread.joinable())
+	{
+		m_WorkerThread.join();
+	}
+}
+
+CAsyncLogWriter::Stats CAsyncLogWriter::GetStats() const
+{
+	Stats stats = m_Stats;
+	stats.batches = m_uBatches.load(std::memory_order_relaxed);
+	stats.bufferSize = m_uBufferMask + 1;
+	return stats;
+}
+
+void CAsyncLogWriter::StartWorker()
+{
+	if (m_WorkerThread.joinable())
+		return;
+
+	m_bShutdown = false;
+	m_WorkerThread = std::thread([this]() { WorkerThreadFunc(); });
+}
+
+void CAsyncLogWriter::WakeWorker()
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	m_bWakeRequested = true;
+	m_WakeCondVar.notify_all();
+}
+
+void CAsyncLogWriter::WorkerThreadFunc() noexcept
+{
+	std::unique_lock<std::mutex> lock(m_Mutex);
+
+	for (;;)
+	{
+		m_WakeCondVar.wait_for(lock, std::chrono::milliseconds(FLUSH_INTERVAL_MS), [&]() {
+			return m_bShutdown || m_bWakeRequested || m_uFlushRequest != m_uFlushDone;
+		});
+
+		m_bWakeRequested = false;
+		uint64_t flushRequest = m_uFlushRequest;
+		bool shutdown = m_bShutdown;
+
+		lock.unlock();
+		WriteBatch();
+		lock.lock();
+
+		if (m_uFlushDone != flushRequest)
+		{
+			m_uFlushDone = flushRequest;
+			m_FlushCondVar.notify_all();
+		}
+
+		if (shutdown)
+			break;
+	}
+}
+
+void CAsyncLogWriter::WriteBatch()
+{
+	std::lock_guard<std::mutex> lock(m_FileMutex);
+
+	size_t readPos = m_uReadPos.load(std::memory_order_relaxed);
+	size_t writePos = m_uWritePos.load(std::memory_order_acquire);
+
+	if (readPos == writePos)
+		return;
+
+	// Text is discarded if the file can't be opened
+	if (!m_pFile && !m_Path.empty())
+		m_pFile = fopen(m_Path.c_str(), "a");
+
+	if (m_pFile)
+	{
+		size_t size = m_uBufferMask + 1;
+		size_t len = writePos - readPos;
+		size_t offset = readPos & m_uBufferMask;
+		size_t first = std::min(len, size - offset);
+
+		fwrite(m_pBuffer.get() + offset, 1, first, m_pFile);
+		fwrite(m_pBuffer.get(), 1, len - first, m_pFile);
+		fflush(m_pFile);
+	}
+
+	m_uReadPos.store(writePos, std::memory_order_release);
+	m_uBatches.fetch_add(1, std::memory_order_relaxed);
+}
@@ -0,0 +1,132 @@
+//
+// async_log_writer.h
+//
+// Appends text to a file from a background thread.
+//
+#ifndef ASYNC_LOG_WRITER_H
+#define ASYNC_LOG_WRITER_H
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+/**
+ * Buffered log file writer.
+ * Text is put into a lock-free ring buffer by one producer thread (the game thread)
+ * and written to the file by a worker thread in batches.
+ * Write, Open, Close, Flush and Shutdown must be called from the same thread.
+ */
+class CAsyncLogWriter
+{
+public:
+	static constexpr size_t DEFAULT_BUFFER_SIZE = 256 * 1024;
+	static constexpr int FLUSH_INTERVAL_MS = 500; //!< Max time text stays in the buffer
+
+	struct Stats
+	{
+		uint64_t writtenLines = 0; //!< Write calls that were accepted
+		uint64_t writtenBytes = 0;
+		uint64_t droppedLines = 0; //!< Write calls rejected because the buffer was full
+		uint64_t droppedBytes = 0;
+		uint64_t batches = 0; //!< Number of batches written by the worker
+		size_t maxUsage = 0; //!< Max number of bytes in the buffer
+		size_t bufferSize = 0;
+	};
+
+	/**
+	 * @param	bufferSize	Ring buffer size, rounded up to a power of two.
+	 */
+	CAsyncLogWriter(size_t bufferSize = DEFAULT_BUFFER_SIZE);
+	CAsyncLogWriter(const CAsyncLogWriter &) = delete;
+	~CAsyncLogWriter();
+
+	CAsyncLogWriter &operator=(const CAsyncLogWriter &) = delete;
+
+	/**
+	 * Sets the file to append the text to. Previous file is closed.
+	 * The file is opened by the worker when there is something to write.
+	 * @param	path	Path to the file.
+	 */
+	void Open(const char *path);
+
+	/**
+	 * Writes buffered text and closes the file.
+	 */
+	void Close();
+
+	/**
+	 * Returns whether a file is set.
+	 */
+	inline bool IsOpen() const { return m_bIsOpen; }
+
+	/**
+	 * Puts text into the buffer. Never blocks.
+	 * @returns false if the file is not open or text doesn't fit into the buffer and was dropped.
+	 */
+	bool Write(const char *text, size_t len);
+
+	/**
+	 * Puts text into the buffer. Never blocks.
+	 */
+	inline bool Write(const char *text) { return Write(text, strlen(text)); }
+
+	/**
+	 * Blocks until all buffered text is written to the file.
+	 */
+	void Flush();
+
+	/**
+	 * Closes the file and stops the worker thread.
+	 */
+	void Shutdown();
+
+	/**
+	 * Returns counters. Not synchronized with the worker, for display only.
+	 */
+	Stats GetStats() const;
+
+private:
+	std::unique_ptr<char[]> m_pBuffer;
+	size_t m_uBufferMask = 0;
+
+	// Ring buffer positions. They only grow, index is pos & m_uBufferMask.
+	alignas(64) std::atomic<size_t> m_uWritePos { 0 }; // Owned by producer
+	alignas(64) std::atomic<size_t> m_uReadPos { 0 }; // Owned by worker
+
+	// Producer-side counters
+	Stats m_Stats;
+	std::atomic<uint64_t> m_uBatches { 0 };
+
+	bool m_bIsOpen = false;
+
+	// File state, protected by m_FileMutex
+	std::mutex m_FileMutex;
+	std::string m_Path;
+	FILE *m_pFile = nullptr;
+
+	// Worker wakeup and flush handshake, protected by m_Mutex
+	std::thread m_WorkerThread;
+	std::mutex m_Mutex;
+	std::condition_variable m_WakeCondVar;
+	std::condition_variable m_FlushCondVar;
+	bool m_bShutdown = false;
+	bool m_bWakeRequested = false;
+	uint64_t m_uFlushRequest = 0;
+	uint64_t m_uFlushDone = 0;
+
+	void StartWorker();
+	void WakeWorker();
+	void WorkerThreadFunc() noexcept;
+
+	/**
+	 * Writes everything that is in the buffer to the file.
+	 */
+	void WriteBatch();
+};
+
+#endif
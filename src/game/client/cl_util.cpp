@@ -24,6 +24,9 @@
 
 #include "hud.h"
 #include "cl_util.h"
+#include "cl_entity.h"
+#include "com_model.h"
+#include "map_entities.h"
 #include <string.h>
 
 #ifndef M_PI
@@ -104,56 +107,6 @@ HSPRITE LoadSprite(const char *pszName)
 	return SPR_Load(sz);
 }
 
-bool ParseColor(const char *string, Color &color)
-{
-	Color newColor;
-	const char *value = string;
-
-	// Red
-	{
-		while (*value == ' ')
-			value++;
-
-		if (*value < '0' || *value > '9')
-			return false;
-
-		newColor[0] = atoi(value);
-
-		value = strchr(value, ' ');
-		if (value == NULL)
-			return false;
-	}
-
-	// Green
-	{
-		while (*value == ' ')
-			value++;
-
-		if (*value < '0' || *value > '9')
-			return false;
-
-		newColor[1] = atoi(value);
-		value = strchr(value, ' ');
-		if (value == NULL)
-			return false;
-	}
-
-	// Blue
-	{
-		while (*value == ' ')
-			value++;
-
-		if (*value < '0' || *value > '9')
-			return false;
-
-		newColor[2] = atoi(value);
-	}
-
-	newColor[3] = 255;
-	color = newColor;
-	return true;
-}
-
 //-------------------------------------------------------------------
 // Text drawing in console font
 //-------------------------------------------------------------------
@@ -289,3 +242,26 @@ const char *RemoveColorCodes(const char *string)
 	RemoveColorCodes(string, buffer, sizeof(buffer));
 	return buffer;
 }
+
+const CMapEntityIndex &GetMapEntities()
+{
+	static CMapEntityIndex s_Index;
+	static const char *s_pLump = nullptr;
+	static char s_szMapName[64];
+
+	cl_entity_t *pEnt = gEngfuncs.GetEntityByIndex(0); // get world model
+	model_t *pModel = pEnt ? pEnt->model : nullptr;
+	const char *pLump = pModel ? pModel->entities : nullptr;
+	const char *pszMapName = pModel ? pModel->name : "";
+
+	if (pLump != s_pLump || strcmp(pszMapName, s_szMapName))
+	{
+		s_pLump = pLump;
+		safe_strcpy(s_szMapName, pszMapName, sizeof(s_szMapName));
+
+		if (!s_Index.Parse(pLump))
+			gEngfuncs.Con_DPrintf("GetMapEntities: %s\n", s_Index.GetError());
+	}
+
+	return s_Index;
+}
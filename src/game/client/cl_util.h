@@ -161,14 +161,6 @@ inline void UnpackRGB(int &r, int &g, int &b, unsigned long ulRGB)
 
 HSPRITE LoadSprite(const char *pszName);
 
-/**
- * Parses a string in format "RRR GGG BBB" where each component is integer [0; 255].
- * @param	string	Input string
- * @param	color	Output color (unchanged if returned false)
- * @return	Whether or not string was parsed successfully.
- */
-bool ParseColor(const char *string, Color &color);
-
 //-------------------------------------------------------------------
 // Text drawing in console font
 //-------------------------------------------------------------------
@@ -243,4 +235,16 @@ void RemoveColorCodes(const char *string, char *buf, size_t bufSize);
  */
 const char *RemoveColorCodes(const char *string);
 
+//-------------------------------------------------------------------
+// Map entities
+//-------------------------------------------------------------------
+
+class CMapEntityIndex;
+
+/**
+ * Returns entities from the entity lump of the current map.
+ * The lump is parsed on the first call after a map change.
+ */
+const CMapEntityIndex &GetMapEntities();
+
 #endif
@@ -7,9 +7,11 @@
 #include <KeyValues.h>
 #include <vgui/IPanel.h>
 #include <vgui/ILocalize.h>
+#include <vgui/ISurface.h>
 #include <vgui_controls/Controls.h>
 #include <convar.h>
 #include "console.h"
+#include "glyph_cache.h"
 #include "client_vgui.h"
 #include "vgui/client_viewport.h"
 #include "gameui/gameui_viewport.h"
@@ -26,6 +28,24 @@ HScheme VGui_GetDefaultScheme()
 
 }
 
+namespace
+{
+
+class CVGuiGlyphSource : public IGlyphMetricsSource
+{
+public:
+	virtual int GetCharAdvance(unsigned long font, wchar_t ch) override
+	{
+		int a, b, c;
+		vgui2::surface()->GetCharABCwide(font, ch, a, b, c);
+		return a + b + c;
+	}
+};
+
+CVGuiGlyphSource s_GlyphSource;
+
+}
+
 void CClientVGUI::Initialize(CreateInterfaceFn *pFactories, int iNumFactories)
 {
 	ConnectTier1Libraries(pFactories, iNumFactories);
@@ -37,6 +57,8 @@ void CClientVGUI::Initialize(CreateInterfaceFn *pFactories, int iNumFactories)
 		Assert(false);
 	}
 
+	CGlyphCache::Get().SetSource(&s_GlyphSource);
+
 	// Add language files
 	g_pVGuiLocalize->AddFile(g_pFullFileSystem, VGUI2_ROOT_DIR "resource/language/bugfixedhl_%language%.txt");
 
@@ -21,6 +21,10 @@ enum
 	TYPE_SVC_STATUS, //!< CSvcMessages::SendStatusRequest
 };
 
+// TYPE_SVC_STATUS data, a random magic number.
+// It prevents the game from interpreting messages recorded in other mods.
+constexpr unsigned DEMO_SVC_STATUS_MAGIC = 2498416793;
+
 void Demo_WriteBuffer(int type, int size, unsigned char *buffer);
 
 extern int g_demosniper;
@@ -0,0 +1,722 @@
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <ctime>
+#include <unordered_set>
+#include "demo_catalog.h"
+
+#if HAS_STD_FILESYSTEM
+#include <filesystem>
+
+namespace fs = std::filesystem;
+
+namespace
+{
+
+constexpr size_t HEADER_SIZE = 8;
+constexpr size_t ADD_RECORD_SIZE = 1 + 4 + 8 + 8 + 1 + 2; // Without the strings
+constexpr size_t SIZE_RECORD_SIZE = 1 + 4 + 8;
+constexpr size_t REMOVE_RECORD_SIZE = 1 + 4;
+constexpr int64_t SECONDS_IN_DAY = 24 * 60 * 60;
+
+template <typename T>
+void AppendValue(std::string &log, T value)
+{
+	log.append(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+template <typename T>
+T ReadValue(const char *p)
+{
+	T value;
+	memcpy(&value, p, sizeof(value));
+	return value;
+}
+
+std::string MakeHeader()
+{
+	std::string header;
+	AppendValue(header, CDemoCatalog::FILE_MAGIC);
+	AppendValue(header, CDemoCatalog::FILE_VERSION);
+	return header;
+}
+
+/**
+ * Returns the map name from a results demo path: results/<month>/<map>-<date>-<time>.dem
+ */
+std::string GetMapFromPath(const std::string &path)
+{
+	size_t start = path.find_last_of("/\\");
+	start = start == std::string::npos ? 0 : start + 1;
+	size_t end = path.rfind('.');
+
+	if (end == std::string::npos || end < start)
+		end = path.size();
+
+	for (int i = 0; i < 2; i++)
+	{
+		size_t dash = path.rfind('-', end - 1);
+
+		if (dash == std::string::npos || dash <= start)
+			break;
+
+		end = dash;
+	}
+
+	return path.substr(start, end - start);
+}
+
+bool ContainsNoCase(const std::string &str, const char *substr)
+{
+	auto it = std::search(str.begin(), str.end(), substr, substr + strlen(substr), [](char a, char b) {
+		return tolower((unsigned char)a) == tolower((unsigned char)b);
+	});
+
+	return it != str.end();
+}
+
+}
+
+CDemoCatalog::~CDemoCatalog()
+{
+	Shutdown();
+}
+
+bool CDemoCatalog::Open(const char *gameDir, const char *fileName, const char *oldListName)
+{
+	Shutdown();
+
+	m_GameDir = gameDir;
+	m_FilePath = m_GameDir + fileName;
+	m_Demos.clear();
+	m_uNextId = 1;
+	m_uRecordingId = 0;
+	m_PendingLog.clear();
+	m_SizeRequests.clear();
+	m_bPurgeRequested = false;
+	m_bRetryCompact = false;
+	m_bHasPurgeResult = false;
+	m_PurgeResult = PurgeResult();
+	m_bShutdown = false;
+	m_uLogRecordCount = 0;
+
+	// The log is small, it's read at once
+	std::string data;
+	bool isValid = true;
+	FILE *file = fopen(m_FilePath.c_str(), "rb");
+
+	if (file)
+	{
+		char buf[64 * 1024];
+		size_t len;
+
+		while ((len = fread(buf, 1, sizeof(buf), file)) > 0)
+			data.append(buf, len);
+
+		fclose(file);
+		isValid = ParseLog(data);
+	}
+
+	// A new or damaged file is written from scratch
+	m_bNeedsCompact = !file || !isValid;
+
+	m_OldListPath.clear();
+
+	if (oldListName)
+	{
+		m_OldListPath = m_GameDir + oldListName;
+
+		if (ImportOldList(m_OldListPath))
+			m_bNeedsCompact = true;
+		else
+			m_OldListPath.clear();
+	}
+
+	m_WorkerThread = std::thread([this]() { WorkerThreadFunc(); });
+	return isValid;
+}
+
+void CDemoCatalog::Shutdown()
+{
+	if (!m_WorkerThread.joinable())
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_bShutdown = true;
+	}
+
+	m_WakeCondVar.notify_one();
+	m_WorkerThread.join();
+}
+
+uint32_t CDemoCatalog::AddDemo(const char *path, const char *map, int64_t time)
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+
+	Demo demo;
+	demo.id = m_uNextId++;
+	demo.time = time;
+	demo.map = map;
+	demo.path = path;
+	AppendAddRecord(m_PendingLog, demo);
+	m_uLogRecordCount++;
+	m_Demos.push_back(std::move(demo));
+	m_uRecordingId = m_Demos.back().id;
+
+	m_WakeCondVar.notify_one();
+	return m_uRecordingId;
+}
+
+void CDemoCatalog::FinishDemo(uint32_t id, const PurgePolicy &policy)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+
+		if (m_uRecordingId == id)
+			m_uRecordingId = 0;
+
+		m_SizeRequests.push_back(id);
+	}
+
+	Purge(policy);
+}
+
+void CDemoCatalog::Purge(const PurgePolicy &policy)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_PurgePolicy = policy;
+		m_bPurgeRequested = true;
+	}
+
+	m_WakeCondVar.notify_one();
+}
+
+bool CDemoCatalog::TakePurgeResult(PurgeResult &result)
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+
+	if (!m_bHasPurgeResult)
+		return false;
+
+	result = std::move(m_PurgeResult);
+	m_PurgeResult = PurgeResult();
+	m_bHasPurgeResult = false;
+	return true;
+}
+
+std::vector<CDemoCatalog::Demo> CDemoCatalog::Find(const char *mapFilter, size_t maxCount, size_t &matchCount) const
+{
+	std::vector<Demo> result;
+	matchCount = 0;
+
+	std::lock_guard<std::mutex> lock(m_Mutex);
+
+	for (auto it = m_Demos.rbegin(); it != m_Demos.rend(); ++it)
+	{
+		if (mapFilter && mapFilter[0] && !ContainsNoCase(it->map, mapFilter))
+			continue;
+
+		matchCount++;
+
+		if (result.size() < maxCount)
+			result.push_back(*it);
+	}
+
+	std::reverse(result.begin(), result.end());
+	return result;
+}
+
+CDemoCatalog::Stats CDemoCatalog::GetStats() const
+{
+	Stats stats;
+	std::lock_guard<std::mutex> lock(m_Mutex);
+
+	for (const Demo &demo : m_Demos)
+	{
+		stats.count++;
+		stats.totalBytes += demo.size;
+
+		if (demo.size == 0)
+			stats.unknownSizeCount++;
+	}
+
+	stats.isPurging = m_bPurgeRequested || m_bIsPurging;
+	return stats;
+}
+
+void CDemoCatalog::Flush()
+{
+	std::unique_lock<std::mutex> lock(m_Mutex);
+
+	if (!m_WorkerThread.joinable())
+		return;
+
+	m_IdleCondVar.wait(lock, [this]() { return !m_bIsBusy && !HasWork(); });
+}
+
+void CDemoCatalog::AppendAddRecord(std::string &log, const Demo &demo)
+{
+	uint8_t mapLen = (uint8_t)std::min(demo.map.size(), (size_t)UINT8_MAX);
+	uint16_t pathLen = (uint16_t)std::min(demo.path.size(), (size_t)UINT16_MAX);
+
+	AppendValue(log, (uint8_t)RECORD_ADD);
+	AppendValue(log, demo.id);
+	AppendValue(log, demo.time);
+	AppendValue(log, demo.size);
+	AppendValue(log, mapLen);
+	AppendValue(log, pathLen);
+	log.append(demo.map, 0, mapLen);
+	log.append(demo.path, 0, pathLen);
+}
+
+void CDemoCatalog::AppendSizeRecord(std::string &log, uint32_t id, uint64_t size)
+{
+	AppendValue(log, (uint8_t)RECORD_SIZE);
+	AppendValue(log, id);
+	AppendValue(log, size);
+}
+
+void CDemoCatalog::AppendRemoveRecord(std::string &log, uint32_t id)
+{
+	AppendValue(log, (uint8_t)RECORD_REMOVE);
+	AppendValue(log, id);
+}
+
+bool CDemoCatalog::ParseLog(const std::string &data)
+{
+	if (data.size() < HEADER_SIZE || data.compare(0, HEADER_SIZE, MakeHeader()))
+		return false;
+
+	const char *p = data.data();
+	size_t pos = HEADER_SIZE;
+
+	while (pos < data.size())
+	{
+		size_t rest = data.size() - pos;
+
+		switch ((uint8_t)p[pos])
+		{
+		case RECORD_ADD:
+		{
+			if (rest < ADD_RECORD_SIZE)
+				return false;
+
+			Demo demo;
+			demo.id = ReadValue<uint32_t>(p + pos + 1);
+			demo.time = ReadValue<int64_t>(p + pos + 5);
+			demo.size = ReadValue<uint64_t>(p + pos + 13);
+			size_t mapLen = ReadValue<uint8_t>(p + pos + 21);
+			size_t pathLen = ReadValue<uint16_t>(p + pos + 22);
+
+			if (rest < ADD_RECORD_SIZE + mapLen + pathLen || demo.id < m_uNextId)
+				return false;
+
+			pos += ADD_RECORD_SIZE;
+			demo.map.assign(p + pos, mapLen);
+			demo.path.assign(p + pos + mapLen, pathLen);
+			pos += mapLen + pathLen;
+
+			m_uNextId = demo.id + 1;
+			m_Demos.push_back(std::move(demo));
+			break;
+		}
+		case RECORD_SIZE:
+		{
+			if (rest < SIZE_RECORD_SIZE)
+				return false;
+
+			Demo *demo = FindDemo(ReadValue<uint32_t>(p + pos + 1));
+
+			if (demo)
+				demo->size = ReadValue<uint64_t>(p + pos + 5);
+
+			pos += SIZE_RECORD_SIZE;
+			break;
+		}
+		case RECORD_REMOVE:
+		{
+			if (rest < REMOVE_RECORD_SIZE)
+				return false;
+
+			Demo *demo = FindDemo(ReadValue<uint32_t>(p + pos + 1));
+
+			if (demo)
+				m_Demos.erase(m_Demos.begin() + (demo - m_Demos.data()));
+
+			pos += REMOVE_RECORD_SIZE;
+			break;
+		}
+		default:
+			return false;
+		}
+
+		m_uLogRecordCount++;
+	}
+
+	return true;
+}
+
+bool CDemoCatalog::ImportOldList(const std::string &path)
+{
+	FILE *file = fopen(path.c_str(), "rb");
+
+	if (!file)
+		return false;
+
+	// The list could be imported before the game was closed
+	std::unordered_set<std::string> knownPaths;
+
+	for (const Demo &demo : m_Demos)
+		knownPaths.insert(demo.path);
+
+	// Rows are "[YYYY-mm-dd HH:MM:SS] <path>"
+	char buf[512];
+
+	while (fgets(buf, sizeof(buf), file))
+	{
+		if (buf[0] != '[' || strlen(buf) < 23 || buf[20] != ']')
+			continue;
+
+		struct tm inTm;
+		memset(&inTm, 0, sizeof(inTm));
+
+		if (sscanf(buf + 1, "%4d-%2d-%2d %2d:%2d:%2d", &inTm.tm_year, &inTm.tm_mon, &inTm.tm_mday, &inTm.tm_hour, &inTm.tm_min, &inTm.tm_sec) != 6)
+			continue;
+
+		inTm.tm_year -= 1900;
+		inTm.tm_mon -= 1;
+		inTm.tm_isdst = -1;
+
+		std::string demoPath = buf + 22;
+
+		while (!demoPath.empty() && (demoPath.back() == '\r' || demoPath.back() == '\n'))
+			demoPath.pop_back();
+
+		if (demoPath.empty() || !knownPaths.insert(demoPath).second)
+			continue;
+
+		Demo demo;
+		demo.id = m_uNextId++;
+		demo.time = (int64_t)mktime(&inTm);
+		demo.map = GetMapFromPath(demoPath);
+		demo.path = std::move(demoPath);
+		m_Demos.push_back(std::move(demo));
+	}
+
+	fclose(file);
+	return true;
+}
+
+CDemoCatalog::Demo *CDemoCatalog::FindDemo(uint32_t id)
+{
+	auto it = std::lower_bound(m_Demos.begin(), m_Demos.end(), id, [](const Demo &demo, uint32_t id) { return demo.id < id; });
+	return it != m_Demos.end() && it->id == id ? &*it : nullptr;
+}
+
+bool CDemoCatalog::HasWork() const
+{
+	return !m_PendingLog.empty() || !m_SizeRequests.empty() || m_bPurgeRequested || m_bNeedsCompact;
+}
+
+bool CDemoCatalog::GetFileSize(const std::string &path, uint64_t &size)
+{
+	std::error_code ec;
+	size = fs::file_size(fs::u8path(m_GameDir + path), ec);
+	return !ec;
+}
+
+void CDemoCatalog::WorkerThreadFunc() noexcept
+{
+	std::unique_lock<std::mutex> lock(m_Mutex);
+
+	for (;;)
+	{
+		m_bIsBusy = false;
+		m_IdleCondVar.notify_all();
+		m_WakeCondVar.wait(lock, [this]() { return m_bShutdown || HasWork(); });
+		m_bIsBusy = true;
+
+		if (m_bNeedsCompact || m_bRetryCompact)
+		{
+			m_bNeedsCompact = false;
+			m_bRetryCompact = false;
+			lock.unlock();
+			Compact();
+			lock.lock();
+		}
+
+		// Sizes and purging can wait for the next start
+		if (!m_bShutdown)
+		{
+			if (!m_SizeRequests.empty())
+			{
+				std::vector<uint32_t> ids;
+				ids.swap(m_SizeRequests);
+				lock.unlock();
+				ReadSizes(ids);
+				lock.lock();
+			}
+
+			if (m_bPurgeRequested)
+			{
+				PurgePolicy policy = m_PurgePolicy;
+				m_bPurgeRequested = false;
+				m_bIsPurging = true;
+				lock.unlock();
+				RunPurge(policy);
+				lock.lock();
+				m_bIsPurging = false;
+			}
+		}
+
+		if (m_bRetryCompact)
+		{
+			// The file isn't consistent with memory, the whole catalog is written by the retry
+			m_PendingLog.clear();
+		}
+		else if (!m_PendingLog.empty())
+		{
+			std::string log;
+			log.swap(m_PendingLog);
+			lock.unlock();
+			WriteLog(log);
+			lock.lock();
+		}
+
+		// Compact when most of the log is removed demos
+		if (!m_bShutdown && m_uLogRecordCount >= MIN_COMPACT_RECORDS && m_uLogRecordCount > m_Demos.size() * 2)
+			m_bNeedsCompact = true;
+
+		if (m_bShutdown)
+			break;
+	}
+
+	m_bIsBusy = false;
+	m_IdleCondVar.notify_all();
+	lock.unlock();
+
+	if (m_pFile)
+	{
+		fclose(m_pFile);
+		m_pFile = nullptr;
+	}
+}
+
+void CDemoCatalog::ReadSizes(std::vector<uint32_t> &ids)
+{
+	for (uint32_t id : ids)
+	{
+		std::string path;
+
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			Demo *demo = FindDemo(id);
+
+			if (!demo)
+				continue;
+
+			path = demo->path;
+		}
+
+		uint64_t size;
+		bool exists = GetFileSize(path, size);
+
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		Demo *demo = FindDemo(id);
+
+		if (!demo)
+			continue;
+
+		if (exists)
+		{
+			demo->size = size;
+			AppendSizeRecord(m_PendingLog, id, size);
+			m_uLogRecordCount++;
+		}
+		else if (id != m_uRecordingId)
+		{
+			// Removed by the user or never recorded
+			m_Demos.erase(m_Demos.begin() + (demo - m_Demos.data()));
+			AppendRemoveRecord(m_PendingLog, id);
+			m_uLogRecordCount++;
+		}
+	}
+}
+
+void CDemoCatalog::RunPurge(const PurgePolicy &policy)
+{
+	struct Candidate
+	{
+		uint32_t id;
+		int64_t time;
+		uint64_t size;
+		std::string path;
+	};
+
+	std::vector<Candidate> candidates;
+	std::vector<uint32_t> unknownSizes;
+
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+
+		// The game could be closed while recording
+		for (const Demo &demo : m_Demos)
+		{
+			if (demo.size == 0 && demo.id != m_uRecordingId)
+				unknownSizes.push_back(demo.id);
+		}
+	}
+
+	ReadSizes(unknownSizes);
+
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		candidates.reserve(m_Demos.size());
+
+		for (const Demo &demo : m_Demos)
+		{
+			if (demo.id != m_uRecordingId)
+				candidates.push_back({ demo.id, demo.time, demo.size, demo.path });
+		}
+	}
+
+	std::stable_sort(candidates.begin(), candidates.end(), [](const Candidate &a, const Candidate &b) { return a.time < b.time; });
+
+	uint64_t totalBytes = 0;
+
+	for (const Candidate &i : candidates)
+		totalBytes += i.size;
+
+	int64_t oldestTime = policy.now - policy.keepDays * SECONDS_IN_DAY;
+	PurgeResult result;
+	std::vector<uint32_t> removedIds;
+
+	for (const Candidate &i : candidates)
+	{
+		bool isOld = i.time < oldestTime;
+		bool isOverQuota = policy.maxBytes != 0 && totalBytes > policy.maxBytes;
+
+		if (!isOld && !isOverQuota)
+			break;
+
+		std::error_code ec;
+		fs::remove(fs::u8path(m_GameDir + i.path), ec);
+
+		if (ec)
+		{
+			result.errors.push_back("Failed to remove file " + i.path + ": " + ec.message());
+			continue;
+		}
+
+		totalBytes -= i.size;
+		result.removedCount++;
+		result.removedBytes += i.size;
+		removedIds.push_back(i.id);
+	}
+
+	std::lock_guard<std::mutex> lock(m_Mutex);
+
+	if (!removedIds.empty())
+	{
+		std::sort(removedIds.begin(), removedIds.end());
+
+		auto it = std::remove_if(m_Demos.begin(), m_Demos.end(), [&](const Demo &demo) {
+			return std::binary_search(removedIds.begin(), removedIds.end(), demo.id);
+		});
+
+		m_Demos.erase(it, m_Demos.end());
+
+		for (uint32_t id : removedIds)
+			AppendRemoveRecord(m_PendingLog, id);
+
+		m_uLogRecordCount += removedIds.size();
+	}
+
+	// Results that weren't taken are added up
+	m_PurgeResult.removedCount += result.removedCount;
+	m_PurgeResult.removedBytes += result.removedBytes;
+	m_PurgeResult.errors.insert(m_PurgeResult.errors.end(), result.errors.begin(), result.errors.end());
+	m_bHasPurgeResult = true;
+}
+
+void CDemoCatalog::Compact()
+{
+	std::string log = MakeHeader();
+	size_t recordCount;
+
+	{
+		// Everything waiting to be written is in the snapshot
+		std::lock_guard<std::mutex> lock(m_Mutex);
+
+		for (const Demo &demo : m_Demos)
+			AppendAddRecord(log, demo);
+
+		recordCount = m_Demos.size();
+		m_PendingLog.clear();
+		m_uLogRecordCount = recordCount;
+	}
+
+	if (m_pFile)
+	{
+		fclose(m_pFile);
+		m_pFile = nullptr;
+	}
+
+	// Written next to the catalog and renamed, so a crash leaves one of them whole
+	std::string tempPath = m_FilePath + ".tmp";
+	FILE *file = fopen(tempPath.c_str(), "wb");
+	bool isWritten = file && fwrite(log.data(), 1, log.size(), file) == log.size();
+
+	if (file && fclose(file) != 0)
+		isWritten = false;
+
+	std::error_code ec;
+
+	if (isWritten)
+		fs::rename(fs::u8path(tempPath), fs::u8path(m_FilePath), ec);
+
+	if (!isWritten || ec)
+	{
+		// Records are kept in memory and written on the next compaction
+		fs::remove(fs::u8path(tempPath), ec);
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_PurgeResult.errors.push_back("Failed to write demo catalog " + m_FilePath);
+		m_bHasPurgeResult = true;
+		m_bRetryCompact = true;
+		return;
+	}
+
+	// Demos of the old list are in the catalog now
+	if (!m_OldListPath.empty())
+	{
+		fs::remove(fs::u8path(m_OldListPath), ec);
+		m_OldListPath.clear();
+	}
+}
+
+void CDemoCatalog::WriteLog(const std::string &log)
+{
+	if (!m_pFile)
+	{
+		m_pFile = fopen(m_FilePath.c_str(), "ab");
+
+		if (!m_pFile)
+			return;
+
+		// A file that failed to be compacted may not exist
+		fseek(m_pFile, 0, SEEK_END);
+
+		if (ftell(m_pFile) == 0)
+		{
+			std::string header = MakeHeader();
+			fwrite(header.data(), 1, header.size(), m_pFile);
+		}
+	}
+
+	fwrite(log.data(), 1, log.size(), m_pFile);
+	fflush(m_pFile);
+}
+
+#endif
@@ -0,0 +1,192 @@
+//
+// demo_catalog.h
+//
+// Catalog of automatically recorded demos with background purging.
+//
+#ifndef DEMO_CATALOG_H
+#define DEMO_CATALOG_H
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * List of recorded demos with their times, sizes and maps.
+ * It's kept in memory and stored in an append-only binary log that is compacted
+ * when most of it is removed demos. File operations, size checks and purging
+ * run on a worker thread. Public methods must be called from the same thread.
+ */
+class CDemoCatalog
+{
+public:
+	static constexpr uint32_t FILE_MAGIC = 0x4C434442; // "BDCL"
+	static constexpr uint32_t FILE_VERSION = 1;
+	static constexpr size_t MIN_COMPACT_RECORDS = 256; //!< Removed demos in the log before it's compacted
+
+	struct Demo
+	{
+		uint32_t id = 0;
+		int64_t time = 0; //!< Unix time of the recording start
+		uint64_t size = 0; //!< Size in bytes, 0 if it isn't known yet
+		std::string map;
+		std::string path; //!< Relative to the game directory, UTF-8
+	};
+
+	struct PurgePolicy
+	{
+		int64_t now = 0; //!< Unix time
+		int keepDays = 0; //!< Demos older than that are removed
+		uint64_t maxBytes = 0; //!< Oldest demos over that total size are removed, 0 for no limit
+	};
+
+	struct PurgeResult
+	{
+		int removedCount = 0;
+		uint64_t removedBytes = 0;
+		std::vector<std::string> errors;
+	};
+
+	struct Stats
+	{
+		int count = 0;
+		uint64_t totalBytes = 0;
+		int unknownSizeCount = 0;
+		bool isPurging = false;
+	};
+
+	CDemoCatalog() = default;
+	CDemoCatalog(const CDemoCatalog &) = delete;
+	~CDemoCatalog();
+
+	CDemoCatalog &operator=(const CDemoCatalog &) = delete;
+
+	/**
+	 * Loads the catalog and starts the worker. Previous catalog is closed.
+	 * Rows of the old text demo list are moved into the catalog and the list is removed.
+	 * @param	gameDir		Game directory with a trailing path separator, UTF-8.
+	 * @param	fileName	Catalog file name in the game directory.
+	 * @param	oldListName	Old demo list name in the game directory, can be nullptr.
+	 * @returns false if the catalog file is damaged. Demos up to the damage are loaded
+	 *          and the file is rewritten.
+	 */
+	bool Open(const char *gameDir, const char *fileName, const char *oldListName);
+
+	/**
+	 * Writes the rest of the log and stops the worker.
+	 */
+	void Shutdown();
+
+	/**
+	 * Adds a demo that starts recording now. It's never purged until FinishDemo.
+	 * @param	path	Path relative to the game directory, UTF-8.
+	 * @returns id of the demo.
+	 */
+	uint32_t AddDemo(const char *path, const char *map, int64_t time);
+
+	/**
+	 * Marks a demo as recorded. Its size is read in the background, then it's purged.
+	 */
+	void FinishDemo(uint32_t id, const PurgePolicy &policy);
+
+	/**
+	 * Removes old demos in the background.
+	 * Sizes that aren't known are read first.
+	 */
+	void Purge(const PurgePolicy &policy);
+
+	/**
+	 * Takes the result of a finished purge.
+	 * @returns false if no purge finished since the last call.
+	 */
+	bool TakePurgeResult(PurgeResult &result);
+
+	/**
+	 * Returns demos whose map contains the filter, oldest first.
+	 * @param	mapFilter	Substring of the map name, nullptr or empty for all demos.
+	 * @param	maxCount	Only the newest that many demos are returned.
+	 * @param	matchCount	Set to the number of matching demos.
+	 */
+	std::vector<Demo> Find(const char *mapFilter, size_t maxCount, size_t &matchCount) const;
+
+	Stats GetStats() const;
+
+	/**
+	 * Blocks until the worker is idle. Used by tests.
+	 */
+	void Flush();
+
+private:
+	enum RecordType : uint8_t
+	{
+		RECORD_ADD = 1,
+		RECORD_SIZE,
+		RECORD_REMOVE,
+	};
+
+	// Protected by m_Mutex
+	mutable std::mutex m_Mutex;
+	std::condition_variable m_WakeCondVar;
+	std::condition_variable m_IdleCondVar;
+	std::vector<Demo> m_Demos; //!< Sorted by id
+	uint32_t m_uNextId = 1;
+	uint32_t m_uRecordingId = 0; //!< Demo that isn't finished
+	std::string m_PendingLog; //!< Records that aren't written yet
+	std::vector<uint32_t> m_SizeRequests;
+	PurgePolicy m_PurgePolicy;
+	bool m_bPurgeRequested = false;
+	bool m_bNeedsCompact = false;
+	bool m_bRetryCompact = false; //!< Last compaction failed, it's tried again with the next work
+	bool m_bIsBusy = false;
+	bool m_bIsPurging = false;
+	bool m_bShutdown = false;
+	bool m_bHasPurgeResult = false;
+	PurgeResult m_PurgeResult;
+	size_t m_uLogRecordCount = 0; //!< Records in the file
+
+	// Owned by the worker after Open
+	std::string m_GameDir;
+	std::string m_FilePath;
+	std::string m_OldListPath; //!< Removed after the first compaction
+	FILE *m_pFile = nullptr;
+	std::thread m_WorkerThread;
+
+	static void AppendAddRecord(std::string &log, const Demo &demo);
+	static void AppendSizeRecord(std::string &log, uint32_t id, uint64_t size);
+	static void AppendRemoveRecord(std::string &log, uint32_t id);
+
+	/**
+	 * Parses the log. Sets m_Demos and m_uNextId.
+	 * @returns false if the log is damaged.
+	 */
+	bool ParseLog(const std::string &data);
+
+	/**
+	 * Adds rows of the old text list. Called before the worker is started.
+	 */
+	bool ImportOldList(const std::string &path);
+
+	Demo *FindDemo(uint32_t id);
+	bool HasWork() const;
+
+	/**
+	 * Reads the size of a file.
+	 * @returns false if the file doesn't exist.
+	 */
+	bool GetFileSize(const std::string &path, uint64_t &size);
+
+	void WorkerThreadFunc() noexcept;
+	void ReadSizes(std::vector<uint32_t> &ids);
+	void RunPurge(const PurgePolicy &policy);
+
+	/**
+	 * Writes a new log of the current demos and replaces the file.
+	 */
+	void Compact();
+
+	void WriteLog(const std::string &log);
+};
+
+#endif
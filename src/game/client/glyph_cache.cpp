@@ -0,0 +1,196 @@
+#include <cstring>
+#include <cwchar>
+#include "glyph_cache.h"
+
+CGlyphCache &CGlyphCache::Get()
+{
+	static CGlyphCache instance;
+	return instance;
+}
+
+void CGlyphCache::SetSource(IGlyphMetricsSource *pSource)
+{
+	m_pSource = pSource;
+	Invalidate();
+}
+
+void CGlyphCache::Invalidate()
+{
+	m_Fonts.clear();
+	m_pLastFont = nullptr;
+}
+
+int CGlyphCache::GetCharAdvance(unsigned long font, wchar_t ch)
+{
+	if (!m_pSource)
+		return 0;
+
+	FontWidths &widths = GetFontWidths(font);
+
+	if ((unsigned)ch < DIRECT_TABLE_SIZE)
+	{
+		int &width = widths.direct[(unsigned)ch];
+
+		if (width == -1)
+		{
+			width = m_pSource->GetCharAdvance(font, ch);
+			m_iMisses++;
+		}
+		else
+		{
+			m_iHits++;
+		}
+
+		return width;
+	}
+
+	auto it = widths.other.find(ch);
+
+	if (it != widths.other.end())
+	{
+		m_iHits++;
+		return it->second;
+	}
+
+	int width = m_pSource->GetCharAdvance(font, ch);
+	widths.other.emplace(ch, width);
+	m_iMisses++;
+	return width;
+}
+
+int CGlyphCache::MeasureText(unsigned long font, const wchar_t *text, int len)
+{
+	if (len < 0)
+		len = (int)wcslen(text);
+
+	int width = 0;
+
+	for (int i = 0; i < len; i++)
+		width += GetCharAdvance(font, text[i]);
+
+	return width;
+}
+
+int CGlyphCache::MeasureTextUTF8(unsigned long font, const char *text, int len)
+{
+	if (len < 0)
+		len = (int)strlen(text);
+
+	int width = 0;
+
+	for (int pos = 0; pos < len;)
+		width += GetCharAdvance(font, DecodeUTF8(text, len, pos));
+
+	return width;
+}
+
+int CGlyphCache::FindBreakUTF8(unsigned long font, const char *text, int len, int width)
+{
+	int currentWidth = 0;
+	int lastBreak = -1;
+	int prevChar = 0;
+
+	for (int pos = 0; pos < len;)
+	{
+		int charPos = pos;
+		wchar_t ch = DecodeUTF8(text, len, pos);
+
+		if ((unsigned)ch <= 32)
+			lastBreak = charPos;
+
+		currentWidth += GetCharAdvance(font, ch);
+
+		if (currentWidth >= width)
+		{
+			// No whitespace to break on, break before the previous character
+			return lastBreak != -1 ? lastBreak : prevChar;
+		}
+
+		prevChar = charPos;
+	}
+
+	return len;
+}
+
+wchar_t CGlyphCache::DecodeUTF8(const char *text, int len, int &pos)
+{
+	const unsigned char *p = (const unsigned char *)text + pos;
+	unsigned c = p[0];
+	int count;
+	unsigned cp;
+
+	if (c < 0x80)
+	{
+		pos++;
+		return (wchar_t)c;
+	}
+	else if ((c & 0xE0) == 0xC0)
+	{
+		count = 1;
+		cp = c & 0x1F;
+	}
+	else if ((c & 0xF0) == 0xE0)
+	{
+		count = 2;
+		cp = c & 0x0F;
+	}
+	else if ((c & 0xF8) == 0xF0)
+	{
+		count = 3;
+		cp = c & 0x07;
+	}
+	else
+	{
+		pos++;
+		return (wchar_t)c;
+	}
+
+	// Sequence is cut at the end of the string
+	if (pos + count >= len)
+	{
+		pos++;
+		return (wchar_t)c;
+	}
+
+	for (int i = 1; i <= count; i++)
+	{
+		if ((p[i] & 0xC0) != 0x80)
+		{
+			pos++;
+			return (wchar_t)c;
+		}
+
+		cp = (cp << 6) | (p[i] & 0x3F);
+	}
+
+	// Characters that don't fit into a 16-bit wchar_t are replaced
+	if (sizeof(wchar_t) == 2 && cp > 0xFFFF)
+		cp = 0xFFFD;
+
+	pos += count + 1;
+	return (wchar_t)cp;
+}
+
+CGlyphCache::FontWidths &CGlyphCache::GetFontWidths(unsigned long font)
+{
+	// Text is usually measured with the same font many times in a row
+	if (m_pLastFont && m_pLastFont->font == font)
+		return *m_pLastFont;
+
+	for (std::unique_ptr<FontWidths> &widths : m_Fonts)
+	{
+		if (widths->font == font)
+		{
+			m_pLastFont = widths.get();
+			return *m_pLastFont;
+		}
+	}
+
+	std::unique_ptr<FontWidths> widths = std::make_unique<FontWidths>();
+	widths->font = font;
+	memset(widths->direct, -1, sizeof(widths->direct));
+
+	m_pLastFont = widths.get();
+	m_Fonts.push_back(std::move(widths));
+	return *m_pLastFont;
+}
@@ -0,0 +1,103 @@
+//
+// glyph_cache.h
+//
+// Cached character advances of VGUI fonts for text measurement and line breaking.
+//
+#ifndef GLYPH_CACHE_H
+#define GLYPH_CACHE_H
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * Source of character widths. Implemented with vgui2::ISurface in the client.
+ */
+class IGlyphMetricsSource
+{
+public:
+	virtual ~IGlyphMetricsSource() = default;
+
+	/**
+	 * Returns the advance of a character (a + b + c of GetCharABCwide).
+	 * @param	font	vgui2::HFont
+	 */
+	virtual int GetCharAdvance(unsigned long font, wchar_t ch) = 0;
+};
+
+/**
+ * Character widths of every font are stored after the first query:
+ * Latin-1 in a direct table, other characters in a hash map.
+ * Widths must be dropped with Invalidate when fonts are reloaded.
+ */
+class CGlyphCache
+{
+public:
+	static constexpr int DIRECT_TABLE_SIZE = 256;
+
+	static CGlyphCache &Get();
+
+	/**
+	 * Sets the source of widths and drops all cached widths.
+	 */
+	void SetSource(IGlyphMetricsSource *pSource);
+
+	/**
+	 * Drops all cached widths. Called when the scheme or the screen size changes.
+	 */
+	void Invalidate();
+
+	/**
+	 * Returns the advance of a character.
+	 */
+	int GetCharAdvance(unsigned long font, wchar_t ch);
+
+	/**
+	 * Returns the width of a wide string.
+	 * @param	len		Number of characters or -1 for a null-terminated string
+	 */
+	int MeasureText(unsigned long font, const wchar_t *text, int len = -1);
+
+	/**
+	 * Returns the width of a UTF-8 string.
+	 * @param	len		Number of bytes or -1 for a null-terminated string
+	 */
+	int MeasureTextUTF8(unsigned long font, const char *text, int len = -1);
+
+	/**
+	 * Finds where a UTF-8 string needs to be split so the first part fits into the width.
+	 * The string is split on the last whitespace before the width is reached or,
+	 * if there is none, before the last character that fits.
+	 * @param	len		Number of bytes
+	 * @returns byte offset of the split, len if the whole string fits.
+	 */
+	int FindBreakUTF8(unsigned long font, const char *text, int len, int width);
+
+	/**
+	 * Decodes a character of a UTF-8 string. Invalid bytes are decoded as Latin-1.
+	 * @param	pos		Byte offset, moved to the next character
+	 */
+	static wchar_t DecodeUTF8(const char *text, int len, int &pos);
+
+	inline int GetHitCount() const { return m_iHits; }
+	inline int GetMissCount() const { return m_iMisses; }
+
+private:
+	struct FontWidths
+	{
+		unsigned long font = 0;
+
+		// -1 if not queried yet
+		int direct[DIRECT_TABLE_SIZE];
+		std::unordered_map<wchar_t, int> other;
+	};
+
+	IGlyphMetricsSource *m_pSource = nullptr;
+	std::vector<std::unique_ptr<FontWidths>> m_Fonts;
+	FontWidths *m_pLastFont = nullptr;
+	int m_iHits = 0;
+	int m_iMisses = 0;
+
+	FontWidths &GetFontWidths(unsigned long font);
+};
+
+#endif
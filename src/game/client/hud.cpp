@@ -18,6 +18,7 @@
 // implementation of CHud class
 //
 
+#include <algorithm>
 #include <cstring>
 #include <cstdio>
 #include <vgui/IScheme.h>
@@ -45,6 +46,7 @@
 #include "cl_voice_status.h"
 #include "bhlcfg.h"
 #include "results.h"
+#include "server_pinger.h"
 #include "svc_messages.h"
 
 #if USE_UPDATER
@@ -219,7 +221,7 @@ void CHud::Init(void)
 	memcpy(m_ColorCodeColors, s_DefaultColorCodeColors, sizeof(s_DefaultColorCodeColors));
 
 	// Set player info IDs
-	for (int i = 1; i < MAX_PLAYERS; i++)
+	for (int i = 1; i <= MAX_PLAYERS; i++)
 		CPlayerInfo::m_sPlayerInfo[i].m_iIndex = i;
 
 	// Check for AG
@@ -401,34 +403,28 @@ void CHud::VidInit(void)
 		if (m_pSpriteList)
 		{
 			// count the number of sprites of the appropriate res
-			m_iSpriteCount = 0;
+			int iSpriteCount = 0;
 			client_sprite_t *p = m_pSpriteList;
 			int j;
 			for (j = 0; j < m_iSpriteCountAllRes; j++)
 			{
 				if (p->iRes == m_iRes)
-					m_iSpriteCount++;
+					iSpriteCount++;
 				p++;
 			}
 
 			// allocated memory for sprite handle arrays
-			m_rghSprites.resize(m_iSpriteCount);
-			m_rgrcRects.resize(m_iSpriteCount);
-			m_rgszSpriteNames.resize(m_iSpriteCount);
+			m_Sprites.Clear();
+			m_Sprites.Reserve(iSpriteCount);
 
 			p = m_pSpriteList;
-			int index = 0;
 			for (j = 0; j < m_iSpriteCountAllRes; j++)
 			{
 				if (p->iRes == m_iRes)
 				{
 					char sz[256];
 					sprintf(sz, "sprites/%s.spr", p->szSprite);
-					m_rghSprites[index] = SPR_Load(sz);
-					m_rgrcRects[index] = p->rc;
-					Q_strncpy(m_rgszSpriteNames[index].name, p->szName, MAX_SPRITE_NAME_LENGTH);
-
-					index++;
+					m_Sprites.Add(p->szName, SPR_Load(sz), p->rc);
 				}
 
 				p++;
@@ -460,7 +456,7 @@ void CHud::VidInit(void)
 			{
 				char sz[256];
 				sprintf(sz, "sprites/%s.spr", p->szSprite);
-				m_rghSprites[index] = SPR_Load(sz);
+				m_Sprites.SetSprite(index, SPR_Load(sz));
 				index++;
 			}
 
@@ -471,7 +467,7 @@ void CHud::VidInit(void)
 	// assumption: number_1, number_2, etc, are all listed and loaded sequentially
 	m_HUD_number_0 = GetSpriteIndex("number_0");
 
-	m_iFontHeight = m_rgrcRects[m_HUD_number_0].bottom - m_rgrcRects[m_HUD_number_0].top;
+	m_iFontHeight = GetSpriteRect(m_HUD_number_0).bottom - GetSpriteRect(m_HUD_number_0).top;
 
 	for (CHudElem *i : m_HudList)
 		i->VidInit();
@@ -480,6 +476,7 @@ void CHud::VidInit(void)
 void CHud::Frame(double time)
 {
 	m_iFrameCount++;
+	CPlayerInfo::UpdateAll();
 
 	vgui2::GetAnimationController()->UpdateAnimations(gEngfuncs.GetClientTime());
 	colorpicker::gTexMgr.RunFrame();
@@ -488,6 +485,7 @@ void CHud::Frame(double time)
 
 	CHudVoiceStatus::Get()->RunFrame(time);
 	CResults::Get().Frame();
+	CServerPinger::Get().Update();
 
 #if USE_UPDATER
 	CHttpClient::Get().RunFrame();
@@ -516,6 +514,8 @@ void CHud::Shutdown()
 	CUpdateInstaller::Get().Shutdown();
 	CHttpClient::Get().Shutdown();
 #endif
+	CResults::Get().Shutdown();
+	CServerPinger::Get().Shutdown();
 	bhlcfg::Shutdown();
 	ClientVoiceMgr_Shutdown();
 	colorpicker::gTexMgr.Shutdown();
@@ -557,45 +557,23 @@ bool CHud::IsAG()
 
 // GetSpriteIndex()
 // searches through the sprite list loaded from hud.txt for a name matching SpriteName
-// returns an index into the gHUD.m_rghSprites[] array
-// returns 0 if sprite not found
+// returns an index for GetSprite() and GetSpriteRect()
+// returns -1 if sprite not found
 int CHud::GetSpriteIndex(const char *SpriteName)
 {
-	// look through the loaded sprite name list for SpriteName
-	for (int i = 0; i < m_iSpriteCount; i++)
-	{
-		if (Q_stricmp(SpriteName, m_rgszSpriteNames[i].name) == 0)
-			return i;
-	}
-
-	return -1; // invalid sprite
+	return m_Sprites.Find(SpriteName);
 }
 
 void CHud::AddSprite(const client_sprite_t &p)
 {
 	// Search for existing sprite
-	int i = 0;
-	for (i = 0; i < m_iSpriteCount; i++)
-	{
-		if (!Q_stricmp(m_rgszSpriteNames[i].name, p.szName))
-			return;
-	}
+	if (m_Sprites.Find(p.szName) != -1)
+		return;
 
 	char sz[256];
 	snprintf(sz, sizeof(sz), "sprites/%s.spr", p.szSprite);
 
-	m_rghSprites.push_back(SPR_Load(sz));
-	m_rgrcRects.push_back(p.rc);
-
-	// Copy sprite name
-	m_rgszSpriteNames.push_back({});
-	Q_strncpy(m_rgszSpriteNames[m_iSpriteCount].name, p.szName, MAX_SPRITE_NAME_LENGTH);
-
-	m_iSpriteCount++;
-
-	Assert(m_rghSprites.size() == m_iSpriteCount);
-	Assert(m_rgrcRects.size() == m_iSpriteCount);
-	Assert(m_rgszSpriteNames.size() == m_iSpriteCount);
+	m_Sprites.Add(p.szName, SPR_Load(sz), p.rc);
 }
 
 float g_lastFOV = 0.0;
@@ -733,10 +711,11 @@ void CHud::GetClientColorAsFloat(int idx, float out[3], Color noTeamColor)
 
 void CHud::UpdateHudColors()
 {
-	ParseColor(hud_color.GetString(), m_HudColor);
-	ParseColor(hud_color1.GetString(), m_HudColor1);
-	ParseColor(hud_color2.GetString(), m_HudColor2);
-	ParseColor(hud_color3.GetString(), m_HudColor3);
+	// Colors are only parsed when the cvars change
+	hud_color.GetColor(m_HudColor);
+	hud_color1.GetColor(m_HudColor1);
+	hud_color2.GetColor(m_HudColor2);
+	hud_color3.GetColor(m_HudColor3);
 }
 
 void CHud::UpdateSupportsCvar()
@@ -839,4 +818,102 @@ CON_COMMAND(joinlast, "Joins latest server.")
 	sprintf(cmd, "connect %s", address);
 
 	EngineClientCmd(cmd);
-}
\ No newline at end of file
+}
+
+/**
+ * Adds servers from a file in the game directory, one address per line.
+ */
+static void AddServersFromFile(const char *filename)
+{
+	char path[MAX_PATH];
+	if (!g_pFullFileSystem->GetLocalPath(filename, path, sizeof(path)))
+		return;
+
+	FILE *inFile = fopen(path, "r");
+
+	if (!inFile)
+		return;
+
+	char line[128];
+
+	while (fgets(line, sizeof(line), inFile))
+	{
+		// Trim line end and skip comments
+		line[strcspn(line, "\r\n")] = 0;
+
+		if (line[0] && line[0] != '#' && !(line[0] == '/' && line[1] == '/'))
+			CServerPinger::Get().AddServer(line);
+	}
+
+	fclose(inFile);
+}
+
+static void PrintPingResults()
+{
+	CServerPinger &pinger = CServerPinger::Get();
+	std::vector<int> order;
+
+	for (int i = 0; i < pinger.GetServerCount(); i++)
+		order.push_back(i);
+
+	// Answered servers first, fastest on top
+	std::sort(order.begin(), order.end(), [&](int lhs, int rhs) {
+		const CServerPinger::Server &a = pinger.GetServer(lhs);
+		const CServerPinger::Server &b = pinger.GetServer(rhs);
+		if (a.hasInfo != b.hasInfo)
+			return a.hasInfo;
+		return a.ping < b.ping;
+	});
+
+	int answered = 0;
+
+	for (int i : order)
+	{
+		const CServerPinger::Server &server = pinger.GetServer(i);
+
+		if (!server.hasInfo)
+		{
+			ConPrintf("%-21s  timed out\n", server.address.c_str());
+			continue;
+		}
+
+		const char *agVersion = server.hasRules ? server.rules.GetValue("sv_ag_version") : nullptr;
+		ConPrintf("%-21s %4d ms %2d/%-2d %-16s %-6s %s%s\n",
+		    server.address.c_str(),
+		    (int)(server.ping * 1000 + 0.5f),
+		    server.info.players, server.info.maxPlayers,
+		    server.info.map.c_str(),
+		    agVersion && agVersion[0] ? agVersion : "-",
+		    server.info.name.c_str(),
+		    server.isLan ? " (LAN)" : "");
+		answered++;
+	}
+
+	ConPrintf("%d of %d servers answered.\n", answered, pinger.GetServerCount());
+}
+
+CON_COMMAND(ping_servers, "Pings servers. Usage: ping_servers [address...]. Without addresses pings servers from pinglist.txt, the last server and LAN.")
+{
+	CServerPinger &pinger = CServerPinger::Get();
+	int argc = gEngfuncs.Cmd_Argc();
+
+	pinger.ClearServers();
+
+	if (argc > 1)
+	{
+		for (int i = 1; i < argc; i++)
+		{
+			if (!pinger.AddServer(gEngfuncs.Cmd_Argv(i)))
+				ConPrintf("Invalid address: %s\n", gEngfuncs.Cmd_Argv(i));
+		}
+	}
+	else
+	{
+		AddServersFromFile("lastip.txt");
+		AddServersFromFile("pinglist.txt");
+	}
+
+	pinger.SetFinishedCallback(PrintPingResults);
+	pinger.Refresh(true, argc <= 1);
+	ConPrintf("Pinging %d servers%s...\n", pinger.GetServerCount(), argc <= 1 ? " and LAN" : "");
+}
@@ -31,6 +31,7 @@
 #include <Color.h>
 #include "global_consts.h"
 #include "hud/base.h"
+#include "hud_sprite_registry.h"
 #include "player_info.h"
 #include "rainbow.h"
 
@@ -158,7 +159,7 @@ public:
 	//-----------------------------------------------------
 	HSPRITE GetSprite(int index);
 	const wrect_t &GetSpriteRect(int index); // Don't keep the reference! It may become invalid.
-	int GetSpriteIndex(const char *SpriteName); // gets a sprite index, for use in the m_rghSprites[] array
+	int GetSpriteIndex(const char *SpriteName); // gets a sprite index, for use in GetSprite() and GetSpriteRect()
 	void AddSprite(const client_sprite_t &p);
 
 	//-----------------------------------------------------
@@ -224,15 +225,9 @@ public:
 	inline int GetFrameCount() { return m_iFrameCount; }
 
 private:
-	struct SpriteName
-	{
-		char name[MAX_SPRITE_NAME_LENGTH];
-	};
-
 	HSPRITE m_hsprLogo;
 	int m_iLogo;
 	client_sprite_t *m_pSpriteList;
-	int m_iSpriteCount = 0;
 	int m_iSpriteCountAllRes;
 	float m_flMouseSensitivity;
 	int m_iConcussionEffect;
@@ -240,11 +235,9 @@ private:
 	std::unordered_map<int, int> m_CharWidths;
 	char m_szEngineVersion[128];
 
-	// the memory for these arrays are allocated in the first call
-	// to CHud::VidInit(), when the hud.txt and associated sprites are loaded.
-	std::vector<HSPRITE> m_rghSprites; /*[HUD_SPRITE_COUNT]*/ // the sprites loaded from hud.txt
-	std::vector<wrect_t> m_rgrcRects; /*[HUD_SPRITE_COUNT]*/
-	std::vector<SpriteName> m_rgszSpriteNames; /*[HUD_SPRITE_COUNT].name*/
+	// the sprites are added in the first call to CHud::VidInit(),
+	// when the hud.txt and associated sprites are loaded.
+	CHudSpriteRegistry m_Sprites;
 
 	std::queue<std::function<void()>> m_NextFrameQueue;
 
@@ -274,13 +267,13 @@ private:
 
 inline HSPRITE CHud::GetSprite(int index)
 {
-	return (index < 0) ? 0 : m_rghSprites[index];
+	return (index < 0) ? 0 : m_Sprites.GetSprite(index);
 }
 
 inline const wrect_t &CHud::GetSpriteRect(int index)
 {
 	static wrect_t empty = wrect_t();
-	return (index < 0) ? empty : m_rgrcRects[index];
+	return (index < 0) ? empty : m_Sprites.GetRect(index);
 }
 
 inline ColorCodeAction CHud::GetColorCodeAction()
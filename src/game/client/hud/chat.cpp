@@ -16,6 +16,7 @@
 #include <KeyValues.h>
 #include "hud.h"
 #include "cl_util.h"
+#include "glyph_cache.h"
 #include "client_vgui.h"
 #include "vgui/client_viewport.h"
 #include "vgui/score_panel.h"
@@ -585,44 +586,7 @@ int CHudChat::ComputeBreakChar(int width, const char *text, int textlen)
 	CHudChatLine *line = m_ChatLine;
 	vgui2::HFont font = line->GetFont();
 
-	int currentlen = 0;
-	int lastbreak = textlen;
-	for (int i = 0; i < textlen; i++)
-	{
-		char ch = text[i];
-
-		if (ch <= 32)
-		{
-			lastbreak = i;
-		}
-
-		wchar_t wch[2];
-
-		g_pVGuiLocalize->ConvertANSIToUnicode(&ch, wch, sizeof(wch));
-
-		int a, b, c;
-
-		vgui2::surface()->GetCharABCwide(font, wch[0], a, b, c);
-		currentlen += a + b + c;
-
-		if (currentlen >= width)
-		{
-			// If we haven't found a whitespace char to break on before getting
-			//  to the end, but it's still too long, break on the character just before
-			//  this one
-			if (lastbreak == textlen)
-			{
-				lastbreak = max(0, i - 1);
-			}
-			break;
-		}
-	}
-
-	if (currentlen >= width)
-	{
-		return lastbreak;
-	}
-	return textlen;
+	return CGlyphCache::Get().FindBreakUTF8(font, text, textlen, width);
 }
 
 //-----------------------------------------------------------------------------
@@ -2,6 +2,7 @@
 #include "ammo.h"
 #include "hud.h"
 #include "cl_util.h"
+#include "hud_renderer.h"
 
 static ConVar cl_cross_enable("cl_cross_enable", "1", FCVAR_BHL_ARCHIVE);
 static ConVar cl_cross_red("cl_cross_red", "0", FCVAR_BHL_ARCHIVE);
@@ -63,6 +64,9 @@ void CHudCrosshair::Draw(float flTime)
 		m_Img.SetPos(0, 0);
 		m_Img.SetSize(ScreenWidth, ScreenHeight);
 		m_Img.SetSettings(settings);
+
+		// vgui2 surface draws immediately, queued HUD sprites must not end up over the crosshair
+		CHudRenderer::Get().Flush();
 		m_Img.Paint();
 	}
 }
@@ -83,8 +83,8 @@ void CHudDeathNotice::Draw(float flTime)
 
 	Color spriteColor = Color(255, 80, 0, 255);
 	Color tkSpriteColor = Color(10, 240, 10, 255); // teamkill - sickly green
-	ParseColor(hud_deathnotice_color.GetString(), spriteColor);
-	ParseColor(hud_deathnotice_color_tk.GetString(), tkSpriteColor);
+	hud_deathnotice_color.GetColor(spriteColor);
+	hud_deathnotice_color_tk.GetColor(tkSpriteColor);
 
 	for (int i = 0; i < MAX_DEATHNOTICES; i++)
 	{
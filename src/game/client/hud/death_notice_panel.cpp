@@ -6,6 +6,7 @@
 #include "hud/death_notice_panel.h"
 #include "vgui/client_viewport.h"
 #include "hud_renderer.h"
+#include "glyph_cache.h"
 
 extern ConVar hud_deathnotice_time;
 ConVar hud_deathnotice_time_self("hud_deathnotice_time_self", "12", FCVAR_BHL_ARCHIVE, "How long should your death notices stay up for");
@@ -312,6 +313,7 @@ int CHudDeathNoticePanel::GetEntryContentWide(const Entry &e)
 
 int CHudDeathNoticePanel::GetColoredTextWide(const wchar_t *str, int len)
 {
+	CGlyphCache &glyphs = CGlyphCache::Get();
 	int x = 0;
 
 	for (int i = 0; i < len; i++)
@@ -323,7 +325,7 @@ int CHudDeathNoticePanel::GetColoredTextWide(const wchar_t *str, int len)
 			continue;
 		}
 
-		x += vgui2::surface()->GetCharacterWidth(m_TextFont, str[i]);
+		x += glyphs.GetCharAdvance(m_TextFont, str[i]);
 	}
 
 	return x;
@@ -331,6 +333,7 @@ int CHudDeathNoticePanel::GetColoredTextWide(const wchar_t *str, int len)
 
 int CHudDeathNoticePanel::DrawColoredText(int x0, int y0, const wchar_t *str, int len, Color c)
 {
+	CGlyphCache &glyphs = CGlyphCache::Get();
 	int x = 0;
 	vgui2::surface()->DrawSetTextColor(c);
 
@@ -350,7 +353,7 @@ int CHudDeathNoticePanel::DrawColoredText(int x0, int y0, const wchar_t *str, in
 
 		vgui2::surface()->DrawSetTextPos(x0 + x, y0);
 		vgui2::surface()->DrawUnicodeChar(str[i]);
-		x += vgui2::surface()->GetCharacterWidth(m_TextFont, str[i]);
+		x += glyphs.GetCharAdvance(m_TextFont, str[i]);
 	}
 
 	return x;
@@ -59,10 +59,10 @@ void CHudScores::Draw(float flTime)
 		m_flScoreBoardLastUpdated = gHUD.m_flTime + 0.5;
 	}
 
-	int xpos, ypos;
-	xpos = 30;
-	ypos = 50;
-	sscanf(hud_scores_pos.GetString(), "%i %i", &xpos, &ypos);
+	Vector pos(30, 50, 0);
+	hud_scores_pos.GetVector(pos);
+	int xpos = (int)pos.x;
+	int ypos = (int)pos.y;
 
 	for (int iLine = 0; iLine < m_iLines && iLine < hud_scores.GetInt(); iLine++)
 	{
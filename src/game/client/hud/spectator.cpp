@@ -34,6 +34,7 @@
 #include "timer.h"
 
 #include "svc_messages.h"
+#include "map_entities.h"
 
 #pragma warning(disable : 4244)
 
@@ -182,127 +183,57 @@ void UTIL_StringToVector(float *pVector, const char *pString)
 
 int UTIL_FindEntityInMap(char *name, float *origin, float *angle)
 {
-	int n, found = 0;
-	char keyname[256];
-	char token[1024];
-
-	cl_entity_t *pEnt = gEngfuncs.GetEntityByIndex(0); // get world model
-
-	if (!pEnt)
-		return 0;
+	const CMapEntityIndex &entities = GetMapEntities();
+	const std::vector<int> &found = entities.FindByClassname(name);
 
-	if (!pEnt->model)
-		return 0;
+	if (found.empty())
+		return 0; // we search all entities, but didn't found the correct
 
-	char *data = pEnt->model->entities;
+	int entity = found[0];
+	const CMapEntityIndex::KeyValue *kv = entities.GetKeyValues(entity);
+	char token[1024];
 
-	while (data)
+	for (int i = 0; i < entities.GetKeyValueCount(entity); i++)
 	{
-		data = gEngfuncs.COM_ParseFile(data, token);
-
-		if ((token[0] == '}') || (token[0] == 0))
-			break;
+		std::string_view keyname = entities.GetKeyName(kv[i].keyId);
+		safe_strcpy(token, kv[i].value.data(), (int)std::min(sizeof(token), kv[i].value.size() + 1));
 
-		if (!data)
+		if (keyname == "angle")
 		{
-			gEngfuncs.Con_DPrintf("UTIL_FindEntityInMap: EOF without closing brace\n");
-			return 0;
-		}
-
-		if (token[0] != '{')
-		{
-			gEngfuncs.Con_DPrintf("UTIL_FindEntityInMap: expected {\n");
-			return 0;
-		}
-
-		// we parse the first { now parse entities properties
-
-		while (1)
-		{
-			// parse key
-			data = gEngfuncs.COM_ParseFile(data, token);
-			if (token[0] == '}')
-				break; // finish parsing this entity
-
-			if (!data)
-			{
-				gEngfuncs.Con_DPrintf("UTIL_FindEntityInMap: EOF without closing brace\n");
-				return 0;
-			};
-
-			strcpy(keyname, token);
-
-			// another hack to fix keynames with trailing spaces
-			n = strlen(keyname);
-			while (n && keyname[n - 1] == ' ')
-			{
-				keyname[n - 1] = 0;
-				n--;
-			}
-
-			// parse value
-			data = gEngfuncs.COM_ParseFile(data, token);
-			if (!data)
-			{
-				gEngfuncs.Con_DPrintf("UTIL_FindEntityInMap: EOF without closing brace\n");
-				return 0;
-			};
+			float y = atof(token);
 
-			if (token[0] == '}')
+			if (y >= 0)
 			{
-				gEngfuncs.Con_DPrintf("UTIL_FindEntityInMap: closing brace without data");
-				return 0;
+				angle[0] = 0.0f;
+				angle[1] = y;
 			}
-
-			if (!strcmp(keyname, "classname"))
-			{
-				if (!strcmp(token, name))
-				{
-					found = 1; // thats our entity
-				}
-			};
-
-			if (!strcmp(keyname, "angle"))
+			else if ((int)y == -1)
 			{
-				float y = atof(token);
-
-				if (y >= 0)
-				{
-					angle[0] = 0.0f;
-					angle[1] = y;
-				}
-				else if ((int)y == -1)
-				{
-					angle[0] = -90.0f;
-					angle[1] = 0.0f;
-					;
-				}
-				else
-				{
-					angle[0] = 90.0f;
-					angle[1] = 0.0f;
-				}
-
-				angle[2] = 0.0f;
+				angle[0] = -90.0f;
+				angle[1] = 0.0f;
+				;
 			}
-
-			if (!strcmp(keyname, "angles"))
+			else
 			{
-				UTIL_StringToVector(angle, token);
+				angle[0] = 90.0f;
+				angle[1] = 0.0f;
 			}
 
-			if (!strcmp(keyname, "origin"))
-			{
-				UTIL_StringToVector(origin, token);
-			};
+			angle[2] = 0.0f;
+		}
 
-		} // while (1)
+		if (keyname == "angles")
+		{
+			UTIL_StringToVector(angle, token);
+		}
 
-		if (found)
-			return 1;
+		if (keyname == "origin")
+		{
+			UTIL_StringToVector(origin, token);
+		};
 	}
 
-	return 0; // we search all entities, but didn't found the correct
+	return 1;
 }
 
 //-----------------------------------------------------------------------------
@@ -36,16 +36,6 @@ CON_COMMAND(customtimer, "Sets a timer to count down from N secs to zero")
 	CHudTimer::Get()->CustomTimerCommand();
 }
 
-enum RulesRequestStatus
-{
-	SOCKET_NONE = 0,
-	SOCKET_IDLE = 1,
-	SOCKET_AWAITING_CODE = 2,
-	SOCKET_AWAITING_ANSWER = 3,
-};
-RulesRequestStatus g_eRulesRequestStatus = SOCKET_NONE;
-NetSocket g_timerSocket = 0; // We will declare socket here to not include winsocks in hud.h
-
 DEFINE_HUD_ELEM(CHudTimer);
 
 void CHudTimer::Init()
@@ -84,13 +74,7 @@ void CHudTimer::VidInit()
 	m_bNeedWriteCustomTimer = true;
 	m_bNeedWriteNextmap = true;
 
-	m_iReceivedSize = 0;
-	if (g_timerSocket != NULL)
-	{
-		NetCloseSocket(g_timerSocket);
-		g_timerSocket = NULL;
-		g_eRulesRequestStatus = SOCKET_NONE;
-	}
+	m_bAwaitingRules = false;
 };
 
 int CHudTimer::MsgFunc_Timer(const char *pszName, int iSize, void *pbuf)
@@ -135,7 +119,7 @@ void CHudTimer::SyncTimer(float fTime)
 		if (status.remote_address.type == NA_IP)
 		{
 			SyncTimerRemote(*(unsigned int *)status.remote_address.ip, status.remote_address.port, fTime, status.latency);
-			if (g_eRulesRequestStatus == SOCKET_AWAITING_CODE || g_eRulesRequestStatus == SOCKET_AWAITING_ANSWER)
+			if (m_bAwaitingRules)
 				return;
 		}
 		else if (status.remote_address.type == NA_LOOPBACK)
@@ -159,12 +143,8 @@ void CHudTimer::SyncTimer(float fTime)
 	else
 	{
 		// Close socket if we are not connected anymore
-		if (g_timerSocket != NULL)
-		{
-			NetCloseSocket(g_timerSocket);
-			g_timerSocket = NULL;
-			g_eRulesRequestStatus = SOCKET_NONE;
-		}
+		m_RulesQuery.Shutdown();
+		m_bAwaitingRules = false;
 
 		m_flNextSyncTime = fTime + 1;
 	}
@@ -234,100 +214,38 @@ void CHudTimer::SyncTimerRemote(unsigned int ip, unsigned short port, float fTim
 {
 	float prevEndtime = m_flEndTime;
 	int prevAgVersion = m_eAgVersion;
-	char buffer[2048];
-	int len = 0;
-
-	// Check for query timeout and just do a resend
-	if (fTime - m_flNextSyncTime > 3 && (g_eRulesRequestStatus == SOCKET_AWAITING_CODE || g_eRulesRequestStatus == SOCKET_AWAITING_ANSWER))
-		g_eRulesRequestStatus = SOCKET_IDLE;
+	CNetQuery::Result result;
+	bool received = false;
 
-	// Retrieve settings from the server
-	switch (g_eRulesRequestStatus)
+	// Take the response of this server, results of previous servers are dropped
+	for (CNetQuery::Result next; m_RulesQuery.GetResult(next);)
 	{
-	case SOCKET_NONE:
-	case SOCKET_IDLE:
-		m_iResponceID = 0;
-		m_iReceivedSize = 0;
-		m_iReceivedPackets = 0;
-		m_iReceivedPacketsCount = 0;
-		NetClearSocket(g_timerSocket);
-		NetSendUdp(ip, port, "\xFF\xFF\xFF\xFFV\xFF\xFF\xFF\xFF", 9, &g_timerSocket);
-		g_eRulesRequestStatus = SOCKET_AWAITING_CODE;
-		m_flNextSyncTime = fTime; // set time for timeout checking
-		return;
-	case SOCKET_AWAITING_CODE:
-		len = NetReceiveUdp(ip, port, buffer, sizeof(buffer), g_timerSocket);
-		if (len < 5)
-			return;
-		if (*(int *)buffer == -1 /*0xFFFFFFFF*/ && buffer[4] == 'A' && len == 9)
+		if (next.addr == ip && next.port == port && !next.isTimedOut)
 		{
-			// Answer is challenge response, send request again with the code
-			buffer[4] = 'V';
-			NetSendUdp(ip, port, buffer, 9, &g_timerSocket);
-			g_eRulesRequestStatus = SOCKET_AWAITING_ANSWER;
-			m_flNextSyncTime = fTime; // set time for timeout checking
-			return;
+			result = std::move(next);
+			received = true;
 		}
-		// Answer should be rules response
-		g_eRulesRequestStatus = SOCKET_AWAITING_ANSWER;
-		break;
-	case SOCKET_AWAITING_ANSWER:
-		len = NetReceiveUdp(ip, port, buffer, sizeof(buffer), g_timerSocket);
-		if (len < 5)
-			return;
-		break;
 	}
 
-	// Check for split packet
-	if (*(int *)buffer == -2 /*0xFEFFFFFF*/)
+	if (!received)
 	{
-		if (len < 9)
-			return;
-		int currentPacket = *((unsigned char *)buffer + 8) >> 4;
-		int totalPackets = *((unsigned char *)buffer + 8) & 0x0F;
-		if (currentPacket >= totalPackets)
-			return; // broken split packet
-		if (m_iReceivedPackets == 0)
-			m_iResponceID = *(int *)(buffer + 4);
-		else if (*(int *)(buffer + 4) != m_iResponceID)
-			return; // packet is from different responce
-		if (m_iReceivedPackets & (1 << currentPacket))
-			return; // already has this packet
-		if (currentPacket < totalPackets - 1 && len != 1400)
-			return; // strange split packet
-		// Copy into merge buffer
-		int pos = (1400 - 9) * currentPacket;
-		memcpy(m_szPacketBuffer + pos, buffer + 9, len - 9);
-		m_iReceivedSize += len - 9;
-		m_iReceivedPackets |= (1 << currentPacket);
-		m_iReceivedPacketsCount++;
-		// Check for completion
-		if (m_iReceivedPacketsCount < totalPackets)
+		// Check for query timeout and just do a resend
+		if (m_bAwaitingRules && fTime - m_flNextSyncTime <= 3)
 			return;
-	}
-	else if (*(int *)buffer == -1 /*0xFFFFFFFF*/)
-	{
-		memcpy(m_szPacketBuffer, buffer, len);
-		m_iReceivedSize += len;
-	}
-	else
-	{
-		return;
-	}
 
-	// Check that this is actually rules responce
-	if (*(int *)m_szPacketBuffer != -1 /*0xFFFFFFFF*/ || m_szPacketBuffer[4] != 'E')
-	{
+		// Retrieve settings from the server, the answer is received in the background
+		m_bAwaitingRules = m_RulesQuery.QueryRules(ip, port);
+		m_flNextSyncTime = m_bAwaitingRules ? fTime : fTime + 1; // set time for timeout checking
 		return;
 	}
 
 	m_flSynced = true;
-	g_eRulesRequestStatus = SOCKET_IDLE;
+	m_bAwaitingRules = false;
 	m_flNextSyncTime = fTime + 10; // Don't sync offten, we get update notifications via svc_print
 
 	// Parse rules
 	// Get map end time
-	char *value = NetGetRuleValueFromBuffer(m_szPacketBuffer, m_iReceivedSize, "mp_timelimit");
+	const char *value = result.rules.GetValue("mp_timelimit");
 	if (value && value[0])
 	{
 		m_flEndTime = atof(value) * 60;
@@ -336,7 +254,7 @@ void CHudTimer::SyncTimerRemote(unsigned int ip, unsigned short port, float fTim
 	{
 		m_flEndTime = 0;
 	}
-	value = NetGetRuleValueFromBuffer(m_szPacketBuffer, m_iReceivedSize, "mp_timeleft");
+	value = result.rules.GetValue("mp_timeleft");
 	if (value && value[0] && !gHUD.m_iIntermission && !m_bDelayTimeleftReading)
 	{
 		float timeleft = atof(value);
@@ -353,7 +271,7 @@ void CHudTimer::SyncTimerRemote(unsigned int ip, unsigned short port, float fTim
 	// Get AG version
 	if (m_eAgVersion == SV_AG_UNKNOWN)
 	{
-		value = NetGetRuleValueFromBuffer(m_szPacketBuffer, m_iReceivedSize, "sv_ag_version");
+		value = result.rules.GetValue("sv_ag_version");
 		if (value && value[0])
 		{
 			if (!strcmp(value, "6.6") || !strcmp(value, "6.3"))
@@ -375,7 +293,7 @@ void CHudTimer::SyncTimerRemote(unsigned int ip, unsigned short port, float fTim
 	}
 
 	// Get nextmap
-	value = NetGetRuleValueFromBuffer(m_szPacketBuffer, m_iReceivedSize, "amx_nextmap");
+	value = result.rules.GetValue("amx_nextmap");
 	if (value && value[0])
 	{
 		if (strcmp(m_szNextmap, value))
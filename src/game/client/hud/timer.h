@@ -2,6 +2,7 @@
 #define CHUDTIMER_H
 
 #include "base.h"
+#include "net_query.h"
 
 class CHudTimer : public CHudElemBase<CHudTimer>
 {
@@ -65,11 +66,8 @@ private:
 	cvar_t *m_pCvarSvAgVersion;
 	cvar_t *m_pCvarAmxNextmap;
 
-	char m_szPacketBuffer[22400]; // 16x1400 split packets
-	int m_iResponceID;
-	int m_iReceivedSize;
-	int m_iReceivedPackets;
-	int m_iReceivedPacketsCount;
+	CNetQuery m_RulesQuery;
+	bool m_bAwaitingRules = false;
 };
 
 #endif
@@ -10,6 +10,7 @@
 #include "hud.h"
 #include "cl_util.h"
 #include "client_steam_context.h"
+#include "glyph_cache.h"
 #include "cl_voice_status.h"
 #include "voice_status.h"
 #include "vgui/avatar_image.h"
@@ -238,7 +239,7 @@ void CHudVoiceStatus::Paint()
 		int iTextWidthCounter = 0;
 		for (int j = 0; j < iNameLength; j++)
 		{
-			iTextWidthCounter += vgui2::surface()->GetCharacterWidth(m_NameFont, pszconverted[j]);
+			iTextWidthCounter += CGlyphCache::Get().GetCharAdvance(m_NameFont, pszconverted[j]);
 
 			if (iTextWidthCounter > iTextSpace)
 			{
@@ -20,6 +20,7 @@
 #include <pm_shared.h>
 #include "hud.h"
 #include "cl_util.h"
+#include "hud_renderer.h"
 #include "hud/spectator.h"
 #include "vgui/client_viewport.h"
 #include "results.h"
@@ -163,6 +164,8 @@ int CHud::Redraw(float flTime, int intermission)
 	// if no redrawing is necessary
 	// return 0;
 
+	CHudRenderer::Get().BeginFrame();
+
 	// draw all registered HUD elements
 	if (hud_draw.GetFloat() > 0)
 	{
@@ -212,6 +215,8 @@ int CHud::Redraw(float flTime, int intermission)
 		SPR_DrawAdditive(i, x, y, NULL);
 	}
 
+	CHudRenderer::Get().EndFrame();
+
 	return 1;
 }
 
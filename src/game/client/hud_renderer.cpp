@@ -2,13 +2,20 @@
 #include "cl_util.h"
 #include "hud_renderer.h"
 #include "engine_patches.h"
+#include "opengl.h"
 #include <com_model.h>
 #include <triangleapi.h>
 
 ConVar hud_client_renderer("hud_client_renderer", "1", FCVAR_BHL_ARCHIVE, "Enable client-side HUD rendering (instead of engine renderer)");
+static ConVar hud_client_renderer_batch("hud_client_renderer_batch", "1", FCVAR_BHL_ARCHIVE, "Draw HUD sprites with the same texture in one draw call");
 
 static CHudRenderer s_Instance;
 
+CON_COMMAND(hud_client_renderer_stats, "Prints HUD renderer draw call counters of the last frame")
+{
+	CHudRenderer::Get().PrintStats();
+}
+
 CHudRenderer &CHudRenderer::Get()
 {
 	return s_Instance;
@@ -19,8 +26,16 @@ bool CHudRenderer::IsAvailable()
 	return CEnginePatches::Get().GetRenderer() == CEnginePatches::Renderer::OpenGL;
 }
 
+CHudRenderer::CHudRenderer()
+{
+	m_Batcher.SetBackend(&m_Backend);
+}
+
 void CHudRenderer::HookFuncs()
 {
+	// gEngfuncs were reset to engine functions
+	m_bHooked = false;
+
 	if (!IsAvailable() || !hud_client_renderer.GetBool())
 		return;
 
@@ -31,6 +46,60 @@ void CHudRenderer::HookFuncs()
 	gEngfuncs.pfnSPR_EnableScissor = nullptr;
 	gEngfuncs.pfnSPR_DisableScissor = nullptr;
 	gEngfuncs.pfnSPR_DrawGeneric = nullptr;
+
+	// Queued sprites must be drawn before anything the engine draws on top of them
+	m_pfnFillRGBA = gEngfuncs.pfnFillRGBA;
+	m_pfnFillRGBABlend = gEngfuncs.pfnFillRGBABlend;
+	m_pfnDrawCharacter = gEngfuncs.pfnDrawCharacter;
+	m_pfnDrawConsoleString = gEngfuncs.pfnDrawConsoleString;
+	m_pfnDrawString = gEngfuncs.pfnDrawString;
+	m_pfnDrawStringReverse = gEngfuncs.pfnDrawStringReverse;
+
+	gEngfuncs.pfnFillRGBA = &FillRGBA;
+	gEngfuncs.pfnFillRGBABlend = &FillRGBABlend;
+	gEngfuncs.pfnDrawCharacter = &DrawCharacter;
+	gEngfuncs.pfnDrawConsoleString = &DrawConsoleString;
+	gEngfuncs.pfnDrawString = &DrawString;
+	gEngfuncs.pfnDrawStringReverse = &DrawStringReverse;
+
+	m_bHooked = true;
+}
+
+void CHudRenderer::BeginFrame()
+{
+	// Without the hooks sprites can't be flushed before engine draws something
+	m_bInFrame = m_bHooked && hud_client_renderer_batch.GetBool();
+}
+
+void CHudRenderer::EndFrame()
+{
+	// Sprites queued outside of the frame were drawn immediately
+	m_Batcher.EndFrame();
+	m_bInFrame = false;
+	m_uFrameCount++;
+}
+
+void CHudRenderer::Flush()
+{
+	m_Batcher.Flush();
+}
+
+void CHudRenderer::PrintStats()
+{
+	if (!m_bHooked)
+	{
+		ConPrintf("HUD renderer is disabled.\n");
+		return;
+	}
+
+	const CHudSpriteBatcher::Stats &stats = m_Batcher.GetLastFrameStats();
+	ConPrintf("HUD renderer, frame %u:\n", m_uFrameCount);
+	ConPrintf("  Batching: %s\n", hud_client_renderer_batch.GetBool() ? "enabled" : "disabled");
+	ConPrintf("  Sprites: %u\n", stats.quads);
+	ConPrintf("  Draw calls: %u\n", stats.drawCalls);
+	ConPrintf("  Texture changes: %u\n", stats.textureChanges);
+	ConPrintf("  Render mode changes: %u\n", stats.renderModeChanges);
+	ConPrintf("  Flushes: %u\n", stats.flushes);
 }
 
 void CHudRenderer::SpriteSet(HSPRITE hPic, int r, int g, int b)
@@ -106,28 +175,94 @@ void CHudRenderer::DrawSprite(int frame, float x, float y, float width, float he
 		return;
 	}
 
-	gEngfuncs.pTriAPI->Color4ub(m_SpriteColor[0], m_SpriteColor[1], m_SpriteColor[2], m_SpriteColor[3]);
-	gEngfuncs.pTriAPI->SpriteTexture(spriteModel, frame);
+	HudSpriteState state;
+	state.model = spriteModel;
+	state.frame = frame;
+	state.renderMode = mode == SpriteDrawMode::Additive ? kRenderTransAdd : kRenderNormal;
+
+	m_Batcher.AddQuad(state, x, y, width, height, s, t, m_SpriteColor);
+
+	if (!m_bInFrame)
+		m_Batcher.Flush();
+}
+
+void CHudRenderer::FillRGBA(int x, int y, int width, int height, int r, int g, int b, int a)
+{
+	s_Instance.Flush();
+	s_Instance.m_pfnFillRGBA(x, y, width, height, r, g, b, a);
+}
+
+void CHudRenderer::FillRGBABlend(int x, int y, int width, int height, int r, int g, int b, int a)
+{
+	s_Instance.Flush();
+	s_Instance.m_pfnFillRGBABlend(x, y, width, height, r, g, b, a);
+}
+
+int CHudRenderer::DrawCharacter(int x, int y, int number, int r, int g, int b)
+{
+	s_Instance.Flush();
+	return s_Instance.m_pfnDrawCharacter(x, y, number, r, g, b);
+}
+
+int CHudRenderer::DrawConsoleString(int x, int y, const char *const pszString)
+{
+	s_Instance.Flush();
+	return s_Instance.m_pfnDrawConsoleString(x, y, pszString);
+}
+
+int CHudRenderer::DrawString(int x, int y, const char *const pszString, int r, int g, int b)
+{
+	s_Instance.Flush();
+	return s_Instance.m_pfnDrawString(x, y, pszString, r, g, b);
+}
+
+int CHudRenderer::DrawStringReverse(int x, int y, const char *const pszString, int r, int g, int b)
+{
+	s_Instance.Flush();
+	return s_Instance.m_pfnDrawStringReverse(x, y, pszString, r, g, b);
+}
+
+void CHudRenderer::CGLBackend::SetTexture(const model_s *model, int frame)
+{
+	gEngfuncs.pTriAPI->SpriteTexture(model, frame);
+}
 
-	if (mode == SpriteDrawMode::Normal)
-		gEngfuncs.pTriAPI->RenderMode(kRenderNormal);
-	else if (mode == SpriteDrawMode::Additive)
-		gEngfuncs.pTriAPI->RenderMode(kRenderTransAdd);
+void CHudRenderer::CGLBackend::SetRenderMode(int mode)
+{
+	gEngfuncs.pTriAPI->RenderMode(mode);
+}
 
-	// TriangleAPI functions call OpenGL directly
-	gEngfuncs.pTriAPI->Begin(TRI_QUADS);
-	gEngfuncs.pTriAPI->TexCoord2f(s[0], t[0]);
-	gEngfuncs.pTriAPI->Vertex3f(x, y, 0);
+void CHudRenderer::CGLBackend::DrawQuads(const HudSpriteVertex *verts, int numQuads)
+{
+	if (!CClientOpenGL::Get().IsAvailable())
+	{
+		// TriangleAPI functions call OpenGL directly
+		for (int i = 0; i < numQuads * 4; i += 4)
+		{
+			const HudSpriteVertex *v = verts + i;
+			gEngfuncs.pTriAPI->Color4ub(v->color[0], v->color[1], v->color[2], v->color[3]);
+			gEngfuncs.pTriAPI->Begin(TRI_QUADS);
 
-	gEngfuncs.pTriAPI->TexCoord2f(s[1], t[0]);
-	gEngfuncs.pTriAPI->Vertex3f(x + width, y, 0);
+			for (int j = 0; j < 4; j++)
+			{
+				gEngfuncs.pTriAPI->TexCoord2f(v[j].s, v[j].t);
+				gEngfuncs.pTriAPI->Vertex3f(v[j].x, v[j].y, 0);
+			}
 
-	gEngfuncs.pTriAPI->TexCoord2f(s[1], t[1]);
-	gEngfuncs.pTriAPI->Vertex3f(x + width, y + height, 0);
+			gEngfuncs.pTriAPI->End();
+		}
 
-	gEngfuncs.pTriAPI->TexCoord2f(s[0], t[1]);
-	gEngfuncs.pTriAPI->Vertex3f(x, y + height, 0);
-	gEngfuncs.pTriAPI->End();
+		return;
+	}
 
-	gEngfuncs.pTriAPI->RenderMode(kRenderNormal);
+	// Client arrays may be in use by the studio model renderer
+	glPushClientAttrib(GL_CLIENT_VERTEX_ARRAY_BIT);
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+	glEnableClientState(GL_COLOR_ARRAY);
+	glVertexPointer(2, GL_FLOAT, sizeof(HudSpriteVertex), &verts->x);
+	glTexCoordPointer(2, GL_FLOAT, sizeof(HudSpriteVertex), &verts->s);
+	glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(HudSpriteVertex), verts->color);
+	glDrawArrays(GL_QUADS, 0, numQuads * 4);
+	glPopClientAttrib();
 }
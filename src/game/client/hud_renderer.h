@@ -1,15 +1,38 @@
 #ifndef HUD_RENDERER_H
 #define HUD_RENDERER_H
 #include "hud.h"
+#include "hud_sprite_batch.h"
 
 class CHudRenderer
 {
 public:
 	static CHudRenderer &Get();
 
+	CHudRenderer();
+
 	bool IsAvailable();
 	void HookFuncs();
 
+	/**
+	 * Starts queueing sprites. Called before HUD elements are drawn.
+	 */
+	void BeginFrame();
+
+	/**
+	 * Draws queued sprites and stops queueing. Called after HUD elements are drawn.
+	 */
+	void EndFrame();
+
+	/**
+	 * Draws queued sprites. Must be called before drawing anything without the renderer.
+	 */
+	void Flush();
+
+	/**
+	 * Prints draw call counters of the last frame to the console.
+	 */
+	void PrintStats();
+
 	static void SpriteSet(HSPRITE hPic, int r, int g, int b);
 	static void SpriteDraw(int frame, int x, int y, const wrect_t *prc);
 	static void SpriteDrawAdditive(int frame, int x, int y, const wrect_t *prc);
@@ -21,10 +44,39 @@ private:
 		Additive,
 	};
 
+	class CGLBackend : public IHudSpriteBackend
+	{
+	public:
+		void SetTexture(const model_s *model, int frame) override;
+		void SetRenderMode(int mode) override;
+		void DrawQuads(const HudSpriteVertex *verts, int numQuads) override;
+	};
+
 	HSPRITE m_hPic = 0;
 	uint8_t m_SpriteColor[4];
 
+	CGLBackend m_Backend;
+	CHudSpriteBatcher m_Batcher;
+	bool m_bHooked = false;
+	bool m_bInFrame = false;
+	unsigned m_uFrameCount = 0;
+
+	// Engine functions that draw on top of the sprites
+	decltype(gEngfuncs.pfnFillRGBA) m_pfnFillRGBA = nullptr;
+	decltype(gEngfuncs.pfnFillRGBABlend) m_pfnFillRGBABlend = nullptr;
+	decltype(gEngfuncs.pfnDrawCharacter) m_pfnDrawCharacter = nullptr;
+	decltype(gEngfuncs.pfnDrawConsoleString) m_pfnDrawConsoleString = nullptr;
+	decltype(gEngfuncs.pfnDrawString) m_pfnDrawString = nullptr;
+	decltype(gEngfuncs.pfnDrawStringReverse) m_pfnDrawStringReverse = nullptr;
+
 	void DrawSprite(int frame, float x, float y, float width, float height, const wrect_t *prc, SpriteDrawMode mode);
+
+	static void FillRGBA(int x, int y, int width, int height, int r, int g, int b, int a);
+	static void FillRGBABlend(int x, int y, int width, int height, int r, int g, int b, int a);
+	static int DrawCharacter(int x, int y, int number, int r, int g, int b);
+	static int DrawConsoleString(int x, int y, const char *const pszString);
+	static int DrawString(int x, int y, const char *const pszString, int r, int g, int b);
+	static int DrawStringReverse(int x, int y, const char *const pszString, int r, int g, int b);
 };
 
 #endif
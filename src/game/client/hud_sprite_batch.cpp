@@ -0,0 +1,126 @@
+#include <algorithm>
+#include "hud_sprite_batch.h"
+
+namespace
+{
+
+inline bool RectsOverlap(const float a[4], const float b[4])
+{
+	return a[0] < b[2] && b[0] < a[2] && a[1] < b[3] && b[1] < a[3];
+}
+
+}
+
+void CHudSpriteBatcher::AddQuad(const HudSpriteState &state, float x, float y, float w, float h, const float s[2], const float t[2], const uint8_t color[4])
+{
+	float rect[4] = { std::min(x, x + w), std::min(y, y + h), std::max(x, x + w), std::max(y, y + h) };
+	Batch *pBatch = nullptr;
+
+	// Look for a batch with the same state that can be moved forward to this quad
+	int minIdx = std::max(0, m_iBatchCount - MAX_MERGE_DISTANCE);
+
+	for (int i = m_iBatchCount - 1; i >= minIdx; i--)
+	{
+		Batch &batch = m_Batches[i];
+
+		if (batch.state == state)
+		{
+			pBatch = &batch;
+			break;
+		}
+
+		// Quad would be drawn below this batch
+		if (RectsOverlap(batch.bounds, rect))
+			break;
+	}
+
+	if (pBatch)
+	{
+		pBatch->bounds[0] = std::min(pBatch->bounds[0], rect[0]);
+		pBatch->bounds[1] = std::min(pBatch->bounds[1], rect[1]);
+		pBatch->bounds[2] = std::max(pBatch->bounds[2], rect[2]);
+		pBatch->bounds[3] = std::max(pBatch->bounds[3], rect[3]);
+	}
+	else
+	{
+		if (m_iBatchCount == (int)m_Batches.size())
+			m_Batches.emplace_back();
+
+		pBatch = &m_Batches[m_iBatchCount++];
+		pBatch->state = state;
+		std::copy(rect, rect + 4, pBatch->bounds);
+		pBatch->verts.clear();
+	}
+
+	HudSpriteVertex v;
+	std::copy(color, color + 4, v.color);
+
+	v.x = x;
+	v.y = y;
+	v.s = s[0];
+	v.t = t[0];
+	pBatch->verts.push_back(v);
+
+	v.x = x + w;
+	v.s = s[1];
+	pBatch->verts.push_back(v);
+
+	v.y = y + h;
+	v.t = t[1];
+	pBatch->verts.push_back(v);
+
+	v.x = x;
+	v.s = s[0];
+	pBatch->verts.push_back(v);
+
+	m_Stats.quads++;
+}
+
+void CHudSpriteBatcher::Flush()
+{
+	if (m_iBatchCount == 0)
+		return;
+
+	// State may have been changed by the engine since last flush
+	bool stateValid = false;
+	HudSpriteState curState;
+
+	for (int i = 0; i < m_iBatchCount; i++)
+	{
+		const Batch &batch = m_Batches[i];
+
+		if (!stateValid || batch.state.model != curState.model || batch.state.frame != curState.frame)
+		{
+			m_pBackend->SetTexture(batch.state.model, batch.state.frame);
+			m_Stats.textureChanges++;
+		}
+
+		if (!stateValid || batch.state.renderMode != curState.renderMode)
+		{
+			m_pBackend->SetRenderMode(batch.state.renderMode);
+			m_Stats.renderModeChanges++;
+		}
+
+		curState = batch.state;
+		stateValid = true;
+
+		m_pBackend->DrawQuads(batch.verts.data(), (int)batch.verts.size() / 4);
+		m_Stats.drawCalls++;
+	}
+
+	if (curState.renderMode != 0)
+	{
+		m_pBackend->SetRenderMode(0);
+		m_Stats.renderModeChanges++;
+	}
+
+	m_iBatchCount = 0;
+	m_Stats.flushes++;
+}
+
+void CHudSpriteBatcher::EndFrame()
+{
+	Flush();
+	m_LastFrameStats = m_Stats;
+	m_Stats = Stats();
+}
@@ -0,0 +1,143 @@
+//
+// hud_sprite_batch.h
+//
+// Batching of HUD sprite quads by texture and render mode.
+//
+#ifndef HUD_SPRITE_BATCH_H
+#define HUD_SPRITE_BATCH_H
+#include <cstdint>
+#include <vector>
+
+struct model_s;
+
+struct HudSpriteVertex
+{
+	float x, y;
+	float s, t;
+	uint8_t color[4];
+};
+
+/**
+ * Render state of a sprite quad. Quads with equal state can be drawn with one draw call.
+ */
+struct HudSpriteState
+{
+	const model_s *model = nullptr;
+	int frame = 0;
+	int renderMode = 0;
+
+	inline bool operator==(const HudSpriteState &other) const
+	{
+		return model == other.model && frame == other.frame && renderMode == other.renderMode;
+	}
+
+	inline bool operator!=(const HudSpriteState &other) const { return !(*this == other); }
+};
+
+/**
+ * Draws batched quads. Implemented with OpenGL by CHudRenderer and by a recording mock in tests.
+ */
+class IHudSpriteBackend
+{
+public:
+	virtual ~IHudSpriteBackend() = default;
+
+	/**
+	 * Binds a sprite frame as current texture.
+	 */
+	virtual void SetTexture(const model_s *model, int frame) = 0;
+
+	/**
+	 * Sets render mode (kRender*).
+	 */
+	virtual void SetRenderMode(int mode) = 0;
+
+	/**
+	 * Draws quads with current texture and render mode.
+	 * @param	verts		4 vertices for each quad.
+	 * @param	numQuads	Number of quads.
+	 */
+	virtual void DrawQuads(const HudSpriteVertex *verts, int numQuads) = 0;
+};
+
+/**
+ * Collects sprite quads and submits them in as few draw calls as possible.
+ * A quad is merged into an earlier batch with the same state only if it doesn't
+ * overlap any batch queued after it, so the result looks the same as drawing
+ * quads one by one.
+ */
+class CHudSpriteBatcher
+{
+public:
+	struct Stats
+	{
+		unsigned quads = 0;
+		unsigned drawCalls = 0;
+		unsigned textureChanges = 0;
+		unsigned renderModeChanges = 0;
+		unsigned flushes = 0;
+	};
+
+	// Max number of batches checked when looking for a batch to merge into
+	static constexpr int MAX_MERGE_DISTANCE = 32;
+
+	/**
+	 * Sets the backend. Must be set before Flush.
+	 */
+	inline void SetBackend(IHudSpriteBackend *pBackend) { m_pBackend = pBackend; }
+
+	/**
+	 * Queues a quad.
+	 * @param	state	Texture and render mode.
+	 * @param	x, y	Top-left corner.
+	 * @param	w, h	Size.
+	 * @param	s, t	Texture coordinates: {left, right} and {top, bottom}.
+	 * @param	color	RGBA color.
+	 */
+	void AddQuad(const HudSpriteState &state, float x, float y, float w, float h, const float s[2], const float t[2], const uint8_t color[4]);
+
+	/**
+	 * Draws all queued quads. Must be called before anything else is drawn
+	 * on top of them. Render mode is reset to 0 (kRenderNormal) if it was changed.
+	 */
+	void Flush();
+
+	/**
+	 * Returns whether there are queued quads.
+	 */
+	inline bool IsEmpty() const { return m_iBatchCount == 0; }
+
+	/**
+	 * Finishes a frame. Counters of the frame are available in GetLastFrameStats.
+	 */
+	void EndFrame();
+
+	/**
+	 * Returns counters of the current frame.
+	 */
+	inline const Stats &GetStats() const { return m_Stats; }
+
+	/**
+	 * Returns counters of the previous frame.
+	 */
+	inline const Stats &GetLastFrameStats() const { return m_LastFrameStats; }
+
+private:
+	struct Batch
+	{
+		HudSpriteState state;
+		float bounds[4]; // x0, y0, x1, y1
+		std::vector<HudSpriteVertex> verts;
+	};
+
+	IHudSpriteBackend *m_pBackend = nullptr;
+
+	// Batches are reused between flushes to keep vertex buffers allocated
+	std::vector<Batch> m_Batches;
+	int m_iBatchCount = 0;
+
+	Stats m_Stats;
+	Stats m_LastFrameStats;
+};
+
+#endif
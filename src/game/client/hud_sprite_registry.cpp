@@ -0,0 +1,136 @@
+#include <algorithm>
+#include <cstring>
+#include "hud_sprite_registry.h"
+
+namespace
+{
+
+// The table is resized when it's more than half full
+constexpr size_t MIN_TABLE_SIZE = 64;
+
+inline unsigned char ToLower(unsigned char c)
+{
+	return (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c;
+}
+
+}
+
+void CHudSpriteRegistry::Clear()
+{
+	m_Sprites.clear();
+	m_Rects.clear();
+	m_Names.clear();
+	m_NameHashes.clear();
+	m_Table.clear();
+}
+
+void CHudSpriteRegistry::Reserve(int count)
+{
+	m_Sprites.reserve(count);
+	m_Rects.reserve(count);
+	m_Names.reserve(count);
+	m_NameHashes.reserve(count);
+
+	size_t tableSize = std::max(m_Table.size(), MIN_TABLE_SIZE);
+
+	while (tableSize < (size_t)count * 2)
+		tableSize *= 2;
+
+	if (tableSize != m_Table.size())
+		Rehash(tableSize);
+}
+
+int CHudSpriteRegistry::Add(const char *name, HSPRITE hSprite, const wrect_t &rect)
+{
+	int index = GetCount();
+
+	SpriteName spriteName;
+	strncpy(spriteName.name, name, MAX_NAME_LENGTH - 1);
+	spriteName.name[MAX_NAME_LENGTH - 1] = '\0';
+
+	m_Sprites.push_back(hSprite);
+	m_Rects.push_back(rect);
+	m_Names.push_back(spriteName);
+	m_NameHashes.push_back(HashName(spriteName.name));
+
+	if (m_Table.size() < m_Sprites.size() * 2)
+		Rehash(std::max(m_Table.size() * 2, MIN_TABLE_SIZE));
+	else
+		Insert(index);
+
+	return index;
+}
+
+int CHudSpriteRegistry::Find(const char *name) const
+{
+	if (m_Table.empty())
+		return -1;
+
+	uint32_t hash = HashName(name);
+	size_t mask = m_Table.size() - 1;
+
+	for (size_t i = hash & mask;; i = (i + 1) & mask)
+	{
+		int index = m_Table[i];
+
+		if (index == -1)
+			return -1;
+
+		if (m_NameHashes[index] == hash && NamesEqual(m_Names[index].name, name))
+			return index;
+	}
+}
+
+uint32_t CHudSpriteRegistry::HashName(const char *name)
+{
+	// FNV-1a of the lowercase name
+	uint32_t hash = 2166136261u;
+
+	for (const unsigned char *p = (const unsigned char *)name; *p; p++)
+	{
+		hash ^= ToLower(*p);
+		hash *= 16777619u;
+	}
+
+	return hash;
+}
+
+bool CHudSpriteRegistry::NamesEqual(const char *a, const char *b)
+{
+	const unsigned char *pa = (const unsigned char *)a;
+	const unsigned char *pb = (const unsigned char *)b;
+
+	while (*pa && ToLower(*pa) == ToLower(*pb))
+	{
+		pa++;
+		pb++;
+	}
+
+	return ToLower(*pa) == ToLower(*pb);
+}
+
+void CHudSpriteRegistry::Rehash(size_t tableSize)
+{
+	m_Table.assign(tableSize, -1);
+
+	for (int index = 0; index < GetCount(); index++)
+		Insert(index);
+}
+
+void CHudSpriteRegistry::Insert(int index)
+{
+	size_t mask = m_Table.size() - 1;
+
+	for (size_t i = m_NameHashes[index] & mask;; i = (i + 1) & mask)
+	{
+		if (m_Table[i] == -1)
+		{
+			m_Table[i] = index;
+			return;
+		}
+
+		// Keep the first sprite with the name
+		if (m_NameHashes[m_Table[i]] == m_NameHashes[index] && NamesEqual(m_Names[m_Table[i]].name, m_Names[index].name))
+			return;
+	}
+}
@@ -0,0 +1,73 @@
+//
+// hud_sprite_registry.h
+//
+// HUD sprites from hud.txt and weapon sprite lists with a name index.
+//
+#ifndef HUD_SPRITE_REGISTRY_H
+#define HUD_SPRITE_REGISTRY_H
+#include <cstdint>
+#include <vector>
+#include "wrect.h"
+
+typedef int HSPRITE; // Same as in cdll_int.h
+
+/**
+ * Handles, rects and names of HUD sprites stored in separate arrays by index,
+ * with a case-insensitive open addressing hash table for lookups by name.
+ */
+class CHudSpriteRegistry
+{
+public:
+	static constexpr int MAX_NAME_LENGTH = 24; // MAX_SPRITE_NAME_LENGTH
+
+	/**
+	 * Removes all sprites.
+	 */
+	void Clear();
+
+	/**
+	 * Allocates memory for the number of sprites.
+	 */
+	void Reserve(int count);
+
+	/**
+	 * Adds a sprite to the end of the list. Names are truncated to MAX_NAME_LENGTH - 1 characters.
+	 * If the name is already used, the sprite is still added but Find returns the first one.
+	 * @returns index of the new sprite.
+	 */
+	int Add(const char *name, HSPRITE hSprite, const wrect_t &rect);
+
+	/**
+	 * Finds a sprite by name, case-insensitive.
+	 * @returns index of the first sprite with this name or -1.
+	 */
+	int Find(const char *name) const;
+
+	inline int GetCount() const { return (int)m_Sprites.size(); }
+	inline HSPRITE GetSprite(int index) const { return m_Sprites[index]; }
+	inline void SetSprite(int index, HSPRITE hSprite) { m_Sprites[index] = hSprite; }
+	inline const wrect_t &GetRect(int index) const { return m_Rects[index]; }
+	inline const char *GetName(int index) const { return m_Names[index].name; }
+
+private:
+	struct SpriteName
+	{
+		char name[MAX_NAME_LENGTH];
+	};
+
+	std::vector<HSPRITE> m_Sprites;
+	std::vector<wrect_t> m_Rects;
+	std::vector<SpriteName> m_Names;
+	std::vector<uint32_t> m_NameHashes;
+
+	// Sprite indexes, -1 for empty slots. Size is a power of two.
+	std::vector<int> m_Table;
+
+	static uint32_t HashName(const char *name);
+	static bool NamesEqual(const char *a, const char *b);
+
+	void Rehash(size_t tableSize);
+	void Insert(int index);
+};
+
+#endif
@@ -0,0 +1,216 @@
+#include <cstring>
+#include "map_entities.h"
+
+namespace
+{
+
+inline bool IsSingleCharToken(char c)
+{
+	return c == '{' || c == '}' || c == '(' || c == ')' || c == '\'' || c == ':';
+}
+
+}
+
+void CMapEntityIndex::Clear()
+{
+	m_Data.clear();
+	m_Entities.clear();
+	m_KeyValues.clear();
+	m_KeyNames.clear();
+	m_KeyIds.clear();
+	m_Classnames.clear();
+	m_pszError = nullptr;
+}
+
+bool CMapEntityIndex::Parse(const char *data)
+{
+	Clear();
+
+	if (!data)
+		return true;
+
+	size_t len = strlen(data);
+	m_Data.assign(data, data + len + 1);
+
+	// About 30 bytes per key and 6 keys per entity
+	m_KeyValues.reserve(len / 30);
+	m_Entities.reserve(len / 180);
+
+	const char *p = m_Data.data();
+	int classnameKey = InternKey("classname");
+	std::string_view token;
+
+	while (ParseToken(p, token))
+	{
+		if (token == "}")
+			break;
+
+		if (token != "{")
+		{
+			m_pszError = "expected {";
+			return false;
+		}
+
+		Entity entity;
+		entity.firstKeyValue = (int)m_KeyValues.size();
+		entity.keyValueCount = 0;
+		std::string_view classname;
+
+		for (;;)
+		{
+			// Key
+			if (!ParseToken(p, token))
+			{
+				m_pszError = "EOF without closing brace";
+				return false;
+			}
+
+			if (token == "}")
+				break;
+
+			// Keys can have trailing spaces
+			std::string_view key = token;
+
+			while (!key.empty() && key.back() == ' ')
+				key.remove_suffix(1);
+
+			// Value
+			if (!ParseToken(p, token))
+			{
+				m_pszError = "EOF without closing brace";
+				return false;
+			}
+
+			if (token == "}")
+			{
+				m_pszError = "closing brace without data";
+				return false;
+			}
+
+			KeyValue kv;
+			kv.keyId = InternKey(key);
+			kv.value = token;
+			m_KeyValues.push_back(kv);
+			entity.keyValueCount++;
+
+			if (kv.keyId == classnameKey)
+				classname = token;
+		}
+
+		int index = (int)m_Entities.size();
+		m_Entities.push_back(entity);
+
+		if (classname.data())
+			m_Classnames[classname].push_back(index);
+	}
+
+	return true;
+}
+
+int CMapEntityIndex::FindKey(std::string_view key) const
+{
+	auto it = m_KeyIds.find(key);
+	return it != m_KeyIds.end() ? it->second : -1;
+}
+
+const std::vector<int> &CMapEntityIndex::FindByClassname(std::string_view classname) const
+{
+	static const std::vector<int> empty;
+	auto it = m_Classnames.find(classname);
+	return it != m_Classnames.end() ? it->second : empty;
+}
+
+std::string_view CMapEntityIndex::GetValue(int entity, int keyId) const
+{
+	const KeyValue *kv = GetKeyValues(entity);
+	std::string_view value;
+
+	for (int i = 0; i < GetKeyValueCount(entity); i++)
+	{
+		if (kv[i].keyId == keyId)
+			value = kv[i].value;
+	}
+
+	return value;
+}
+
+std::string_view CMapEntityIndex::GetValue(int entity, std::string_view key) const
+{
+	int keyId = FindKey(key);
+
+	if (keyId == -1)
+		return std::string_view();
+
+	return GetValue(entity, keyId);
+}
+
+bool CMapEntityIndex::ParseToken(const char *&data, std::string_view &token)
+{
+	const char *p = data;
+
+	// Skip whitespace and comments
+	for (;;)
+	{
+		while (*p && (unsigned char)*p <= ' ')
+			p++;
+
+		if (!*p)
+		{
+			token = std::string_view();
+			data = p;
+			return false;
+		}
+
+		if (p[0] == '/' && p[1] == '/')
+		{
+			while (*p && *p != '\n')
+				p++;
+
+			continue;
+		}
+
+		break;
+	}
+
+	const char *start = p;
+
+	if (*p == '"')
+	{
+		start = ++p;
+
+		while (*p && *p != '"')
+			p++;
+
+		token = std::string_view(start, p - start);
+
+		if (*p)
+			p++;
+	}
+	else if (IsSingleCharToken(*p))
+	{
+		token = std::string_view(p, 1);
+		p++;
+	}
+	else
+	{
+		do
+		{
+			p++;
+		} while ((unsigned char)*p > ' ' && !IsSingleCharToken(*p));
+
+		token = std::string_view(start, p - start);
+	}
+
+	data = p;
+	return true;
+}
+
+int CMapEntityIndex::InternKey(std::string_view key)
+{
+	auto it = m_KeyIds.emplace(key, (int)m_KeyNames.size());
+
+	if (it.second)
+		m_KeyNames.push_back(key);
+
+	return it.first->second;
+}
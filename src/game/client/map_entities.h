@@ -0,0 +1,102 @@
+//
+// map_entities.h
+//
+// Index of the BSP entity lump.
+//
+#ifndef MAP_ENTITIES_H
+#define MAP_ENTITIES_H
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * Entities of a map parsed once from the entity lump.
+ * Keys and values point into a copy of the lump, key names are interned into ids
+ * and entities are indexed by classname.
+ */
+class CMapEntityIndex
+{
+public:
+	struct KeyValue
+	{
+		int keyId;
+		std::string_view value;
+	};
+
+	/**
+	 * Removes all entities.
+	 */
+	void Clear();
+
+	/**
+	 * Parses an entity lump. Previous entities are removed.
+	 * On error entities before the error are kept.
+	 * @returns false on a parsing error, see GetError.
+	 */
+	bool Parse(const char *data);
+
+	/**
+	 * Returns the error of the last Parse call or nullptr.
+	 */
+	inline const char *GetError() const { return m_pszError; }
+
+	/**
+	 * Returns the number of entities.
+	 */
+	inline int GetEntityCount() const { return (int)m_Entities.size(); }
+
+	/**
+	 * Returns the id of a key name or -1 if no entity has it.
+	 */
+	int FindKey(std::string_view key) const;
+
+	/**
+	 * Returns the name of a key id.
+	 */
+	inline std::string_view GetKeyName(int keyId) const { return m_KeyNames[keyId]; }
+
+	/**
+	 * Returns indexes of entities with the classname in the order of the lump.
+	 */
+	const std::vector<int> &FindByClassname(std::string_view classname) const;
+
+	/**
+	 * Returns the value of the last key of an entity with the name.
+	 * @returns the value or an empty view with nullptr data if the entity doesn't have the key.
+	 */
+	std::string_view GetValue(int entity, int keyId) const;
+	std::string_view GetValue(int entity, std::string_view key) const;
+
+	/**
+	 * Returns keys of an entity in the order of the lump.
+	 */
+	inline const KeyValue *GetKeyValues(int entity) const { return m_KeyValues.data() + m_Entities[entity].firstKeyValue; }
+	inline int GetKeyValueCount(int entity) const { return m_Entities[entity].keyValueCount; }
+
+private:
+	struct Entity
+	{
+		int firstKeyValue;
+		int keyValueCount;
+	};
+
+	// Copy of the lump, all views point into it
+	std::vector<char> m_Data;
+
+	std::vector<Entity> m_Entities;
+	std::vector<KeyValue> m_KeyValues;
+	std::vector<std::string_view> m_KeyNames;
+	std::unordered_map<std::string_view, int> m_KeyIds;
+	std::unordered_map<std::string_view, std::vector<int>> m_Classnames;
+	const char *m_pszError = nullptr;
+
+	/**
+	 * Reads a token the same way as COM_ParseFile.
+	 * @returns false at the end of the data.
+	 */
+	static bool ParseToken(const char *&data, std::string_view &token);
+
+	int InternKey(std::string_view key);
+};
+
+#endif
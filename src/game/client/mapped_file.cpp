@@ -0,0 +1,138 @@
+#include <string>
+#include <utility>
+
+#ifdef PLATFORM_WINDOWS
+
+#include <winsani_in.h>
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+#include <winsani_out.h>
+
+#else
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#endif
+
+#include "mapped_file.h"
+
+CMappedFile::CMappedFile(CMappedFile &&other) noexcept
+{
+	*this = std::move(other);
+}
+
+CMappedFile::~CMappedFile()
+{
+	Close();
+}
+
+CMappedFile &CMappedFile::operator=(CMappedFile &&other) noexcept
+{
+	if (this != &other)
+	{
+		Close();
+		m_pData = other.m_pData;
+		m_uSize = other.m_uSize;
+		other.m_pData = nullptr;
+		other.m_uSize = 0;
+	}
+
+	return *this;
+}
+
+#ifdef PLATFORM_WINDOWS
+
+bool CMappedFile::Open(const char *path)
+{
+	Close();
+
+	int wlen = MultiByteToWideChar(CP_UTF8, 0, path, -1, nullptr, 0);
+	if (wlen <= 0)
+		return false;
+
+	std::wstring wpath(wlen, L'\0');
+	MultiByteToWideChar(CP_UTF8, 0, path, -1, &wpath[0], wlen);
+
+	HANDLE hFile = CreateFileW(wpath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (hFile == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(hFile, &size) || size.QuadPart == 0 || (unsigned long long)size.QuadPart > SIZE_MAX)
+	{
+		CloseHandle(hFile);
+		return false;
+	}
+
+	HANDLE hMapping = CreateFileMappingW(hFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	CloseHandle(hFile);
+
+	if (!hMapping)
+		return false;
+
+	// The view keeps the mapping alive
+	void *pData = MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0);
+	CloseHandle(hMapping);
+
+	if (!pData)
+		return false;
+
+	m_pData = (const uint8_t *)pData;
+	m_uSize = (size_t)size.QuadPart;
+	return true;
+}
+
+void CMappedFile::Close()
+{
+	if (m_pData)
+	{
+		UnmapViewOfFile(m_pData);
+		m_pData = nullptr;
+		m_uSize = 0;
+	}
+}
+
+#else
+
+bool CMappedFile::Open(const char *path)
+{
+	Close();
+
+	int fd = open(path, O_RDONLY);
+	if (fd == -1)
+		return false;
+
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size <= 0 || (unsigned long long)st.st_size > SIZE_MAX)
+	{
+		close(fd);
+		return false;
+	}
+
+	// The mapping stays valid after the descriptor is closed
+	void *pData = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+
+	if (pData == MAP_FAILED)
+		return false;
+
+	m_pData = (const uint8_t *)pData;
+	m_uSize = (size_t)st.st_size;
+	return true;
+}
+
+void CMappedFile::Close()
+{
+	if (m_pData)
+	{
+		munmap((void *)m_pData, m_uSize);
+		m_pData = nullptr;
+		m_uSize = 0;
+	}
+}
+
+#endif
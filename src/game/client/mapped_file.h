@@ -0,0 +1,58 @@
+//
+// mapped_file.h
+//
+// Read-only memory-mapped files.
+//
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Maps a whole file into memory for reading.
+ * The file is unmapped when the object is destroyed.
+ */
+class CMappedFile
+{
+public:
+	CMappedFile() = default;
+	CMappedFile(const CMappedFile &) = delete;
+	CMappedFile(CMappedFile &&other) noexcept;
+	~CMappedFile();
+
+	CMappedFile &operator=(const CMappedFile &) = delete;
+	CMappedFile &operator=(CMappedFile &&other) noexcept;
+
+	/**
+	 * Maps a file. Previously mapped file is closed.
+	 * @param	path	Path to the file in UTF-8.
+	 * @returns true if file was mapped. Empty files can't be mapped.
+	 */
+	bool Open(const char *path);
+
+	/**
+	 * Unmaps the file.
+	 */
+	void Close();
+
+	/**
+	 * Returns whether a file is mapped.
+	 */
+	inline bool IsOpen() const { return m_pData != nullptr; }
+
+	/**
+	 * Returns pointer to the beginning of the file.
+	 */
+	inline const uint8_t *GetData() const { return m_pData; }
+
+	/**
+	 * Returns size of the file in bytes.
+	 */
+	inline size_t GetSize() const { return m_uSize; }
+
+private:
+	const uint8_t *m_pData = nullptr;
+	size_t m_uSize = 0;
+};
+
+#endif
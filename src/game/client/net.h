@@ -20,6 +20,40 @@ int NetReceiveUdp(unsigned long sin_addr, int sin_port, char *recvbuf, int size,
 void NetClearSocket(NetSocket s);
 void NetCloseSocket(NetSocket s);
 
-char *NetGetRuleValueFromBuffer(const char *buffer, int len, const char *cvar);
+/**
+ * Address that sends to all hosts of the local network, see NetOpenUdpSocket.
+ */
+constexpr unsigned long NET_BROADCAST_ADDR = 0xFFFFFFFF;
+
+/**
+ * Opens a nonblocking UDP socket.
+ * @param	port		Local port in host byte order, 0 for any.
+ * @param	broadcast	Whether sending to NET_BROADCAST_ADDR is allowed.
+ * @returns Socket or 0 on error.
+ */
+NetSocket NetOpenUdpSocket(int port = 0, bool broadcast = false);
+
+/**
+ * Returns local port of a socket in host byte order or 0 on error.
+ */
+int NetGetSocketPort(NetSocket s);
+
+/**
+ * Waits for a datagram from any address and receives it.
+ * @param	from_addr	Sender address, network byte order.
+ * @param	from_port	Sender port, network byte order.
+ * @param	timeoutMs	Max time to wait.
+ * @returns Received size, 0 on timeout or -1 on error.
+ */
+int NetWaitReceiveUdp(NetSocket s, char *recvbuf, int size, unsigned long *from_addr, int *from_port, int timeoutMs);
+
+/**
+ * Parses "a.b.c.d:port" address. Port is optional.
+ * @param	addr			Address, network byte order.
+ * @param	port			Port, network byte order.
+ * @param	defaultPort		Port if string has none, host byte order.
+ * @returns false if string is not an IP address.
+ */
+bool NetStringToAddr(const char *str, unsigned long *addr, int *port, int defaultPort);
 
 #endif
@@ -7,7 +7,10 @@
 ****/
 
 #include <unistd.h>
+#include <cerrno>
+#include <cstdlib>
 #include <cstring>
+#include <poll.h>
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
@@ -99,10 +102,19 @@ int NetSendUdp(unsigned long sin_addr, int sin_port, const char *sendbuf, int le
 {
 	// Create or get a socket for sending data
 	int s1;
+	bool created = false;
 	if (s && *s)
+	{
 		s1 = SocketConvert(*s);
+	}
 	else
+	{
+		// Socket is made nonblocking once, NetReceiveUdp relies on it
 		s1 = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+		unsigned long nonzero = 1;
+		ioctl(s1, FIONBIO, &nonzero);
+		created = true;
+	}
 
 	struct sockaddr_in addr;
 	memset(&addr, 0, sizeof(struct sockaddr_in));
@@ -113,10 +125,10 @@ int NetSendUdp(unsigned long sin_addr, int sin_port, const char *sendbuf, int le
 	// Send buffer
 	int res = sendto(s1, sendbuf, len, 0, (struct sockaddr *)&addr, sizeof(struct sockaddr_in));
 
-	// Return socket if send was succeded
+	// Return socket if send was succeded, caller's socket is never closed
 	if (res != -1 && s)
 		*s = SocketConvert(s1);
-	else
+	else if (created)
 		close(s1);
 
 	return res;
@@ -134,33 +146,12 @@ int NetReceiveUdp(unsigned long sin_addr, int sin_port, char *recvbuf, int size,
 	addr.sin_addr.s_addr = sin_addr;
 	addr.sin_port = sin_port;
 
-	// Try to receive response
-	int res;
-	unsigned long nonzero = 1;
-	ioctl(s, FIONBIO, &nonzero);
-	int maxfd;
-	fd_set rfd;
-	fd_set efd;
-	struct timeval tv;
-
-	// Do select on socket
-	FD_ZERO(&rfd);
-	FD_ZERO(&efd);
-	FD_SET(s, &rfd);
-	FD_SET(s, &efd);
-	maxfd = s;
-	tv.tv_sec = 0;
-	tv.tv_usec = 0;
-	res = select(maxfd + 1, &rfd, NULL, &efd, &tv);
-	// Check for error on socket
-	if (res == -1 || FD_ISSET(s, &efd))
-		return -1;
+	// Socket is nonblocking, so just try to receive
+	socklen_t fromaddrlen = sizeof(struct sockaddr_in);
+	int res = recvfrom(s, recvbuf, size, 0, (struct sockaddr *)&fromaddr, &fromaddrlen);
 	// Return if nothing to receive
-	if (res == 0)
+	if (res == -1 && (errno == EAGAIN || errno == EWOULDBLOCK))
 		return 0;
-	// Get what we had received
-	socklen_t fromaddrlen = sizeof(struct sockaddr_in);
-	res = recvfrom(s, recvbuf, size, 0, (struct sockaddr *)&fromaddr, &fromaddrlen);
 	// Check for error on socket
 	if (res == -1)
 		return -1;
@@ -188,28 +179,107 @@ void NetCloseSocket(NetSocket s)
 	close(SocketConvert(s));
 }
 
-char *NetGetRuleValueFromBuffer(const char *buffer, int len, const char *cvar)
+NetSocket NetOpenUdpSocket(int port, bool broadcast)
 {
-	// Check response header
-	if (len < 6 || (*(unsigned int *)buffer != 0xFFFFFFFF || buffer[4] != 'E'))
-		return NULL;
-	// Search for a cvar
-	char *current = (char *)buffer + 4;
-	char *end = (char *)buffer + len - strlen(cvar);
-	while (current < end)
+	int s = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+	if (s == -1)
+		return 0;
+
+	struct sockaddr_in addr;
+	memset(&addr, 0, sizeof(struct sockaddr_in));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = INADDR_ANY;
+	addr.sin_port = htons((unsigned short)port);
+
+	unsigned long nonzero = 1;
+	if (bind(s, (struct sockaddr *)&addr, sizeof(struct sockaddr_in)) == -1 || ioctl(s, FIONBIO, &nonzero) == -1)
 	{
-		char *pcvar = (char *)cvar;
-		while (*current == *pcvar && *pcvar != 0)
-		{
-			current++;
-			pcvar++;
-		}
-		if (*pcvar == 0)
-		{
-			// Found
-			return current + 1;
-		}
-		current++;
+		close(s);
+		return 0;
 	}
-	return NULL;
+
+	// Many servers may answer at once, ask for a larger buffer
+	int rcvbuf = 1024 * 1024;
+	setsockopt(s, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+
+	int enable = 1;
+	if (broadcast && setsockopt(s, SOL_SOCKET, SO_BROADCAST, &enable, sizeof(enable)) == -1)
+	{
+		close(s);
+		return 0;
+	}
+
+	return SocketConvert(s);
+}
+
+int NetGetSocketPort(NetSocket s)
+{
+	struct sockaddr_in addr;
+	socklen_t addrlen = sizeof(struct sockaddr_in);
+	if (!s || getsockname(SocketConvert(s), (struct sockaddr *)&addr, &addrlen) == -1)
+		return 0;
+	return ntohs(addr.sin_port);
+}
+
+int NetWaitReceiveUdp(NetSocket ns, char *recvbuf, int size, unsigned long *from_addr, int *from_port, int timeoutMs)
+{
+	if (!ns)
+		return -1;
+
+	int s = SocketConvert(ns);
+	struct sockaddr_in fromaddr;
+	socklen_t fromaddrlen = sizeof(struct sockaddr_in);
+
+	// Try the socket first, poll is only needed when it's empty
+	int res = recvfrom(s, recvbuf, size, 0, (struct sockaddr *)&fromaddr, &fromaddrlen);
+	if (res == -1 && (errno == EAGAIN || errno == EWOULDBLOCK))
+	{
+		struct pollfd pfd;
+		pfd.fd = s;
+		pfd.events = POLLIN;
+		pfd.revents = 0;
+		res = poll(&pfd, 1, timeoutMs);
+		if (res <= 0)
+			return res == 0 || errno == EINTR ? 0 : -1;
+
+		fromaddrlen = sizeof(struct sockaddr_in);
+		res = recvfrom(s, recvbuf, size, 0, (struct sockaddr *)&fromaddr, &fromaddrlen);
+		if (res == -1 && (errno == EAGAIN || errno == EWOULDBLOCK))
+			return 0;
+	}
+	if (res == -1)
+		return -1;
+
+	*from_addr = fromaddr.sin_addr.s_addr;
+	*from_port = fromaddr.sin_port;
+	return res;
+}
+
+bool NetStringToAddr(const char *str, unsigned long *addr, int *port, int defaultPort)
+{
+	char host[32];
+	const char *colon = strchr(str, ':');
+	size_t len = colon ? colon - str : strlen(str);
+	if (len == 0 || len >= sizeof(host))
+		return false;
+	memcpy(host, str, len);
+	host[len] = 0;
+
+	// Only dotted addresses, name resolution would block
+	unsigned long a = inet_addr(host);
+	if (a == INADDR_NONE && strcmp(host, "255.255.255.255"))
+		return false;
+
+	int p = defaultPort;
+	if (colon)
+	{
+		char *end;
+		p = strtol(colon + 1, &end, 10);
+		if (*end || p <= 0 || p > 65535)
+			return false;
+	}
+
+	*addr = a;
+	*port = htons((unsigned short)p);
+	return true;
 }
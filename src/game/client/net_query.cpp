@@ -0,0 +1,573 @@
+#include <algorithm>
+#include <cstring>
+#include "net_query.h"
+
+namespace
+{
+
+constexpr char A2S_INFO_REQUEST[] = "\xFF\xFF\xFF\xFFTSource Engine Query"; // Including the null terminator
+constexpr char A2S_RULES_REQUEST[] = "\xFF\xFF\xFF\xFFV";
+constexpr int MAX_REQUEST_LEN = sizeof(A2S_INFO_REQUEST) + 4;
+
+inline int ReadInt(const char *p)
+{
+	int value;
+	memcpy(&value, p, sizeof(value));
+	return value;
+}
+
+/**
+ * Reads fields of a response, stops at the end.
+ */
+class CResponseReader
+{
+public:
+	CResponseReader(const char *data, int len)
+	    : m_pPos(data)
+	    , m_pEnd(data + len)
+	{
+	}
+
+	inline bool IsValid() const { return m_bIsValid; }
+
+	int ReadByte()
+	{
+		if (m_pPos >= m_pEnd)
+		{
+			m_bIsValid = false;
+			return 0;
+		}
+
+		return (unsigned char)*m_pPos++;
+	}
+
+	void Skip(int len)
+	{
+		if (m_pEnd - m_pPos < len)
+		{
+			m_bIsValid = false;
+			m_pPos = m_pEnd;
+			return;
+		}
+
+		m_pPos += len;
+	}
+
+	std::string ReadString()
+	{
+		const char *end = (const char *)memchr(m_pPos, 0, m_pEnd - m_pPos);
+
+		if (!end)
+		{
+			m_bIsValid = false;
+			m_pPos = m_pEnd;
+			return std::string();
+		}
+
+		std::string str(m_pPos, end);
+		m_pPos = end + 1;
+		return str;
+	}
+
+private:
+	const char *m_pPos;
+	const char *m_pEnd;
+	bool m_bIsValid = true;
+};
+
+}
+
+//-----------------------------------------------------------------
+// CNetRules
+//-----------------------------------------------------------------
+bool CNetRules::Parse(const char *data, int len)
+{
+	Clear();
+
+	// Check response header
+	if (len < 5 || ReadInt(data) != -1 /*0xFFFFFFFF*/ || data[4] != 'E')
+		return false;
+
+	// Header is followed by a short rule count, which is not trusted: rules are read until the end
+	int start = std::min(len, 7);
+	m_Data.assign(data + start, data + len);
+
+	const char *base = m_Data.data();
+	const char *p = base;
+	const char *end = base + m_Data.size();
+
+	while (p < end)
+	{
+		const char *nameEnd = (const char *)memchr(p, 0, end - p);
+
+		if (!nameEnd)
+			break;
+
+		const char *valueEnd = (const char *)memchr(nameEnd + 1, 0, end - nameEnd - 1);
+
+		if (!valueEnd)
+			break;
+
+		m_Rules.push_back({ (int)(p - base), (int)(nameEnd + 1 - base) });
+		p = valueEnd + 1;
+	}
+
+	// If a name is repeated, the first one is found
+	std::stable_sort(m_Rules.begin(), m_Rules.end(), [base](const Rule &lhs, const Rule &rhs) {
+		return strcmp(base + lhs.name, base + rhs.name) < 0;
+	});
+
+	return true;
+}
+
+const char *CNetRules::GetValue(const char *name) const
+{
+	const char *base = m_Data.data();
+	auto it = std::lower_bound(m_Rules.begin(), m_Rules.end(), name, [base](const Rule &lhs, const char *rhs) {
+		return strcmp(base + lhs.name, rhs) < 0;
+	});
+
+	if (it == m_Rules.end() || strcmp(base + it->name, name))
+		return nullptr;
+
+	return base + it->value;
+}
+
+void CNetRules::Clear()
+{
+	m_Data.clear();
+	m_Rules.clear();
+}
+
+//-----------------------------------------------------------------
+// CNetServerInfo
+//-----------------------------------------------------------------
+bool CNetServerInfo::Parse(const char *data, int len)
+{
+	if (len < 5 || ReadInt(data) != -1 /*0xFFFFFFFF*/)
+		return false;
+
+	CResponseReader reader(data + 5, len - 5);
+
+	if (data[4] == 'I')
+	{
+		reader.ReadByte(); // Protocol
+		name = reader.ReadString();
+		map = reader.ReadString();
+		gameDir = reader.ReadString();
+		description = reader.ReadString();
+		reader.Skip(2); // App ID
+		players = reader.ReadByte();
+		maxPlayers = reader.ReadByte();
+		bots = reader.ReadByte();
+		reader.Skip(2); // Server type and OS
+		isPassworded = reader.ReadByte() != 0;
+		isSecure = reader.ReadByte() != 0;
+	}
+	else if (data[4] == 'm')
+	{
+		reader.ReadString(); // Address
+		name = reader.ReadString();
+		map = reader.ReadString();
+		gameDir = reader.ReadString();
+		description = reader.ReadString();
+		players = reader.ReadByte();
+		maxPlayers = reader.ReadByte();
+		reader.Skip(3); // Protocol, server type and OS
+		isPassworded = reader.ReadByte() != 0;
+
+		if (reader.ReadByte() == 1)
+		{
+			// Mod info
+			reader.ReadString(); // Link
+			reader.ReadString(); // Download link
+			reader.Skip(11); // Null, version, size, type and DLL
+		}
+
+		isSecure = reader.ReadByte() != 0;
+		bots = reader.ReadByte();
+	}
+	else
+	{
+		return false;
+	}
+
+	return reader.IsValid();
+}
+
+//-----------------------------------------------------------------
+// CNetSplitPacket
+//-----------------------------------------------------------------
+void CNetSplitPacket::Reset()
+{
+	for (Response &i : m_Responses)
+	{
+		i.receivedMask = 0;
+		i.receivedCount = 0;
+	}
+}
+
+CNetSplitPacket::Status CNetSplitPacket::Add(const char *packet, int len)
+{
+	if (len < 5)
+		return Status::Invalid;
+
+	int header = ReadInt(packet);
+
+	if (header == -1 /*0xFFFFFFFF*/)
+	{
+		m_Data.assign(packet, packet + len);
+		return Status::Complete;
+	}
+
+	if (header != -2 /*0xFEFFFFFF*/ || len < 9)
+		return Status::Invalid;
+
+	int responseID = ReadInt(packet + 4);
+	int currentPacket = (unsigned char)packet[8] >> 4;
+	int totalPackets = (unsigned char)packet[8] & 0x0F;
+
+	if (currentPacket >= totalPackets)
+		return Status::Invalid; // broken split packet
+
+	Response &response = FindResponse(responseID, totalPackets);
+	response.lastUpdate = ++m_iUpdateCount;
+
+	if (response.receivedMask & (1 << currentPacket))
+		return Status::Incomplete; // already has this packet
+
+	response.parts[currentPacket].assign(packet + 9, len - 9);
+	response.receivedMask |= 1 << currentPacket;
+	response.receivedCount++;
+
+	if (response.receivedCount < response.total)
+		return Status::Incomplete;
+
+	// Parts may come in any order and have any size
+	m_Data.clear();
+
+	for (int i = 0; i < response.total; i++)
+		m_Data.insert(m_Data.end(), response.parts[i].begin(), response.parts[i].end());
+
+	response.receivedMask = 0;
+	response.receivedCount = 0;
+	return Status::Complete;
+}
+
+CNetSplitPacket::Response &CNetSplitPacket::FindResponse(int responseID, int total)
+{
+	Response *pFree = nullptr;
+	Response *pOldest = &m_Responses[0];
+
+	for (Response &i : m_Responses)
+	{
+		if (i.receivedCount == 0)
+		{
+			if (!pFree)
+				pFree = &i;
+
+			continue;
+		}
+
+		if (i.responseID == responseID)
+		{
+			if (i.total == total)
+				return i;
+
+			// Same ID with another part count, can't be the same response
+			pFree = &i;
+			break;
+		}
+
+		if (i.lastUpdate < pOldest->lastUpdate)
+			pOldest = &i;
+	}
+
+	Response &response = pFree ? *pFree : *pOldest;
+	response.responseID = responseID;
+	response.total = total;
+	response.receivedMask = 0;
+	response.receivedCount = 0;
+	return response;
+}
+
+//-----------------------------------------------------------------
+// CNetQuery
+//-----------------------------------------------------------------
+CNetQuery::~CNetQuery()
+{
+	Shutdown();
+}
+
+bool CNetQuery::Start()
+{
+	if (IsStarted())
+		return true;
+
+	m_Socket = NetOpenUdpSocket(0, true);
+
+	if (!m_Socket)
+		return false;
+
+	m_bShutdown = false;
+	m_WorkerThread = std::thread([this]() { WorkerThreadFunc(); });
+	return true;
+}
+
+void CNetQuery::Shutdown()
+{
+	if (!IsStarted())
+		return;
+
+	m_bShutdown = true;
+	m_WorkerThread.join();
+
+	NetCloseSocket(m_Socket);
+	m_Socket = 0;
+	m_Pending.clear();
+
+	// The worker is stopped, so the queues can be emptied from this thread
+	Request request;
+	Result result;
+
+	while (m_Requests.Pop(request))
+		;
+	while (m_Results.Pop(result))
+		;
+}
+
+bool CNetQuery::Query(Type type, unsigned long addr, int port)
+{
+	if (!Start())
+		return false;
+
+	// The worker must know about the request before the answer arrives
+	Request request;
+	request.type = type;
+	request.addr = addr;
+	request.port = port;
+	request.time = Clock::now();
+
+	if (!m_Requests.Push(std::move(request)))
+		return false;
+
+	char buf[MAX_REQUEST_LEN];
+	int len = MakeRequest(type, -1, buf);
+	NetSocket s = m_Socket;
+	NetSendUdp(addr, port, buf, len, &s);
+	return true;
+}
+
+bool CNetQuery::GetResult(Result &result)
+{
+	return m_Results.Pop(result);
+}
+
+uint64_t CNetQuery::GetKey(Type type, unsigned long addr, int port)
+{
+	return ((uint64_t)(addr & 0xFFFFFFFF) << 24) | ((uint64_t)(port & 0xFFFF) << 8) | (uint64_t)type;
+}
+
+int CNetQuery::MakeRequest(Type type, int challenge, char *buf)
+{
+	if (type == Type::Info)
+	{
+		// Challenge is appended only when server asked for it
+		memcpy(buf, A2S_INFO_REQUEST, sizeof(A2S_INFO_REQUEST));
+
+		if (challenge == -1)
+			return sizeof(A2S_INFO_REQUEST);
+
+		memcpy(buf + sizeof(A2S_INFO_REQUEST), &challenge, 4);
+		return sizeof(A2S_INFO_REQUEST) + 4;
+	}
+	else
+	{
+		// -1 requests the challenge
+		memcpy(buf, A2S_RULES_REQUEST, 5);
+		memcpy(buf + 5, &challenge, 4);
+		return 9;
+	}
+}
+
+void CNetQuery::WorkerThreadFunc() noexcept
+{
+	char buffer[2048];
+
+	while (!m_bShutdown.load(std::memory_order_relaxed))
+	{
+		unsigned long addr = 0;
+		int port = 0;
+		int len = NetWaitReceiveUdp(m_Socket, buffer, sizeof(buffer), &addr, &port, POLL_INTERVAL_MS);
+
+		TakeRequests();
+
+		if (len > 0)
+			ProcessPacket(addr, port, buffer, len);
+		else if (len < 0)
+			std::this_thread::sleep_for(std::chrono::milliseconds(POLL_INTERVAL_MS)); // Don't spin on a broken socket
+
+		// Many answers may come at once, don't go through all queries after each of them
+		Clock::time_point now = Clock::now();
+
+		if (len <= 0 || now >= m_NextTimeoutCheck)
+		{
+			CheckTimeouts(now);
+			m_NextTimeoutCheck = now + std::chrono::milliseconds(POLL_INTERVAL_MS / 5);
+		}
+	}
+}
+
+void CNetQuery::TakeRequests()
+{
+	Request request;
+
+	while (m_Requests.Pop(request))
+	{
+		Pending &pending = m_Pending[GetKey(request.type, request.addr, request.port)];
+		pending.type = request.type;
+		pending.addr = request.addr;
+		pending.port = request.port;
+		pending.time = request.time;
+		pending.sendTime = request.time;
+		pending.challenge = -1;
+		pending.response.Reset();
+	}
+}
+
+void CNetQuery::ProcessPacket(unsigned long addr, int port, const char *packet, int len)
+{
+	if (len < 5)
+		return;
+
+	int header = ReadInt(packet);
+	Type type;
+
+	if (header == -2 /*0xFEFFFFFF*/)
+	{
+		type = Type::Rules; // Only rules don't fit into one packet
+	}
+	else if (header != -1 /*0xFFFFFFFF*/)
+	{
+		return;
+	}
+	else if (packet[4] == 'A' && len >= 9)
+	{
+		ProcessChallenge(addr, port, ReadInt(packet + 5));
+		return;
+	}
+	else if (packet[4] == 'E')
+	{
+		type = Type::Rules;
+	}
+	else if (packet[4] == 'I' || packet[4] == 'm')
+	{
+		type = Type::Info;
+	}
+	else
+	{
+		return;
+	}
+
+	auto it = m_Pending.find(GetKey(type, addr, port));
+
+	if (it == m_Pending.end())
+	{
+		if (type == Type::Info)
+			ProcessBroadcastAnswer(addr, port, packet, len);
+
+		return; // Not queried or already finished
+	}
+
+	Pending &pending = it->second;
+
+	if (pending.response.Add(packet, len) != CNetSplitPacket::Status::Complete)
+		return;
+
+	Result result;
+	const std::vector<char> &data = pending.response.GetData();
+	bool isParsed = type == Type::Info
+	    ? result.info.Parse(data.data(), (int)data.size())
+	    : result.rules.Parse(data.data(), (int)data.size());
+
+	if (!isParsed)
+	{
+		// Broken answer, keep waiting for a good one
+		pending.response.Reset();
+		return;
+	}
+
+	result.type = type;
+	result.addr = addr;
+	result.port = port;
+	result.rtt = std::chrono::duration<float>(Clock::now() - pending.sendTime).count();
+
+	// Dropped if the game thread doesn't take results
+	m_Results.Push(std::move(result));
+	m_Pending.erase(it);
+}
+
+void CNetQuery::ProcessChallenge(unsigned long addr, int port, int challenge)
+{
+	// Challenge answer doesn't tell which request it's for, so all requests to the server are sent again
+	for (Type type : { Type::Info, Type::Rules })
+	{
+		auto it = m_Pending.find(GetKey(type, addr, port));
+
+		if (it == m_Pending.end() || it->second.challenge == challenge)
+			continue;
+
+		char buf[MAX_REQUEST_LEN];
+		int len = MakeRequest(type, challenge, buf);
+		NetSocket s = m_Socket;
+		NetSendUdp(addr, port, buf, len, &s);
+
+		it->second.challenge = challenge;
+		it->second.sendTime = Clock::now();
+	}
+}
+
+void CNetQuery::ProcessBroadcastAnswer(unsigned long addr, int port, const char *packet, int len)
+{
+	auto it = m_Pending.find(GetKey(Type::Info, NET_BROADCAST_ADDR, port));
+
+	if (it == m_Pending.end())
+		return;
+
+	Result result;
+
+	if (!result.info.Parse(packet, len))
+		return;
+
+	// The broadcast stays pending for other servers
+	result.type = Type::Info;
+	result.isBroadcastAnswer = true;
+	result.addr = addr;
+	result.port = port;
+	result.rtt = std::chrono::duration<float>(Clock::now() - it->second.sendTime).count();
+	m_Results.Push(std::move(result));
+}
+
+void CNetQuery::CheckTimeouts(Clock::time_point now)
+{
+	for (auto it = m_Pending.begin(); it != m_Pending.end();)
+	{
+		const Pending &pending = it->second;
+
+		if (now - pending.time < std::chrono::milliseconds(TIMEOUT_MS))
+		{
+			++it;
+			continue;
+		}
+
+		Result result;
+		result.type = pending.type;
+		result.addr = pending.addr;
+		result.port = pending.port;
+		result.isTimedOut = true;
+		result.rtt = std::chrono::duration<float>(now - pending.sendTime).count();
+		m_Results.Push(std::move(result));
+
+		it = m_Pending.erase(it);
+	}
+}
@@ -0,0 +1,289 @@
+//
+// net_query.h
+//
+// Asynchronous A2S_INFO and A2S_RULES queries on one persistent socket.
+//
+#ifndef NET_QUERY_H
+#define NET_QUERY_H
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "net.h"
+
+/**
+ * Fixed-size lock-free queue for one producer thread and one consumer thread.
+ */
+template <typename T, size_t N>
+class CNetSpscQueue
+{
+public:
+	static_assert((N & (N - 1)) == 0, "N must be a power of two");
+
+	/**
+	 * Moves an item into the queue. Called by the producer.
+	 * @returns false if the queue is full.
+	 */
+	bool Push(T &&item)
+	{
+		size_t writePos = m_uWritePos.load(std::memory_order_relaxed);
+
+		if (writePos - m_uReadPos.load(std::memory_order_acquire) == N)
+			return false;
+
+		m_Items[writePos & (N - 1)] = std::move(item);
+		m_uWritePos.store(writePos + 1, std::memory_order_release);
+		return true;
+	}
+
+	/**
+	 * Moves the oldest item out of the queue. Called by the consumer.
+	 * @returns false if the queue is empty.
+	 */
+	bool Pop(T &item)
+	{
+		size_t readPos = m_uReadPos.load(std::memory_order_relaxed);
+
+		if (readPos == m_uWritePos.load(std::memory_order_acquire))
+			return false;
+
+		item = std::move(m_Items[readPos & (N - 1)]);
+		m_uReadPos.store(readPos + 1, std::memory_order_release);
+		return true;
+	}
+
+private:
+	T m_Items[N];
+
+	// Positions only grow, index is pos & (N - 1)
+	alignas(64) std::atomic<size_t> m_uWritePos { 0 }; // Owned by producer
+	alignas(64) std::atomic<size_t> m_uReadPos { 0 }; // Owned by consumer
+};
+
+/**
+ * Server rules from an A2S_RULES response.
+ */
+class CNetRules
+{
+public:
+	/**
+	 * Parses a complete response, starting with the 0xFFFFFFFF 'E' header.
+	 * Rules of a truncated response are kept up to the cut.
+	 * @returns false if this isn't a rules response.
+	 */
+	bool Parse(const char *data, int len);
+
+	/**
+	 * Returns value of a rule or nullptr if server doesn't have it.
+	 */
+	const char *GetValue(const char *name) const;
+
+	inline int GetCount() const { return (int)m_Rules.size(); }
+
+	void Clear();
+
+private:
+	struct Rule
+	{
+		int name; //!< Offset in m_Data
+		int value;
+	};
+
+	std::vector<char> m_Data; //!< Null-terminated names and values
+	std::vector<Rule> m_Rules; //!< Sorted by name
+};
+
+/**
+ * Server info from an A2S_INFO response.
+ * Both the Source ('I') and the old GoldSrc ('m') formats are read.
+ */
+class CNetServerInfo
+{
+public:
+	std::string name;
+	std::string map;
+	std::string gameDir;
+	std::string description;
+	int players = 0;
+	int maxPlayers = 0;
+	int bots = 0;
+	bool isPassworded = false;
+	bool isSecure = false;
+
+	/**
+	 * Parses a complete response, starting with the 0xFFFFFFFF header.
+	 * @returns false if this isn't an info response or it's truncated.
+	 */
+	bool Parse(const char *data, int len);
+};
+
+/**
+ * Reassembles a response from GoldSrc split packets (0xFFFFFFFE header).
+ * Single packets (0xFFFFFFFF header) complete at once.
+ */
+class CNetSplitPacket
+{
+public:
+	static constexpr int MAX_PACKETS = 16;
+
+	enum class Status
+	{
+		Incomplete, //!< Waiting for other parts
+		Complete, //!< GetData returns the response
+		Invalid, //!< Not a response packet
+	};
+
+	void Reset();
+
+	/**
+	 * Adds a received packet.
+	 * Parts are collected separately per response ID, so late parts of an
+	 * earlier response don't block the current one. If more responses are
+	 * in progress than fit, the one updated longest ago is dropped.
+	 */
+	Status Add(const char *packet, int len);
+
+	/**
+	 * Returns the reassembled response.
+	 */
+	inline const std::vector<char> &GetData() const { return m_Data; }
+
+private:
+	static constexpr int MAX_RESPONSES = 4;
+
+	struct Response
+	{
+		int responseID = 0;
+		int total = 0;
+		int receivedMask = 0;
+		int receivedCount = 0; //!< 0 if the slot is free
+		unsigned lastUpdate = 0;
+		std::string parts[MAX_PACKETS];
+	};
+
+	Response m_Responses[MAX_RESPONSES];
+	unsigned m_iUpdateCount = 0;
+	std::vector<char> m_Data;
+
+	Response &FindResponse(int responseID, int total);
+};
+
+/**
+ * A2S_INFO and A2S_RULES query client.
+ * Requests are sent from the game thread, a worker thread waits on the socket,
+ * answers challenges, reassembles split responses and parses them.
+ * Results are passed back through a lock-free queue.
+ * Public methods must be called from the same thread.
+ */
+class CNetQuery
+{
+public:
+	static constexpr int TIMEOUT_MS = 3000;
+	static constexpr int POLL_INTERVAL_MS = 50; //!< Max time the worker sleeps on the socket
+	static constexpr size_t QUEUE_SIZE = 1024;
+
+	enum class Type
+	{
+		Info,
+		Rules,
+	};
+
+	struct Result
+	{
+		Type type = Type::Info;
+		unsigned long addr = 0; //!< Network byte order
+		int port = 0; //!< Network byte order
+		bool isTimedOut = false;
+		bool isBroadcastAnswer = false; //!< Answer of a server to a broadcast query
+		float rtt = 0; //!< Seconds from the last sent request to the complete response
+		CNetServerInfo info; //!< Set for Type::Info
+		CNetRules rules; //!< Set for Type::Rules
+	};
+
+	CNetQuery() = default;
+	CNetQuery(const CNetQuery &) = delete;
+	~CNetQuery();
+
+	CNetQuery &operator=(const CNetQuery &) = delete;
+
+	/**
+	 * Opens the socket and starts the worker. Called by Query.
+	 * @returns false if the socket can't be opened.
+	 */
+	bool Start();
+
+	/**
+	 * Stops the worker, closes the socket and drops pending queries.
+	 */
+	void Shutdown();
+
+	inline bool IsStarted() const { return m_WorkerThread.joinable(); }
+
+	/**
+	 * Sends a request. A pending query of the same type to the same server is restarted.
+	 * Info query to NET_BROADCAST_ADDR gives a result for every server that answers
+	 * and a timed out result at the end.
+	 * @param	addr	Server address, network byte order.
+	 * @param	port	Server port, network byte order.
+	 * @returns false if the worker can't be started or too many requests are waiting for it.
+	 *          A request that fails to send times out.
+	 */
+	bool Query(Type type, unsigned long addr, int port);
+
+	inline bool QueryInfo(unsigned long addr, int port) { return Query(Type::Info, addr, port); }
+	inline bool QueryRules(unsigned long addr, int port) { return Query(Type::Rules, addr, port); }
+
+	/**
+	 * Takes the next finished query.
+	 * @returns false if there is none.
+	 */
+	bool GetResult(Result &result);
+
+private:
+	using Clock = std::chrono::steady_clock;
+
+	struct Request
+	{
+		Type type = Type::Info;
+		unsigned long addr = 0;
+		int port = 0;
+		Clock::time_point time;
+	};
+
+	struct Pending
+	{
+		Type type;
+		unsigned long addr;
+		int port;
+		Clock::time_point time; //!< Time of the first request, for the timeout
+		Clock::time_point sendTime; //!< Time of the last request, for the RTT
+		int challenge = -1;
+		CNetSplitPacket response;
+	};
+
+	NetSocket m_Socket = 0;
+	std::thread m_WorkerThread;
+	std::atomic<bool> m_bShutdown { false };
+	CNetSpscQueue<Request, QUEUE_SIZE> m_Requests; // Game thread to worker
+	CNetSpscQueue<Result, QUEUE_SIZE> m_Results; // Worker to game thread
+
+	// Owned by the worker
+	std::unordered_map<uint64_t, Pending> m_Pending;
+	Clock::time_point m_NextTimeoutCheck;
+
+	static uint64_t GetKey(Type type, unsigned long addr, int port);
+	static int MakeRequest(Type type, int challenge, char *buf);
+
+	void WorkerThreadFunc() noexcept;
+	void TakeRequests();
+	void ProcessPacket(unsigned long addr, int port, const char *packet, int len);
+	void ProcessChallenge(unsigned long addr, int port, int challenge);
+	void ProcessBroadcastAnswer(unsigned long addr, int port, const char *packet, int len);
+	void CheckTimeouts(Clock::time_point now);
+};
+
+#endif
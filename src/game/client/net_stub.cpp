@@ -40,7 +40,22 @@ void NetCloseSocket(NetSocket s)
 {
 }
 
-char *NetGetRuleValueFromBuffer(const char *buffer, int len, const char *cvar)
+NetSocket NetOpenUdpSocket(int port, bool broadcast)
 {
-	return nullptr;
+	return 0;
+}
+
+int NetGetSocketPort(NetSocket s)
+{
+	return 0;
+}
+
+int NetWaitReceiveUdp(NetSocket s, char *recvbuf, int size, unsigned long *from_addr, int *from_port, int timeoutMs)
+{
+	return -1;
+}
+
+bool NetStringToAddr(const char *str, unsigned long *addr, int *port, int defaultPort)
+{
+	return false;
 }
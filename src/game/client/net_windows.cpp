@@ -7,6 +7,7 @@
 ****/
 
 #include <windows.h>
+#include <stdlib.h>
 #include <time.h>
 #include "net.h"
 
@@ -134,10 +135,19 @@ int NetSendUdp(unsigned long sin_addr, int sin_port, const char *sendbuf, int le
 
 	// Create or get a socket for sending data
 	SOCKET s1;
+	bool created = false;
 	if (s && *s)
+	{
 		s1 = SocketConvert(*s);
+	}
 	else
+	{
+		// Socket is made nonblocking once, NetReceiveUdp relies on it
 		s1 = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+		unsigned long nonzero = 1;
+		ioctlsocket(s1, FIONBIO, &nonzero);
+		created = true;
+	}
 
 	struct sockaddr_in addr;
 	memset(&addr, 0, sizeof(struct sockaddr_in));
@@ -148,10 +158,10 @@ int NetSendUdp(unsigned long sin_addr, int sin_port, const char *sendbuf, int le
 	// Send buffer
 	int res = sendto(s1, sendbuf, len, 0, (struct sockaddr *)&addr, sizeof(struct sockaddr_in));
 
-	// Return socket if send was succeded
+	// Return socket if send was succeded, caller's socket is never closed
 	if (res != SOCKET_ERROR && s)
 		*s = SocketConvert(s1);
-	else
+	else if (created)
 		closesocket(s1);
 
 	return res;
@@ -173,35 +183,14 @@ int NetReceiveUdp(unsigned long sin_addr, int sin_port, char *recvbuf, int size,
 	addr.sin_addr.s_addr = sin_addr;
 	addr.sin_port = sin_port;
 
-	// Try to receive response
-	int res;
-	unsigned long nonzero = 1;
-	ioctlsocket(s, FIONBIO, &nonzero);
-	SOCKET maxfd;
-	fd_set rfd;
-	fd_set efd;
-	struct timeval tv;
-
-	// Do select on socket
-	FD_ZERO(&rfd);
-	FD_ZERO(&efd);
-	FD_SET(s, &rfd);
-	FD_SET(s, &efd);
-	maxfd = s;
-	tv.tv_sec = 0;
-	tv.tv_usec = 0;
-	res = select(maxfd + 1, &rfd, NULL, &efd, &tv);
-	// Check for error on socket
-	if (res == SOCKET_ERROR || FD_ISSET(s, &efd))
-		return -1;
+	// Socket is nonblocking, so just try to receive
+	int fromaddrlen = sizeof(struct sockaddr_in);
+	int res = recvfrom(s, recvbuf, size, 0, (struct sockaddr *)&fromaddr, &fromaddrlen);
 	// Return if nothing to receive
-	if (res == 0)
+	if (res == SOCKET_ERROR && WSAGetLastError() == WSAEWOULDBLOCK)
 		return 0;
-	// Get what we had received
-	int fromaddrlen = sizeof(struct sockaddr_in);
-	res = recvfrom(s, recvbuf, size, 0, (struct sockaddr *)&fromaddr, &fromaddrlen);
 	// Check for error on socket
-	if (res == SOCKET_ERROR && WSAGetLastError() != WSAEWOULDBLOCK)
+	if (res == SOCKET_ERROR)
 		return -1;
 	// Check address from which data came
 	if (res >= 0 && (addr.sin_addr.s_addr == 0 && addr.sin_port == 0) || (addr.sin_addr.s_addr == fromaddr.sin_addr.s_addr && addr.sin_port == fromaddr.sin_port))
@@ -227,28 +216,116 @@ void NetCloseSocket(NetSocket s)
 	closesocket(SocketConvert(s));
 }
 
-char *NetGetRuleValueFromBuffer(const char *buffer, int len, const char *cvar)
+NetSocket NetOpenUdpSocket(int port, bool broadcast)
 {
-	// Check response header
-	if (len < 6 || (*(unsigned int *)buffer != 0xFFFFFFFF || buffer[4] != 'E'))
-		return NULL;
-	// Search for a cvar
-	char *current = (char *)buffer + 4;
-	char *end = (char *)buffer + len - strlen(cvar);
-	while (current < end)
+	if (!g_bInitialised)
+		WinsockInit();
+	if (g_bFailedInitialization)
+		return 0;
+
+	SOCKET s = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+	if (s == INVALID_SOCKET)
+		return 0;
+
+	struct sockaddr_in addr;
+	memset(&addr, 0, sizeof(struct sockaddr_in));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = INADDR_ANY;
+	addr.sin_port = htons((unsigned short)port);
+
+	unsigned long nonzero = 1;
+	if (bind(s, (struct sockaddr *)&addr, sizeof(struct sockaddr_in)) == SOCKET_ERROR || ioctlsocket(s, FIONBIO, &nonzero) == SOCKET_ERROR)
 	{
-		char *pcvar = (char *)cvar;
-		while (*current == *pcvar && *pcvar != 0)
-		{
-			current++;
-			pcvar++;
-		}
-		if (*pcvar == 0)
-		{
-			// Found
-			return current + 1;
-		}
-		current++;
+		closesocket(s);
+		return 0;
 	}
-	return NULL;
+
+	// Many servers may answer at once, ask for a larger buffer
+	int rcvbuf = 1024 * 1024;
+	setsockopt(s, SOL_SOCKET, SO_RCVBUF, (const char *)&rcvbuf, sizeof(rcvbuf));
+
+	BOOL enable = TRUE;
+	if (broadcast && setsockopt(s, SOL_SOCKET, SO_BROADCAST, (const char *)&enable, sizeof(enable)) == SOCKET_ERROR)
+	{
+		closesocket(s);
+		return 0;
+	}
+
+	return SocketConvert(s);
+}
+
+int NetGetSocketPort(NetSocket s)
+{
+	struct sockaddr_in addr;
+	int addrlen = sizeof(struct sockaddr_in);
+	if (!s || getsockname(SocketConvert(s), (struct sockaddr *)&addr, &addrlen) == SOCKET_ERROR)
+		return 0;
+	return ntohs(addr.sin_port);
+}
+
+int NetWaitReceiveUdp(NetSocket ns, char *recvbuf, int size, unsigned long *from_addr, int *from_port, int timeoutMs)
+{
+	if (!ns)
+		return -1;
+
+	SOCKET s = SocketConvert(ns);
+	struct sockaddr_in fromaddr;
+	int fromaddrlen = sizeof(struct sockaddr_in);
+
+	// Try the socket first, select is only needed when it's empty
+	int res = recvfrom(s, recvbuf, size, 0, (struct sockaddr *)&fromaddr, &fromaddrlen);
+	if (res == SOCKET_ERROR && WSAGetLastError() == WSAEWOULDBLOCK)
+	{
+		fd_set rfd;
+		FD_ZERO(&rfd);
+		FD_SET(s, &rfd);
+		struct timeval tv;
+		tv.tv_sec = timeoutMs / 1000;
+		tv.tv_usec = (timeoutMs % 1000) * 1000;
+		res = select(0, &rfd, NULL, NULL, &tv);
+		if (res <= 0)
+			return res == 0 ? 0 : -1;
+
+		fromaddrlen = sizeof(struct sockaddr_in);
+		res = recvfrom(s, recvbuf, size, 0, (struct sockaddr *)&fromaddr, &fromaddrlen);
+	}
+	if (res == SOCKET_ERROR)
+	{
+		// ICMP port unreachable from an earlier send is reported as a reset, it's not an error of this socket
+		int error = WSAGetLastError();
+		return error == WSAEWOULDBLOCK || error == WSAECONNRESET ? 0 : -1;
+	}
+
+	*from_addr = fromaddr.sin_addr.s_addr;
+	*from_port = fromaddr.sin_port;
+	return res;
+}
+
+bool NetStringToAddr(const char *str, unsigned long *addr, int *port, int defaultPort)
+{
+	char host[32];
+	const char *colon = strchr(str, ':');
+	size_t len = colon ? colon - str : strlen(str);
+	if (len == 0 || len >= sizeof(host))
+		return false;
+	memcpy(host, str, len);
+	host[len] = 0;
+
+	// Only dotted addresses, name resolution would block
+	unsigned long a = inet_addr(host);
+	if (a == INADDR_NONE && strcmp(host, "255.255.255.255"))
+		return false;
+
+	int p = defaultPort;
+	if (colon)
+	{
+		char *end;
+		p = strtol(colon + 1, &end, 10);
+		if (*end || p <= 0 || p > 65535)
+			return false;
+	}
+
+	*addr = a;
+	*port = htons((unsigned short)p);
+	return true;
 }
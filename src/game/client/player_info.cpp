@@ -1,5 +1,9 @@
 #include <map>
 #include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 #include <FileSystem.h>
 #include <tier1/strtools.h>
 #include "hud.h"
@@ -7,10 +11,10 @@
 #include "player_info.h"
 #include "com_model.h"
 #include "engine_patches.h"
-#include "vgui/client_viewport.h"
-#include "vgui/score_panel.h"
+#include "svc_messages.h"
 
 CPlayerInfo CPlayerInfo::m_sPlayerInfo[MAX_PLAYERS + 1];
+unsigned CPlayerInfo::s_uSnapshotId = 1;
 static CPlayerInfo *s_ThisPlayerInfo = nullptr;
 
 namespace
@@ -18,6 +22,13 @@ namespace
 
 std::map<uint64_t, std::string> s_RealNames;
 
+// Name -> slot index. Keys point to CPlayerInfo::m_szIndexedName.
+std::unordered_map<std::string_view, int> s_NameIndex;
+bool s_bNameIndexDirty = true;
+
+std::vector<std::pair<int, CPlayerInfo::ChangeListener>> s_ChangeListeners;
+int s_iNextListenerId = 1;
+
 // UTF-friendly version instead of platform-specific ones
 bool IsSpace(char c)
 {
@@ -367,9 +378,111 @@ const char *CPlayerInfo::GetSteamID()
 	return m_szSteamID;
 }
 
+int CPlayerInfo::AddChangeListener(const ChangeListener &listener)
+{
+	int id = s_iNextListenerId++;
+	s_ChangeListeners.emplace_back(id, listener);
+	return id;
+}
+
+void CPlayerInfo::RemoveChangeListener(int id)
+{
+	for (auto it = s_ChangeListeners.begin(); it != s_ChangeListeners.end(); ++it)
+	{
+		if (it->first == id)
+		{
+			s_ChangeListeners.erase(it);
+			return;
+		}
+	}
+}
+
+void CPlayerInfo::UpdateAll()
+{
+	InvalidateAll();
+
+	for (int i = 1; i <= MAX_PLAYERS; i++)
+		GetPlayerInfo(i)->Refresh();
+
+	for (int i = 1; i <= MAX_PLAYERS; i++)
+	{
+		CPlayerInfo *pi = GetPlayerInfo(i);
+		unsigned fields = pi->m_uChangedFields;
+
+		if (fields == 0)
+			continue;
+
+		// Listener may mark new changes, they will be passed next frame
+		pi->m_uChangedFields = 0;
+
+		for (auto &listener : s_ChangeListeners)
+			listener.second(pi, fields);
+	}
+}
+
+void CPlayerInfo::InvalidateAll()
+{
+	s_uSnapshotId++;
+}
+
+CPlayerInfo *CPlayerInfo::FindByName(const char *name)
+{
+	if (s_bNameIndexDirty)
+	{
+		s_NameIndex.clear();
+
+		for (int i = 1; i <= MAX_PLAYERS; i++)
+		{
+			CPlayerInfo *pi = GetPlayerInfo(i);
+			pi->ReadIndexedName();
+
+			// Lowest slot wins if names are the same
+			if (pi->m_szIndexedName[0])
+				s_NameIndex.emplace(pi->m_szIndexedName, i);
+		}
+
+		s_bNameIndexDirty = false;
+	}
+
+	auto it = s_NameIndex.find(name);
+
+	if (it == s_NameIndex.end())
+		return nullptr;
+
+	return GetPlayerInfo(it->second);
+}
+
+void CPlayerInfo::UpdateNameIndex(int idx)
+{
+	// Will be rebuilt on next lookup
+	if (s_bNameIndexDirty)
+		return;
+
+	CPlayerInfo *pi = GetPlayerInfo(idx);
+	pi->RemoveFromNameIndex();
+	pi->ReadIndexedName();
+	pi->AddToNameIndex();
+}
+
 CPlayerInfo *CPlayerInfo::Update()
 {
+	if (m_uSnapshotId != s_uSnapshotId)
+		Refresh();
+
+	return this;
+}
+
+void CPlayerInfo::MarkChanged(unsigned fields)
+{
+	m_uChangedFields |= fields;
+}
+
+void CPlayerInfo::Refresh()
+{
+	hud_player_info_t oldInfo = m_EngineInfo;
 	gEngfuncs.pfnGetPlayerInfo(m_iIndex, &m_EngineInfo);
+	m_uSnapshotId = s_uSnapshotId;
+
 	bool bWasConnected = m_bIsConnected;
 	bool bIsConnected = m_EngineInfo.name != nullptr;
 	m_bIsConnected = bIsConnected;
@@ -382,44 +495,119 @@ CPlayerInfo *CPlayerInfo::Update()
 		m_bRealNameChecked = false;
 		m_iStatusPenalty = 0;
 		m_flLastStatusRequest = 0;
-		g_pViewport->GetScoreBoard()->UpdateOnPlayerInfo(GetIndex());
+		m_uChangedFields |= CHANGED_CONNECTED;
+	}
+
+	if (!bIsConnected)
+	{
+		m_szSnapshotName[0] = '\0';
+		return;
+	}
+
+	if (strncmp(m_szSnapshotName, m_EngineInfo.name, MAX_PLAYER_NAME))
+	{
+		Q_strncpy(m_szSnapshotName, m_EngineInfo.name, sizeof(m_szSnapshotName));
+		m_uChangedFields |= CHANGED_NAME;
 	}
 
-	if (bIsConnected)
+	if (bWasConnected)
 	{
-		if (!m_szSteamID[0])
+		if (m_EngineInfo.ping != oldInfo.ping || m_EngineInfo.packetloss != oldInfo.packetloss)
+			m_uChangedFields |= CHANGED_PING;
+
+		if (m_EngineInfo.topcolor != oldInfo.topcolor || m_EngineInfo.bottomcolor != oldInfo.bottomcolor)
+			m_uChangedFields |= CHANGED_COLOR;
+	}
+
+	if (m_ExtraInfo.teamnumber != m_iSnapshotTeam)
+	{
+		m_iSnapshotTeam = m_ExtraInfo.teamnumber;
+		m_uChangedFields |= CHANGED_TEAM;
+	}
+
+	if (!m_szSteamID[0])
+	{
+		// Player has no SteamID, update it
+		float period = (m_iStatusPenalty < STATUS_PENALTY_THRESHOLD) ? STATUS_PERIOD : STATUS_BUGGED_PERIOD;
+		if (m_flLastStatusRequest + period < gEngfuncs.GetAbsoluteTime())
 		{
-			// Player has no SteamID, update it
-			float period = (m_iStatusPenalty < STATUS_PENALTY_THRESHOLD) ? STATUS_PERIOD : STATUS_BUGGED_PERIOD;
-			if (m_flLastStatusRequest + period < gEngfuncs.GetAbsoluteTime())
-			{
-				CSvcMessages::Get().SendStatusRequest();
-				m_flLastStatusRequest = gEngfuncs.GetAbsoluteTime();
-			}
+			CSvcMessages::Get().SendStatusRequest();
+			m_flLastStatusRequest = gEngfuncs.GetAbsoluteTime();
 		}
+	}
 
-		if (!m_bRealNameChecked && m_szSteamID[0])
+	if (!m_bRealNameChecked && m_szSteamID[0])
+	{
+		m_bRealNameChecked = true;
+
+		if (!s_RealNames.empty())
 		{
-			m_bRealNameChecked = true;
+			// Find real name
+			uint64_t steamid64 = GetStatusSteamID64();
+			auto it = s_RealNames.find(steamid64);
 
-			if (!s_RealNames.empty())
+			if (it != s_RealNames.end())
 			{
-				// Find real name
-				uint64_t steamid64 = GetStatusSteamID64();
-				auto it = s_RealNames.find(steamid64);
-
-				if (it != s_RealNames.end())
-				{
-					Q_strncpy(m_szRealName, it->second.c_str(), sizeof(m_szRealName));
-				}
+				Q_strncpy(m_szRealName, it->second.c_str(), sizeof(m_szRealName));
+				m_uChangedFields |= CHANGED_NAME;
 			}
 		}
+	}
 
-		if (IsThisPlayer())
-			s_ThisPlayerInfo = this;
+	if (IsThisPlayer())
+		s_ThisPlayerInfo = this;
+}
+
+void CPlayerInfo::ReadIndexedName()
+{
+	// Only reads the engine, Refresh may send a status request
+	hud_player_info_t info = {};
+	gEngfuncs.pfnGetPlayerInfo(m_iIndex, &info);
+	Q_strncpy(m_szIndexedName, info.name ? info.name : "", sizeof(m_szIndexedName));
+}
+
+void CPlayerInfo::AddToNameIndex()
+{
+	if (!m_szIndexedName[0])
+		return;
+
+	auto it = s_NameIndex.find(m_szIndexedName);
+
+	if (it == s_NameIndex.end())
+	{
+		s_NameIndex.emplace(m_szIndexedName, m_iIndex);
 	}
+	else if (it->second > m_iIndex)
+	{
+		// Lowest slot wins if names are the same. Key must point to this player's name.
+		s_NameIndex.erase(it);
+		s_NameIndex.emplace(m_szIndexedName, m_iIndex);
+	}
+}
 
-	return this;
+void CPlayerInfo::RemoveFromNameIndex()
+{
+	if (!m_szIndexedName[0])
+		return;
+
+	auto it = s_NameIndex.find(m_szIndexedName);
+
+	if (it == s_NameIndex.end() || it->second != m_iIndex)
+		return;
+
+	s_NameIndex.erase(it);
+
+	// Next player with the same name takes the entry
+	for (int i = m_iIndex + 1; i <= MAX_PLAYERS; i++)
+	{
+		CPlayerInfo *pi = GetPlayerInfo(i);
+
+		if (!strcmp(pi->m_szIndexedName, m_szIndexedName))
+		{
+			s_NameIndex.emplace(pi->m_szIndexedName, i);
+			break;
+		}
+	}
 }
 
 bool CPlayerInfo::HasRealName()
@@ -429,6 +617,9 @@ bool CPlayerInfo::HasRealName()
 
 void CPlayerInfo::ClearRealName()
 {
+	if (m_szRealName[0])
+		m_uChangedFields |= CHANGED_NAME;
+
 	m_szRealName[0] = '\0';
 	m_bRealNameChecked = false;
 }
@@ -449,6 +640,12 @@ void CPlayerInfo::Reset()
 	m_bIsConnected = false;
 	m_bIsSpectator = false;
 	m_szSteamID[0] = '\0';
+	m_uSnapshotId = 0;
+	m_uChangedFields = 0;
+	m_szSnapshotName[0] = '\0';
+	m_iSnapshotTeam = 0;
+	m_szIndexedName[0] = '\0';
+	s_bNameIndexDirty = true;
 }
 
 //-----------------------------------------------------
@@ -14,6 +14,7 @@
 ****/
 #ifndef PLAYER_INFO_H
 #define PLAYER_INFO_H
+#include <functional>
 #include <tier0/dbg.h>
 
 typedef struct player_info_s player_info_t;
@@ -44,6 +45,63 @@ CPlayerInfo *GetPlayerInfoSafe(int idx);
 class CPlayerInfo
 {
 public:
+	/**
+	 * Bits passed to change listeners.
+	 */
+	enum ChangedFields : unsigned
+	{
+		CHANGED_CONNECTED = 1 << 0, //!< Player connected or disconnected
+		CHANGED_NAME = 1 << 1,
+		CHANGED_PING = 1 << 2, //!< Ping or packet loss
+		CHANGED_COLOR = 1 << 3, //!< Top or bottom color
+		CHANGED_TEAM = 1 << 4, //!< Team number or team name
+		CHANGED_SCORE = 1 << 5, //!< Frags, deaths or class
+		CHANGED_STEAMID = 1 << 6, //!< SteamID received from status
+	};
+
+	/**
+	 * Called once per frame for every player whose info has changed.
+	 * @param	pi		The player.
+	 * @param	fields	ChangedFields bits.
+	 */
+	using ChangeListener = std::function<void(CPlayerInfo *pi, unsigned fields)>;
+
+	/**
+	 * Registers a change listener.
+	 * @returns ID for RemoveChangeListener.
+	 */
+	static int AddChangeListener(const ChangeListener &listener);
+
+	/**
+	 * Unregisters a change listener.
+	 */
+	static void RemoveChangeListener(int id);
+
+	/**
+	 * Takes a new snapshot of all players and calls change listeners.
+	 * Called once per frame.
+	 */
+	static void UpdateAll();
+
+	/**
+	 * Marks the snapshot as outdated. Next Update will query the engine again.
+	 * Called when the engine receives new user info.
+	 */
+	static void InvalidateAll();
+
+	/**
+	 * Finds a connected player by name (as returned by GetName).
+	 * Uses the name index, doesn't refresh player snapshots.
+	 * @returns Player info or nullptr.
+	 */
+	static CPlayerInfo *FindByName(const char *name);
+
+	/**
+	 * Updates the name index entry of a player from engine info.
+	 * Called when the engine receives new user info of the player.
+	 */
+	static void UpdateNameIndex(int idx);
+
 	int GetIndex();
 	bool IsConnected();
 
@@ -79,9 +137,16 @@ public:
 	const char *GetSteamID();
 
 	// Should be called before reading engine info.
+	// Only queries the engine once per snapshot.
 	// Returns this
 	CPlayerInfo *Update();
 
+	/**
+	 * Marks fields as changed. Listeners will be called on next UpdateAll.
+	 * @param	fields	ChangedFields bits.
+	 */
+	void MarkChanged(unsigned fields);
+
 	/**
 	 * Returns whether the player has a real name.
 	 */
@@ -113,9 +178,33 @@ private:
 	int m_iStatusPenalty; //!< This var is incremented every time player is not found in status output
 	float m_flLastStatusRequest = 0;
 
+	// Snapshot state
+	unsigned m_uSnapshotId = 0; //!< Equals s_uSnapshotId if engine info is up to date
+	unsigned m_uChangedFields = 0; //!< ChangedFields not yet passed to listeners
+	char m_szSnapshotName[MAX_PLAYER_NAME + 1] = {}; //!< Copy of the name, engine info only has a pointer
+	int m_iSnapshotTeam = 0;
+
+	char m_szIndexedName[MAX_PLAYER_NAME + 1] = {}; //!< Name in the name index, empty if not indexed
+
+	static unsigned s_uSnapshotId;
+
 	player_info_t *GetEnginePlayerInfo();
 	void Reset();
 
+	/**
+	 * Queries the engine and updates changed fields.
+	 */
+	void Refresh();
+
+	/**
+	 * Copies the name from the engine into m_szIndexedName.
+	 * Unlike Refresh, never sends a status request.
+	 */
+	void ReadIndexedName();
+
+	void AddToNameIndex();
+	void RemoveFromNameIndex();
+
 	static CPlayerInfo m_sPlayerInfo[MAX_PLAYERS + 1];
 	friend CPlayerInfo *GetPlayerInfo(int idx);
 	friend class CHud;
@@ -0,0 +1,67 @@
+#include <cstring>
+#include <pcre.h>
+#include "regex_filter.h"
+
+CRegexFilter::~CRegexFilter()
+{
+	Free();
+}
+
+bool CRegexFilter::SetPattern(const char *pattern)
+{
+	if (m_Pattern == pattern)
+		return m_Error.empty();
+
+	Free();
+	m_Pattern = pattern;
+	m_Error.clear();
+
+	if (pattern[0] == 0)
+		return true;
+
+	const char *error;
+	int erroffset;
+
+	m_pRegex = pcre_compile(pattern, PCRE_CASELESS, &error, &erroffset, nullptr);
+	m_Stats.compiles++;
+
+	if (!m_pRegex)
+	{
+		m_Error = "offset " + std::to_string(erroffset) + ": " + error;
+		return false;
+	}
+
+	return true;
+}
+
+bool CRegexFilter::Match(const char *str, size_t len)
+{
+	if (!m_pRegex)
+		return false;
+
+	int ovector[30];
+	int rc = pcre_exec((const pcre *)m_pRegex, nullptr, str, (int)len, 0, 0, ovector, sizeof(ovector) / sizeof(ovector[0]));
+
+	m_Stats.checks++;
+
+	if (rc < 0)
+		return false; // No match
+
+	m_Stats.matches++;
+	return true;
+}
+
+void CRegexFilter::ResetStats()
+{
+	m_Stats.checks = 0;
+	m_Stats.matches = 0;
+}
+
+void CRegexFilter::Free()
+{
+	if (m_pRegex)
+	{
+		pcre_free(m_pRegex);
+		m_pRegex = nullptr;
+	}
+}
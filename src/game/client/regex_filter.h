@@ -0,0 +1,84 @@
+//
+// regex_filter.h
+//
+// Precompiled regular expressions for command and cvar filtering.
+//
+#ifndef REGEX_FILTER_H
+#define REGEX_FILTER_H
+#include <cstddef>
+#include <cstring>
+#include <string>
+
+/**
+ * A case-insensitive PCRE pattern that is compiled once and reused.
+ * The pattern is only recompiled when it changes.
+ */
+class CRegexFilter
+{
+public:
+	struct Stats
+	{
+		unsigned compiles = 0; //!< Number of times the pattern was compiled
+		unsigned checks = 0; //!< Number of Match calls with a valid pattern
+		unsigned matches = 0; //!< Number of successful matches
+	};
+
+	CRegexFilter() = default;
+	CRegexFilter(const CRegexFilter &) = delete;
+	~CRegexFilter();
+
+	CRegexFilter &operator=(const CRegexFilter &) = delete;
+
+	/**
+	 * Sets the pattern. Does nothing if it didn't change.
+	 * @param	pattern	Regular expression. Empty pattern doesn't match anything.
+	 * @returns false if pattern was changed and failed to compile. See GetError.
+	 */
+	bool SetPattern(const char *pattern);
+
+	/**
+	 * Returns whether string matches the pattern.
+	 * Always false if pattern is empty or invalid.
+	 */
+	bool Match(const char *str, size_t len);
+
+	/**
+	 * Returns whether string matches the pattern.
+	 */
+	inline bool Match(const char *str) { return Match(str, strlen(str)); }
+
+	/**
+	 * Returns current pattern.
+	 */
+	inline const char *GetPattern() const { return m_Pattern.c_str(); }
+
+	/**
+	 * Returns whether pattern is set and compiled successfully.
+	 */
+	inline bool IsValid() const { return m_pRegex != nullptr; }
+
+	/**
+	 * Returns compilation error of the last SetPattern call.
+	 */
+	inline const char *GetError() const { return m_Error.c_str(); }
+
+	/**
+	 * Returns match counters.
+	 */
+	inline const Stats &GetStats() const { return m_Stats; }
+
+	/**
+	 * Resets match counters. Compile counter is kept.
+	 */
+	void ResetStats();
+
+private:
+	void *m_pRegex = nullptr; // pcre *
+	std::string m_Pattern;
+	std::string m_Error;
+	Stats m_Stats;
+
+	void Free();
+};
+
+#endif
@@ -9,6 +9,7 @@
 // Functions for storing game results files.
 //
 
+#include <algorithm>
 #include <ctime>
 
 #ifdef PLATFORM_WINDOWS
@@ -37,10 +38,28 @@ static CResults s_Results;
 // <map> will be replaced with mapname
 static constexpr char FILENAME_FORMAT[] = "results/%Y-%m/<map>-%Y%m%d-%H%M%S";
 
+// Catalog of automatically recorded demos and the text list it replaced, in gamedir
+static constexpr char DEMO_CATALOG_NAME[] = "demolist.bin";
+static constexpr char OLD_DEMO_LIST_NAME[] = "tempdemolist.txt";
+
+// Newest demos printed by results_demo_list
+static constexpr size_t MAX_LISTED_DEMOS = 50;
+
 static ConVar results_demo_autorecord("results_demo_autorecord", "0", FCVAR_BHL_ARCHIVE, "Record demos when joining a server");
 static ConVar results_demo_keepdays("results_demo_keepdays", "14", FCVAR_BHL_ARCHIVE, "Days to keep automatically recorded demos");
+static ConVar results_demo_maxgb("results_demo_maxgb", "0", FCVAR_BHL_ARCHIVE, "Max size of automatically recorded demos in GB, oldest are removed over it. 0 for no limit");
 static ConVar results_log_chat("results_log_chat", "0", FCVAR_BHL_ARCHIVE, "Enable chat logging into a file");
 static ConVar results_log_other("results_log_other", "0", FCVAR_BHL_ARCHIVE, "Enable other messages (like kill messages and others in the console) logging into a file");
+
+CON_COMMAND(results_log_stats, "Prints statistics of results log writing")
+{
+	CResults::Get().PrintLogStats();
+}
+
+CON_COMMAND(results_demo_list, "Lists automatically recorded demos. Usage: results_demo_list [map]")
+{
+	CResults::Get().PrintDemoList(gEngfuncs.Cmd_Argc() >= 2 ? gEngfuncs.Cmd_Argv(1) : nullptr);
+}
 #endif
 
 CResults &CResults::Get()
@@ -85,8 +104,10 @@ void CResults::Init()
 
 	m_fsFullGameDirPath = std::filesystem::u8path(m_szFullGameDirPath);
 
-	// Get temporary demos file list name and purge old demos
-	snprintf(m_szTempDemoList, sizeof(m_szTempDemoList), "%stempdemolist.txt", m_szFullGameDirPath);
+	// Load the demo list and purge old demos
+	if (!m_DemoCatalog.Open(m_szFullGameDirPath, DEMO_CATALOG_NAME, OLD_DEMO_LIST_NAME))
+		ConPrintf(ConColor::Red, "Results: %s is damaged, demos after the damage won't be purged.\n", DEMO_CATALOG_NAME);
+
 	PurgeDemos();
 #endif
 }
@@ -120,8 +141,27 @@ void CResults::Frame()
 		else if (!gEngfuncs.pDemoAPI->IsRecording())
 		{
 			m_bDemoRecording = false;
+			m_uStoppedDemoId = m_uCurrentDemoId;
 		}
 	}
+
+	// Demo file is complete when the engine stops recording
+	if (m_uStoppedDemoId != 0 && !gEngfuncs.pDemoAPI->IsRecording())
+	{
+		m_DemoCatalog.FinishDemo(m_uStoppedDemoId, GetDemoPurgePolicy());
+		m_uStoppedDemoId = 0;
+	}
+
+	CDemoCatalog::PurgeResult purgeResult;
+
+	if (m_DemoCatalog.TakePurgeResult(purgeResult))
+	{
+		for (const std::string &error : purgeResult.errors)
+			ConPrintf(ConColor::Red, "Results: %s.\n", error.c_str());
+
+		if (purgeResult.removedCount > 0)
+			gEngfuncs.Con_DPrintf("Results: Removed %d old demos, %.1f MB.\n", purgeResult.removedCount, purgeResult.removedBytes / (1024.0 * 1024.0));
+	}
 #endif
 }
 
@@ -154,14 +194,64 @@ void CResults::AddLog(const char *text, bool chat)
 		return;
 
 	// Open log file in case it is not already
-	if (!m_pLogFile)
-		m_pLogFile = fopen(m_szCurrentResultsLog, "a");
-	if (!m_pLogFile)
-		return;
+	if (!m_LogWriter.IsOpen())
+	{
+		if (m_szCurrentResultsLog[0] == '\0')
+			return;
 
-	int len = strlen(text);
-	fprintf(m_pLogFile, "%s", text);
-	fflush(m_pLogFile);
+		m_LogWriter.Open(m_szCurrentResultsLog);
+	}
+
+	// Written to the file in the background
+	m_LogWriter.Write(text);
+#endif
+}
+
+void CResults::Shutdown()
+{
+#if HAS_STD_FILESYSTEM
+	Stop();
+	m_LogWriter.Shutdown();
+	m_DemoCatalog.Shutdown();
+#endif
+}
+
+void CResults::PrintLogStats()
+{
+#if HAS_STD_FILESYSTEM
+	CAsyncLogWriter::Stats stats = m_LogWriter.GetStats();
+
+	ConPrintf("Log file: %s\n", m_LogWriter.IsOpen() ? m_szCurrentResultsLog : "not open");
+	ConPrintf("Written: %llu lines, %llu bytes in %llu batches\n", (unsigned long long)stats.writtenLines, (unsigned long long)stats.writtenBytes, (unsigned long long)stats.batches);
+	ConPrintf("Dropped: %llu lines, %llu bytes\n", (unsigned long long)stats.droppedLines, (unsigned long long)stats.droppedBytes);
+	ConPrintf("Buffer: %u KiB, max usage %u KiB\n", (unsigned)(stats.bufferSize / 1024), (unsigned)(stats.maxUsage / 1024));
+#endif
+}
+
+void CResults::PrintDemoList(const char *mapFilter)
+{
+#if HAS_STD_FILESYSTEM
+	size_t matchCount;
+	std::vector<CDemoCatalog::Demo> demos = m_DemoCatalog.Find(mapFilter, MAX_LISTED_DEMOS, matchCount);
+
+	for (const CDemoCatalog::Demo &demo : demos)
+	{
+		char date[32] = "";
+		time_t t = (time_t)demo.time;
+		tm *pTm = localtime(&t);
+
+		if (pTm)
+			strftime(date, sizeof(date), "%Y-%m-%d %H:%M", pTm);
+
+		if (demo.size != 0)
+			ConPrintf("%s %8.1f MB  %-24s %s\n", date, demo.size / (1024.0 * 1024.0), demo.map.c_str(), demo.path.c_str());
+		else
+			ConPrintf("%s        ? MB  %-24s %s\n", date, demo.map.c_str(), demo.path.c_str());
+	}
+
+	CDemoCatalog::Stats stats = m_DemoCatalog.GetStats();
+	ConPrintf("%d of %d matching demos shown. Total: %d demos, %.1f MB%s.\n", (int)demos.size(), (int)matchCount,
+	    stats.count, stats.totalBytes / (1024.0 * 1024.0), stats.isPurging ? ", purging" : "");
 #endif
 }
 
@@ -190,9 +280,12 @@ void CResults::Stop()
 	CloseFiles();
 
 	// Stop demo recording if we started it
-	if (m_bDemoRecording && gEngfuncs.pDemoAPI->IsRecording())
+	if (m_bDemoRecording)
 	{
-		EngineClientCmd("stop\n");
+		if (gEngfuncs.pDemoAPI->IsRecording())
+			EngineClientCmd("stop\n");
+
+		m_uStoppedDemoId = m_uCurrentDemoId;
 	}
 
 	m_bDemoRecording = false;
@@ -206,10 +299,15 @@ void CResults::Stop()
 
 void CResults::CloseFiles()
 {
-	if (m_pLogFile)
+	// Writes the rest of the buffer
+	m_LogWriter.Close();
+
+	uint64_t droppedLines = m_LogWriter.GetStats().droppedLines;
+
+	if (droppedLines != m_uReportedDroppedLines)
 	{
-		fclose(m_pLogFile);
-		m_pLogFile = nullptr;
+		ConPrintf(ConColor::Red, "Results: %llu log lines were dropped because the disk was too slow.\n", (unsigned long long)(droppedLines - m_uReportedDroppedLines));
+		m_uReportedDroppedLines = droppedLines;
 	}
 }
 
@@ -230,98 +328,23 @@ void CResults::StartDemoRecording()
 	m_bDemoRecording = true;
 	m_bDemoRecordingFrame = 0;
 
-	// Write autodemo file name to the temporary list
-	FILE *file = fopen(m_szTempDemoList, "a+b");
-	if (file)
-	{
-		time_t now;
-		time(&now);
-		struct tm *current = localtime(&now);
-		snprintf(buf, sizeof(buf), "[%04i-%02i-%02i %02i:%02i:%02i] ", current->tm_year + 1900, current->tm_mon + 1, current->tm_mday, current->tm_hour, current->tm_min, current->tm_sec);
-		fprintf(file, "%s%s\r\n", buf, m_szCurrentResultsDemo);
-		fclose(file);
-	}
+	// Size and purging are handled by the catalog when recording is finished
+	if (m_szCurrentResultsDemo[0])
+		m_uCurrentDemoId = m_DemoCatalog.AddDemo(m_szCurrentResultsDemo, m_szCurrentMap, (int64_t)time(nullptr));
 }
 
 void CResults::PurgeDemos()
 {
-	char buf[512], fileName[MAX_PATH];
-	int readPos = 0, writePos = 0;
-	bool deleteRow = true;
-
-	time_t now;
-	time(&now);
-	now -= results_demo_keepdays.GetInt() * 24 * 60 * 60; // days to keep
-
-	FILE *file = fopen(m_szTempDemoList, "r+b");
-	if (file)
-	{
-		while (fgets(buf, sizeof(buf), file) != NULL)
-		{
-			deleteRow = true;
-			if (buf[0] == '[' && buf[20] == ']')
-			{
-				buf[20] = 0;
-				struct tm inTm;
-				memset(&inTm, 0, sizeof(inTm));
-				int scanResult = sscanf(buf + 1, "%4u-%2u-%2u %2u:%2u:%2u", &(inTm.tm_year), &(inTm.tm_mon), &(inTm.tm_mday), &(inTm.tm_hour), &(inTm.tm_min), &(inTm.tm_sec));
-				if (scanResult == 6)
-				{
-					inTm.tm_year -= 1900;
-					inTm.tm_mon -= 1;
-					time_t inTime = mktime(&inTm);
-					if (inTime < now)
-					{
-						char *fname = &buf[22];
-						int len = strlen(fname) - 1;
-						while (len >= 0 && fname[len] == '\r' || fname[len] == '\n')
-						{
-							fname[len--] = 0;
-						}
-						snprintf(fileName, sizeof(fileName), "%s%s", m_szFullGameDirPath, fname);
-						try
-						{
-							std::filesystem::remove(std::filesystem::u8path(fileName));
-						}
-						catch (const std::exception &e)
-						{
-							ConPrintf(ConColor::Red, "Results: Failed to remove file %s: %s.\n", fname, e.what());
-						}
-					}
-					else
-					{
-						deleteRow = false;
-					}
-				}
-			}
-
-			// Remove row
-			if (deleteRow)
-			{
-				readPos = ftell(file);
-				continue;
-			}
+	m_DemoCatalog.Purge(GetDemoPurgePolicy());
+}
 
-			// Place string back if we keep it
-			if (readPos != writePos)
-			{
-				buf[20] = ']';
-				readPos = ftell(file);
-				fseek(file, writePos, SEEK_SET);
-				fputs(buf, file);
-				writePos = ftell(file);
-				fseek(file, readPos, SEEK_SET);
-			}
-			else
-			{
-				readPos = ftell(file);
-				writePos = readPos;
-			}
-		}
-		fseek(file, writePos, SEEK_SET);
-		fclose(file);
-		std::filesystem::resize_file(std::filesystem::u8path(m_szTempDemoList), writePos);
-	}
+CDemoCatalog::PurgePolicy CResults::GetDemoPurgePolicy()
+{
+	CDemoCatalog::PurgePolicy policy;
+	policy.now = (int64_t)time(nullptr);
+	policy.keepDays = results_demo_keepdays.GetInt();
+	policy.maxBytes = (uint64_t)(std::max(0.0f, results_demo_maxgb.GetFloat()) * 1024 * 1024 * 1024);
+	return policy;
 }
 
 bool CResults::GetResultsFilename(const char *extension, char *filename, char *fullpath)
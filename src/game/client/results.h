@@ -14,6 +14,8 @@
 #include <filesystem>
 #endif
 #include <tier0/platform.h>
+#include "async_log_writer.h"
+#include "demo_catalog.h"
 
 class CResults
 {
@@ -52,6 +54,22 @@ public:
 	 */
 	void Stop();
 
+	/**
+	 * Stops results and the log writer thread.
+	 */
+	void Shutdown();
+
+	/**
+	 * Prints log writer counters to the console.
+	 */
+	void PrintLogStats();
+
+	/**
+	 * Prints the newest automatically recorded demos to the console.
+	 * @param	mapFilter	Substring of the map name, can be nullptr.
+	 */
+	void PrintDemoList(const char *mapFilter);
+
 private:
 #if HAS_STD_FILESYSTEM
 	// Contains path to gamedir with a trailing path separator
@@ -59,7 +77,6 @@ private:
 	char m_szFullGameDirPath[MAX_PATH] = "";
 	std::filesystem::path m_fsFullGameDirPath;
 
-	char m_szTempDemoList[MAX_PATH] = "";
 	char m_szCurrentResultsDemo[MAX_PATH] = "";
 	char m_szCurrentResultsLog[MAX_PATH] = "";
 	char m_szCurrentResultsStats[MAX_PATH] = "";
@@ -72,7 +89,12 @@ private:
 	bool m_bDemoRecordingStartIssued = false;
 	int m_bDemoRecordingFrame = 0;
 
-	FILE *m_pLogFile = nullptr;
+	CDemoCatalog m_DemoCatalog;
+	uint32_t m_uCurrentDemoId = 0;
+	uint32_t m_uStoppedDemoId = 0; //!< Finished in the catalog when the engine stops recording
+
+	CAsyncLogWriter m_LogWriter;
+	uint64_t m_uReportedDroppedLines = 0;
 
 	/**
 	 * Closes opened results files.
@@ -85,10 +107,15 @@ private:
 	void StartDemoRecording();
 
 	/**
-	 * Purges old demos.
+	 * Starts purging old demos in the background.
 	 */
 	void PurgeDemos();
 
+	/**
+	 * Returns the purge policy set by cvars.
+	 */
+	CDemoCatalog::PurgePolicy GetDemoPurgePolicy();
+
 	/**
 	 * Creates path to a file in results/<date>/<map>-<date and time>.<extension>
 	 * @param	extension	File extension.
@@ -0,0 +1,218 @@
+#include <cstdio>
+#include <cstring>
+#include "server_pinger.h"
+
+namespace
+{
+
+/**
+ * Formats an address in network byte order as a.b.c.d:port.
+ */
+std::string FormatAddress(unsigned long addr, int port)
+{
+	uint32_t addr32 = (uint32_t)addr;
+	uint16_t port16 = (uint16_t)port;
+	unsigned char a[4], p[2];
+	memcpy(a, &addr32, sizeof(a));
+	memcpy(p, &port16, sizeof(p));
+
+	char buf[32];
+	snprintf(buf, sizeof(buf), "%d.%d.%d.%d:%d", a[0], a[1], a[2], a[3], (p[0] << 8) | p[1]);
+	return buf;
+}
+
+/**
+ * Converts a port from host to network byte order.
+ */
+int ToNetPort(int port)
+{
+	const unsigned char p[2] = { (unsigned char)(port >> 8), (unsigned char)port };
+	uint16_t port16;
+	memcpy(&port16, p, sizeof(port16));
+	return port16;
+}
+
+}
+
+CServerPinger &CServerPinger::Get()
+{
+	static CServerPinger instance;
+	return instance;
+}
+
+bool CServerPinger::AddServer(const char *address)
+{
+	unsigned long addr;
+	int port;
+
+	if (!NetStringToAddr(address, &addr, &port, DEFAULT_PORT) || addr == NET_BROADCAST_ADDR)
+		return false;
+
+	FindOrAddServer(addr, port);
+	return true;
+}
+
+void CServerPinger::ClearServers()
+{
+	m_Query.Shutdown();
+	m_Servers.clear();
+	m_ServerIndex.clear();
+	m_SendQueue.clear();
+	m_uNextSend = 0;
+	m_iPendingCount = 0;
+	m_bIsRefreshing = false;
+}
+
+void CServerPinger::Refresh(bool queryRules, bool searchLan)
+{
+	// Results of the previous refresh are dropped with the pending queries
+	m_Query.Shutdown();
+
+	// LAN servers are found again
+	std::vector<Server> servers;
+	servers.swap(m_Servers);
+	m_ServerIndex.clear();
+
+	for (Server &i : servers)
+	{
+		if (!i.isLan)
+			FindOrAddServer(i.addr, i.port);
+	}
+
+	m_SendQueue.clear();
+
+	for (const Server &i : m_Servers)
+		m_SendQueue.push_back({ CNetQuery::Type::Info, i.addr, i.port });
+
+	if (queryRules)
+	{
+		for (const Server &i : m_Servers)
+			m_SendQueue.push_back({ CNetQuery::Type::Rules, i.addr, i.port });
+	}
+
+	if (searchLan)
+	{
+		for (int i = 0; i < LAN_PORT_COUNT; i++)
+			m_SendQueue.push_back({ CNetQuery::Type::Info, NET_BROADCAST_ADDR, ToNetPort(DEFAULT_PORT + i) });
+	}
+
+	m_uNextSend = 0;
+	m_iPendingCount = 0;
+	m_bIsRefreshing = true;
+}
+
+void CServerPinger::Update()
+{
+	if (!m_bIsRefreshing)
+		return;
+
+	// Requests are sent later if results may not fit into the queue,
+	// some space is left for answers to the broadcast
+	for (int i = 0; i < MAX_SENDS_PER_UPDATE && m_uNextSend < m_SendQueue.size() && m_iPendingCount < MAX_PENDING; i++)
+	{
+		const Send &send = m_SendQueue[m_uNextSend];
+
+		if (!m_Query.Query(send.type, send.addr, send.port))
+			break;
+
+		m_uNextSend++;
+		m_iPendingCount++;
+	}
+
+	CNetQuery::Result result;
+
+	while (m_Query.GetResult(result))
+		ProcessResult(result);
+
+	// Stop if the socket can't be opened, nothing will be sent
+	bool isFailed = !m_Query.IsStarted() && m_iPendingCount == 0;
+
+	if ((m_uNextSend == m_SendQueue.size() && m_iPendingCount == 0) || isFailed)
+	{
+		m_bIsRefreshing = false;
+		m_SendQueue.clear();
+		m_uNextSend = 0;
+
+		if (m_FinishedCallback)
+			m_FinishedCallback();
+	}
+}
+
+void CServerPinger::Shutdown()
+{
+	ClearServers();
+}
+
+uint64_t CServerPinger::GetKey(unsigned long addr, int port)
+{
+	return ((uint64_t)(addr & 0xFFFFFFFF) << 16) | (uint64_t)(port & 0xFFFF);
+}
+
+int CServerPinger::FindOrAddServer(unsigned long addr, int port)
+{
+	auto it = m_ServerIndex.find(GetKey(addr, port));
+
+	if (it != m_ServerIndex.end())
+		return it->second;
+
+	Server server;
+	server.address = FormatAddress(addr, port);
+	server.addr = addr;
+	server.port = port;
+	m_Servers.push_back(std::move(server));
+
+	int idx = (int)m_Servers.size() - 1;
+	m_ServerIndex[GetKey(addr, port)] = idx;
+	return idx;
+}
+
+void CServerPinger::ProcessResult(CNetQuery::Result &result)
+{
+	if (!result.isBroadcastAnswer)
+		m_iPendingCount--;
+
+	if (result.addr == NET_BROADCAST_ADDR)
+		return; // End of the LAN search
+
+	int idx;
+
+	if (result.isBroadcastAnswer)
+	{
+		bool isNew = m_ServerIndex.find(GetKey(result.addr, result.port)) == m_ServerIndex.end();
+		idx = FindOrAddServer(result.addr, result.port);
+
+		if (isNew)
+			m_Servers[idx].isLan = true;
+	}
+	else
+	{
+		auto it = m_ServerIndex.find(GetKey(result.addr, result.port));
+
+		if (it == m_ServerIndex.end())
+			return;
+
+		idx = it->second;
+	}
+
+	Server &server = m_Servers[idx];
+
+	if (result.type == CNetQuery::Type::Info)
+	{
+		if (result.isTimedOut)
+		{
+			// A broadcast answer may have come first
+			server.isTimedOut = !server.hasInfo;
+			return;
+		}
+
+		server.hasInfo = true;
+		server.isTimedOut = false;
+		server.ping = result.rtt;
+		server.info = std::move(result.info);
+	}
+	else if (!result.isTimedOut)
+	{
+		server.hasRules = true;
+		server.rules = std::move(result.rules);
+	}
+}
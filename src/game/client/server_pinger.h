@@ -0,0 +1,110 @@
+//
+// server_pinger.h
+//
+// Queries info and rules of many servers at once.
+//
+#ifndef SERVER_PINGER_H
+#define SERVER_PINGER_H
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "net_query.h"
+
+/**
+ * Server list pinger.
+ * All servers are queried concurrently through one CNetQuery. Requests over
+ * MAX_PENDING are sent on later updates, so results always fit into its queue. LAN servers are found by a broadcast.
+ * Must be used from one thread, results arrive in Update.
+ */
+class CServerPinger
+{
+public:
+	static constexpr int DEFAULT_PORT = 27015;
+	static constexpr int LAN_PORT_COUNT = 6; //!< Ports searched on LAN, starting with DEFAULT_PORT
+	static constexpr int MAX_SENDS_PER_UPDATE = 256;
+	static constexpr int MAX_PENDING = (int)CNetQuery::QUEUE_SIZE / 2;
+
+	struct Server
+	{
+		std::string address; //!< a.b.c.d:port
+		unsigned long addr = 0; //!< Network byte order
+		int port = 0; //!< Network byte order
+		bool isLan = false; //!< Found by the broadcast
+		bool hasInfo = false;
+		bool hasRules = false;
+		bool isTimedOut = false; //!< Info query timed out
+		float ping = 0; //!< Info RTT in seconds
+		CNetServerInfo info;
+		CNetRules rules;
+	};
+
+	static CServerPinger &Get();
+
+	/**
+	 * Adds a server to the list.
+	 * @param	address		a.b.c.d or a.b.c.d:port
+	 * @returns false if the address is invalid.
+	 */
+	bool AddServer(const char *address);
+
+	/**
+	 * Removes all servers. A running refresh is stopped.
+	 */
+	void ClearServers();
+
+	/**
+	 * Starts querying all servers. Previous results are dropped.
+	 * @param	queryRules	Whether rules are queried too.
+	 * @param	searchLan	Whether LAN servers are searched and added to the list.
+	 */
+	void Refresh(bool queryRules, bool searchLan);
+
+	/**
+	 * Sends waiting requests and takes results. Called every frame.
+	 */
+	void Update();
+
+	/**
+	 * Stops the query worker.
+	 */
+	void Shutdown();
+
+	inline bool IsRefreshing() const { return m_bIsRefreshing; }
+	inline int GetServerCount() const { return (int)m_Servers.size(); }
+	inline const Server &GetServer(int i) const { return m_Servers[i]; }
+
+	/**
+	 * Sets a function that is called from Update when a refresh is finished.
+	 */
+	inline void SetFinishedCallback(std::function<void()> callback) { m_FinishedCallback = std::move(callback); }
+
+private:
+	struct Send
+	{
+		CNetQuery::Type type;
+		unsigned long addr;
+		int port;
+	};
+
+	CNetQuery m_Query;
+	std::vector<Server> m_Servers;
+	std::unordered_map<uint64_t, int> m_ServerIndex; // Address to index in m_Servers
+	std::vector<Send> m_SendQueue;
+	size_t m_uNextSend = 0;
+	int m_iPendingCount = 0; //!< Sent queries without a result
+	bool m_bIsRefreshing = false;
+	std::function<void()> m_FinishedCallback;
+
+	static uint64_t GetKey(unsigned long addr, int port);
+
+	/**
+	 * Returns index of a server, adding it if it's not in the list.
+	 */
+	int FindOrAddServer(unsigned long addr, int port);
+
+	void ProcessResult(CNetQuery::Result &result);
+};
+
+#endif
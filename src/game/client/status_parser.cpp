@@ -0,0 +1,352 @@
+#include <cctype>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include "status_parser.h"
+
+void CStatusParser::Begin()
+{
+	m_State = State::Header;
+	m_iLineLength = 0;
+	m_bSkipRowEnd = false;
+	m_iLineCount = 0;
+	m_iRowCount = 0;
+	m_iMessageCount = 0;
+	m_flParseTime = 0;
+}
+
+void CStatusParser::Reset()
+{
+	m_State = State::Idle;
+	m_iLineLength = 0;
+	m_bSkipRowEnd = false;
+}
+
+CStatusParser::FeedResult CStatusParser::Feed(const char *text, const RowCallback &callback)
+{
+	if (m_State == State::Idle)
+		return FeedResult::Ignored;
+
+	using Clock = std::chrono::high_resolution_clock;
+	auto startTime = Clock::now();
+	FeedResult result = FeedResult::Parsed;
+	const char *c = text;
+
+	if (m_State == State::Rows && m_iLineLength > 0 && IsRowPrefix(m_szLine, m_iLineLength))
+	{
+		// Parts of a row come in separate messages, other prints may come between them
+		int lineLength = m_iLineLength;
+
+		for (; *c && *c != '\n'; c++)
+		{
+			if (lineLength < MAX_LINE_LENGTH - 1)
+				m_szLine[lineLength++] = *c;
+		}
+
+		if (IsRowPrefix(m_szLine, lineLength))
+		{
+			m_iLineLength = lineLength;
+		}
+		else
+		{
+			m_iLineLength = 0;
+			m_bSkipRowEnd = true;
+			result = FeedResult::Ignored;
+		}
+	}
+	else if (m_bSkipRowEnd && (*c == ' ' || *c == '\n'))
+	{
+		// Remaining parts of a dropped row start with a space or end it
+		while (*c && *c != '\n')
+			c++;
+
+		if (*c)
+		{
+			c++;
+			m_bSkipRowEnd = false;
+		}
+	}
+	else if (m_State == State::Rows && m_iLineLength == 0)
+	{
+		// Only rows and the "N users" line are expected at the start of a line
+		int length = 0;
+
+		while (c[length] && c[length] != '\n')
+			length++;
+
+		bool isComplete = c[length] == '\n';
+		m_bSkipRowEnd = false;
+
+		if (!IsRowPrefix(c, length) && !MatchPattern("# users", c, length, isComplete))
+			result = FeedResult::Ignored;
+	}
+
+	if (result != FeedResult::Ignored)
+	{
+		m_iMessageCount++;
+
+		for (; *c; c++)
+		{
+			if (*c == '\n')
+			{
+				m_szLine[m_iLineLength] = '\0';
+
+				if (ProcessLine(callback))
+				{
+					result = FeedResult::End;
+					Reset();
+					break;
+				}
+
+				m_iLineLength = 0;
+			}
+			else if (m_iLineLength < MAX_LINE_LENGTH - 1)
+			{
+				m_szLine[m_iLineLength++] = *c;
+			}
+		}
+	}
+
+	std::chrono::duration<double, std::micro> parseTime = Clock::now() - startTime;
+	m_flParseTime += parseTime.count();
+
+	return result;
+}
+
+bool CStatusParser::ParseRow(const char *line, Row &row)
+{
+	if (!IsTableLine(line))
+		return false;
+
+	// Header row has no number
+	int index = atoi(line + 1);
+
+	if (index <= 0)
+		return false;
+
+	// Name is quoted and may contain spaces
+	const char *name = strchr(line + 1, '"');
+
+	if (!name)
+		return false;
+
+	name++;
+	const char *nameEnd = strrchr(name, '"');
+
+	if (!nameEnd)
+		return false;
+
+	char *end;
+	int userid = strtol(nameEnd + 1, &end, 10);
+
+	if (end == nameEnd + 1)
+		return false;
+
+	const char *uniqueid = end;
+
+	while (*uniqueid == ' ')
+		uniqueid++;
+
+	int uniqueidLength = 0;
+
+	while ((unsigned char)uniqueid[uniqueidLength] > ' ')
+		uniqueidLength++;
+
+	if (uniqueidLength == 0)
+		return false;
+
+	int nameLength = (int)(nameEnd - name);
+
+	if (nameLength > MAX_NAME_LENGTH - 1)
+		nameLength = MAX_NAME_LENGTH - 1;
+
+	if (uniqueidLength > MAX_UNIQUEID_LENGTH - 1)
+		uniqueidLength = MAX_UNIQUEID_LENGTH - 1;
+
+	row.index = index;
+	row.userid = userid;
+	memcpy(row.name, name, nameLength);
+	row.name[nameLength] = '\0';
+	memcpy(row.uniqueid, uniqueid, uniqueidLength);
+	row.uniqueid[uniqueidLength] = '\0';
+
+	return true;
+}
+
+bool CStatusParser::ProcessLine(const RowCallback &callback)
+{
+	m_iLineCount++;
+
+	if (m_State == State::Header)
+	{
+		// Lines before the header are server info
+		if (IsTableLine(m_szLine))
+			m_State = State::Rows;
+
+		return false;
+	}
+
+	if (!IsTableLine(m_szLine))
+	{
+		// "N users" line or anything else ends the table
+		return true;
+	}
+
+	Row row;
+
+	if (ParseRow(m_szLine, row))
+	{
+		m_iRowCount++;
+		callback(row);
+	}
+
+	return false;
+}
+
+bool CStatusParser::IsTableLine(const char *line)
+{
+	// "#      name userid ...", "# 1 "name" ..." or "#10 "name" ..."
+	return line[0] == '#' && line[1] != '\0' && line[2] != '\0' && line[3] == ' ';
+}
+
+bool CStatusParser::IsRowPrefix(const char *line, int length)
+{
+	// "#%2i %8s %i %s" with the quoted name, then frags or HLTV info, time, ping, loss and address
+	int i = 0;
+
+	if (i == length)
+		return true;
+
+	if (line[i++] != '#')
+		return false;
+
+	for (; i < 3; i++)
+	{
+		if (i == length)
+			return true;
+
+		if (!isdigit((unsigned char)line[i]) && line[i] != ' ')
+			return false;
+	}
+
+	if (i == length)
+		return true;
+
+	if (line[i++] != ' ')
+		return false;
+
+	while (i < length && line[i] == ' ')
+		i++;
+
+	if (i == length)
+		return true;
+
+	if (line[i++] != '"')
+		return false;
+
+	// Name may contain quotes, it ends with the last one
+	int nameEnd = -1;
+
+	for (int j = i; j < length; j++)
+	{
+		if (line[j] == '"')
+			nameEnd = j;
+	}
+
+	// A quote inside the name isn't followed by a space
+	if (nameEnd == -1 || nameEnd + 1 == length || line[nameEnd + 1] != ' ')
+		return true;
+
+	// Fields separated by spaces: userid, uniqueid, then the rest
+	int field = 0;
+	i = nameEnd + 1;
+
+	while (i < length)
+	{
+		if (line[i] == ' ')
+		{
+			i++;
+			continue;
+		}
+
+		int start = i;
+
+		while (i < length && line[i] != ' ')
+			i++;
+
+		const char *text = line + start;
+		int textLength = i - start;
+		bool isComplete = i < length;
+
+		if (field == 0)
+		{
+			if (!MatchPattern("#", text, textLength, isComplete))
+				return false;
+		}
+		else if (field == 1)
+		{
+			for (int j = 0; j < textLength; j++)
+			{
+				if (!isalnum((unsigned char)text[j]) && !strchr("_:[]", text[j]))
+					return false;
+			}
+		}
+		else if (!IsRowField(text, textLength, isComplete))
+		{
+			return false;
+		}
+
+		field++;
+	}
+
+	return true;
+}
+
+bool CStatusParser::IsRowField(const char *field, int length, bool isComplete)
+{
+	static const char *const patterns[] = {
+		"#", // ping, loss
+		"-#", // frags
+		"#:#", // time
+		"#:#:#",
+		"#.#.#.#:#", // address
+		"loopback",
+		"hltv:#/#",
+		"delay:#",
+	};
+
+	for (const char *pattern : patterns)
+	{
+		if (MatchPattern(pattern, field, length, isComplete))
+			return true;
+	}
+
+	return false;
+}
+
+bool CStatusParser::MatchPattern(const char *pattern, const char *text, int length, bool isComplete)
+{
+	// '#' is one or more digits, an incomplete text may match only the start of the pattern
+	int i = 0;
+
+	for (; *pattern; pattern++)
+	{
+		if (i == length)
+			return !isComplete;
+
+		if (*pattern == '#')
+		{
+			if (!isdigit((unsigned char)text[i]))
+				return false;
+
+			while (i < length && isdigit((unsigned char)text[i]))
+				i++;
+		}
+		else if (text[i++] != *pattern)
+		{
+			return false;
+		}
+	}
+
+	return i == length;
+}
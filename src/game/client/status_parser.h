@@ -0,0 +1,127 @@
+//
+// status_parser.h
+//
+// Incremental parser of the player table printed by the "status" command.
+//
+#ifndef STATUS_PARSER_H
+#define STATUS_PARSER_H
+#include <functional>
+
+/**
+ * Parses "status" output received in svc_print messages.
+ * Text is split into lines in a fixed buffer, so a row may be split across any number of messages.
+ * Nothing is allocated while parsing.
+ */
+class CStatusParser
+{
+public:
+	static constexpr int MAX_LINE_LENGTH = 512; //!< Longer lines are truncated
+	static constexpr int MAX_NAME_LENGTH = 64;
+	static constexpr int MAX_UNIQUEID_LENGTH = 64;
+
+	struct Row
+	{
+		int index; //!< Number in the table, doesn't always match player slot
+		int userid;
+		char name[MAX_NAME_LENGTH];
+		char uniqueid[MAX_UNIQUEID_LENGTH]; //!< e.g. STEAM_0:1:2345, VALVE_ID_LAN, BOT, HLTV
+	};
+
+	using RowCallback = std::function<void(const Row &row)>;
+
+	enum class FeedResult
+	{
+		Parsed, //!< Text is a part of the response
+		End, //!< End of the table was found, text after it is ignored
+		Ignored, //!< Text isn't a part of the response, e.g. a chat message between parts of a row
+	};
+
+	/**
+	 * Starts parsing a new response. Text before the table header is skipped.
+	 */
+	void Begin();
+
+	/**
+	 * Stops parsing and drops a pending line.
+	 */
+	void Reset();
+
+	/**
+	 * Returns whether a response is being parsed.
+	 */
+	inline bool IsActive() const { return m_State != State::Idle; }
+
+	/**
+	 * Parses text of one svc_print message.
+	 * The last line is kept until its end is received. Text that would make
+	 * a kept player row malformed is another print that came between parts
+	 * of the row: the kept part is dropped and the text is ignored. Text
+	 * between rows that doesn't start a row or the end line is ignored too.
+	 * @param	text		Message text.
+	 * @param	callback	Called for each player row.
+	 */
+	FeedResult Feed(const char *text, const RowCallback &callback);
+
+	/**
+	 * Parses a single complete player row without the new line.
+	 * @returns	false if the line is not a player row.
+	 */
+	static bool ParseRow(const char *line, Row &row);
+
+	/**
+	 * Returns number of lines of the current or last response.
+	 */
+	inline int GetLineCount() const { return m_iLineCount; }
+
+	/**
+	 * Returns number of player rows of the current or last response.
+	 */
+	inline int GetRowCount() const { return m_iRowCount; }
+
+	/**
+	 * Returns number of messages of the current or last response.
+	 */
+	inline int GetMessageCount() const { return m_iMessageCount; }
+
+	/**
+	 * Returns time spent in Feed for the current or last response in microseconds.
+	 */
+	inline double GetParseTime() const { return m_flParseTime; }
+
+private:
+	enum class State
+	{
+		Idle = 0,
+		Header, //!< Waiting for the table header
+		Rows,
+	};
+
+	State m_State = State::Idle;
+	char m_szLine[MAX_LINE_LENGTH];
+	int m_iLineLength = 0;
+	bool m_bSkipRowEnd = false; //!< Rest of a dropped row is skipped until its end
+
+	int m_iLineCount = 0;
+	int m_iRowCount = 0;
+	int m_iMessageCount = 0;
+	double m_flParseTime = 0;
+
+	/**
+	 * Processes a complete line.
+	 * @returns	true if end of the table was found.
+	 */
+	bool ProcessLine(const RowCallback &callback);
+
+	static bool IsTableLine(const char *line);
+
+	/**
+	 * Returns whether the line is the start of a player row in the format of Host_Status_f.
+	 * @param	line	Line text, doesn't need to be null-terminated.
+	 * @param	length	Line length.
+	 */
+	static bool IsRowPrefix(const char *line, int length);
+	static bool IsRowField(const char *field, int length, bool isComplete);
+	static bool MatchPattern(const char *pattern, const char *text, int length, bool isComplete);
+};
+
+#endif
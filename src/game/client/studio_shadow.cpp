@@ -0,0 +1,833 @@
+//
+// studio_shadow.cpp
+//
+// Precomputed studio model data for stencil shadow volumes.
+//
+#include <cstring>
+#include <unordered_map>
+#include "studio_shadow.h"
+
+#if defined(__i386__) || defined(__x86_64__) || defined(_M_IX86) || defined(_M_X64)
+#define SHADOW_SIMD_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#else
+#define SHADOW_SIMD_X86 0
+#endif
+
+#if SHADOW_SIMD_X86 && defined(__GNUC__)
+#define SHADOW_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define SHADOW_TARGET_AVX2
+#endif
+
+namespace
+{
+
+// Shadow cache file layout (native byte order):
+//   ShadowCacheHeader
+//   ShadowCacheSubModel[numSubModels]
+//   for each submodel: Face[numFaces], Edge[numEdges]
+// Checksum covers everything after the header.
+constexpr char SHADOW_CACHE_IDENT[4] = { 'B', 'S', 'H', 'C' };
+constexpr int32_t SHADOW_CACHE_VERSION = 1;
+
+struct ShadowCacheHeader
+{
+	char ident[4];
+	int32_t version;
+	int32_t modelLength;
+	int32_t numSubModels;
+	uint32_t checksum;
+};
+
+struct ShadowCacheSubModel
+{
+	int32_t numFaces;
+	int32_t numEdges;
+};
+
+static_assert(sizeof(Face) == 3 * sizeof(uint16_t), "Face must be tightly packed");
+static_assert(sizeof(Edge) == 4 * sizeof(uint16_t), "Edge must be tightly packed");
+static_assert(sizeof(ShadowCacheHeader) == 20, "ShadowCacheHeader must be tightly packed");
+
+// FNV-1a
+uint32_t CalcChecksum(const uint8_t *buf, size_t size)
+{
+	uint32_t hash = 2166136261u;
+
+	for (size_t i = 0; i < size; i++)
+	{
+		hash ^= buf[i];
+		hash *= 16777619u;
+	}
+
+	return hash;
+}
+
+inline uint32_t EdgeKey(uint16_t v0, uint16_t v1)
+{
+	return ((uint32_t)v0 << 16) | v1;
+}
+
+}
+
+void ShadowBuildFaces(SubModelData &dst, const short *const *ppTriCmds, int numMeshes)
+{
+	// get number of triangles in all meshes
+	int i, n = 0;
+	for (i = 0; i < numMeshes; i++)
+	{
+		int j;
+		const short *ptricmds = ppTriCmds[i];
+		while ((j = *(ptricmds++)))
+		{
+			if (j < 0)
+				j *= -1;
+			n += (j - 2);
+			ptricmds += 4 * j;
+		}
+	}
+
+	dst.faces.clear();
+
+	if (n == 0)
+		return;
+
+	dst.faces.reserve(n);
+
+	for (i = 0; i < numMeshes; i++)
+	{
+		const short *ptricmds = ppTriCmds[i];
+
+		int j;
+		while ((j = *(ptricmds++)))
+		{
+			if (j > 0)
+			{
+				// convert triangle strip
+				j -= 3;
+
+				short indices[3];
+				indices[0] = ptricmds[0];
+				ptricmds += 4;
+				indices[1] = ptricmds[0];
+				ptricmds += 4;
+				indices[2] = ptricmds[0];
+				ptricmds += 4;
+				dst.faces.push_back(Face(indices[0], indices[1], indices[2]));
+
+				bool reverse = false;
+				for (; j > 0; j--, ptricmds += 4)
+				{
+					indices[0] = indices[1];
+					indices[1] = indices[2];
+					indices[2] = ptricmds[0];
+
+					if (!reverse)
+						dst.faces.push_back(Face(indices[2], indices[1], indices[0]));
+					else
+						dst.faces.push_back(Face(indices[0], indices[1], indices[2]));
+					reverse = !reverse;
+				}
+			}
+			else
+			{
+				// convert triangle fan
+				j = -j - 3;
+
+				short indices[3];
+				indices[0] = ptricmds[0];
+				ptricmds += 4;
+				indices[1] = ptricmds[0];
+				ptricmds += 4;
+				indices[2] = ptricmds[0];
+				ptricmds += 4;
+				dst.faces.push_back(Face(indices[0], indices[1], indices[2]));
+
+				for (; j > 0; j--, ptricmds += 4)
+				{
+					indices[1] = indices[2];
+					indices[2] = ptricmds[0];
+					dst.faces.push_back(Face(indices[0], indices[1], indices[2]));
+				}
+			}
+		}
+	}
+}
+
+void ShadowBuildEdges(SubModelData &dst)
+{
+	dst.edges.clear();
+
+	if (dst.faces.size() == 0)
+		return;
+
+	// Edges that don't have a second face yet, keyed by their vertices.
+	// Edges with the same key are chained in the order they were added,
+	// so a face is always joined to the oldest of them.
+	struct OpenChain
+	{
+		int head;
+		int tail;
+	};
+
+	size_t maxEdges = dst.faces.size() * 3;
+	std::unordered_map<uint32_t, OpenChain> openEdges;
+	std::vector<int> nextOpen;
+
+	openEdges.reserve(maxEdges);
+	nextOpen.reserve(maxEdges);
+	dst.edges.reserve(maxEdges);
+
+	auto fnAddEdge = [&](uint16_t face, uint16_t v0, uint16_t v1) {
+		// first look for face's neighbour
+		auto it = openEdges.find(EdgeKey(v1, v0));
+
+		if (it != openEdges.end())
+		{
+			OpenChain &chain = it->second;
+			int idx = chain.head;
+			dst.edges[idx].face1 = face;
+
+			if (idx == chain.tail)
+				openEdges.erase(it);
+			else
+				chain.head = nextOpen[idx];
+
+			return;
+		}
+
+		// add new edge to list
+		int idx = (int)dst.edges.size();
+		dst.edges.push_back({ v0, v1, face, ShadowEdgeNoFace });
+		nextOpen.push_back(-1);
+
+		auto res = openEdges.insert({ EdgeKey(v0, v1), { idx, idx } });
+
+		if (!res.second)
+		{
+			OpenChain &chain = res.first->second;
+			nextOpen[chain.tail] = idx;
+			chain.tail = idx;
+		}
+	};
+
+	for (size_t i = 0; i < dst.faces.size(); i++)
+	{
+		const Face &f = dst.faces[i];
+		fnAddEdge((uint16_t)i, f.vertex0, f.vertex1);
+		fnAddEdge((uint16_t)i, f.vertex1, f.vertex2);
+		fnAddEdge((uint16_t)i, f.vertex2, f.vertex0);
+	}
+
+	dst.edges.shrink_to_fit();
+}
+
+void ShadowBuildSubModel(SubModelData &dst, const short *const *ppTriCmds, int numMeshes)
+{
+	ShadowBuildFaces(dst, ppTriCmds, numMeshes);
+	ShadowBuildEdges(dst);
+
+	// Each source vertex has two vertices in the vertex buffer: original and extruded one
+	for (Face &f : dst.faces)
+	{
+		f.vertex0 *= 2;
+		f.vertex1 *= 2;
+		f.vertex2 *= 2;
+	}
+
+	for (Edge &e : dst.edges)
+	{
+		e.vertex0 *= 2;
+		e.vertex1 *= 2;
+	}
+
+	ShadowBuildStreams(dst);
+}
+
+void ShadowBuildStreams(SubModelData &dst)
+{
+	size_t numFaces = dst.faces.size();
+	size_t numEdges = dst.edges.size();
+
+	for (int i = 0; i < 3; i++)
+		dst.faceVertex[i].resize(numFaces);
+
+	for (int i = 0; i < 2; i++)
+	{
+		dst.edgeVertex[i].resize(numEdges);
+		dst.edgeFace[i].resize(numEdges);
+	}
+
+	for (size_t i = 0; i < numFaces; i++)
+	{
+		dst.faceVertex[0][i] = dst.faces[i].vertex0;
+		dst.faceVertex[1][i] = dst.faces[i].vertex1;
+		dst.faceVertex[2][i] = dst.faces[i].vertex2;
+	}
+
+	for (size_t i = 0; i < numEdges; i++)
+	{
+		dst.edgeVertex[0][i] = dst.edges[i].vertex0;
+		dst.edgeVertex[1][i] = dst.edges[i].vertex1;
+		dst.edgeFace[0][i] = dst.edges[i].face0;
+		dst.edgeFace[1][i] = dst.edges[i].face1;
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Shadow volume kernels
+//
+// Every kernel does the same float operations in the same order as the scalar
+// one, so the output is bit-identical. FMA must not be used.
+//-----------------------------------------------------------------------------
+namespace
+{
+
+inline int GetVertBone(const ShadowVolumeParams &p, int vert)
+{
+	int bone = p.vertBones[vert];
+	return bone < p.numBones ? bone : 0;
+}
+
+//-------------------------------------
+// Scalar
+//-------------------------------------
+void TransformVertsScalar(const ShadowVolumeParams &p, float (*out)[3])
+{
+	for (int i = 0, j = 0; i < p.numVerts; i++, j += 2)
+	{
+		const float *in = p.verts[i];
+		const float(*m)[4] = p.bones[GetVertBone(p, i)];
+
+		out[j][0] = in[0] * m[0][0] + in[1] * m[0][1] + in[2] * m[0][2] + m[0][3];
+		out[j][1] = in[0] * m[1][0] + in[1] * m[1][1] + in[2] * m[1][2] + m[1][3];
+		out[j][2] = in[0] * m[2][0] + in[1] * m[2][1] + in[2] * m[2][2] + m[2][3];
+
+		out[j + 1][0] = out[j][0] - p.extrude[0];
+		out[j + 1][1] = out[j][1] - p.extrude[1];
+		out[j + 1][2] = out[j][2] - p.extrude[2];
+	}
+}
+
+void ClassifyFacesScalar(const ShadowVolumeParams &p, const SubModelData &data, size_t start, const float (*verts)[3], uint8_t *faceLight)
+{
+	for (size_t i = start; i < data.faces.size(); i++)
+	{
+		const Face &f = data.faces[i];
+		const float *p0 = verts[f.vertex0];
+		const float *p1 = verts[f.vertex1];
+		const float *p2 = verts[f.vertex2];
+
+		float v1[3], v2[3], norm[3];
+		v1[0] = p1[0] - p0[0];
+		v1[1] = p1[1] - p0[1];
+		v1[2] = p1[2] - p0[2];
+		v2[0] = p2[0] - p1[0];
+		v2[1] = p2[1] - p1[1];
+		v2[2] = p2[2] - p1[2];
+
+		// CrossProduct(v2, v1, norm)
+		norm[0] = v2[1] * v1[2] - v2[2] * v1[1];
+		norm[1] = v2[2] * v1[0] - v2[0] * v1[2];
+		norm[2] = v2[0] * v1[1] - v2[1] * v1[0];
+
+		float dot = norm[0] * p.lightDir[0] + norm[1] * p.lightDir[1] + norm[2] * p.lightDir[2];
+		faceLight[i] = dot >= 0;
+	}
+}
+
+inline uint16_t *EmitQuad(uint16_t *out, uint16_t a, uint16_t b)
+{
+	out[0] = a;
+	out[1] = b;
+	out[2] = a + 1;
+	out[3] = a + 1;
+	out[4] = b;
+	out[5] = b + 1;
+	return out + 6;
+}
+
+uint16_t *EmitEdgesScalar(const SubModelData &data, const uint8_t *faceLight, uint16_t *out)
+{
+	for (const Edge &e : data.edges)
+	{
+		if (faceLight[e.face0])
+		{
+			if ((e.face1 != ShadowEdgeNoFace) && faceLight[e.face1])
+				continue;
+
+			out = EmitQuad(out, e.vertex0, e.vertex1);
+		}
+		else
+		{
+			if ((e.face1 == ShadowEdgeNoFace) || !faceLight[e.face1])
+				continue;
+
+			out = EmitQuad(out, e.vertex1, e.vertex0);
+		}
+	}
+
+	return out;
+}
+
+// Branchless version, relies on faceLight[ShadowEdgeNoFace] == 0.
+// Always writes a quad and only advances the output if the edge is on the silhouette.
+uint16_t *EmitEdgesRange(const SubModelData &data, size_t start, const uint8_t *faceLight, uint16_t *out)
+{
+	const uint16_t *v0 = data.edgeVertex[0].data();
+	const uint16_t *v1 = data.edgeVertex[1].data();
+	const uint16_t *f0 = data.edgeFace[0].data();
+	const uint16_t *f1 = data.edgeFace[1].data();
+	size_t numEdges = data.edges.size();
+
+	for (size_t i = start; i < numEdges; i++)
+	{
+		unsigned l0 = faceLight[f0[i]];
+		unsigned l1 = faceLight[f1[i]];
+		uint16_t mask = (uint16_t)(0u - l0);
+		uint16_t a = (v0[i] & mask) | (v1[i] & ~mask);
+		uint16_t b = v0[i] ^ v1[i] ^ a;
+
+		EmitQuad(out, a, b);
+		out += 6 * (l0 ^ l1);
+	}
+
+	return out;
+}
+
+#if SHADOW_SIMD_X86
+
+inline void StoreVec3(float *dst, __m128 v)
+{
+	_mm_storel_pi((__m64 *)dst, v);
+	_mm_store_ss(dst + 2, _mm_movehl_ps(v, v));
+}
+
+inline unsigned CountTrailingZeros(unsigned x)
+{
+#ifdef _MSC_VER
+	unsigned long idx;
+	_BitScanForward(&idx, x);
+	return idx;
+#else
+	return __builtin_ctz(x);
+#endif
+}
+
+//-------------------------------------
+// SSE2
+//-------------------------------------
+void TransformVertsSSE2(const ShadowVolumeParams &p, float (*out)[3])
+{
+	// Bone matrices split into columns, so each vertex is three multiply-adds
+	// done in the same order as VectorTransform
+	alignas(16) float cols[ShadowMaxBones][4][4];
+
+	for (int b = 0; b < p.numBones; b++)
+	{
+		for (int c = 0; c < 4; c++)
+		{
+			cols[b][c][0] = p.bones[b][0][c];
+			cols[b][c][1] = p.bones[b][1][c];
+			cols[b][c][2] = p.bones[b][2][c];
+			cols[b][c][3] = 0;
+		}
+	}
+
+	__m128 extrude = _mm_setr_ps(p.extrude[0], p.extrude[1], p.extrude[2], 0);
+
+	for (int i = 0, j = 0; i < p.numVerts; i++, j += 2)
+	{
+		const float *in = p.verts[i];
+		const float(*c)[4] = cols[GetVertBone(p, i)];
+
+		__m128 r = _mm_mul_ps(_mm_set1_ps(in[0]), _mm_load_ps(c[0]));
+		r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(in[1]), _mm_load_ps(c[1])));
+		r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(in[2]), _mm_load_ps(c[2])));
+		r = _mm_add_ps(r, _mm_load_ps(c[3]));
+
+		StoreVec3(out[j], r);
+		StoreVec3(out[j + 1], _mm_sub_ps(r, extrude));
+	}
+}
+
+inline __m128 Gather4(const float (*verts)[3], const uint16_t *idx, int comp)
+{
+	return _mm_setr_ps(verts[idx[0]][comp], verts[idx[1]][comp], verts[idx[2]][comp], verts[idx[3]][comp]);
+}
+
+void ClassifyFacesSSE2(const ShadowVolumeParams &p, const SubModelData &data, const float (*verts)[3], uint8_t *faceLight)
+{
+	const uint16_t *i0 = data.faceVertex[0].data();
+	const uint16_t *i1 = data.faceVertex[1].data();
+	const uint16_t *i2 = data.faceVertex[2].data();
+	size_t numFaces = data.faces.size();
+	size_t i = 0;
+
+	__m128 lx = _mm_set1_ps(p.lightDir[0]);
+	__m128 ly = _mm_set1_ps(p.lightDir[1]);
+	__m128 lz = _mm_set1_ps(p.lightDir[2]);
+	__m128 zero = _mm_setzero_ps();
+
+	for (; i + 4 <= numFaces; i += 4)
+	{
+		__m128 p0x = Gather4(verts, i0 + i, 0), p0y = Gather4(verts, i0 + i, 1), p0z = Gather4(verts, i0 + i, 2);
+		__m128 p1x = Gather4(verts, i1 + i, 0), p1y = Gather4(verts, i1 + i, 1), p1z = Gather4(verts, i1 + i, 2);
+		__m128 p2x = Gather4(verts, i2 + i, 0), p2y = Gather4(verts, i2 + i, 1), p2z = Gather4(verts, i2 + i, 2);
+
+		__m128 v1x = _mm_sub_ps(p1x, p0x), v1y = _mm_sub_ps(p1y, p0y), v1z = _mm_sub_ps(p1z, p0z);
+		__m128 v2x = _mm_sub_ps(p2x, p1x), v2y = _mm_sub_ps(p2y, p1y), v2z = _mm_sub_ps(p2z, p1z);
+
+		__m128 nx = _mm_sub_ps(_mm_mul_ps(v2y, v1z), _mm_mul_ps(v2z, v1y));
+		__m128 ny = _mm_sub_ps(_mm_mul_ps(v2z, v1x), _mm_mul_ps(v2x, v1z));
+		__m128 nz = _mm_sub_ps(_mm_mul_ps(v2x, v1y), _mm_mul_ps(v2y, v1x));
+
+		__m128 dot = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, lx), _mm_mul_ps(ny, ly)), _mm_mul_ps(nz, lz));
+		int mask = _mm_movemask_ps(_mm_cmpge_ps(dot, zero));
+
+		faceLight[i + 0] = (mask >> 0) & 1;
+		faceLight[i + 1] = (mask >> 1) & 1;
+		faceLight[i + 2] = (mask >> 2) & 1;
+		faceLight[i + 3] = (mask >> 3) & 1;
+	}
+
+	// remaining faces
+	ClassifyFacesScalar(p, data, i, verts, faceLight);
+}
+
+//-------------------------------------
+// AVX2
+//-------------------------------------
+SHADOW_TARGET_AVX2 inline __m256i LoadIndexes8(const uint16_t *idx)
+{
+	return _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *)idx));
+}
+
+SHADOW_TARGET_AVX2 void ClassifyFacesAVX2(const ShadowVolumeParams &p, const SubModelData &data, const float (*verts)[3], uint8_t *faceLight)
+{
+	const float *base = verts[0];
+	const uint16_t *i0 = data.faceVertex[0].data();
+	const uint16_t *i1 = data.faceVertex[1].data();
+	const uint16_t *i2 = data.faceVertex[2].data();
+	size_t numFaces = data.faces.size();
+	size_t i = 0;
+
+	__m256 lx = _mm256_set1_ps(p.lightDir[0]);
+	__m256 ly = _mm256_set1_ps(p.lightDir[1]);
+	__m256 lz = _mm256_set1_ps(p.lightDir[2]);
+	__m256 zero = _mm256_setzero_ps();
+
+	for (; i + 8 <= numFaces; i += 8)
+	{
+		// Offsets of vertices in floats: index * 3
+		__m256i o0 = LoadIndexes8(i0 + i);
+		__m256i o1 = LoadIndexes8(i1 + i);
+		__m256i o2 = LoadIndexes8(i2 + i);
+		o0 = _mm256_add_epi32(o0, _mm256_add_epi32(o0, o0));
+		o1 = _mm256_add_epi32(o1, _mm256_add_epi32(o1, o1));
+		o2 = _mm256_add_epi32(o2, _mm256_add_epi32(o2, o2));
+
+		__m256 p0x = _mm256_i32gather_ps(base + 0, o0, 4), p0y = _mm256_i32gather_ps(base + 1, o0, 4), p0z = _mm256_i32gather_ps(base + 2, o0, 4);
+		__m256 p1x = _mm256_i32gather_ps(base + 0, o1, 4), p1y = _mm256_i32gather_ps(base + 1, o1, 4), p1z = _mm256_i32gather_ps(base + 2, o1, 4);
+		__m256 p2x = _mm256_i32gather_ps(base + 0, o2, 4), p2y = _mm256_i32gather_ps(base + 1, o2, 4), p2z = _mm256_i32gather_ps(base + 2, o2, 4);
+
+		__m256 v1x = _mm256_sub_ps(p1x, p0x), v1y = _mm256_sub_ps(p1y, p0y), v1z = _mm256_sub_ps(p1z, p0z);
+		__m256 v2x = _mm256_sub_ps(p2x, p1x), v2y = _mm256_sub_ps(p2y, p1y), v2z = _mm256_sub_ps(p2z, p1z);
+
+		__m256 nx = _mm256_sub_ps(_mm256_mul_ps(v2y, v1z), _mm256_mul_ps(v2z, v1y));
+		__m256 ny = _mm256_sub_ps(_mm256_mul_ps(v2z, v1x), _mm256_mul_ps(v2x, v1z));
+		__m256 nz = _mm256_sub_ps(_mm256_mul_ps(v2x, v1y), _mm256_mul_ps(v2y, v1x));
+
+		__m256 dot = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(nx, lx), _mm256_mul_ps(ny, ly)), _mm256_mul_ps(nz, lz));
+		int mask = _mm256_movemask_ps(_mm256_cmp_ps(dot, zero, _CMP_GE_OQ));
+
+		for (int k = 0; k < 8; k++)
+			faceLight[i + k] = (mask >> k) & 1;
+	}
+
+	ClassifyFacesScalar(p, data, i, verts, faceLight);
+}
+
+SHADOW_TARGET_AVX2 uint16_t *EmitEdgesAVX2(const SubModelData &data, const uint8_t *faceLight, uint16_t *out)
+{
+	const uint16_t *v0 = data.edgeVertex[0].data();
+	const uint16_t *v1 = data.edgeVertex[1].data();
+	const uint16_t *f0 = data.edgeFace[0].data();
+	const uint16_t *f1 = data.edgeFace[1].data();
+	size_t numEdges = data.edges.size();
+	size_t i = 0;
+
+	__m256i byteMask = _mm256_set1_epi32(0xFF);
+
+	for (; i + 8 <= numEdges; i += 8)
+	{
+		// faceLight has 3 bytes of padding so 4-byte gathers stay in bounds
+		__m256i l0 = _mm256_i32gather_epi32((const int *)faceLight, LoadIndexes8(f0 + i), 1);
+		__m256i l1 = _mm256_i32gather_epi32((const int *)faceLight, LoadIndexes8(f1 + i), 1);
+		l0 = _mm256_and_si256(l0, byteMask);
+		l1 = _mm256_and_si256(l1, byteMask);
+
+		unsigned lit = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(l0, _mm256_setzero_si256())));
+		unsigned same = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(l0, l1)));
+		unsigned emit = ~same & 0xFF;
+
+		while (emit)
+		{
+			unsigned k = CountTrailingZeros(emit);
+			emit &= emit - 1;
+
+			if (lit & (1u << k))
+				out = EmitQuad(out, v0[i + k], v1[i + k]);
+			else
+				out = EmitQuad(out, v1[i + k], v0[i + k]);
+		}
+	}
+
+	return EmitEdgesRange(data, i, faceLight, out);
+}
+
+bool CpuHasAVX2()
+{
+#ifdef _MSC_VER
+	int info[4];
+	__cpuid(info, 0);
+	if (info[0] < 7)
+		return false;
+
+	// AVX and OS support for saving YMM registers
+	__cpuid(info, 1);
+	if (!(info[2] & (1 << 27)) || !(info[2] & (1 << 28)))
+		return false;
+
+	if ((_xgetbv(0) & 6) != 6)
+		return false;
+
+	__cpuidex(info, 7, 0);
+	return (info[1] & (1 << 5)) != 0;
+#else
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2");
+#endif
+}
+
+#endif // SHADOW_SIMD_X86
+
+}
+
+ShadowKernel ShadowGetBestKernel()
+{
+	if (ShadowIsKernelSupported(ShadowKernel::AVX2))
+		return ShadowKernel::AVX2;
+
+	if (ShadowIsKernelSupported(ShadowKernel::SSE2))
+		return ShadowKernel::SSE2;
+
+	return ShadowKernel::Scalar;
+}
+
+bool ShadowIsKernelSupported(ShadowKernel kernel)
+{
+	switch (kernel)
+	{
+	case ShadowKernel::Scalar:
+		return true;
+#if SHADOW_SIMD_X86
+	case ShadowKernel::SSE2:
+		// The game is built with SSE2 enabled
+		return true;
+	case ShadowKernel::AVX2:
+	{
+		static bool bHasAVX2 = CpuHasAVX2();
+		return bHasAVX2;
+	}
+#endif
+	default:
+		return false;
+	}
+}
+
+const char *ShadowGetKernelName(ShadowKernel kernel)
+{
+	switch (kernel)
+	{
+	case ShadowKernel::Scalar:
+		return "scalar";
+	case ShadowKernel::SSE2:
+		return "SSE2";
+	case ShadowKernel::AVX2:
+		return "AVX2";
+	default:
+		return "unknown";
+	}
+}
+
+int ShadowBuildVolume(ShadowKernel kernel, const ShadowVolumeParams &inParams, const SubModelData &data, float (*outVerts)[3], uint16_t *outIndexes, uint8_t *faceLight)
+{
+	uint16_t *out = outIndexes;
+
+	if (inParams.numBones <= 0)
+		return 0;
+
+	ShadowVolumeParams params = inParams;
+	if (params.numBones > ShadowMaxBones)
+		params.numBones = ShadowMaxBones;
+
+	// Edges with one face read this entry in branchless kernels
+	faceLight[ShadowEdgeNoFace] = 0;
+
+	switch (kernel)
+	{
+#if SHADOW_SIMD_X86
+	case ShadowKernel::SSE2:
+		TransformVertsSSE2(params, outVerts);
+		ClassifyFacesSSE2(params, data, outVerts, faceLight);
+		out = EmitEdgesRange(data, 0, faceLight, out);
+		break;
+	case ShadowKernel::AVX2:
+		TransformVertsSSE2(params, outVerts);
+		ClassifyFacesAVX2(params, data, outVerts, faceLight);
+		out = EmitEdgesAVX2(data, faceLight, out);
+		break;
+#endif
+	default:
+		TransformVertsScalar(params, outVerts);
+		ClassifyFacesScalar(params, data, 0, outVerts, faceLight);
+		out = EmitEdgesScalar(data, faceLight, out);
+		break;
+	}
+
+	return (int)(out - outIndexes);
+}
+
+void ShadowCacheWrite(const ModelExtraData &data, int modelLength, std::vector<uint8_t> &out)
+{
+	size_t size = sizeof(ShadowCacheHeader) + sizeof(ShadowCacheSubModel) * data.submodels.size();
+
+	for (const SubModelData &sm : data.submodels)
+		size += sizeof(Face) * sm.faces.size() + sizeof(Edge) * sm.edges.size();
+
+	out.resize(size);
+
+	uint8_t *ptr = out.data() + sizeof(ShadowCacheHeader);
+
+	for (const SubModelData &sm : data.submodels)
+	{
+		ShadowCacheSubModel info;
+		info.numFaces = (int32_t)sm.faces.size();
+		info.numEdges = (int32_t)sm.edges.size();
+		memcpy(ptr, &info, sizeof(info));
+		ptr += sizeof(info);
+	}
+
+	for (const SubModelData &sm : data.submodels)
+	{
+		if (!sm.faces.empty())
+		{
+			memcpy(ptr, sm.faces.data(), sizeof(Face) * sm.faces.size());
+			ptr += sizeof(Face) * sm.faces.size();
+		}
+
+		if (!sm.edges.empty())
+		{
+			memcpy(ptr, sm.edges.data(), sizeof(Edge) * sm.edges.size());
+			ptr += sizeof(Edge) * sm.edges.size();
+		}
+	}
+
+	ShadowCacheHeader header;
+	memcpy(header.ident, SHADOW_CACHE_IDENT, sizeof(header.ident));
+	header.version = SHADOW_CACHE_VERSION;
+	header.modelLength = modelLength;
+	header.numSubModels = (int32_t)data.submodels.size();
+	header.checksum = CalcChecksum(out.data() + sizeof(header), size - sizeof(header));
+	memcpy(out.data(), &header, sizeof(header));
+}
+
+bool ShadowCacheRead(const uint8_t *buf, size_t size, int modelLength, const std::vector<int> &numVerts, ModelExtraData &data)
+{
+	size_t numSubModels = numVerts.size();
+	ShadowCacheHeader header;
+
+	if (size < sizeof(header))
+		return false;
+
+	memcpy(&header, buf, sizeof(header));
+
+	if (memcmp(header.ident, SHADOW_CACHE_IDENT, sizeof(header.ident)) != 0)
+		return false;
+
+	if (header.version != SHADOW_CACHE_VERSION || header.modelLength != modelLength)
+		return false;
+
+	if (header.numSubModels < 0 || (size_t)header.numSubModels != numSubModels)
+		return false;
+
+	if ((size - sizeof(header)) / sizeof(ShadowCacheSubModel) < numSubModels)
+		return false;
+
+	if (CalcChecksum(buf + sizeof(header), size - sizeof(header)) != header.checksum)
+		return false;
+
+	const uint8_t *table = buf + sizeof(header);
+	const uint8_t *ptr = table + sizeof(ShadowCacheSubModel) * numSubModels;
+	const uint8_t *end = buf + size;
+
+	ModelExtraData result;
+	result.submodels.resize(numSubModels);
+
+	for (size_t i = 0; i < numSubModels; i++)
+	{
+		ShadowCacheSubModel info;
+		memcpy(&info, table + sizeof(info) * i, sizeof(info));
+
+		if (info.numFaces < 0 || info.numEdges < 0 || info.numFaces > ShadowEdgeNoFace)
+			return false;
+
+		size_t faceBytes = sizeof(Face) * info.numFaces;
+		size_t edgeBytes = sizeof(Edge) * info.numEdges;
+
+		if ((size_t)(end - ptr) < faceBytes + edgeBytes)
+			return false;
+
+		// Both structs only contain uint16_t so they are 2-byte aligned in the file
+		SubModelData &sm = result.submodels[i];
+		const Face *faces = reinterpret_cast<const Face *>(ptr);
+		const Edge *edges = reinterpret_cast<const Edge *>(ptr + faceBytes);
+		sm.faces.assign(faces, faces + info.numFaces);
+		sm.edges.assign(edges, edges + info.numEdges);
+		ptr += faceBytes + edgeBytes;
+
+		// A cache of another model with the same length passes the checks above.
+		// Reject anything that would read vertex or face arrays out of bounds.
+		// Indexes point to the original vertex, the extruded one follows it.
+		int maxVert = 2 * numVerts[i] - 1;
+
+		for (const Face &f : sm.faces)
+		{
+			if (f.vertex0 >= maxVert || f.vertex1 >= maxVert || f.vertex2 >= maxVert)
+				return false;
+		}
+
+		for (const Edge &e : sm.edges)
+		{
+			if (e.vertex0 >= maxVert || e.vertex1 >= maxVert)
+				return false;
+
+			if (e.face0 >= info.numFaces || (e.face1 != ShadowEdgeNoFace && e.face1 >= info.numFaces))
+				return false;
+		}
+	}
+
+	if (ptr != end)
+		return false;
+
+	for (SubModelData &sm : result.submodels)
+		ShadowBuildStreams(sm);
+
+	data.submodels.swap(result.submodels);
+	return true;
+}
@@ -0,0 +1,155 @@
+//
+// studio_shadow.h
+//
+// Precomputed studio model data for stencil shadow volumes.
+//
+#ifndef STUDIO_SHADOW_H
+#define STUDIO_SHADOW_H
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// some precomputed data about model, for shadow volumes optimization
+
+struct Edge
+{
+	uint16_t vertex0;
+	uint16_t vertex1;
+	uint16_t face0;
+	uint16_t face1;
+};
+
+struct Face
+{
+	Face() { }
+	Face(uint16_t v0, uint16_t v1, uint16_t v2)
+	    : vertex0(v0)
+	    , vertex1(v1)
+	    , vertex2(v2)
+	{
+	}
+	uint16_t vertex0;
+	uint16_t vertex1;
+	uint16_t vertex2;
+};
+
+struct SubModelData
+{
+	std::vector<Face> faces;
+	std::vector<Edge> edges;
+
+	// faces and edges split into separate streams for SIMD kernels, see ShadowBuildStreams
+	std::vector<uint16_t> faceVertex[3];
+	std::vector<uint16_t> edgeVertex[2];
+	std::vector<uint16_t> edgeFace[2];
+};
+
+struct ModelExtraData
+{
+	std::vector<SubModelData> submodels;
+};
+
+// Value of Edge::face1 for edges that belong to only one face
+constexpr uint16_t ShadowEdgeNoFace = 0xFFFF;
+
+// Max number of bone matrices passed to ShadowBuildVolume
+constexpr int ShadowMaxBones = 128;
+
+// Size of the scratch buffer for ShadowBuildVolume
+constexpr size_t ShadowFaceLightSize = 0x10000 + 4;
+
+enum class ShadowKernel
+{
+	Scalar = 0,
+	SSE2,
+	AVX2,
+	Count,
+};
+
+/**
+ * Input of ShadowBuildVolume.
+ */
+struct ShadowVolumeParams
+{
+	const float (*verts)[3] = nullptr; // untransformed vertices of the submodel
+	const uint8_t *vertBones = nullptr; // bone index for each vertex
+	int numVerts = 0;
+	const float (*bones)[3][4] = nullptr; // bone transforms
+	int numBones = 0; // at most ShadowMaxBones, vertices of other bones use bone 0
+	float lightDir[3] = {}; // faces with normal facing this direction are lit
+	float extrude[3] = {}; // extruded vertices are moved by -extrude
+};
+
+/**
+ * Converts triangle strips and fans of a submodel into a list of faces.
+ * @param	ppTriCmds	Triangle commands for each mesh of the submodel.
+ * @param	numMeshes	Number of meshes.
+ */
+void ShadowBuildFaces(SubModelData &dst, const short *const *ppTriCmds, int numMeshes);
+
+/**
+ * Builds edge list with adjacent faces from dst.faces.
+ * Edge shared by two faces with opposite winding is stored once, other edges
+ * have face1 set to ShadowEdgeNoFace. Runs in linear time.
+ */
+void ShadowBuildEdges(SubModelData &dst);
+
+/**
+ * Builds faces and edges of a submodel from triangle commands.
+ * Vertex indexes are doubled to address the vertex buffer filled by ShadowBuildVolume.
+ */
+void ShadowBuildSubModel(SubModelData &dst, const short *const *ppTriCmds, int numMeshes);
+
+/**
+ * Fills SoA streams of dst from dst.faces and dst.edges.
+ */
+void ShadowBuildStreams(SubModelData &dst);
+
+/**
+ * Returns the fastest kernel supported by the CPU.
+ */
+ShadowKernel ShadowGetBestKernel();
+
+/**
+ * Returns whether the kernel can run on this CPU.
+ */
+bool ShadowIsKernelSupported(ShadowKernel kernel);
+
+/**
+ * Returns name of the kernel for display.
+ */
+const char *ShadowGetKernelName(ShadowKernel kernel);
+
+/**
+ * Transforms vertices and extracts silhouette edges of a submodel.
+ * All kernels produce bit-identical output.
+ * @param	kernel		Kernel to use, must be supported.
+ * @param	params		Vertices and light.
+ * @param	data		Submodel data with streams.
+ * @param	outVerts	Receives 2 * numVerts vertices: transformed and extruded one for each vertex.
+ * @param	outIndexes	Receives triangle list of silhouette quads. Must have room for 6 * (edges.size() + 1) indexes.
+ * @param	faceLight	Scratch buffer of ShadowFaceLightSize bytes.
+ * @returns number of indexes written.
+ */
+int ShadowBuildVolume(ShadowKernel kernel, const ShadowVolumeParams &params, const SubModelData &data, float (*outVerts)[3], uint16_t *outIndexes, uint8_t *faceLight);
+
+/**
+ * Serializes model data into shadow cache file contents.
+ * @param	data		Model data.
+ * @param	modelLength	studiohdr_t::length of the source model.
+ * @param	out			Output buffer, overwritten.
+ */
+void ShadowCacheWrite(const ModelExtraData &data, int modelLength, std::vector<uint8_t> &out);
+
+/**
+ * Parses shadow cache file contents.
+ * @param	buf				File contents.
+ * @param	size			Size of buf.
+ * @param	modelLength		studiohdr_t::length of the source model.
+ * @param	numVerts		Vertex count of each submodel of the source model.
+ * @param	data			Output model data. Not modified on failure.
+ * @returns false if file is corrupted or made for another model or format version.
+ */
+bool ShadowCacheRead(const uint8_t *buf, size_t size, int modelLength, const std::vector<int> &numVerts, ModelExtraData &data);
+
+#endif
@@ -10,7 +10,6 @@
 //
 
 #include <ctime>
-#include <pcre.h>
 #include <tier1/strtools.h>
 
 #include "hud.h"
@@ -66,6 +65,14 @@ CON_COMMAND(cl_protect_help, "Prints info about client proctection configuration
 	ConPrintf("Cvar requests: %s\n", s_BlockListCvar);
 }
 
+CON_COMMAND(cl_protect_stats, "Prints statistics of client protection filters. Use \"cl_protect_stats reset\" to reset them.")
+{
+	if (gEngfuncs.Cmd_Argc() >= 2 && !strcmp(gEngfuncs.Cmd_Argv(1), "reset"))
+		CSvcMessages::Get().ResetProtectStats();
+	else
+		CSvcMessages::Get().PrintProtectStats();
+}
+
 CON_COMMAND(dev_send_status, "Sends a status command to update SteamIDs")
 {
 	CSvcMessages::Get().SendStatusRequest();
@@ -99,8 +106,20 @@ CSvcMessages::CSvcMessages()
 	memset(m_iMarkedPlayers, 0, sizeof(m_iMarkedPlayers));
 }
 
+static void CompileFilter(CRegexFilter &filter, const char *pattern)
+{
+	if (!filter.SetPattern(pattern))
+	{
+		ConPrintf(ConColor::Red, "PCRE compilation failed at %s\n", filter.GetError());
+		ConPrintf(ConColor::Red, "in regex: %s\n", pattern);
+	}
+}
+
 void CSvcMessages::Init()
 {
+	CompileFilter(m_BlockList, s_BlockList);
+	CompileFilter(m_BlockListCvar, s_BlockListCvar);
+
 	if (!CEnginePatches::Get().GetSvcArray())
 	{
 		ConPrintf(ConColor::Red, "SVC: Engine svc array not found, handlers not installed.\n");
@@ -119,6 +138,7 @@ void CSvcMessages::Init()
 	m_Handlers.funcs.pfnSvcTempEntity = CallMember<&CSvcMessages::SvcTempEntity>;
 	m_Handlers.funcs.pfnSvcNewUserMsg = CallMember<&CSvcMessages::SvcNewUserMsg>;
 	m_Handlers.funcs.pfnSvcStuffText = CallMember<&CSvcMessages::SvcStuffText>;
+	m_Handlers.funcs.pfnSvcUpdateUserInfo = CallMember<&CSvcMessages::SvcUpdateUserInfo>;
 	m_Handlers.funcs.pfnSvcSendCvarValue = CallMember<&CSvcMessages::SvcSendCvarValue>;
 	m_Handlers.funcs.pfnSvcSendCvarValue2 = CallMember<&CSvcMessages::SvcSendCvarValue2>;
 
@@ -129,6 +149,7 @@ void CSvcMessages::VidInit()
 {
 	m_iStatusRequestState = StatusRequestState::Idle;
 	m_iStatusResponseCounter = 0;
+	m_StatusParser.Reset();
 
 	// Only allow sending requests STATUS_REQUEST_CONN_DELAY after connection was established
 	m_flStatusRequestLastTime = gEngfuncs.GetAbsoluteTime() + STATUS_REQUEST_CONN_DELAY - STATUS_REQUEST_PERIOD;
@@ -175,8 +196,8 @@ void CSvcMessages::SendStatusRequest()
 	if (gEngfuncs.pDemoAPI->IsRecording())
 	{
 		// Write into the demo that a status command was sent
-		uint8_t buf[sizeof(DEMO_MAGIC)];
-		memcpy(buf, &DEMO_MAGIC, sizeof(DEMO_MAGIC));
+		uint8_t buf[sizeof(DEMO_SVC_STATUS_MAGIC)];
+		memcpy(buf, &DEMO_SVC_STATUS_MAGIC, sizeof(DEMO_SVC_STATUS_MAGIC));
 		Demo_WriteBuffer(TYPE_SVC_STATUS, sizeof(buf), buf);
 	}
 }
@@ -311,7 +332,7 @@ void CSvcMessages::ReadDemoBuffer(int type, const uint8_t *buffer)
 		// It prevents the game from interpreting messages recorded in other mods
 		unsigned magic;
 		memcpy(&magic, buffer, sizeof(magic));
-		if (magic != DEMO_MAGIC)
+		if (magic != DEMO_SVC_STATUS_MAGIC)
 		{
 			gEngfuncs.Con_DPrintf("CSvcMessages::ReadDemoBuffer: Invalid magic %u\n", magic);
 			return;
@@ -331,34 +352,57 @@ void CSvcMessages::ReadDemoBuffer(int type, const uint8_t *buffer)
 	}
 }
 
-bool CSvcMessages::RegexMatch(const char *str, const char *regex)
+void CSvcMessages::PrintProtectStats()
 {
-	if (regex[0] == 0)
-		return false;
+	UpdateProtectFilters();
 
-	const char *error;
-	int erroffset;
-	int ovector[30];
+	ConPrintf("Commands: %u checked, %u blocked\n", m_uCommandsChecked, m_uCommandsBlocked);
+	ConPrintf("Cvar requests: %u checked, %u blocked\n", m_uCvarsChecked, m_uCvarsBlocked);
+	ConPrintf("Filters:\n");
 
-	// Prepare regex
-	pcre *re = pcre_compile(regex, PCRE_CASELESS, &error, &erroffset, NULL);
-	if (!re)
-	{
-		ConPrintf(ConColor::Red, "PCRE compilation failed at offset %d: %s\n", erroffset, error);
-		ConPrintf(ConColor::Red, "in regex: %s\n", regex);
-		return false;
-	}
+	auto fnPrint = [](const char *name, const CRegexFilter &filter) {
+		const CRegexFilter::Stats &stats = filter.GetStats();
 
-	// Try to match
-	int rc = pcre_exec(re, NULL, str, strlen(str), 0, 0, ovector, sizeof(ovector) / sizeof(ovector[0]));
+		if (filter.GetPattern()[0] == '\0')
+			ConPrintf("  %-22s (empty)\n", name);
+		else if (!filter.IsValid())
+			ConPrintf(ConColor::Red, "  %-22s (invalid: %s)\n", name, filter.GetError());
+		else
+			ConPrintf("  %-22s %u checks, %u matches, compiled %u times\n", name, stats.checks, stats.matches, stats.compiles);
+	};
+
+	fnPrint("built-in commands", m_BlockList);
+	fnPrint("built-in cvars", m_BlockListCvar);
+	fnPrint(cl_protect_block.GetName(), m_UserBlockList);
+	fnPrint(cl_protect_allow.GetName(), m_UserAllowList);
+	fnPrint(cl_protect_block_cvar.GetName(), m_UserBlockListCvar);
+}
 
-	// Free up the regular expression
-	pcre_free(re);
+void CSvcMessages::ResetProtectStats()
+{
+	m_uCommandsChecked = 0;
+	m_uCommandsBlocked = 0;
+	m_uCvarsChecked = 0;
+	m_uCvarsBlocked = 0;
+
+	m_BlockList.ResetStats();
+	m_BlockListCvar.ResetStats();
+	m_UserBlockList.ResetStats();
+	m_UserAllowList.ResetStats();
+	m_UserBlockListCvar.ResetStats();
+}
 
-	// Test the result
-	if (rc < 0)
-		return false; // No match
-	return true;
+void CSvcMessages::UpdateProtectFilters()
+{
+	// Only recompile when the cvar value is changed
+	auto fnUpdate = [](CRegexFilter &filter, ConVar &cvar) {
+		if (strcmp(filter.GetPattern(), cvar.GetString()))
+			CompileFilter(filter, cvar.GetString());
+	};
+
+	fnUpdate(m_UserBlockList, cl_protect_block);
+	fnUpdate(m_UserAllowList, cl_protect_allow);
+	fnUpdate(m_UserBlockListCvar, cl_protect_block_cvar);
 }
 
 bool CSvcMessages::IsCommandGood(const char *str)
@@ -378,9 +422,15 @@ bool CSvcMessages::IsCommandGood(const char *str)
 	if (!Q_stricmp(s_ComToken, cl_protect_block_cvar.GetName()))
 		return false;
 
+	UpdateProtectFilters();
+	m_uCommandsChecked++;
+
 	// Check command name against block lists and whole command line against allow list
-	if ((RegexMatch(s_ComToken, s_BlockList) || RegexMatch(s_ComToken, cl_protect_block.GetString())) && !RegexMatch(str, cl_protect_allow.GetString()))
+	if ((m_BlockList.Match(s_ComToken) || m_UserBlockList.Match(s_ComToken)) && !m_UserAllowList.Match(str))
+	{
+		m_uCommandsBlocked++;
 		return false;
+	}
 
 	return true;
 }
@@ -400,17 +450,52 @@ bool CSvcMessages::IsCvarGood(const char *str)
 	if (!Q_stricmp(s_ComToken, cl_protect_block_cvar.GetName()))
 		return false;
 
+	UpdateProtectFilters();
+	m_uCvarsChecked++;
+
 	// Check cvar name against block lists
-	if (RegexMatch(str, s_BlockListCvar) || RegexMatch(str, cl_protect_block_cvar.GetString()))
+	if (m_BlockListCvar.Match(str) || m_UserBlockListCvar.Match(str))
+	{
+		m_uCvarsBlocked++;
 		return false;
+	}
 
 	return true;
 }
 
-void CSvcMessages::SvcPrint()
+void CSvcMessages::ProcessStatusRow(const CStatusParser::Row &row)
 {
-	static bool processingUserRow = false;
+	// Index in 'status' doesn't always match with player slot
+	CPlayerInfo *pi = CPlayerInfo::FindByName(row.name);
+
+	if (!pi)
+	{
+		ConPrintf(ConColor::Red, "[BUG] SvcPrint: Unable to find player's slot\n");
+		ConPrintf(ConColor::Red, "[BUG] Status row: #%d \"%s\" %d %s\n", row.index, row.name, row.userid, row.uniqueid);
+		assert(false);
+		return;
+	}
+
+	const char *steamid = row.uniqueid;
+	char newSteamID[MAX_STEAMID + 1];
+
+	if (!strncmp(steamid, "STEAM_", 6) || !strncmp(steamid, "VALVE_", 6))
+		strncpy(newSteamID, steamid + 6, MAX_STEAMID); // cutout "STEAM_" or "VALVE_" start of the string
+	else
+		strncpy(newSteamID, steamid, MAX_STEAMID);
+	newSteamID[MAX_STEAMID] = 0;
+
+	if (strcmp(pi->m_szSteamID, newSteamID))
+	{
+		strcpy(pi->m_szSteamID, newSteamID);
+		pi->MarkChanged(CPlayerInfo::CHANGED_STEAMID);
+	}
+
+	m_iMarkedPlayers[pi->GetIndex()] = m_iStatusResponseCounter;
+}
 
+void CSvcMessages::SvcPrint()
+{
 	BEGIN_READ(GetMsgBuf().GetBuf(), GetMsgBuf().GetSize(), GetMsgBuf().GetReadPos());
 	char *str = READ_STRING();
 
@@ -427,8 +512,10 @@ void CSvcMessages::SvcPrint()
 			// Detect answer
 			if (!strncmp(str, "hostname:  ", 11))
 			{
-				m_iStatusRequestState = StatusRequestState::AnswerReceived;
+				m_iStatusRequestState = StatusRequestState::Processing;
 				m_iStatusResponseCounter++;
+				m_StatusParser.Begin();
+				m_StatusParser.Feed(str, [this](const CStatusParser::Row &row) { ProcessStatusRow(row); });
 				// Suppress status output
 				GetMsgBuf().GetReadPos() += strlen(str) + 1;
 				return;
@@ -440,104 +527,22 @@ void CSvcMessages::SvcPrint()
 			}
 			break;
 		}
-		case StatusRequestState::AnswerReceived:
-		{
-			// Search for start of table header
-			if (str[0] == '#' && str[1] != 0 && str[2] != 0 && str[3] == ' ')
-			{
-				m_iStatusRequestState = StatusRequestState::Processing;
-			}
-			if (strchr(str, '\n') == NULL)
-			{
-				// if header row is not finished within received string, pend it
-				processingUserRow = true;
-			}
-
-			// Suppress status output
-			GetMsgBuf().GetReadPos() += strlen(str) + 1;
-			return;
-		}
 		case StatusRequestState::Processing:
 		{
-			if (str[0] == '#' && str[1] != 0 && str[2] != 0 && str[3] == ' ')
-			{
-				// start of new player info row
-				int idx = atoi(str + 1); // Index in 'status' doesn't always match with player slot
-				if (idx > 0)
-				{
-					char *name = strchr(strchr(str + 2, ' '), '"');
-					if (name != NULL)
-					{
-						name++; // space
-						char *userid = strchr(name, '"');
-						if (userid != NULL)
-						{
-							userid += 2; // quote and space
-							char *steamid = strchr(userid, ' ');
-							if (steamid != NULL)
-							{
-								// Find actual slot
-								int slot = 0;
-
-								// Replace '\"' in the string with a null-terminator
-								//   to later be used in strcmp
-								char stringTerm = '\0';
-								std::swap(name[userid - name - 2], stringTerm);
-
-								for (int i = 1; i <= MAX_PLAYERS; i++)
-								{
-									CPlayerInfo *pi = GetPlayerInfo(i)->Update();
-									if (pi->IsConnected() && !strcmp(pi->GetName(), name))
-									{
-										slot = i;
-										break;
-									}
-								}
-
-								std::swap(name[userid - name - 2], stringTerm);
-
-								if (slot > 0)
-								{
-									steamid++; // space
-									char *steamidend = strchr(steamid, ' ');
-									if (steamidend != NULL)
-										*steamidend = 0;
-
-									CPlayerInfo *pi = GetPlayerInfo(slot);
-
-									if (!strncmp(steamid, "STEAM_", 6) || !strncmp(steamid, "VALVE_", 6))
-										strncpy(pi->m_szSteamID, steamid + 6, MAX_STEAMID); // cutout "STEAM_" or "VALVE_" start of the string
-									else
-										strncpy(pi->m_szSteamID, steamid, MAX_STEAMID);
-									pi->m_szSteamID[MAX_STEAMID] = 0;
-
-									m_iMarkedPlayers[slot] = m_iStatusResponseCounter;
-								}
-								else
-								{
-									ConPrintf(ConColor::Red, "[BUG] SvcPrint: Unable to find player's slot\n");
-									ConPrintf(ConColor::Red, "[BUG] Status string:\n");
-									ConPrintf(ConColor::Red, "[BUG] %s\n", str);
-									assert(false);
-								}
-							}
-						}
-					}
-				}
-				if (strchr(str, '\n') == NULL) // user row is not finished within received string, pend it
-					processingUserRow = true;
-			}
-			else if (processingUserRow)
-			{
-				// continuation of user or header row
-				if (strchr(str, '\n') != NULL) // skip till the end of the row (new line)
-					processingUserRow = false;
-			}
-			else
+			// Rows may be split across messages, parser keeps the unfinished line
+			CStatusParser::FeedResult result = m_StatusParser.Feed(str, [this](const CStatusParser::Row &row) { ProcessStatusRow(row); });
+
+			// Other output between parts of a row is printed as usual
+			if (result == CStatusParser::FeedResult::Ignored)
+				break;
+
+			if (result == CStatusParser::FeedResult::End)
 			{
 				// end of the table
 				m_iStatusRequestState = StatusRequestState::Idle;
-				gEngfuncs.Con_DPrintf("%.3f status request received\n", gEngfuncs.GetAbsoluteTime());
+				gEngfuncs.Con_DPrintf("%.3f status request received (%d rows, %d lines, %d messages, parsed in %.1f us)\n",
+				    gEngfuncs.GetAbsoluteTime(), m_StatusParser.GetRowCount(), m_StatusParser.GetLineCount(),
+				    m_StatusParser.GetMessageCount(), m_StatusParser.GetParseTime());
 
 				for (int idx = 1; idx <= MAX_PLAYERS; idx++)
 				{
@@ -559,24 +564,33 @@ void CSvcMessages::SvcPrint()
 	{
 		// Clear cached steam id for left player
 		int len = strlen(str);
-		if (!strcmp(str + len - 9, " dropped\n"))
+		if (len >= 9 && !strcmp(str + len - 9, " dropped\n"))
 		{
 			str[len - 9] = 0;
-			for (int i = 1; i <= MAX_PLAYERS; i++)
-			{
-				CPlayerInfo *pi = GetPlayerInfo(i)->Update();
-				if (pi->IsConnected() && !strcmp(pi->GetName(), str))
-				{
-					pi->m_szSteamID[0] = 0;
-					break;
-				}
-			}
+			CPlayerInfo *pi = CPlayerInfo::FindByName(str);
+
+			if (pi)
+				pi->m_szSteamID[0] = 0;
 		}
 	}
 
 	CEnginePatches::Get().GetEngineSvcHandlers().pfnSvcPrint();
 }
 
+void CSvcMessages::SvcUpdateUserInfo()
+{
+	BEGIN_READ(GetMsgBuf().GetBuf(), GetMsgBuf().GetSize(), GetMsgBuf().GetReadPos());
+	int slot = READ_BYTE();
+
+	CEnginePatches::Get().GetEngineSvcHandlers().pfnSvcUpdateUserInfo();
+
+	// Name, colors or model may have changed
+	CPlayerInfo::InvalidateAll();
+
+	if (slot >= 0 && slot < MAX_PLAYERS)
+		CPlayerInfo::UpdateNameIndex(slot + 1);
+}
+
 void CSvcMessages::SvcTempEntity()
 {
 	BEGIN_READ(GetMsgBuf().GetBuf(), GetMsgBuf().GetSize(), GetMsgBuf().GetReadPos());
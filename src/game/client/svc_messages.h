@@ -12,6 +12,8 @@
 #ifndef SVC_MESSAGES_H
 #define SVC_MESSAGES_H
 #include <cstddef>
+#include "regex_filter.h"
+#include "status_parser.h"
 
 using SvcParseFunc = void (*)();
 
@@ -138,12 +140,21 @@ public:
 	 */
 	void ReadDemoBuffer(int type, const uint8_t *buffer);
 
+	/**
+	 * Prints cl_protect filter statistics to the console.
+	 */
+	void PrintProtectStats();
+
+	/**
+	 * Resets cl_protect filter statistics.
+	 */
+	void ResetProtectStats();
+
 private:
 	enum class StatusRequestState
 	{
 		Idle = 0,
 		Sent,
-		AnswerReceived,
 		Processing,
 	};
 
@@ -157,19 +168,29 @@ private:
 	static constexpr float STATUS_REQUEST_PERIOD = 2.0f; //<! Minimum time between status requests
 	static constexpr float STATUS_REQUEST_CONN_DELAY = 3.f; //<! Only begin sending requests some time after connection established
 
-	static constexpr unsigned DEMO_MAGIC = 2498416793; //!< A random magic number
-
 	StatusRequestState m_iStatusRequestState = StatusRequestState::Idle;
 	float m_flStatusRequestLastTime = 0.0f;
 	float m_flStatusRequestNextTime = 0.0f;
 	int m_iStatusRequestLastFrame = 0;
 	int m_iStatusResponseCounter = 0; //<! Incremented at the start of each response
 	int m_iMarkedPlayers[MAX_PLAYERS + 1]; //<! [i] is set to counter if i-th player was found in the response
+	CStatusParser m_StatusParser;
+
+	CRegexFilter m_BlockList; //!< Built-in command block list
+	CRegexFilter m_BlockListCvar; //!< Built-in cvar block list
+	CRegexFilter m_UserBlockList; //!< cl_protect_block
+	CRegexFilter m_UserAllowList; //!< cl_protect_allow
+	CRegexFilter m_UserBlockListCvar; //!< cl_protect_block_cvar
+
+	unsigned m_uCommandsChecked = 0;
+	unsigned m_uCommandsBlocked = 0;
+	unsigned m_uCvarsChecked = 0;
+	unsigned m_uCvarsBlocked = 0;
 
 	/**
-	 * Returns whether string matches a regular expression.
+	 * Recompiles user filters if cl_protect_* cvars were changed.
 	 */
-	bool RegexMatch(const char *str, const char *regex);
+	void UpdateProtectFilters();
 
 	/**
 	 * Returns whether a command is safe to execute from the server.
@@ -181,6 +202,11 @@ private:
 	 */
 	bool IsCvarGood(const char *str);
 
+	/**
+	 * Updates SteamID of a player from a row of the status response.
+	 */
+	void ProcessStatusRow(const CStatusParser::Row &row);
+
 	/**
 	 * svc_print: Prints text to the console.
 	 * Message contents:
@@ -188,6 +214,16 @@ private:
 	 */
 	void SvcPrint();
 
+	/**
+	 * svc_updateuserinfo: Updates user info of a player.
+	 * Message contents:
+	 *   byte: Slot
+	 *   long: User ID
+	 *   string: User info
+	 *   16 bytes: CD key hash
+	 */
+	void SvcUpdateUserInfo();
+
 	/**
 	 * svc_temp_entity: Create a tempentity on the client.
 	 * Message contents:
@@ -48,6 +48,7 @@ IParticleMan *g_pParticleMan = NULL;
 #include "StudioModelRenderer.h"
 #include "GameStudioModelRenderer.h"
 #include "sdl_rt.h"
+#include "world_shadow_receivers.h"
 
 #define GL_TEXTURE0_ARB 0x84C0
 #define GL_TEXTURE1_ARB 0x84C1
@@ -83,74 +84,88 @@ int g_visframe;
 int g_framecount;
 Vector g_lightvec;
 
-void RecursiveDrawWorld(mnode_t *node)
+CWorldShadowReceivers g_WorldShadowReceivers;
+
+// World the receivers were built for
+static const msurface_t *s_pReceiversSurfaces = nullptr;
+static char s_szReceiversWorld[64];
+
+static void AddWorldShadowNode(mnode_t *node, std::vector<CWorldShadowReceivers::Node> &nodes, std::vector<CWorldShadowReceivers::Surface> &surfaces)
 {
-	if (node->contents == CONTENTS_SOLID)
+	// leaves have no surfaces of their own
+	if (node->contents < 0)
 		return;
 
-	if (node->visframe != g_visframe)
-		return;
+	size_t nodeIndex = nodes.size();
+	nodes.emplace_back();
 
-	if (node->contents < 0)
-		return; // faces already marked by engine
+	CWorldShadowReceivers::Node desc;
+	desc.normal = &node->plane->normal[0];
+	desc.planeType = node->plane->type;
+	desc.pVisframe = &node->visframe;
+	desc.firstSurface = (int)surfaces.size();
 
-	// recurse down the children, Order doesn't matter
-	RecursiveDrawWorld(node->children[0]);
-	RecursiveDrawWorld(node->children[1]);
+	msurface_t *surf = g_pworld->surfaces + node->firstsurface;
 
-	// draw stuff
-	int c = node->numsurfaces;
-	if (c)
+	for (int c = node->numsurfaces; c; c--, surf++)
 	{
-		msurface_t *surf = g_pworld->surfaces + node->firstsurface;
-
-		for (; c; c--, surf++)
-		{
-			if (surf->visframe != g_framecount)
-				continue;
-
-			if (surf->flags & (SURF_DRAWSKY | SURF_DRAWTURB | SURF_UNDERWATER))
-				continue;
-
-			// cull from light vector
-
-			float dot;
-			mplane_t *plane = surf->plane;
-
-			switch (plane->type)
-			{
-			case PLANE_X:
-				dot = g_lightvec[0];
-				break;
-			case PLANE_Y:
-				dot = g_lightvec[1];
-				break;
-			case PLANE_Z:
-				dot = g_lightvec[2];
-				break;
-			default:
-				dot = DotProduct(g_lightvec, plane->normal);
-				break;
-			}
-
-			if ((dot > 0) && (surf->flags & SURF_PLANEBACK))
-				continue;
-
-			if ((dot < 0) && !(surf->flags & SURF_PLANEBACK))
-				continue;
-
-			glpoly_t *p = surf->polys;
-			float *v = p->verts[0];
-
-			glBegin(GL_POLYGON);
-			for (int i = 0; i < p->numverts; i++, v += VERTEXSIZE)
-			{
-				glTexCoord2f(v[3], v[4]);
-				glVertex3fv(v);
-			}
-			glEnd();
-		}
+		if (surf->flags & (SURF_DRAWSKY | SURF_DRAWTURB | SURF_UNDERWATER))
+			continue;
+
+		glpoly_t *p = surf->polys;
+
+		if (!p)
+			continue;
+
+		CWorldShadowReceivers::Surface surfDesc;
+		surfDesc.verts = p->verts[0];
+		surfDesc.numVerts = p->numverts;
+		surfDesc.vertexStride = VERTEXSIZE;
+		surfDesc.planeBack = (surf->flags & SURF_PLANEBACK) != 0;
+		surfDesc.pVisframe = &surf->visframe;
+		surfaces.push_back(surfDesc);
 	}
+
+	desc.surfaceCount = (int)surfaces.size() - desc.firstSurface;
+
+	AddWorldShadowNode(node->children[0], nodes, surfaces);
+	AddWorldShadowNode(node->children[1], nodes, surfaces);
+
+	desc.subtreeSize = (int)(nodes.size() - nodeIndex);
+	nodes[nodeIndex] = desc;
+}
+
+static void BuildWorldShadowReceivers()
+{
+	std::vector<CWorldShadowReceivers::Node> nodes;
+	std::vector<CWorldShadowReceivers::Surface> surfaces;
+
+	// Only nodes of the world tree, brush entity nodes follow them in the same array
+	AddWorldShadowNode(g_pworld->nodes + g_pworld->hulls[0].firstclipnode, nodes, surfaces);
+
+	g_WorldShadowReceivers.Build(nodes, surfaces);
+	s_pReceiversSurfaces = g_pworld->surfaces;
+	safe_strcpy(s_szReceiversWorld, g_pworld->name, sizeof(s_szReceiversWorld));
+}
+
+static void DrawWorldShadowReceivers()
+{
+	if (g_pworld->surfaces != s_pReceiversSurfaces || strcmp(g_pworld->name, s_szReceiversWorld))
+		BuildWorldShadowReceivers();
+
+	// cull from node and surface visframes and light vector
+	g_WorldShadowReceivers.BuildVisibleList(g_visframe, g_framecount, &g_lightvec[0]);
+
+	if (g_WorldShadowReceivers.GetVisibleIndexCount() == 0)
+		return;
+
+	glPushClientAttrib(GL_CLIENT_VERTEX_ARRAY_BIT);
+	glDisableClientState(GL_COLOR_ARRAY);
+	glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glVertexPointer(3, GL_FLOAT, 0, g_WorldShadowReceivers.GetVertices());
+	glDrawElements(GL_TRIANGLES, g_WorldShadowReceivers.GetVisibleIndexCount(), GL_UNSIGNED_INT, g_WorldShadowReceivers.GetVisibleIndices());
+	glPopClientAttrib();
 }
 
 // buz end
@@ -250,7 +265,7 @@ void CL_DLLEXPORT HUD_DrawNormalTriangles(void)
 		g_StudioRenderer.GetShadowVector(g_lightvec);
 
 		// draw world
-		RecursiveDrawWorld(g_pworld->nodes);
+		DrawWorldShadowReceivers();
 
 		glPopAttrib();
 	}
@@ -0,0 +1,96 @@
+#include <algorithm>
+#include <thread>
+#include <tier1/checksum_sha1.h>
+#include "mapped_file.h"
+#include "file_hasher.h"
+
+namespace fs = std::filesystem;
+
+bool CFileHasher::HashFile(const fs::path &path, std::vector<uint8_t> &hash, uint64_t &size, std::string &error)
+{
+	// CSHA1::Update takes the length as unsigned int
+	constexpr size_t MAX_UPDATE_SIZE = 1024 * 1024;
+
+	std::error_code ec;
+	uint64_t fileSize = fs::file_size(path, ec);
+
+	if (ec)
+	{
+		error = "failed to get size of " + path.u8string() + ": " + ec.message();
+		return false;
+	}
+
+	CSHA1 sha1;
+
+	// Empty files can't be mapped
+	if (fileSize != 0)
+	{
+		CMappedFile file;
+
+		if (!file.Open(path.u8string().c_str()))
+		{
+			error = "failed to open " + path.u8string();
+			return false;
+		}
+
+		uint8_t *pData = const_cast<uint8_t *>(file.GetData());
+		fileSize = file.GetSize();
+
+		for (size_t offset = 0; offset < file.GetSize(); offset += MAX_UPDATE_SIZE)
+			sha1.Update(pData + offset, (unsigned int)std::min(file.GetSize() - offset, MAX_UPDATE_SIZE));
+	}
+
+	sha1.Final();
+	hash.resize(HASH_SIZE);
+	sha1.GetHash(hash.data());
+	size = fileSize;
+	return true;
+}
+
+bool CFileHasher::HashFiles(std::vector<File> &files, int threads, const std::atomic_bool *pAbort, const FileCallback &fnCallback)
+{
+	std::atomic<size_t> nextFile(0);
+	bool aborted = false;
+
+	if (threads <= 0)
+		threads = (int)std::thread::hardware_concurrency();
+
+	threads = std::max(1, std::min({ threads, MAX_THREADS, (int)files.size() }));
+
+	auto fnWorker = [&]() {
+		for (;;)
+		{
+			size_t i = nextFile.fetch_add(1, std::memory_order_relaxed);
+
+			if (i >= files.size())
+				break;
+
+			if (pAbort && *pAbort)
+				break;
+
+			File &file = files[i];
+			file.hashed = HashFile(file.path, file.hash, file.size, file.error);
+
+			if (fnCallback)
+				fnCallback(i);
+		}
+	};
+
+	std::vector<std::thread> pool;
+
+	for (int i = 1; i < threads; i++)
+		pool.emplace_back(fnWorker);
+
+	fnWorker();
+
+	for (std::thread &thread : pool)
+		thread.join();
+
+	for (const File &file : files)
+	{
+		if (!file.hashed && file.error.empty())
+			aborted = true;
+	}
+
+	return !aborted;
+}
@@ -0,0 +1,60 @@
+//
+// file_hasher.h
+//
+// SHA-1 hashing of many files on worker threads.
+//
+#ifndef UPDATER_FILE_HASHER_H
+#define UPDATER_FILE_HASHER_H
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <string>
+#include <vector>
+
+/**
+ * Hashes files with SHA-1. Files are memory-mapped and split between a small pool of threads.
+ */
+class CFileHasher
+{
+public:
+	static constexpr int MAX_THREADS = 4;
+	static constexpr size_t HASH_SIZE = 160 / 8;
+
+	struct File
+	{
+		std::filesystem::path path;
+
+		// Results
+		std::vector<uint8_t> hash;
+		uint64_t size = 0;
+		bool hashed = false;
+		std::string error;
+	};
+
+	/**
+	 * Called from a worker thread when a file is hashed or failed.
+	 * @param	index	Index of the file in the list
+	 */
+	using FileCallback = std::function<void(size_t index)>;
+
+	/**
+	 * Hashes one file.
+	 * @param	hash	SHA-1 of the contents
+	 * @param	size	Size in bytes
+	 * @param	error	Reason of the failure
+	 * @returns true on success
+	 */
+	static bool HashFile(const std::filesystem::path &path, std::vector<uint8_t> &hash, uint64_t &size, std::string &error);
+
+	/**
+	 * Hashes all files in the list. Returns when all files are done or after an abort.
+	 * @param	threads		Number of threads, 0 to use the number of CPU cores up to MAX_THREADS
+	 * @param	pAbort		If set, files that aren't started yet are skipped
+	 * @param	fnCallback	Called after every file, can be empty
+	 * @returns false if aborted
+	 */
+	static bool HashFiles(std::vector<File> &files, int threads, const std::atomic_bool *pAbort, const FileCallback &fnCallback);
+};
+
+#endif
@@ -16,6 +16,7 @@
 #include "cl_util.h"
 #include "update_installer.h"
 #include "update_dialogs.h"
+#include "file_hasher.h"
 #include "gameui/gameui_viewport.h"
 #include "engine_patches.h"
 #include "appversion.h"
@@ -113,44 +114,6 @@ std::string BytesToHexString(const std::vector<uint8_t> &data)
 	return ss.str();
 }
 
-std::vector<uint8_t> CalcFileSHA1(std::ifstream &file, unsigned long *pulFileSize = nullptr)
-{
-	// Based on CSHA1::HashFile
-	CSHA1 hash;
-	constexpr size_t MAX_FILE_READ_BUFFER = 8000;
-	unsigned long ulFileSize = 0, ulRest = 0, ulBlocks = 0;
-	unsigned long i = 0;
-	unsigned char uData[MAX_FILE_READ_BUFFER];
-
-	file.seekg(0, file.end);
-	ulFileSize = file.tellg();
-	file.seekg(0, file.beg);
-
-	ulRest = ulFileSize % MAX_FILE_READ_BUFFER;
-	ulBlocks = ulFileSize / MAX_FILE_READ_BUFFER;
-
-	for (i = 0; i < ulBlocks; i++)
-	{
-		file.read((char *)uData, MAX_FILE_READ_BUFFER);
-		hash.Update(uData, MAX_FILE_READ_BUFFER);
-	}
-
-	if (ulRest != 0)
-	{
-		file.read((char *)uData, ulRest);
-		hash.Update(uData, ulRest);
-	}
-
-	hash.Final();
-	std::vector<uint8_t> hashBytes(SHA1_HASH_SIZE);
-	hash.GetHash(hashBytes.data());
-
-	if (pulFileSize)
-		*pulFileSize = ulFileSize;
-
-	return hashBytes;
-}
-
 /**
  * Returns whether a path is in a subdirectory
  */
@@ -177,6 +140,12 @@ void CUpdateInstaller::Shutdown()
 {
 	s_bCanCallVGui2 = false;
 
+	if (m_ValidationResult.valid())
+	{
+		m_bAbortValidation = true;
+		m_ValidationResult.wait();
+	}
+
 	if (m_bIsInProcess)
 	{
 		// Can't use CancelInstallation since it calls to VGUI2
@@ -213,6 +182,8 @@ void CUpdateInstaller::Shutdown()
 
 void CUpdateInstaller::RunFrame()
 {
+	UpdateValidationStatus();
+
 	if (!m_bIsInProcess)
 		return;
 
@@ -968,53 +939,77 @@ void CUpdateInstaller::HashFiles()
 
 		try
 		{
-			auto fnCalcFileHashAndSize = [](const fs::path &path, unsigned long &fileSize) {
-				std::ifstream file;
-				file.exceptions(std::ios::badbit | std::ios::failbit);
-				file.open(path, std::ios::in | std::ios::binary);
-				return CalcFileSHA1(file, &fileSize);
+			// Every entry has a new file and maybe an old one
+			struct FileEntry
+			{
+				const std::string *pName;
+				FileHash *pHash;
+				bool isNewFile;
 			};
 
-			m_FileProgress.iTotalFiles = m_FileHashes.size();
+			std::vector<CFileHasher::File> files;
+			std::vector<FileEntry> fileEntries;
 
 			for (auto &file : m_FileHashes)
 			{
-				if (m_bAbortRequested)
-				{
-					isSuccess = false;
-					error = "aborted";
-					break;
-				}
-
-				{
-					std::lock_guard<std::mutex> lock(m_AsyncMutex);
-					m_FileProgress.filename = file.first;
-				}
-
 				if (!fs::exists(file.second.newPath))
 					throw std::runtime_error("file " + file.second.newPath.u8string() + " doesn't exist");
 
-				unsigned long fileSize = 0;
-
-				file.second.realNewHash = fnCalcFileHashAndSize(file.second.newPath, fileSize);
-				file.second.realNewSize = fileSize;
+				files.emplace_back().path = file.second.newPath;
+				fileEntries.push_back({ &file.first, &file.second, true });
 
 				if (!file.second.oldPath.empty())
 				{
 					if (!fs::exists(file.second.oldPath))
 						throw std::runtime_error("file " + file.second.oldPath.u8string() + " doesn't exist");
 
-					file.second.realOldHash = fnCalcFileHashAndSize(file.second.oldPath, fileSize);
-					file.second.realOldSize = fileSize;
+					files.emplace_back().path = file.second.oldPath;
+					fileEntries.push_back({ &file.first, &file.second, false });
+				}
+			}
+
+			m_FileProgress.iTotalFiles = files.size();
+
+			auto fnFileHashed = [&](size_t i) {
+				{
+					std::lock_guard<std::mutex> lock(m_AsyncMutex);
+					m_FileProgress.filename = *fileEntries[i].pName;
 				}
 
 				if (update_hash_sleep.GetInt() > 0)
 					std::this_thread::sleep_for(std::chrono::milliseconds(update_hash_sleep.GetInt()));
 
+				m_FileProgress.iFinishedFiles++;
+			};
+
+			if (!CFileHasher::HashFiles(files, 0, &m_bAbortRequested, fnFileHashed))
+			{
+				isSuccess = false;
+				error = "aborted";
+			}
+			else
+			{
+				for (size_t i = 0; i < files.size(); i++)
+				{
+					if (!files[i].hashed)
+						throw std::runtime_error(files[i].error);
+
+					FileHash &hash = *fileEntries[i].pHash;
+
+					if (fileEntries[i].isNewFile)
+					{
+						hash.realNewHash = std::move(files[i].hash);
+						hash.realNewSize = files[i].size;
+					}
+					else
+					{
+						hash.realOldHash = std::move(files[i].hash);
+						hash.realOldSize = files[i].size;
+					}
+				}
+
 				if (update_hash_error.GetBool())
 					throw std::logic_error("Never Gonna Let You Down");
-
-				m_FileProgress.iFinishedFiles++;
 			}
 		}
 		catch (const std::exception &e)
@@ -1464,10 +1459,16 @@ void CUpdateInstaller::CleanUp() noexcept
 	m_InstallationPath.clear();
 }
 
-CON_COMMAND(bhl_validate_files, "Validates integrity of BugfixedHL (Enriched) files, may freeze the game for a bit")
+void CUpdateInstaller::ValidateFiles()
 {
 	using nlohmann::json;
 
+	if (m_ValidationResult.valid())
+	{
+		ConPrintf(ConColor::Red, "Files are already being validated.\n");
+		return;
+	}
+
 	// Disconnect from the server so the command can't be abused for lagspiking
 	gEngfuncs.pfnClientCmd("disconnect\n");
 
@@ -1539,18 +1540,14 @@ CON_COMMAND(bhl_validate_files, "Validates integrity of BugfixedHL (Enriched) fi
 		}
 	}
 
-	int filesChecked = 0;
-	int filesFailed = 0;
-	int filesPassed = 0;
+	std::vector<ValidatedFile> validatedFiles;
+	std::vector<CFileHasher::File> filesToHash;
 
 	try
 	{
 		// Print version of metadata
 		ConPrintf("Metadata version: %s\n", metadata.at("version").get<std::string>().c_str());
 
-		// Validate all files in the metadata
-		ConPrintf(ConColor::Yellow, "Validating files...\n");
-
 		for (auto &file : metadata.at("files").get<json::object_t>())
 		{
 			const std::string &filename = file.first;
@@ -1559,19 +1556,21 @@ CON_COMMAND(bhl_validate_files, "Validates integrity of BugfixedHL (Enriched) fi
 			if (filename.find("..") != filename.npos)
 				throw std::runtime_error("file " + filename + " points outside mod dir");
 
+			ValidatedFile &result = validatedFiles.emplace_back();
+			result.filename = filename;
+
 			// Hash and size
-			std::vector<uint8_t> metaHash = HexStringToBytes(file.second.at("hash_sha1").get<std::string>());
+			result.metaHash = HexStringToBytes(file.second.at("hash_sha1").get<std::string>());
 			uint64_t metaSize = file.second.at("size").get<uint64_t>();
 
-			if (metaHash.size() != SHA1_HASH_SIZE)
+			if (result.metaHash.size() != SHA1_HASH_SIZE)
 				throw std::runtime_error("file " + filename + " has invalid hash in metadata");
 
 			// User modifiable flag
-			bool isUserMod = false;
 			auto userModifiableIt = file.second.find("user_modifiable");
 
 			if (userModifiableIt != file.second.end())
-				isUserMod = userModifiableIt->get<bool>();
+				result.isUserModifiable = userModifiableIt->get<bool>();
 
 			// Get all possible paths to the file
 			fs::path realPath = modPath / fs::path(filename);
@@ -1580,82 +1579,43 @@ CON_COMMAND(bhl_validate_files, "Validates integrity of BugfixedHL (Enriched) fi
 			char vfsPath[MAX_PATH];
 			bool vfsPathExists = g_pFullFileSystem->GetLocalPath(filename.c_str(), vfsPath, sizeof(vfsPath));
 
-			bool isValid = false;
-
 			if (!realPathExists && !vfsPathExists)
 			{
-				ConPrintf("%s is missing\n", filename.c_str());
+				result.message = filename + " is missing\n";
 			}
 			else if (realPathExists != vfsPathExists)
 			{
 				if (realPathExists)
 				{
-					ConPrintf("%s only exists in real file system\n", filename.c_str());
-					ConPrintf("    %s\n", realPath.u8string().c_str());
+					result.message = filename + " only exists in real file system\n";
+					result.message += "    " + realPath.u8string() + "\n";
 				}
 				else
 				{
-					ConPrintf("%s only exists in virtual file system\n", filename.c_str());
-					ConPrintf("    %s\n", vfsPath);
+					result.message = filename + " only exists in virtual file system\n";
+					result.message += std::string("    ") + vfsPath + "\n";
 				}
 			}
 			else
 			{
 				// Both files exist
-				fs::path vfsPathAsPath = fs::u8path(vfsPath);
-
 				if (!fs::equivalent(realPath, fs::u8path(vfsPath)))
 				{
-					ConPrintf("%s points to two different files\n", filename.c_str());
-					ConPrintf("    Real: %s\n", realPath.u8string().c_str());
-					ConPrintf("    Virtual: %s\n", vfsPath);
+					result.message = filename + " points to two different files\n";
+					result.message += "    Real: " + realPath.u8string() + "\n";
+					result.message += std::string("    Virtual: ") + vfsPath + "\n";
+				}
+				else if (fs::file_size(realPath) != metaSize)
+				{
+					result.isModified = true;
 				}
 				else
 				{
-					bool isModified = false;
-
-					// Compare sizes
-					uint64_t realSize = fs::file_size(realPath);
-
-					if (realSize != metaSize)
-					{
-						isModified = true;
-					}
-					else
-					{
-						std::ifstream file;
-						file.exceptions(std::ios::badbit | std::ios::failbit);
-						file.open(realPath, std::ios::in | std::ios::binary);
-						std::vector<uint8_t> realHash = CalcFileSHA1(file);
-
-						if (realHash != metaHash)
-							isModified = true;
-					}
-
-					if (isModified)
-					{
-						if (isUserMod)
-						{
-							ConPrintf("%s is user-modified\n", filename.c_str());
-							isValid = true;
-						}
-						else
-						{
-							ConPrintf("%s is modified\n", filename.c_str());
-						}
-					}
-					else
-					{
-						isValid = true;
-					}
+					// Hashed in the background
+					result.hashIndex = (int)filesToHash.size();
+					filesToHash.emplace_back().path = realPath;
 				}
 			}
-
-			if (isValid)
-				filesPassed++;
-			else
-				filesFailed++;
-			filesChecked++;
 		}
 	}
 	catch (const std::exception &e)
@@ -1664,13 +1624,71 @@ CON_COMMAND(bhl_validate_files, "Validates integrity of BugfixedHL (Enriched) fi
 		return;
 	}
 
-	ConPrintf("\n");
+	ConPrintf(ConColor::Yellow, "Validating files...\n");
+
+	m_ValidationResult = std::async(std::launch::async, [this, validatedFiles = std::move(validatedFiles), filesToHash = std::move(filesToHash)]() mutable {
+		CFileHasher::HashFiles(filesToHash, 0, &m_bAbortValidation, nullptr);
+
+		for (ValidatedFile &file : validatedFiles)
+		{
+			if (file.hashIndex == -1)
+				continue;
+
+			const CFileHasher::File &hashedFile = filesToHash[file.hashIndex];
 
-	if (filesPassed + filesFailed != filesChecked)
+			if (!hashedFile.hashed)
+				file.message = file.filename + " can't be read: " + hashedFile.error + "\n";
+			else if (hashedFile.hash != file.metaHash)
+				file.isModified = true;
+		}
+
+		return std::move(validatedFiles);
+	});
+}
+
+void CUpdateInstaller::UpdateValidationStatus()
+{
+	if (!IsFutureReady(m_ValidationResult))
+		return;
+
+	std::vector<ValidatedFile> validatedFiles = m_ValidationResult.get();
+	m_ValidationResult = std::future<std::vector<ValidatedFile>>();
+
+	int filesChecked = 0;
+	int filesFailed = 0;
+
+	for (const ValidatedFile &file : validatedFiles)
 	{
-		ConPrintf(ConColor::Red, "File number mismatch: %d + %d != %d\nThis should never happen.\n", filesPassed, filesFailed, filesChecked);
+		bool isValid = false;
+
+		if (!file.message.empty())
+		{
+			ConPrintf("%s", file.message.c_str());
+		}
+		else if (file.isModified)
+		{
+			if (file.isUserModifiable)
+			{
+				ConPrintf("%s is user-modified\n", file.filename.c_str());
+				isValid = true;
+			}
+			else
+			{
+				ConPrintf("%s is modified\n", file.filename.c_str());
+			}
+		}
+		else
+		{
+			isValid = true;
+		}
+
+		if (!isValid)
+			filesFailed++;
+		filesChecked++;
 	}
 
+	ConPrintf("\n");
+
 	if (filesFailed == 0)
 	{
 		ConPrintf("All %d files validated successfully.\n", filesChecked);
@@ -1682,3 +1700,8 @@ CON_COMMAND(bhl_validate_files, "Validates integrity of BugfixedHL (Enriched) fi
 
 	ConPrintf(ConColor::Cyan, ">>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>\n");
 }
+
+CON_COMMAND(bhl_validate_files, "Validates integrity of BugfixedHL (Enriched) files in the background")
+{
+	CUpdateInstaller::Get().ValidateFiles();
+}
@@ -52,6 +52,12 @@ public:
 	 */
 	void CancelInstallation();
 
+	/**
+	 * Checks installed files against the metadata (bhl_validate_files).
+	 * Files are hashed in the background, results are printed from RunFrame.
+	 */
+	void ValidateFiles();
+
 private:
 	using AsyncResult = std::tuple<bool, std::string>;
 
@@ -103,6 +109,22 @@ private:
 		bool metaIsUserModifiable = false;
 	};
 
+	struct ValidatedFile
+	{
+		std::string filename;
+
+		// Hash from metadata
+		std::vector<uint8_t> metaHash;
+		bool isUserModifiable = false;
+
+		// Index in the list of files to hash or -1 if it's not hashed
+		int hashIndex = -1;
+
+		// Result. The message is printed instead of the modified status if not empty.
+		bool isModified = false;
+		std::string message;
+	};
+
 	std::atomic_bool m_bIsInProcess = false;
 	std::atomic_bool m_bAbortRequested = false;
 
@@ -131,6 +153,10 @@ private:
 
 	size_t m_iFileToAskIdx = 0;
 
+	// File validation
+	std::future<std::vector<ValidatedFile>> m_ValidationResult;
+	std::atomic_bool m_bAbortValidation = false;
+
 	/**
 	 * Locates update installation directory.
 	 * Reads installed client metadata.
@@ -202,6 +228,11 @@ private:
 	 */
 	void UpdateInstallStatus();
 
+	/**
+	 * Runs every frame to print results of file validation when it has finished.
+	 */
+	void UpdateValidationStatus();
+
 	/**
 	 * Shows an error dialog and cancels the update. Can only be called from main thread.
 	 */
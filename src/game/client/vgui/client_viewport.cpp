@@ -14,6 +14,7 @@
 #include "hud/text_message.h"
 #include "hud/spectator.h"
 #include "cl_util.h"
+#include "glyph_cache.h"
 
 #include "score_panel.h"
 #include "client_motd.h"
@@ -241,6 +242,8 @@ void CClientViewport::OnThink()
 
 void CClientViewport::ApplySchemeSettings(vgui2::IScheme *pScheme)
 {
+	// Fonts may have been reloaded with a different size
+	CGlyphCache::Get().Invalidate();
 	gHUD.ApplyViewportSchemeSettings(pScheme);
 }
 
@@ -424,11 +427,6 @@ const char *CClientViewport::GetServerName()
 	return m_szServerName;
 }
 
-void CClientViewport::UpdateOnPlayerInfo(int client)
-{
-	m_pScorePanel->UpdateOnPlayerInfo(client);
-}
-
 //-------------------------------------------------------
 // Viewport messages
 //-------------------------------------------------------
@@ -571,8 +569,7 @@ void CClientViewport::MsgFunc_ScoreInfo(const char *pszName, int iSize, void *pb
 		info->m_ExtraInfo.deaths = deaths;
 		info->m_ExtraInfo.playerclass = playerclass;
 		info->m_ExtraInfo.teamnumber = clamp(teamnumber, 0, MAX_TEAMS);
-
-		UpdateOnPlayerInfo(cl);
+		info->MarkChanged(CPlayerInfo::CHANGED_SCORE);
 	}
 }
 
@@ -611,7 +608,7 @@ void CClientViewport::MsgFunc_TeamInfo(const char *pszName, int iSize, void *pbu
 		// set the players team
 		CPlayerInfo *pi = GetPlayerInfo(cl)->Update();
 		strncpy(pi->m_ExtraInfo.teamname, READ_STRING(), MAX_TEAM_NAME);
-		UpdateOnPlayerInfo(cl);
+		pi->MarkChanged(CPlayerInfo::CHANGED_TEAM);
 	}
 }
 
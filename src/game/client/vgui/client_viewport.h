@@ -143,8 +143,6 @@ private:
 	void CreateDefaultPanels();
 	void AddNewPanel(IViewportPanel *panel);
 
-	void UpdateOnPlayerInfo(int client);
-
 public:
 	// Messages
 	void MsgFunc_ValClass(const char *pszName, int iSize, void *pbuf);
@@ -174,6 +174,15 @@ CScorePanel::CScorePanel()
 
 	LoadControlSettings(VGUI2_ROOT_DIR "resource/ScorePanel.res");
 	SetVisible(false);
+
+	m_iPlayerInfoListener = CPlayerInfo::AddChangeListener([this](CPlayerInfo *pi, unsigned fields) {
+		OnPlayerInfoChanged(pi->GetIndex(), fields);
+	});
+}
+
+CScorePanel::~CScorePanel()
+{
+	CPlayerInfo::RemoveChangeListener(m_iPlayerInfoListener);
 }
 
 void CScorePanel::UpdateServerName()
@@ -196,15 +205,14 @@ void CScorePanel::EnableMousePointer(bool bEnable)
 	vgui2::input()->SetCursorPos(x, y);
 }
 
-void CScorePanel::UpdateOnPlayerInfo(int client)
+void CScorePanel::OnPlayerInfoChanged(int client, unsigned fields)
 {
+	// Everything is updated when the panel is shown
 	if (!IsVisible())
 		return;
 
-	RestoreSize();
-	UpdateClientInfo(client);
-	UpdateScoresAndCounts();
-	Resize();
+	m_ChangedClients[client] = true;
+	m_bAnyClientChanged = true;
 }
 
 void CScorePanel::DeathMsg(int killer, int victim)
@@ -248,6 +256,22 @@ void CScorePanel::OnThink()
 	{
 		UpdateAllClients();
 	}
+	else if (m_bAnyClientChanged)
+	{
+		RestoreSize();
+
+		for (int i = 1; i <= MAX_PLAYERS; i++)
+		{
+			if (m_ChangedClients[i])
+				UpdateClientInfo(i);
+		}
+
+		UpdateScoresAndCounts();
+		Resize();
+	}
+
+	m_ChangedClients.fill(false);
+	m_bAnyClientChanged = false;
 }
 
 void CScorePanel::OnCommand(const char *command)
@@ -27,6 +27,7 @@ public:
 	DECLARE_CLASS_SIMPLE(CScorePanel, vgui2::Frame);
 
 	CScorePanel();
+	~CScorePanel();
 
 	/**
 	 * Updates server name label. Called on ServerName message.
@@ -39,14 +40,14 @@ public:
 	void EnableMousePointer(bool bEnable);
 
 	/**
-	 * Updates player's score in the scoreboard.
+	 * Highlightes the killer of they killed this player.
 	 */
-	void UpdateOnPlayerInfo(int client);
+	void DeathMsg(int killer, int victim);
 
 	/**
-	 * Highlightes the killer of they killed this player.
+	 * Player info change listener. Changed clients are updated in the next OnThink.
 	 */
-	void DeathMsg(int killer, int victim);
+	void OnPlayerInfoChanged(int client, unsigned fields);
 
 	// Frame overrides
 	virtual void ApplySchemeSettings(vgui2::IScheme *pScheme) override;
@@ -68,7 +69,7 @@ private:
 	static constexpr int TEAM_SPECTATOR = MAX_TEAMS + 1;
 	static constexpr int HEADER_SECTION_ID = 0;
 	static constexpr float HIGHLIGHT_KILLER_TIME = 10.f;
-	static constexpr float UPDATE_PERIOD = 0.5f;
+	static constexpr float UPDATE_PERIOD = 2.0f; //!< Player info changes are handled immediately, this updates avatars and mute icons
 
 	enum class MenuAction
 	{
@@ -133,6 +134,10 @@ private:
 	float m_flKillerHighlightStart = 0;
 	float m_flLastUpdateTime = 0;
 
+	int m_iPlayerInfoListener = 0;
+	std::array<bool, MAX_PLAYERS + 1> m_ChangedClients = {}; //!< Clients changed since last OnThink
+	bool m_bAnyClientChanged = false;
+
 	Color m_ThisPlayerBgColor = Color(0, 0, 0, 0);
 	Color m_KillerBgColor = Color(0, 0, 0, 0);
 
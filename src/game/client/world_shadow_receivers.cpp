@@ -0,0 +1,156 @@
+#include <cstddef>
+#include <cstring>
+#include "world_shadow_receivers.h"
+
+void CWorldShadowReceivers::Clear()
+{
+	m_Vertices.clear();
+	m_Indices.clear();
+	m_Surfaces.clear();
+	m_Nodes.clear();
+	m_VisibleIndices.clear();
+	m_iVisibleIndexCount = 0;
+	m_iVisibleSurfaces = 0;
+}
+
+void CWorldShadowReceivers::Build(const std::vector<Node> &nodes, const std::vector<Surface> &surfaces)
+{
+	Clear();
+	m_Nodes.reserve(nodes.size());
+
+	auto fnAddSurface = [this](const Surface &surf) {
+		SurfaceRange range;
+		unsigned firstVertex = (unsigned)(m_Vertices.size() / 3);
+		range.pVisframe = surf.pVisframe;
+		range.firstIndex = (int)m_Indices.size();
+
+		for (int j = 0; j < surf.numVerts; j++)
+		{
+			const float *v = surf.verts + j * surf.vertexStride;
+			m_Vertices.insert(m_Vertices.end(), v, v + 3);
+		}
+
+		// Polygons are convex, draw them as fans
+		for (int j = 2; j < surf.numVerts; j++)
+		{
+			m_Indices.push_back(firstVertex);
+			m_Indices.push_back(firstVertex + j - 1);
+			m_Indices.push_back(firstVertex + j);
+		}
+
+		range.indexCount = (int)m_Indices.size() - range.firstIndex;
+		m_Surfaces.push_back(range);
+	};
+
+	for (const Node &node : nodes)
+	{
+		NodeRange range;
+		range.pVisframe = node.pVisframe;
+		range.normal = node.normal;
+		range.planeType = node.planeType;
+		range.subtreeSize = node.subtreeSize;
+		range.firstSurface = (int)m_Surfaces.size();
+
+		// Split by side so the light test is done once per side
+		for (int i = 0; i < node.surfaceCount; i++)
+		{
+			if (!surfaces[node.firstSurface + i].planeBack)
+				fnAddSurface(surfaces[node.firstSurface + i]);
+		}
+
+		range.frontCount = (int)m_Surfaces.size() - range.firstSurface;
+
+		for (int i = 0; i < node.surfaceCount; i++)
+		{
+			if (surfaces[node.firstSurface + i].planeBack)
+				fnAddSurface(surfaces[node.firstSurface + i]);
+		}
+
+		range.backCount = (int)m_Surfaces.size() - range.firstSurface - range.frontCount;
+		m_Nodes.push_back(range);
+	}
+
+	m_VisibleIndices.resize(m_Indices.size());
+}
+
+void CWorldShadowReceivers::BuildVisibleList(int visframe, int framecount, const float *lightvec)
+{
+	m_iVisibleIndexCount = 0;
+	m_iVisibleSurfaces = 0;
+
+	const NodeRange *node = m_Nodes.data();
+	const NodeRange *nodesEnd = node + m_Nodes.size();
+	const SurfaceRange *surfaces = m_Surfaces.data();
+	int runStart = 0, runEnd = 0;
+
+	while (node < nodesEnd)
+	{
+		// Nothing below a node that isn't in the PVS is visible
+		if (*node->pVisframe != visframe)
+		{
+			node += node->subtreeSize;
+			continue;
+		}
+
+		if (node->frontCount + node->backCount != 0)
+		{
+			float dot;
+
+			switch (node->planeType)
+			{
+			case PLANE_X:
+				dot = lightvec[0];
+				break;
+			case PLANE_Y:
+				dot = lightvec[1];
+				break;
+			case PLANE_Z:
+				dot = lightvec[2];
+				break;
+			default:
+				dot = lightvec[0] * node->normal[0] + lightvec[1] * node->normal[1] + lightvec[2] * node->normal[2];
+				break;
+			}
+
+			const SurfaceRange *front = surfaces + node->firstSurface;
+			const SurfaceRange *back = front + node->frontCount;
+
+			if (dot >= 0)
+				AddVisibleSurfaces(front, back, framecount, runStart, runEnd);
+
+			if (dot <= 0)
+				AddVisibleSurfaces(back, back + node->backCount, framecount, runStart, runEnd);
+		}
+
+		node++;
+	}
+
+	AddRun(runStart, runEnd);
+}
+
+void CWorldShadowReceivers::AddVisibleSurfaces(const SurfaceRange *surf, const SurfaceRange *end, int framecount, int &runStart, int &runEnd)
+{
+	for (; surf < end; surf++)
+	{
+		if (*surf->pVisframe != framecount)
+			continue;
+
+		if (surf->firstIndex != runEnd)
+		{
+			AddRun(runStart, runEnd);
+			runStart = surf->firstIndex;
+		}
+
+		runEnd = surf->firstIndex + surf->indexCount;
+		m_iVisibleSurfaces++;
+	}
+}
+
+void CWorldShadowReceivers::AddRun(int runStart, int runEnd)
+{
+	if (runStart == runEnd)
+		return;
+
+	memcpy(m_VisibleIndices.data() + m_iVisibleIndexCount, m_Indices.data() + runStart, sizeof(unsigned) * (runEnd - runStart));
+	m_iVisibleIndexCount += runEnd - runStart;
+}
@@ -0,0 +1,131 @@
+//
+// world_shadow_receivers.h
+//
+// Triangulated world surfaces that receive stencil shadows.
+//
+#ifndef WORLD_SHADOW_RECEIVERS_H
+#define WORLD_SHADOW_RECEIVERS_H
+#include <vector>
+
+/**
+ * World surface polygons triangulated once per map and stored in the order of
+ * world BSP nodes. Every frame the nodes are walked like the engine's world walk,
+ * skipping subtrees of nodes that aren't in the PVS, and triangles of visible
+ * surfaces that face the light are collected into an index list that can be
+ * drawn with one glDrawElements call.
+ */
+class CWorldShadowReceivers
+{
+public:
+	// Same as in the engine
+	static constexpr int PLANE_X = 0;
+	static constexpr int PLANE_Y = 1;
+	static constexpr int PLANE_Z = 2;
+
+	struct Surface
+	{
+		// Convex polygon, position is the first three floats of a vertex
+		const float *verts;
+		int numVerts;
+		int vertexStride;
+
+		// Surface is on the back side of the node plane
+		bool planeBack;
+
+		// Surface is visible if the value equals the frame number
+		const int *pVisframe;
+	};
+
+	struct Node
+	{
+		// Plane of the node, all its surfaces lie on it
+		const float *normal;
+		int planeType;
+
+		// Node is in the PVS if the value equals the vis frame number
+		const int *pVisframe;
+
+		// Number of nodes in the subtree including this one, nodes are in preorder
+		int subtreeSize;
+
+		// Surfaces of the node in the surface list
+		int firstSurface;
+		int surfaceCount;
+	};
+
+	/**
+	 * Removes all surfaces.
+	 */
+	void Clear();
+
+	/**
+	 * Triangulates surfaces. Previous surfaces are removed.
+	 * @param	nodes		World nodes reachable from the head node, in preorder.
+	 * @param	surfaces	Surfaces of the nodes.
+	 */
+	void Build(const std::vector<Node> &nodes, const std::vector<Surface> &surfaces);
+
+	/**
+	 * Collects triangles of surfaces that are visible in the frame and face the light.
+	 * @param	visframe	Vis frame number of nodes in the PVS.
+	 * @param	framecount	Frame number of visible surfaces.
+	 * @param	lightvec	Light direction.
+	 */
+	void BuildVisibleList(int visframe, int framecount, const float *lightvec);
+
+	inline bool IsEmpty() const { return m_Surfaces.empty(); }
+	inline int GetNodeCount() const { return (int)m_Nodes.size(); }
+	inline int GetSurfaceCount() const { return (int)m_Surfaces.size(); }
+
+	/**
+	 * Returns positions of all vertices, 3 floats per vertex.
+	 */
+	inline const float *GetVertices() const { return m_Vertices.data(); }
+	inline int GetVertexCount() const { return (int)m_Vertices.size() / 3; }
+
+	/**
+	 * Returns triangle indexes collected by BuildVisibleList.
+	 */
+	inline const unsigned *GetVisibleIndices() const { return m_VisibleIndices.data(); }
+	inline int GetVisibleIndexCount() const { return m_iVisibleIndexCount; }
+	inline int GetVisibleSurfaceCount() const { return m_iVisibleSurfaces; }
+
+private:
+	struct SurfaceRange
+	{
+		const int *pVisframe;
+		int firstIndex;
+		int indexCount;
+	};
+
+	struct NodeRange
+	{
+		const int *pVisframe;
+		const float *normal;
+		int planeType;
+		int subtreeSize;
+
+		// Front surfaces, then back ones. Their indexes are consecutive.
+		int firstSurface;
+		int frontCount;
+		int backCount;
+	};
+
+	std::vector<float> m_Vertices;
+	std::vector<unsigned> m_Indices;
+	std::vector<SurfaceRange> m_Surfaces;
+	std::vector<NodeRange> m_Nodes;
+
+	// Sized for all indices so runs are copied without reallocation checks
+	std::vector<unsigned> m_VisibleIndices;
+	int m_iVisibleIndexCount = 0;
+	int m_iVisibleSurfaces = 0;
+
+	/**
+	 * Adds index ranges of visible surfaces, consecutive ranges are joined.
+	 */
+	void AddVisibleSurfaces(const SurfaceRange *surf, const SurfaceRange *end, int framecount, int &runStart, int &runEnd);
+	void AddRun(int runStart, int runEnd);
+};
+
+#endif
@@ -326,6 +326,7 @@ void CFlockingFlyer ::SpawnCommonCode()
 {
 	pev->deadflag = DEAD_NO;
 	pev->classname = MAKE_STRING("monster_flyer");
+	UTIL_UpdateEntityNames(ENT(pev));
 	pev->solid = SOLID_SLIDEBOX;
 	pev->movetype = MOVETYPE_FLY;
 	pev->takedamage = DAMAGE_NO;
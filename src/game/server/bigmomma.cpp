@@ -1098,6 +1098,7 @@ void CBMortar::Spawn(void)
 {
 	pev->movetype = MOVETYPE_TOSS;
 	pev->classname = MAKE_STRING("bmortar");
+	UTIL_UpdateEntityNames(ENT(pev));
 
 	pev->solid = SOLID_BBOX;
 	pev->rendermode = kRenderTransAlpha;
@@ -83,6 +83,7 @@ void CSquidSpit::Spawn(void)
 {
 	pev->movetype = MOVETYPE_FLY;
 	pev->classname = MAKE_STRING("squidspit");
+	UTIL_UpdateEntityNames(ENT(pev));
 
 	pev->solid = SOLID_BBOX;
 	pev->rendermode = kRenderTransAlpha;
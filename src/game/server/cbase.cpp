@@ -92,7 +92,7 @@ static DLL_FUNCTIONS gFunctionTable = {
 };
 
 NEW_DLL_FUNCTIONS gNewDLLFunctions = {
-	nullptr,
+	OnFreeEntPrivateData, //pfnOnFreeEntPrivateData
 	nullptr,
 	nullptr,
 	nullptr,
@@ -156,6 +156,10 @@ int DispatchSpawn(edict_t *pent)
 
 		if (pEntity)
 		{
+			// Entities that don't link to the world aren't in the grid yet
+			UTIL_UpdateEntityGrid(pent);
+			UTIL_UpdateEntityNames(pent);
+
 			if (g_pGameRules && !g_pGameRules->IsAllowedToSpawn(pEntity))
 				return -1; // return that this entity should be deleted
 			if (pEntity->pev->flags & FL_KILLME)
@@ -193,6 +197,7 @@ void DispatchKeyValue(edict_t *pentKeyvalue, KeyValueData *pkvd)
 		return;
 
 	EntvarsKeyvalue(VARS(pentKeyvalue), pkvd);
+	UTIL_UpdateEntityNames(pentKeyvalue);
 
 	// If the key was an entity variable, or there's no class set yet, don't look for the object, it may
 	// not exist yet.
@@ -369,6 +374,10 @@ int DispatchRestore(edict_t *pent, SAVERESTOREDATA *pSaveData, int globalEntity)
 		// Again, could be deleted, get the pointer again.
 		pEntity = (CBaseEntity *)GET_PRIVATE(pent);
 
+		// Restored names must be found by entities restored after this one
+		if (pEntity)
+			UTIL_UpdateEntityNames(pent);
+
 #if 0
 		if ( pEntity && pEntity->pev->globalname && globalEntity ) 
 		{
@@ -421,6 +430,17 @@ void DispatchObjectCollsionBox(edict_t *pent)
 	}
 	else
 		SetObjectCollisionBox(&pent->v);
+
+	UTIL_UpdateEntityGrid(pent);
+
+	// Catches names set directly before the entity was linked
+	UTIL_UpdateEntityNames(pent);
+}
+
+void OnFreeEntPrivateData(edict_t *pEnt)
+{
+	UTIL_RemoveFromEntityGrid(pEnt);
+	UTIL_RemoveFromEntityNames(pEnt);
 }
 
 void SaveWriteFields(SAVERESTOREDATA *pSaveData, const char *pname, void *pBaseData, TYPEDESCRIPTION *pFields, int fieldCount)
@@ -66,6 +66,7 @@ extern void DispatchBlocked(edict_t *pentBlocked, edict_t *pentOther);
 extern void DispatchSave(edict_t *pent, SAVERESTOREDATA *pSaveData);
 extern int DispatchRestore(edict_t *pent, SAVERESTOREDATA *pSaveData, int globalEntity);
 extern void DispatchObjectCollsionBox(edict_t *pent);
+extern void OnFreeEntPrivateData(edict_t *pEnt);
 extern void SaveWriteFields(SAVERESTOREDATA *pSaveData, const char *pname, void *pBaseData, TYPEDESCRIPTION *pFields, int fieldCount);
 extern void SaveReadFields(SAVERESTOREDATA *pSaveData, const char *pname, void *pBaseData, TYPEDESCRIPTION *pFields, int fieldCount);
 extern void SaveGlobalState(SAVERESTOREDATA *pSaveData);
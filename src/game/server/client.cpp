@@ -41,6 +41,7 @@
 #include "path.h"
 #include <ctype.h>
 #include "CBugfixedServer.h"
+#include "entity_snapshot.h"
 
 extern DLL_GLOBAL ULONG g_ulModelIndexPlayer;
 extern DLL_GLOBAL BOOL g_fGameOver;
@@ -52,6 +53,9 @@ extern int gmsgSayText;
 
 extern int g_teamplay;
 
+// Client-independent part of AddToFullPack states
+static CEntitySnapshot g_EntitySnapshot;
+
 void LinkUserMessages(void);
 
 char g_checkedPlayerModels[MAX_PLAYERS][MAX_TEAM_NAME]; // Used to store checked player model name
@@ -487,6 +491,9 @@ void ClientCommand(edict_t *pEntity)
 	if (!pPlayer || !pPlayer->IsConnected())
 		return;
 
+	// Commands can change entities while the server is paused and StartFrame isn't called
+	g_EntitySnapshot.NewFrame();
+
 	if (FStrEq(pcmd, "say"))
 	{
 		Host_Say(pEntity, 0);
@@ -738,6 +745,9 @@ void ServerDeactivate(void)
 
 	// Peform any shutdown operations here...
 	//
+	UTIL_ClearEntityGrid();
+	UTIL_ClearEntityNames();
+	g_EntitySnapshot.Clear();
 }
 
 void ServerActivate(edict_t *pEdictList, int edictCount, int clientMax)
@@ -749,6 +759,8 @@ void ServerActivate(edict_t *pEdictList, int edictCount, int clientMax)
 	ASSERT(g_serveractive == 0);
 	g_serveractive = 1;
 
+	g_EntitySnapshot.Init(pEdictList, clientMax, gpGlobals->pStringBase, g_engfuncs.pfnModelIndex);
+
 	// Clients have not been initialized yet
 	for (i = 0; i < edictCount; i++)
 	{
@@ -827,6 +839,10 @@ void ParmsChangeLevel(void)
 //
 void StartFrame(void)
 {
+	UTIL_SyncEntityGrid();
+	UTIL_SyncEntityNames();
+	g_EntitySnapshot.NewFrame();
+
 	if (g_pGameRules)
 		g_pGameRules->Think();
 
@@ -1139,8 +1155,6 @@ we could also use the pas/ pvs that we set in SetupVisibility, if we wanted to.
 */
 int AddToFullPack(struct entity_state_s *state, int e, edict_t *ent, edict_t *host, int hostflags, int player, unsigned char *pSet)
 {
-	int i;
-
 	// don't send if flagged for NODRAW and it's not the host getting the message
 	if ((ent->v.effects == EF_NODRAW) && (ent != host))
 		return 0;
@@ -1194,132 +1208,7 @@ int AddToFullPack(struct entity_state_s *state, int e, edict_t *ent, edict_t *ho
 		UTIL_UnsetGroupTrace();
 	}
 
-	memset(state, 0, sizeof(*state));
-
-	// Assign index so we can track this entity from frame to frame and
-	//  delta from it.
-	state->number = e;
-	state->entityType = ENTITY_NORMAL;
-
-	// Flag custom entities.
-	if (ent->v.flags & FL_CUSTOMENTITY)
-	{
-		state->entityType = ENTITY_BEAM;
-	}
-
-	//
-	// Copy state data
-	//
-
-	// Round animtime to nearest millisecond
-	state->animtime = (int)(1000.0 * ent->v.animtime) / 1000.0;
-
-	memcpy(state->origin, ent->v.origin, 3 * sizeof(float));
-	memcpy(state->angles, ent->v.angles, 3 * sizeof(float));
-	memcpy(state->mins, ent->v.mins, 3 * sizeof(float));
-	memcpy(state->maxs, ent->v.maxs, 3 * sizeof(float));
-
-	memcpy(state->startpos, ent->v.startpos, 3 * sizeof(float));
-	memcpy(state->endpos, ent->v.endpos, 3 * sizeof(float));
-
-	state->impacttime = ent->v.impacttime;
-	state->starttime = ent->v.starttime;
-
-	state->modelindex = ent->v.modelindex;
-
-	state->frame = ent->v.frame;
-
-	state->skin = ent->v.skin;
-	state->effects = ent->v.effects;
-
-	// This non-player entity is being moved by the game .dll and not the physics simulation system
-	//  make sure that we interpolate it's position on the client if it moves
-	if (!player && ent->v.animtime && ent->v.velocity[0] == 0 && ent->v.velocity[1] == 0 && ent->v.velocity[2] == 0)
-	{
-		state->eflags |= EFLAG_SLERP;
-	}
-
-	state->scale = ent->v.scale;
-	state->solid = ent->v.solid;
-	state->colormap = ent->v.colormap;
-
-	state->movetype = ent->v.movetype;
-	state->sequence = ent->v.sequence;
-	state->framerate = ent->v.framerate;
-	state->body = ent->v.body;
-
-	for (i = 0; i < 4; i++)
-	{
-		state->controller[i] = ent->v.controller[i];
-	}
-
-	for (i = 0; i < 2; i++)
-	{
-		state->blending[i] = ent->v.blending[i];
-	}
-
-	state->rendermode = ent->v.rendermode;
-	state->renderamt = ent->v.renderamt;
-	state->renderfx = ent->v.renderfx;
-	state->rendercolor.r = ent->v.rendercolor.x;
-	state->rendercolor.g = ent->v.rendercolor.y;
-	state->rendercolor.b = ent->v.rendercolor.z;
-
-	state->aiment = 0;
-	if (ent->v.aiment)
-	{
-		state->aiment = ENTINDEX(ent->v.aiment);
-		// Change ent for egon beam for spectators to look like it goes from the client weapon if in first person mode
-		if (state->entityType == ENTITY_BEAM && host->v.iuser1 == OBS_IN_EYE && host->v.iuser2 == state->aiment)
-		{
-			state->aiment = ENTINDEX(host);
-			state->skin = (state->aiment & 0x0FFF) | (state->skin & 0xF000);
-		}
-	}
-
-	state->owner = 0;
-	if (ent->v.owner)
-	{
-		int owner = ENTINDEX(ent->v.owner);
-
-		// Only care if owned by a player
-		if (owner >= 1 && owner <= gpGlobals->maxClients)
-		{
-			state->owner = owner;
-		}
-	}
-
-	// HACK:  Somewhat...
-	// Class is overridden for non-players to signify a breakable glass object ( sort of a class? )
-	if (!player)
-	{
-		state->playerclass = ent->v.playerclass;
-	}
-
-	// Special stuff for players only
-	if (player)
-	{
-		memcpy(state->basevelocity, ent->v.basevelocity, 3 * sizeof(float));
-
-		state->weaponmodel = MODEL_INDEX(STRING(ent->v.weaponmodel));
-		state->gaitsequence = ent->v.gaitsequence;
-		state->spectator = ent->v.flags & FL_SPECTATOR;
-		state->friction = ent->v.friction;
-
-		state->gravity = ent->v.gravity;
-
-		if (ent->v.iuser1)
-			state->team = -1; // Set team if player is spectator. This will enable "Cancel" button in team menu.
-
-		state->usehull = (ent->v.flags & FL_DUCKING) ? 1 : 0;
-		state->health = ent->v.health;
-	}
-
-	if (ent->v.renderfx == kRenderFxDeadPlayer)
-	{
-		state->movetype = MOVETYPE_NONE;
-		state->solid = SOLID_NOT;
-	}
+	g_EntitySnapshot.GetState(state, e, ent, host, player);
 
 	return 1;
 }
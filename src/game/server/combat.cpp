@@ -770,6 +770,7 @@ void CGib ::Spawn(const char *szGibModel)
 	pev->renderfx = kRenderFxNone;
 	pev->solid = SOLID_SLIDEBOX; /// hopefully this will fix the VELOCITY TOO LOW crap
 	pev->classname = MAKE_STRING("gib");
+	UTIL_UpdateEntityNames(ENT(pev));
 
 	SET_MODEL(ENT(pev), szGibModel);
 	UTIL_SetSize(pev, Vector(0, 0, 0), Vector(0, 0, 0));
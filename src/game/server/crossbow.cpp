@@ -53,6 +53,7 @@ CCrossbowBolt *CCrossbowBolt::BoltCreate(void)
 	// Create a new entity with CCrossbowBolt private data
 	CCrossbowBolt *pBolt = GetClassPtr((CCrossbowBolt *)NULL);
 	pBolt->pev->classname = MAKE_STRING("bolt");
+	UTIL_UpdateEntityNames(pBolt->edict());
 	pBolt->Spawn();
 
 	return pBolt;
@@ -212,6 +212,7 @@ CBeam *CBeam::BeamCreate(const char *pSpriteName, int width)
 	// Create a new entity with CBeam private data
 	CBeam *pBeam = GetClassPtr((CBeam *)NULL);
 	pBeam->pev->classname = MAKE_STRING("beam");
+	UTIL_UpdateEntityNames(pBeam->edict());
 
 	pBeam->BeamInit(pSpriteName, width);
 
@@ -1186,6 +1187,7 @@ CSprite *CSprite::SpriteCreate(const char *pSpriteName, const Vector &origin, BO
 	CSprite *pSprite = GetClassPtr((CSprite *)NULL);
 	pSprite->SpriteInit(pSpriteName, origin);
 	pSprite->pev->classname = MAKE_STRING("env_sprite");
+	UTIL_UpdateEntityNames(pSprite->edict());
 	pSprite->pev->solid = SOLID_NOT;
 	pSprite->pev->movetype = MOVETYPE_NOCLIP;
 	if (animate)
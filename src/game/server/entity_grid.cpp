@@ -0,0 +1,178 @@
+#include <algorithm>
+#include <cmath>
+#include "entity_grid.h"
+
+static void RemoveFromList(std::vector<int> &list, int id)
+{
+	auto it = std::find(list.begin(), list.end(), id);
+
+	if (it != list.end())
+	{
+		*it = list.back();
+		list.pop_back();
+	}
+}
+
+CEntityGrid::CEntityGrid()
+    : m_Cells(GRID_SIZE * GRID_SIZE)
+{
+}
+
+void CEntityGrid::Clear()
+{
+	for (std::vector<int> &cell : m_Cells)
+		cell.clear();
+
+	m_Large.clear();
+	m_Entries.clear();
+	m_QueryMarks.clear();
+	m_uQueryMark = 0;
+	m_iCount = 0;
+}
+
+void CEntityGrid::Update(int id, const float *mins, const float *maxs)
+{
+	if (id < 0)
+		return;
+
+	if (id >= (int)m_Entries.size())
+	{
+		m_Entries.resize(id + 1);
+		m_QueryMarks.resize(id + 1, 0);
+	}
+
+	Entry &entry = m_Entries[id];
+
+	for (int i = 0; i < 3; i++)
+	{
+		entry.mins[i] = mins[i];
+		entry.maxs[i] = maxs[i];
+	}
+
+	int cellMins[2] = { CellCoord(mins[0]), CellCoord(mins[1]) };
+	int cellMaxs[2] = { CellCoord(maxs[0]), CellCoord(maxs[1]) };
+
+	// Most updates are small moves within the same cells
+	if (entry.linked && cellMins[0] == entry.cellMins[0] && cellMins[1] == entry.cellMins[1] && cellMaxs[0] == entry.cellMaxs[0] && cellMaxs[1] == entry.cellMaxs[1])
+		return;
+
+	if (entry.linked)
+		Unlink(id);
+
+	entry.cellMins[0] = cellMins[0];
+	entry.cellMins[1] = cellMins[1];
+	entry.cellMaxs[0] = cellMaxs[0];
+	entry.cellMaxs[1] = cellMaxs[1];
+	Link(id);
+}
+
+void CEntityGrid::Remove(int id)
+{
+	if (Contains(id))
+		Unlink(id);
+}
+
+bool CEntityGrid::Contains(int id) const
+{
+	return id >= 0 && id < (int)m_Entries.size() && m_Entries[id].linked;
+}
+
+void CEntityGrid::Query(const float *mins, const float *maxs, std::vector<int> &ids)
+{
+	ids.clear();
+
+	// Boxes that cover several cells are found more than once
+	if (++m_uQueryMark == 0)
+	{
+		std::fill(m_QueryMarks.begin(), m_QueryMarks.end(), 0);
+		m_uQueryMark = 1;
+	}
+
+	int x0 = CellCoord(mins[0]);
+	int y0 = CellCoord(mins[1]);
+	int x1 = CellCoord(maxs[0]);
+	int y1 = CellCoord(maxs[1]);
+
+	for (int y = y0; y <= y1; y++)
+	{
+		for (int x = x0; x <= x1; x++)
+		{
+			for (int id : m_Cells[y * GRID_SIZE + x])
+			{
+				if (m_QueryMarks[id] == m_uQueryMark)
+					continue;
+
+				m_QueryMarks[id] = m_uQueryMark;
+
+				if (Intersects(m_Entries[id], mins, maxs))
+					ids.push_back(id);
+			}
+		}
+	}
+
+	for (int id : m_Large)
+	{
+		if (Intersects(m_Entries[id], mins, maxs))
+			ids.push_back(id);
+	}
+
+	std::sort(ids.begin(), ids.end());
+}
+
+int CEntityGrid::CellCoord(float f)
+{
+	float cell = std::floor(f / CELL_SIZE) + GRID_SIZE / 2;
+
+	// Also catches NaN
+	if (!(cell >= 0))
+		return 0;
+
+	if (cell >= GRID_SIZE - 1)
+		return GRID_SIZE - 1;
+
+	return (int)cell;
+}
+
+bool CEntityGrid::Intersects(const Entry &entry, const float *mins, const float *maxs)
+{
+	return !(mins[0] > entry.maxs[0] || mins[1] > entry.maxs[1] || mins[2] > entry.maxs[2] || maxs[0] < entry.mins[0] || maxs[1] < entry.mins[1] || maxs[2] < entry.mins[2]);
+}
+
+void CEntityGrid::Link(int id)
+{
+	Entry &entry = m_Entries[id];
+	entry.linked = true;
+	entry.large = entry.cellMaxs[0] - entry.cellMins[0] >= MAX_CELL_SPAN || entry.cellMaxs[1] - entry.cellMins[1] >= MAX_CELL_SPAN;
+	m_iCount++;
+
+	if (entry.large)
+	{
+		m_Large.push_back(id);
+		return;
+	}
+
+	for (int y = entry.cellMins[1]; y <= entry.cellMaxs[1]; y++)
+	{
+		for (int x = entry.cellMins[0]; x <= entry.cellMaxs[0]; x++)
+			m_Cells[y * GRID_SIZE + x].push_back(id);
+	}
+}
+
+void CEntityGrid::Unlink(int id)
+{
+	Entry &entry = m_Entries[id];
+	entry.linked = false;
+	m_iCount--;
+
+	if (entry.large)
+	{
+		RemoveFromList(m_Large, id);
+		return;
+	}
+
+	for (int y = entry.cellMins[1]; y <= entry.cellMaxs[1]; y++)
+	{
+		for (int x = entry.cellMins[0]; x <= entry.cellMaxs[0]; x++)
+			RemoveFromList(m_Cells[y * GRID_SIZE + x], id);
+	}
+}
@@ -0,0 +1,85 @@
+//
+// entity_grid.h
+//
+// Uniform grid of entity bounding boxes for area queries.
+//
+#ifndef ENTITY_GRID_H
+#define ENTITY_GRID_H
+#include <vector>
+
+/**
+ * Bounding boxes indexed by entity number in a grid of cells on the XY plane.
+ * Boxes that cover too many cells are kept in a separate list that is
+ * checked on every query.
+ */
+class CEntityGrid
+{
+public:
+	static constexpr float CELL_SIZE = 256.0f;
+	static constexpr int GRID_SIZE = 64; //!< Cells per axis, boxes outside of +-8192 go to the border cells
+	static constexpr int MAX_CELL_SPAN = 4; //!< Boxes wider than this number of cells go to the large list
+
+	CEntityGrid();
+
+	/**
+	 * Removes all boxes.
+	 */
+	void Clear();
+
+	/**
+	 * Adds a box or moves it if it's already in the grid.
+	 * @param	id		Entity number.
+	 * @param	mins	Box min point.
+	 * @param	maxs	Box max point.
+	 */
+	void Update(int id, const float *mins, const float *maxs);
+
+	/**
+	 * Removes a box if it's in the grid.
+	 */
+	void Remove(int id);
+
+	/**
+	 * Returns whether the grid has a box of the entity.
+	 */
+	bool Contains(int id) const;
+
+	/**
+	 * Finds boxes that touch the query box.
+	 * @param	mins	Query box min point.
+	 * @param	maxs	Query box max point.
+	 * @param	ids		Receives entity numbers in ascending order. It is cleared first.
+	 */
+	void Query(const float *mins, const float *maxs, std::vector<int> &ids);
+
+	/**
+	 * Returns the number of boxes in the grid.
+	 */
+	inline int GetCount() const { return m_iCount; }
+
+private:
+	struct Entry
+	{
+		float mins[3];
+		float maxs[3];
+		int cellMins[2];
+		int cellMaxs[2];
+		bool linked = false;
+		bool large = false;
+	};
+
+	std::vector<Entry> m_Entries;
+	std::vector<std::vector<int>> m_Cells;
+	std::vector<int> m_Large;
+	std::vector<unsigned> m_QueryMarks;
+	unsigned m_uQueryMark = 0;
+	int m_iCount = 0;
+
+	static int CellCoord(float f);
+	static bool Intersects(const Entry &entry, const float *mins, const float *maxs);
+
+	void Link(int id);
+	void Unlink(int id);
+};
+
+#endif
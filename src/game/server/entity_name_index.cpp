@@ -0,0 +1,200 @@
+#include "entity_name_index.h"
+
+void CEntityNameIndex::Clear()
+{
+	for (FieldIndex &f : m_Fields)
+	{
+		f.nodes.clear();
+		f.listIds.clear();
+		f.lists.clear();
+	}
+}
+
+void CEntityNameIndex::Update(int id, Field field, const char *pszName)
+{
+	if (id < 0)
+		return;
+
+	FieldIndex &f = m_Fields[field];
+
+	if (!pszName || !pszName[0])
+	{
+		if (id < (int)f.nodes.size())
+		{
+			Unlink(f, id);
+			f.nodes[id].source = nullptr;
+		}
+
+		return;
+	}
+
+	if (id >= (int)f.nodes.size())
+		f.nodes.resize(id + 1);
+
+	Node &node = f.nodes[id];
+
+	if (node.source == pszName && node.list != -1)
+		return;
+
+	node.source = pszName;
+
+	// Different string with the same name
+	if (node.list != -1 && f.lists[node.list].name == pszName)
+		return;
+
+	Unlink(f, id);
+
+	int listId = FindList(f, pszName);
+
+	if (listId == -1)
+	{
+		listId = (int)f.lists.size();
+		f.lists.emplace_back();
+		f.lists.back().name = pszName;
+		f.listIds.emplace(f.lists.back().name, listId);
+	}
+
+	Link(f, id, listId);
+}
+
+void CEntityNameIndex::Remove(int id)
+{
+	for (FieldIndex &f : m_Fields)
+	{
+		if (id >= 0 && id < (int)f.nodes.size())
+		{
+			Unlink(f, id);
+			f.nodes[id].source = nullptr;
+		}
+	}
+}
+
+int CEntityNameIndex::FindNext(Field field, const char *pszName, int startId) const
+{
+	const FieldIndex &f = m_Fields[field];
+	int listId = FindListOf(f, startId, pszName);
+
+	// Continue the search from the entity found last
+	if (listId != -1)
+		return f.nodes[startId].next;
+
+	listId = FindList(f, pszName);
+
+	if (listId == -1)
+		return -1;
+
+	int id = f.lists[listId].head;
+
+	while (id != -1 && id <= startId)
+		id = f.nodes[id].next;
+
+	return id;
+}
+
+int CEntityNameIndex::FindPrev(Field field, const char *pszName, int startId) const
+{
+	const FieldIndex &f = m_Fields[field];
+	int listId = FindListOf(f, startId, pszName);
+
+	if (listId != -1)
+		return f.nodes[startId].prev;
+
+	listId = FindList(f, pszName);
+
+	if (listId == -1)
+		return -1;
+
+	int id = f.lists[listId].tail;
+
+	while (id != -1 && id >= startId)
+		id = f.nodes[id].prev;
+
+	return id;
+}
+
+int CEntityNameIndex::GetCount(Field field, const char *pszName) const
+{
+	const FieldIndex &f = m_Fields[field];
+	int listId = FindList(f, pszName);
+
+	if (listId == -1)
+		return 0;
+
+	return f.lists[listId].count;
+}
+
+int CEntityNameIndex::FindList(const FieldIndex &f, const char *pszName)
+{
+	auto it = f.listIds.find(pszName);
+
+	if (it == f.listIds.end())
+		return -1;
+
+	return it->second;
+}
+
+int CEntityNameIndex::FindListOf(const FieldIndex &f, int id, const char *pszName)
+{
+	if (id < 0 || id >= (int)f.nodes.size())
+		return -1;
+
+	int listId = f.nodes[id].list;
+
+	if (listId == -1 || f.lists[listId].name != pszName)
+		return -1;
+
+	return listId;
+}
+
+void CEntityNameIndex::Link(FieldIndex &f, int id, int listId)
+{
+	List &list = f.lists[listId];
+	Node &node = f.nodes[id];
+
+	// New entities usually have the highest number, search from the tail
+	int prev = list.tail;
+
+	while (prev != -1 && prev > id)
+		prev = f.nodes[prev].prev;
+
+	node.list = listId;
+	node.prev = prev;
+	node.next = prev != -1 ? f.nodes[prev].next : list.head;
+
+	if (node.prev != -1)
+		f.nodes[node.prev].next = id;
+	else
+		list.head = id;
+
+	if (node.next != -1)
+		f.nodes[node.next].prev = id;
+	else
+		list.tail = id;
+
+	list.count++;
+}
+
+void CEntityNameIndex::Unlink(FieldIndex &f, int id)
+{
+	Node &node = f.nodes[id];
+
+	if (node.list == -1)
+		return;
+
+	List &list = f.lists[node.list];
+
+	if (node.prev != -1)
+		f.nodes[node.prev].next = node.next;
+	else
+		list.head = node.next;
+
+	if (node.next != -1)
+		f.nodes[node.next].prev = node.prev;
+	else
+		list.tail = node.prev;
+
+	list.count--;
+	node.list = -1;
+	node.prev = -1;
+	node.next = -1;
+}
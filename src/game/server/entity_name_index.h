@@ -0,0 +1,97 @@
+//
+// entity_name_index.h
+//
+// Index of entities by classname and targetname.
+//
+#ifndef ENTITY_NAME_INDEX_H
+#define ENTITY_NAME_INDEX_H
+#include <deque>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * Entity numbers grouped by name. Entities with the same name are linked
+ * into a list sorted by entity number, so the next entity after the one
+ * found last is found in constant time and the first one in O(matches).
+ */
+class CEntityNameIndex
+{
+public:
+	enum Field
+	{
+		CLASSNAME = 0,
+		TARGETNAME,
+		FIELD_COUNT,
+	};
+
+	/**
+	 * Removes all entities and names.
+	 */
+	void Clear();
+
+	/**
+	 * Sets a name of an entity. Names are copied.
+	 * @param	id		Entity number.
+	 * @param	field	Name field.
+	 * @param	pszName	Name. nullptr or an empty string removes the entity from the field.
+	 *					The same pointer as in the last call is assumed to be the same name.
+	 */
+	void Update(int id, Field field, const char *pszName);
+
+	/**
+	 * Removes an entity from all fields.
+	 */
+	void Remove(int id);
+
+	/**
+	 * Finds the entity with the lowest number above startId.
+	 * @returns	Entity number or -1.
+	 */
+	int FindNext(Field field, const char *pszName, int startId) const;
+
+	/**
+	 * Finds the entity with the highest number below startId.
+	 * @returns	Entity number or -1.
+	 */
+	int FindPrev(Field field, const char *pszName, int startId) const;
+
+	/**
+	 * Returns the number of entities with the name.
+	 */
+	int GetCount(Field field, const char *pszName) const;
+
+private:
+	struct Node
+	{
+		const char *source = nullptr; //!< Pointer passed to Update
+		int list = -1;
+		int prev = -1;
+		int next = -1;
+	};
+
+	struct List
+	{
+		std::string name;
+		int head = -1;
+		int tail = -1;
+		int count = 0;
+	};
+
+	struct FieldIndex
+	{
+		std::vector<Node> nodes; //!< Indexed by entity number
+		std::deque<List> lists;
+		std::unordered_map<std::string_view, int> listIds; //!< Keys point to List::name
+	};
+
+	FieldIndex m_Fields[FIELD_COUNT];
+
+	static int FindList(const FieldIndex &f, const char *pszName);
+	static int FindListOf(const FieldIndex &f, int id, const char *pszName);
+	static void Link(FieldIndex &f, int id, int listId);
+	static void Unlink(FieldIndex &f, int id);
+};
+
+#endif
@@ -0,0 +1,214 @@
+#include <cstring>
+#include "extdll.h"
+#include "pm_shared.h"
+#include "entity_snapshot.h"
+
+void CEntitySnapshot::Init(const edict_t *pEdicts, int maxClients, const char *pStringBase, ModelIndexFn pfnModelIndex)
+{
+	Clear();
+	m_pEdicts = pEdicts;
+	m_iMaxClients = maxClients;
+	m_pStringBase = pStringBase;
+	m_pfnModelIndex = pfnModelIndex;
+}
+
+void CEntitySnapshot::Clear()
+{
+	m_Entries.clear();
+	m_WeaponModels.clear();
+	m_uFrame = 1;
+}
+
+void CEntitySnapshot::NewFrame()
+{
+	m_uFrame++;
+
+	// Frame 0 marks entries that were never built
+	if (m_uFrame == 0)
+	{
+		for (Entry &entry : m_Entries)
+			entry.frame = 0;
+
+		m_uFrame = 1;
+	}
+}
+
+void CEntitySnapshot::GetState(entity_state_t *state, int e, const edict_t *ent, const edict_t *host, int player)
+{
+	if (e >= (int)m_Entries.size())
+		m_Entries.resize(e + 1);
+
+	Entry &entry = m_Entries[e];
+
+	if (entry.frame != m_uFrame)
+	{
+		BuildState(&entry.state, e, ent, player);
+		entry.frame = m_uFrame;
+		entry.hasAiment = ent->v.aiment != nullptr;
+		m_iBuildCount++;
+	}
+	else
+	{
+		m_iShareCount++;
+	}
+
+	*state = entry.state;
+
+	// Change ent for egon beam for spectators to look like it goes from the client weapon if in first person mode
+	if (entry.hasAiment && state->entityType == ENTITY_BEAM && host->v.iuser1 == OBS_IN_EYE && host->v.iuser2 == state->aiment)
+	{
+		state->aiment = EntIndex(host);
+		state->skin = (state->aiment & 0x0FFF) | (state->skin & 0xF000);
+	}
+}
+
+void CEntitySnapshot::ResetCounters()
+{
+	m_iBuildCount = 0;
+	m_iShareCount = 0;
+	m_iModelLookupCount = 0;
+}
+
+void CEntitySnapshot::BuildState(entity_state_t *state, int e, const edict_t *ent, int player)
+{
+	int i;
+
+	memset(state, 0, sizeof(*state));
+
+	// Assign index so we can track this entity from frame to frame and
+	//  delta from it.
+	state->number = e;
+	state->entityType = ENTITY_NORMAL;
+
+	// Flag custom entities.
+	if (ent->v.flags & FL_CUSTOMENTITY)
+	{
+		state->entityType = ENTITY_BEAM;
+	}
+
+	//
+	// Copy state data
+	//
+
+	// Round animtime to nearest millisecond
+	state->animtime = (int)(1000.0 * ent->v.animtime) / 1000.0;
+
+	memcpy(state->origin, ent->v.origin, 3 * sizeof(float));
+	memcpy(state->angles, ent->v.angles, 3 * sizeof(float));
+	memcpy(state->mins, ent->v.mins, 3 * sizeof(float));
+	memcpy(state->maxs, ent->v.maxs, 3 * sizeof(float));
+
+	memcpy(state->startpos, ent->v.startpos, 3 * sizeof(float));
+	memcpy(state->endpos, ent->v.endpos, 3 * sizeof(float));
+
+	state->impacttime = ent->v.impacttime;
+	state->starttime = ent->v.starttime;
+
+	state->modelindex = ent->v.modelindex;
+
+	state->frame = ent->v.frame;
+
+	state->skin = ent->v.skin;
+	state->effects = ent->v.effects;
+
+	// This non-player entity is being moved by the game .dll and not the physics simulation system
+	//  make sure that we interpolate it's position on the client if it moves
+	if (!player && ent->v.animtime && ent->v.velocity[0] == 0 && ent->v.velocity[1] == 0 && ent->v.velocity[2] == 0)
+	{
+		state->eflags |= EFLAG_SLERP;
+	}
+
+	state->scale = ent->v.scale;
+	state->solid = ent->v.solid;
+	state->colormap = ent->v.colormap;
+
+	state->movetype = ent->v.movetype;
+	state->sequence = ent->v.sequence;
+	state->framerate = ent->v.framerate;
+	state->body = ent->v.body;
+
+	for (i = 0; i < 4; i++)
+	{
+		state->controller[i] = ent->v.controller[i];
+	}
+
+	for (i = 0; i < 2; i++)
+	{
+		state->blending[i] = ent->v.blending[i];
+	}
+
+	state->rendermode = ent->v.rendermode;
+	state->renderamt = ent->v.renderamt;
+	state->renderfx = ent->v.renderfx;
+	state->rendercolor.r = ent->v.rendercolor.x;
+	state->rendercolor.g = ent->v.rendercolor.y;
+	state->rendercolor.b = ent->v.rendercolor.z;
+
+	state->aiment = 0;
+	if (ent->v.aiment)
+	{
+		state->aiment = EntIndex(ent->v.aiment);
+	}
+
+	state->owner = 0;
+	if (ent->v.owner)
+	{
+		int owner = EntIndex(ent->v.owner);
+
+		// Only care if owned by a player
+		if (owner >= 1 && owner <= m_iMaxClients)
+		{
+			state->owner = owner;
+		}
+	}
+
+	// HACK:  Somewhat...
+	// Class is overridden for non-players to signify a breakable glass object ( sort of a class? )
+	if (!player)
+	{
+		state->playerclass = ent->v.playerclass;
+	}
+
+	// Special stuff for players only
+	if (player)
+	{
+		memcpy(state->basevelocity, ent->v.basevelocity, 3 * sizeof(float));
+
+		state->weaponmodel = GetWeaponModelIndex(e, ent->v.weaponmodel);
+		state->gaitsequence = ent->v.gaitsequence;
+		state->spectator = ent->v.flags & FL_SPECTATOR;
+		state->friction = ent->v.friction;
+
+		state->gravity = ent->v.gravity;
+
+		if (ent->v.iuser1)
+			state->team = -1; // Set team if player is spectator. This will enable "Cancel" button in team menu.
+
+		state->usehull = (ent->v.flags & FL_DUCKING) ? 1 : 0;
+		state->health = ent->v.health;
+	}
+
+	if (ent->v.renderfx == kRenderFxDeadPlayer)
+	{
+		state->movetype = MOVETYPE_NONE;
+		state->solid = SOLID_NOT;
+	}
+}
+
+int CEntitySnapshot::GetWeaponModelIndex(int e, string_t model)
+{
+	if (e >= (int)m_WeaponModels.size())
+		m_WeaponModels.resize(e + 1);
+
+	WeaponModel &cached = m_WeaponModels[e];
+
+	// Same string_t is the same string until map change, empty model has index 0
+	if (model != cached.model)
+	{
+		cached.model = model;
+		cached.index = m_pfnModelIndex(m_pStringBase + model);
+		m_iModelLookupCount++;
+	}
+
+	return cached.index;
+}
@@ -0,0 +1,95 @@
+//
+// entity_snapshot.h
+//
+// Entity states shared by all clients in a server frame.
+//
+#ifndef ENTITY_SNAPSHOT_H
+#define ENTITY_SNAPSHOT_H
+#include <vector>
+#include "entity_state.h"
+
+/**
+ * AddToFullPack is called for every client and entity pair. The part of
+ * the entity state that doesn't depend on the client is built on first use
+ * in a frame and copied for the other clients. Model indexes of player
+ * weapon models are cached until the model changes.
+ */
+class CEntitySnapshot
+{
+public:
+	using ModelIndexFn = int (*)(const char *name);
+
+	/**
+	 * Sets engine data of a map and removes all states.
+	 * @param	pEdicts			First edict (world).
+	 * @param	maxClients		Max number of players.
+	 * @param	pStringBase		Base of string_t offsets.
+	 * @param	pfnModelIndex	Returns index of a precached model.
+	 */
+	void Init(const edict_t *pEdicts, int maxClients, const char *pStringBase, ModelIndexFn pfnModelIndex);
+
+	/**
+	 * Removes all states and cached model indexes. Must be called on map change.
+	 */
+	void Clear();
+
+	/**
+	 * Starts a new frame. States of previous frames are rebuilt on next use.
+	 */
+	void NewFrame();
+
+	/**
+	 * Fills the state of an entity for a client.
+	 * Entity must have passed all visibility checks of AddToFullPack.
+	 * @param	state	Receives the state.
+	 * @param	e		Entity index.
+	 * @param	ent		Entity.
+	 * @param	host	Client the state is sent to.
+	 * @param	player	Whether the entity is a player.
+	 */
+	void GetState(entity_state_t *state, int e, const edict_t *ent, const edict_t *host, int player);
+
+	//! Number of states built from entvars.
+	inline int GetBuildCount() const { return m_iBuildCount; }
+
+	//! Number of states copied from a state built for another client.
+	inline int GetShareCount() const { return m_iShareCount; }
+
+	//! Number of weapon model lookups in the engine.
+	inline int GetModelLookupCount() const { return m_iModelLookupCount; }
+
+	void ResetCounters();
+
+private:
+	struct Entry
+	{
+		unsigned frame = 0;
+		bool hasAiment = false;
+		entity_state_t state;
+	};
+
+	struct WeaponModel
+	{
+		string_t model = 0;
+		int index = 0;
+	};
+
+	const edict_t *m_pEdicts = nullptr;
+	int m_iMaxClients = 0;
+	const char *m_pStringBase = nullptr;
+	ModelIndexFn m_pfnModelIndex = nullptr;
+
+	std::vector<Entry> m_Entries;
+	std::vector<WeaponModel> m_WeaponModels;
+	unsigned m_uFrame = 1;
+
+	int m_iBuildCount = 0;
+	int m_iShareCount = 0;
+	int m_iModelLookupCount = 0;
+
+	void BuildState(entity_state_t *state, int e, const edict_t *ent, int player);
+	int GetWeaponModelIndex(int e, string_t model);
+	inline int EntIndex(const edict_t *ent) const { return (int)(ent - m_pEdicts); }
+};
+
+#endif
@@ -18,6 +18,12 @@
 
 //#include "weapons.h"
 //#include "items.h"
+#include <ctime>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include "motd_cache.h"
+
 class CBasePlayerItem;
 class CBasePlayer;
 class CItem;
@@ -382,6 +388,48 @@ public:
 	 */
 	bool SendHtmlMOTDFileToClient(edict_t *client, const char *file = nullptr);
 	void SendHtmlMOTDToClient(edict_t *client, char *string);
+
+protected:
+	/**
+	 * Sends queued MOTD chunks that fit into clients' byte budgets.
+	 * Called every frame from Think.
+	 */
+	void SendQueuedMOTDs();
+
+private:
+	enum
+	{
+		MOTD_PLAIN = 0,
+		MOTD_UNICODE,
+		MOTD_HTML,
+		MOTD_TYPE_COUNT,
+	};
+
+	struct MotdFile
+	{
+		time_t mtime;
+		std::shared_ptr<const CMotdText> text;
+	};
+
+	std::unordered_map<std::string, MotdFile> m_MotdFiles[MOTD_TYPE_COUNT]; //!< Split MOTD files by file name
+	CMotdQueue m_MotdQueue;
+
+	/**
+	 * Returns a split MOTD file. The file is only read again if it was modified.
+	 * @returns the text or nullptr if the file was not found.
+	 */
+	std::shared_ptr<const CMotdText> GetMOTDFile(int type, const char *file, int maxLength);
+
+	/**
+	 * Queues a MOTD file for a client.
+	 * @returns false if the file was not found.
+	 */
+	bool QueueMOTDFile(edict_t *client, int type, int msgType, const char *file, int maxLength);
+
+	/**
+	 * Splits a string and queues it for a client.
+	 */
+	void QueueMOTDString(edict_t *client, int msgType, const char *string, int maxLength);
 };
 
 extern DLL_GLOBAL CGameRules *g_pGameRules;
@@ -105,6 +105,7 @@ void CStomp::Spawn(void)
 {
 	pev->nextthink = gpGlobals->time;
 	pev->classname = MAKE_STRING("garg_stomp");
+	UTIL_UpdateEntityNames(ENT(pev));
 	pev->dmgtime = gpGlobals->time;
 
 	pev->framerate = 30;
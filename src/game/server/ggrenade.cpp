@@ -345,6 +345,7 @@ void CGrenade::Spawn(void)
 {
 	pev->movetype = MOVETYPE_BOUNCE;
 	pev->classname = MAKE_STRING("grenade");
+	UTIL_UpdateEntityNames(ENT(pev));
 
 	pev->solid = SOLID_BBOX;
 
@@ -425,6 +426,7 @@ CGrenade *CGrenade ::ShootSatchelCharge(entvars_t *pevOwner, Vector vecStart, Ve
 	CGrenade *pGrenade = GetClassPtr((CGrenade *)NULL);
 	pGrenade->pev->movetype = MOVETYPE_BOUNCE;
 	pGrenade->pev->classname = MAKE_STRING("grenade");
+	UTIL_UpdateEntityNames(pGrenade->edict());
 
 	pGrenade->pev->solid = SOLID_BBOX;
 
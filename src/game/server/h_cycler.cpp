@@ -96,6 +96,7 @@ void CCycler ::GenericCyclerSpawn(char *szModel, Vector vecMin, Vector vecMax)
 	}
 
 	pev->classname = MAKE_STRING("cycler");
+	UTIL_UpdateEntityNames(ENT(pev));
 	PRECACHE_MODEL(szModel);
 	SET_MODEL(ENT(pev), szModel);
 
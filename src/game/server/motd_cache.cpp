@@ -0,0 +1,127 @@
+#include <algorithm>
+#include "motd_cache.h"
+
+namespace
+{
+
+inline bool IsContinuationByte(char c)
+{
+	return (c & 0xC0) == 0x80;
+}
+
+}
+
+void CMotdText::Split(const char *text, int maxLength)
+{
+	m_Data.clear();
+	m_Offsets.clear();
+	m_Lengths.clear();
+
+	int total = 0;
+	const char *p = text;
+
+	while (*p && total < maxLength)
+	{
+		int len = 0;
+
+		while (len < MAX_CHUNK && p[len])
+			len++;
+
+		if (p[len] && IsContinuationByte(p[len]))
+		{
+			// Move the end to the start of the sequence, UTF-8 sequences are at most 4 bytes long
+			int end = len;
+
+			while (end > len - 3 && end > 0 && IsContinuationByte(p[end]))
+				end--;
+
+			// Invalid UTF-8 is split as is
+			if (end > 0 && !IsContinuationByte(p[end]))
+				len = end;
+		}
+
+		m_Offsets.push_back((int)m_Data.size());
+		m_Lengths.push_back(len);
+		m_Data.insert(m_Data.end(), p, p + len);
+		m_Data.push_back('\0');
+
+		total += len;
+		p += len;
+	}
+}
+
+void CMotdQueue::Push(int client, int msgType, const std::shared_ptr<const CMotdText> &text)
+{
+	if (client < 1 || client > MAX_CLIENTS || !text || text->GetChunkCount() == 0)
+		return;
+
+	Client &cl = m_Clients[client];
+
+	if (cl.jobs.empty())
+	{
+		// Budget isn't refilled while idle
+		cl.budget = MAX_BURST;
+		m_iPendingCount++;
+	}
+
+	cl.jobs.push_back({ text, msgType, 0 });
+}
+
+void CMotdQueue::Clear(int client)
+{
+	if (client < 1 || client > MAX_CLIENTS)
+		return;
+
+	Client &cl = m_Clients[client];
+
+	if (!cl.jobs.empty())
+	{
+		cl.jobs.clear();
+		m_iPendingCount--;
+	}
+}
+
+bool CMotdQueue::IsPending(int client) const
+{
+	if (client < 1 || client > MAX_CLIENTS)
+		return false;
+
+	return !m_Clients[client].jobs.empty();
+}
+
+void CMotdQueue::Update(float frametime, const SendFn &send)
+{
+	if (m_iPendingCount == 0)
+		return;
+
+	for (int i = 1; i <= MAX_CLIENTS; i++)
+	{
+		Client &cl = m_Clients[i];
+
+		if (cl.jobs.empty())
+			continue;
+
+		cl.budget = std::min(cl.budget + BYTES_PER_SECOND * frametime, MAX_BURST);
+
+		while (!cl.jobs.empty())
+		{
+			Job &job = cl.jobs.front();
+			int size = job.text->GetChunkLength(job.nextChunk) + MESSAGE_OVERHEAD;
+
+			if (size > cl.budget)
+				break;
+
+			cl.budget -= size;
+
+			int chunk = job.nextChunk++;
+			bool isLast = job.nextChunk == job.text->GetChunkCount();
+			send(i, job.msgType, isLast, job.text->GetChunk(chunk));
+
+			if (isLast)
+				cl.jobs.pop_front();
+		}
+
+		if (cl.jobs.empty())
+			m_iPendingCount--;
+	}
+}
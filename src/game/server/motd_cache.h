@@ -0,0 +1,107 @@
+//
+// motd_cache.h
+//
+// MOTD text split into message chunks and paced delivery to clients.
+//
+#ifndef MOTD_CACHE_H
+#define MOTD_CACHE_H
+#include <deque>
+#include <functional>
+#include <memory>
+#include <vector>
+
+/**
+ * MOTD text split into chunks that fit into one MOTD message.
+ * Chunks are stored null-terminated, ready for WRITE_STRING.
+ */
+class CMotdText
+{
+public:
+	static constexpr int MAX_CHUNK = 60;
+
+	/**
+	 * Splits text into chunks of at most MAX_CHUNK bytes.
+	 * A chunk never ends in the middle of a UTF-8 sequence.
+	 * Chunks are added while total length is below maxLength.
+	 * @param	text		Null-terminated text.
+	 * @param	maxLength	Length limit of the MOTD type.
+	 */
+	void Split(const char *text, int maxLength);
+
+	inline int GetChunkCount() const { return (int)m_Offsets.size(); }
+	inline const char *GetChunk(int i) const { return m_Data.data() + m_Offsets[i]; }
+	inline int GetChunkLength(int i) const { return m_Lengths[i]; }
+
+	/**
+	 * Returns total length of all chunks.
+	 */
+	inline int GetLength() const { return (int)m_Data.size() - GetChunkCount(); }
+
+private:
+	std::vector<char> m_Data;
+	std::vector<int> m_Offsets;
+	std::vector<int> m_Lengths;
+};
+
+/**
+ * Queues of MOTDs being sent to clients.
+ * Each client gets a byte budget that is refilled over time, so a large MOTD
+ * is sent over several frames instead of overflowing the reliable channel.
+ */
+class CMotdQueue
+{
+public:
+	static constexpr int MAX_CLIENTS = 32;
+	static constexpr int MESSAGE_OVERHEAD = 4; //!< Message header, last chunk flag and null terminator
+	static constexpr float BYTES_PER_SECOND = 4096;
+	static constexpr float MAX_BURST = 1024; //!< Budget limit
+
+	/**
+	 * Called for every chunk to send.
+	 * @param	client	Client index, 1-based.
+	 * @param	msgType	Message type passed to Push.
+	 * @param	isLast	Whether this is the last chunk of the MOTD.
+	 * @param	chunk	Null-terminated chunk.
+	 */
+	using SendFn = std::function<void(int client, int msgType, bool isLast, const char *chunk)>;
+
+	/**
+	 * Queues a MOTD for a client. It's sent after MOTDs queued before.
+	 */
+	void Push(int client, int msgType, const std::shared_ptr<const CMotdText> &text);
+
+	/**
+	 * Drops all MOTDs of a client.
+	 */
+	void Clear(int client);
+
+	/**
+	 * Returns whether a client has queued MOTDs.
+	 */
+	bool IsPending(int client) const;
+
+	/**
+	 * Refills budgets and sends chunks that fit.
+	 * @param	frametime	Time since the last call.
+	 */
+	void Update(float frametime, const SendFn &send);
+
+private:
+	struct Job
+	{
+		std::shared_ptr<const CMotdText> text;
+		int msgType;
+		int nextChunk;
+	};
+
+	struct Client
+	{
+		std::deque<Job> jobs;
+		float budget = MAX_BURST;
+	};
+
+	Client m_Clients[MAX_CLIENTS + 1];
+	int m_iPendingCount = 0; //!< Number of clients with jobs
+};
+
+#endif
@@ -48,6 +48,7 @@ int CMP5::SecondaryAmmoIndex(void)
 void CMP5::Spawn()
 {
 	pev->classname = MAKE_STRING("weapon_9mmAR"); // hack to allow for old names
+	UTIL_UpdateEntityNames(ENT(pev));
 	Precache();
 	SET_MODEL(ENT(pev), "models/w_9mmAR.mdl");
 	m_iId = WEAPON_MP5;
@@ -29,6 +29,7 @@
 #include "hltv.h"
 
 #include <ctype.h>
+#include <sys/stat.h>
 
 #include <CBugfixedServer.h>
 
@@ -204,6 +205,7 @@ extern cvar_t mp_chattime;
 void CHalfLifeMultiplay ::Think(void)
 {
 	g_VoiceGameMgr.Update(gpGlobals->frametime);
+	SendQueuedMOTDs();
 
 	PM_SetBHopCapEnabled(!bunnyhop.value);
 
@@ -560,6 +562,8 @@ void CHalfLifeMultiplay ::ClientDisconnected(edict_t *pClient)
 	if (!pClient)
 		return;
 
+	m_MotdQueue.Clear(ENTINDEX(pClient));
+
 	CBasePlayer *pPlayer = (CBasePlayer *)CBaseEntity::Instance(pClient);
 	if (!pPlayer)
 		return;
@@ -1790,103 +1794,105 @@ void CHalfLifeMultiplay::SendDefaultMOTDToClient(edict_t *client)
 	}
 }
 
-#define MAX_MOTD_CHUNK  60
-#define MAX_MOTD_LENGTH 1536 // (MAX_MOTD_CHUNK * 4)
+#define MAX_MOTD_LENGTH         1536
+#define MAX_UNICODE_MOTD_LENGTH (MAX_MOTD_LENGTH * 2) // Some Unicode charachters take two or more bytes in UTF8
 
-bool CHalfLifeMultiplay::SendMOTDFileToClient(edict_t *client, const char *file /*= nullptr*/)
+// Returns modification time of a file in the game directory or 0 if it's not there
+static time_t GetGameFileTime(const char *file)
 {
-	if (!file)
-		file = (char *)CVAR_GET_STRING("motdfile");
+	char path[MAX_PATH];
+	GET_GAME_DIR(path);
+
+	std::string fullPath = std::string(path) + "/" + file;
+	struct stat st;
+
+	if (stat(fullPath.c_str(), &st) != 0)
+		return 0;
+
+	return st.st_mtime;
+}
+
+std::shared_ptr<const CMotdText> CHalfLifeMultiplay::GetMOTDFile(int type, const char *file, int maxLength)
+{
+	// Files found in other search paths have no time, they are read once per map
+	time_t mtime = GetGameFileTime(file);
+	auto it = m_MotdFiles[type].find(file);
+
+	if (it != m_MotdFiles[type].end() && it->second.mtime == mtime)
+		return it->second.text;
 
 	int length;
 	char *aFileList = (char *)LOAD_FILE_FOR_ME(const_cast<char *>(file), &length);
 	if (!aFileList)
-		return false;
-	SendMOTDToClient(client, aFileList);
+		return nullptr;
+
+	auto text = std::make_shared<CMotdText>();
+	text->Split(aFileList, maxLength);
 	FREE_FILE(aFileList);
+
+	m_MotdFiles[type][file] = { mtime, text };
+	return text;
+}
+
+bool CHalfLifeMultiplay::QueueMOTDFile(edict_t *client, int type, int msgType, const char *file, int maxLength)
+{
+	std::shared_ptr<const CMotdText> text = GetMOTDFile(type, file, maxLength);
+	if (!text)
+		return false;
+
+	m_MotdQueue.Push(ENTINDEX(client), msgType, text);
 	return true;
 }
 
-void CHalfLifeMultiplay::SendMOTDToClient(edict_t *client, char *string)
+void CHalfLifeMultiplay::QueueMOTDString(edict_t *client, int msgType, const char *string, int maxLength)
 {
-	int char_count = 0;
-	char *pFileList = string;
-	// Send the message of the day
-	// read it chunk-by-chunk,  and send it in parts
-	while (pFileList && *pFileList && char_count < MAX_MOTD_LENGTH)
-	{
-		char chunk[MAX_MOTD_CHUNK + 1];
+	if (!string)
+		return;
 
-		if (strlen(pFileList) < MAX_MOTD_CHUNK)
-		{
-			strcpy(chunk, pFileList);
-		}
-		else
-		{
-			strncpy(chunk, pFileList, MAX_MOTD_CHUNK);
-			chunk[MAX_MOTD_CHUNK] = 0; // strncpy doesn't always append the null terminator
-		}
+	auto text = std::make_shared<CMotdText>();
+	text->Split(string, maxLength);
+	m_MotdQueue.Push(ENTINDEX(client), msgType, text);
+}
 
-		char_count += strlen(chunk);
-		if (char_count < MAX_MOTD_LENGTH)
-			pFileList = string + char_count;
-		else
-			*pFileList = 0;
+void CHalfLifeMultiplay::SendQueuedMOTDs()
+{
+	// Large MOTDs are sent over several frames to not overflow the reliable channel
+	m_MotdQueue.Update(gpGlobals->frametime, [](int client, int msgType, bool isLast, const char *chunk) {
+		edict_t *pEdict = INDEXENT(client);
+		if (FNullEnt(pEdict) || pEdict->free)
+			return;
 
-		MESSAGE_BEGIN(MSG_ONE, gmsgMOTD, NULL, client);
-		WRITE_BYTE(*pFileList ? FALSE : TRUE); // FALSE means there is still more message to come
+		MESSAGE_BEGIN(MSG_ONE, msgType, NULL, pEdict);
+		WRITE_BYTE(isLast ? TRUE : FALSE); // FALSE means there is still more message to come
 		WRITE_STRING(chunk);
 		MESSAGE_END();
-	}
+	});
 }
 
-#define MAX_UNICODE_MOTD_LENGTH (MAX_MOTD_LENGTH * 2) // Some Unicode charachters take two or more bytes in UTF8
+bool CHalfLifeMultiplay::SendMOTDFileToClient(edict_t *client, const char *file /*= nullptr*/)
+{
+	if (!file)
+		file = (char *)CVAR_GET_STRING("motdfile");
+
+	return QueueMOTDFile(client, MOTD_PLAIN, gmsgMOTD, file, MAX_MOTD_LENGTH);
+}
+
+void CHalfLifeMultiplay::SendMOTDToClient(edict_t *client, char *string)
+{
+	QueueMOTDString(client, gmsgMOTD, string, MAX_MOTD_LENGTH);
+}
 
 bool CHalfLifeMultiplay::SendUnicodeMOTDFileToClient(edict_t *client, const char *file /*= nullptr*/)
 {
 	if (!file)
 		file = (char *)CVAR_GET_STRING("motdfile_unicode");
 
-	int length;
-	char *aFileList = (char *)LOAD_FILE_FOR_ME(const_cast<char *>(file), &length);
-	if (!aFileList)
-		return false;
-	SendUnicodeMOTDToClient(client, aFileList);
-	FREE_FILE(aFileList);
-	return true;
+	return QueueMOTDFile(client, MOTD_UNICODE, gmsgMOTD, file, MAX_UNICODE_MOTD_LENGTH);
 }
 
 void CHalfLifeMultiplay::SendUnicodeMOTDToClient(edict_t *client, char *string)
 {
-	int char_count = 0;
-	char *pFileList = string;
-	// Send the message of the day
-	// read it chunk-by-chunk,  and send it in parts
-	while (pFileList && *pFileList && char_count < MAX_UNICODE_MOTD_LENGTH)
-	{
-		char chunk[MAX_MOTD_CHUNK + 1];
-
-		if (strlen(pFileList) < MAX_MOTD_CHUNK)
-		{
-			strcpy(chunk, pFileList);
-		}
-		else
-		{
-			strncpy(chunk, pFileList, MAX_MOTD_CHUNK);
-			chunk[MAX_MOTD_CHUNK] = 0; // strncpy doesn't always append the null terminator
-		}
-
-		char_count += strlen(chunk);
-		if (char_count < MAX_UNICODE_MOTD_LENGTH)
-			pFileList = string + char_count;
-		else
-			*pFileList = 0;
-
-		MESSAGE_BEGIN(MSG_ONE, gmsgMOTD, NULL, client);
-		WRITE_BYTE(*pFileList ? FALSE : TRUE); // FALSE means there is still more message to come
-		WRITE_STRING(chunk);
-		MESSAGE_END();
-	}
+	QueueMOTDString(client, gmsgMOTD, string, MAX_UNICODE_MOTD_LENGTH);
 }
 
 bool CHalfLifeMultiplay::SendHtmlMOTDFileToClient(edict_t *client, const char *file /*= nullptr*/)
@@ -1894,44 +1900,10 @@ bool CHalfLifeMultiplay::SendHtmlMOTDFileToClient(edict_t *client, const char *f
 	if (!file)
 		file = (char *)CVAR_GET_STRING("motdfile_html");
 
-	int length;
-	char *aFileList = (char *)LOAD_FILE_FOR_ME(const_cast<char *>(file), &length);
-	if (!aFileList)
-		return false;
-	SendHtmlMOTDToClient(client, aFileList);
-	FREE_FILE(aFileList);
-	return true;
+	return QueueMOTDFile(client, MOTD_HTML, gmsgHtmlMOTD, file, MAX_UNICODE_MOTD_LENGTH);
 }
 
 void CHalfLifeMultiplay::SendHtmlMOTDToClient(edict_t *client, char *string)
 {
-	int char_count = 0;
-	char *pFileList = string;
-	// Send the message of the day
-	// read it chunk-by-chunk,  and send it in parts
-	while (pFileList && *pFileList && char_count < MAX_UNICODE_MOTD_LENGTH)
-	{
-		char chunk[MAX_MOTD_CHUNK + 1];
-
-		if (strlen(pFileList) < MAX_MOTD_CHUNK)
-		{
-			strcpy(chunk, pFileList);
-		}
-		else
-		{
-			strncpy(chunk, pFileList, MAX_MOTD_CHUNK);
-			chunk[MAX_MOTD_CHUNK] = 0; // strncpy doesn't always append the null terminator
-		}
-
-		char_count += strlen(chunk);
-		if (char_count < MAX_UNICODE_MOTD_LENGTH)
-			pFileList = string + char_count;
-		else
-			*pFileList = 0;
-
-		MESSAGE_BEGIN(MSG_ONE, gmsgHtmlMOTD, NULL, client);
-		WRITE_BYTE(*pFileList ? FALSE : TRUE); // FALSE means there is still more message to come
-		WRITE_STRING(chunk);
-		MESSAGE_END();
-	}
+	QueueMOTDString(client, gmsgHtmlMOTD, string, MAX_UNICODE_MOTD_LENGTH);
 }
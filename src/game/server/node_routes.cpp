@@ -0,0 +1,386 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include "node_routes.h"
+
+namespace
+{
+
+// Max number of worker threads, the graph is at most MAX_NODES nodes
+constexpr int MAX_THREADS = 16;
+
+uint32_t HashBytes(uint32_t hash, const void *data, size_t size)
+{
+	// FNV-1a
+	const uint8_t *p = static_cast<const uint8_t *>(data);
+
+	for (size_t i = 0; i < size; i++)
+	{
+		hash ^= p[i];
+		hash *= 16777619u;
+	}
+
+	return hash;
+}
+
+}
+
+void CNodeRouteGraph::Clear()
+{
+	m_FirstLink.assign(1, 0);
+	m_DestNode.clear();
+	m_flWeight.clear();
+	m_afTables.clear();
+}
+
+int CNodeRouteGraph::AddNode()
+{
+	m_FirstLink.push_back(m_FirstLink.back());
+	return GetNodeCount() - 1;
+}
+
+void CNodeRouteGraph::AddLink(int iDestNode, float flWeight, unsigned afTables)
+{
+	m_DestNode.push_back(iDestNode);
+	m_flWeight.push_back(flWeight);
+	m_afTables.push_back((uint8_t)afTables);
+	m_FirstLink.back()++;
+}
+
+uint32_t CNodeRouteGraph::GetHash() const
+{
+	uint32_t hash = 2166136261u;
+	hash = HashBytes(hash, m_FirstLink.data(), m_FirstLink.size() * sizeof(int));
+	hash = HashBytes(hash, m_DestNode.data(), m_DestNode.size() * sizeof(int));
+	hash = HashBytes(hash, m_flWeight.data(), m_flWeight.size() * sizeof(float));
+	hash = HashBytes(hash, m_afTables.data(), m_afTables.size());
+	return hash;
+}
+
+/**
+ * Buffers of one thread.
+ */
+struct CNodeRouteBuilder::Worker
+{
+	std::vector<float> dist;
+	std::vector<int> firstHop;
+	std::vector<int> nextNodes;
+	std::vector<std::pair<float, int>> heap;
+
+	explicit Worker(int cNodes)
+	    : dist(cNodes)
+	    , firstHop(cNodes)
+	    , nextNodes(cNodes)
+	{
+	}
+
+	/**
+	 * Dijkstra from iFrom to all nodes. Same distance rules as CGraph::FindShortestPath.
+	 * Fills nextNodes with the first node on the path to each node, or iFrom if unreachable.
+	 */
+	void FindRoutes(const CNodeRouteGraph &graph, int iFrom, int iTable)
+	{
+		unsigned bit = 1u << iTable;
+		std::fill(dist.begin(), dist.end(), -1.0f);
+		heap.clear();
+
+		dist[iFrom] = 0;
+		firstHop[iFrom] = iFrom;
+		heap.emplace_back(0.0f, iFrom);
+
+		while (!heap.empty())
+		{
+			std::pop_heap(heap.begin(), heap.end(), std::greater<std::pair<float, int>>());
+			float flCurrentDistance = heap.back().first;
+			int iCurrentNode = heap.back().second;
+			heap.pop_back();
+
+			// Node was already visited with a shorter distance
+			if (flCurrentDistance > dist[iCurrentNode])
+				continue;
+
+			int iFirstLink = graph.m_FirstLink[iCurrentNode];
+			int iLastLink = graph.m_FirstLink[iCurrentNode + 1];
+
+			for (int i = iFirstLink; i < iLastLink; i++)
+			{
+				if (!(graph.m_afTables[i] & bit))
+					continue;
+
+				int iVisitNode = graph.m_DestNode[i];
+				float flOurDistance = flCurrentDistance + graph.m_flWeight[i];
+
+				if (dist[iVisitNode] < -0.5f || flOurDistance < dist[iVisitNode] - 0.001f)
+				{
+					dist[iVisitNode] = flOurDistance;
+					firstHop[iVisitNode] = iCurrentNode == iFrom ? iVisitNode : firstHop[iCurrentNode];
+
+					heap.emplace_back(flOurDistance, iVisitNode);
+					std::push_heap(heap.begin(), heap.end(), std::greater<std::pair<float, int>>());
+				}
+			}
+		}
+
+		for (size_t i = 0; i < nextNodes.size(); i++)
+			nextNodes[i] = dist[i] < -0.5f ? iFrom : firstHop[i];
+	}
+};
+
+void CNodeRouteBuilder::Build(const CNodeRouteGraph &graph, int threads, Result &result)
+{
+	auto startTime = std::chrono::steady_clock::now();
+
+	int cNodes = graph.GetNodeCount();
+	int cTasks = cNodes * CNodeRouteGraph::NUM_TABLES;
+
+	// Task i is the route from node (i % cNodes) in table (i / cNodes)
+	std::vector<std::vector<char>> routes(cTasks);
+	std::atomic<int> nextTask(0);
+	std::atomic<bool> needsSorting(false);
+
+	if (threads <= 0)
+		threads = (int)std::thread::hardware_concurrency();
+
+	threads = std::max(1, std::min({ threads, MAX_THREADS, cTasks }));
+
+	auto fnWorker = [&]() {
+		Worker worker(cNodes);
+
+		for (;;)
+		{
+			int iTask = nextTask.fetch_add(1, std::memory_order_relaxed);
+
+			if (iTask >= cTasks)
+				break;
+
+			int iTable = iTask / cNodes;
+			int iFrom = iTask % cNodes;
+
+			worker.FindRoutes(graph, iFrom, iTable);
+
+			if (!CompressRoute(worker.nextNodes.data(), iFrom, cNodes, routes[iTask]))
+				needsSorting = true;
+		}
+	};
+
+	std::vector<std::thread> pool;
+
+	for (int i = 1; i < threads; i++)
+		pool.emplace_back(fnWorker);
+
+	fnWorker();
+
+	for (std::thread &thread : pool)
+		thread.join();
+
+	// Merge in a fixed order so the result doesn't depend on the number of threads.
+	// Nodes with identical routes share them.
+	std::unordered_map<std::string, int> routeOffsets;
+
+	result.routeInfo.clear();
+	result.offsets.assign(cTasks, 0);
+
+	for (int iTask = 0; iTask < cTasks; iTask++)
+	{
+		const std::vector<char> &route = routes[iTask];
+		auto it = routeOffsets.emplace(std::string(route.begin(), route.end()), (int)result.routeInfo.size());
+
+		if (it.second)
+			result.routeInfo.insert(result.routeInfo.end(), route.begin(), route.end());
+
+		int iTable = iTask / cNodes;
+		int iFrom = iTask % cNodes;
+		result.offsets[iFrom * CNodeRouteGraph::NUM_TABLES + iTable] = it.first->second;
+	}
+
+	result.threads = threads;
+	result.needsSorting = needsSorting;
+	result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+}
+
+int CNodeRouteBuilder::NextNodeInRoute(const char *pRoute, int iCurrentNode, int iDest, int cNodes)
+{
+	int iNext = iCurrentNode;
+	int nCount = iDest + 1;
+
+	// Until we decode the next best node
+	//
+	while (nCount > 0)
+	{
+		int ch = *pRoute++;
+
+		if (ch < 0)
+		{
+			// Sequence phrase
+			//
+			ch = -ch;
+
+			if (nCount <= ch)
+			{
+				iNext = iDest;
+				nCount = 0;
+			}
+			else
+			{
+				nCount = nCount - ch;
+			}
+		}
+		else
+		{
+			// Repeat phrase
+			//
+			if (nCount <= ch + 1)
+			{
+				iNext = iCurrentNode + *pRoute;
+
+				if (iNext >= cNodes)
+					iNext -= cNodes;
+				else if (iNext < 0)
+					iNext += cNodes;
+
+				nCount = 0;
+			}
+			else
+			{
+				nCount = nCount - ch - 1;
+			}
+
+			pRoute++;
+		}
+	}
+
+	return iNext;
+}
+
+bool CNodeRouteBuilder::CompressRoute(const int *pNextNodes, int iFrom, int cNodes, std::vector<char> &out)
+{
+	bool bSuccess = true;
+
+	// Repeat phrase: (count - 1, offset of the node from iFrom)
+	auto fnEmitRepeat = [&](int cRepeats, int iNode) {
+		out.push_back((char)(cRepeats - 1));
+
+		int a = iNode - iFrom;
+		int b = iNode - iFrom + cNodes;
+		int c = iNode - iFrom - cNodes;
+
+		if (-128 <= a && a <= 127)
+		{
+			out.push_back((char)a);
+		}
+		else if (-128 <= b && b <= 127)
+		{
+			out.push_back((char)b);
+		}
+		else if (-128 <= c && c <= 127)
+		{
+			out.push_back((char)c);
+		}
+		else
+		{
+			// Nodes need sorting. Keep the phrase readable.
+			out.push_back(0);
+			bSuccess = false;
+		}
+	};
+
+	int iLastNode = 9999999; // just really big.
+	int cSequence = 0;
+	int cRepeats = 0;
+
+	out.clear();
+
+	for (int i = 0; i < cNodes; i++)
+	{
+		bool CanRepeat = (pNextNodes[i] == iLastNode) && cRepeats < 127;
+		bool CanSequence = (pNextNodes[i] == i && cSequence < 128);
+
+		if (cRepeats)
+		{
+			if (CanRepeat)
+			{
+				cRepeats++;
+			}
+			else
+			{
+				fnEmitRepeat(cRepeats, iLastNode);
+				cRepeats = 0;
+
+				if (CanSequence)
+				{
+					// Start a sequence.
+					//
+					cSequence++;
+				}
+				else
+				{
+					// Start another repeat.
+					//
+					cRepeats++;
+				}
+			}
+		}
+		else if (cSequence)
+		{
+			if (CanSequence)
+			{
+				cSequence++;
+			}
+			else
+			{
+				// It may be advantageous to combine
+				// a single-entry sequence phrase with the
+				// next repeat phrase.
+				//
+				if (cSequence == 1 && CanRepeat)
+				{
+					// Combine with repeat phrase.
+					//
+					cRepeats = 2;
+					cSequence = 0;
+				}
+				else
+				{
+					// Emit the sequence phrase (-count).
+					//
+					out.push_back((char)-cSequence);
+					cSequence = 0;
+
+					// Start a repeat sequence.
+					//
+					cRepeats++;
+				}
+			}
+		}
+		else
+		{
+			if (CanSequence)
+			{
+				// Start a sequence phrase.
+				//
+				cSequence++;
+			}
+			else
+			{
+				// Start a repeat sequence.
+				//
+				cRepeats++;
+			}
+		}
+
+		iLastNode = pNextNodes[i];
+	}
+
+	if (cRepeats)
+		fnEmitRepeat(cRepeats, iLastNode);
+
+	if (cSequence)
+		out.push_back((char)-cSequence);
+
+	return bSuccess;
+}
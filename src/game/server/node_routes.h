@@ -0,0 +1,108 @@
+//
+// node_routes.h
+//
+// Computation of compressed node graph routing tables.
+//
+#ifndef NODE_ROUTES_H
+#define NODE_ROUTES_H
+#include <cstdint>
+#include <vector>
+
+/**
+ * Node graph in compressed sparse row form. Each link has a bit for every
+ * routing table (hull and door capability) it can be used in.
+ */
+class CNodeRouteGraph
+{
+public:
+	static constexpr int NUM_HULLS = 4; // MAX_NODE_HULLS
+	static constexpr int NUM_CAPS = 2; // CGraph::CapIndex
+	static constexpr int NUM_TABLES = NUM_HULLS * NUM_CAPS;
+
+	/**
+	 * Returns the index of a routing table.
+	 */
+	static inline int TableIndex(int iHull, int iCap) { return iHull * NUM_CAPS + iCap; }
+
+	/**
+	 * Removes all nodes and links.
+	 */
+	void Clear();
+
+	/**
+	 * Adds a node. Links of a node must be added right after it.
+	 * @returns index of the node.
+	 */
+	int AddNode();
+
+	/**
+	 * Adds a link from the last added node.
+	 * @param	iDestNode	Node on the other end.
+	 * @param	flWeight	Length of the link.
+	 * @param	afTables	Bit (1 << TableIndex) for each table the link can be used in.
+	 */
+	void AddLink(int iDestNode, float flWeight, unsigned afTables);
+
+	inline int GetNodeCount() const { return (int)m_FirstLink.size() - 1; }
+	inline int GetLinkCount() const { return (int)m_DestNode.size(); }
+
+	/**
+	 * Returns a hash of nodes and links. Routes only depend on what is hashed,
+	 * so graphs with the same hash have the same routes.
+	 */
+	uint32_t GetHash() const;
+
+private:
+	std::vector<int> m_FirstLink = { 0 }; // m_FirstLink[i]..m_FirstLink[i + 1] are links of node i
+	std::vector<int> m_DestNode;
+	std::vector<float> m_flWeight;
+	std::vector<uint8_t> m_afTables;
+
+	friend class CNodeRouteBuilder;
+};
+
+/**
+ * Computes routing tables of all hulls and capabilities in a pool of worker threads
+ * and compresses them into the format CGraph::NextNodeInRoute reads.
+ */
+class CNodeRouteBuilder
+{
+public:
+	struct Result
+	{
+		std::vector<char> routeInfo; //!< Compressed routes of all tables
+		std::vector<int> offsets; //!< Offset in routeInfo for [iNode * NUM_TABLES + iTable]
+		int threads = 0; //!< Number of threads used
+		double seconds = 0; //!< Time spent
+		bool needsSorting = false; //!< A next node was too far in the node list to be encoded
+	};
+
+	/**
+	 * Computes the routes.
+	 * @param	graph		The graph.
+	 * @param	threads		Number of threads or 0 to use all CPU cores.
+	 * @param	result		Output.
+	 */
+	static void Build(const CNodeRouteGraph &graph, int threads, Result &result);
+
+	/**
+	 * Decodes the next node on the shortest path from the compressed routes of a node.
+	 * @param	pRoute			Routes of iCurrentNode.
+	 * @param	iCurrentNode	Node the routes belong to.
+	 * @param	iDest			Destination node.
+	 * @param	cNodes			Number of nodes in the graph.
+	 * @returns next node or iCurrentNode if iDest is unreachable.
+	 */
+	static int NextNodeInRoute(const char *pRoute, int iCurrentNode, int iDest, int cNodes);
+
+private:
+	struct Worker;
+
+	/**
+	 * Compresses the next nodes from iFrom to every node.
+	 * @returns false if a node is too far from iFrom to be encoded.
+	 */
+	static bool CompressRoute(const int *pNextNodes, int iFrom, int cNodes, std::vector<char> &out);
+};
+
+#endif
@@ -23,6 +23,7 @@
 #include "nodes.h"
 #include "animation.h"
 #include "doors.h"
+#include "node_routes.h"
 
 #if !defined(_WIN32)
 #include <sys/stat.h>
@@ -112,6 +113,7 @@ void CGraph ::InitGraph(void)
 	m_cNodes = 0;
 	m_cLinks = 0;
 	m_nRouteInfo = 0;
+	m_uRouteHash = 0;
 
 	m_iLastActiveIdleSearch = 0;
 	m_iLastCoverSearch = 0;
@@ -521,59 +523,8 @@ float CGraph::PathLength(int iStart, int iDest, int iHull, int afCapMask)
 // Parse the routing table at iCurrentNode for the next node on the shortest path to iDest
 int CGraph::NextNodeInRoute(int iCurrentNode, int iDest, int iHull, int iCap)
 {
-	int iNext = iCurrentNode;
-	int nCount = iDest + 1;
 	char *pRoute = m_pRouteInfo + m_pNodes[iCurrentNode].m_pNextBestNode[iHull][iCap];
-
-	// Until we decode the next best node
-	//
-	while (nCount > 0)
-	{
-		char ch = *pRoute++;
-		//ALERT(at_aiconsole, "C(%d)", ch);
-		if (ch < 0)
-		{
-			// Sequence phrase
-			//
-			ch = -ch;
-			if (nCount <= ch)
-			{
-				iNext = iDest;
-				nCount = 0;
-				//ALERT(at_aiconsole, "SEQ: iNext/iDest=%d\n", iNext);
-			}
-			else
-			{
-				//ALERT(at_aiconsole, "SEQ: nCount + ch (%d + %d)\n", nCount, ch);
-				nCount = nCount - ch;
-			}
-		}
-		else
-		{
-			//ALERT(at_aiconsole, "C(%d)", *pRoute);
-
-			// Repeat phrase
-			//
-			if (nCount <= ch + 1)
-			{
-				iNext = iCurrentNode + *pRoute;
-				if (iNext >= m_cNodes)
-					iNext -= m_cNodes;
-				else if (iNext < 0)
-					iNext += m_cNodes;
-				nCount = 0;
-				//ALERT(at_aiconsole, "REP: iNext=%d\n", iNext);
-			}
-			else
-			{
-				//ALERT(at_aiconsole, "REP: nCount - ch+1 (%d - %d+1)\n", nCount, ch);
-				nCount = nCount - ch - 1;
-			}
-			pRoute++;
-		}
-	}
-
-	return iNext;
+	return CNodeRouteBuilder::NextNodeInRoute(pRoute, iCurrentNode, iDest, m_cNodes);
 }
 
 //=========================================================
@@ -2077,9 +2028,11 @@ void CTestHull ::BuildNodeGraph(void)
 	WorldGraph.m_fGraphPointersSet = TRUE; // since the graph was generated, the pointers are ready
 	WorldGraph.m_fRoutingComplete = FALSE; // Optimal routes aren't computed, yet.
 
-	// Compute and compress the routing information.
+	// Compute and compress the routing information. Routes in the old
+	// .nod file are reused if nodes and links didn't change.
 	//
-	WorldGraph.ComputeStaticRoutingTables();
+	if (!WorldGraph.FLoadRoutes((char *)STRING(gpGlobals->mapname)))
+		WorldGraph.ComputeStaticRoutingTables();
 
 	// save the node graph for this level
 	WorldGraph.FSaveGraph((char *)STRING(gpGlobals->mapname));
@@ -2582,6 +2535,93 @@ int CGraph ::FSaveGraph(char *szMapName)
 	}
 }
 
+//=========================================================
+// CGraph - FLoadRoutes - copies the routing tables from the
+// .nod file on disk if it was saved for the same nodes and
+// links as the graph that was just built.
+//=========================================================
+int CGraph ::FLoadRoutes(char *szMapName)
+{
+	char szFilename[MAX_PATH];
+	int iVersion;
+	int length;
+	byte *aMemFile;
+	byte *pMemFile;
+	CGraph *pSavedGraph;
+	byte *pSavedNodes;
+	CNode savedNode;
+	CNodeRouteGraph graph;
+
+	strcpy(szFilename, "maps/graphs/");
+	strcat(szFilename, szMapName);
+	strcat(szFilename, ".nod");
+
+	pMemFile = aMemFile = LOAD_FILE_FOR_ME(szFilename, &length);
+
+	if (!aMemFile)
+		return FALSE;
+
+	// The file is: version, CGraph, nodes, links, sorting info, routes, hash links
+	//
+	length -= sizeof(int) + sizeof(CGraph);
+	if (length < 0)
+		goto Mismatch;
+
+	memcpy(&iVersion, pMemFile, sizeof(int));
+	pMemFile += sizeof(int);
+
+	if (iVersion != GRAPH_VERSION)
+		goto Mismatch;
+
+	pSavedGraph = (CGraph *)calloc(1, sizeof(CGraph));
+	memcpy(pSavedGraph, pMemFile, sizeof(CGraph));
+	pMemFile += sizeof(CGraph);
+
+	BuildRouteGraph(graph);
+
+	if (!pSavedGraph->m_fRoutingComplete || pSavedGraph->m_cNodes != m_cNodes || pSavedGraph->m_cLinks != m_cLinks
+	    || pSavedGraph->m_nRouteInfo <= 0 || pSavedGraph->m_uRouteHash != graph.GetHash())
+	{
+		free(pSavedGraph);
+		goto Mismatch;
+	}
+
+	length -= sizeof(CNode) * m_cNodes + sizeof(CLink) * m_cLinks + sizeof(DIST_INFO) * m_cNodes + pSavedGraph->m_nRouteInfo;
+	if (length < 0)
+	{
+		free(pSavedGraph);
+		goto Mismatch;
+	}
+
+	pSavedNodes = pMemFile;
+	pMemFile += sizeof(CNode) * m_cNodes + sizeof(CLink) * m_cLinks + sizeof(DIST_INFO) * m_cNodes;
+
+	if (m_pRouteInfo)
+		free(m_pRouteInfo);
+
+	m_nRouteInfo = pSavedGraph->m_nRouteInfo;
+	m_pRouteInfo = (char *)calloc(sizeof(char), m_nRouteInfo);
+	memcpy(m_pRouteInfo, pMemFile, m_nRouteInfo);
+
+	for (int i = 0; i < m_cNodes; i++)
+	{
+		memcpy(&savedNode, pSavedNodes + sizeof(CNode) * i, sizeof(CNode));
+		memcpy(m_pNodes[i].m_pNextBestNode, savedNode.m_pNextBestNode, sizeof(savedNode.m_pNextBestNode));
+	}
+
+	m_uRouteHash = pSavedGraph->m_uRouteHash;
+	m_fRoutingComplete = TRUE;
+	free(pSavedGraph);
+	FREE_FILE(aMemFile);
+
+	ALERT(at_console, "Node graph didn't change, reusing routes from %s\n", szFilename);
+	return TRUE;
+
+Mismatch:
+	FREE_FILE(aMemFile);
+	return FALSE;
+}
+
 //=========================================================
 // CGraph - FSetGraphPointers - Takes the modelnames of
 // all of the brush ents that block connections in the node
@@ -3072,304 +3112,87 @@ void CGraph::BuildRegionTables(void)
 	memset(m_Cache, 0, sizeof(m_Cache));
 }
 
-void CGraph ::ComputeStaticRoutingTables(void)
+//=========================================================
+// CGraph - BuildRouteGraph - copies the links into a compact
+// graph and resolves which hulls and capabilities can use
+// each of them.
+//=========================================================
+void CGraph ::BuildRouteGraph(CNodeRouteGraph &graph)
 {
-	int nRoutes = m_cNodes * m_cNodes;
-#define FROM_TO(x, y) ((x)*m_cNodes + (y))
-	short *Routes = new short[nRoutes];
+	static const int s_HullMasks[MAX_NODE_HULLS] = { bits_LINK_SMALL_HULL, bits_LINK_HUMAN_HULL, bits_LINK_LARGE_HULL, bits_LINK_FLY_HULL };
+	static const int s_CapMasks[2] = { 0, bits_CAP_OPEN_DOORS | bits_CAP_AUTO_DOORS | bits_CAP_USE };
 
-	int *pMyPath = new int[m_cNodes];
-	unsigned short *BestNextNodes = new unsigned short[m_cNodes];
-	char *pRoute = new char[m_cNodes * 2];
+	graph.Clear();
 
-	if (Routes && pMyPath && BestNextNodes && pRoute)
+	for (int iNode = 0; iNode < m_cNodes; iNode++)
 	{
-		int nTotalCompressedSize = 0;
-		for (int iHull = 0; iHull < MAX_NODE_HULLS; iHull++)
+		graph.AddNode();
+
+		for (int i = 0; i < m_pNodes[iNode].m_cNumLinks; i++)
 		{
+			CLink &link = NodeLink(iNode, i);
+			unsigned afTables = 0;
+
 			for (int iCap = 0; iCap < 2; iCap++)
 			{
-				int iCapMask;
-				switch (iCap)
-				{
-				case 0:
-					iCapMask = 0;
-					break;
-
-				case 1:
-					iCapMask = bits_CAP_OPEN_DOORS | bits_CAP_AUTO_DOORS | bits_CAP_USE;
-					break;
-				}
+				// Same checks as FindShortestPath does for each step
+				if (link.m_pLinkEnt != NULL && !HandleLinkEnt(iNode, link.m_pLinkEnt, s_CapMasks[iCap], NODEGRAPH_STATIC))
+					continue;
 
-				// Initialize Routing table to uncalculated.
-				//
-				int iFrom;
-				for (iFrom = 0; iFrom < m_cNodes; iFrom++)
+				for (int iHull = 0; iHull < MAX_NODE_HULLS; iHull++)
 				{
-					for (int iTo = 0; iTo < m_cNodes; iTo++)
-					{
-						Routes[FROM_TO(iFrom, iTo)] = -1;
-					}
+					if ((link.m_afLinkInfo & s_HullMasks[iHull]) == s_HullMasks[iHull])
+						afTables |= 1 << CNodeRouteGraph::TableIndex(iHull, iCap);
 				}
+			}
 
-				for (iFrom = 0; iFrom < m_cNodes; iFrom++)
-				{
-					for (int iTo = m_cNodes - 1; iTo >= 0; iTo--)
-					{
-						if (Routes[FROM_TO(iFrom, iTo)] != -1)
-							continue;
-
-						int cPathSize = FindShortestPath(pMyPath, iFrom, iTo, iHull, iCapMask);
+			graph.AddLink(link.m_iDestNode, link.m_flWeight, afTables);
+		}
+	}
+}
 
-						// Use the computed path to update the routing table.
-						//
-						if (cPathSize > 1)
-						{
-							for (int iNode = 0; iNode < cPathSize - 1; iNode++)
-							{
-								int iStart = pMyPath[iNode];
-								int iNext = pMyPath[iNode + 1];
-								for (int iNode1 = iNode + 1; iNode1 < cPathSize; iNode1++)
-								{
-									int iEnd = pMyPath[iNode1];
-									Routes[FROM_TO(iStart, iEnd)] = iNext;
-								}
-							}
-#if 0
-							// Well, at first glance, this should work, but actually it's safer
-							// to be told explictly that you can take a series of node in a
-							// particular direction. Some links don't appear to have links in
-							// the opposite direction.
-							//
-							for (iNode = cPathSize-1; iNode >= 1; iNode--)
-							{
-								int iStart = pMyPath[iNode];
-								int iNext  = pMyPath[iNode-1];
-								for (int iNode1 = iNode-1; iNode1 >= 0; iNode1--)
-								{
-									int iEnd = pMyPath[iNode1];
-									Routes[FROM_TO(iStart, iEnd)] = iNext;
-								}
-							}
-#endif
-						}
-						else
-						{
-							Routes[FROM_TO(iFrom, iTo)] = iFrom;
-							Routes[FROM_TO(iTo, iFrom)] = iTo;
-						}
-					}
-				}
+//=========================================================
+// CGraph - ComputeStaticRoutingTables - finds the shortest
+// routes between all nodes for every hull and capability
+// and compresses them into m_pRouteInfo.
+//=========================================================
+void CGraph ::ComputeStaticRoutingTables(void)
+{
+	CNodeRouteGraph graph;
+	CNodeRouteBuilder::Result result;
 
-				for (iFrom = 0; iFrom < m_cNodes; iFrom++)
-				{
-					for (int iTo = 0; iTo < m_cNodes; iTo++)
-					{
-						BestNextNodes[iTo] = Routes[FROM_TO(iFrom, iTo)];
-					}
+	BuildRouteGraph(graph);
+	CNodeRouteBuilder::Build(graph, 0, result);
 
-					// Compress this node's routing table.
-					//
-					int iLastNode = 9999999; // just really big.
-					int cSequence = 0;
-					int cRepeats = 0;
-					int CompressedSize = 0;
-					char *p = pRoute;
-					for (int i = 0; i < m_cNodes; i++)
-					{
-						BOOL CanRepeat = ((BestNextNodes[i] == iLastNode) && cRepeats < 127);
-						BOOL CanSequence = (BestNextNodes[i] == i && cSequence < 128);
+	if (result.needsSorting)
+		ALERT(at_aiconsole, "Nodes need sorting!\n");
 
-						if (cRepeats)
-						{
-							if (CanRepeat)
-							{
-								cRepeats++;
-							}
-							else
-							{
-								// Emit the repeat phrase.
-								//
-								CompressedSize += 2; // (count-1, iLastNode-i)
-								*p++ = cRepeats - 1;
-								int a = iLastNode - iFrom;
-								int b = iLastNode - iFrom + m_cNodes;
-								int c = iLastNode - iFrom - m_cNodes;
-								if (-128 <= a && a <= 127)
-								{
-									*p++ = a;
-								}
-								else if (-128 <= b && b <= 127)
-								{
-									*p++ = b;
-								}
-								else if (-128 <= c && c <= 127)
-								{
-									*p++ = c;
-								}
-								else
-								{
-									ALERT(at_aiconsole, "Nodes need sorting (%d,%d)!\n", iLastNode, iFrom);
-								}
-								cRepeats = 0;
+	if (m_pRouteInfo)
+	{
+		free(m_pRouteInfo);
+		m_pRouteInfo = NULL;
+	}
 
-								if (CanSequence)
-								{
-									// Start a sequence.
-									//
-									cSequence++;
-								}
-								else
-								{
-									// Start another repeat.
-									//
-									cRepeats++;
-								}
-							}
-						}
-						else if (cSequence)
-						{
-							if (CanSequence)
-							{
-								cSequence++;
-							}
-							else
-							{
-								// It may be advantageous to combine
-								// a single-entry sequence phrase with the
-								// next repeat phrase.
-								//
-								if (cSequence == 1 && CanRepeat)
-								{
-									// Combine with repeat phrase.
-									//
-									cRepeats = 2;
-									cSequence = 0;
-								}
-								else
-								{
-									// Emit the sequence phrase.
-									//
-									CompressedSize += 1; // (-count)
-									*p++ = -cSequence;
-									cSequence = 0;
-
-									// Start a repeat sequence.
-									//
-									cRepeats++;
-								}
-							}
-						}
-						else
-						{
-							if (CanSequence)
-							{
-								// Start a sequence phrase.
-								//
-								cSequence++;
-							}
-							else
-							{
-								// Start a repeat sequence.
-								//
-								cRepeats++;
-							}
-						}
-						iLastNode = BestNextNodes[i];
-					}
-					if (cRepeats)
-					{
-						// Emit the repeat phrase.
-						//
-						CompressedSize += 2;
-						*p++ = cRepeats - 1;
-#if 0
-						iLastNode = iFrom + *pRoute;
-						if (iLastNode >= m_cNodes) iLastNode -= m_cNodes;
-						else if (iLastNode < 0) iLastNode += m_cNodes;
-#endif
-						int a = iLastNode - iFrom;
-						int b = iLastNode - iFrom + m_cNodes;
-						int c = iLastNode - iFrom - m_cNodes;
-						if (-128 <= a && a <= 127)
-						{
-							*p++ = a;
-						}
-						else if (-128 <= b && b <= 127)
-						{
-							*p++ = b;
-						}
-						else if (-128 <= c && c <= 127)
-						{
-							*p++ = c;
-						}
-						else
-						{
-							ALERT(at_aiconsole, "Nodes need sorting (%d,%d)!\n", iLastNode, iFrom);
-						}
-					}
-					if (cSequence)
-					{
-						// Emit the Sequence phrase.
-						//
-						CompressedSize += 1;
-						*p++ = -cSequence;
-					}
+	m_nRouteInfo = result.routeInfo.size();
+	m_pRouteInfo = (char *)calloc(sizeof(char), max(m_nRouteInfo, 1));
+	memcpy(m_pRouteInfo, result.routeInfo.data(), m_nRouteInfo);
 
-					// Go find a place to store this thing and point to it.
-					//
-					int nRoute = p - pRoute;
-					if (m_pRouteInfo)
-					{
-						int i;
-						for (i = 0; i < m_nRouteInfo - nRoute; i++)
-						{
-							if (memcmp(m_pRouteInfo + i, pRoute, nRoute) == 0)
-							{
-								break;
-							}
-						}
-						if (i < m_nRouteInfo - nRoute)
-						{
-							m_pNodes[iFrom].m_pNextBestNode[iHull][iCap] = i;
-						}
-						else
-						{
-							char *Tmp = (char *)calloc(sizeof(char), (m_nRouteInfo + nRoute));
-							memcpy(Tmp, m_pRouteInfo, m_nRouteInfo);
-							free(m_pRouteInfo);
-							m_pRouteInfo = Tmp;
-							memcpy(m_pRouteInfo + m_nRouteInfo, pRoute, nRoute);
-							m_pNodes[iFrom].m_pNextBestNode[iHull][iCap] = m_nRouteInfo;
-							m_nRouteInfo += nRoute;
-							nTotalCompressedSize += CompressedSize;
-						}
-					}
-					else
-					{
-						m_nRouteInfo = nRoute;
-						m_pRouteInfo = (char *)calloc(sizeof(char), nRoute);
-						memcpy(m_pRouteInfo, pRoute, nRoute);
-						m_pNodes[iFrom].m_pNextBestNode[iHull][iCap] = 0;
-						nTotalCompressedSize += CompressedSize;
-					}
-				}
+	for (int iNode = 0; iNode < m_cNodes; iNode++)
+	{
+		for (int iHull = 0; iHull < MAX_NODE_HULLS; iHull++)
+		{
+			for (int iCap = 0; iCap < 2; iCap++)
+			{
+				int iTable = CNodeRouteGraph::TableIndex(iHull, iCap);
+				m_pNodes[iNode].m_pNextBestNode[iHull][iCap] = result.offsets[iNode * CNodeRouteGraph::NUM_TABLES + iTable];
 			}
 		}
-		ALERT(at_aiconsole, "Size of Routes = %d\n", nTotalCompressedSize);
 	}
-	if (Routes)
-		delete[] Routes;
-	if (BestNextNodes)
-		delete[] BestNextNodes;
-	if (pRoute)
-		delete[] pRoute;
-	if (pMyPath)
-		delete[] pMyPath;
-	Routes = 0;
-	BestNextNodes = 0;
-	pRoute = 0;
-	pMyPath = 0;
+
+	m_uRouteHash = graph.GetHash();
+
+	ALERT(at_aiconsole, "Size of Routes = %d\n", m_nRouteInfo);
+	ALERT(at_console, "Computed routes for %d nodes in %.2f seconds using %d threads\n", m_cNodes, result.seconds, result.threads);
 
 #if 0
 	TestRoutingTables();
@@ -103,7 +103,9 @@ typedef struct
 //=========================================================
 // CGraph
 //=========================================================
-#define GRAPH_VERSION (int)16 // !!!increment this whever graph/node/link classes change, to obsolesce older disk files.
+#define GRAPH_VERSION (int)17 // !!!increment this whever graph/node/link classes change, to obsolesce older disk files.
+class CNodeRouteGraph;
+
 class CGraph
 {
 public:
@@ -119,6 +121,7 @@ public:
 	int m_cNodes; // total number of nodes
 	int m_cLinks; // total number of links
 	int m_nRouteInfo; // size of m_pRouteInfo in bytes.
+	unsigned int m_uRouteHash; // hash of the nodes and links m_pRouteInfo was computed for.
 
 	// Tables for making nearest node lookup faster. SortedBy provided nodes in a
 	// order of a particular coordinate. Instead of doing a binary search, RangeStart
@@ -179,11 +182,13 @@ public:
 
 	int CheckNODFile(char *szMapName);
 	int FLoadGraph(char *szMapName);
+	int FLoadRoutes(char *szMapName);
 	int FSaveGraph(char *szMapName);
 	int FSetGraphPointers(void);
 	void CheckNode(Vector vecOrigin, int iNode);
 
 	void BuildRegionTables(void);
+	void BuildRouteGraph(CNodeRouteGraph &graph);
 	void ComputeStaticRoutingTables(void);
 	void TestRoutingTables(void);
 
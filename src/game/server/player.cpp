@@ -2937,6 +2937,7 @@ void CBasePlayer::Spawn(void)
 	m_bConnected = TRUE;
 
 	pev->classname = MAKE_STRING("player");
+	UTIL_UpdateEntityNames(ENT(pev));
 	pev->health = 100;
 	pev->armorvalue = 0;
 	pev->takedamage = DAMAGE_AIM;
@@ -67,6 +67,7 @@ int CPython::AddToPlayer(CBasePlayer *pPlayer)
 void CPython::Spawn()
 {
 	pev->classname = MAKE_STRING("weapon_357"); // hack to allow for old names
+	UTIL_UpdateEntityNames(ENT(pev));
 	Precache();
 	m_iId = WEAPON_PYTHON;
 	SET_MODEL(ENT(pev), "models/w_357.mdl");
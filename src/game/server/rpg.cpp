@@ -51,6 +51,7 @@ CLaserSpot *CLaserSpot::CreateSpot(void)
 	pSpot->Spawn();
 
 	pSpot->pev->classname = MAKE_STRING("laser_spot");
+	UTIL_UpdateEntityNames(pSpot->edict());
 
 	return pSpot;
 }
@@ -130,6 +131,7 @@ void CRpgRocket ::Spawn(void)
 	UTIL_SetOrigin(pev, pev->origin);
 
 	pev->classname = MAKE_STRING("rpg_rocket");
+	UTIL_UpdateEntityNames(ENT(pev));
 
 	SetThink(&CRpgRocket::IgniteThink);
 	SetTouch(&CRpgRocket::ExplodeTouch);
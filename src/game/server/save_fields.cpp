@@ -0,0 +1,133 @@
+#include "extdll.h"
+#include "save_fields.h"
+
+namespace
+{
+
+inline unsigned char ToLower(unsigned char c)
+{
+	return (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c;
+}
+
+}
+
+void CSaveFieldTable::Compile(const TYPEDESCRIPTION *pFields, int fieldCount, const int *pTypeSizes)
+{
+	m_Fields.resize(fieldCount);
+
+	unsigned lookupSize = 8;
+
+	while (lookupSize < (unsigned)fieldCount * 2)
+		lookupSize *= 2;
+
+	m_Lookup.assign(lookupSize, -1);
+	m_uLookupMask = lookupSize - 1;
+
+	for (int i = 0; i < fieldCount; i++)
+	{
+		const TYPEDESCRIPTION &desc = pFields[i];
+		Field &field = m_Fields[i];
+
+		field.name = desc.fieldName;
+		field.nameHash = HashString(desc.fieldName);
+		field.lookupHash = LookupHash(desc.fieldName);
+		field.dataSize = desc.fieldSize * pTypeSizes[desc.fieldType];
+
+		switch (desc.fieldType)
+		{
+		case FIELD_FLOAT:
+		case FIELD_VECTOR:
+		case FIELD_INTEGER:
+		case FIELD_BOOLEAN:
+		case FIELD_SHORT:
+		case FIELD_CHARACTER:
+			field.plainData = true;
+			break;
+		default:
+			field.plainData = false;
+			break;
+		}
+
+		unsigned slot = field.lookupHash & m_uLookupMask;
+
+		while (m_Lookup[slot] != -1)
+			slot = (slot + 1) & m_uLookupMask;
+
+		m_Lookup[slot] = i;
+	}
+}
+
+int CSaveFieldTable::FindField(const char *pszName, int startField) const
+{
+	int fieldCount = (int)m_Fields.size();
+
+	if (fieldCount == 0)
+		return -1;
+
+	unsigned int hash = LookupHash(pszName);
+
+	// Most data is read in the same order as it was written
+	int first = startField % fieldCount;
+
+	if (m_Fields[first].lookupHash == hash && NamesEqual(m_Fields[first].name, pszName))
+		return first;
+
+	int result = -1;
+	int resultDist = fieldCount;
+
+	for (unsigned slot = hash & m_uLookupMask; m_Lookup[slot] != -1; slot = (slot + 1) & m_uLookupMask)
+	{
+		int i = m_Lookup[slot];
+		const Field &field = m_Fields[i];
+
+		if (field.lookupHash != hash || !NamesEqual(field.name, pszName))
+			continue;
+
+		// Distance from startField in the order of a wrapping scan
+		int dist = ((i - startField) % fieldCount + fieldCount) % fieldCount;
+
+		if (dist < resultDist)
+		{
+			result = i;
+			resultDist = dist;
+		}
+	}
+
+	return result;
+}
+
+unsigned int CSaveFieldTable::HashString(const char *pszToken)
+{
+	unsigned int hash = 0;
+
+	// Rotate right by 4
+	while (*pszToken)
+		hash = ((hash >> 4) | (hash << 28)) ^ *pszToken++;
+
+	return hash;
+}
+
+unsigned int CSaveFieldTable::LookupHash(const char *pszName)
+{
+	// FNV-1a of lower case name
+	unsigned int hash = 2166136261u;
+
+	for (const unsigned char *p = (const unsigned char *)pszName; *p; p++)
+		hash = (hash ^ ToLower(*p)) * 16777619u;
+
+	return hash;
+}
+
+bool CSaveFieldTable::NamesEqual(const char *a, const char *b)
+{
+	const unsigned char *pa = (const unsigned char *)a;
+	const unsigned char *pb = (const unsigned char *)b;
+
+	while (*pa && ToLower(*pa) == ToLower(*pb))
+	{
+		pa++;
+		pb++;
+	}
+
+	return ToLower(*pa) == ToLower(*pb);
+}
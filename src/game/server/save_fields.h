@@ -0,0 +1,77 @@
+//
+// save_fields.h
+//
+// Compiled TYPEDESCRIPTION tables for save/restore.
+//
+#ifndef SAVE_FIELDS_H
+#define SAVE_FIELDS_H
+#include <vector>
+
+/**
+ * Lookup data of a TYPEDESCRIPTION array that save/restore used to compute
+ * for every field of every entity: save token hashes of field names,
+ * case-insensitive name to field index lookup and data sizes.
+ */
+class CSaveFieldTable
+{
+public:
+	/**
+	 * Builds the table.
+	 * @param	pFields		Field descriptions. Must stay valid while the table is used.
+	 * @param	fieldCount	Number of fields.
+	 * @param	pTypeSizes	Size of one element of each FIELDTYPE.
+	 */
+	void Compile(const TYPEDESCRIPTION *pFields, int fieldCount, const int *pTypeSizes);
+
+	/**
+	 * Finds a field by name, ignoring case.
+	 * Duplicate names are searched from startField and wrap around like a linear scan.
+	 * @param	pszName		Field name.
+	 * @param	startField	Field to start searching from.
+	 * @returns	Field index or -1.
+	 */
+	int FindField(const char *pszName, int startField) const;
+
+	inline int GetFieldCount() const { return (int)m_Fields.size(); }
+
+	/**
+	 * Returns CSaveRestoreBuffer::HashString of the field name.
+	 */
+	inline unsigned int GetNameHash(int field) const { return m_Fields[field].nameHash; }
+
+	/**
+	 * Returns the size of field data in bytes: element size times element count.
+	 */
+	inline int GetDataSize(int field) const { return m_Fields[field].dataSize; }
+
+	/**
+	 * Returns whether field data is saved and restored as is, without any fixups.
+	 */
+	inline bool IsPlainData(int field) const { return m_Fields[field].plainData; }
+
+	/**
+	 * Save token hash. Same as CSaveRestoreBuffer::HashString.
+	 */
+	static unsigned int HashString(const char *pszToken);
+
+private:
+	struct Field
+	{
+		const char *name;
+		unsigned int nameHash;
+		unsigned int lookupHash;
+		int dataSize;
+		bool plainData;
+	};
+
+	std::vector<Field> m_Fields;
+
+	// Open addressing table of field indexes, -1 is empty
+	std::vector<int> m_Lookup;
+	unsigned m_uLookupMask = 0;
+
+	static unsigned int LookupHash(const char *pszName);
+	static bool NamesEqual(const char *a, const char *b);
+};
+
+#endif
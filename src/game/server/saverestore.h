@@ -17,6 +17,7 @@
 #define SAVERESTORE_H
 
 class CBaseEntity;
+class CSaveFieldTable;
 
 class CSaveRestoreBuffer
 {
@@ -36,6 +37,7 @@ public:
 	edict_t *EntityFromIndex(int entityIndex);
 
 	unsigned short TokenHash(const char *pszToken);
+	unsigned short TokenHash(const char *pszToken, unsigned int stringHash); // stringHash is HashString(pszToken)
 
 protected:
 	SAVERESTOREDATA *m_pdata;
@@ -72,9 +74,13 @@ public:
 private:
 	int DataEmpty(const char *pdata, int size);
 	void BufferField(const char *pname, int size, const char *pdata);
+	void BufferField(unsigned short token, int size, const char *pdata);
 	void BufferString(char *pdata, int len);
 	void BufferData(const char *pdata, int size);
 	void BufferHeader(const char *pname, int size);
+	void BufferHeader(unsigned short token, int size);
+	void BufferTime(const float *data, int count);
+	void BufferPositionVector(const float *value, int count);
 };
 
 typedef struct
@@ -105,6 +111,8 @@ public:
 	void PrecacheMode(BOOL mode) { m_precache = mode; }
 
 private:
+	int ReadField(void *pBaseData, TYPEDESCRIPTION *pFields, const CSaveFieldTable &table, int startField, int size, char *pName, void *pData);
+
 	char *BufferPointer(void);
 	void BufferReadBytes(char *pOutput, int size);
 	void BufferSkipBytes(int bytes);
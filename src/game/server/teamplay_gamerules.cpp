@@ -109,6 +109,8 @@ void CHalfLifeTeamplay ::Think(void)
 		return;
 	}
 
+	SendQueuedMOTDs();
+
 	float flTimeLimit = CVAR_GET_FLOAT("mp_timelimit") * 60;
 
 	time_remaining = (int)(flTimeLimit ? (flTimeLimit - gpGlobals->time) : 0);
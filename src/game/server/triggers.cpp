@@ -1257,6 +1257,7 @@ LINK_ENTITY_TO_CLASS(fireanddie, CFireAndDie);
 void CFireAndDie::Spawn(void)
 {
 	pev->classname = MAKE_STRING("fireanddie");
+	UTIL_UpdateEntityNames(ENT(pev));
 	// Don't call Precache() - it should be called on restore
 }
 
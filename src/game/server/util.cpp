@@ -30,6 +30,10 @@
 #include "player.h"
 #include "weapons.h"
 #include "gamerules.h"
+#include "entity_grid.h"
+#include "entity_name_index.h"
+#include "save_fields.h"
+#include <unordered_map>
 
 float UTIL_WeaponTimeBase(void)
 {
@@ -395,19 +399,90 @@ void UTIL_MoveToOrigin(edict_t *pent, const Vector &vecGoal, float flDist, int i
 	MOVE_TO_ORIGIN(pent, rgfl, flDist, iMoveType);
 }
 
-int UTIL_EntitiesInBox(CBaseEntity **pList, int listMax, const Vector &mins, const Vector &maxs, int flagMask)
+//=========================================================
+// Entity grid
+//
+// Boxes of entities are kept in a grid so area queries don't have to go
+// through every edict. The engine calls DispatchObjectCollsionBox every time
+// it links an entity, which keeps the grid in sync with physics and
+// SET_ORIGIN/SET_SIZE/SET_MODEL. The grid is also synced with all edicts
+// at the start of every frame to pick up direct changes of pev->origin.
+//=========================================================
+static CEntityGrid g_EntityGrid;
+static std::vector<int> g_EntityGridResults;
+
+static void EntityGridUpdate(int index, const entvars_t *pev)
+{
+	// Sphere queries use the origin, it may be outside of the box
+	Vector mins, maxs;
+
+	for (int i = 0; i < 3; i++)
+	{
+		mins[i] = min(pev->absmin[i], pev->origin[i]);
+		maxs[i] = max(pev->absmax[i], pev->origin[i]);
+	}
+
+	g_EntityGrid.Update(index, mins, maxs);
+}
+
+void UTIL_UpdateEntityGrid(edict_t *pent)
+{
+	if (!pent || pent->free)
+		return;
+
+	EntityGridUpdate(pent - g_engfuncs.pfnPEntityOfEntIndex(0), &pent->v);
+}
+
+void UTIL_RemoveFromEntityGrid(edict_t *pent)
+{
+	if (!pent)
+		return;
+
+	g_EntityGrid.Remove(pent - g_engfuncs.pfnPEntityOfEntIndex(0));
+}
+
+void UTIL_SyncEntityGrid(void)
 {
 	edict_t *pEdict = g_engfuncs.pfnPEntityOfEntIndex(1);
+
+	if (!pEdict)
+		return;
+
+	for (int i = 1; i < gpGlobals->maxEntities; i++, pEdict++)
+	{
+		if (pEdict->free)
+			g_EntityGrid.Remove(i);
+		else
+			EntityGridUpdate(i, &pEdict->v);
+	}
+}
+
+void UTIL_ClearEntityGrid(void)
+{
+	g_EntityGrid.Clear();
+}
+
+int UTIL_EntitiesInBox(CBaseEntity **pList, int listMax, const Vector &mins, const Vector &maxs, int flagMask)
+{
+	edict_t *pEdicts = g_engfuncs.pfnPEntityOfEntIndex(0);
 	CBaseEntity *pEntity;
 	int count;
 
 	count = 0;
 
-	if (!pEdict)
+	if (!pEdicts)
 		return count;
 
-	for (int i = 1; i < gpGlobals->maxEntities; i++, pEdict++)
+	// Candidates come in the edict order, same as when all edicts are checked
+	g_EntityGrid.Query(mins, maxs, g_EntityGridResults);
+
+	for (int i : g_EntityGridResults)
 	{
+		if (i < 1 || i >= gpGlobals->maxEntities)
+			continue;
+
+		edict_t *pEdict = pEdicts + i;
+
 		if (pEdict->free) // Not in use
 			continue;
 
@@ -433,7 +508,7 @@ int UTIL_EntitiesInBox(CBaseEntity **pList, int listMax, const Vector &mins, con
 
 int UTIL_MonstersInSphere(CBaseEntity **pList, int listMax, const Vector &center, float radius)
 {
-	edict_t *pEdict = g_engfuncs.pfnPEntityOfEntIndex(1);
+	edict_t *pEdicts = g_engfuncs.pfnPEntityOfEntIndex(0);
 	CBaseEntity *pEntity;
 	int count;
 	float distance, delta;
@@ -441,11 +516,19 @@ int UTIL_MonstersInSphere(CBaseEntity **pList, int listMax, const Vector &center
 	count = 0;
 	float radiusSquared = radius * radius;
 
-	if (!pEdict)
+	if (!pEdicts)
 		return count;
 
-	for (int i = 1; i < gpGlobals->maxEntities; i++, pEdict++)
+	Vector vecRadius(radius, radius, radius);
+	g_EntityGrid.Query(center - vecRadius, center + vecRadius, g_EntityGridResults);
+
+	for (int i : g_EntityGridResults)
 	{
+		if (i < 1 || i >= gpGlobals->maxEntities)
+			continue;
+
+		edict_t *pEdict = pEdicts + i;
+
 		if (pEdict->free) // Not in use
 			continue;
 
@@ -517,6 +600,105 @@ CBaseEntity *UTIL_FindEntityInSphere(CBaseEntity *pStartEntity, const Vector &ve
 	return resultEntity;
 }
 
+//=========================================================
+// Entity name index
+//
+// Replaces the engine's FIND_ENTITY_BY_STRING scan for classname and
+// targetname. Names are updated on spawn, keyvalue and link and all edicts
+// are synced at the start of every frame, like the entity grid. Game code
+// that sets pev->classname or pev->targetname directly calls
+// UTIL_UpdateEntityNames after it. Names may still be cleared or changed
+// elsewhere before the next sync, so every found entity is checked against
+// its current name.
+//=========================================================
+static CEntityNameIndex g_EntityNames;
+
+static void EntityNamesUpdate(int index, const entvars_t *pev)
+{
+	g_EntityNames.Update(index, CEntityNameIndex::CLASSNAME, pev->classname ? STRING(pev->classname) : nullptr);
+	g_EntityNames.Update(index, CEntityNameIndex::TARGETNAME, pev->targetname ? STRING(pev->targetname) : nullptr);
+}
+
+void UTIL_UpdateEntityNames(edict_t *pent)
+{
+	if (!pent || pent->free)
+		return;
+
+	EntityNamesUpdate(pent - g_engfuncs.pfnPEntityOfEntIndex(0), &pent->v);
+}
+
+void UTIL_RemoveFromEntityNames(edict_t *pent)
+{
+	if (!pent)
+		return;
+
+	g_EntityNames.Remove(pent - g_engfuncs.pfnPEntityOfEntIndex(0));
+}
+
+void UTIL_SyncEntityNames(void)
+{
+	edict_t *pEdict = g_engfuncs.pfnPEntityOfEntIndex(0);
+
+	if (!pEdict)
+		return;
+
+	for (int i = 0; i < gpGlobals->maxEntities; i++, pEdict++)
+	{
+		if (pEdict->free)
+			g_EntityNames.Remove(i);
+		else
+			EntityNamesUpdate(i, &pEdict->v);
+	}
+}
+
+void UTIL_ClearEntityNames(void)
+{
+	g_EntityNames.Clear();
+}
+
+static bool EntityHasName(const edict_t *pEdict, CEntityNameIndex::Field field, const char *pszName)
+{
+	if (pEdict->free)
+		return false;
+
+	string_t name = field == CEntityNameIndex::CLASSNAME ? pEdict->v.classname : pEdict->v.targetname;
+
+	return name && !strcmp(STRING(name), pszName);
+}
+
+// Same as FIND_ENTITY_BY_STRING: returns the next entity after entStart or the world if not found
+static edict_t *FindEdictByName(edict_t *entStart, CEntityNameIndex::Field field, const char *pszName)
+{
+	edict_t *pEdicts = g_engfuncs.pfnPEntityOfEntIndex(0);
+
+	if (!pEdicts || !pszName || !pszName[0])
+		return FIND_ENTITY_BY_STRING(entStart, field == CEntityNameIndex::CLASSNAME ? "classname" : "targetname", pszName);
+
+	int index = entStart ? entStart - pEdicts : 0;
+
+	while ((index = g_EntityNames.FindNext(field, pszName, index)) != -1)
+	{
+		if (index >= gpGlobals->maxEntities)
+			break;
+
+		// Name may have been changed directly since the last sync
+		if (EntityHasName(pEdicts + index, field, pszName))
+			return pEdicts + index;
+	}
+
+	return pEdicts;
+}
+
+edict_t *UTIL_FindEdictByClassname(edict_t *entStart, const char *pszName)
+{
+	return FindEdictByName(entStart, CEntityNameIndex::CLASSNAME, pszName);
+}
+
+edict_t *UTIL_FindEdictByTargetname(edict_t *entStart, const char *pszName)
+{
+	return FindEdictByName(entStart, CEntityNameIndex::TARGETNAME, pszName);
+}
+
 CBaseEntity *UTIL_FindEntityByString(CBaseEntity *pStartEntity, const char *szKeyword, const char *szValue)
 {
 	edict_t *pentEntity;
@@ -526,7 +708,12 @@ CBaseEntity *UTIL_FindEntityByString(CBaseEntity *pStartEntity, const char *szKe
 	else
 		pentEntity = NULL;
 
-	pentEntity = FIND_ENTITY_BY_STRING(pentEntity, szKeyword, szValue);
+	if (!strcmp(szKeyword, "classname"))
+		pentEntity = UTIL_FindEdictByClassname(pentEntity, szValue);
+	else if (!strcmp(szKeyword, "targetname"))
+		pentEntity = UTIL_FindEdictByTargetname(pentEntity, szValue);
+	else
+		pentEntity = FIND_ENTITY_BY_STRING(pentEntity, szKeyword, szValue);
 
 	if (!FNullEnt(pentEntity))
 		return CBaseEntity::Instance(pentEntity);
@@ -590,37 +777,30 @@ CBaseEntity *UTIL_FindEntityByClassname(CBaseEntity *pStartEntity, const char *s
 	// Do reverse search logic
 	edict_t *pEdictFound = NULL;
 	edict_t *pEdictStart = g_engfuncs.pfnPEntityOfEntIndex(0);
-	edict_t *pEdictEnd = pEdictStart + gpGlobals->maxEntities - 1;
-	edict_t *pEdictMiddle = pStartEntity == NULL ? pEdictStart : pStartEntity->edict();
+	int middle = pStartEntity == NULL ? 0 : pStartEntity->edict() - pEdictStart;
+	int index = middle;
 
-	edict_t *pEdict;
 	// Search from the middle to the start
-	for (pEdict = pEdictMiddle - 1; pEdict >= pEdictStart; pEdict--)
+	while ((index = g_EntityNames.FindPrev(CEntityNameIndex::CLASSNAME, szName, index)) != -1)
 	{
-		if (pEdict->free) // Not in use
-			continue;
-		if (pEdict->v.classname == NULL)
-			continue;
-		const char *name = STRING(pEdict->v.classname);
-		if (strcmp(szName, name))
-			continue;
-		pEdictFound = pEdict;
-		break;
+		if (EntityHasName(pEdictStart + index, CEntityNameIndex::CLASSNAME, szName))
+		{
+			pEdictFound = pEdictStart + index;
+			break;
+		}
 	}
 	if (!pEdictFound && bLoop)
 	{
 		// Loop: Search from the end to the middle
-		for (pEdict = pEdictEnd; pEdict > pEdictMiddle; pEdict--)
+		index = gpGlobals->maxEntities;
+
+		while ((index = g_EntityNames.FindPrev(CEntityNameIndex::CLASSNAME, szName, index)) > middle)
 		{
-			if (pEdict->free) // Not in use
-				continue;
-			if (pEdict->v.classname == NULL)
-				continue;
-			const char *name = STRING(pEdict->v.classname);
-			if (strcmp(szName, name))
-				continue;
-			pEdictFound = pEdict;
-			break;
+			if (EntityHasName(pEdictStart + index, CEntityNameIndex::CLASSNAME, szName))
+			{
+				pEdictFound = pEdictStart + index;
+				break;
+			}
 		}
 	}
 
@@ -1682,6 +1862,41 @@ static int gSizes[FIELD_TYPECOUNT] = {
 	sizeof(int), // FIELD_SOUNDNAME
 };
 
+// Field tables are compiled on first use and kept until the library is unloaded,
+// TYPEDESCRIPTION arrays are static. The same array may be passed with
+// different counts, so the count is a part of the key.
+struct SaveFieldTableKey
+{
+	const TYPEDESCRIPTION *pFields;
+	int fieldCount;
+
+	bool operator==(const SaveFieldTableKey &other) const { return pFields == other.pFields && fieldCount == other.fieldCount; }
+};
+
+struct SaveFieldTableKeyHash
+{
+	size_t operator()(const SaveFieldTableKey &key) const
+	{
+		return std::hash<const void *>()(key.pFields) ^ ((size_t)key.fieldCount * 0x9E3779B9u);
+	}
+};
+
+static std::unordered_map<SaveFieldTableKey, CSaveFieldTable, SaveFieldTableKeyHash> g_SaveFieldTables;
+
+static const CSaveFieldTable &GetSaveFieldTable(const TYPEDESCRIPTION *pFields, int fieldCount)
+{
+	SaveFieldTableKey key = { pFields, fieldCount };
+	auto it = g_SaveFieldTables.find(key);
+
+	if (it == g_SaveFieldTables.end())
+	{
+		it = g_SaveFieldTables.emplace(key, CSaveFieldTable()).first;
+		it->second.Compile(pFields, fieldCount, gSizes);
+	}
+
+	return it->second;
+}
+
 // Base class includes common SAVERESTOREDATA pointer, and manages the entity table
 CSaveRestoreBuffer ::CSaveRestoreBuffer(void)
 {
@@ -1774,40 +1989,19 @@ void CSaveRestoreBuffer ::BufferRewind(int size)
 	m_pdata->size -= size;
 }
 
-#if !defined(_WIN32) && !defined(_rotr)
-extern "C" unsigned _rotr(unsigned val, int shift)
+unsigned int CSaveRestoreBuffer ::HashString(const char *pszToken)
 {
-	unsigned lobit; /* non-zero means lo bit set */
-	unsigned num = val; /* number to rotate */
-
-	shift &= 0x1f; /* modulo 32 -- this will also make
-                                           negative shifts work */
-
-	while (shift--)
-	{
-		lobit = num & 1; /* get high bit */
-		num >>= 1; /* shift right one bit */
-		if (lobit)
-			num |= 0x80000000; /* set hi bit if lo bit was set */
-	}
-
-	return num;
+	return CSaveFieldTable::HashString(pszToken);
 }
-#endif
 
-unsigned int CSaveRestoreBuffer ::HashString(const char *pszToken)
+unsigned short CSaveRestoreBuffer ::TokenHash(const char *pszToken)
 {
-	unsigned int hash = 0;
-
-	while (*pszToken)
-		hash = _rotr(hash, 4) ^ *pszToken++;
-
-	return hash;
+	return TokenHash(pszToken, HashString(pszToken));
 }
 
-unsigned short CSaveRestoreBuffer ::TokenHash(const char *pszToken)
+unsigned short CSaveRestoreBuffer ::TokenHash(const char *pszToken, unsigned int stringHash)
 {
-	unsigned short hash = (unsigned short)(HashString(pszToken) % (unsigned)m_pdata->tokenCount);
+	unsigned short hash = (unsigned short)(stringHash % (unsigned)m_pdata->tokenCount);
 
 #if _DEBUG
 	static int tokensparsed = 0;
@@ -1831,7 +2025,8 @@ unsigned short CSaveRestoreBuffer ::TokenHash(const char *pszToken)
 		if (index >= m_pdata->tokenCount)
 			index -= m_pdata->tokenCount;
 
-		if (!m_pdata->pTokens[index] || strcmp(pszToken, m_pdata->pTokens[index]) == 0)
+		// Field names are usually stored by the same pointer
+		if (!m_pdata->pTokens[index] || m_pdata->pTokens[index] == pszToken || strcmp(pszToken, m_pdata->pTokens[index]) == 0)
 		{
 			m_pdata->pTokens[index] = (char *)pszToken;
 			return index;
@@ -1865,11 +2060,15 @@ void CSave ::WriteFloat(const char *pname, const float *data, int count)
 }
 
 void CSave ::WriteTime(const char *pname, const float *data, int count)
+{
+	BufferHeader(pname, sizeof(float) * count);
+	BufferTime(data, count);
+}
+
+void CSave ::BufferTime(const float *data, int count)
 {
 	int i;
-	Vector tmp, input;
 
-	BufferHeader(pname, sizeof(float) * count);
 	for (i = 0; i < count; i++)
 	{
 		float tmp = data[0];
@@ -1945,11 +2144,15 @@ void CSave ::WritePositionVector(const char *pname, const Vector &value)
 }
 
 void CSave ::WritePositionVector(const char *pname, const float *value, int count)
+{
+	BufferHeader(pname, sizeof(float) * 3 * count);
+	BufferPositionVector(value, count);
+}
+
+void CSave ::BufferPositionVector(const float *value, int count)
 {
 	int i;
-	Vector tmp, input;
 
-	BufferHeader(pname, sizeof(float) * 3 * count);
 	for (i = 0; i < count; i++)
 	{
 		Vector tmp(value[0], value[1], value[2]);
@@ -2031,14 +2234,18 @@ int CSave ::WriteFields(const char *pname, void *pBaseData, TYPEDESCRIPTION *pFi
 	int i, j, actualCount, emptyCount;
 	TYPEDESCRIPTION *pTest;
 	int entityArray[MAX_ENTITYARRAY];
+	const CSaveFieldTable &table = GetSaveFieldTable(pFields, fieldCount);
+	static std::vector<char> emptyFields;
 
 	// Precalculate the number of empty fields
 	emptyCount = 0;
+	emptyFields.resize(fieldCount);
 	for (i = 0; i < fieldCount; i++)
 	{
 		void *pOutputData;
 		pOutputData = ((char *)pBaseData + pFields[i].fieldOffset);
-		if (DataEmpty((const char *)pOutputData, pFields[i].fieldSize * gSizes[pFields[i].fieldType]))
+		emptyFields[i] = DataEmpty((const char *)pOutputData, table.GetDataSize(i));
+		if (emptyFields[i])
 			emptyCount++;
 	}
 
@@ -2052,17 +2259,21 @@ int CSave ::WriteFields(const char *pname, void *pBaseData, TYPEDESCRIPTION *pFi
 		pTest = &pFields[i];
 		pOutputData = ((char *)pBaseData + pTest->fieldOffset);
 
-		// UNDONE: Must we do this twice?
-		if (DataEmpty((const char *)pOutputData, pTest->fieldSize * gSizes[pTest->fieldType]))
+		if (emptyFields[i])
+			continue;
+
+		// Fields that are written as is: float, vector, integer, boolean, short and character
+		if (table.IsPlainData(i))
+		{
+			BufferField(TokenHash(pTest->fieldName, table.GetNameHash(i)), table.GetDataSize(i), (const char *)pOutputData);
 			continue;
+		}
 
 		switch (pTest->fieldType)
 		{
-		case FIELD_FLOAT:
-			WriteFloat(pTest->fieldName, (float *)pOutputData, pTest->fieldSize);
-			break;
 		case FIELD_TIME:
-			WriteTime(pTest->fieldName, (float *)pOutputData, pTest->fieldSize);
+			BufferHeader(TokenHash(pTest->fieldName, table.GetNameHash(i)), sizeof(float) * pTest->fieldSize);
+			BufferTime((float *)pOutputData, pTest->fieldSize);
 			break;
 		case FIELD_MODELNAME:
 		case FIELD_SOUNDNAME:
@@ -2100,23 +2311,8 @@ int CSave ::WriteFields(const char *pname, void *pBaseData, TYPEDESCRIPTION *pFi
 			WriteInt(pTest->fieldName, entityArray, pTest->fieldSize);
 			break;
 		case FIELD_POSITION_VECTOR:
-			WritePositionVector(pTest->fieldName, (float *)pOutputData, pTest->fieldSize);
-			break;
-		case FIELD_VECTOR:
-			WriteVector(pTest->fieldName, (float *)pOutputData, pTest->fieldSize);
-			break;
-
-		case FIELD_BOOLEAN:
-		case FIELD_INTEGER:
-			WriteInt(pTest->fieldName, (int *)pOutputData, pTest->fieldSize);
-			break;
-
-		case FIELD_SHORT:
-			WriteData(pTest->fieldName, 2 * pTest->fieldSize, ((char *)pOutputData));
-			break;
-
-		case FIELD_CHARACTER:
-			WriteData(pTest->fieldName, pTest->fieldSize, ((char *)pOutputData));
+			BufferHeader(TokenHash(pTest->fieldName, table.GetNameHash(i)), sizeof(float) * 3 * pTest->fieldSize);
+			BufferPositionVector((float *)pOutputData, pTest->fieldSize);
 			break;
 
 		// For now, just write the address out, we're not going to change memory while doing this yet!
@@ -2155,13 +2351,23 @@ int CSave ::DataEmpty(const char *pdata, int size)
 
 void CSave ::BufferField(const char *pname, int size, const char *pdata)
 {
-	BufferHeader(pname, size);
+	BufferField(TokenHash(pname), size, pdata);
+}
+
+void CSave ::BufferField(unsigned short token, int size, const char *pdata)
+{
+	BufferHeader(token, size);
 	BufferData(pdata, size);
 }
 
 void CSave ::BufferHeader(const char *pname, int size)
 {
-	short hashvalue = TokenHash(pname);
+	BufferHeader(TokenHash(pname), size);
+}
+
+void CSave ::BufferHeader(unsigned short token, int size)
+{
+	short hashvalue = token;
 	if (size > 1 << (sizeof(short) * 8))
 		ALERT(at_error, "CSave :: BufferHeader() size parameter exceeds 'short'!");
 	BufferData((const char *)&size, sizeof(short));
@@ -2193,7 +2399,12 @@ void CSave ::BufferData(const char *pdata, int size)
 
 int CRestore::ReadField(void *pBaseData, TYPEDESCRIPTION *pFields, int fieldCount, int startField, int size, char *pName, void *pData)
 {
-	int i, j, stringCount, fieldNumber, entityIndex;
+	return ReadField(pBaseData, pFields, GetSaveFieldTable(pFields, fieldCount), startField, size, pName, pData);
+}
+
+int CRestore::ReadField(void *pBaseData, TYPEDESCRIPTION *pFields, const CSaveFieldTable &table, int startField, int size, char *pName, void *pData)
+{
+	int j, stringCount, fieldNumber, entityIndex;
 	TYPEDESCRIPTION *pTest;
 	float time, timeData;
 	Vector position;
@@ -2210,150 +2421,132 @@ int CRestore::ReadField(void *pBaseData, TYPEDESCRIPTION *pFields, int fieldCoun
 			position = m_pdata->vecLandmarkOffset;
 	}
 
-	for (i = 0; i < fieldCount; i++)
+	fieldNumber = table.FindField(pName, startField);
+
+	if (fieldNumber == -1)
+		return -1;
+
+	pTest = &pFields[fieldNumber];
+	if (!m_global || !(pTest->flags & FTYPEDESC_GLOBAL))
 	{
-		fieldNumber = (i + startField) % fieldCount;
-		pTest = &pFields[fieldNumber];
-		if (!_stricmp(pTest->fieldName, pName))
+		// Fields that are read as is: float, vector, integer, boolean, short and character
+		if (table.IsPlainData(fieldNumber))
+		{
+			memcpy((char *)pBaseData + pTest->fieldOffset, pData, table.GetDataSize(fieldNumber));
+			return fieldNumber;
+		}
+
+		for (j = 0; j < pTest->fieldSize; j++)
 		{
-			if (!m_global || !(pTest->flags & FTYPEDESC_GLOBAL))
+			void *pOutputData = ((char *)pBaseData + pTest->fieldOffset + (j * gSizes[pTest->fieldType]));
+			void *pInputData = (char *)pData + j * gSizes[pTest->fieldType];
+
+			switch (pTest->fieldType)
 			{
-				for (j = 0; j < pTest->fieldSize; j++)
+			case FIELD_TIME:
+				timeData = *(float *)pInputData;
+				// Re-base time variables
+				timeData += time;
+				*((float *)pOutputData) = timeData;
+				break;
+			case FIELD_MODELNAME:
+			case FIELD_SOUNDNAME:
+			case FIELD_STRING:
+				// Skip over j strings
+				pString = (char *)pData;
+				for (stringCount = 0; stringCount < j; stringCount++)
 				{
-					void *pOutputData = ((char *)pBaseData + pTest->fieldOffset + (j * gSizes[pTest->fieldType]));
-					void *pInputData = (char *)pData + j * gSizes[pTest->fieldType];
+					while (*pString)
+						pString++;
+					pString++;
+				}
+				pInputData = pString;
+				if (strlen((char *)pInputData) == 0)
+					*((int *)pOutputData) = 0;
+				else
+				{
+					int string;
+
+					string = ALLOC_STRING((char *)pInputData);
+
+					*((int *)pOutputData) = string;
 
-					switch (pTest->fieldType)
+					if (!FStringNull(string) && m_precache)
 					{
-					case FIELD_TIME:
-						timeData = *(float *)pInputData;
-						// Re-base time variables
-						timeData += time;
-						*((float *)pOutputData) = timeData;
-						break;
-					case FIELD_FLOAT:
-						*((float *)pOutputData) = *(float *)pInputData;
-						break;
-					case FIELD_MODELNAME:
-					case FIELD_SOUNDNAME:
-					case FIELD_STRING:
-						// Skip over j strings
-						pString = (char *)pData;
-						for (stringCount = 0; stringCount < j; stringCount++)
-						{
-							while (*pString)
-								pString++;
-							pString++;
-						}
-						pInputData = pString;
-						if (strlen((char *)pInputData) == 0)
-							*((int *)pOutputData) = 0;
-						else
-						{
-							int string;
-
-							string = ALLOC_STRING((char *)pInputData);
-
-							*((int *)pOutputData) = string;
-
-							if (!FStringNull(string) && m_precache)
-							{
-								if (pTest->fieldType == FIELD_MODELNAME)
-									PRECACHE_MODEL((char *)STRING(string));
-								else if (pTest->fieldType == FIELD_SOUNDNAME)
-									PRECACHE_SOUND((char *)STRING(string));
-							}
-						}
-						break;
-					case FIELD_EVARS:
-						entityIndex = *(int *)pInputData;
-						pent = EntityFromIndex(entityIndex);
-						if (pent)
-							*((entvars_t **)pOutputData) = VARS(pent);
-						else
-							*((entvars_t **)pOutputData) = NULL;
-						break;
-					case FIELD_CLASSPTR:
-						entityIndex = *(int *)pInputData;
-						pent = EntityFromIndex(entityIndex);
-						if (pent)
-							*((CBaseEntity **)pOutputData) = CBaseEntity::Instance(pent);
-						else
-							*((CBaseEntity **)pOutputData) = NULL;
-						break;
-					case FIELD_EDICT:
-						entityIndex = *(int *)pInputData;
-						pent = EntityFromIndex(entityIndex);
-						*((edict_t **)pOutputData) = pent;
-						break;
-					case FIELD_EHANDLE:
-						// Input and Output sizes are different!
-						pOutputData = (char *)pOutputData + j * (sizeof(EHANDLE) - gSizes[pTest->fieldType]);
-						entityIndex = *(int *)pInputData;
-						pent = EntityFromIndex(entityIndex);
-						if (pent)
-							*((EHANDLE *)pOutputData) = CBaseEntity::Instance(pent);
-						else
-							*((EHANDLE *)pOutputData) = NULL;
-						break;
-					case FIELD_ENTITY:
-						entityIndex = *(int *)pInputData;
-						pent = EntityFromIndex(entityIndex);
-						if (pent)
-							*((EOFFSET *)pOutputData) = OFFSET(pent);
-						else
-							*((EOFFSET *)pOutputData) = 0;
-						break;
-					case FIELD_VECTOR:
-						((float *)pOutputData)[0] = ((float *)pInputData)[0];
-						((float *)pOutputData)[1] = ((float *)pInputData)[1];
-						((float *)pOutputData)[2] = ((float *)pInputData)[2];
-						break;
-					case FIELD_POSITION_VECTOR:
-						((float *)pOutputData)[0] = ((float *)pInputData)[0] + position.x;
-						((float *)pOutputData)[1] = ((float *)pInputData)[1] + position.y;
-						((float *)pOutputData)[2] = ((float *)pInputData)[2] + position.z;
-						break;
-
-					case FIELD_BOOLEAN:
-					case FIELD_INTEGER:
-						*((int *)pOutputData) = *(int *)pInputData;
-						break;
-
-					case FIELD_SHORT:
-						*((short *)pOutputData) = *(short *)pInputData;
-						break;
-
-					case FIELD_CHARACTER:
-						*((char *)pOutputData) = *(char *)pInputData;
-						break;
-
-					case FIELD_POINTER:
-						*((int *)pOutputData) = *(int *)pInputData;
-						break;
-					case FIELD_FUNCTION:
-						if (strlen((char *)pInputData) == 0)
-							*((int *)pOutputData) = 0;
-						else
-							*((int *)pOutputData) = FUNCTION_FROM_NAME((char *)pInputData);
-						break;
-
-					default:
-						ALERT(at_error, "Bad field type\n");
+						if (pTest->fieldType == FIELD_MODELNAME)
+							PRECACHE_MODEL((char *)STRING(string));
+						else if (pTest->fieldType == FIELD_SOUNDNAME)
+							PRECACHE_SOUND((char *)STRING(string));
 					}
 				}
+				break;
+			case FIELD_EVARS:
+				entityIndex = *(int *)pInputData;
+				pent = EntityFromIndex(entityIndex);
+				if (pent)
+					*((entvars_t **)pOutputData) = VARS(pent);
+				else
+					*((entvars_t **)pOutputData) = NULL;
+				break;
+			case FIELD_CLASSPTR:
+				entityIndex = *(int *)pInputData;
+				pent = EntityFromIndex(entityIndex);
+				if (pent)
+					*((CBaseEntity **)pOutputData) = CBaseEntity::Instance(pent);
+				else
+					*((CBaseEntity **)pOutputData) = NULL;
+				break;
+			case FIELD_EDICT:
+				entityIndex = *(int *)pInputData;
+				pent = EntityFromIndex(entityIndex);
+				*((edict_t **)pOutputData) = pent;
+				break;
+			case FIELD_EHANDLE:
+				// Input and Output sizes are different!
+				pOutputData = (char *)pOutputData + j * (sizeof(EHANDLE) - gSizes[pTest->fieldType]);
+				entityIndex = *(int *)pInputData;
+				pent = EntityFromIndex(entityIndex);
+				if (pent)
+					*((EHANDLE *)pOutputData) = CBaseEntity::Instance(pent);
+				else
+					*((EHANDLE *)pOutputData) = NULL;
+				break;
+			case FIELD_ENTITY:
+				entityIndex = *(int *)pInputData;
+				pent = EntityFromIndex(entityIndex);
+				if (pent)
+					*((EOFFSET *)pOutputData) = OFFSET(pent);
+				else
+					*((EOFFSET *)pOutputData) = 0;
+				break;
+			case FIELD_POSITION_VECTOR:
+				((float *)pOutputData)[0] = ((float *)pInputData)[0] + position.x;
+				((float *)pOutputData)[1] = ((float *)pInputData)[1] + position.y;
+				((float *)pOutputData)[2] = ((float *)pInputData)[2] + position.z;
+				break;
+
+			case FIELD_POINTER:
+				*((int *)pOutputData) = *(int *)pInputData;
+				break;
+			case FIELD_FUNCTION:
+				if (strlen((char *)pInputData) == 0)
+					*((int *)pOutputData) = 0;
+				else
+					*((int *)pOutputData) = FUNCTION_FROM_NAME((char *)pInputData);
+				break;
+
+			default:
+				ALERT(at_error, "Bad field type\n");
 			}
-#if 0
-			else
-			{
-				ALERT( at_console, "Skipping global field %s\n", pName );
-			}
-#endif
-			return fieldNumber;
 		}
 	}
-
-	return -1;
+#if 0
+	else
+	{
+		ALERT( at_console, "Skipping global field %s\n", pName );
+	}
+#endif
+	return fieldNumber;
 }
 
 int CRestore::ReadEntVars(const char *pname, entvars_t *pev)
@@ -2383,6 +2576,8 @@ int CRestore::ReadFields(const char *pname, void *pBaseData, TYPEDESCRIPTION *pF
 	// Skip over the struct name
 	fileCount = ReadInt(); // Read field count
 
+	const CSaveFieldTable &table = GetSaveFieldTable(pFields, fieldCount);
+
 	lastField = 0; // Make searches faster, most data is read/written in the same order
 
 	// Clear out base data
@@ -2390,13 +2585,13 @@ int CRestore::ReadFields(const char *pname, void *pBaseData, TYPEDESCRIPTION *pF
 	{
 		// Don't clear global fields
 		if (!m_global || !(pFields[i].flags & FTYPEDESC_GLOBAL))
-			memset(((char *)pBaseData + pFields[i].fieldOffset), 0, pFields[i].fieldSize * gSizes[pFields[i].fieldType]);
+			memset(((char *)pBaseData + pFields[i].fieldOffset), 0, table.GetDataSize(i));
 	}
 
 	for (i = 0; i < fileCount; i++)
 	{
 		BufferReadHeader(&header);
-		lastField = ReadField(pBaseData, pFields, fieldCount, lastField, header.size, m_pdata->pTokens[header.token], header.pData);
+		lastField = ReadField(pBaseData, pFields, table, lastField, header.size, m_pdata->pTokens[header.token], header.pData);
 		lastField++;
 	}
 
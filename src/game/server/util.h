@@ -51,14 +51,18 @@ inline __attribute__((no_sanitize_address)) string_t MAKE_STRING(const char *str
 #define MAKE_STRING(str) ((uint64)(str) - (uint64)(STRING(0)))
 #endif
 
+// Use the entity name index instead of the engine scan
+extern edict_t *UTIL_FindEdictByClassname(edict_t *entStart, const char *pszName);
+extern edict_t *UTIL_FindEdictByTargetname(edict_t *entStart, const char *pszName);
+
 inline edict_t *FIND_ENTITY_BY_CLASSNAME(edict_t *entStart, const char *pszName)
 {
-	return FIND_ENTITY_BY_STRING(entStart, "classname", pszName);
+	return UTIL_FindEdictByClassname(entStart, pszName);
 }
 
 inline edict_t *FIND_ENTITY_BY_TARGETNAME(edict_t *entStart, const char *pszName)
 {
-	return FIND_ENTITY_BY_STRING(entStart, "targetname", pszName);
+	return UTIL_FindEdictByTargetname(entStart, pszName);
 }
 
 // for doing a reverse lookup. Say you have a door, and want to find its button.
@@ -263,6 +267,18 @@ extern void UTIL_MakeVectors(const Vector &vecAngles);
 extern int UTIL_MonstersInSphere(CBaseEntity **pList, int listMax, const Vector &center, float radius);
 extern int UTIL_EntitiesInBox(CBaseEntity **pList, int listMax, const Vector &mins, const Vector &maxs, int flagMask);
 
+// Grid of entity boxes used by the functions above
+extern void UTIL_UpdateEntityGrid(edict_t *pent);
+extern void UTIL_RemoveFromEntityGrid(edict_t *pent);
+extern void UTIL_SyncEntityGrid(void);
+extern void UTIL_ClearEntityGrid(void);
+
+// Index of entities by classname and targetname used by FIND_ENTITY_BY_CLASSNAME/TARGETNAME
+extern void UTIL_UpdateEntityNames(edict_t *pent);
+extern void UTIL_RemoveFromEntityNames(edict_t *pent);
+extern void UTIL_SyncEntityNames(void);
+extern void UTIL_ClearEntityNames(void);
+
 inline void UTIL_MakeVectorsPrivate(const Vector &vecAngles, float *p_vForward, float *p_vRight, float *p_vUp)
 {
 	g_engfuncs.pfnAngleVectors(vecAngles, p_vForward, p_vRight, p_vUp);
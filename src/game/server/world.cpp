@@ -212,10 +212,14 @@ static void InitBodyQue(void)
 	g_pBodyQueueHead = CREATE_NAMED_ENTITY(istrClassname);
 	entvars_t *pev = VARS(g_pBodyQueueHead);
 
+	// Not spawned, so the name index doesn't see them otherwise
+	UTIL_UpdateEntityNames(g_pBodyQueueHead);
+
 	// Reserve 3 more slots for dead bodies
 	for (int i = 0; i < 3; i++)
 	{
 		pev->owner = CREATE_NAMED_ENTITY(istrClassname);
+		UTIL_UpdateEntityNames(pev->owner);
 		pev = VARS(pev->owner);
 	}
 
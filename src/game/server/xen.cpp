@@ -221,6 +221,7 @@ CXenTreeTrigger *CXenTreeTrigger ::TriggerCreate(edict_t *pOwner, const Vector &
 	CXenTreeTrigger *pTrigger = GetClassPtr((CXenTreeTrigger *)NULL);
 	pTrigger->pev->origin = position;
 	pTrigger->pev->classname = MAKE_STRING("xen_ttrigger");
+	UTIL_UpdateEntityNames(pTrigger->edict());
 	pTrigger->pev->solid = SOLID_TRIGGER;
 	pTrigger->pev->movetype = MOVETYPE_NONE;
 	pTrigger->pev->owner = pOwner;
@@ -453,6 +454,7 @@ CXenHull *CXenHull ::CreateHull(CBaseEntity *source, const Vector &mins, const V
 	SET_MODEL(pHull->edict(), STRING(source->pev->model));
 	pHull->pev->solid = SOLID_BBOX;
 	pHull->pev->classname = MAKE_STRING("xen_hull");
+	UTIL_UpdateEntityNames(pHull->edict());
 	pHull->pev->movetype = MOVETYPE_NONE;
 	pHull->pev->owner = source->edict();
 	UTIL_SetSize(pHull->pev, mins, maxs);
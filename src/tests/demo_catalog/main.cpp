@@ -0,0 +1,666 @@
+//
+// Demo catalog test and benchmark.
+//
+// Checks that CDemoCatalog keeps demos between runs, imports the old text demo
+// list, purges demos by age and total size, survives a damaged log and compacts it.
+// The benchmark compares the time the game thread spends purging a long demo list
+// with the text list rewrite that the catalog replaced.
+//
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <string>
+#include <vector>
+#include <demo_catalog.h>
+
+namespace fs = std::filesystem;
+
+namespace
+{
+
+using Clock = std::chrono::high_resolution_clock;
+
+constexpr char CATALOG_NAME[] = "demolist.bin";
+constexpr char OLD_LIST_NAME[] = "tempdemolist.txt";
+constexpr int64_t DAY = 24 * 60 * 60;
+
+constexpr int BENCH_DEMOS = 5000;
+constexpr int BENCH_OLD_DEMOS = 500; // Removed by the purge
+constexpr int BENCH_KEEP_DAYS = 14;
+
+}
+
+class CDemoCatalogTest
+{
+public:
+	int Run();
+	[[noreturn]] void FatalError(const std::string &msg);
+
+private:
+	fs::path m_TempPath;
+	std::string m_GameDir;
+
+	void ResetDir();
+	void WriteFile(const std::string &relPath, size_t size);
+	bool FileExists(const std::string &relPath);
+	void AppendOldListRow(FILE *file, int64_t time, const std::string &relPath);
+	static CDemoCatalog::PurgePolicy MakePolicy(int64_t now, int keepDays, uint64_t maxBytes);
+	void CheckCount(const CDemoCatalog &catalog, int count);
+
+	/**
+	 * Purge of the text demo list that was used before the catalog.
+	 */
+	static int OldPurgeDemos(const std::string &gameDir, const std::string &listPath, int keepDays);
+
+	void TestReopen();
+	void TestImportOldList();
+	void TestPurgeByAge();
+	void TestPurgeByQuota();
+	void TestMissingFiles();
+	void TestDamagedLog();
+	void TestCompaction();
+	void TestFind();
+	void RunBenchmark();
+};
+
+int main()
+{
+	CDemoCatalogTest test;
+	return test.Run();
+}
+
+int CDemoCatalogTest::Run()
+{
+	m_TempPath = fs::temp_directory_path() / "bhl_test_demo_catalog";
+	m_GameDir = m_TempPath.u8string() + "/";
+
+	TestReopen();
+	TestImportOldList();
+	TestPurgeByAge();
+	TestPurgeByQuota();
+	TestMissingFiles();
+	TestDamagedLog();
+	TestCompaction();
+	TestFind();
+	RunBenchmark();
+
+	fs::remove_all(m_TempPath);
+	return 0;
+}
+
+void CDemoCatalogTest::FatalError(const std::string &msg)
+{
+	fprintf(stderr, "Fatal Error: %s\n", msg.c_str());
+	exit(1);
+}
+
+void CDemoCatalogTest::ResetDir()
+{
+	fs::remove_all(m_TempPath);
+	fs::create_directories(m_TempPath / "results");
+}
+
+void CDemoCatalogTest::WriteFile(const std::string &relPath, size_t size)
+{
+	FILE *file = fopen((m_GameDir + relPath).c_str(), "wb");
+
+	if (!file)
+		FatalError("Failed to create " + relPath);
+
+	std::vector<char> data(size, 'd');
+	fwrite(data.data(), 1, data.size(), file);
+	fclose(file);
+}
+
+bool CDemoCatalogTest::FileExists(const std::string &relPath)
+{
+	return fs::exists(fs::u8path(m_GameDir + relPath));
+}
+
+void CDemoCatalogTest::AppendOldListRow(FILE *file, int64_t time, const std::string &relPath)
+{
+	// Same as StartDemoRecording wrote it
+	time_t t = (time_t)time;
+	char date[32];
+	strftime(date, sizeof(date), "%Y-%m-%d %H:%M:%S", localtime(&t));
+	fprintf(file, "[%s] %s\n", date, relPath.c_str());
+}
+
+CDemoCatalog::PurgePolicy CDemoCatalogTest::MakePolicy(int64_t now, int keepDays, uint64_t maxBytes)
+{
+	CDemoCatalog::PurgePolicy policy;
+	policy.now = now;
+	policy.keepDays = keepDays;
+	policy.maxBytes = maxBytes;
+	return policy;
+}
+
+void CDemoCatalogTest::CheckCount(const CDemoCatalog &catalog, int count)
+{
+	CDemoCatalog::Stats stats = catalog.GetStats();
+
+	if (stats.count != count)
+		FatalError("Expected " + std::to_string(count) + " demos, got " + std::to_string(stats.count));
+}
+
+int CDemoCatalogTest::OldPurgeDemos(const std::string &gameDir, const std::string &listPath, int keepDays)
+{
+	char buf[512], fileName[512];
+	int readPos = 0, writePos = 0, removed = 0;
+	bool deleteRow = true;
+
+	time_t now;
+	time(&now);
+	now -= keepDays * 24 * 60 * 60;
+
+	FILE *file = fopen(listPath.c_str(), "r+b");
+
+	if (!file)
+		return 0;
+
+	while (fgets(buf, sizeof(buf), file) != NULL)
+	{
+		deleteRow = true;
+
+		if (buf[0] == '[' && buf[20] == ']')
+		{
+			buf[20] = 0;
+			struct tm inTm;
+			memset(&inTm, 0, sizeof(inTm));
+			int scanResult = sscanf(buf + 1, "%4d-%2d-%2d %2d:%2d:%2d", &inTm.tm_year, &inTm.tm_mon, &inTm.tm_mday, &inTm.tm_hour, &inTm.tm_min, &inTm.tm_sec);
+
+			if (scanResult == 6)
+			{
+				inTm.tm_year -= 1900;
+				inTm.tm_mon -= 1;
+				inTm.tm_isdst = -1;
+
+				if (mktime(&inTm) < now)
+				{
+					char *fname = &buf[22];
+					int len = (int)strlen(fname) - 1;
+
+					while (len >= 0 && (fname[len] == '\r' || fname[len] == '\n'))
+						fname[len--] = 0;
+
+					snprintf(fileName, sizeof(fileName), "%s%s", gameDir.c_str(), fname);
+					std::error_code ec;
+
+					if (fs::remove(fs::u8path(fileName), ec))
+						removed++;
+				}
+				else
+				{
+					deleteRow = false;
+				}
+			}
+		}
+
+		if (deleteRow)
+		{
+			readPos = ftell(file);
+			continue;
+		}
+
+		if (readPos != writePos)
+		{
+			buf[20] = ']';
+			readPos = ftell(file);
+			fseek(file, writePos, SEEK_SET);
+			fputs(buf, file);
+			writePos = ftell(file);
+			fseek(file, readPos, SEEK_SET);
+		}
+		else
+		{
+			readPos = ftell(file);
+			writePos = readPos;
+		}
+	}
+
+	fclose(file);
+	fs::resize_file(fs::u8path(listPath), writePos);
+	return removed;
+}
+
+void CDemoCatalogTest::TestReopen()
+{
+	fprintf(stderr, "Checking reopening...\n");
+	ResetDir();
+
+	int64_t now = (int64_t)time(nullptr);
+	uint32_t ids[3];
+
+	{
+		CDemoCatalog catalog;
+
+		if (!catalog.Open(m_GameDir.c_str(), CATALOG_NAME, OLD_LIST_NAME))
+			FatalError("New catalog is reported as damaged");
+
+		for (int i = 0; i < 3; i++)
+		{
+			std::string path = "results/crossfire-" + std::to_string(i) + ".dem";
+			ids[i] = catalog.AddDemo(path.c_str(), "crossfire", now + i);
+			WriteFile(path, 1000 * (i + 1));
+			catalog.FinishDemo(ids[i], MakePolicy(now, 14, 0));
+		}
+
+		catalog.Flush();
+
+		if (ids[0] == 0 || ids[1] <= ids[0] || ids[2] <= ids[1])
+			FatalError("Ids aren't increasing");
+
+		CDemoCatalog::Stats stats = catalog.GetStats();
+
+		if (stats.count != 3 || stats.totalBytes != 6000 || stats.unknownSizeCount != 0 || stats.isPurging)
+			FatalError("Wrong stats after adding demos");
+
+		// Recording demo without a file yet
+		catalog.AddDemo("results/crossfire-3.dem", "crossfire", now + 3);
+		catalog.Shutdown();
+	}
+
+	CDemoCatalog catalog;
+
+	if (!catalog.Open(m_GameDir.c_str(), CATALOG_NAME, OLD_LIST_NAME))
+		FatalError("Reopened catalog is reported as damaged");
+
+	size_t matchCount;
+	std::vector<CDemoCatalog::Demo> demos = catalog.Find(nullptr, 10, matchCount);
+
+	if (demos.size() != 4 || matchCount != 4)
+		FatalError("Demos weren't kept: " + std::to_string(demos.size()));
+
+	for (int i = 0; i < 3; i++)
+	{
+		if (demos[i].id != ids[i] || demos[i].size != 1000u * (i + 1) || demos[i].time != now + i || demos[i].map != "crossfire")
+			FatalError("Wrong demo " + std::to_string(i) + " after reopening");
+	}
+
+	if (demos[3].size != 0 || demos[3].path != "results/crossfire-3.dem")
+		FatalError("Wrong unfinished demo after reopening");
+
+	if (catalog.AddDemo("results/crossfire-4.dem", "crossfire", now + 4) <= demos[3].id)
+		FatalError("Ids are reused after reopening");
+
+	catalog.Shutdown();
+	fprintf(stderr, "Good\n\n");
+}
+
+void CDemoCatalogTest::TestImportOldList()
+{
+	fprintf(stderr, "Checking import of the old demo list...\n");
+	ResetDir();
+
+	int64_t now = (int64_t)time(nullptr);
+	FILE *file = fopen((m_GameDir + OLD_LIST_NAME).c_str(), "wb");
+	AppendOldListRow(file, now - 2 * DAY, "results/2020-01/crossfire-20200101-120000.dem");
+	fprintf(file, "garbage\n");
+	AppendOldListRow(file, now - DAY, "results/2020-01/boot_camp-20200102-120000.dem");
+	AppendOldListRow(file, now - DAY, "results/2020-01/boot_camp-20200102-120000.dem");
+	fprintf(file, "[2020-01-03 12:00:00] results/2020-01/stalkyard-20200103-120000.dem\r\n");
+	fclose(file);
+
+	WriteFile("results/crossfire.dem", 10);
+
+	{
+		CDemoCatalog catalog;
+		catalog.Open(m_GameDir.c_str(), CATALOG_NAME, OLD_LIST_NAME);
+		catalog.Flush();
+
+		size_t matchCount;
+		std::vector<CDemoCatalog::Demo> demos = catalog.Find(nullptr, 10, matchCount);
+
+		if (demos.size() != 3)
+			FatalError("Expected 3 imported demos, got " + std::to_string(demos.size()));
+
+		if (demos[0].map != "crossfire" || demos[1].map != "boot_camp" || demos[2].map != "stalkyard")
+			FatalError("Wrong maps of imported demos: " + demos[0].map + ", " + demos[1].map + ", " + demos[2].map);
+
+		if (demos[0].time != now - 2 * DAY || demos[2].path != "results/2020-01/stalkyard-20200103-120000.dem")
+			FatalError("Wrong imported demo");
+
+		if (FileExists(OLD_LIST_NAME))
+			FatalError("Old list wasn't removed");
+
+		catalog.Shutdown();
+	}
+
+	CDemoCatalog catalog;
+	catalog.Open(m_GameDir.c_str(), CATALOG_NAME, OLD_LIST_NAME);
+	CheckCount(catalog, 3);
+	catalog.Shutdown();
+
+	fprintf(stderr, "Good\n\n");
+}
+
+void CDemoCatalogTest::TestPurgeByAge()
+{
+	fprintf(stderr, "Checking purging by age...\n");
+	ResetDir();
+
+	int64_t now = (int64_t)time(nullptr);
+	CDemoCatalog catalog;
+	catalog.Open(m_GameDir.c_str(), CATALOG_NAME, nullptr);
+
+	const int ages[] = { 30, 20, 15, 13, 1 };
+
+	for (int age : ages)
+	{
+		std::string path = "results/age-" + std::to_string(age) + ".dem";
+		WriteFile(path, 100);
+		uint32_t id = catalog.AddDemo(path.c_str(), "datacore", now - age * DAY);
+		catalog.FinishDemo(id, MakePolicy(now + 100 * DAY, 1000, 0));
+	}
+
+	catalog.Purge(MakePolicy(now, 14, 0));
+	catalog.Flush();
+
+	CDemoCatalog::PurgeResult result;
+
+	if (!catalog.TakePurgeResult(result))
+		FatalError("No purge result");
+
+	if (result.removedCount != 3 || result.removedBytes != 300 || !result.errors.empty())
+		FatalError("Wrong purge result: " + std::to_string(result.removedCount) + " removed");
+
+	if (catalog.TakePurgeResult(result))
+		FatalError("Purge result was taken twice");
+
+	if (FileExists("results/age-30.dem") || FileExists("results/age-15.dem") || !FileExists("results/age-13.dem"))
+		FatalError("Wrong files were removed");
+
+	CheckCount(catalog, 2);
+	catalog.Shutdown();
+
+	// Removal is in the log
+	catalog.Open(m_GameDir.c_str(), CATALOG_NAME, nullptr);
+	CheckCount(catalog, 2);
+	catalog.Shutdown();
+
+	fprintf(stderr, "Good\n\n");
+}
+
+void CDemoCatalogTest::TestPurgeByQuota()
+{
+	fprintf(stderr, "Checking purging by size...\n");
+	ResetDir();
+
+	int64_t now = (int64_t)time(nullptr);
+	CDemoCatalog catalog;
+	catalog.Open(m_GameDir.c_str(), CATALOG_NAME, nullptr);
+
+	for (int i = 0; i < 5; i++)
+	{
+		std::string path = "results/quota-" + std::to_string(i) + ".dem";
+		WriteFile(path, 1000);
+		uint32_t id = catalog.AddDemo(path.c_str(), "rapidcore", now - 10 + i);
+		catalog.FinishDemo(id, MakePolicy(now, 14, 0));
+	}
+
+	// The recording demo is never removed, even if it's the oldest
+	WriteFile("results/quota-recording.dem", 1000);
+	catalog.AddDemo("results/quota-recording.dem", "rapidcore", now - 100);
+
+	catalog.Purge(MakePolicy(now, 14, 2500));
+	catalog.Flush();
+
+	CDemoCatalog::PurgeResult result;
+	catalog.TakePurgeResult(result);
+
+	if (result.removedCount != 3 || result.removedBytes != 3000)
+		FatalError("Expected 3 removed demos, got " + std::to_string(result.removedCount));
+
+	if (FileExists("results/quota-2.dem") || !FileExists("results/quota-3.dem") || !FileExists("results/quota-recording.dem"))
+		FatalError("Wrong files were removed");
+
+	CheckCount(catalog, 3);
+	catalog.Shutdown();
+
+	fprintf(stderr, "Good\n\n");
+}
+
+void CDemoCatalogTest::TestMissingFiles()
+{
+	fprintf(stderr, "Checking demos without files...\n");
+	ResetDir();
+
+	int64_t now = (int64_t)time(nullptr);
+	CDemoCatalog catalog;
+	catalog.Open(m_GameDir.c_str(), CATALOG_NAME, nullptr);
+
+	WriteFile("results/exists.dem", 10);
+	catalog.FinishDemo(catalog.AddDemo("results/exists.dem", "frenzy", now), MakePolicy(now, 14, 0));
+	catalog.FinishDemo(catalog.AddDemo("results/missing.dem", "frenzy", now), MakePolicy(now, 14, 0));
+	catalog.Flush();
+
+	size_t matchCount;
+	std::vector<CDemoCatalog::Demo> demos = catalog.Find(nullptr, 10, matchCount);
+
+	if (demos.size() != 1 || demos[0].path != "results/exists.dem")
+		FatalError("Demo without a file wasn't removed");
+
+	CDemoCatalog::PurgeResult result;
+	catalog.TakePurgeResult(result);
+
+	if (result.removedCount != 0 || !result.errors.empty())
+		FatalError("Demo without a file is counted as purged");
+
+	catalog.Shutdown();
+	fprintf(stderr, "Good\n\n");
+}
+
+void CDemoCatalogTest::TestDamagedLog()
+{
+	fprintf(stderr, "Checking damaged log...\n");
+	ResetDir();
+
+	int64_t now = (int64_t)time(nullptr);
+
+	{
+		CDemoCatalog catalog;
+		catalog.Open(m_GameDir.c_str(), CATALOG_NAME, nullptr);
+		catalog.AddDemo("results/a.dem", "bounce", now);
+		catalog.AddDemo("results/b.dem", "bounce", now);
+		catalog.Shutdown();
+	}
+
+	std::string catalogPath = m_GameDir + CATALOG_NAME;
+	uint64_t validSize = fs::file_size(fs::u8path(catalogPath));
+
+	// Record that was cut by a crash
+	FILE *file = fopen(catalogPath.c_str(), "ab");
+	const char tail[] = { 1, 3, 0 };
+	fwrite(tail, 1, sizeof(tail), file);
+	fclose(file);
+
+	{
+		CDemoCatalog catalog;
+
+		if (catalog.Open(m_GameDir.c_str(), CATALOG_NAME, nullptr))
+			FatalError("Damaged catalog isn't reported");
+
+		catalog.Flush();
+		CheckCount(catalog, 2);
+
+		if (fs::file_size(fs::u8path(catalogPath)) != validSize)
+			FatalError("Damaged catalog wasn't rewritten");
+
+		catalog.Shutdown();
+	}
+
+	// Not a catalog at all
+	file = fopen(catalogPath.c_str(), "wb");
+	fprintf(file, "[2020-01-01 12:00:00] results/a.dem\n");
+	fclose(file);
+
+	CDemoCatalog catalog;
+
+	if (catalog.Open(m_GameDir.c_str(), CATALOG_NAME, nullptr))
+		FatalError("Wrong file isn't reported");
+
+	CheckCount(catalog, 0);
+	catalog.AddDemo("results/c.dem", "bounce", now);
+	catalog.Shutdown();
+
+	if (!catalog.Open(m_GameDir.c_str(), CATALOG_NAME, nullptr))
+		FatalError("Rewritten catalog is reported as damaged");
+
+	CheckCount(catalog, 1);
+	catalog.Shutdown();
+
+	fprintf(stderr, "Good\n\n");
+}
+
+void CDemoCatalogTest::TestCompaction()
+{
+	fprintf(stderr, "Checking compaction...\n");
+	ResetDir();
+
+	int64_t now = (int64_t)time(nullptr);
+	const int count = (int)CDemoCatalog::MIN_COMPACT_RECORDS;
+	CDemoCatalog catalog;
+	catalog.Open(m_GameDir.c_str(), CATALOG_NAME, nullptr);
+
+	for (int i = 0; i < count; i++)
+	{
+		std::string path = "results/compact-" + std::to_string(i) + ".dem";
+		WriteFile(path, 10);
+		int64_t time = i < count - 10 ? now - 30 * DAY + i : now - DAY + i;
+		catalog.FinishDemo(catalog.AddDemo(path.c_str(), "snark_pit", time), MakePolicy(now, 1000, 0));
+	}
+
+	catalog.Flush();
+
+	std::string catalogPath = m_GameDir + CATALOG_NAME;
+	uint64_t fullSize = fs::file_size(fs::u8path(catalogPath));
+
+	// Everything but the newest 10 demos
+	catalog.Purge(MakePolicy(now, 14, 0));
+	catalog.Flush();
+	CheckCount(catalog, 10);
+
+	uint64_t compactSize = fs::file_size(fs::u8path(catalogPath));
+
+	if (compactSize * 10 > fullSize)
+		FatalError("Log wasn't compacted: " + std::to_string(compactSize) + " of " + std::to_string(fullSize) + " bytes");
+
+	catalog.Shutdown();
+
+	if (!catalog.Open(m_GameDir.c_str(), CATALOG_NAME, nullptr))
+		FatalError("Compacted catalog is reported as damaged");
+
+	CDemoCatalog::Stats stats = catalog.GetStats();
+
+	if (stats.count != 10 || stats.totalBytes != 100)
+		FatalError("Wrong stats after compaction");
+
+	catalog.Shutdown();
+	fprintf(stderr, "Good\n\n");
+}
+
+void CDemoCatalogTest::TestFind()
+{
+	fprintf(stderr, "Checking search...\n");
+	ResetDir();
+
+	int64_t now = (int64_t)time(nullptr);
+	CDemoCatalog catalog;
+	catalog.Open(m_GameDir.c_str(), CATALOG_NAME, nullptr);
+
+	const char *maps[] = { "crossfire", "boot_camp", "Crossfire_2", "stalkyard", "crossfire" };
+
+	for (int i = 0; i < 5; i++)
+		catalog.AddDemo(("results/find-" + std::to_string(i) + ".dem").c_str(), maps[i], now + i);
+
+	size_t matchCount;
+	std::vector<CDemoCatalog::Demo> demos = catalog.Find("CROSS", 2, matchCount);
+
+	if (matchCount != 3 || demos.size() != 2)
+		FatalError("Expected 2 of 3 matches, got " + std::to_string(demos.size()) + " of " + std::to_string(matchCount));
+
+	if (demos[0].path != "results/find-2.dem" || demos[1].path != "results/find-4.dem")
+		FatalError("Newest matches aren't returned oldest first");
+
+	demos = catalog.Find("", 100, matchCount);
+
+	if (matchCount != 5 || demos.size() != 5)
+		FatalError("Empty filter doesn't match all demos");
+
+	demos = catalog.Find("datacore", 100, matchCount);
+
+	if (matchCount != 0 || !demos.empty())
+		FatalError("Wrong map is matched");
+
+	catalog.Shutdown();
+	fprintf(stderr, "Good\n\n");
+}
+
+void CDemoCatalogTest::RunBenchmark()
+{
+	fprintf(stderr, "Benchmark: purging %d of %d demos\n", BENCH_OLD_DEMOS, BENCH_DEMOS);
+
+	int64_t now = (int64_t)time(nullptr);
+	std::string oldListPath = m_GameDir + OLD_LIST_NAME;
+	std::vector<std::string> paths;
+
+	for (int i = 0; i < BENCH_DEMOS; i++)
+		paths.push_back("results/bench-" + std::to_string(i) + ".dem");
+
+	auto createDemos = [&]() {
+		ResetDir();
+		FILE *file = fopen(oldListPath.c_str(), "wb");
+
+		for (int i = 0; i < BENCH_DEMOS; i++)
+		{
+			// Oldest demos are past BENCH_KEEP_DAYS
+			int64_t time = i < BENCH_OLD_DEMOS ? now - 2 * BENCH_KEEP_DAYS * DAY + i : now - DAY + i;
+			WriteFile(paths[i], 16);
+			AppendOldListRow(file, time, paths[i]);
+		}
+
+		fclose(file);
+	};
+
+	// Text list rewrite on the game thread
+	createDemos();
+	auto start = Clock::now();
+	int removed = OldPurgeDemos(m_GameDir, oldListPath, BENCH_KEEP_DAYS);
+	double oldTime = std::chrono::duration<double>(Clock::now() - start).count();
+
+	if (removed != BENCH_OLD_DEMOS)
+		FatalError("Old purge removed " + std::to_string(removed) + " demos");
+
+	// Catalog with sizes already known
+	createDemos();
+	CDemoCatalog catalog;
+	catalog.Open(m_GameDir.c_str(), CATALOG_NAME, OLD_LIST_NAME);
+	catalog.Purge(MakePolicy(now, 1000, 0));
+	catalog.Flush();
+
+	CDemoCatalog::PurgeResult result;
+	catalog.TakePurgeResult(result);
+
+	// Game thread is blocked only by the call, the purge is done when Flush returns
+	start = Clock::now();
+	catalog.Purge(MakePolicy(now, BENCH_KEEP_DAYS, 0));
+	double callTime = std::chrono::duration<double>(Clock::now() - start).count();
+	catalog.Flush();
+	double totalTime = std::chrono::duration<double>(Clock::now() - start).count();
+
+	if (!catalog.TakePurgeResult(result) || result.removedCount != BENCH_OLD_DEMOS)
+		FatalError("Catalog purge removed " + std::to_string(result.removedCount) + " demos");
+
+	CheckCount(catalog, BENCH_DEMOS - BENCH_OLD_DEMOS);
+	catalog.Shutdown();
+
+	// The text list purge runs entirely on the game thread
+	fprintf(stderr, "                 Game thread      Total\n");
+	fprintf(stderr, "Text list:     %10.3f ms %10.3f ms\n", oldTime * 1000, oldTime * 1000);
+	fprintf(stderr, "Catalog:       %10.3f ms %10.3f ms\n", callTime * 1000, totalTime * 1000);
+	fprintf(stderr, "Speedup of total purge time: %.1fx\n", oldTime / totalTime);
+	fprintf(stderr, "\n");
+}
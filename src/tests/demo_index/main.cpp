@@ -0,0 +1,653 @@
+//
+// Demo index test and benchmark.
+//
+// Writes synthetic demos with every engine frame type and every client record
+// type, then checks what CDemoIndex finds in finished, unfinished and damaged
+// demos. The benchmark compares indexing of a demo archive with a reader that
+// freads every frame, and the parallel indexer with one thread.
+// Extra arguments are paths to real demos to benchmark.
+//
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include <demo.h>
+#include <demo_index.h>
+
+namespace fs = std::filesystem;
+
+namespace
+{
+
+using Clock = std::chrono::high_resolution_clock;
+
+constexpr int BENCH_FILES = 8;
+constexpr int BENCH_SECONDS = 600; // Length of a benchmark demo
+constexpr int BENCH_FPS = 30;
+
+}
+
+/**
+ * Writes demos in the engine format.
+ */
+class CDemoWriter
+{
+public:
+	CDemoWriter(const char *map = "crossfire")
+	{
+		m_Data.resize(CDemoIndex::HEADER_SIZE);
+		memcpy(m_Data.data(), "HLDEMO", 6);
+		PutInt(8, 5);
+		PutInt(12, 48);
+		strcpy((char *)m_Data.data() + 16, map);
+		strcpy((char *)m_Data.data() + 16 + 260, "ag");
+		PutInt(16 + 520, 0x12345678);
+	}
+
+	const std::vector<uint8_t> &GetData() const { return m_Data; }
+
+	void Frame(int type, float time, const std::vector<uint8_t> &data = {})
+	{
+		m_Data.push_back((uint8_t)type);
+		Append(&time, sizeof(time));
+		Append(&m_iFrame, sizeof(m_iFrame));
+		Append(data.data(), data.size());
+		m_iFrame++;
+	}
+
+	void NetworkFrame(float time, int msgLen)
+	{
+		std::vector<uint8_t> data(464 + 4 + msgLen, 0x5A);
+		memcpy(data.data() + 464, &msgLen, 4);
+		Frame(CDemoIndex::FRAME_NETWORK, time, data);
+	}
+
+	void SoundFrame(float time, const char *sample)
+	{
+		int len = (int)strlen(sample) + 1;
+		std::vector<uint8_t> data(8 + len + 16);
+		memcpy(data.data() + 4, &len, 4);
+		memcpy(data.data() + 8, sample, len);
+		Frame(CDemoIndex::FRAME_SOUND, time, data);
+	}
+
+	//! Same as Demo_WriteBuffer
+	void Record(float time, int type, const void *data, int size)
+	{
+		int len = size + 4;
+		std::vector<uint8_t> buf(4 + len);
+		memcpy(buf.data(), &len, 4);
+		memcpy(buf.data() + 4, &type, 4);
+		memcpy(buf.data() + 8, data, size);
+		Frame(CDemoIndex::FRAME_DEMO_BUFFER, time, buf);
+	}
+
+	void RecordFloat(float time, int type, float value) { Record(time, type, &value, sizeof(value)); }
+
+	void RecordTimer(float time, float endTime, int agVersion)
+	{
+		uint8_t buf[8];
+		memcpy(buf, &endTime, 4);
+		memcpy(buf + 4, &agVersion, 4);
+		Record(time, TYPE_TIMER, buf, sizeof(buf));
+	}
+
+	//! Same as CHudTimer::Think
+	void RecordCustomTimers(float time, float start1, float end1, float start2, float end2)
+	{
+		std::vector<uint8_t> buf(4 + 2 * 9);
+		int count = 2;
+		bool needSound = true;
+		memcpy(buf.data(), &count, 4);
+		memcpy(buf.data() + 4, &start1, 4);
+		memcpy(buf.data() + 8, &end1, 4);
+		memcpy(buf.data() + 12, &needSound, 1);
+		memcpy(buf.data() + 13, &start2, 4);
+		memcpy(buf.data() + 17, &end2, 4);
+		memcpy(buf.data() + 21, &needSound, 1);
+		Record(time, TYPE_CUSTOM_TIMER, buf.data(), (int)buf.size());
+	}
+
+	void RecordNextmap(float time, const char *map)
+	{
+		// Written without the terminator when the buffer is full
+		char buf[63] = {};
+		memcpy(buf, map, std::min(strlen(map), sizeof(buf)));
+		Record(time, TYPE_NEXTMAP, buf, sizeof(buf));
+	}
+
+	void RecordStatus(float time, unsigned magic = DEMO_SVC_STATUS_MAGIC)
+	{
+		Record(time, TYPE_SVC_STATUS, &magic, sizeof(magic));
+	}
+
+	void RecordSniperDot(float time, bool isOn)
+	{
+		std::vector<uint8_t> buf(isOn ? 4 + 4 + 24 : 4);
+		int on = isOn;
+		memcpy(buf.data(), &on, 4);
+		Record(time, TYPE_SNIPERDOT, buf.data(), (int)buf.size());
+	}
+
+	/**
+	 * Writes the directory like the engine does when recording is stopped.
+	 */
+	void Finish()
+	{
+		PutInt(540, (int)m_Data.size());
+		int count = 2;
+		Append(&count, 4);
+		m_Data.resize(m_Data.size() + count * 92);
+	}
+
+private:
+	std::vector<uint8_t> m_Data;
+	int m_iFrame = 0;
+
+	void Append(const void *data, size_t size)
+	{
+		m_Data.insert(m_Data.end(), (const uint8_t *)data, (const uint8_t *)data + size);
+	}
+
+	void PutInt(size_t pos, int value)
+	{
+		memcpy(m_Data.data() + pos, &value, 4);
+	}
+};
+
+class CDemoIndexTest
+{
+public:
+	int Run(int argc, char **argv);
+	[[noreturn]] void FatalError(const std::string &msg);
+
+private:
+	fs::path m_TempPath;
+
+	/**
+	 * A demo with every frame and record type.
+	 * @param	isFinished	Whether the directory is written
+	 */
+	static CDemoWriter CreateMatchDemo(bool isFinished);
+
+	/**
+	 * Long demo that looks like a recorded match.
+	 */
+	static CDemoWriter CreateBenchDemo(int seed);
+
+	static void WriteFile(const fs::path &path, const std::vector<uint8_t> &data);
+
+	/**
+	 * Reads a demo frame by frame with fread.
+	 * @returns number of frames or -1 on error
+	 */
+	static int ReadFrames(const fs::path &path, uint64_t &size);
+
+	void CheckMatchIndex(const CDemoIndex &index, bool isFinished);
+
+	void TestMatchDemo();
+	void TestTruncatedDemo();
+	void TestDamagedDemos();
+	void TestFiles();
+	void RunBenchmark(const std::vector<fs::path> &files);
+};
+
+int main(int argc, char **argv)
+{
+	CDemoIndexTest test;
+	return test.Run(argc, argv);
+}
+
+int CDemoIndexTest::Run(int argc, char **argv)
+{
+	m_TempPath = fs::temp_directory_path() / "bhl_test_demo_index";
+	fs::remove_all(m_TempPath);
+	fs::create_directories(m_TempPath);
+
+	TestMatchDemo();
+	TestTruncatedDemo();
+	TestDamagedDemos();
+	TestFiles();
+
+	std::vector<fs::path> benchFiles;
+
+	for (int i = 0; i < BENCH_FILES; i++)
+	{
+		fs::path path = m_TempPath / ("bench_" + std::to_string(i) + ".dem");
+		WriteFile(path, CreateBenchDemo(i).GetData());
+		benchFiles.push_back(path);
+	}
+
+	RunBenchmark(benchFiles);
+	fs::remove_all(m_TempPath);
+
+	if (argc > 1)
+		RunBenchmark(std::vector<fs::path>(argv + 1, argv + argc));
+
+	return 0;
+}
+
+void CDemoIndexTest::FatalError(const std::string &msg)
+{
+	fprintf(stderr, "Fatal Error: %s\n", msg.c_str());
+	exit(1);
+}
+
+CDemoWriter CDemoIndexTest::CreateMatchDemo(bool isFinished)
+{
+	CDemoWriter demo;
+
+	// Loading segment
+	demo.NetworkFrame(0, 3000);
+	demo.NetworkFrame(0, 200);
+	demo.Frame(CDemoIndex::FRAME_NEXT_SECTION, 0);
+
+	// Playback segment
+	demo.Frame(CDemoIndex::FRAME_START, 0);
+	demo.Frame(CDemoIndex::FRAME_CONSOLE_COMMAND, 0.1f, std::vector<uint8_t>(64, 'c'));
+	demo.RecordTimer(0.5f, 1900, 1);
+	demo.RecordCustomTimers(0.5f, 0, 0, 0, 0);
+	demo.RecordNextmap(0.5f, "stalkyard_with_a_very_long_name_that_does_not_fit_into_the_buffer");
+	demo.RecordStatus(0.6f);
+
+	for (int i = 0; i < 100; i++)
+	{
+		float time = 1 + i;
+
+		// Game time of a server that was running before
+		demo.RecordFloat(time, TYPE_TIME, 100 + time);
+		demo.NetworkFrame(time, 100 + i);
+		demo.Frame(CDemoIndex::FRAME_CLIENT_DATA, time, std::vector<uint8_t>(32));
+		demo.Frame(CDemoIndex::FRAME_EVENT, time + 0.5f, std::vector<uint8_t>(84));
+		demo.Frame(CDemoIndex::FRAME_WEAPON_ANIM, time + 0.5f, std::vector<uint8_t>(8));
+		demo.SoundFrame(time + 0.5f, "weapons/357_shot1.wav");
+	}
+
+	demo.RecordCustomTimers(30, 129, 189, 0, 0);
+	demo.RecordFloat(40, TYPE_ZOOM, 30);
+	demo.RecordSniperDot(41, true);
+	demo.RecordSniperDot(42, false);
+	demo.RecordStatus(50);
+	demo.RecordStatus(51, 1234); // Other mod
+	demo.RecordFloat(52, 100, 0); // Newer client
+	demo.Frame(CDemoIndex::FRAME_NEXT_SECTION, 101);
+
+	if (isFinished)
+		demo.Finish();
+
+	return demo;
+}
+
+CDemoWriter CDemoIndexTest::CreateBenchDemo(int seed)
+{
+	std::mt19937 rng(seed);
+	std::uniform_int_distribution<int> msgLen(20, 1400);
+	CDemoWriter demo(("map_" + std::to_string(seed)).c_str());
+
+	demo.NetworkFrame(0, 16000);
+	demo.Frame(CDemoIndex::FRAME_NEXT_SECTION, 0);
+	demo.RecordTimer(0.5f, BENCH_SECONDS, 2);
+
+	for (int i = 0; i < BENCH_SECONDS * BENCH_FPS; i++)
+	{
+		float time = (float)i / BENCH_FPS;
+
+		if (i % BENCH_FPS == 0)
+			demo.RecordFloat(time, TYPE_TIME, time);
+
+		demo.NetworkFrame(time, msgLen(rng));
+		demo.Frame(CDemoIndex::FRAME_CLIENT_DATA, time, std::vector<uint8_t>(32));
+
+		if (i % 7 == 0)
+			demo.Frame(CDemoIndex::FRAME_EVENT, time, std::vector<uint8_t>(84));
+
+		if (i % 11 == 0)
+			demo.SoundFrame(time, "player/pl_step1.wav");
+	}
+
+	demo.Frame(CDemoIndex::FRAME_NEXT_SECTION, BENCH_SECONDS);
+	demo.Finish();
+	return demo;
+}
+
+void CDemoIndexTest::WriteFile(const fs::path &path, const std::vector<uint8_t> &data)
+{
+	std::ofstream file(path, std::ios::out | std::ios::binary);
+	file.write((const char *)data.data(), data.size());
+}
+
+int CDemoIndexTest::ReadFrames(const fs::path &path, uint64_t &size)
+{
+	FILE *file = fopen(path.u8string().c_str(), "rb");
+
+	if (!file)
+		return -1;
+
+	uint8_t header[CDemoIndex::HEADER_SIZE];
+	int directoryOffset;
+	int frames = 0;
+
+	if (fread(header, sizeof(header), 1, file) != 1)
+	{
+		fclose(file);
+		return -1;
+	}
+
+	memcpy(&directoryOffset, header + 540, 4);
+
+	if (directoryOffset <= 0)
+		directoryOffset = INT_MAX; // Unfinished demo
+	std::vector<uint8_t> buf(64 * 1024);
+
+	auto fnRead = [&](size_t len) {
+		if (buf.size() < len)
+			buf.resize(len);
+
+		return fread(buf.data(), 1, len, file) == len;
+	};
+
+	auto fnReadInt = [&](int &value) {
+		return fnRead(4) && (memcpy(&value, buf.data(), 4), value >= 0);
+	};
+
+	bool ok = true;
+	int len;
+
+	while (ok && ftell(file) < directoryOffset)
+	{
+		ok = fnRead(9);
+		int type = buf[0];
+
+		if (!ok)
+			break;
+
+		switch (type)
+		{
+		case 0:
+		case 1:
+			ok = fnRead(464) && fnReadInt(len) && fnRead(len);
+			break;
+		case 2:
+		case 5:
+			break;
+		case 3:
+			ok = fnRead(64);
+			break;
+		case 4:
+			ok = fnRead(32);
+			break;
+		case 6:
+			ok = fnRead(84);
+			break;
+		case 7:
+			ok = fnRead(8);
+			break;
+		case 8:
+			ok = fnRead(4) && fnReadInt(len) && fnRead(len + 16);
+			break;
+		case 9:
+			ok = fnReadInt(len) && fnRead(len);
+			break;
+		default:
+			ok = false;
+		}
+
+		frames++;
+	}
+
+	fseek(file, 0, SEEK_END);
+	size = ftell(file);
+	fclose(file);
+	return ok ? frames : -1;
+}
+
+void CDemoIndexTest::CheckMatchIndex(const CDemoIndex &index, bool isFinished)
+{
+	if (index.map != "crossfire" || index.gameDir != "ag" || index.demoProtocol != 5 || index.netProtocol != 48 || index.mapCRC != 0x12345678)
+		FatalError("Wrong header");
+
+	if (index.isTruncated == isFinished)
+		FatalError("Wrong truncated state");
+
+	const int expectedCounts[CDemoIndex::FRAME_TYPE_COUNT] = { 0, 102, 1, 1, 100, 2, 100, 100, 100, 111 };
+
+	for (int i = 0; i < CDemoIndex::FRAME_TYPE_COUNT; i++)
+	{
+		if (index.frameTypeCounts[i] != expectedCounts[i])
+			FatalError("Wrong count of frame type " + std::to_string(i) + ": " + std::to_string(index.frameTypeCounts[i]));
+	}
+
+	if (index.frameCount != 617 || index.segmentCount != 2 || index.duration != 101)
+		FatalError("Wrong frames");
+
+	if (index.syncPoints.size() != 100 || index.syncPoints[10].demoTime != 11 || index.syncPoints[10].gameTime != 111)
+		FatalError("Wrong sync points");
+
+	if (index.timers.size() != 1 || index.timers[0].demoTime != 0.5f || index.timers[0].endTime != 1900 || index.timers[0].agVersion != 1)
+		FatalError("Wrong timer");
+
+	// The match ends at game time 1900, sync points say game time is demo time + 100
+	if (index.GameToDemoTime(1900) != 1800 || index.GameToDemoTime(150.5f) != 50.5f)
+		FatalError("Wrong GameToDemoTime");
+
+	if (index.customTimers.size() != 4 || index.customTimers[2].demoTime != 30 || index.customTimers[2].number != 0
+	    || index.customTimers[2].startTime != 129 || index.customTimers[2].endTime != 189 || index.customTimers[3].number != 1)
+		FatalError("Wrong custom timers");
+
+	if (index.nextmaps.size() != 1 || index.nextmaps[0].map != std::string("stalkyard_with_a_very_long_name_that_does_not_fit_into_the_buffer", 63))
+		FatalError("Wrong nextmap");
+
+	if (index.statusRequests.size() != 2 || index.statusRequests[0] != 0.6f || index.statusRequests[1] != 50)
+		FatalError("Wrong status requests");
+
+	if (index.zoomCount != 1 || index.sniperDotCount != 1 || index.unknownRecordCount != 2)
+		FatalError("Wrong other records");
+}
+
+void CDemoIndexTest::TestMatchDemo()
+{
+	fprintf(stderr, "Checking a finished demo\n");
+
+	CDemoIndex index;
+	const std::vector<uint8_t> data = CreateMatchDemo(true).GetData();
+
+	if (!index.Build(data.data(), data.size()))
+		FatalError("Build failed: " + index.error);
+
+	CheckMatchIndex(index, true);
+
+	if (index.fileSize != data.size())
+		FatalError("Wrong size");
+
+	fprintf(stderr, "Good\n\n");
+}
+
+void CDemoIndexTest::TestTruncatedDemo()
+{
+	fprintf(stderr, "Checking unfinished demos\n");
+
+	std::vector<uint8_t> data = CreateMatchDemo(false).GetData();
+	CDemoIndex index;
+
+	if (!index.Build(data.data(), data.size()))
+		FatalError("Build failed: " + index.error);
+
+	CheckMatchIndex(index, false);
+
+	// Every cut must give the frames before it
+	int lastFrameCount = 0;
+
+	for (size_t size = CDemoIndex::HEADER_SIZE; size < data.size(); size += 7)
+	{
+		if (!index.Build(data.data(), size))
+			FatalError("Build of a cut demo failed: " + index.error);
+
+		if (index.frameCount < lastFrameCount || !index.isTruncated)
+			FatalError("Wrong frames of a cut demo");
+
+		lastFrameCount = index.frameCount;
+	}
+
+	fprintf(stderr, "Good\n\n");
+}
+
+void CDemoIndexTest::TestDamagedDemos()
+{
+	fprintf(stderr, "Checking damaged demos\n");
+
+	const std::vector<uint8_t> good = CreateMatchDemo(true).GetData();
+	CDemoIndex index;
+
+	auto fnCheckFails = [&](const std::vector<uint8_t> &data, const char *name) {
+		if (index.Build(data.data(), data.size()))
+			FatalError(std::string("Build of a damaged demo succeeded: ") + name);
+
+		fprintf(stderr, "%s: %s\n", name, index.error.c_str());
+	};
+
+	std::vector<uint8_t> data = good;
+	data[0] = 'X';
+	fnCheckFails(data, "magic");
+
+	fnCheckFails(std::vector<uint8_t>(good.begin(), good.begin() + 100), "short header");
+
+	// Type of the first frame
+	data = good;
+	data[CDemoIndex::HEADER_SIZE] = 10;
+	fnCheckFails(data, "frame type");
+
+	// Message length of the first frame
+	data = good;
+	int len = 0x7FFFFFF0;
+	memcpy(data.data() + CDemoIndex::HEADER_SIZE + 9 + 464, &len, 4);
+	fnCheckFails(data, "message length");
+
+	len = -1;
+	memcpy(data.data() + CDemoIndex::HEADER_SIZE + 9 + 464, &len, 4);
+	fnCheckFails(data, "negative length");
+
+	// Directory in the middle of a frame
+	data = good;
+	int directoryOffset = CDemoIndex::HEADER_SIZE + 100;
+	memcpy(data.data() + 540, &directoryOffset, 4);
+	fnCheckFails(data, "directory offset");
+
+	fprintf(stderr, "Good\n\n");
+}
+
+void CDemoIndexTest::TestFiles()
+{
+	fprintf(stderr, "Checking indexing of files\n");
+
+	std::vector<CDemoIndexer::File> files(20);
+
+	for (size_t i = 0; i < files.size(); i++)
+	{
+		fs::path path = m_TempPath / ("match_" + std::to_string(i) + ".dem");
+
+		if (i == 5)
+			WriteFile(path, {}); // Empty files can't be mapped
+		else if (i != 7)
+			WriteFile(path, CreateMatchDemo(i % 2 == 0).GetData());
+
+		files[i].path = path.u8string();
+	}
+
+	for (int threads : { 1, 4, 0 })
+	{
+		std::vector<CDemoIndexer::File> results = files;
+		std::atomic<int> callbackCount(0);
+		CDemoIndexer::IndexFiles(results, threads, [&](size_t) { callbackCount++; });
+
+		if (callbackCount != (int)files.size())
+			FatalError("Wrong callback count");
+
+		for (size_t i = 0; i < results.size(); i++)
+		{
+			bool shouldFail = i == 5 || i == 7;
+
+			if (results[i].isIndexed == shouldFail)
+				FatalError("Wrong result of file " + std::to_string(i) + ": " + results[i].index.error);
+
+			if (!shouldFail)
+				CheckMatchIndex(results[i].index, i % 2 == 0);
+		}
+	}
+
+	fprintf(stderr, "Good\n\n");
+}
+
+void CDemoIndexTest::RunBenchmark(const std::vector<fs::path> &files)
+{
+	fprintf(stderr, "Benchmark (%d demos)\n", (int)files.size());
+
+	// Reading frames with fread
+	uint64_t totalSize = 0;
+	int totalFrames = 0;
+	auto start = Clock::now();
+
+	for (const fs::path &path : files)
+	{
+		uint64_t size = 0;
+		int frames = ReadFrames(path, size);
+
+		if (frames < 0)
+			FatalError("ReadFrames failed on " + path.u8string());
+
+		totalSize += size;
+		totalFrames += frames;
+	}
+
+	double freadTime = std::chrono::duration<double>(Clock::now() - start).count();
+	double sizeMB = totalSize / (1024.0 * 1024.0);
+	fprintf(stderr, "%.1f MB, %d frames\n", sizeMB, totalFrames);
+	fprintf(stderr, "fread per frame:         %8.1f ms (%6.0f MB/s)\n", freadTime * 1000, sizeMB / freadTime);
+
+	for (int threads : { 1, 0 })
+	{
+		std::vector<CDemoIndexer::File> indexFiles(files.size());
+
+		for (size_t i = 0; i < files.size(); i++)
+			indexFiles[i].path = files[i].u8string();
+
+		start = Clock::now();
+		CDemoIndexer::IndexFiles(indexFiles, threads, nullptr);
+		double time = std::chrono::duration<double>(Clock::now() - start).count();
+
+		int frames = 0;
+
+		for (const CDemoIndexer::File &file : indexFiles)
+		{
+			if (!file.isIndexed)
+				FatalError("Indexing failed on " + file.path + ": " + file.index.error);
+
+			frames += file.index.frameCount;
+		}
+
+		if (frames != totalFrames)
+			FatalError("Frame counts differ: " + std::to_string(frames) + " != " + std::to_string(totalFrames));
+
+		if (threads == 1)
+		{
+			fprintf(stderr, "CDemoIndexer, 1 thread:  %8.1f ms (%6.0f MB/s)\n", time * 1000, sizeMB / time);
+			fprintf(stderr, "Speedup: %.1fx\n", freadTime / time);
+		}
+		else
+		{
+			fprintf(stderr, "CDemoIndexer, %u cores:  %8.1f ms (%6.0f MB/s)\n", std::thread::hardware_concurrency(), time * 1000, sizeMB / time);
+			fprintf(stderr, "Speedup: %.1fx\n", freadTime / time);
+		}
+	}
+
+	fprintf(stderr, "\n");
+}
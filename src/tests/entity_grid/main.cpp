@@ -0,0 +1,323 @@
+//
+// Entity grid test and benchmark.
+//
+// Moves a map worth of entity boxes around, checks that CEntityGrid queries
+// find the same entities as a scan of all boxes and compares the cost
+// of both.
+//
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+#include <entity_grid.h>
+
+class CEntityGridTest
+{
+public:
+	int Run();
+	[[noreturn]] void FatalError(const std::string &msg);
+
+private:
+	struct Box
+	{
+		bool used;
+		float mins[3];
+		float maxs[3];
+	};
+
+	static constexpr int ENTITY_COUNT = 1500;
+	static constexpr float MAP_SIZE = 3500.0f;
+
+	std::mt19937 m_Rng { 1234 };
+	std::vector<Box> m_Boxes;
+	CEntityGrid m_Grid;
+
+	float RandomFloat(float min, float max);
+	void SpawnBox(int id);
+	void MoveBox(int id, float dist);
+	void LinearQuery(const float *mins, const float *maxs, std::vector<int> &ids);
+	void RandomQueryBox(float *mins, float *maxs);
+
+	void TestQueries();
+	void TestEdgeCases();
+	void RunBenchmark();
+};
+
+int main()
+{
+	CEntityGridTest test;
+	return test.Run();
+}
+
+int CEntityGridTest::Run()
+{
+	m_Boxes.resize(ENTITY_COUNT);
+
+	for (int i = 1; i < ENTITY_COUNT; i++)
+		SpawnBox(i);
+
+	TestQueries();
+	TestEdgeCases();
+	RunBenchmark();
+	return 0;
+}
+
+void CEntityGridTest::FatalError(const std::string &msg)
+{
+	fprintf(stderr, "Fatal Error: %s\n", msg.c_str());
+	exit(1);
+}
+
+float CEntityGridTest::RandomFloat(float min, float max)
+{
+	return std::uniform_real_distribution<float>(min, max)(m_Rng);
+}
+
+void CEntityGridTest::SpawnBox(int id)
+{
+	Box &box = m_Boxes[id];
+	float size[3];
+	int type = m_Rng() % 100;
+
+	if (type < 5)
+	{
+		// Triggers and big brushes
+		size[0] = RandomFloat(64, 2048);
+		size[1] = RandomFloat(64, 2048);
+		size[2] = RandomFloat(64, 512);
+	}
+	else if (type < 40)
+	{
+		// Monsters and players
+		size[0] = size[1] = 32;
+		size[2] = 72;
+	}
+	else
+	{
+		// Items, info_ entities, doors
+		size[0] = RandomFloat(2, 128);
+		size[1] = RandomFloat(2, 128);
+		size[2] = RandomFloat(2, 128);
+	}
+
+	for (int i = 0; i < 3; i++)
+	{
+		box.mins[i] = RandomFloat(-MAP_SIZE, MAP_SIZE);
+		box.maxs[i] = box.mins[i] + size[i];
+	}
+
+	box.used = true;
+	m_Grid.Update(id, box.mins, box.maxs);
+}
+
+void CEntityGridTest::MoveBox(int id, float dist)
+{
+	Box &box = m_Boxes[id];
+
+	for (int i = 0; i < 3; i++)
+	{
+		float delta = RandomFloat(-dist, dist);
+		box.mins[i] += delta;
+		box.maxs[i] += delta;
+	}
+
+	m_Grid.Update(id, box.mins, box.maxs);
+}
+
+void CEntityGridTest::LinearQuery(const float *mins, const float *maxs, std::vector<int> &ids)
+{
+	ids.clear();
+
+	for (int i = 1; i < ENTITY_COUNT; i++)
+	{
+		const Box &box = m_Boxes[i];
+
+		if (!box.used)
+			continue;
+
+		if (mins[0] > box.maxs[0] || mins[1] > box.maxs[1] || mins[2] > box.maxs[2] || maxs[0] < box.mins[0] || maxs[1] < box.mins[1] || maxs[2] < box.mins[2])
+			continue;
+
+		ids.push_back(i);
+	}
+}
+
+void CEntityGridTest::RandomQueryBox(float *mins, float *maxs)
+{
+	// Mostly explosions, sometimes a bigger search
+	float radius = m_Rng() % 10 ? RandomFloat(16, 400) : RandomFloat(400, 1500);
+
+	for (int i = 0; i < 3; i++)
+	{
+		float center = RandomFloat(-MAP_SIZE, MAP_SIZE);
+		mins[i] = center - radius;
+		maxs[i] = center + radius;
+	}
+}
+
+void CEntityGridTest::TestQueries()
+{
+	fprintf(stderr, "Checking that queries match a scan of all entities\n");
+
+	std::vector<int> expected, ids;
+	size_t found = 0;
+
+	for (int frame = 0; frame < 300; frame++)
+	{
+		// Some entities move every frame, some teleport, some are removed and respawned
+		for (int i = 1; i < ENTITY_COUNT; i++)
+		{
+			if (!m_Boxes[i].used)
+			{
+				if (m_Rng() % 20 == 0)
+					SpawnBox(i);
+
+				continue;
+			}
+
+			int action = m_Rng() % 1000;
+
+			if (action < 300)
+				MoveBox(i, 20);
+			else if (action < 305)
+				MoveBox(i, 2000);
+			else if (action < 310)
+			{
+				m_Boxes[i].used = false;
+				m_Grid.Remove(i);
+			}
+		}
+
+		for (int i = 0; i < 20; i++)
+		{
+			float mins[3], maxs[3];
+			RandomQueryBox(mins, maxs);
+
+			LinearQuery(mins, maxs, expected);
+			m_Grid.Query(mins, maxs, ids);
+
+			if (ids != expected)
+				FatalError("Query result mismatch in frame " + std::to_string(frame) + ": expected " + std::to_string(expected.size()) + " entities, got " + std::to_string(ids.size()));
+
+			found += ids.size();
+		}
+	}
+
+	int count = 0;
+
+	for (int i = 1; i < ENTITY_COUNT; i++)
+	{
+		if (m_Boxes[i].used != m_Grid.Contains(i))
+			FatalError("Wrong entity list in the grid");
+
+		count += m_Boxes[i].used;
+	}
+
+	if (m_Grid.GetCount() != count)
+		FatalError("Wrong entity count");
+
+	fprintf(stderr, "%zu entities found in 6000 queries\n", found);
+	fprintf(stderr, "Good\n\n");
+}
+
+void CEntityGridTest::TestEdgeCases()
+{
+	fprintf(stderr, "Checking boxes outside of the grid\n");
+
+	CEntityGrid grid;
+	std::vector<int> ids;
+
+	float farMins[3] = { 20000, -20000, 0 };
+	float farMaxs[3] = { 20016, -19984, 16 };
+	grid.Update(5, farMins, farMaxs);
+
+	float worldMins[3] = { -16384, -16384, -16384 };
+	float worldMaxs[3] = { 16384, 16384, 16384 };
+	grid.Update(7, worldMins, worldMaxs);
+
+	// Touching boxes intersect
+	float pointMins[3] = { 20016, -19984, 16 };
+	grid.Query(pointMins, pointMins, ids);
+
+	if (ids != std::vector<int> { 5 })
+		FatalError("Box outside of the grid wasn't found");
+
+	float nearMins[3] = { 9000, -9000, 0 };
+	float nearMaxs[3] = { 9100, -8900, 16 };
+	grid.Query(nearMins, nearMaxs, ids);
+
+	if (ids != std::vector<int> { 7 })
+		FatalError("Box outside of the grid was found in the wrong place");
+
+	grid.Remove(5);
+	grid.Remove(5);
+	grid.Query(pointMins, pointMins, ids);
+
+	if (!ids.empty() || grid.GetCount() != 1)
+		FatalError("Removed box was found");
+
+	grid.Clear();
+	grid.Query(worldMins, worldMaxs, ids);
+
+	if (!ids.empty() || grid.GetCount() != 0)
+		FatalError("Grid wasn't cleared");
+
+	fprintf(stderr, "Good\n\n");
+}
+
+void CEntityGridTest::RunBenchmark()
+{
+	constexpr int QUERY_COUNT = 200000;
+
+	fprintf(stderr, "Benchmark: %d entities, %d queries\n", m_Grid.GetCount(), QUERY_COUNT);
+
+	std::vector<float> queries(QUERY_COUNT * 6);
+
+	for (int i = 0; i < QUERY_COUNT; i++)
+		RandomQueryBox(&queries[i * 6], &queries[i * 6 + 3]);
+
+	std::vector<int> ids;
+	size_t linearFound = 0;
+	size_t gridFound = 0;
+
+	auto startTime = std::chrono::steady_clock::now();
+
+	for (int i = 0; i < QUERY_COUNT; i++)
+	{
+		LinearQuery(&queries[i * 6], &queries[i * 6 + 3], ids);
+		linearFound += ids.size();
+	}
+
+	auto linearTime = std::chrono::steady_clock::now();
+
+	for (int i = 0; i < QUERY_COUNT; i++)
+	{
+		m_Grid.Query(&queries[i * 6], &queries[i * 6 + 3], ids);
+		gridFound += ids.size();
+	}
+
+	auto gridTime = std::chrono::steady_clock::now();
+
+	// A frame where every entity moves
+	for (int i = 1; i < ENTITY_COUNT; i++)
+	{
+		if (m_Boxes[i].used)
+			MoveBox(i, 20);
+	}
+
+	auto updateTime = std::chrono::steady_clock::now();
+
+	if (linearFound != gridFound)
+		FatalError("Benchmark results don't match");
+
+	double linearNs = std::chrono::duration<double, std::nano>(linearTime - startTime).count() / QUERY_COUNT;
+	double gridNs = std::chrono::duration<double, std::nano>(gridTime - linearTime).count() / QUERY_COUNT;
+	double updateNs = std::chrono::duration<double, std::nano>(updateTime - gridTime).count() / m_Grid.GetCount();
+
+	fprintf(stderr, "Linear scan: %8.1f ns per query\n", linearNs);
+	fprintf(stderr, "Grid:        %8.1f ns per query (%.1fx)\n", gridNs, linearNs / gridNs);
+	fprintf(stderr, "Grid update: %8.1f ns per entity\n", updateNs);
+}
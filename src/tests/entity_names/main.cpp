@@ -0,0 +1,513 @@
+//
+// Entity name index test and benchmark.
+//
+// Spawns, renames and removes a map worth of entities, checks that
+// CEntityNameIndex finds the same entities in the same order as a scan of
+// all edicts like FIND_ENTITY_BY_STRING does and compares the cost of both.
+//
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <random>
+#include <string>
+#include <vector>
+#include <entity_name_index.h>
+
+namespace
+{
+
+// Names of a typical deathmatch map and entities created during the game
+const char *s_Classnames[] = {
+	"worldspawn",
+	"info_player_deathmatch",
+	"info_player_start",
+	"func_wall",
+	"func_door",
+	"func_door_rotating",
+	"func_button",
+	"func_breakable",
+	"func_illusionary",
+	"func_train",
+	"path_corner",
+	"trigger_multiple",
+	"trigger_once",
+	"trigger_hurt",
+	"trigger_push",
+	"trigger_teleport",
+	"info_teleport_destination",
+	"multisource",
+	"multi_manager",
+	"env_sprite",
+	"env_glow",
+	"env_beam",
+	"ambient_generic",
+	"light",
+	"light_spot",
+	"weapon_crossbow",
+	"weapon_rpg",
+	"weapon_gauss",
+	"weapon_egon",
+	"weapon_shotgun",
+	"weapon_9mmAR",
+	"ammo_crossbow",
+	"ammo_rpgclip",
+	"ammo_gaussclip",
+	"ammo_buckshot",
+	"item_healthkit",
+	"item_battery",
+	"item_longjump",
+	"player",
+	"bodyque",
+	"grenade",
+	"bolt",
+	"rpg_rocket",
+	"laser_spot",
+	"beam",
+	"gib",
+	"weaponbox",
+};
+
+const char *s_Targetnames[] = {
+	"door1",
+	"door2",
+	"lift",
+	"lift_btn",
+	"tele_dest",
+	"glass",
+	"mm_start",
+	"ms_power",
+	"spr_light",
+	"train",
+	"t1",
+	"t2",
+	"t3",
+	"t4",
+	"t5",
+	"t6",
+	"t7",
+	"t8",
+};
+
+constexpr int BENCH_ITERATIONS = 2000;
+
+}
+
+class CEntityNamesTest
+{
+public:
+	int Run();
+	[[noreturn]] void FatalError(const std::string &msg);
+
+private:
+	struct Edict
+	{
+		bool free = true;
+		const char *names[CEntityNameIndex::FIELD_COUNT] = {};
+	};
+
+	static constexpr int MAX_ENTITIES = 1400;
+
+	std::mt19937 m_Rng { 1234 };
+	std::vector<Edict> m_Edicts;
+	CEntityNameIndex m_Index;
+
+	// Copies of names at other addresses, like a string allocated twice
+	std::vector<std::string> m_Copies;
+
+	const char *RandomName(CEntityNameIndex::Field field);
+	void Spawn(int id);
+	void Free(int id);
+	void Rename(int id, CEntityNameIndex::Field field);
+	void SpawnMap();
+	void MutateMap(int count);
+
+	int ScanNext(CEntityNameIndex::Field field, const char *pszName, int startId);
+	int ScanPrev(CEntityNameIndex::Field field, const char *pszName, int startId);
+	int IndexNext(CEntityNameIndex::Field field, const char *pszName, int startId);
+	bool HasName(int id, CEntityNameIndex::Field field, const char *pszName);
+
+	void CompareAll(const char *stage);
+	void TestLookups();
+	void TestDirectChanges();
+	void RunBenchmark();
+};
+
+int main()
+{
+	CEntityNamesTest test;
+	return test.Run();
+}
+
+int CEntityNamesTest::Run()
+{
+	for (const char *name : s_Classnames)
+		m_Copies.push_back(name);
+
+	for (const char *name : s_Targetnames)
+		m_Copies.push_back(name);
+
+	TestLookups();
+	TestDirectChanges();
+	RunBenchmark();
+	return 0;
+}
+
+void CEntityNamesTest::FatalError(const std::string &msg)
+{
+	fprintf(stderr, "Fatal Error: %s\n", msg.c_str());
+	exit(1);
+}
+
+const char *CEntityNamesTest::RandomName(CEntityNameIndex::Field field)
+{
+	if (field == CEntityNameIndex::TARGETNAME)
+	{
+		// Most entities have no targetname
+		if (m_Rng() % 4 != 0)
+			return nullptr;
+
+		size_t i = m_Rng() % std::size(s_Targetnames);
+		return (m_Rng() % 8 == 0) ? m_Copies[std::size(s_Classnames) + i].c_str() : s_Targetnames[i];
+	}
+
+	// Skip worldspawn, lower classes are more common
+	size_t i = 1 + (m_Rng() % (std::size(s_Classnames) - 1)) * (m_Rng() % 100) / 100;
+	return (m_Rng() % 8 == 0) ? m_Copies[i].c_str() : s_Classnames[i];
+}
+
+void CEntityNamesTest::Spawn(int id)
+{
+	Edict &ed = m_Edicts[id];
+	ed.free = false;
+
+	for (int f = 0; f < CEntityNameIndex::FIELD_COUNT; f++)
+	{
+		ed.names[f] = RandomName((CEntityNameIndex::Field)f);
+		m_Index.Update(id, (CEntityNameIndex::Field)f, ed.names[f]);
+	}
+}
+
+void CEntityNamesTest::Free(int id)
+{
+	m_Edicts[id] = Edict();
+	m_Index.Remove(id);
+}
+
+void CEntityNamesTest::Rename(int id, CEntityNameIndex::Field field)
+{
+	m_Edicts[id].names[field] = RandomName(field);
+	m_Index.Update(id, field, m_Edicts[id].names[field]);
+}
+
+void CEntityNamesTest::SpawnMap()
+{
+	m_Index.Clear();
+	m_Edicts.assign(MAX_ENTITIES, Edict());
+
+	m_Edicts[0].free = false;
+	m_Edicts[0].names[CEntityNameIndex::CLASSNAME] = s_Classnames[0];
+	m_Index.Update(0, CEntityNameIndex::CLASSNAME, s_Classnames[0]);
+
+	for (int i = 1; i < MAX_ENTITIES * 3 / 4; i++)
+		Spawn(i);
+}
+
+void CEntityNamesTest::MutateMap(int count)
+{
+	for (int i = 0; i < count; i++)
+	{
+		int id = 1 + m_Rng() % (MAX_ENTITIES - 1);
+
+		switch (m_Rng() % 4)
+		{
+		case 0:
+			if (m_Edicts[id].free)
+				Spawn(id);
+			else
+				Free(id);
+			break;
+		case 1:
+			if (!m_Edicts[id].free)
+				Rename(id, CEntityNameIndex::CLASSNAME);
+			break;
+		case 2:
+			if (!m_Edicts[id].free)
+				Rename(id, CEntityNameIndex::TARGETNAME);
+			break;
+		case 3:
+			// Same name, pointer to another copy
+			if (!m_Edicts[id].free && m_Edicts[id].names[CEntityNameIndex::CLASSNAME])
+			{
+				for (std::string &copy : m_Copies)
+				{
+					if (copy == m_Edicts[id].names[CEntityNameIndex::CLASSNAME])
+					{
+						m_Edicts[id].names[CEntityNameIndex::CLASSNAME] = copy.c_str();
+						m_Index.Update(id, CEntityNameIndex::CLASSNAME, copy.c_str());
+						break;
+					}
+				}
+			}
+			break;
+		}
+	}
+}
+
+bool CEntityNamesTest::HasName(int id, CEntityNameIndex::Field field, const char *pszName)
+{
+	const Edict &ed = m_Edicts[id];
+	return !ed.free && ed.names[field] && !strcmp(ed.names[field], pszName);
+}
+
+int CEntityNamesTest::ScanNext(CEntityNameIndex::Field field, const char *pszName, int startId)
+{
+	// Same as PF_find_Shared in the engine
+	for (int id = startId + 1; id < (int)m_Edicts.size(); id++)
+	{
+		if (HasName(id, field, pszName))
+			return id;
+	}
+
+	return -1;
+}
+
+int CEntityNamesTest::ScanPrev(CEntityNameIndex::Field field, const char *pszName, int startId)
+{
+	for (int id = startId - 1; id >= 0; id--)
+	{
+		if (HasName(id, field, pszName))
+			return id;
+	}
+
+	return -1;
+}
+
+int CEntityNamesTest::IndexNext(CEntityNameIndex::Field field, const char *pszName, int startId)
+{
+	// Same as FindEdictByName in util.cpp
+	int id = startId;
+
+	while ((id = m_Index.FindNext(field, pszName, id)) != -1)
+	{
+		if (HasName(id, field, pszName))
+			return id;
+	}
+
+	return -1;
+}
+
+void CEntityNamesTest::CompareAll(const char *stage)
+{
+	for (int f = 0; f < CEntityNameIndex::FIELD_COUNT; f++)
+	{
+		auto field = (CEntityNameIndex::Field)f;
+		const char **names = field == CEntityNameIndex::CLASSNAME ? s_Classnames : s_Targetnames;
+		size_t nameCount = field == CEntityNameIndex::CLASSNAME ? std::size(s_Classnames) : std::size(s_Targetnames);
+
+		for (size_t n = 0; n < nameCount; n++)
+		{
+			const char *name = names[n];
+
+			// Iteration never returns the world, GetCount does
+			int count = HasName(0, field, name) ? 1 : 0;
+
+			// Iteration like while ((pEnt = UTIL_FindEntityByClassname(pEnt, name)))
+			int scan = 0;
+			int index = 0;
+
+			do
+			{
+				scan = ScanNext(field, name, scan);
+				index = IndexNext(field, name, index);
+
+				if (scan != index)
+				{
+					FatalError(std::string(stage) + ": " + name + ": scan found " + std::to_string(scan)
+					    + ", index found " + std::to_string(index));
+				}
+
+				if (scan != -1)
+					count++;
+			} while (scan != -1);
+
+			if (count != m_Index.GetCount(field, name))
+				FatalError(std::string(stage) + ": wrong count of " + name);
+
+			// Searches from random entities in both directions
+			for (int i = 0; i < 20; i++)
+			{
+				int start = m_Rng() % (MAX_ENTITIES + 1);
+
+				if (ScanNext(field, name, start) != m_Index.FindNext(field, name, start))
+					FatalError(std::string(stage) + ": FindNext differs for " + name + " from " + std::to_string(start));
+
+				if (ScanPrev(field, name, start) != m_Index.FindPrev(field, name, start))
+					FatalError(std::string(stage) + ": FindPrev differs for " + name + " from " + std::to_string(start));
+			}
+		}
+	}
+
+	if (m_Index.FindNext(CEntityNameIndex::CLASSNAME, "no_such_class", 0) != -1)
+		FatalError(std::string(stage) + ": found an unknown classname");
+}
+
+void CEntityNamesTest::TestLookups()
+{
+	fprintf(stderr, "Checking lookups\n");
+
+	SpawnMap();
+	CompareAll("Spawned map");
+
+	for (int i = 0; i < 50; i++)
+	{
+		MutateMap(200);
+		CompareAll("Mutated map");
+	}
+
+	// Worldspawn is never found after the start, like in the engine
+	if (IndexNext(CEntityNameIndex::CLASSNAME, "worldspawn", 0) != -1)
+		FatalError("Worldspawn was found");
+
+	if (m_Index.FindPrev(CEntityNameIndex::CLASSNAME, "worldspawn", 1) != 0)
+		FatalError("Worldspawn wasn't found in reverse");
+
+	m_Index.Clear();
+
+	if (m_Index.GetCount(CEntityNameIndex::CLASSNAME, "func_wall") != 0)
+		FatalError("Index isn't empty after Clear");
+
+	fprintf(stderr, "Good\n\n");
+}
+
+void CEntityNamesTest::TestDirectChanges()
+{
+	fprintf(stderr, "Checking names changed without Update\n");
+
+	SpawnMap();
+
+	// pev->classname = MAKE_STRING(...) without any engine call, fixed by the per-frame sync
+	int changed = 0;
+
+	for (int id = 1; id < MAX_ENTITIES; id++)
+	{
+		Edict &ed = m_Edicts[id];
+
+		if (!ed.free && ed.names[CEntityNameIndex::CLASSNAME] && !strcmp(ed.names[CEntityNameIndex::CLASSNAME], "func_wall") && (id & 1))
+		{
+			ed.names[CEntityNameIndex::CLASSNAME] = "func_wall_toggle";
+			changed++;
+		}
+	}
+
+	// Stale entries are skipped, nothing wrong is found
+	for (int id = IndexNext(CEntityNameIndex::CLASSNAME, "func_wall", 0); id != -1; id = IndexNext(CEntityNameIndex::CLASSNAME, "func_wall", id))
+	{
+		if (id & 1)
+			FatalError("Renamed entity was found by the old name");
+	}
+
+	// Sync
+	for (int id = 0; id < MAX_ENTITIES; id++)
+	{
+		if (m_Edicts[id].free)
+		{
+			m_Index.Remove(id);
+			continue;
+		}
+
+		for (int f = 0; f < CEntityNameIndex::FIELD_COUNT; f++)
+			m_Index.Update(id, (CEntityNameIndex::Field)f, m_Edicts[id].names[f]);
+	}
+
+	if (m_Index.GetCount(CEntityNameIndex::CLASSNAME, "func_wall_toggle") != changed)
+		FatalError("Sync missed renamed entities");
+
+	CompareAll("Synced map");
+
+	// Classname set after Spawn like CLaserSpot::CreateSpot, then updated
+	int spot = -1;
+
+	for (int id = 1; id < MAX_ENTITIES && spot == -1; id++)
+	{
+		if (m_Edicts[id].free)
+			spot = id;
+	}
+
+	m_Edicts[spot].free = false;
+	m_Index.Update(spot, CEntityNameIndex::CLASSNAME, nullptr);
+	m_Index.Update(spot, CEntityNameIndex::TARGETNAME, nullptr);
+	m_Edicts[spot].names[CEntityNameIndex::CLASSNAME] = "laser_spot";
+	m_Index.Update(spot, CEntityNameIndex::CLASSNAME, "laser_spot");
+
+	if (IndexNext(CEntityNameIndex::CLASSNAME, "laser_spot", 0) != ScanNext(CEntityNameIndex::CLASSNAME, "laser_spot", 0))
+		FatalError("Entity named after Spawn wasn't found");
+
+	CompareAll("Named after spawn");
+
+	fprintf(stderr, "%d entities renamed\n", changed);
+	fprintf(stderr, "Good\n\n");
+}
+
+void CEntityNamesTest::RunBenchmark()
+{
+	fprintf(stderr, "Benchmark (%d iterations)\n", BENCH_ITERATIONS);
+
+	SpawnMap();
+
+	// Spawn point selection, FireTargets, multisource and item respawn lookups
+	struct
+	{
+		CEntityNameIndex::Field field;
+		const char *name;
+	} queries[] = {
+		{ CEntityNameIndex::CLASSNAME, "info_player_deathmatch" },
+		{ CEntityNameIndex::CLASSNAME, "player" },
+		{ CEntityNameIndex::CLASSNAME, "multisource" },
+		{ CEntityNameIndex::CLASSNAME, "weaponbox" },
+		{ CEntityNameIndex::TARGETNAME, "door1" },
+		{ CEntityNameIndex::TARGETNAME, "t5" },
+		{ CEntityNameIndex::TARGETNAME, "ms_power" },
+		{ CEntityNameIndex::TARGETNAME, "nonexistent" },
+	};
+
+	using Clock = std::chrono::high_resolution_clock;
+	volatile int sink = 0;
+	int found = 0;
+
+	auto start = Clock::now();
+
+	for (int it = 0; it < BENCH_ITERATIONS; it++)
+	{
+		for (auto &q : queries)
+		{
+			for (int id = ScanNext(q.field, q.name, 0); id != -1; id = ScanNext(q.field, q.name, id))
+				sink += id;
+		}
+	}
+
+	auto mid = Clock::now();
+
+	for (int it = 0; it < BENCH_ITERATIONS; it++)
+	{
+		for (auto &q : queries)
+		{
+			for (int id = IndexNext(q.field, q.name, 0); id != -1; id = IndexNext(q.field, q.name, id))
+			{
+				sink += id;
+				found++;
+			}
+		}
+	}
+
+	auto end = Clock::now();
+
+	double scan = std::chrono::duration<double, std::micro>(mid - start).count() / BENCH_ITERATIONS;
+	double index = std::chrono::duration<double, std::micro>(end - mid).count() / BENCH_ITERATIONS;
+
+	fprintf(stderr, "%d queries, %d entities found per iteration\n", (int)std::size(queries), found / BENCH_ITERATIONS);
+	fprintf(stderr, "Edict scan: %8.2f us per iteration\n", scan);
+	fprintf(stderr, "Name index: %8.2f us per iteration\n", index);
+	fprintf(stderr, "Speedup: %.1fx\n", scan / index);
+}
@@ -0,0 +1,394 @@
+//
+// Entity snapshot test and benchmark.
+//
+// Drives AddToFullPack state building with synthetic edicts of a full server:
+// every frame entities move, change weapons and spectator modes, and states
+// are built for every client and entity pair. Checks that CEntitySnapshot
+// gives the same states as the old per-client code and compares the cost.
+//
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+#include "extdll.h"
+#include "pm_shared.h"
+#include <entity_snapshot.h>
+
+class CEntitySnapshotTest
+{
+public:
+	int Run();
+	[[noreturn]] void FatalError(const std::string &msg);
+
+private:
+	static constexpr int MAX_CLIENTS = 32;
+	static constexpr int MAX_EDICTS = 900;
+	static constexpr int MODEL_COUNT = 300;
+
+	std::mt19937 m_Rng { 1234 };
+	std::vector<edict_t> m_Edicts;
+	std::string m_Strings;
+	std::vector<string_t> m_WeaponModels;
+
+	static std::vector<std::string> m_Precache;
+	static int m_iModelIndexCalls;
+
+	// Same as the engine, linear search in the precache list
+	static int ModelIndex(const char *name);
+
+	float RandomFloat(float min, float max);
+	void CreateEdicts();
+	void RunFrame();
+
+	// Old AddToFullPack after visibility checks
+	void OldGetState(entity_state_t *state, int e, edict_t *ent, edict_t *host, int player);
+
+	void TestStates();
+	void RunBenchmark();
+};
+
+std::vector<std::string> CEntitySnapshotTest::m_Precache;
+int CEntitySnapshotTest::m_iModelIndexCalls = 0;
+
+int main()
+{
+	CEntitySnapshotTest test;
+	return test.Run();
+}
+
+int CEntitySnapshotTest::Run()
+{
+	CreateEdicts();
+
+	TestStates();
+	RunBenchmark();
+	return 0;
+}
+
+void CEntitySnapshotTest::FatalError(const std::string &msg)
+{
+	fprintf(stderr, "Fatal Error: %s\n", msg.c_str());
+	exit(1);
+}
+
+int CEntitySnapshotTest::ModelIndex(const char *name)
+{
+	m_iModelIndexCalls++;
+
+	if (!name[0])
+		return 0;
+
+	for (size_t i = 1; i < m_Precache.size(); i++)
+	{
+		if (!strcmp(m_Precache[i].c_str(), name))
+			return (int)i;
+	}
+
+	return 0;
+}
+
+float CEntitySnapshotTest::RandomFloat(float min, float max)
+{
+	return std::uniform_real_distribution<float>(min, max)(m_Rng);
+}
+
+void CEntitySnapshotTest::CreateEdicts()
+{
+	// Offset 0 is the empty string
+	m_Strings.push_back('\0');
+	m_Precache.push_back("");
+
+	for (int i = 1; i < MODEL_COUNT; i++)
+	{
+		std::string name = "models/m_" + std::to_string(i) + ".mdl";
+
+		// Weapon models are precached last, so lookups are slow
+		if (i >= MODEL_COUNT - 20)
+		{
+			name = "models/p_weapon" + std::to_string(i) + ".mdl";
+			m_WeaponModels.push_back((string_t)m_Strings.size());
+			m_Strings += name;
+			m_Strings.push_back('\0');
+		}
+
+		m_Precache.push_back(name);
+	}
+
+	m_Edicts.resize(MAX_EDICTS);
+	memset(m_Edicts.data(), 0, m_Edicts.size() * sizeof(edict_t));
+
+	for (int i = 1; i < MAX_EDICTS; i++)
+	{
+		entvars_t &v = m_Edicts[i].v;
+		v.modelindex = 1 + m_Rng() % (MODEL_COUNT - 1);
+		v.scale = 1;
+		v.framerate = 1;
+		v.rendercolor = Vector(255, 128, 0);
+
+		if (i <= MAX_CLIENTS)
+		{
+			v.weaponmodel = m_WeaponModels[m_Rng() % m_WeaponModels.size()];
+			v.gravity = 1;
+			v.health = 100;
+		}
+		else if (m_Rng() % 10 == 0)
+		{
+			// Beams attached to players
+			v.flags |= FL_CUSTOMENTITY;
+			v.aiment = &m_Edicts[1 + m_Rng() % MAX_CLIENTS];
+			v.skin = (short)(m_Rng() % 0x10000);
+		}
+
+		if (m_Rng() % 4 == 0)
+			v.owner = &m_Edicts[m_Rng() % MAX_EDICTS];
+	}
+}
+
+void CEntitySnapshotTest::RunFrame()
+{
+	for (int i = 1; i < MAX_EDICTS; i++)
+	{
+		entvars_t &v = m_Edicts[i].v;
+
+		for (int j = 0; j < 3; j++)
+		{
+			v.origin[j] += RandomFloat(-10, 10);
+			v.angles[j] = RandomFloat(-180, 180);
+			v.velocity[j] = m_Rng() % 2 ? 0 : RandomFloat(-320, 320);
+		}
+
+		v.animtime = RandomFloat(0, 1000);
+		v.frame = RandomFloat(0, 255);
+		v.sequence = m_Rng() % 20;
+		v.controller[m_Rng() % 4] = (byte)m_Rng();
+		v.renderfx = m_Rng() % 50 == 0 ? kRenderFxDeadPlayer : kRenderFxNone;
+
+		if (i <= MAX_CLIENTS)
+		{
+			v.flags ^= m_Rng() % 10 == 0 ? FL_DUCKING : 0;
+
+			if (m_Rng() % 20 == 0)
+				v.weaponmodel = m_Rng() % 10 == 0 ? 0 : m_WeaponModels[m_Rng() % m_WeaponModels.size()];
+
+			if (m_Rng() % 20 == 0)
+			{
+				v.iuser1 = m_Rng() % 2 ? OBS_IN_EYE : 0;
+				v.iuser2 = v.iuser1 ? 1 + m_Rng() % MAX_CLIENTS : 0;
+			}
+		}
+	}
+}
+
+void CEntitySnapshotTest::OldGetState(entity_state_t *state, int e, edict_t *ent, edict_t *host, int player)
+{
+	int i;
+
+	memset(state, 0, sizeof(*state));
+
+	state->number = e;
+	state->entityType = ENTITY_NORMAL;
+
+	if (ent->v.flags & FL_CUSTOMENTITY)
+	{
+		state->entityType = ENTITY_BEAM;
+	}
+
+	state->animtime = (int)(1000.0 * ent->v.animtime) / 1000.0;
+
+	memcpy(state->origin, ent->v.origin, 3 * sizeof(float));
+	memcpy(state->angles, ent->v.angles, 3 * sizeof(float));
+	memcpy(state->mins, ent->v.mins, 3 * sizeof(float));
+	memcpy(state->maxs, ent->v.maxs, 3 * sizeof(float));
+
+	memcpy(state->startpos, ent->v.startpos, 3 * sizeof(float));
+	memcpy(state->endpos, ent->v.endpos, 3 * sizeof(float));
+
+	state->impacttime = ent->v.impacttime;
+	state->starttime = ent->v.starttime;
+
+	state->modelindex = ent->v.modelindex;
+
+	state->frame = ent->v.frame;
+
+	state->skin = ent->v.skin;
+	state->effects = ent->v.effects;
+
+	if (!player && ent->v.animtime && ent->v.velocity[0] == 0 && ent->v.velocity[1] == 0 && ent->v.velocity[2] == 0)
+	{
+		state->eflags |= EFLAG_SLERP;
+	}
+
+	state->scale = ent->v.scale;
+	state->solid = ent->v.solid;
+	state->colormap = ent->v.colormap;
+
+	state->movetype = ent->v.movetype;
+	state->sequence = ent->v.sequence;
+	state->framerate = ent->v.framerate;
+	state->body = ent->v.body;
+
+	for (i = 0; i < 4; i++)
+	{
+		state->controller[i] = ent->v.controller[i];
+	}
+
+	for (i = 0; i < 2; i++)
+	{
+		state->blending[i] = ent->v.blending[i];
+	}
+
+	state->rendermode = ent->v.rendermode;
+	state->renderamt = ent->v.renderamt;
+	state->renderfx = ent->v.renderfx;
+	state->rendercolor.r = ent->v.rendercolor.x;
+	state->rendercolor.g = ent->v.rendercolor.y;
+	state->rendercolor.b = ent->v.rendercolor.z;
+
+	state->aiment = 0;
+	if (ent->v.aiment)
+	{
+		state->aiment = (int)(ent->v.aiment - m_Edicts.data());
+		if (state->entityType == ENTITY_BEAM && host->v.iuser1 == OBS_IN_EYE && host->v.iuser2 == state->aiment)
+		{
+			state->aiment = (int)(host - m_Edicts.data());
+			state->skin = (state->aiment & 0x0FFF) | (state->skin & 0xF000);
+		}
+	}
+
+	state->owner = 0;
+	if (ent->v.owner)
+	{
+		int owner = (int)(ent->v.owner - m_Edicts.data());
+
+		if (owner >= 1 && owner <= MAX_CLIENTS)
+		{
+			state->owner = owner;
+		}
+	}
+
+	if (!player)
+	{
+		state->playerclass = ent->v.playerclass;
+	}
+
+	if (player)
+	{
+		memcpy(state->basevelocity, ent->v.basevelocity, 3 * sizeof(float));
+
+		state->weaponmodel = ModelIndex(m_Strings.c_str() + ent->v.weaponmodel);
+		state->gaitsequence = ent->v.gaitsequence;
+		state->spectator = ent->v.flags & FL_SPECTATOR;
+		state->friction = ent->v.friction;
+
+		state->gravity = ent->v.gravity;
+
+		if (ent->v.iuser1)
+			state->team = -1;
+
+		state->usehull = (ent->v.flags & FL_DUCKING) ? 1 : 0;
+		state->health = ent->v.health;
+	}
+
+	if (ent->v.renderfx == kRenderFxDeadPlayer)
+	{
+		state->movetype = MOVETYPE_NONE;
+		state->solid = SOLID_NOT;
+	}
+}
+
+void CEntitySnapshotTest::TestStates()
+{
+	fprintf(stderr, "Checking that states match the old code\n");
+
+	CEntitySnapshot snapshot;
+	snapshot.Init(m_Edicts.data(), MAX_CLIENTS, m_Strings.c_str(), &ModelIndex);
+
+	for (int frame = 0; frame < 50; frame++)
+	{
+		RunFrame();
+		snapshot.NewFrame();
+
+		for (int h = 1; h <= MAX_CLIENTS; h++)
+		{
+			edict_t *host = &m_Edicts[h];
+
+			for (int e = 1; e < MAX_EDICTS; e++)
+			{
+				entity_state_t expected, state;
+				int player = e <= MAX_CLIENTS;
+
+				OldGetState(&expected, e, &m_Edicts[e], host, player);
+				snapshot.GetState(&state, e, &m_Edicts[e], host, player);
+
+				if (memcmp(&expected, &state, sizeof(state)))
+					FatalError("Frame " + std::to_string(frame) + ": state of " + std::to_string(e) + " for client " + std::to_string(h) + " doesn't match");
+			}
+		}
+	}
+
+	if (snapshot.GetBuildCount() != 50 * (MAX_EDICTS - 1))
+		FatalError("Unexpected build count " + std::to_string(snapshot.GetBuildCount()));
+
+	fprintf(stderr, "Good\n\n");
+}
+
+void CEntitySnapshotTest::RunBenchmark()
+{
+	constexpr int FRAME_COUNT = 50;
+
+	fprintf(stderr, "Benchmark: %d clients, %d edicts, %d frames\n", MAX_CLIENTS, MAX_EDICTS, FRAME_COUNT);
+
+	CEntitySnapshot snapshot;
+	snapshot.Init(m_Edicts.data(), MAX_CLIENTS, m_Strings.c_str(), &ModelIndex);
+
+	double oldTime = 0;
+	double newTime = 0;
+	int oldLookups = 0;
+	int checksum = 0;
+	entity_state_t state;
+
+	for (int frame = 0; frame < FRAME_COUNT; frame++)
+	{
+		RunFrame();
+
+		auto t0 = std::chrono::steady_clock::now();
+		m_iModelIndexCalls = 0;
+
+		for (int h = 1; h <= MAX_CLIENTS; h++)
+		{
+			for (int e = 1; e < MAX_EDICTS; e++)
+			{
+				OldGetState(&state, e, &m_Edicts[e], &m_Edicts[h], e <= MAX_CLIENTS);
+				checksum += state.weaponmodel;
+			}
+		}
+
+		oldLookups += m_iModelIndexCalls;
+		auto t1 = std::chrono::steady_clock::now();
+
+		snapshot.NewFrame();
+
+		for (int h = 1; h <= MAX_CLIENTS; h++)
+		{
+			for (int e = 1; e < MAX_EDICTS; e++)
+			{
+				snapshot.GetState(&state, e, &m_Edicts[e], &m_Edicts[h], e <= MAX_CLIENTS);
+				checksum -= state.weaponmodel;
+			}
+		}
+
+		auto t2 = std::chrono::steady_clock::now();
+		oldTime += std::chrono::duration<double, std::micro>(t1 - t0).count();
+		newTime += std::chrono::duration<double, std::micro>(t2 - t1).count();
+	}
+
+	if (checksum != 0)
+		FatalError("Benchmark results don't match");
+
+	fprintf(stderr, "Old per-client states: %8.1f us per frame, %d model lookups\n", oldTime / FRAME_COUNT, oldLookups);
+	fprintf(stderr, "Snapshot:              %8.1f us per frame, %d model lookups\n", newTime / FRAME_COUNT, snapshot.GetModelLookupCount());
+	fprintf(stderr, "States built: %d, shared: %d\n", snapshot.GetBuildCount(), snapshot.GetShareCount());
+}
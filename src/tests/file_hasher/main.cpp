@@ -0,0 +1,325 @@
+//
+// File hasher test and benchmark.
+//
+// Creates a directory tree that looks like a game directory, checks CFileHasher
+// results against the ifstream-based hashing the updater used before and
+// compares the time it takes to hash the whole tree.
+// Extra argument is a path to a real game directory to benchmark.
+//
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+#include <tier1/checksum_sha1.h>
+#include <updater/file_hasher.h>
+
+namespace fs = std::filesystem;
+
+class CFileHasherTest
+{
+public:
+	int Run(int argc, char **argv);
+	[[noreturn]] void FatalError(const std::string &msg);
+
+private:
+	fs::path m_TreePath;
+	std::vector<fs::path> m_TreeFiles;
+
+	static std::vector<uint8_t> StreamSHA1(const fs::path &path, uint64_t &size);
+	static std::string ToHex(const std::vector<uint8_t> &hash);
+	static void WriteFile(const fs::path &path, const std::string &data);
+
+	void CreateTree();
+	void ListTree(const fs::path &path, std::vector<fs::path> &files);
+
+	void TestSmallFiles();
+	void TestTree();
+	void TestAbort();
+	void RunBenchmark(const std::vector<fs::path> &files);
+};
+
+int main(int argc, char **argv)
+{
+	CFileHasherTest test;
+	return test.Run(argc, argv);
+}
+
+int CFileHasherTest::Run(int argc, char **argv)
+{
+	m_TreePath = fs::temp_directory_path() / "bhl_test_file_hasher";
+	fs::remove_all(m_TreePath);
+	CreateTree();
+
+	TestSmallFiles();
+	TestTree();
+	TestAbort();
+	RunBenchmark(m_TreeFiles);
+
+	fs::remove_all(m_TreePath);
+
+	for (int i = 1; i < argc; i++)
+	{
+		std::vector<fs::path> files;
+		ListTree(fs::u8path(argv[i]), files);
+		fprintf(stderr, "\n%s\n", argv[i]);
+		RunBenchmark(files);
+	}
+
+	return 0;
+}
+
+void CFileHasherTest::FatalError(const std::string &msg)
+{
+	fprintf(stderr, "Fatal Error: %s\n", msg.c_str());
+	exit(1);
+}
+
+std::vector<uint8_t> CFileHasherTest::StreamSHA1(const fs::path &path, uint64_t &size)
+{
+	// CalcFileSHA1 of the updater before CFileHasher
+	constexpr size_t MAX_FILE_READ_BUFFER = 8000;
+	std::ifstream file;
+	file.exceptions(std::ios::badbit | std::ios::failbit);
+	file.open(path, std::ios::in | std::ios::binary);
+
+	CSHA1 hash;
+	unsigned char uData[MAX_FILE_READ_BUFFER];
+
+	file.seekg(0, file.end);
+	size = file.tellg();
+	file.seekg(0, file.beg);
+
+	uint64_t rest = size;
+
+	while (rest > 0)
+	{
+		size_t count = rest < MAX_FILE_READ_BUFFER ? (size_t)rest : MAX_FILE_READ_BUFFER;
+		file.read((char *)uData, count);
+		hash.Update(uData, (unsigned int)count);
+		rest -= count;
+	}
+
+	hash.Final();
+	std::vector<uint8_t> hashBytes(CFileHasher::HASH_SIZE);
+	hash.GetHash(hashBytes.data());
+	return hashBytes;
+}
+
+std::string CFileHasherTest::ToHex(const std::vector<uint8_t> &hash)
+{
+	std::string s;
+	char buf[3];
+
+	for (uint8_t i : hash)
+	{
+		snprintf(buf, sizeof(buf), "%02x", i);
+		s += buf;
+	}
+
+	return s;
+}
+
+void CFileHasherTest::WriteFile(const fs::path &path, const std::string &data)
+{
+	fs::create_directories(path.parent_path());
+	std::ofstream file(path, std::ios::out | std::ios::binary);
+	file.write(data.data(), data.size());
+}
+
+void CFileHasherTest::CreateTree()
+{
+	std::mt19937 rng(1234);
+	const char *dirs[] = { "models", "models/player", "sound/weapons", "sound/player", "sprites", "gfx/env", "maps", "resource/ui" };
+
+	auto fnData = [&](size_t size) {
+		std::string data(size, '\0');
+
+		for (char &c : data)
+			c = (char)(rng() & 0xFF);
+
+		return data;
+	};
+
+	// Lots of small files and a few big ones, like models, sounds and maps
+	for (int i = 0; i < 1500; i++)
+	{
+		const char *dir = dirs[rng() % (sizeof(dirs) / sizeof(dirs[0]))];
+		size_t size = (rng() % 10 == 0) ? 100000 + rng() % 400000 : rng() % 20000;
+		fs::path path = m_TreePath / dir / ("file" + std::to_string(i) + ".dat");
+		WriteFile(path, fnData(size));
+	}
+
+	for (int i = 0; i < 4; i++)
+		WriteFile(m_TreePath / "maps" / ("big" + std::to_string(i) + ".bsp"), fnData(8000000 + rng() % 4000000));
+
+	WriteFile(m_TreePath / "empty.txt", "");
+	ListTree(m_TreePath, m_TreeFiles);
+}
+
+void CFileHasherTest::ListTree(const fs::path &path, std::vector<fs::path> &files)
+{
+	for (const fs::directory_entry &entry : fs::recursive_directory_iterator(path))
+	{
+		if (entry.is_regular_file())
+			files.push_back(entry.path());
+	}
+}
+
+void CFileHasherTest::TestSmallFiles()
+{
+	fprintf(stderr, "Checking hashes of known files\n");
+
+	WriteFile(m_TreePath / "abc.txt", "abc");
+
+	struct Case
+	{
+		const char *name;
+		bool success;
+		uint64_t size;
+		const char *hash;
+	};
+
+	const Case cases[] = {
+		{ "abc.txt", true, 3, "a9993e364706816aba3e25717850c26c9cd0d89d" },
+		{ "empty.txt", true, 0, "da39a3ee5e6b4b0d3255bfef95601890afd80709" },
+		{ "missing.txt", false, 0, "" },
+	};
+
+	for (const Case &c : cases)
+	{
+		std::vector<uint8_t> hash;
+		uint64_t size = 0;
+		std::string error;
+		bool success = CFileHasher::HashFile(m_TreePath / c.name, hash, size, error);
+
+		if (success != c.success)
+			FatalError(std::string(c.name) + ": wrong result: " + error);
+
+		if (success && (size != c.size || ToHex(hash) != c.hash))
+			FatalError(std::string(c.name) + ": wrong hash " + ToHex(hash));
+
+		if (!success && error.empty())
+			FatalError(std::string(c.name) + ": no error message");
+	}
+
+	fs::remove(m_TreePath / "abc.txt");
+	fprintf(stderr, "Good\n\n");
+}
+
+void CFileHasherTest::TestTree()
+{
+	fprintf(stderr, "Checking that hashes match ifstream hashing\n");
+
+	std::vector<CFileHasher::File> files;
+
+	for (const fs::path &path : m_TreeFiles)
+		files.emplace_back().path = path;
+
+	files.emplace_back().path = m_TreePath / "missing.txt";
+
+	std::vector<std::atomic_int> callbacks(files.size());
+
+	if (!CFileHasher::HashFiles(files, 3, nullptr, [&](size_t i) { callbacks[i]++; }))
+		FatalError("HashFiles was aborted");
+
+	for (size_t i = 0; i < files.size(); i++)
+	{
+		if (callbacks[i] != 1)
+			FatalError("Callback of " + files[i].path.u8string() + " was called " + std::to_string(callbacks[i]) + " times");
+	}
+
+	if (files.back().hashed || files.back().error.empty())
+		FatalError("Missing file was hashed");
+
+	files.pop_back();
+
+	for (const CFileHasher::File &file : files)
+	{
+		uint64_t size = 0;
+		std::vector<uint8_t> hash = StreamSHA1(file.path, size);
+
+		if (!file.hashed || file.hash != hash || file.size != size)
+			FatalError(file.path.u8string() + " has wrong hash " + ToHex(file.hash) + ", expected " + ToHex(hash));
+	}
+
+	fprintf(stderr, "%d files\n", (int)files.size());
+	fprintf(stderr, "Good\n\n");
+}
+
+void CFileHasherTest::TestAbort()
+{
+	fprintf(stderr, "Checking abort\n");
+
+	std::vector<CFileHasher::File> files;
+
+	for (const fs::path &path : m_TreeFiles)
+		files.emplace_back().path = path;
+
+	std::atomic_bool abort = false;
+	std::atomic_int hashed = 0;
+
+	auto fnCallback = [&](size_t i) {
+		if (++hashed == 10)
+			abort = true;
+	};
+
+	if (CFileHasher::HashFiles(files, 2, &abort, fnCallback))
+		FatalError("HashFiles wasn't aborted");
+
+	// Files that were already started by the workers are finished
+	if (hashed < 10 || hashed > 12)
+		FatalError("Wrong number of files was hashed: " + std::to_string(hashed));
+
+	fprintf(stderr, "Good\n\n");
+}
+
+void CFileHasherTest::RunBenchmark(const std::vector<fs::path> &paths)
+{
+	uint64_t totalSize = 0;
+
+	for (const fs::path &path : paths)
+		totalSize += fs::file_size(path);
+
+	fprintf(stderr, "Benchmark: %d files, %.1f MiB\n", (int)paths.size(), totalSize / (1024.0 * 1024.0));
+
+	// Read everything once so all runs start with the same page cache
+	for (const fs::path &path : paths)
+	{
+		uint64_t size;
+		StreamSHA1(path, size);
+	}
+
+	auto t0 = std::chrono::steady_clock::now();
+
+	for (const fs::path &path : paths)
+	{
+		uint64_t size;
+		StreamSHA1(path, size);
+	}
+
+	auto t1 = std::chrono::steady_clock::now();
+
+	double ms[CFileHasher::MAX_THREADS + 1] = {};
+
+	for (int threads = 1; threads <= CFileHasher::MAX_THREADS; threads *= 2)
+	{
+		std::vector<CFileHasher::File> files;
+
+		for (const fs::path &path : paths)
+			files.emplace_back().path = path;
+
+		auto t2 = std::chrono::steady_clock::now();
+		CFileHasher::HashFiles(files, threads, nullptr, nullptr);
+		ms[threads] = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t2).count();
+	}
+
+	double streamMs = std::chrono::duration<double, std::milli>(t1 - t0).count();
+	fprintf(stderr, "ifstream:           %8.1f ms\n", streamMs);
+
+	for (int threads = 1; threads <= CFileHasher::MAX_THREADS; threads *= 2)
+		fprintf(stderr, "Mapped, %d threads:  %8.1f ms (%.1fx)\n", threads, ms[threads], streamMs / ms[threads]);
+}
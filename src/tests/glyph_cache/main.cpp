@@ -0,0 +1,329 @@
+//
+// Glyph cache test and benchmark.
+//
+// Measures and splits chat lines with CGlyphCache and a fake font source,
+// checks the results against the per-character code that CHudChat used before
+// and compares the number of source queries and the time spent.
+//
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+#include <glyph_cache.h>
+
+class CGlyphCacheTest
+{
+public:
+	int Run();
+	[[noreturn]] void FatalError(const std::string &msg);
+
+private:
+	// Source with made-up widths that counts the queries
+	class CFakeSource : public IGlyphMetricsSource
+	{
+	public:
+		int m_iQueries = 0;
+		int m_iCost = 0;
+
+		virtual int GetCharAdvance(unsigned long font, wchar_t ch) override;
+	};
+
+	CFakeSource m_Source;
+	std::vector<std::string> m_Lines;
+
+	void CreateChatLines();
+	int OldComputeBreakChar(unsigned long font, int width, const char *text, int textlen);
+
+	void TestWidths();
+	void TestUTF8();
+	void TestBreaks();
+	void RunBenchmark();
+};
+
+int main()
+{
+	CGlyphCacheTest test;
+	return test.Run();
+}
+
+int CGlyphCacheTest::Run()
+{
+	CreateChatLines();
+	CGlyphCache::Get().SetSource(&m_Source);
+
+	TestWidths();
+	TestUTF8();
+	TestBreaks();
+	RunBenchmark();
+	return 0;
+}
+
+void CGlyphCacheTest::FatalError(const std::string &msg)
+{
+	fprintf(stderr, "Fatal Error: %s\n", msg.c_str());
+	exit(1);
+}
+
+int CGlyphCacheTest::CFakeSource::GetCharAdvance(unsigned long font, wchar_t ch)
+{
+	m_iQueries++;
+
+	// Font lookup and glyph rasterization in the engine's surface
+	volatile unsigned x = (unsigned)ch;
+
+	for (int i = 0; i < m_iCost; i++)
+		x = x * 31 + i;
+
+	return (int)(((unsigned)ch * 7 + font * 3) % 9) + 4;
+}
+
+void CGlyphCacheTest::CreateChatLines()
+{
+	std::mt19937 rng(1234);
+	const char *words[] = { "gg", "wp", "rush", "B", "noob", "lol", "привет", "ready?", "héllo", "日本語", "x", "go go go", "\t", "loooooooooooooooooooong" };
+
+	for (int i = 0; i < 2000; i++)
+	{
+		std::string line;
+		int wordCount = 1 + rng() % 30;
+
+		for (int j = 0; j < wordCount; j++)
+		{
+			line += words[rng() % (sizeof(words) / sizeof(words[0]))];
+			line += ' ';
+		}
+
+		m_Lines.push_back(line);
+	}
+}
+
+int CGlyphCacheTest::OldComputeBreakChar(unsigned long font, int width, const char *text, int textlen)
+{
+	// CHudChat::ComputeBreakChar before the cache, ConvertANSIToUnicode of one byte is its Latin-1 value
+	int currentlen = 0;
+	int lastbreak = textlen;
+	for (int i = 0; i < textlen; i++)
+	{
+		char ch = text[i];
+
+		if (ch <= 32)
+		{
+			lastbreak = i;
+		}
+
+		currentlen += m_Source.GetCharAdvance(font, (wchar_t)(unsigned char)ch);
+
+		if (currentlen >= width)
+		{
+			if (lastbreak == textlen)
+			{
+				lastbreak = std::max(0, i - 1);
+			}
+			break;
+		}
+	}
+
+	if (currentlen >= width)
+	{
+		return lastbreak;
+	}
+	return textlen;
+}
+
+void CGlyphCacheTest::TestWidths()
+{
+	fprintf(stderr, "Checking cached widths\n");
+
+	CGlyphCache &cache = CGlyphCache::Get();
+	cache.Invalidate();
+	m_Source.m_iQueries = 0;
+
+	const wchar_t *text = L"PlayerЖ日 killed";
+	int expected = 0;
+
+	for (const wchar_t *p = text; *p; p++)
+		expected += m_Source.GetCharAdvance(1, *p);
+
+	m_Source.m_iQueries = 0;
+
+	if (cache.MeasureText(1, text) != expected)
+		FatalError("Wrong text width");
+
+	int queries = m_Source.m_iQueries;
+
+	if (queries != 12)
+		FatalError("Repeated characters were queried again: " + std::to_string(queries));
+
+	if (cache.MeasureText(1, text) != expected || cache.MeasureText(1, text, 3) != cache.MeasureText(1, L"Pla") || m_Source.m_iQueries != queries)
+		FatalError("Cached widths are wrong");
+
+	// Fonts don't share widths
+	if (cache.GetCharAdvance(2, L'P') != m_Source.GetCharAdvance(2, L'P') || m_Source.m_iQueries != queries + 2)
+		FatalError("Width of another font is wrong");
+
+	cache.Invalidate();
+	m_Source.m_iQueries = 0;
+	cache.MeasureText(1, text);
+
+	if (m_Source.m_iQueries != queries)
+		FatalError("Widths weren't dropped");
+
+	fprintf(stderr, "Good\n\n");
+}
+
+void CGlyphCacheTest::TestUTF8()
+{
+	fprintf(stderr, "Checking UTF-8 decoding\n");
+
+	struct Case
+	{
+		const char *text;
+		std::vector<wchar_t> chars;
+	};
+
+	const Case cases[] = {
+		{ "a\xC3\xA9\xE2\x82\xAC", { L'a', 0xE9, 0x20AC } },
+		{ "\xD0\x96z", { 0x416, L'z' } },
+		{ "\xE6\x97\xA5", { 0x65E5 } },
+		{ "\xF0\x9F\x98\x80", { sizeof(wchar_t) == 2 ? (wchar_t)0xFFFD : (wchar_t)0x1F600 } },
+		{ "\xE9t\xE9", { 0xE9, L't', 0xE9 } }, // Latin-1
+		{ "\xC3", { 0xC3 } },                  // Cut sequence
+		{ "\xE2\x82", { 0xE2, 0x82 } },
+		{ "\xE2(x", { 0xE2, L'(', L'x' } },
+		{ "\xFF\x80", { 0xFF, 0x80 } },
+	};
+
+	for (const Case &c : cases)
+	{
+		std::vector<wchar_t> chars;
+		int len = (int)strlen(c.text);
+
+		for (int pos = 0; pos < len;)
+			chars.push_back(CGlyphCache::DecodeUTF8(c.text, len, pos));
+
+		if (chars != c.chars)
+			FatalError("Wrong decoding of \"" + std::string(c.text) + "\"");
+	}
+
+	CGlyphCache &cache = CGlyphCache::Get();
+
+	if (cache.MeasureTextUTF8(1, "a\xC3\xA9\xE2\x82\xAC") != cache.MeasureText(1, L"aé€"))
+		FatalError("Wrong UTF-8 text width");
+
+	fprintf(stderr, "Good\n\n");
+}
+
+void CGlyphCacheTest::TestBreaks()
+{
+	fprintf(stderr, "Checking chat line breaks\n");
+
+	CGlyphCache &cache = CGlyphCache::Get();
+	int splits = 0;
+
+	for (const std::string &line : m_Lines)
+	{
+		int len = (int)line.size();
+		bool ascii = true;
+
+		for (char c : line)
+			ascii = ascii && (unsigned char)c < 0x80;
+
+		for (int width : { 1, 40, 200, 1000 })
+		{
+			int pos = cache.FindBreakUTF8(1, line.c_str(), len, width);
+
+			if (pos < 0 || pos > len)
+				FatalError("Break is out of the line");
+
+			// Never in the middle of a character
+			if (pos < len && ((unsigned char)line[pos] & 0xC0) == 0x80)
+				FatalError("Line was broken inside of a character: " + line);
+
+			// Same as before for text the old code could decode
+			if (ascii && pos != OldComputeBreakChar(1, width, line.c_str(), len))
+				FatalError("Break is different from the old code: " + line);
+
+			if (pos == len && cache.MeasureTextUTF8(1, line.c_str()) >= width)
+				FatalError("Line that doesn't fit wasn't broken: " + line);
+
+			if (pos < len && pos > 0 && (unsigned char)line[pos] > 32 && cache.MeasureTextUTF8(1, line.c_str(), pos) >= width)
+				FatalError("First part doesn't fit: " + line);
+
+			splits += pos < len;
+		}
+	}
+
+	if (cache.FindBreakUTF8(1, "", 0, 10) != 0 || cache.FindBreakUTF8(1, "abc", 3, 1) != 0)
+		FatalError("Wrong break of a short line");
+
+	fprintf(stderr, "%d of %d lines split\n", splits, (int)m_Lines.size() * 4);
+	fprintf(stderr, "Good\n\n");
+}
+
+void CGlyphCacheTest::RunBenchmark()
+{
+	constexpr int REPEAT_COUNT = 20;
+	constexpr int WIDTH = 300;
+
+	size_t bytes = 0;
+
+	for (const std::string &line : m_Lines)
+		bytes += line.size();
+
+	fprintf(stderr, "Benchmark: %d chat lines, %zu bytes, %d times\n", (int)m_Lines.size(), bytes, REPEAT_COUNT);
+
+	CGlyphCache &cache = CGlyphCache::Get();
+	cache.Invalidate();
+	m_Source.m_iCost = 50;
+	m_Source.m_iQueries = 0;
+
+	int oldSum = 0;
+	int cachedSum = 0;
+
+	auto t0 = std::chrono::steady_clock::now();
+
+	// Old code measured every byte, remaining parts of the line were measured again
+	for (int i = 0; i < REPEAT_COUNT; i++)
+	{
+		for (const std::string &line : m_Lines)
+		{
+			for (const char *p = line.c_str(), *end = p + line.size(); p < end;)
+			{
+				int pos = OldComputeBreakChar(1, WIDTH, p, (int)(end - p));
+				oldSum += pos;
+				p += pos > 0 ? pos : 1;
+			}
+		}
+	}
+
+	auto t1 = std::chrono::steady_clock::now();
+	int oldQueries = m_Source.m_iQueries;
+	m_Source.m_iQueries = 0;
+
+	for (int i = 0; i < REPEAT_COUNT; i++)
+	{
+		for (const std::string &line : m_Lines)
+		{
+			for (const char *p = line.c_str(), *end = p + line.size(); p < end;)
+			{
+				int pos = cache.FindBreakUTF8(1, p, (int)(end - p), WIDTH);
+				cachedSum += pos;
+				p += pos > 0 ? pos : 1;
+			}
+		}
+	}
+
+	auto t2 = std::chrono::steady_clock::now();
+
+	if (oldSum == 0 || cachedSum == 0)
+		FatalError("Nothing was measured");
+
+	auto ms = [](auto a, auto b) { return std::chrono::duration<double, std::milli>(b - a).count(); };
+	fprintf(stderr, "Per character: %8.3f ms, %d source queries\n", ms(t0, t1) / REPEAT_COUNT, oldQueries / REPEAT_COUNT);
+	fprintf(stderr, "Cached:        %8.3f ms, %d source queries total\n", ms(t1, t2) / REPEAT_COUNT, m_Source.m_iQueries);
+	fprintf(stderr, "Cache hits: %d, misses: %d\n", cache.GetHitCount(), cache.GetMissCount());
+}
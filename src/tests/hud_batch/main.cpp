@@ -0,0 +1,423 @@
+//
+// HUD sprite batching test.
+//
+// Draws quads through CHudSpriteBatcher into a recording backend and checks
+// that batches are merged, state changes are deduplicated and the image
+// is the same as when every quad is drawn separately, also when quads are
+// mixed with immediate drawing like vgui2 painting of the custom crosshair.
+//
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+#include <hud_sprite_batch.h>
+
+class CHudBatchTest
+{
+public:
+	int Run();
+	[[noreturn]] void FatalError(const std::string &msg);
+
+private:
+	struct Call
+	{
+		enum
+		{
+			Texture,
+			RenderMode,
+			Draw,
+			Immediate,
+		} type;
+
+		const model_s *model;
+		int value; // Frame, render mode or number of quads
+	};
+
+	class CRecordingBackend : public IHudSpriteBackend
+	{
+	public:
+		static constexpr int WIDTH = 64;
+		static constexpr int HEIGHT = 48;
+
+		std::vector<Call> calls;
+		std::vector<HudSpriteVertex> verts;
+
+		// Id of the quad that was drawn last in each pixel
+		unsigned pixels[WIDTH * HEIGHT] = {};
+
+		void SetTexture(const model_s *model, int frame) override;
+		void SetRenderMode(int mode) override;
+		void DrawQuads(const HudSpriteVertex *pVerts, int numQuads) override;
+
+		/**
+		 * Fills a rect bypassing the batcher, like vgui2 surface does.
+		 */
+		void DrawImmediate(int x, int y, int w, int h, unsigned id);
+
+		void Clear();
+		int CountCalls(int type);
+	};
+
+	CRecordingBackend m_Backend;
+	CHudSpriteBatcher m_Batcher;
+
+	const model_s *m_pModelA = reinterpret_cast<const model_s *>(0x1000);
+	const model_s *m_pModelB = reinterpret_cast<const model_s *>(0x2000);
+
+	void AddQuad(const model_s *model, int frame, int mode, float x, float y, float w, float h, unsigned id = 1);
+	void TestMerge();
+	void TestOverlap();
+	void TestStateChanges();
+	void TestDrawOrder();
+	void TestImmediateDraw();
+};
+
+int main()
+{
+	CHudBatchTest test;
+	return test.Run();
+}
+
+int CHudBatchTest::Run()
+{
+	m_Batcher.SetBackend(&m_Backend);
+
+	TestMerge();
+	TestOverlap();
+	TestStateChanges();
+	TestDrawOrder();
+	TestImmediateDraw();
+	return 0;
+}
+
+void CHudBatchTest::FatalError(const std::string &msg)
+{
+	fprintf(stderr, "Fatal Error: %s\n", msg.c_str());
+	exit(1);
+}
+
+void CHudBatchTest::CRecordingBackend::SetTexture(const model_s *model, int frame)
+{
+	calls.push_back({ Call::Texture, model, frame });
+}
+
+void CHudBatchTest::CRecordingBackend::SetRenderMode(int mode)
+{
+	calls.push_back({ Call::RenderMode, nullptr, mode });
+}
+
+void CHudBatchTest::CRecordingBackend::DrawQuads(const HudSpriteVertex *pVerts, int numQuads)
+{
+	calls.push_back({ Call::Draw, nullptr, numQuads });
+	verts.insert(verts.end(), pVerts, pVerts + numQuads * 4);
+
+	for (int i = 0; i < numQuads; i++)
+	{
+		const HudSpriteVertex *v = pVerts + i * 4;
+		unsigned id = v->color[0] | (v->color[1] << 8) | (v->color[2] << 16);
+
+		// Vertices go clockwise from top-left
+		for (int y = (int)v[0].y; y < (int)v[2].y; y++)
+		{
+			for (int x = (int)v[0].x; x < (int)v[2].x; x++)
+			{
+				if (x >= 0 && x < WIDTH && y >= 0 && y < HEIGHT)
+					pixels[y * WIDTH + x] = id;
+			}
+		}
+	}
+}
+
+void CHudBatchTest::CRecordingBackend::DrawImmediate(int x, int y, int w, int h, unsigned id)
+{
+	calls.push_back({ Call::Immediate, nullptr, (int)id });
+
+	for (int py = std::max(y, 0); py < std::min(y + h, HEIGHT); py++)
+	{
+		for (int px = std::max(x, 0); px < std::min(x + w, WIDTH); px++)
+			pixels[py * WIDTH + px] = id;
+	}
+}
+
+void CHudBatchTest::CRecordingBackend::Clear()
+{
+	calls.clear();
+	verts.clear();
+	std::fill(std::begin(pixels), std::end(pixels), 0);
+}
+
+int CHudBatchTest::CRecordingBackend::CountCalls(int type)
+{
+	int count = 0;
+
+	for (const Call &call : calls)
+	{
+		if (call.type == type)
+			count++;
+	}
+
+	return count;
+}
+
+void CHudBatchTest::AddQuad(const model_s *model, int frame, int mode, float x, float y, float w, float h, unsigned id)
+{
+	HudSpriteState state;
+	state.model = model;
+	state.frame = frame;
+	state.renderMode = mode;
+
+	float s[2] = { 0, 1 };
+	float t[2] = { 0, 1 };
+	uint8_t color[4] = { (uint8_t)id, (uint8_t)(id >> 8), (uint8_t)(id >> 16), 255 };
+	m_Batcher.AddQuad(state, x, y, w, h, s, t, color);
+}
+
+void CHudBatchTest::TestMerge()
+{
+	fprintf(stderr, "Checking that quads with the same state are merged\n");
+	m_Backend.Clear();
+
+	// Digits of a number
+	for (int i = 0; i < 10; i++)
+		AddQuad(m_pModelA, 0, 0, i * 5.0f, 0, 5, 8);
+
+	// Two icons drawn in turns
+	for (int i = 0; i < 10; i++)
+		AddQuad(i % 2 ? m_pModelA : m_pModelB, 1, 0, i * 5.0f, 10, 5, 8);
+
+	m_Batcher.Flush();
+
+	if (m_Backend.CountCalls(Call::Draw) != 3)
+		FatalError("Expected 3 draw calls, got " + std::to_string(m_Backend.CountCalls(Call::Draw)));
+
+	if (m_Backend.verts.size() != 20 * 4)
+		FatalError("Wrong number of vertices");
+
+	const HudSpriteVertex *v = m_Backend.verts.data();
+
+	if (v[0].x != 0 || v[0].y != 0 || v[2].x != 5 || v[2].y != 8 || v[1].s != 1 || v[1].t != 0 || v[3].s != 0 || v[3].t != 1)
+		FatalError("Wrong quad vertices");
+
+	if (m_Batcher.GetStats().quads != 20 || m_Batcher.GetStats().drawCalls != 3)
+		FatalError("Wrong counters");
+
+	fprintf(stderr, "Good\n\n");
+}
+
+void CHudBatchTest::TestOverlap()
+{
+	fprintf(stderr, "Checking that overlapping quads are not reordered\n");
+	m_Backend.Clear();
+
+	AddQuad(m_pModelA, 0, 0, 0, 0, 10, 10, 1);
+	AddQuad(m_pModelB, 0, 0, 5, 5, 10, 10, 2);
+	AddQuad(m_pModelA, 0, 0, 8, 8, 10, 10, 3);
+	m_Batcher.Flush();
+
+	if (m_Backend.CountCalls(Call::Draw) != 3)
+		FatalError("Overlapping quad was merged into an earlier batch");
+
+	if (m_Backend.pixels[9 * CRecordingBackend::WIDTH + 9] != 3 || m_Backend.pixels[6 * CRecordingBackend::WIDTH + 6] != 2)
+		FatalError("Wrong draw order");
+
+	fprintf(stderr, "Good\n\n");
+}
+
+void CHudBatchTest::TestStateChanges()
+{
+	fprintf(stderr, "Checking that state changes are deduplicated\n");
+	m_Backend.Clear();
+
+	// Same texture, different modes
+	AddQuad(m_pModelA, 0, 5, 0, 0, 10, 10);
+	AddQuad(m_pModelA, 0, 0, 0, 0, 10, 10);
+	AddQuad(m_pModelA, 0, 5, 0, 0, 10, 10);
+	m_Batcher.Flush();
+
+	if (m_Backend.CountCalls(Call::Texture) != 1)
+		FatalError("Texture was set more than once");
+
+	// 5, 0, 5 and reset to 0
+	if (m_Backend.CountCalls(Call::RenderMode) != 4 || m_Backend.calls.back().type != Call::RenderMode || m_Backend.calls.back().value != 0)
+		FatalError("Render mode wasn't reset at the end of the flush");
+
+	// Engine may change the state between flushes
+	m_Backend.Clear();
+	AddQuad(m_pModelA, 0, 0, 0, 0, 10, 10);
+	m_Batcher.Flush();
+
+	if (m_Backend.CountCalls(Call::Texture) != 1 || m_Backend.CountCalls(Call::RenderMode) != 1)
+		FatalError("State wasn't set again after a flush");
+
+	// Different frames of the same sprite are different textures
+	m_Backend.Clear();
+	AddQuad(m_pModelA, 0, 0, 0, 0, 10, 10);
+	AddQuad(m_pModelA, 1, 0, 20, 0, 10, 10);
+	m_Batcher.Flush();
+
+	if (m_Backend.CountCalls(Call::Texture) != 2 || m_Backend.CountCalls(Call::RenderMode) != 1)
+		FatalError("Frame change wasn't handled");
+
+	m_Backend.Clear();
+	m_Batcher.Flush();
+
+	if (!m_Backend.calls.empty())
+		FatalError("Empty flush called the backend");
+
+	fprintf(stderr, "Good\n\n");
+}
+
+void CHudBatchTest::TestDrawOrder()
+{
+	fprintf(stderr, "Checking that batched image matches unbatched one\n");
+
+	std::mt19937 rng(1234);
+	const model_s *models[] = { m_pModelA, m_pModelB };
+	unsigned totalQuads = 0;
+	unsigned totalCalls = 0;
+
+	for (int frame = 0; frame < 1000; frame++)
+	{
+		struct Quad
+		{
+			int model, frame, mode, x, y, w, h;
+		};
+
+		std::vector<Quad> quads(1 + rng() % 60);
+
+		for (Quad &q : quads)
+		{
+			q.model = rng() % 2;
+			q.frame = rng() % 3;
+			q.mode = rng() % 2 ? 5 : 0;
+			q.x = rng() % CRecordingBackend::WIDTH - 4;
+			q.y = rng() % CRecordingBackend::HEIGHT - 4;
+			q.w = 1 + rng() % 12;
+			q.h = 1 + rng() % 12;
+		}
+
+		// Reference: one flush per quad
+		m_Backend.Clear();
+
+		for (size_t i = 0; i < quads.size(); i++)
+		{
+			const Quad &q = quads[i];
+			AddQuad(models[q.model], q.frame, q.mode, q.x, q.y, q.w, q.h, i + 1);
+			m_Batcher.Flush();
+		}
+
+		std::vector<unsigned> expected(std::begin(m_Backend.pixels), std::end(m_Backend.pixels));
+		m_Batcher.EndFrame();
+
+		m_Backend.Clear();
+
+		for (size_t i = 0; i < quads.size(); i++)
+		{
+			const Quad &q = quads[i];
+			AddQuad(models[q.model], q.frame, q.mode, q.x, q.y, q.w, q.h, i + 1);
+		}
+
+		m_Batcher.EndFrame();
+
+		if (!std::equal(expected.begin(), expected.end(), std::begin(m_Backend.pixels)))
+			FatalError("Image mismatch in frame " + std::to_string(frame));
+
+		if (m_Batcher.GetLastFrameStats().quads != quads.size() || m_Batcher.GetLastFrameStats().flushes != 1)
+			FatalError("Wrong frame counters");
+
+		totalQuads += quads.size();
+		totalCalls += m_Batcher.GetLastFrameStats().drawCalls;
+	}
+
+	fprintf(stderr, "%u quads in %u draw calls\n", totalQuads, totalCalls);
+	fprintf(stderr, "Good\n\n");
+}
+
+void CHudBatchTest::TestImmediateDraw()
+{
+	fprintf(stderr, "Checking that immediate drawing keeps its place between batched quads\n");
+
+	// Ammo and health icons, then the crosshair over them, then the rest of the HUD
+	m_Backend.Clear();
+	AddQuad(m_pModelA, 0, 5, 20, 20, 10, 10, 1);
+	AddQuad(m_pModelB, 0, 5, 0, 0, 10, 10, 2);
+	m_Batcher.Flush();
+	m_Backend.DrawImmediate(24, 24, 2, 2, 3);
+	AddQuad(m_pModelA, 0, 5, 40, 0, 10, 10, 4);
+	m_Batcher.EndFrame();
+
+	if (m_Backend.pixels[25 * CRecordingBackend::WIDTH + 25] != 3 || m_Backend.pixels[21 * CRecordingBackend::WIDTH + 21] != 1)
+		FatalError("Queued quad was drawn over the immediate draw");
+
+	if (m_Backend.calls[0].type == Call::Immediate || m_Batcher.GetLastFrameStats().flushes != 2)
+		FatalError("Quads weren't flushed before the immediate draw");
+
+	std::mt19937 rng(4321);
+	const model_s *models[] = { m_pModelA, m_pModelB };
+
+	for (int frame = 0; frame < 1000; frame++)
+	{
+		struct Item
+		{
+			bool isImmediate;
+			int model, mode, x, y, w, h;
+		};
+
+		std::vector<Item> items(1 + rng() % 40);
+
+		for (Item &i : items)
+		{
+			i.isImmediate = rng() % 8 == 0;
+			i.model = rng() % 2;
+			i.mode = rng() % 2 ? 5 : 0;
+			i.x = rng() % CRecordingBackend::WIDTH - 4;
+			i.y = rng() % CRecordingBackend::HEIGHT - 4;
+			i.w = 1 + rng() % 12;
+			i.h = 1 + rng() % 12;
+		}
+
+		// Reference: everything is drawn immediately
+		m_Backend.Clear();
+
+		for (size_t i = 0; i < items.size(); i++)
+		{
+			const Item &item = items[i];
+
+			if (item.isImmediate)
+				m_Backend.DrawImmediate(item.x, item.y, item.w, item.h, i + 1);
+			else
+			{
+				AddQuad(models[item.model], 0, item.mode, item.x, item.y, item.w, item.h, i + 1);
+				m_Batcher.Flush();
+			}
+		}
+
+		std::vector<unsigned> expected(std::begin(m_Backend.pixels), std::end(m_Backend.pixels));
+		m_Batcher.EndFrame();
+
+		// Batched, flushed before each immediate draw
+		m_Backend.Clear();
+
+		for (size_t i = 0; i < items.size(); i++)
+		{
+			const Item &item = items[i];
+
+			if (item.isImmediate)
+			{
+				m_Batcher.Flush();
+				m_Backend.DrawImmediate(item.x, item.y, item.w, item.h, i + 1);
+			}
+			else
+				AddQuad(models[item.model], 0, item.mode, item.x, item.y, item.w, item.h, i + 1);
+		}
+
+		m_Batcher.EndFrame();
+
+		if (!std::equal(expected.begin(), expected.end(), std::begin(m_Backend.pixels)))
+			FatalError("Image mismatch in frame " + std::to_string(frame));
+	}
+
+	fprintf(stderr, "Good\n\n");
+}
@@ -0,0 +1,344 @@
+//
+// HUD sprite registry test and benchmark.
+//
+// Loads hud.txt and weapon sprite lists of a big custom weapon mod into
+// CHudSpriteRegistry the same way CHud does, checks lookups against a linear
+// search of the names and compares load and lookup times.
+//
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+#include <hud_sprite_registry.h>
+
+class CHudSpritesTest
+{
+public:
+	int Run();
+	[[noreturn]] void FatalError(const std::string &msg);
+
+private:
+	struct SpriteEntry
+	{
+		std::string name;
+		std::string sprite;
+		int res;
+		wrect_t rc;
+	};
+
+	// Sprite list like CHud used before the registry
+	struct LinearList
+	{
+		std::vector<HSPRITE> sprites;
+		std::vector<wrect_t> rects;
+		std::vector<std::string> names;
+
+		int Find(const char *name) const;
+		void Add(const SpriteEntry &entry, HSPRITE hSprite);
+	};
+
+	static constexpr int WEAPON_COUNT = 400;
+
+	std::vector<SpriteEntry> m_HudTxt;
+	std::vector<std::vector<SpriteEntry>> m_WeaponTxts;
+	std::vector<std::string> m_LookupNames;
+
+	void CreateSpriteLists();
+	void LoadRegistry(CHudSpriteRegistry &registry);
+	void LoadLinear(LinearList &list);
+	static HSPRITE LoadSprite(const std::string &path);
+
+	void TestBasics();
+	void TestModLoad();
+	void RunBenchmark();
+};
+
+int main()
+{
+	CHudSpritesTest test;
+	return test.Run();
+}
+
+int CHudSpritesTest::Run()
+{
+	CreateSpriteLists();
+
+	TestBasics();
+	TestModLoad();
+	RunBenchmark();
+	return 0;
+}
+
+void CHudSpritesTest::FatalError(const std::string &msg)
+{
+	fprintf(stderr, "Fatal Error: %s\n", msg.c_str());
+	exit(1);
+}
+
+int CHudSpritesTest::LinearList::Find(const char *name) const
+{
+	for (size_t i = 0; i < names.size(); i++)
+	{
+		const char *a = name;
+		const char *b = names[i].c_str();
+
+		while (*a && tolower((unsigned char)*a) == tolower((unsigned char)*b))
+		{
+			a++;
+			b++;
+		}
+
+		if (tolower((unsigned char)*a) == tolower((unsigned char)*b))
+			return (int)i;
+	}
+
+	return -1;
+}
+
+void CHudSpritesTest::LinearList::Add(const SpriteEntry &entry, HSPRITE hSprite)
+{
+	sprites.push_back(hSprite);
+	rects.push_back(entry.rc);
+	names.push_back(entry.name.substr(0, CHudSpriteRegistry::MAX_NAME_LENGTH - 1));
+}
+
+HSPRITE CHudSpritesTest::LoadSprite(const std::string &path)
+{
+	// Fake handle that depends on the path
+	unsigned h = 1;
+
+	for (char c : path)
+		h = h * 31 + c;
+
+	return (HSPRITE)(h & 0x7FFFFFFF);
+}
+
+void CHudSpritesTest::CreateSpriteLists()
+{
+	std::mt19937 rng(1234);
+	const char *hudNames[] = { "number_", "divider", "cross", "dollar", "minus", "plus", "suit_", "lamp", "selection", "bucket", "dmg_", "item_", "icon_" };
+
+	for (int res : { 320, 640 })
+	{
+		for (int i = 0; i < 300; i++)
+		{
+			std::string name = hudNames[i % 13] + std::to_string(i / 13);
+			m_HudTxt.push_back({ name, res == 640 ? "640hud1" : "320hud1", res, wrect_t { 0, 24, 0, 24 } });
+		}
+	}
+
+	// Every weapon has its own sprites, ammo types are shared by several weapons
+	const char *weaponSprites[] = { "weapon", "weapon_s", "ammo", "ammo2", "crosshair", "autoaim", "zoom", "zoom_autoaim" };
+
+	for (int i = 0; i < WEAPON_COUNT; i++)
+	{
+		std::vector<SpriteEntry> list;
+		std::string weaponName = "weapon_custom" + std::to_string(i);
+
+		for (int res : { 320, 640 })
+		{
+			for (const char *spr : weaponSprites)
+			{
+				std::string name = spr;
+
+				if (name.compare(0, 4, "ammo") == 0)
+					name = "ammo_type" + std::to_string(rng() % 120) + name.substr(4);
+				else
+					name = "w" + std::to_string(i) + "_" + name;
+
+				list.push_back({ name, weaponName, res, wrect_t { 0, 170, 0, 45 } });
+			}
+		}
+
+		m_WeaponTxts.push_back(list);
+		m_LookupNames.push_back(list[0].name);
+		m_LookupNames.push_back(list[2].name);
+	}
+
+	// Lookups that fail
+	m_LookupNames.push_back("not_a_sprite");
+	m_LookupNames.push_back("");
+}
+
+void CHudSpritesTest::LoadRegistry(CHudSpriteRegistry &registry)
+{
+	// CHud::VidInit
+	int count = 0;
+
+	for (const SpriteEntry &entry : m_HudTxt)
+	{
+		if (entry.res == 640)
+			count++;
+	}
+
+	registry.Clear();
+	registry.Reserve(count);
+
+	for (const SpriteEntry &entry : m_HudTxt)
+	{
+		if (entry.res == 640)
+			registry.Add(entry.name.c_str(), LoadSprite("sprites/" + entry.sprite + ".spr"), entry.rc);
+	}
+
+	// CHudAmmo::LoadWeaponSprites calls CHud::AddSprite
+	for (const std::vector<SpriteEntry> &list : m_WeaponTxts)
+	{
+		for (const SpriteEntry &entry : list)
+		{
+			if (entry.res == 640 && registry.Find(entry.name.c_str()) == -1)
+				registry.Add(entry.name.c_str(), LoadSprite("sprites/" + entry.sprite + ".spr"), entry.rc);
+		}
+	}
+}
+
+void CHudSpritesTest::LoadLinear(LinearList &list)
+{
+	list = LinearList();
+
+	for (const SpriteEntry &entry : m_HudTxt)
+	{
+		if (entry.res == 640)
+			list.Add(entry, LoadSprite("sprites/" + entry.sprite + ".spr"));
+	}
+
+	for (const std::vector<SpriteEntry> &weapon : m_WeaponTxts)
+	{
+		for (const SpriteEntry &entry : weapon)
+		{
+			if (entry.res == 640 && list.Find(entry.name.c_str()) == -1)
+				list.Add(entry, LoadSprite("sprites/" + entry.sprite + ".spr"));
+		}
+	}
+}
+
+void CHudSpritesTest::TestBasics()
+{
+	fprintf(stderr, "Checking sprite lookups\n");
+
+	CHudSpriteRegistry registry;
+
+	if (registry.Find("number_0") != -1)
+		FatalError("Empty registry found a sprite");
+
+	registry.Add("number_0", 10, wrect_t { 0, 24, 0, 24 });
+	registry.Add("Number_1", 11, wrect_t { 24, 48, 0, 24 });
+	registry.Add("NUMBER_0", 12, wrect_t { 0, 1, 0, 1 });
+	registry.Add("a_very_long_sprite_name_that_is_cut", 13, wrect_t {});
+
+	if (registry.GetCount() != 4)
+		FatalError("Wrong sprite count");
+
+	if (registry.Find("NUMBER_1") != 1 || registry.Find("number_1") != 1)
+		FatalError("Lookup is case-sensitive");
+
+	if (registry.Find("number_0") != 0 || registry.GetSprite(0) != 10 || registry.GetRect(1).left != 24)
+		FatalError("Duplicate name replaced the first sprite");
+
+	if (registry.Find("a_very_long_sprite_name") != 3 || registry.Find("a_very_long_sprite_name_that_is_cut") != -1)
+		FatalError("Long name wasn't cut like in hud.txt");
+
+	if (registry.Find("number_") != -1 || registry.Find("number_00") != -1 || registry.Find("") != -1)
+		FatalError("Partial name was found");
+
+	registry.SetSprite(1, 20);
+
+	if (registry.GetSprite(1) != 20 || registry.Find("number_1") != 1)
+		FatalError("SetSprite changed the index");
+
+	registry.Clear();
+
+	if (registry.GetCount() != 0 || registry.Find("number_0") != -1)
+		FatalError("Registry wasn't cleared");
+
+	fprintf(stderr, "Good\n\n");
+}
+
+void CHudSpritesTest::TestModLoad()
+{
+	fprintf(stderr, "Checking that mod sprites match a linear search\n");
+
+	CHudSpriteRegistry registry;
+	LinearList list;
+	LoadRegistry(registry);
+	LoadLinear(list);
+
+	if (registry.GetCount() != (int)list.names.size())
+		FatalError("Wrong sprite count");
+
+	for (int i = 0; i < registry.GetCount(); i++)
+	{
+		if (list.names[i] != registry.GetName(i) || list.sprites[i] != registry.GetSprite(i) || list.rects[i].right != registry.GetRect(i).right)
+			FatalError("Sprite " + std::to_string(i) + " is different");
+
+		std::string upper = list.names[i];
+
+		for (char &c : upper)
+			c = toupper(c);
+
+		if (registry.Find(upper.c_str()) != list.Find(upper.c_str()))
+			FatalError("Lookup of " + upper + " is different");
+	}
+
+	for (const std::string &name : m_LookupNames)
+	{
+		if (registry.Find(name.c_str()) != list.Find(name.c_str()))
+			FatalError("Lookup of " + name + " is different");
+	}
+
+	fprintf(stderr, "%d sprites\n", registry.GetCount());
+	fprintf(stderr, "Good\n\n");
+}
+
+void CHudSpritesTest::RunBenchmark()
+{
+	constexpr int LOAD_COUNT = 20;
+	constexpr int LOOKUP_COUNT = 50;
+
+	fprintf(stderr, "Benchmark: %d weapons, %d loads, %d lookups\n", WEAPON_COUNT, LOAD_COUNT, LOOKUP_COUNT * (int)m_LookupNames.size());
+
+	CHudSpriteRegistry registry;
+	LinearList list;
+
+	auto t0 = std::chrono::steady_clock::now();
+
+	for (int i = 0; i < LOAD_COUNT; i++)
+		LoadLinear(list);
+
+	auto t1 = std::chrono::steady_clock::now();
+
+	for (int i = 0; i < LOAD_COUNT; i++)
+		LoadRegistry(registry);
+
+	auto t2 = std::chrono::steady_clock::now();
+
+	int linearSum = 0;
+	int registrySum = 0;
+
+	for (int i = 0; i < LOOKUP_COUNT; i++)
+	{
+		for (const std::string &name : m_LookupNames)
+			linearSum += list.Find(name.c_str());
+	}
+
+	auto t3 = std::chrono::steady_clock::now();
+
+	for (int i = 0; i < LOOKUP_COUNT; i++)
+	{
+		for (const std::string &name : m_LookupNames)
+			registrySum += registry.Find(name.c_str());
+	}
+
+	auto t4 = std::chrono::steady_clock::now();
+
+	if (linearSum != registrySum)
+		FatalError("Benchmark results don't match");
+
+	auto ms = [](auto a, auto b) { return std::chrono::duration<double, std::milli>(b - a).count(); };
+	fprintf(stderr, "Load, linear:   %8.3f ms\n", ms(t0, t1) / LOAD_COUNT);
+	fprintf(stderr, "Load, hashed:   %8.3f ms\n", ms(t1, t2) / LOAD_COUNT);
+	fprintf(stderr, "Lookup, linear: %8.1f ns\n", ms(t2, t3) * 1e6 / (LOOKUP_COUNT * m_LookupNames.size()));
+	fprintf(stderr, "Lookup, hashed: %8.1f ns\n", ms(t3, t4) * 1e6 / (LOOKUP_COUNT * m_LookupNames.size()));
+}
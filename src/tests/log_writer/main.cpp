@@ -0,0 +1,237 @@
+//
+// Async log writer test.
+//
+// Writes lines through CAsyncLogWriter and checks that the file contains
+// exactly the accepted lines in order, that overflow is counted and that
+// Close and Shutdown flush everything.
+//
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+#include <async_log_writer.h>
+
+class CLogWriterTest
+{
+public:
+	int Run();
+	[[noreturn]] void FatalError(const std::string &msg);
+
+private:
+	std::string m_Path = "test_log_writer.log";
+
+	std::string ReadFile();
+	void TestOrder();
+	void TestReopen();
+	void TestOverflow();
+	void TestShutdown();
+	void RunBenchmark();
+};
+
+int main()
+{
+	CLogWriterTest test;
+	return test.Run();
+}
+
+int CLogWriterTest::Run()
+{
+	TestOrder();
+	TestReopen();
+	TestOverflow();
+	TestShutdown();
+	RunBenchmark();
+
+	remove(m_Path.c_str());
+	return 0;
+}
+
+void CLogWriterTest::FatalError(const std::string &msg)
+{
+	fprintf(stderr, "Fatal Error: %s\n", msg.c_str());
+	exit(1);
+}
+
+std::string CLogWriterTest::ReadFile()
+{
+	std::string data;
+	FILE *file = fopen(m_Path.c_str(), "rb");
+
+	if (!file)
+		return data;
+
+	char buf[4096];
+	size_t len;
+
+	while ((len = fread(buf, 1, sizeof(buf), file)) > 0)
+		data.append(buf, len);
+
+	fclose(file);
+	return data;
+}
+
+void CLogWriterTest::TestOrder()
+{
+	fprintf(stderr, "Checking that lines are written in order\n");
+	remove(m_Path.c_str());
+
+	// Small buffer so it wraps around many times
+	CAsyncLogWriter writer(256);
+	std::string expected;
+
+	writer.Open(m_Path.c_str());
+
+	for (int i = 0; i < 20000; i++)
+	{
+		std::string line = "[00:00:00] Player" + std::to_string(i % 32) + ": message " + std::to_string(i) + "\n";
+
+		// Spin until it fits, test must not lose any lines
+		while (!writer.Write(line.c_str(), line.size()))
+			std::this_thread::yield();
+
+		expected += line;
+	}
+
+	writer.Close();
+
+	if (ReadFile() != expected)
+		FatalError("File contents don't match");
+
+	fprintf(stderr, "Good\n\n");
+}
+
+void CLogWriterTest::TestReopen()
+{
+	fprintf(stderr, "Checking that file is appended to and closed writer drops text\n");
+	remove(m_Path.c_str());
+
+	CAsyncLogWriter writer;
+
+	if (writer.Write("not open\n"))
+		FatalError("Write succeeded without a file");
+
+	writer.Open(m_Path.c_str());
+	writer.Write("first\n");
+	writer.Close();
+
+	if (writer.Write("closed\n"))
+		FatalError("Write succeeded after Close");
+
+	writer.Open(m_Path.c_str());
+	writer.Write("second\n");
+	writer.Flush();
+
+	if (ReadFile() != "first\nsecond\n")
+		FatalError("Flush didn't write the text or file wasn't appended to");
+
+	writer.Close();
+	fprintf(stderr, "Good\n\n");
+}
+
+void CLogWriterTest::TestOverflow()
+{
+	fprintf(stderr, "Checking overflow counters\n");
+	remove(m_Path.c_str());
+
+	CAsyncLogWriter writer(64);
+	writer.Open(m_Path.c_str());
+
+	std::string big(100, 'x');
+
+	if (writer.Write(big.c_str(), big.size()))
+		FatalError("Text larger than the buffer was accepted");
+
+	CAsyncLogWriter::Stats stats = writer.GetStats();
+
+	if (stats.droppedLines != 1 || stats.droppedBytes != big.size())
+		FatalError("Dropped text wasn't counted");
+
+	// Written + dropped must add up no matter how fast the worker is
+	std::string line = "0123456789abcdef";
+	int accepted = 0;
+
+	for (int i = 0; i < 10000; i++)
+	{
+		if (writer.Write(line.c_str(), line.size()))
+			accepted++;
+	}
+
+	writer.Close();
+	stats = writer.GetStats();
+
+	if (stats.writtenLines != (uint64_t)accepted || stats.droppedLines != 1 + 10000 - (uint64_t)accepted)
+		FatalError("Written and dropped counters don't add up");
+
+	if (ReadFile().size() != accepted * line.size())
+		FatalError("File size doesn't match accepted lines");
+
+	fprintf(stderr, "%d of 10000 lines accepted, %llu batches\n", accepted, (unsigned long long)stats.batches);
+	fprintf(stderr, "Good\n\n");
+}
+
+void CLogWriterTest::TestShutdown()
+{
+	fprintf(stderr, "Checking that shutdown writes the buffer\n");
+	remove(m_Path.c_str());
+
+	{
+		CAsyncLogWriter writer;
+		writer.Open(m_Path.c_str());
+		writer.Write("before shutdown\n");
+		writer.Shutdown();
+		writer.Shutdown();
+	}
+
+	{
+		// Destructor must flush too
+		CAsyncLogWriter writer;
+		writer.Open(m_Path.c_str());
+		writer.Write("before destruction\n");
+	}
+
+	if (ReadFile() != "before shutdown\nbefore destruction\n")
+		FatalError("Shutdown lost buffered text");
+
+	fprintf(stderr, "Good\n\n");
+}
+
+void CLogWriterTest::RunBenchmark()
+{
+	fprintf(stderr, "Benchmark: time spent in the calling thread per line\n");
+
+	using Clock = std::chrono::high_resolution_clock;
+	constexpr int LINES = 100000;
+	std::string line = "[12:34:56] Player: gg wp, that was a nice round\n";
+
+	remove(m_Path.c_str());
+	FILE *file = fopen(m_Path.c_str(), "a");
+	auto start = Clock::now();
+
+	for (int i = 0; i < LINES; i++)
+	{
+		fprintf(file, "%s", line.c_str());
+		fflush(file);
+	}
+
+	auto mid = Clock::now();
+	fclose(file);
+
+	remove(m_Path.c_str());
+	CAsyncLogWriter writer;
+	writer.Open(m_Path.c_str());
+	auto mid2 = Clock::now();
+
+	for (int i = 0; i < LINES; i++)
+		writer.Write(line.c_str(), line.size());
+
+	auto end = Clock::now();
+	writer.Close();
+
+	double sync = std::chrono::duration<double, std::nano>(mid - start).count() / LINES;
+	double async = std::chrono::duration<double, std::nano>(end - mid2).count() / LINES;
+
+	fprintf(stderr, "fprintf + fflush: %8.0f ns\n", sync);
+	fprintf(stderr, "CAsyncLogWriter:  %8.0f ns (%llu lines dropped)\n", async, (unsigned long long)writer.GetStats().droppedLines);
+}
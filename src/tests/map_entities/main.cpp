@@ -0,0 +1,423 @@
+//
+// Map entity index test and benchmark.
+//
+// Generates the entity lump of a big map, checks CMapEntityIndex against
+// the COM_ParseFile loop that UTIL_FindEntityInMap used before and compares
+// the cost of spectator start position lookups.
+//
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+#include <map_entities.h>
+
+class CMapEntitiesTest
+{
+public:
+	int Run();
+	[[noreturn]] void FatalError(const std::string &msg);
+
+private:
+	struct Position
+	{
+		bool found = false;
+		std::string origin;
+		std::string angles;
+	};
+
+	static constexpr int ENTITY_COUNT = 8000;
+
+	std::string m_Lump;
+	std::vector<std::string> m_Classnames;
+
+	static char *COM_Parse(char *data, char *token);
+	static Position OldFindEntity(const char *lump, const char *name);
+	static Position IndexFindEntity(const CMapEntityIndex &index, const char *name);
+
+	void CreateLump();
+
+	void TestParsing();
+	void TestLookups();
+	void TestErrors();
+	void RunBenchmark();
+};
+
+int main()
+{
+	CMapEntitiesTest test;
+	return test.Run();
+}
+
+int CMapEntitiesTest::Run()
+{
+	CreateLump();
+
+	TestParsing();
+	TestLookups();
+	TestErrors();
+	RunBenchmark();
+	return 0;
+}
+
+void CMapEntitiesTest::FatalError(const std::string &msg)
+{
+	fprintf(stderr, "Fatal Error: %s\n", msg.c_str());
+	exit(1);
+}
+
+char *CMapEntitiesTest::COM_Parse(char *data, char *token)
+{
+	// Same as the engine's COM_ParseFile
+	int len = 0;
+	int c;
+	token[0] = 0;
+
+	if (!data)
+		return nullptr;
+
+skipwhite:
+	while ((c = (unsigned char)*data) <= ' ')
+	{
+		if (c == 0)
+			return nullptr;
+		data++;
+	}
+
+	if (c == '/' && data[1] == '/')
+	{
+		while (*data && *data != '\n')
+			data++;
+		goto skipwhite;
+	}
+
+	if (c == '\"')
+	{
+		data++;
+		while (1)
+		{
+			c = *data;
+
+			if (c)
+				data++;
+
+			if (c == '\"' || !c)
+			{
+				token[len] = 0;
+				return data;
+			}
+
+			token[len] = c;
+			len++;
+		}
+	}
+
+	if (c == '{' || c == '}' || c == ')' || c == '(' || c == '\'' || c == ':')
+	{
+		token[len] = c;
+		len++;
+		token[len] = 0;
+		return data + 1;
+	}
+
+	do
+	{
+		token[len] = c;
+		data++;
+		len++;
+		c = (unsigned char)*data;
+		if (c == '{' || c == '}' || c == ')' || c == '(' || c == '\'' || c == ':')
+			break;
+	} while (c > 32);
+
+	token[len] = 0;
+	return data;
+}
+
+CMapEntitiesTest::Position CMapEntitiesTest::OldFindEntity(const char *lump, const char *name)
+{
+	// UTIL_FindEntityInMap before the index. Origin and angles are kept as strings
+	// and are reset for every entity instead of keeping values of previous ones.
+	std::vector<char> copy(lump, lump + strlen(lump) + 1);
+	char *data = copy.data();
+	char keyname[256];
+	char token[1024];
+	int n;
+	bool found = false;
+	Position pos;
+
+	while (data)
+	{
+		data = COM_Parse(data, token);
+
+		if ((token[0] == '}') || (token[0] == 0))
+			break;
+
+		if (!data || token[0] != '{')
+			return Position();
+
+		pos = Position();
+
+		while (1)
+		{
+			data = COM_Parse(data, token);
+			if (token[0] == '}')
+				break;
+
+			if (!data)
+				return Position();
+
+			strcpy(keyname, token);
+
+			n = strlen(keyname);
+			while (n && keyname[n - 1] == ' ')
+			{
+				keyname[n - 1] = 0;
+				n--;
+			}
+
+			data = COM_Parse(data, token);
+			if (!data || token[0] == '}')
+				return Position();
+
+			if (!strcmp(keyname, "classname") && !strcmp(token, name))
+				found = true;
+
+			if (!strcmp(keyname, "angle") || !strcmp(keyname, "angles"))
+				pos.angles = std::string(keyname) + "=" + token;
+
+			if (!strcmp(keyname, "origin"))
+				pos.origin = token;
+		}
+
+		if (found)
+		{
+			pos.found = true;
+			return pos;
+		}
+	}
+
+	return Position();
+}
+
+CMapEntitiesTest::Position CMapEntitiesTest::IndexFindEntity(const CMapEntityIndex &index, const char *name)
+{
+	const std::vector<int> &found = index.FindByClassname(name);
+	Position pos;
+
+	if (found.empty())
+		return pos;
+
+	const CMapEntityIndex::KeyValue *kv = index.GetKeyValues(found[0]);
+
+	for (int i = 0; i < index.GetKeyValueCount(found[0]); i++)
+	{
+		std::string_view key = index.GetKeyName(kv[i].keyId);
+
+		if (key == "angle" || key == "angles")
+			pos.angles = std::string(key) + "=" + std::string(kv[i].value);
+
+		if (key == "origin")
+			pos.origin = kv[i].value;
+	}
+
+	pos.found = true;
+	return pos;
+}
+
+void CMapEntitiesTest::CreateLump()
+{
+	std::mt19937 rng(1234);
+	const char *classnames[] = { "func_wall", "func_door", "light", "info_player_deathmatch", "env_sprite", "trigger_multiple", "func_breakable", "ambient_generic", "info_target", "weapon_shotgun", "ammo_buckshot", "func_illusionary" };
+
+	auto fnNum = [&]() { return std::to_string((int)(rng() % 8000) - 4000); };
+
+	m_Lump = "{\n\"wad\" \"\\half-life\\valve\\halflife.wad\"\n\"classname\" \"worldspawn\"\n\"mapversion\" \"220\"\n\"skyname\" \"desert\"\n}\n";
+
+	for (int i = 0; i < ENTITY_COUNT; i++)
+	{
+		const char *classname = classnames[rng() % (sizeof(classnames) / sizeof(classnames[0]))];
+		m_Lump += "{\n";
+
+		if (strncmp(classname, "func_", 5) == 0 || strncmp(classname, "trigger_", 8) == 0)
+		{
+			m_Lump += "\"model\" \"*" + std::to_string(i) + "\"\n";
+			m_Lump += "\"rendercolor\" \"0 0 0\"\n";
+		}
+
+		// Some entities have the classname after the origin
+		if (rng() % 2)
+			m_Lump += "\"classname\" \"" + std::string(classname) + "\"\n";
+
+		m_Lump += "\"origin\" \"" + fnNum() + " " + fnNum() + " " + fnNum() + "\"\n";
+
+		if (rng() % 3 == 0)
+			m_Lump += "\"angle\" \"" + std::to_string((int)(rng() % 360)) + "\"\n";
+		else if (rng() % 3 == 0)
+			m_Lump += "\"angles\" \"0 " + std::to_string((int)(rng() % 360)) + " 0\"\n";
+
+		if (m_Lump.size() % 2)
+			m_Lump += "\"targetname\" \"t" + std::to_string(i) + "\"\n";
+
+		if (m_Lump.find("classname", m_Lump.rfind('{')) == std::string::npos)
+			m_Lump += "\"classname\" \"" + std::string(classname) + "\"\n";
+
+		m_Lump += "}\n";
+	}
+
+	// Spawn points near the end like in maps edited with ripent
+	m_Lump += "{\n\"origin\" \"-256 512 36\"\n\"angle\" \"90\"\n\"classname\" \"info_player_start\"\n}\n";
+	m_Lump += "{\n\"classname\" \"trigger_camera\"\n\"angles\" \"10 20 0\"\n\"origin\" \"1 2 3\"\n}\n";
+
+	for (const char *classname : classnames)
+		m_Classnames.push_back(classname);
+
+	m_Classnames.push_back("worldspawn");
+	m_Classnames.push_back("info_player_start");
+	m_Classnames.push_back("trigger_camera");
+	m_Classnames.push_back("info_player_coop");
+}
+
+void CMapEntitiesTest::TestParsing()
+{
+	fprintf(stderr, "Checking parsing\n");
+
+	CMapEntityIndex index;
+	const char *lump = "// comment\n{\n\"classname\" \"worldspawn\"\n\"key \" \"value\"\n}\n"
+	                   "{ classname light origin \"1 2 3\" \"origin\" \"4 5 6\" \"empty\" \"\" }\n"
+	                   "{ \"classname\" \"light\" }";
+
+	if (!index.Parse(lump) || index.GetError())
+		FatalError("Valid lump wasn't parsed");
+
+	if (index.GetEntityCount() != 3)
+		FatalError("Wrong entity count");
+
+	if (index.GetValue(0, "key") != "value" || index.GetValue(0, "key ").data())
+		FatalError("Trailing spaces weren't removed from the key");
+
+	if (index.GetValue(1, "classname") != "light" || index.GetValue(1, "origin") != "4 5 6")
+		FatalError("Wrong values");
+
+	if (!index.GetValue(1, "empty").data() || !index.GetValue(1, "empty").empty() || index.GetValue(1, "missing").data() || index.GetValue(2, "origin").data())
+		FatalError("Empty and missing values are wrong");
+
+	if (index.FindByClassname("light") != std::vector<int> { 1, 2 } || !index.FindByClassname("lights").empty())
+		FatalError("Wrong classname index");
+
+	if (index.FindKey("origin") == -1 || index.GetKeyName(index.FindKey("origin")) != "origin" || index.FindKey("target") != -1)
+		FatalError("Wrong key ids");
+
+	if (!index.Parse(nullptr) || index.GetEntityCount() != 0 || !index.Parse("") || index.GetEntityCount() != 0)
+		FatalError("Empty lump wasn't parsed");
+
+	fprintf(stderr, "Good\n\n");
+}
+
+void CMapEntitiesTest::TestLookups()
+{
+	fprintf(stderr, "Checking lookups against the old parser\n");
+
+	CMapEntityIndex index;
+
+	if (!index.Parse(m_Lump.c_str()))
+		FatalError(std::string("Parsing failed: ") + index.GetError());
+
+	for (const std::string &name : m_Classnames)
+	{
+		Position expected = OldFindEntity(m_Lump.c_str(), name.c_str());
+		Position pos = IndexFindEntity(index, name.c_str());
+
+		if (expected.found != pos.found || expected.origin != pos.origin || expected.angles != pos.angles)
+			FatalError("Lookup of " + name + " is different");
+	}
+
+	fprintf(stderr, "%d entities, %zu bytes\n", index.GetEntityCount(), m_Lump.size());
+	fprintf(stderr, "Good\n\n");
+}
+
+void CMapEntitiesTest::TestErrors()
+{
+	fprintf(stderr, "Checking broken lumps\n");
+
+	const char *lumps[] = {
+		"{ \"classname\" \"light\" } \"key\"",
+		"{ \"classname\" \"light\" } { \"key\"",
+		"{ \"classname\" \"light\" } { \"key\" }",
+		"{ \"classname\" \"light\" } { \"key\" \"value\"",
+	};
+
+	for (const char *lump : lumps)
+	{
+		CMapEntityIndex index;
+
+		if (index.Parse(lump) || !index.GetError())
+			FatalError(std::string("Broken lump was parsed: ") + lump);
+
+		// Entities before the error are kept
+		if (index.FindByClassname("light") != std::vector<int> { 0 })
+			FatalError(std::string("Entity before the error was lost: ") + lump);
+	}
+
+	fprintf(stderr, "Good\n\n");
+}
+
+void CMapEntitiesTest::RunBenchmark()
+{
+	constexpr int LOOKUP_COUNT = 20;
+	const char *spectatorNames[] = { "trigger_camera", "info_player_start", "info_player_deathmatch", "info_player_coop" };
+
+	fprintf(stderr, "Benchmark: %d entities, %d spectator start lookups\n", ENTITY_COUNT, LOOKUP_COUNT);
+
+	int oldFound = 0;
+	int indexFound = 0;
+
+	auto t0 = std::chrono::steady_clock::now();
+
+	// CHudSpectator::SetSpectatorStartPosition
+	for (int i = 0; i < LOOKUP_COUNT; i++)
+	{
+		for (const char *name : spectatorNames)
+		{
+			if (OldFindEntity(m_Lump.c_str(), name).found)
+			{
+				oldFound++;
+				break;
+			}
+		}
+	}
+
+	auto t1 = std::chrono::steady_clock::now();
+
+	// Index is parsed once per map
+	CMapEntityIndex index;
+
+	for (int i = 0; i < LOOKUP_COUNT; i++)
+		index.Parse(m_Lump.c_str());
+
+	auto t2 = std::chrono::steady_clock::now();
+
+	for (int i = 0; i < LOOKUP_COUNT; i++)
+	{
+		for (const char *name : spectatorNames)
+		{
+			if (IndexFindEntity(index, name).found)
+			{
+				indexFound++;
+				break;
+			}
+		}
+	}
+
+	auto t3 = std::chrono::steady_clock::now();
+
+	if (oldFound != indexFound)
+		FatalError("Benchmark results don't match");
+
+	auto ms = [](auto a, auto b) { return std::chrono::duration<double, std::milli>(b - a).count(); };
+	fprintf(stderr, "Old lookup:   %8.3f ms\n", ms(t0, t1) / LOOKUP_COUNT);
+	fprintf(stderr, "Index parse:  %8.3f ms\n", ms(t1, t2) / LOOKUP_COUNT);
+	fprintf(stderr, "Index lookup: %8.3f ms\n", ms(t2, t3) / LOOKUP_COUNT);
+}
@@ -0,0 +1,436 @@
+//
+// MOTD chunk cache test.
+//
+// Checks that CMotdText gives the same chunks as the old Send*MOTDToClient
+// loops for ASCII text, that chunk boundaries never split UTF-8 sequences
+// and that CMotdQueue keeps clients within the byte budget.
+//
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+#include <motd_cache.h>
+
+namespace
+{
+
+constexpr int MAX_MOTD_LENGTH = 1536;
+constexpr int MAX_UNICODE_MOTD_LENGTH = MAX_MOTD_LENGTH * 2;
+constexpr int BENCH_ITERATIONS = 20000;
+
+struct Chunk
+{
+	bool isLast;
+	std::string text;
+};
+
+// Old CHalfLifeMultiplay::SendMOTDToClient with messages collected into a vector
+std::vector<Chunk> OldSplit(char *string, int maxLength)
+{
+	constexpr int MAX_MOTD_CHUNK = 60;
+	std::vector<Chunk> chunks;
+	int char_count = 0;
+	char *pFileList = string;
+
+	while (pFileList && *pFileList && char_count < maxLength)
+	{
+		char chunk[MAX_MOTD_CHUNK + 1];
+
+		if (strlen(pFileList) < MAX_MOTD_CHUNK)
+		{
+			strcpy(chunk, pFileList);
+		}
+		else
+		{
+			strncpy(chunk, pFileList, MAX_MOTD_CHUNK);
+			chunk[MAX_MOTD_CHUNK] = 0; // strncpy doesn't always append the null terminator
+		}
+
+		char_count += strlen(chunk);
+		if (char_count < maxLength)
+			pFileList = string + char_count;
+		else
+			*pFileList = 0;
+
+		chunks.push_back({ *pFileList ? false : true, chunk });
+	}
+
+	return chunks;
+}
+
+// Code points of different UTF-8 lengths
+const char *s_Utf8Pieces[] = {
+	"a", " ", "<br>", "\n", "<b>Welcome</b>",
+	"\xc3\xa9", // e acute
+	"\xd0\x9f\xd1\x80\xd0\xb8\xd0\xb2\xd0\xb5\xd1\x82", // Cyrillic
+	"\xe4\xbd\xa0\xe5\xa5\xbd", // CJK
+	"\xe2\x82\xac", // Euro sign
+	"\xf0\x9f\x98\x80", // Emoji
+	"\xf0\x9f\x8e\xae\xf0\x9f\x94\xab",
+};
+
+int SequenceLength(unsigned char c)
+{
+	if (c < 0x80)
+		return 1;
+	if ((c & 0xE0) == 0xC0)
+		return 2;
+	if ((c & 0xF0) == 0xE0)
+		return 3;
+	if ((c & 0xF8) == 0xF0)
+		return 4;
+	return -1;
+}
+
+/**
+ * Returns whether text consists of complete UTF-8 sequences.
+ */
+bool IsCompleteUtf8(const char *text, int length)
+{
+	int i = 0;
+
+	while (i < length)
+	{
+		int len = SequenceLength(text[i]);
+
+		if (len < 0 || i + len > length)
+			return false;
+
+		for (int j = 1; j < len; j++)
+		{
+			if ((text[i + j] & 0xC0) != 0x80)
+				return false;
+		}
+
+		i += len;
+	}
+
+	return true;
+}
+
+}
+
+class CMotdCacheTest
+{
+public:
+	int Run();
+	[[noreturn]] void FatalError(const std::string &msg);
+
+private:
+	std::mt19937 m_Rng { 1234 };
+
+	std::string RandomAscii(int length);
+	std::string RandomUtf8(int length);
+
+	void CheckSplit(const std::string &text, int maxLength, bool isUtf8);
+	void TestAscii();
+	void TestUtf8();
+	void TestInvalidUtf8();
+	void TestQueue();
+	void RunBenchmark();
+};
+
+int main()
+{
+	CMotdCacheTest test;
+	return test.Run();
+}
+
+int CMotdCacheTest::Run()
+{
+	TestAscii();
+	TestUtf8();
+	TestInvalidUtf8();
+	TestQueue();
+	RunBenchmark();
+	return 0;
+}
+
+void CMotdCacheTest::FatalError(const std::string &msg)
+{
+	fprintf(stderr, "Fatal Error: %s\n", msg.c_str());
+	exit(1);
+}
+
+std::string CMotdCacheTest::RandomAscii(int length)
+{
+	std::string text;
+
+	for (int i = 0; i < length; i++)
+		text += (char)(' ' + m_Rng() % 95);
+
+	return text;
+}
+
+std::string CMotdCacheTest::RandomUtf8(int length)
+{
+	std::string text;
+
+	while ((int)text.size() < length)
+		text += s_Utf8Pieces[m_Rng() % std::size(s_Utf8Pieces)];
+
+	return text;
+}
+
+void CMotdCacheTest::CheckSplit(const std::string &text, int maxLength, bool isUtf8)
+{
+	CMotdText motd;
+	motd.Split(text.c_str(), maxLength);
+
+	std::string joined;
+	int lastLength = 0;
+
+	for (int i = 0; i < motd.GetChunkCount(); i++)
+	{
+		const char *chunk = motd.GetChunk(i);
+		int len = motd.GetChunkLength(i);
+
+		if (len < 1 || len > CMotdText::MAX_CHUNK || (int)strlen(chunk) != len)
+			FatalError("Wrong chunk length " + std::to_string(len));
+
+		if (isUtf8 && !IsCompleteUtf8(chunk, len))
+			FatalError("Chunk " + std::to_string(i) + " splits a UTF-8 sequence: " + chunk);
+
+		joined += chunk;
+		lastLength = len;
+	}
+
+	if (joined != text.substr(0, joined.size()))
+		FatalError("Chunks are not a prefix of the text");
+
+	if ((int)joined.size() != motd.GetLength())
+		FatalError("Wrong total length");
+
+	// Same limit as the old loop: chunks are added while the total is below the limit
+	bool isComplete = joined.size() == text.size();
+	bool isLimited = (int)joined.size() >= maxLength && (int)joined.size() - lastLength < maxLength;
+
+	if (!isComplete && !isLimited)
+		FatalError("Text is cut at " + std::to_string(joined.size()) + " of " + std::to_string(text.size()));
+}
+
+void CMotdCacheTest::TestAscii()
+{
+	fprintf(stderr, "Checking ASCII text against the old loop\n");
+
+	for (int maxLength : { MAX_MOTD_LENGTH, MAX_UNICODE_MOTD_LENGTH })
+	{
+		for (int length = 0; length < 4000; length += 1 + m_Rng() % 37)
+		{
+			std::string text = RandomAscii(length);
+			std::vector<char> buf(text.begin(), text.end());
+			buf.push_back('\0');
+
+			std::vector<Chunk> old = OldSplit(buf.data(), maxLength);
+			CMotdText motd;
+			motd.Split(text.c_str(), maxLength);
+
+			if ((int)old.size() != motd.GetChunkCount())
+				FatalError("Chunk count differs for length " + std::to_string(length));
+
+			for (size_t i = 0; i < old.size(); i++)
+			{
+				bool isLast = (int)i == motd.GetChunkCount() - 1;
+
+				if (old[i].text != motd.GetChunk(i) || old[i].isLast != isLast)
+					FatalError("Chunk " + std::to_string(i) + " differs for length " + std::to_string(length));
+			}
+
+			CheckSplit(text, maxLength, true);
+		}
+	}
+
+	fprintf(stderr, "Good\n\n");
+}
+
+void CMotdCacheTest::TestUtf8()
+{
+	fprintf(stderr, "Checking UTF-8 chunk boundaries\n");
+
+	int splits = 0;
+
+	for (int maxLength : { MAX_MOTD_LENGTH, MAX_UNICODE_MOTD_LENGTH })
+	{
+		for (int it = 0; it < 2000; it++)
+		{
+			CheckSplit(RandomUtf8(m_Rng() % 4000), maxLength, true);
+			splits++;
+		}
+
+		// Every offset of a multi-byte sequence at the chunk boundary
+		for (int prefix = 0; prefix < 8; prefix++)
+		{
+			for (const char *piece : s_Utf8Pieces)
+			{
+				std::string text = RandomAscii(CMotdText::MAX_CHUNK - prefix);
+
+				while ((int)text.size() < maxLength + 100)
+					text += piece;
+
+				CheckSplit(text, maxLength, true);
+				splits++;
+			}
+		}
+	}
+
+	fprintf(stderr, "%d texts checked\n", splits);
+	fprintf(stderr, "Good\n\n");
+}
+
+void CMotdCacheTest::TestInvalidUtf8()
+{
+	fprintf(stderr, "Checking invalid UTF-8\n");
+
+	// Runs of continuation bytes and truncated sequences must not stall or give empty chunks
+	std::string texts[] = {
+		std::string(200, '\x80'),
+		RandomAscii(59) + std::string(100, '\xBF'),
+		RandomAscii(58) + "\xf0\x9f" + RandomAscii(100),
+		"\xe2\x82" + RandomAscii(200),
+	};
+
+	for (const std::string &text : texts)
+		CheckSplit(text, MAX_UNICODE_MOTD_LENGTH, false);
+
+	fprintf(stderr, "Good\n\n");
+}
+
+void CMotdCacheTest::TestQueue()
+{
+	fprintf(stderr, "Checking paced delivery\n");
+
+	auto html = std::make_shared<CMotdText>();
+	std::string htmlText = RandomUtf8(MAX_UNICODE_MOTD_LENGTH);
+	html->Split(htmlText.c_str(), MAX_UNICODE_MOTD_LENGTH);
+
+	auto plain = std::make_shared<CMotdText>();
+	std::string plainText = RandomAscii(500);
+	plain->Split(plainText.c_str(), MAX_MOTD_LENGTH);
+
+	for (float frametime : { 0.001f, 0.01f, 0.05f })
+	{
+		CMotdQueue queue;
+		std::string received[CMotdQueue::MAX_CLIENTS + 1];
+		int lastCount[CMotdQueue::MAX_CLIENTS + 1] = {};
+		std::vector<std::pair<float, int>> sent; // Time and bytes sent to client 1
+
+		queue.Push(1, 1, html);
+		queue.Push(1, 2, plain);
+		queue.Push(5, 1, html);
+		queue.Push(32, 2, plain);
+		queue.Push(33, 2, plain); // Invalid client
+		queue.Push(7, 1, html);
+		queue.Clear(7);
+
+		if (!queue.IsPending(1) || queue.IsPending(7) || queue.IsPending(33))
+			FatalError("Wrong pending state after Push");
+
+		float time = 0;
+		int frames = 0;
+
+		while ((queue.IsPending(1) || queue.IsPending(5) || queue.IsPending(32)) && frames < 100000)
+		{
+			time += frametime;
+			frames++;
+
+			queue.Update(frametime, [&](int client, int msgType, bool isLast, const char *chunk) {
+				if (client == 7)
+					FatalError("Cleared client got a chunk");
+
+				// Client 1 gets html (type 1) and then plain (type 2)
+				if (client == 1 && msgType != ((int)received[1].size() < html->GetLength() ? 1 : 2))
+					FatalError("Wrong order of queued MOTDs");
+
+				received[client] += chunk;
+
+				if (isLast)
+					lastCount[client]++;
+
+				if (client == 1)
+					sent.push_back({ time, (int)strlen(chunk) + CMotdQueue::MESSAGE_OVERHEAD });
+			});
+		}
+
+		std::string expected1;
+		for (int i = 0; i < html->GetChunkCount(); i++)
+			expected1 += html->GetChunk(i);
+		std::string expectedHtml = expected1;
+		expected1 += plainText;
+
+		if (received[1] != expected1 || lastCount[1] != 2)
+			FatalError("Client 1 got wrong MOTDs");
+
+		if (received[5] != expectedHtml || lastCount[5] != 1)
+			FatalError("Client 5 got wrong MOTD");
+
+		if (received[32] != plainText || lastCount[32] != 1)
+			FatalError("Client 32 got wrong MOTD");
+
+		// Bytes sent in any time window fit into the budget
+		for (size_t i = 0; i < sent.size(); i++)
+		{
+			int bytes = 0;
+
+			for (size_t j = i; j < sent.size(); j++)
+			{
+				bytes += sent[j].second;
+				float window = sent[j].first - sent[i].first + frametime;
+
+				if (bytes > CMotdQueue::MAX_BURST + CMotdQueue::BYTES_PER_SECOND * window)
+					FatalError("Budget exceeded with frametime " + std::to_string(frametime));
+			}
+		}
+
+		fprintf(stderr, "Frame time %5.3f: %d bytes sent to a client in %d frames (%.2f s)\n", frametime,
+		    (int)received[1].size(), frames, time);
+	}
+
+	fprintf(stderr, "Good\n\n");
+}
+
+void CMotdCacheTest::RunBenchmark()
+{
+	fprintf(stderr, "Benchmark (%d HTML MOTDs)\n", BENCH_ITERATIONS);
+
+	using Clock = std::chrono::high_resolution_clock;
+	std::string text = RandomUtf8(MAX_UNICODE_MOTD_LENGTH + 500);
+	std::vector<char> buf;
+	volatile size_t sink = 0;
+
+	CMotdText motd;
+	motd.Split(text.c_str(), MAX_UNICODE_MOTD_LENGTH);
+
+	auto start = Clock::now();
+
+	for (int it = 0; it < BENCH_ITERATIONS; it++)
+	{
+		// Old loop also modifies the text, so it needs a fresh copy like a new file read
+		buf.assign(text.begin(), text.end());
+		buf.push_back('\0');
+
+		for (const Chunk &chunk : OldSplit(buf.data(), MAX_UNICODE_MOTD_LENGTH))
+			sink += chunk.text.size();
+	}
+
+	auto mid = Clock::now();
+
+	for (int it = 0; it < BENCH_ITERATIONS; it++)
+	{
+		for (int i = 0; i < motd.GetChunkCount(); i++)
+			sink += strlen(motd.GetChunk(i));
+	}
+
+	auto end = Clock::now();
+
+	double old = std::chrono::duration<double, std::micro>(mid - start).count() / BENCH_ITERATIONS;
+	double cached = std::chrono::duration<double, std::micro>(end - mid).count() / BENCH_ITERATIONS;
+
+	fprintf(stderr, "Split on every send (without file read): %6.2f us\n", old);
+	fprintf(stderr, "Cached chunks:                           %6.2f us\n", cached);
+	fprintf(stderr, "Speedup: %.1fx\n", old / cached);
+}
@@ -0,0 +1,692 @@
+//
+// A2S_RULES query client test.
+//
+// Runs a stand-in server on a local UDP port and checks challenge handling,
+// split packet reassembly and rules parsing of CNetQuery.
+// Then compares round trip and rule lookup times with the old code.
+//
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include <net_query.h>
+
+namespace
+{
+
+using Clock = std::chrono::high_resolution_clock;
+
+constexpr int CHALLENGE = 0x1234ABCD;
+constexpr int SPLIT_PAYLOAD = 1400 - 9;
+constexpr int BENCH_QUERIES = 2000;
+constexpr int BENCH_LOOKUPS = 20000;
+
+unsigned long LoopbackAddr()
+{
+	const unsigned char bytes[4] = { 127, 0, 0, 1 };
+	uint32_t addr;
+	memcpy(&addr, bytes, sizeof(addr));
+	return addr;
+}
+
+int ToNetPort(int port)
+{
+	const unsigned char bytes[2] = { (unsigned char)(port >> 8), (unsigned char)port };
+	uint16_t netPort;
+	memcpy(&netPort, bytes, sizeof(netPort));
+	return netPort;
+}
+
+// Old NetGetRuleValueFromBuffer
+const char *OldGetRuleValue(const char *buffer, int len, const char *cvar)
+{
+	// Check response header
+	if (len < 6 || (*(unsigned int *)buffer != 0xFFFFFFFF || buffer[4] != 'E'))
+		return NULL;
+	// Search for a cvar
+	char *current = (char *)buffer + 4;
+	char *end = (char *)buffer + len - strlen(cvar);
+	while (current < end)
+	{
+		char *pcvar = (char *)cvar;
+		while (*current == *pcvar && *pcvar != 0)
+		{
+			current++;
+			pcvar++;
+		}
+		if (*pcvar == 0)
+		{
+			// Found
+			return current + 1;
+		}
+		current++;
+	}
+	return NULL;
+}
+
+}
+
+/**
+ * Answers A2S_RULES requests on a local port.
+ */
+class CStandInServer
+{
+public:
+	bool useChallenge = false;
+	bool shuffleParts = false;
+	bool duplicateParts = false;
+	std::atomic<bool> isSilent { false };
+	int splitPayload = SPLIT_PAYLOAD;
+	std::vector<char> response;
+
+	std::atomic<int> requestCount { 0 };
+
+	~CStandInServer() { Stop(); }
+
+	bool Start()
+	{
+		m_Socket = NetOpenUdpSocket();
+
+		if (!m_Socket)
+			return false;
+
+		m_bStop = false;
+		m_Thread = std::thread([this]() { ThreadFunc(); });
+		return true;
+	}
+
+	void Stop()
+	{
+		if (!m_Thread.joinable())
+			return;
+
+		m_bStop = true;
+		m_Thread.join();
+		NetCloseSocket(m_Socket);
+		m_Socket = 0;
+	}
+
+	int GetNetPort() { return ToNetPort(NetGetSocketPort(m_Socket)); }
+
+	/**
+	 * Builds a rules response from name-value pairs.
+	 */
+	void SetRules(const std::vector<std::pair<std::string, std::string>> &rules)
+	{
+		response.assign({ '\xFF', '\xFF', '\xFF', '\xFF', 'E', (char)(rules.size() & 0xFF), (char)(rules.size() >> 8) });
+
+		for (auto &i : rules)
+		{
+			response.insert(response.end(), i.first.c_str(), i.first.c_str() + i.first.size() + 1);
+			response.insert(response.end(), i.second.c_str(), i.second.c_str() + i.second.size() + 1);
+		}
+	}
+
+private:
+	NetSocket m_Socket = 0;
+	std::thread m_Thread;
+	std::atomic<bool> m_bStop { false };
+	std::mt19937 m_Rng { 42 };
+	int m_iResponseID = 1;
+	std::vector<char> m_LastPart;
+
+	void ThreadFunc()
+	{
+		char buffer[2048];
+
+		while (!m_bStop)
+		{
+			unsigned long addr;
+			int port;
+			int len = NetWaitReceiveUdp(m_Socket, buffer, sizeof(buffer), &addr, &port, 10);
+
+			if (len != 9 || buffer[4] != 'V')
+				continue;
+
+			requestCount++;
+
+			if (isSilent)
+				continue;
+
+			int challenge;
+			memcpy(&challenge, buffer + 5, sizeof(challenge));
+
+			if (useChallenge && challenge != CHALLENGE)
+			{
+				char reply[9] = { '\xFF', '\xFF', '\xFF', '\xFF', 'A' };
+				memcpy(reply + 5, &CHALLENGE, sizeof(CHALLENGE));
+				Send(addr, port, reply, sizeof(reply));
+				continue;
+			}
+
+			SendResponse(addr, port);
+		}
+	}
+
+	void Send(unsigned long addr, int port, const char *data, int len)
+	{
+		NetSocket s = m_Socket;
+		NetSendUdp(addr, port, data, len, &s);
+	}
+
+	void SendResponse(unsigned long addr, int port)
+	{
+		if ((int)response.size() <= splitPayload)
+		{
+			Send(addr, port, response.data(), (int)response.size());
+			return;
+		}
+
+		int total = ((int)response.size() + splitPayload - 1) / splitPayload;
+		std::vector<std::vector<char>> packets;
+
+		for (int i = 0; i < total; i++)
+		{
+			std::vector<char> packet = { '\xFE', '\xFF', '\xFF', '\xFF' };
+			packet.insert(packet.end(), (char *)&m_iResponseID, (char *)&m_iResponseID + 4);
+			packet.push_back((char)((i << 4) | total));
+
+			auto begin = response.begin() + i * splitPayload;
+			auto end = response.begin() + std::min((int)response.size(), (i + 1) * splitPayload);
+			packet.insert(packet.end(), begin, end);
+			packets.push_back(packet);
+		}
+
+		m_iResponseID++;
+
+		if (shuffleParts)
+			std::shuffle(packets.begin(), packets.end(), m_Rng);
+
+		// A late duplicate of the previous response always comes first, the
+		// query for it is finished or restarted by then
+		if (duplicateParts && !m_LastPart.empty())
+			packets.insert(packets.begin(), m_LastPart);
+
+		if (duplicateParts)
+		{
+			m_LastPart = packets.back();
+			packets.push_back(packets.back());
+		}
+
+		for (auto &i : packets)
+			Send(addr, port, i.data(), (int)i.size());
+	}
+};
+
+class CNetQueryTest
+{
+public:
+	int Run();
+	[[noreturn]] void FatalError(const std::string &msg);
+
+private:
+	std::vector<std::pair<std::string, std::string>> MakeRules(int extraCount);
+
+	/**
+	 * Queries the server and waits for the result.
+	 */
+	CNetQuery::Result Query(CNetQuery &query, CStandInServer &server);
+
+	void CheckRules(const CNetRules &rules, int extraCount);
+	void TestParser();
+	void TestSplitPacket();
+	void TestQueries();
+	void TestTimeout();
+	void RunBenchmark();
+};
+
+int main()
+{
+	CNetQueryTest test;
+	return test.Run();
+}
+
+int CNetQueryTest::Run()
+{
+	TestParser();
+	TestSplitPacket();
+	TestQueries();
+	TestTimeout();
+	RunBenchmark();
+	return 0;
+}
+
+void CNetQueryTest::FatalError(const std::string &msg)
+{
+	fprintf(stderr, "Fatal Error: %s\n", msg.c_str());
+	exit(1);
+}
+
+std::vector<std::pair<std::string, std::string>> CNetQueryTest::MakeRules(int extraCount)
+{
+	// Order like on a server: game cvars first, plugins register theirs later
+	std::vector<std::pair<std::string, std::string>> rules = {
+		{ "xmp_timelimit", "99" }, // Name containing a wanted name
+		{ "mp_timelimit", "25" },
+		{ "mp_timeleft", "1234" },
+		{ "sv_empty", "" },
+	};
+
+	for (int i = 0; i < extraCount; i++)
+	{
+		if (i == extraCount / 2)
+			rules.push_back({ "sv_ag_version", "6.6" });
+
+		rules.push_back({ "sv_rule_" + std::to_string(i), "value_" + std::to_string(i * 7) });
+	}
+
+	if (extraCount == 0)
+		rules.push_back({ "sv_ag_version", "6.6" });
+
+	rules.push_back({ "amx_nextmap", "crossfire" });
+
+	return rules;
+}
+
+CNetQuery::Result CNetQueryTest::Query(CNetQuery &query, CStandInServer &server)
+{
+	if (!query.QueryRules(LoopbackAddr(), server.GetNetPort()))
+		FatalError("QueryRules failed");
+
+	CNetQuery::Result result;
+	auto timeout = Clock::now() + std::chrono::seconds(10);
+
+	while (!query.GetResult(result))
+	{
+		if (Clock::now() > timeout)
+			FatalError("No result");
+
+		std::this_thread::sleep_for(std::chrono::microseconds(100));
+	}
+
+	if (result.addr != LoopbackAddr() || result.port != server.GetNetPort())
+		FatalError("Result has wrong address");
+
+	return result;
+}
+
+void CNetQueryTest::CheckRules(const CNetRules &rules, int extraCount)
+{
+	auto expect = [&](const char *name, const char *expected) {
+		const char *value = rules.GetValue(name);
+
+		if (!expected ? value != nullptr : !value || strcmp(value, expected))
+			FatalError(std::string("Wrong value of ") + name + ": " + (value ? value : "(null)"));
+	};
+
+	expect("mp_timelimit", "25");
+	expect("mp_timeleft", "1234");
+	expect("sv_ag_version", "6.6");
+	expect("amx_nextmap", "crossfire");
+	expect("sv_empty", "");
+	expect("timelimit", nullptr);
+	expect("sv_missing", nullptr);
+
+	if (extraCount > 0)
+		expect(("sv_rule_" + std::to_string(extraCount - 1)).c_str(), ("value_" + std::to_string((extraCount - 1) * 7)).c_str());
+
+	if (rules.GetCount() != 6 + extraCount)
+		FatalError("Wrong rule count " + std::to_string(rules.GetCount()));
+}
+
+void CNetQueryTest::TestParser()
+{
+	fprintf(stderr, "Checking rules parser\n");
+
+	CStandInServer server;
+	server.SetRules(MakeRules(10));
+
+	CNetRules rules;
+
+	if (!rules.Parse(server.response.data(), (int)server.response.size()))
+		FatalError("Parse failed");
+
+	CheckRules(rules, 10);
+
+	// Truncated response keeps complete rules
+	if (!rules.Parse(server.response.data(), 40) || rules.GetCount() < 1 || rules.GetValue("mp_timeleft"))
+		FatalError("Truncated response parsed wrong");
+
+	// Other responses
+	const char info[] = "\xFF\xFF\xFF\xFFmsome info";
+	const char split[] = "\xFE\xFF\xFF\xFF\x01\x00\x00\x00\x02";
+
+	if (rules.Parse(info, sizeof(info)) || rules.Parse(split, sizeof(split)) || rules.Parse(info, 3) || rules.GetCount() != 0)
+		FatalError("Wrong response accepted");
+
+	fprintf(stderr, "Good\n\n");
+}
+
+void CNetQueryTest::TestSplitPacket()
+{
+	fprintf(stderr, "Checking split packet reassembly\n");
+
+	std::string payload;
+
+	for (int i = 0; i < 3000; i++)
+		payload += (char)('a' + i % 26);
+
+	auto makePart = [&](int id, int current, int total, int begin, int end) {
+		std::string packet = "\xFE\xFF\xFF\xFF";
+		packet.append((char *)&id, 4);
+		packet += (char)((current << 4) | total);
+		packet += payload.substr(begin, end - begin);
+		return packet;
+	};
+
+	// Parts of different sizes in any order, with duplicates and a foreign part
+	std::string parts[] = {
+		makePart(7, 2, 3, 2000, 3000),
+		makePart(7, 0, 3, 0, 1391),
+		makePart(8, 1, 3, 0, 100),
+		makePart(7, 0, 3, 0, 1391),
+		makePart(7, 1, 3, 1391, 2000),
+	};
+
+	CNetSplitPacket split;
+
+	for (int i = 0; i < 5; i++)
+	{
+		CNetSplitPacket::Status status = split.Add(parts[i].data(), (int)parts[i].size());
+		CNetSplitPacket::Status expected = i < 4 ? CNetSplitPacket::Status::Incomplete : CNetSplitPacket::Status::Complete;
+
+		if (status != expected)
+			FatalError("Wrong status of part " + std::to_string(i));
+	}
+
+	if (std::string(split.GetData().begin(), split.GetData().end()) != payload)
+		FatalError("Wrong reassembled data");
+
+	// Query restarted after the first part of response 7, late parts of 7 come
+	// before, between and after the parts of the new response 8
+	std::string restarted[] = {
+		makePart(7, 0, 3, 0, 1391),
+		makePart(8, 2, 3, 2000, 3000),
+		makePart(7, 2, 3, 2000, 3000),
+		makePart(8, 0, 3, 0, 1391),
+		makePart(7, 0, 3, 0, 1391),
+		makePart(8, 1, 3, 1391, 2000),
+	};
+
+	split.Reset();
+	split.Add(parts[1].data(), (int)parts[1].size());
+	split.Reset();
+
+	for (int i = 0; i < 6; i++)
+	{
+		CNetSplitPacket::Status status = split.Add(restarted[i].data(), (int)restarted[i].size());
+		CNetSplitPacket::Status expected = i < 5 ? CNetSplitPacket::Status::Incomplete : CNetSplitPacket::Status::Complete;
+
+		if (status != expected)
+			FatalError("Wrong status of part " + std::to_string(i) + " after restart");
+	}
+
+	if (std::string(split.GetData().begin(), split.GetData().end()) != payload)
+		FatalError("Wrong reassembled data after restart");
+
+	// Duplicate of a completed response doesn't block the next one
+	split.Reset();
+
+	if (split.Add(restarted[4].data(), (int)restarted[4].size()) != CNetSplitPacket::Status::Incomplete)
+		FatalError("Duplicate part of a completed response");
+
+	for (int i = 0; i < 3; i++)
+	{
+		std::string part = makePart(9, i, 3, i * 1000, (i + 1) * 1000);
+
+		if (split.Add(part.data(), (int)part.size()) != (i < 2 ? CNetSplitPacket::Status::Incomplete : CNetSplitPacket::Status::Complete))
+			FatalError("Wrong status of part " + std::to_string(i) + " after a duplicate");
+	}
+
+	if (std::string(split.GetData().begin(), split.GetData().end()) != payload)
+		FatalError("Wrong reassembled data after a duplicate");
+
+	// Same ID with a different part count
+	split.Reset();
+	split.Add(parts[2].data(), (int)parts[2].size());
+
+	for (int i = 0; i < 2; i++)
+	{
+		std::string part = makePart(8, i, 2, i * 1500, (i + 1) * 1500);
+
+		if (split.Add(part.data(), (int)part.size()) != (i < 1 ? CNetSplitPacket::Status::Incomplete : CNetSplitPacket::Status::Complete))
+			FatalError("Wrong status of part " + std::to_string(i) + " with a new part count");
+	}
+
+	if (std::string(split.GetData().begin(), split.GetData().end()) != payload)
+		FatalError("Wrong reassembled data with a new part count");
+
+	// Broken parts
+	std::string broken = makePart(9, 3, 3, 0, 10);
+	split.Reset();
+
+	if (split.Add(broken.data(), (int)broken.size()) != CNetSplitPacket::Status::Invalid || split.Add("\xFF\xFF", 2) != CNetSplitPacket::Status::Invalid)
+		FatalError("Broken part accepted");
+
+	fprintf(stderr, "Good\n\n");
+}
+
+void CNetQueryTest::TestQueries()
+{
+	fprintf(stderr, "Checking queries to a stand-in server\n");
+
+	struct Case
+	{
+		const char *name;
+		int extraCount;
+		bool useChallenge;
+		bool shuffleParts;
+		bool duplicateParts;
+	};
+
+	const Case cases[] = {
+		{ "single packet", 10, false, false, false },
+		{ "challenge", 10, true, false, false },
+		{ "split", 400, false, false, false },
+		{ "split with challenge", 400, true, false, false },
+		{ "split shuffled", 400, true, true, false },
+		{ "split duplicated", 400, false, true, true },
+	};
+
+	CNetQuery query;
+
+	for (const Case &i : cases)
+	{
+		CStandInServer server;
+		server.SetRules(MakeRules(i.extraCount));
+		server.useChallenge = i.useChallenge;
+		server.shuffleParts = i.shuffleParts;
+		server.duplicateParts = i.duplicateParts;
+
+		if (!server.Start())
+			FatalError("Can't open server socket");
+
+		// Several times to check that query state is reset
+		for (int j = 0; j < 3; j++)
+		{
+			CNetQuery::Result result = Query(query, server);
+
+			if (result.isTimedOut)
+				FatalError(std::string("Query timed out: ") + i.name);
+
+			CheckRules(result.rules, i.extraCount);
+		}
+
+		fprintf(stderr, "%-22s %5d bytes, %d requests\n", i.name, (int)server.response.size(), server.requestCount.load());
+	}
+
+	// Answers are matched to their servers
+	CStandInServer server, fake;
+	server.SetRules(MakeRules(10));
+	fake.SetRules(MakeRules(0));
+
+	if (!server.Start() || !fake.Start())
+		FatalError("Can't open server socket");
+
+	server.isSilent = true;
+	query.QueryRules(LoopbackAddr(), server.GetNetPort());
+	query.QueryRules(LoopbackAddr(), fake.GetNetPort());
+
+	CNetQuery::Result result;
+	auto timeout = Clock::now() + std::chrono::seconds(5);
+
+	while (!query.GetResult(result) && Clock::now() < timeout)
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+	if (result.port != fake.GetNetPort() || result.rules.GetCount() != 6)
+		FatalError("Wrong result of the second server");
+
+	server.isSilent = false;
+	result = Query(query, server);
+	CheckRules(result.rules, 10);
+
+	query.Shutdown();
+
+	if (query.IsStarted() || query.GetResult(result))
+		FatalError("Query is not stopped");
+
+	fprintf(stderr, "Good\n\n");
+}
+
+void CNetQueryTest::TestTimeout()
+{
+	fprintf(stderr, "Checking timeout\n");
+
+	CStandInServer server;
+	server.isSilent = true;
+
+	if (!server.Start())
+		FatalError("Can't open server socket");
+
+	CNetQuery query;
+	auto start = Clock::now();
+	CNetQuery::Result result = Query(query, server);
+	float time = std::chrono::duration<float>(Clock::now() - start).count();
+
+	if (!result.isTimedOut || time < CNetQuery::TIMEOUT_MS / 1000.f || time > CNetQuery::TIMEOUT_MS / 1000.f + 1)
+		FatalError("Wrong timeout " + std::to_string(time));
+
+	fprintf(stderr, "Timed out in %.2f s\n", time);
+	fprintf(stderr, "Good\n\n");
+}
+
+void CNetQueryTest::RunBenchmark()
+{
+	fprintf(stderr, "Benchmark\n");
+
+	CStandInServer server;
+	server.SetRules(MakeRules(400));
+	server.useChallenge = true;
+
+	if (!server.Start())
+		FatalError("Can't open server socket");
+
+	CStandInServer smallServer;
+	smallServer.SetRules(MakeRules(10));
+
+	if (!smallServer.Start())
+		FatalError("Can't open server socket");
+
+	// Round trip with the old blocking call, one socket per request and no challenge reply
+	{
+		char buffer[2048];
+		auto start = Clock::now();
+
+		for (int i = 0; i < BENCH_QUERIES; i++)
+		{
+			if (NetSendReceiveUdp(LoopbackAddr(), smallServer.GetNetPort(), "\xFF\xFF\xFF\xFFV\xFF\xFF\xFF\xFF", 9, buffer, sizeof(buffer)) <= 0)
+				FatalError("NetSendReceiveUdp failed");
+		}
+
+		double time = std::chrono::duration<double, std::micro>(Clock::now() - start).count() / BENCH_QUERIES;
+		fprintf(stderr, "NetSendReceiveUdp, single packet:  %7.1f us per query, %6.0f queries/s\n", time, 1e6 / time);
+	}
+
+	// Same with the query client, and with challenge and 3-part reassembly
+	auto benchQuery = [&](CStandInServer &target, const char *name) {
+		CNetQuery query;
+		std::vector<float> rtts;
+		auto start = Clock::now();
+
+		for (int i = 0; i < BENCH_QUERIES; i++)
+		{
+			if (!query.QueryRules(LoopbackAddr(), target.GetNetPort()))
+				FatalError("QueryRules failed");
+
+			CNetQuery::Result result;
+
+			while (!query.GetResult(result))
+				std::this_thread::yield();
+
+			if (result.isTimedOut)
+				FatalError("Query timed out");
+
+			rtts.push_back(result.rtt * 1e6f);
+		}
+
+		double time = std::chrono::duration<double, std::micro>(Clock::now() - start).count() / BENCH_QUERIES;
+		std::sort(rtts.begin(), rtts.end());
+		fprintf(stderr, "%-34s %7.1f us per query, %6.0f queries/s (median rtt %.1f us, p99 %.1f us)\n",
+		    name, time, 1e6 / time, rtts[rtts.size() / 2], rtts[rtts.size() * 99 / 100]);
+	};
+
+	benchQuery(smallServer, "CNetQuery, single packet:");
+	benchQuery(server, "CNetQuery, challenge and 3 parts:");
+
+	// Rule lookups of the timer: old substring scan of the whole response for each cvar on the game thread,
+	// now the worker parses the response once and the game thread only does lookups
+	{
+		const char *names[] = { "mp_timelimit", "mp_timeleft", "sv_ag_version", "amx_nextmap" };
+		const std::vector<char> &response = server.response;
+		volatile size_t sink = 0;
+		CNetRules rules;
+
+		auto start = Clock::now();
+
+		for (int i = 0; i < BENCH_LOOKUPS; i++)
+		{
+			for (const char *name : names)
+			{
+				const char *value = OldGetRuleValue(response.data(), (int)response.size(), name);
+				sink += value ? value[0] : 0;
+			}
+		}
+
+		auto parseStart = Clock::now();
+
+		for (int i = 0; i < BENCH_LOOKUPS; i++)
+		{
+			rules.Parse(response.data(), (int)response.size());
+			sink += rules.GetCount();
+		}
+
+		auto lookupStart = Clock::now();
+
+		for (int i = 0; i < BENCH_LOOKUPS; i++)
+		{
+			for (const char *name : names)
+			{
+				const char *value = rules.GetValue(name);
+				sink += value ? value[0] : 0;
+			}
+		}
+
+		auto end = Clock::now();
+
+		double oldTime = std::chrono::duration<double, std::micro>(parseStart - start).count() / BENCH_LOOKUPS;
+		double parseTime = std::chrono::duration<double, std::micro>(lookupStart - parseStart).count() / BENCH_LOOKUPS;
+		double lookupTime = std::chrono::duration<double, std::micro>(end - lookupStart).count() / BENCH_LOOKUPS;
+
+		fprintf(stderr, "Rules of %d bytes, 4 lookups:\n", (int)response.size());
+		fprintf(stderr, "Substring scans (game thread): %7.2f us\n", oldTime);
+		fprintf(stderr, "Parse (worker thread):         %7.2f us\n", parseTime);
+		fprintf(stderr, "Lookups (game thread):         %7.2f us\n", lookupTime);
+		fprintf(stderr, "Speedup: %.1fx\n", oldTime / lookupTime);
+	}
+}
@@ -0,0 +1,307 @@
+//
+// Node graph routing table test and benchmark.
+//
+// Builds routes of a generated map graph with CNodeRouteBuilder and checks
+// that every decoded route is a shortest path using only links allowed
+// for its hull and capability, and that the result doesn't depend on
+// the number of threads.
+//
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+#include <node_routes.h>
+
+class CNodeRoutesTest
+{
+public:
+	int Run();
+	[[noreturn]] void FatalError(const std::string &msg);
+
+private:
+	struct Link
+	{
+		int dest;
+		float weight;
+		unsigned tables;
+	};
+
+	// A map of GRID_SIZE x GRID_SIZE nodes like a maze of rooms
+	static constexpr int GRID_SIZE = 32;
+	static constexpr int NODE_COUNT = GRID_SIZE * GRID_SIZE; // MAX_NODES
+
+	std::vector<std::vector<Link>> m_Links;
+
+	void CreateMapGraph(unsigned seed);
+	void FillGraph(CNodeRouteGraph &graph);
+	std::vector<float> FindDistances(int iFrom, int iTable);
+
+	void TestRoutes();
+	void TestThreads();
+	void TestHash();
+	void RunBenchmark();
+};
+
+int main()
+{
+	CNodeRoutesTest test;
+	return test.Run();
+}
+
+int CNodeRoutesTest::Run()
+{
+	CreateMapGraph(1234);
+
+	TestRoutes();
+	TestThreads();
+	TestHash();
+	RunBenchmark();
+	return 0;
+}
+
+void CNodeRoutesTest::FatalError(const std::string &msg)
+{
+	fprintf(stderr, "Fatal Error: %s\n", msg.c_str());
+	exit(1);
+}
+
+void CNodeRoutesTest::CreateMapGraph(unsigned seed)
+{
+	std::mt19937 rng(seed);
+	std::uniform_real_distribution<float> jitter(0.0f, 16.0f);
+
+	m_Links.assign(NODE_COUNT, {});
+
+	for (int y = 0; y < GRID_SIZE; y++)
+	{
+		for (int x = 0; x < GRID_SIZE; x++)
+		{
+			for (int dy = -1; dy <= 1; dy++)
+			{
+				for (int dx = -1; dx <= 1; dx++)
+				{
+					int nx = x + dx;
+					int ny = y + dy;
+
+					if ((dx == 0 && dy == 0) || nx < 0 || ny < 0 || nx >= GRID_SIZE || ny >= GRID_SIZE)
+						continue;
+
+					// Walls
+					if (rng() % 4 == 0)
+						continue;
+
+					Link link;
+					link.dest = ny * GRID_SIZE + nx;
+					link.weight = 128.0f * std::sqrt((float)(dx * dx + dy * dy)) + jitter(rng);
+					link.tables = 0;
+
+					// Smaller hulls fit through more links
+					int size = rng() % 10;
+					bool isDoor = rng() % 20 == 0;
+
+					for (int iHull = 0; iHull < CNodeRouteGraph::NUM_HULLS; iHull++)
+					{
+						if (size < 10 - iHull * 3)
+						{
+							link.tables |= 1 << CNodeRouteGraph::TableIndex(iHull, 1);
+
+							if (!isDoor)
+								link.tables |= 1 << CNodeRouteGraph::TableIndex(iHull, 0);
+						}
+					}
+
+					m_Links[y * GRID_SIZE + x].push_back(link);
+				}
+			}
+		}
+	}
+}
+
+void CNodeRoutesTest::FillGraph(CNodeRouteGraph &graph)
+{
+	graph.Clear();
+
+	for (const std::vector<Link> &links : m_Links)
+	{
+		graph.AddNode();
+
+		for (const Link &link : links)
+			graph.AddLink(link.dest, link.weight, link.tables);
+	}
+}
+
+std::vector<float> CNodeRoutesTest::FindDistances(int iFrom, int iTable)
+{
+	// Plain O(n^2) Dijkstra
+	std::vector<float> dist(NODE_COUNT, INFINITY);
+	std::vector<bool> visited(NODE_COUNT, false);
+	dist[iFrom] = 0;
+
+	for (;;)
+	{
+		int best = -1;
+
+		for (int i = 0; i < NODE_COUNT; i++)
+		{
+			if (!visited[i] && dist[i] != INFINITY && (best == -1 || dist[i] < dist[best]))
+				best = i;
+		}
+
+		if (best == -1)
+			break;
+
+		visited[best] = true;
+
+		for (const Link &link : m_Links[best])
+		{
+			if ((link.tables & (1 << iTable)) && dist[best] + link.weight < dist[link.dest])
+				dist[link.dest] = dist[best] + link.weight;
+		}
+	}
+
+	return dist;
+}
+
+void CNodeRoutesTest::TestRoutes()
+{
+	fprintf(stderr, "Checking that routes are shortest paths\n");
+
+	CNodeRouteGraph graph;
+	CNodeRouteBuilder::Result result;
+	FillGraph(graph);
+	CNodeRouteBuilder::Build(graph, 0, result);
+
+	if (result.needsSorting)
+		FatalError("Routes couldn't be encoded");
+
+	if ((int)result.offsets.size() != NODE_COUNT * CNodeRouteGraph::NUM_TABLES)
+		FatalError("Wrong number of offsets");
+
+	int checked = 0;
+	int unreachable = 0;
+
+	for (int iTable = 0; iTable < CNodeRouteGraph::NUM_TABLES; iTable++)
+	{
+		for (int iFrom = 0; iFrom < NODE_COUNT; iFrom += 37)
+		{
+			std::vector<float> dist = FindDistances(iFrom, iTable);
+
+			for (int iDest = 0; iDest < NODE_COUNT; iDest++)
+			{
+				int iNode = iFrom;
+				float length = 0;
+				int steps = 0;
+
+				while (iNode != iDest)
+				{
+					const char *pRoute = result.routeInfo.data() + result.offsets[iNode * CNodeRouteGraph::NUM_TABLES + iTable];
+					int iNext = CNodeRouteBuilder::NextNodeInRoute(pRoute, iNode, iDest, NODE_COUNT);
+
+					if (iNext == iNode)
+						break;
+
+					const Link *pLink = nullptr;
+
+					for (const Link &link : m_Links[iNode])
+					{
+						if (link.dest == iNext && (link.tables & (1 << iTable)))
+							pLink = &link;
+					}
+
+					if (!pLink)
+						FatalError("Route uses a missing or forbidden link " + std::to_string(iNode) + " -> " + std::to_string(iNext));
+
+					length += pLink->weight;
+					iNode = iNext;
+
+					if (++steps > NODE_COUNT)
+						FatalError("Route has a loop");
+				}
+
+				if (iNode != iDest)
+				{
+					if (dist[iDest] != INFINITY)
+						FatalError("Reachable node " + std::to_string(iDest) + " wasn't reached from " + std::to_string(iFrom));
+
+					unreachable++;
+				}
+				else if (std::fabs(length - dist[iDest]) > 0.002f * steps + 0.01f)
+				{
+					FatalError("Route " + std::to_string(iFrom) + " -> " + std::to_string(iDest) + " is not the shortest");
+				}
+
+				checked++;
+			}
+		}
+	}
+
+	fprintf(stderr, "%d routes checked, %d unreachable\n", checked, unreachable);
+	fprintf(stderr, "Good\n\n");
+}
+
+void CNodeRoutesTest::TestThreads()
+{
+	fprintf(stderr, "Checking that result doesn't depend on number of threads\n");
+
+	CNodeRouteGraph graph;
+	FillGraph(graph);
+
+	CNodeRouteBuilder::Result reference;
+	CNodeRouteBuilder::Build(graph, 1, reference);
+
+	for (int threads : { 2, 3, 8 })
+	{
+		CNodeRouteBuilder::Result result;
+		CNodeRouteBuilder::Build(graph, threads, result);
+
+		if (result.routeInfo != reference.routeInfo || result.offsets != reference.offsets)
+			FatalError("Result with " + std::to_string(threads) + " threads is different");
+	}
+
+	fprintf(stderr, "Good\n\n");
+}
+
+void CNodeRoutesTest::TestHash()
+{
+	fprintf(stderr, "Checking graph hash\n");
+
+	CNodeRouteGraph a, b;
+	FillGraph(a);
+	FillGraph(b);
+
+	if (a.GetHash() != b.GetHash())
+		FatalError("Same graphs have different hashes");
+
+	m_Links[100][0].tables &= ~1u;
+	FillGraph(b);
+
+	if (a.GetHash() == b.GetHash())
+		FatalError("Hash didn't change with link tables");
+
+	m_Links[100][0].tables |= 1u;
+	m_Links[100][0].weight += 1;
+	FillGraph(b);
+
+	if (a.GetHash() == b.GetHash())
+		FatalError("Hash didn't change with link weight");
+
+	m_Links[100][0].weight -= 1;
+	fprintf(stderr, "Good\n\n");
+}
+
+void CNodeRoutesTest::RunBenchmark()
+{
+	fprintf(stderr, "Benchmark: %d nodes, %d tables\n", NODE_COUNT, CNodeRouteGraph::NUM_TABLES);
+
+	CNodeRouteGraph graph;
+	FillGraph(graph);
+
+	for (int threads : { 1, 0 })
+	{
+		CNodeRouteBuilder::Result result;
+		CNodeRouteBuilder::Build(graph, threads, result);
+		fprintf(stderr, "%2d threads: %8.1f ms, %zu route bytes\n", result.threads, result.seconds * 1000.0, result.routeInfo.size());
+	}
+}
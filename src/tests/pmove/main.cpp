@@ -0,0 +1,1096 @@
+//
+// Player movement replay test and benchmark.
+//
+// Runs pm_shared against a synthetic world made of boxes compiled into
+// clipnode hulls, the same way the engine would run it against a BSP.
+// Scripted usercmd streams (bunnyhop, ladder, water, duck-jump) are replayed,
+// player state is hashed after every move and the time per move is measured.
+//
+// Usage: test_pmove [--save <file>] [--check <file>] [--repeat <n>] [stream files...]
+//   --save    writes checksums of all streams to a file
+//   --check   compares checksums with a file written by --save
+//   --repeat  number of replays for the benchmark
+// A stream file has one command per line:
+//   msec forwardmove sidemove upmove pitch yaw roll buttons
+// and an optional "origin x y z" line with the start position.
+//
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+#include <mathlib/mathlib.h>
+#include "const.h"
+#include "usercmd.h"
+#include "pm_defs.h"
+#include "pm_shared.h"
+#include "pm_movevars.h"
+#include "in_buttons.h"
+
+movevars_t movevars;
+
+// Same layout as in pm_shared.cpp and the engine
+typedef struct
+{
+	int planenum;
+	short children[2]; // negative numbers are contents
+} dclipnode_t;
+
+typedef struct mplane_s
+{
+	Vector normal;
+	float dist;
+	byte type;
+	byte signbits;
+	byte pad[2];
+} mplane_t;
+
+typedef struct hull_s
+{
+	dclipnode_t *clipnodes;
+	mplane_t *planes;
+	int firstclipnode;
+	int lastclipnode;
+	Vector clip_mins;
+	Vector clip_maxs;
+} hull_t;
+
+namespace
+{
+
+constexpr float DIST_EPSILON = 0.03125f;
+constexpr int NUM_HULLS = 4;
+
+/**
+ * A set of axis-aligned boxes compiled into a clipnode tree.
+ * Each box is a chain of 6 nodes: outside of any plane leads to the next box,
+ * inside of all planes is the box contents.
+ */
+class CBoxHull
+{
+public:
+	struct Box
+	{
+		Vector mins, maxs;
+		int contents;
+	};
+
+	void Build(const std::vector<Box> &boxes, const Vector &hullMins, const Vector &hullMaxs)
+	{
+		m_Nodes.clear();
+		m_Planes.clear();
+
+		for (size_t i = 0; i < boxes.size(); i++)
+		{
+			// Expand by the hull size so the hull can be traced as a point
+			Vector mins = boxes[i].mins - hullMaxs;
+			Vector maxs = boxes[i].maxs - hullMins;
+			int outside = i + 1 < boxes.size() ? (int)(i + 1) * 6 : CONTENTS_EMPTY;
+
+			for (int j = 0; j < 6; j++)
+			{
+				int axis = j / 2;
+				bool isMax = (j % 2) == 0;
+				int inside = j < 5 ? (int)m_Nodes.size() + 1 : boxes[i].contents;
+
+				mplane_t plane = {};
+				plane.normal = Vector(0, 0, 0);
+				plane.normal[axis] = 1;
+				plane.dist = isMax ? maxs[axis] : mins[axis];
+				plane.type = axis;
+
+				dclipnode_t node;
+				node.planenum = m_Planes.size();
+				node.children[0] = isMax ? outside : inside;
+				node.children[1] = isMax ? inside : outside;
+
+				m_Planes.push_back(plane);
+				m_Nodes.push_back(node);
+			}
+		}
+
+		m_Hull.clipnodes = m_Nodes.data();
+		m_Hull.planes = m_Planes.data();
+		m_Hull.firstclipnode = m_Nodes.empty() ? CONTENTS_EMPTY : 0;
+		m_Hull.lastclipnode = (int)m_Nodes.size() - 1;
+		m_Hull.clip_mins = hullMins;
+		m_Hull.clip_maxs = hullMaxs;
+	}
+
+	hull_t *GetHull() { return &m_Hull; }
+
+private:
+	std::vector<dclipnode_t> m_Nodes;
+	std::vector<mplane_t> m_Planes;
+	hull_t m_Hull = {};
+};
+
+int HullPointContents(hull_t *hull, int num, const float *p)
+{
+	while (num >= 0)
+	{
+		dclipnode_t *node = hull->clipnodes + num;
+		mplane_t *plane = hull->planes + node->planenum;
+		float d = p[plane->type] - plane->dist;
+		num = node->children[d < 0 ? 1 : 0];
+	}
+
+	return num;
+}
+
+/**
+ * Quake's SV_RecursiveHullCheck.
+ */
+bool RecursiveHullCheck(hull_t *hull, int num, float p1f, float p2f, const Vector &p1, const Vector &p2, pmtrace_t *trace)
+{
+	if (num < 0)
+	{
+		if (num != CONTENTS_SOLID)
+		{
+			trace->allsolid = false;
+
+			if (num == CONTENTS_EMPTY)
+				trace->inopen = true;
+			else
+				trace->inwater = true;
+		}
+		else
+		{
+			trace->startsolid = true;
+		}
+
+		return true;
+	}
+
+	dclipnode_t *node = hull->clipnodes + num;
+	mplane_t *plane = hull->planes + node->planenum;
+	float t1 = p1[plane->type] - plane->dist;
+	float t2 = p2[plane->type] - plane->dist;
+
+	if (t1 >= 0 && t2 >= 0)
+		return RecursiveHullCheck(hull, node->children[0], p1f, p2f, p1, p2, trace);
+	if (t1 < 0 && t2 < 0)
+		return RecursiveHullCheck(hull, node->children[1], p1f, p2f, p1, p2, trace);
+
+	// Put the crosspoint DIST_EPSILON pixels on the near side
+	float frac = t1 < 0 ? (t1 + DIST_EPSILON) / (t1 - t2) : (t1 - DIST_EPSILON) / (t1 - t2);
+
+	if (frac < 0)
+		frac = 0;
+	if (frac > 1)
+		frac = 1;
+
+	float midf = p1f + (p2f - p1f) * frac;
+	Vector mid = p1 + (p2 - p1) * frac;
+	int side = t1 < 0;
+
+	if (!RecursiveHullCheck(hull, node->children[side], p1f, midf, p1, mid, trace))
+		return false;
+
+	if (HullPointContents(hull, node->children[side ^ 1], mid) != CONTENTS_SOLID)
+		return RecursiveHullCheck(hull, node->children[side ^ 1], midf, p2f, mid, p2, trace);
+
+	if (trace->allsolid)
+		return false; // Never got out of the solid area
+
+	// The other side of the node is solid, this is the impact point
+	if (!side)
+	{
+		trace->plane.normal = plane->normal;
+		trace->plane.dist = plane->dist;
+	}
+	else
+	{
+		trace->plane.normal = -plane->normal;
+		trace->plane.dist = -plane->dist;
+	}
+
+	while (HullPointContents(hull, hull->firstclipnode, mid) == CONTENTS_SOLID)
+	{
+		// Shouldn't really happen, but does occasionally
+		frac -= 0.1f;
+
+		if (frac < 0)
+		{
+			trace->fraction = midf;
+			trace->endpos = mid;
+			return false;
+		}
+
+		midf = p1f + (p2f - p1f) * frac;
+		mid = p1 + (p2 - p1) * frac;
+	}
+
+	trace->fraction = midf;
+	trace->endpos = mid;
+	return false;
+}
+
+pmtrace_t HullTrace(hull_t *hull, const Vector &start, const Vector &end)
+{
+	pmtrace_t trace = {};
+	trace.allsolid = true;
+	trace.fraction = 1;
+	trace.endpos = end;
+	trace.plane.normal = Vector(0, 0, 0);
+	trace.ent = -1;
+	trace.deltavelocity = Vector(0, 0, 0);
+
+	if (hull->firstclipnode >= 0)
+		RecursiveHullCheck(hull, hull->firstclipnode, 0, 1, start, end, &trace);
+	else
+		trace.allsolid = false;
+
+	if (trace.allsolid)
+		trace.startsolid = true;
+	if (trace.startsolid)
+		trace.fraction = 0;
+
+	return trace;
+}
+
+uint64_t HashBytes(uint64_t hash, const void *data, size_t size)
+{
+	// FNV-1a
+	const uint8_t *p = static_cast<const uint8_t *>(data);
+
+	for (size_t i = 0; i < size; i++)
+	{
+		hash ^= p[i];
+		hash *= 0x100000001b3ULL;
+	}
+
+	return hash;
+}
+
+constexpr uint64_t HASH_INIT = 0xcbf29ce484222325ULL;
+
+}
+
+class CPmoveTest
+{
+public:
+	int Run(int argc, char **argv);
+	[[noreturn]] void FatalError(const std::string &msg);
+
+private:
+	struct Stream
+	{
+		std::string name;
+		Vector origin;
+		std::vector<usercmd_t> cmds;
+	};
+
+	struct Result
+	{
+		uint64_t hash = HASH_INIT;
+		Vector origin;
+		Vector maxOrigin;
+		float maxSpeed2D = 0;
+		int maxWaterLevel = 0;
+		int jumps = 0;
+		int ladderMoves = 0;
+		int sounds = 0;
+		bool onGround = false;
+		bool ducked = false;
+	};
+
+	static CPmoveTest *s_pInstance;
+	static playermove_t s_Pmove;
+
+	CBoxHull m_WorldHulls[NUM_HULLS];
+	CBoxHull m_LadderHulls[NUM_HULLS];
+	Vector m_LadderMins, m_LadderMaxs;
+
+	// Fake model pointers, only compared with each other
+	model_s *m_pWorldModel = reinterpret_cast<model_s *>(0x1000);
+	model_s *m_pLadderModel = reinterpret_cast<model_s *>(0x2000);
+
+	double m_flTime = 0;
+	uint32_t m_uRandomSeed = 0;
+	Result *m_pResult = nullptr;
+
+	std::vector<Stream> m_Streams;
+	std::string m_SavePath;
+	std::string m_CheckPath;
+	int m_iRepeat = 20;
+
+	void ParseArgs(int argc, char **argv);
+	Stream LoadStream(const std::string &path);
+	void CreateWorld();
+	void InitPmove();
+	Result Replay(const Stream &stream);
+	void HashState(Result &result);
+
+	Stream BuildBunnyhop();
+	Stream BuildLadder();
+	Stream BuildWater();
+	Stream BuildDuckJump();
+
+	void TestScenarios();
+	void TestDeterminism();
+	void TestChecksums();
+	void RunBenchmark();
+
+	// Engine callbacks
+	static const char *Info_ValueForKey(const char *s, const char *key);
+	static void Particle(float *origin, int color, float life, int zpos, int zvel);
+	static int TestPlayerPosition(float *pos, pmtrace_t *ptrace);
+	static void Con_NPrintf(int idx, char *fmt, ...);
+	static void Con_Printf(char *fmt, ...);
+	static double Sys_FloatTime();
+	static void StuckTouch(int hitent, pmtrace_t *ptraceresult);
+	static int PointContents(float *p, int *truecontents);
+	static int TruePointContents(float *p);
+	static int HullPointContentsCb(hull_t *hull, int num, float *p);
+	static pmtrace_t PlayerTrace(float *start, float *end, int traceFlags, int ignore_pe);
+	static int32 RandomLong(int32 lLow, int32 lHigh);
+	static float RandomFloat(float flLow, float flHigh);
+	static int GetModelType(model_s *mod);
+	static void GetModelBounds(model_s *mod, float *mins, float *maxs);
+	static void *HullForBsp(physent_t *pe, float *offset);
+	static float TraceModel(physent_t *pEnt, float *start, float *end, trace_t *trace);
+	static int COM_FileSize(char *filename);
+	static byte *COM_LoadFile(char *path, int usehunk, int *pLength);
+	static void COM_FreeFile(void *buffer);
+	static char *memfgets(byte *pMemFile, int fileSize, int *pFilePos, char *pBuffer, int bufferSize);
+	static void PlaySound(int channel, const char *sample, float volume, float attenuation, int fFlags, int pitch);
+	static const char *TraceTexture(int ground, float *vstart, float *vend);
+};
+
+CPmoveTest *CPmoveTest::s_pInstance = nullptr;
+playermove_t CPmoveTest::s_Pmove;
+
+int main(int argc, char **argv)
+{
+	CPmoveTest test;
+	return test.Run(argc, argv);
+}
+
+int CPmoveTest::Run(int argc, char **argv)
+{
+	s_pInstance = this;
+
+	ParseArgs(argc, argv);
+	InitPmove();
+	CreateWorld();
+
+	m_Streams.insert(m_Streams.begin(), { BuildBunnyhop(), BuildLadder(), BuildWater(), BuildDuckJump() });
+
+	TestScenarios();
+	TestDeterminism();
+	TestChecksums();
+	RunBenchmark();
+	return 0;
+}
+
+void CPmoveTest::FatalError(const std::string &msg)
+{
+	fprintf(stderr, "Fatal Error: %s\n", msg.c_str());
+	exit(1);
+}
+
+void CPmoveTest::ParseArgs(int argc, char **argv)
+{
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+
+		if ((arg == "--save" || arg == "--check" || arg == "--repeat") && i + 1 >= argc)
+			FatalError(arg + " requires a value");
+
+		if (arg == "--save")
+			m_SavePath = argv[++i];
+		else if (arg == "--check")
+			m_CheckPath = argv[++i];
+		else if (arg == "--repeat")
+			m_iRepeat = std::max(1, atoi(argv[++i]));
+		else
+			m_Streams.push_back(LoadStream(arg));
+	}
+}
+
+CPmoveTest::Stream CPmoveTest::LoadStream(const std::string &path)
+{
+	FILE *file = fopen(path.c_str(), "r");
+
+	if (!file)
+		FatalError("Failed to open " + path);
+
+	Stream stream;
+	stream.name = path;
+	stream.origin = Vector(0, 0, 36);
+
+	char line[256];
+	int lineNum = 0;
+
+	while (fgets(line, sizeof(line), file))
+	{
+		lineNum++;
+
+		if (line[0] == '#' || line[0] == '\n' || line[0] == '\r')
+			continue;
+
+		if (!strncmp(line, "origin ", 7))
+		{
+			if (sscanf(line + 7, "%f %f %f", &stream.origin.x, &stream.origin.y, &stream.origin.z) != 3)
+				FatalError(path + ":" + std::to_string(lineNum) + ": invalid origin");
+
+			continue;
+		}
+
+		int msec, buttons;
+		usercmd_t cmd = {};
+
+		if (sscanf(line, "%d %f %f %f %f %f %f %d", &msec, &cmd.forwardmove, &cmd.sidemove, &cmd.upmove,
+		        &cmd.viewangles.x, &cmd.viewangles.y, &cmd.viewangles.z, &buttons)
+		    != 8)
+			FatalError(path + ":" + std::to_string(lineNum) + ": invalid command");
+
+		cmd.msec = msec;
+		cmd.buttons = buttons;
+		stream.cmds.push_back(cmd);
+	}
+
+	fclose(file);
+	return stream;
+}
+
+void CPmoveTest::CreateWorld()
+{
+	std::vector<CBoxHull::Box> solids = {
+		// Floor
+		{ Vector(-2048, -2048, -64), Vector(2048, 2048, 0), CONTENTS_SOLID },
+		// A box that can only be climbed with a duck-jump
+		{ Vector(300, -128, 0), Vector(400, 128, 56), CONTENTS_SOLID },
+		// Stairs next to it
+		{ Vector(300, 200, 0), Vector(332, 328, 16), CONTENTS_SOLID },
+		{ Vector(332, 200, 0), Vector(364, 328, 32), CONTENTS_SOLID },
+		{ Vector(364, 200, 0), Vector(396, 328, 48), CONTENTS_SOLID },
+		// Wall behind the ladder
+		{ Vector(528, -64, 0), Vector(560, 64, 512), CONTENTS_SOLID },
+	};
+
+	// Water is only in the point hull, like in a compiled map
+	std::vector<CBoxHull::Box> withWater = solids;
+	withWater.push_back({ Vector(-1024, -256, 0), Vector(-512, 256, 128), CONTENTS_WATER });
+
+	m_LadderMins = Vector(512, -32, 0);
+	m_LadderMaxs = Vector(528, 32, 400);
+	std::vector<CBoxHull::Box> ladder = { { m_LadderMins, m_LadderMaxs, CONTENTS_SOLID } };
+
+	for (int i = 0; i < NUM_HULLS; i++)
+	{
+		const Vector &mins = s_Pmove.player_mins[i];
+		const Vector &maxs = s_Pmove.player_maxs[i];
+		m_WorldHulls[i].Build(i == 2 ? withWater : solids, mins, maxs);
+		m_LadderHulls[i].Build(ladder, mins, maxs);
+	}
+}
+
+void CPmoveTest::InitPmove()
+{
+	playermove_t &pm = s_Pmove;
+
+	movevars.gravity = 800;
+	movevars.stopspeed = 100;
+	movevars.maxspeed = 320;
+	movevars.spectatormaxspeed = 500;
+	movevars.accelerate = 10;
+	movevars.airaccelerate = 10;
+	movevars.wateraccelerate = 10;
+	movevars.friction = 4;
+	movevars.edgefriction = 2;
+	movevars.waterfriction = 1;
+	movevars.entgravity = 1;
+	movevars.bounce = 1;
+	movevars.stepsize = 18;
+	movevars.maxvelocity = 2000;
+	movevars.footsteps = true;
+
+	pm.movevars = &movevars;
+	pm.player_mins[0] = Vector(-16, -16, -36);
+	pm.player_maxs[0] = Vector(16, 16, 36);
+	pm.player_mins[1] = Vector(-16, -16, -18);
+	pm.player_maxs[1] = Vector(16, 16, 18);
+	pm.player_mins[2] = Vector(0, 0, 0);
+	pm.player_maxs[2] = Vector(0, 0, 0);
+	pm.player_mins[3] = Vector(-32, -32, -32);
+	pm.player_maxs[3] = Vector(32, 32, 32);
+
+	pm.server = true;
+	pm.multiplayer = true;
+	pm.runfuncs = true;
+
+	pm.PM_Info_ValueForKey = &Info_ValueForKey;
+	pm.PM_Particle = &Particle;
+	pm.PM_TestPlayerPosition = &TestPlayerPosition;
+	pm.Con_NPrintf = &Con_NPrintf;
+	pm.Con_DPrintf = &Con_Printf;
+	pm.Con_Printf = &Con_Printf;
+	pm.Sys_FloatTime = &Sys_FloatTime;
+	pm.PM_StuckTouch = &StuckTouch;
+	pm.PM_PointContents = &PointContents;
+	pm.PM_TruePointContents = &TruePointContents;
+	pm.PM_HullPointContents = &HullPointContentsCb;
+	pm.PM_PlayerTrace = &PlayerTrace;
+	pm.RandomLong = &RandomLong;
+	pm.RandomFloat = &RandomFloat;
+	pm.PM_GetModelType = &GetModelType;
+	pm.PM_GetModelBounds = &GetModelBounds;
+	pm.PM_HullForBsp = &HullForBsp;
+	pm.PM_TraceModel = &TraceModel;
+	pm.COM_FileSize = &COM_FileSize;
+	pm.COM_LoadFile = &COM_LoadFile;
+	pm.COM_FreeFile = &COM_FreeFile;
+	pm.memfgets = &memfgets;
+	pm.PM_PlaySound = &PlaySound;
+	pm.PM_TraceTexture = &TraceTexture;
+
+	PM_Init(&s_Pmove);
+}
+
+CPmoveTest::Result CPmoveTest::Replay(const Stream &stream)
+{
+	playermove_t &pm = s_Pmove;
+	Result result;
+
+	m_pResult = &result;
+	m_flTime = 1.0;
+	m_uRandomSeed = 1;
+
+	// Player state
+	pm.origin = stream.origin;
+	pm.velocity = Vector(0, 0, 0);
+	pm.basevelocity = Vector(0, 0, 0);
+	pm.movedir = Vector(0, 0, 0);
+	pm.punchangle = Vector(0, 0, 0);
+	pm.view_ofs = Vector(0, 0, 28);
+	pm.angles = pm.oldangles = Vector(0, 0, 0);
+	pm.flDuckTime = 0;
+	pm.bInDuck = false;
+	pm.flTimeStepSound = 0;
+	pm.iStepLeft = 0;
+	pm.flFallVelocity = 0;
+	pm.flSwimTime = 0;
+	pm.flags = FL_CLIENT;
+	pm.usehull = 0;
+	pm.gravity = 1;
+	pm.friction = 1;
+	pm.oldbuttons = 0;
+	pm.waterjumptime = 0;
+	pm.dead = false;
+	pm.deadflag = 0;
+	pm.spectator = 0;
+	pm.movetype = MOVETYPE_WALK;
+	pm.onground = -1;
+	pm.waterlevel = 0;
+	pm.watertype = CONTENTS_EMPTY;
+	pm.oldwaterlevel = 0;
+	pm.sztexturename[0] = '\0';
+	pm.chtexturetype = 0;
+	pm.maxspeed = 320;
+	pm.clientmaxspeed = 320;
+
+	// World
+	pm.numphysent = 1;
+	memset(&pm.physents[0], 0, sizeof(physent_t));
+	strcpy(pm.physents[0].name, "maps/synthetic.bsp");
+	pm.physents[0].model = m_pWorldModel;
+	pm.physents[0].solid = SOLID_BSP;
+
+	pm.nummoveent = 1;
+	memset(&pm.moveents[0], 0, sizeof(physent_t));
+	strcpy(pm.moveents[0].name, "*1");
+	pm.moveents[0].model = m_pLadderModel;
+	pm.moveents[0].skin = CONTENTS_LADDER;
+
+	pm.numvisent = 0;
+	result.maxOrigin = stream.origin;
+
+	for (const usercmd_t &cmd : stream.cmds)
+	{
+		bool wasOnGround = pm.onground != -1;
+
+		m_flTime += cmd.msec / 1000.0;
+		pm.time = (float)(m_flTime * 1000.0);
+		pm.frametime = cmd.msec / 1000.0f;
+		pm.cmd = cmd;
+		pm.oldangles = pm.angles;
+		pm.angles = cmd.viewangles;
+		pm.numtouch = 0;
+
+		PM_Move(&pm, true);
+
+		if (wasOnGround && pm.onground == -1 && pm.velocity.z > 0 && (cmd.buttons & IN_JUMP))
+			result.jumps++;
+
+		if (pm.movetype == MOVETYPE_FLY)
+			result.ladderMoves++;
+
+		result.maxSpeed2D = std::max(result.maxSpeed2D, pm.velocity.Length2D());
+		result.maxWaterLevel = std::max(result.maxWaterLevel, pm.waterlevel);
+
+		for (int i = 0; i < 3; i++)
+			result.maxOrigin[i] = std::max(result.maxOrigin[i], pm.origin[i]);
+
+		HashState(result);
+	}
+
+	result.origin = pm.origin;
+	result.onGround = pm.onground != -1;
+	result.ducked = (pm.flags & FL_DUCKING) != 0;
+	m_pResult = nullptr;
+	return result;
+}
+
+void CPmoveTest::HashState(Result &result)
+{
+	const playermove_t &pm = s_Pmove;
+	uint64_t hash = result.hash;
+
+	hash = HashBytes(hash, &pm.origin, sizeof(pm.origin));
+	hash = HashBytes(hash, &pm.velocity, sizeof(pm.velocity));
+	hash = HashBytes(hash, &pm.view_ofs, sizeof(pm.view_ofs));
+	hash = HashBytes(hash, &pm.flags, sizeof(pm.flags));
+	hash = HashBytes(hash, &pm.onground, sizeof(pm.onground));
+	hash = HashBytes(hash, &pm.waterlevel, sizeof(pm.waterlevel));
+	hash = HashBytes(hash, &pm.movetype, sizeof(pm.movetype));
+	hash = HashBytes(hash, &pm.usehull, sizeof(pm.usehull));
+	hash = HashBytes(hash, &pm.bInDuck, sizeof(pm.bInDuck));
+	hash = HashBytes(hash, &pm.flDuckTime, sizeof(pm.flDuckTime));
+
+	result.hash = hash;
+}
+
+CPmoveTest::Stream CPmoveTest::BuildBunnyhop()
+{
+	Stream stream;
+	stream.name = "bunnyhop";
+	stream.origin = Vector(-1500, -1500, 36);
+
+	usercmd_t cmd = {};
+	cmd.msec = 10;
+	cmd.viewangles = Vector(0, 45, 0);
+
+	// Run up
+	for (int i = 0; i < 60; i++)
+	{
+		cmd.forwardmove = 320;
+		cmd.buttons = IN_FORWARD;
+		stream.cmds.push_back(cmd);
+	}
+
+	// Jump every other command like a mouse wheel does and strafe in the air,
+	// turning toward the strafe direction.
+	for (int i = 0; i < 800; i++)
+	{
+		int dir = (i / 35) % 2 ? -1 : 1;
+
+		cmd.forwardmove = 0;
+		cmd.sidemove = 320.0f * dir;
+		cmd.viewangles.y -= 1.4f * dir;
+		cmd.buttons = (dir > 0 ? IN_MOVERIGHT : IN_MOVELEFT) | (i % 2 ? IN_JUMP : 0);
+		stream.cmds.push_back(cmd);
+	}
+
+	return stream;
+}
+
+CPmoveTest::Stream CPmoveTest::BuildLadder()
+{
+	Stream stream;
+	stream.name = "ladder";
+	stream.origin = Vector(440, 0, 36);
+
+	usercmd_t cmd = {};
+	cmd.msec = 10;
+	cmd.viewangles = Vector(0, 0, 0);
+
+	// Walk into the ladder, then climb looking up
+	for (int i = 0; i < 150; i++)
+	{
+		cmd.forwardmove = 320;
+		cmd.buttons = IN_FORWARD;
+		cmd.viewangles.x = i < 50 ? 0 : -60;
+		stream.cmds.push_back(cmd);
+	}
+
+	// Jump off
+	cmd.forwardmove = 0;
+	cmd.buttons = IN_JUMP;
+	stream.cmds.push_back(cmd);
+
+	cmd.buttons = 0;
+
+	for (int i = 0; i < 300; i++)
+		stream.cmds.push_back(cmd);
+
+	return stream;
+}
+
+CPmoveTest::Stream CPmoveTest::BuildWater()
+{
+	Stream stream;
+	stream.name = "water";
+	stream.origin = Vector(-400, 0, 36);
+
+	usercmd_t cmd = {};
+	cmd.msec = 10;
+	cmd.viewangles = Vector(0, 180, 0);
+
+	// Walk in, dive, swim up to the surface and walk out on the other side
+	for (int i = 0; i < 350; i++)
+	{
+		cmd.forwardmove = 320;
+		cmd.buttons = IN_FORWARD;
+		cmd.viewangles.x = 0;
+
+		if (i < 120)
+			cmd.viewangles.x = 30;
+		else if (i < 200)
+			cmd.viewangles.x = -45;
+
+		if (i >= 120 && i < 200 && i % 4 == 0)
+			cmd.buttons |= IN_JUMP;
+
+		stream.cmds.push_back(cmd);
+	}
+
+	return stream;
+}
+
+CPmoveTest::Stream CPmoveTest::BuildDuckJump()
+{
+	Stream stream;
+	stream.name = "duckjump";
+	stream.origin = Vector(100, 0, 36);
+
+	usercmd_t cmd = {};
+	cmd.msec = 10;
+	cmd.viewangles = Vector(0, 0, 0);
+
+	for (int i = 0; i < 200; i++)
+	{
+		cmd.forwardmove = 320;
+		cmd.buttons = IN_FORWARD;
+
+		if (i == 40)
+			cmd.buttons |= IN_JUMP;
+		else if (i > 45 && i < 120)
+			cmd.buttons |= IN_DUCK;
+
+		// Stop after landing
+		if (i >= 85)
+		{
+			cmd.forwardmove = 0;
+			cmd.buttons &= ~IN_FORWARD;
+		}
+
+		stream.cmds.push_back(cmd);
+	}
+
+	return stream;
+}
+
+void CPmoveTest::TestScenarios()
+{
+	fprintf(stderr, "Checking that scripted moves do what they are meant to\n");
+
+	Result bhop = Replay(m_Streams[0]);
+
+	if (bhop.jumps < 5 || bhop.maxSpeed2D <= 320)
+		FatalError("Bunnyhop: " + std::to_string(bhop.jumps) + " jumps, max speed " + std::to_string(bhop.maxSpeed2D));
+
+	Result ladder = Replay(m_Streams[1]);
+
+	if (ladder.ladderMoves == 0 || ladder.maxOrigin.z < 200)
+		FatalError("Ladder: climbed to " + std::to_string(ladder.maxOrigin.z));
+
+	if (!ladder.onGround || ladder.origin.x >= 512)
+		FatalError("Ladder: didn't jump off");
+
+	Result water = Replay(m_Streams[2]);
+
+	if (water.maxWaterLevel != 3 || water.origin.x > -1024 || !water.onGround)
+		FatalError("Water: didn't swim through");
+
+	if (water.sounds == 0)
+		FatalError("Water: no sounds were played");
+
+	Result duck = Replay(m_Streams[3]);
+
+	if (!duck.onGround || duck.ducked || duck.origin.x < 300 - 16 || duck.origin.x > 400 + 16 || duck.origin.z < 56)
+		FatalError("Duck-jump: didn't get on the box, origin " + std::to_string(duck.origin.x) + " " + std::to_string(duck.origin.z));
+
+	fprintf(stderr, "bunnyhop: %d jumps, max speed %.1f\n", bhop.jumps, bhop.maxSpeed2D);
+	fprintf(stderr, "ladder: max height %.1f\n", ladder.maxOrigin.z);
+	fprintf(stderr, "Good\n\n");
+}
+
+void CPmoveTest::TestDeterminism()
+{
+	fprintf(stderr, "Checking that replays are deterministic\n");
+
+	for (const Stream &stream : m_Streams)
+	{
+		uint64_t first = Replay(stream).hash;
+		uint64_t second = Replay(stream).hash;
+
+		if (first != second)
+			FatalError(stream.name + ": checksum changed between replays");
+	}
+
+	fprintf(stderr, "Good\n\n");
+}
+
+void CPmoveTest::TestChecksums()
+{
+	if (m_SavePath.empty() && m_CheckPath.empty())
+		return;
+
+	fprintf(stderr, "Checking state checksums\n");
+
+	std::map<std::string, uint64_t> hashes;
+
+	for (const Stream &stream : m_Streams)
+		hashes[stream.name] = Replay(stream).hash;
+
+	if (!m_SavePath.empty())
+	{
+		FILE *file = fopen(m_SavePath.c_str(), "w");
+
+		if (!file)
+			FatalError("Failed to open " + m_SavePath);
+
+		for (auto &i : hashes)
+			fprintf(file, "%s %016llx\n", i.first.c_str(), (unsigned long long)i.second);
+
+		fclose(file);
+	}
+
+	if (!m_CheckPath.empty())
+	{
+		FILE *file = fopen(m_CheckPath.c_str(), "r");
+
+		if (!file)
+			FatalError("Failed to open " + m_CheckPath);
+
+		char name[256];
+		unsigned long long expected;
+		int count = 0;
+
+		while (fscanf(file, "%255s %llx", name, &expected) == 2)
+		{
+			auto it = hashes.find(name);
+
+			if (it == hashes.end())
+				FatalError(std::string(name) + ": stream not found");
+
+			if (it->second != expected)
+				FatalError(std::string(name) + ": checksum mismatch");
+
+			count++;
+		}
+
+		fclose(file);
+		fprintf(stderr, "%d checksums match\n", count);
+	}
+
+	fprintf(stderr, "Good\n\n");
+}
+
+void CPmoveTest::RunBenchmark()
+{
+	fprintf(stderr, "Benchmark: time per move\n");
+
+	using Clock = std::chrono::high_resolution_clock;
+
+	for (const Stream &stream : m_Streams)
+	{
+		auto start = Clock::now();
+
+		for (int i = 0; i < m_iRepeat; i++)
+			Replay(stream);
+
+		auto end = Clock::now();
+		double ns = std::chrono::duration<double, std::nano>(end - start).count() / ((double)m_iRepeat * stream.cmds.size());
+		fprintf(stderr, "%-16s %6zu moves %8.0f ns/move  %016llx\n", stream.name.c_str(), stream.cmds.size(), ns, (unsigned long long)Replay(stream).hash);
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Engine callbacks
+//-----------------------------------------------------------------------------
+const char *CPmoveTest::Info_ValueForKey(const char *, const char *)
+{
+	return "";
+}
+
+void CPmoveTest::Particle(float *, int, float, int, int)
+{
+}
+
+int CPmoveTest::TestPlayerPosition(float *pos, pmtrace_t *ptrace)
+{
+	hull_t *hull = s_pInstance->m_WorldHulls[s_Pmove.usehull].GetHull();
+	pmtrace_t trace = HullTrace(hull, Vector(pos[0], pos[1], pos[2]), Vector(pos[0], pos[1], pos[2]));
+
+	if (ptrace)
+		*ptrace = trace;
+
+	if (HullPointContents(hull, hull->firstclipnode, pos) == CONTENTS_SOLID)
+	{
+		if (ptrace)
+			ptrace->ent = 0;
+
+		return 0;
+	}
+
+	return -1;
+}
+
+void CPmoveTest::Con_NPrintf(int, char *, ...)
+{
+}
+
+void CPmoveTest::Con_Printf(char *, ...)
+{
+}
+
+double CPmoveTest::Sys_FloatTime()
+{
+	return s_pInstance->m_flTime;
+}
+
+void CPmoveTest::StuckTouch(int, pmtrace_t *)
+{
+}
+
+int CPmoveTest::PointContents(float *p, int *truecontents)
+{
+	int contents = TruePointContents(p);
+
+	if (truecontents)
+		*truecontents = contents;
+
+	return contents;
+}
+
+int CPmoveTest::TruePointContents(float *p)
+{
+	hull_t *hull = s_pInstance->m_WorldHulls[2].GetHull();
+	return HullPointContents(hull, hull->firstclipnode, p);
+}
+
+int CPmoveTest::HullPointContentsCb(hull_t *hull, int num, float *p)
+{
+	return HullPointContents(hull, num, p);
+}
+
+pmtrace_t CPmoveTest::PlayerTrace(float *start, float *end, int, int)
+{
+	pmtrace_t trace = HullTrace(s_pInstance->m_WorldHulls[s_Pmove.usehull].GetHull(), Vector(start[0], start[1], start[2]), Vector(end[0], end[1], end[2]));
+
+	if (trace.allsolid || trace.startsolid || trace.fraction < 1)
+		trace.ent = 0;
+
+	return trace;
+}
+
+int32 CPmoveTest::RandomLong(int32 lLow, int32 lHigh)
+{
+	// Same sequence on every replay
+	uint32_t &seed = s_pInstance->m_uRandomSeed;
+	seed = seed * 1664525 + 1013904223;
+
+	uint32_t range = (uint32_t)(lHigh - lLow) + 1;
+	return range ? lLow + (int32)((seed >> 8) % range) : lLow;
+}
+
+float CPmoveTest::RandomFloat(float flLow, float flHigh)
+{
+	uint32_t &seed = s_pInstance->m_uRandomSeed;
+	seed = seed * 1664525 + 1013904223;
+
+	return flLow + (flHigh - flLow) * ((seed >> 8) / (float)(1 << 24));
+}
+
+int CPmoveTest::GetModelType(model_s *)
+{
+	return 0; // mod_brush
+}
+
+void CPmoveTest::GetModelBounds(model_s *, float *mins, float *maxs)
+{
+	VectorCopy(s_pInstance->m_LadderMins, mins);
+	VectorCopy(s_pInstance->m_LadderMaxs, maxs);
+}
+
+void *CPmoveTest::HullForBsp(physent_t *pe, float *offset)
+{
+	// Hulls are built in world space
+	VectorCopy(pe->origin, offset);
+
+	if (pe->model == s_pInstance->m_pLadderModel)
+		return s_pInstance->m_LadderHulls[s_Pmove.usehull].GetHull();
+
+	return s_pInstance->m_WorldHulls[s_Pmove.usehull].GetHull();
+}
+
+float CPmoveTest::TraceModel(physent_t *pEnt, float *start, float *end, trace_t *trace)
+{
+	hull_t *hull = pEnt->model == s_pInstance->m_pLadderModel ? s_pInstance->m_LadderHulls[2].GetHull() : s_pInstance->m_WorldHulls[2].GetHull();
+	pmtrace_t tr = HullTrace(hull, Vector(start[0], start[1], start[2]) - pEnt->origin, Vector(end[0], end[1], end[2]) - pEnt->origin);
+
+	memset(trace, 0, sizeof(*trace));
+	trace->allsolid = tr.allsolid;
+	trace->startsolid = tr.startsolid;
+	trace->inopen = tr.inopen;
+	trace->inwater = tr.inwater;
+	trace->fraction = tr.fraction;
+	trace->endpos = tr.endpos + pEnt->origin;
+	trace->plane.normal = tr.plane.normal;
+	trace->plane.dist = tr.plane.dist;
+	return tr.fraction;
+}
+
+int CPmoveTest::COM_FileSize(char *)
+{
+	return -1;
+}
+
+byte *CPmoveTest::COM_LoadFile(char *, int, int *pLength)
+{
+	// No materials.txt, all textures are concrete
+	if (pLength)
+		*pLength = 0;
+
+	return nullptr;
+}
+
+void CPmoveTest::COM_FreeFile(void *)
+{
+}
+
+char *CPmoveTest::memfgets(byte *, int, int *, char *, int)
+{
+	return nullptr;
+}
+
+void CPmoveTest::PlaySound(int, const char *, float, float, int, int)
+{
+	// Sounds aren't part of the checksum: wading sounds are skipped with a static
+	// counter in PM_PlayStepSound that carries over between replays.
+	if (s_pInstance->m_pResult)
+		s_pInstance->m_pResult->sounds++;
+}
+
+const char *CPmoveTest::TraceTexture(int, float *, float *)
+{
+	return nullptr;
+}
@@ -0,0 +1,406 @@
+//
+// cl_protect filter test.
+//
+// Checks that precompiled CRegexFilter gives the same results as compiling
+// the pattern for every check (the old CSvcMessages::RegexMatch) on a corpus
+// of stufftext commands and cvar requests, and prints timings of both.
+//
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <string>
+#include <vector>
+#include <pcre.h>
+#include <regex_filter.h>
+
+namespace
+{
+
+constexpr int BENCH_ITERATIONS = 200;
+
+// Same as in svc_messages.cpp
+const char *s_BlockList = "^(exit|quit|bind|unbind|unbindall|kill|exec|alias|clear|"
+                          "motdfile|motd_write|writecfg|developer|fps.+|rcon.*)$";
+const char *s_BlockListCvar = "^(MP3Volume|volume|name|rcon.*)$";
+
+// User filters, like they are set in configs
+const char *s_UserBlock = "^(cl_.*rate|rate|ex_interp|gl_.*)$";
+const char *s_UserAllow = "^(exec (\"?)(mapcycle|skins/.*)\\.cfg\\2|fps_max 100)$";
+const char *s_UserBlockCvar = "^(cl_.*|sensitivity)$";
+
+// Commands sent by servers with svc_stufftext, split by ';' and '\n'
+const char *s_Commands[] = {
+	"spk \"vox/five\"",
+	"spk \"vox/four\"",
+	"spk \"vox/three\"",
+	"spk buttons/bell1",
+	"mp3 play media/Half-Life01.mp3",
+	"mp3 stop",
+	"play sound/misc/talk.wav",
+	"cl_forwardspeed 400",
+	"cl_sidespeed 400",
+	"cl_backspeed 400",
+	"cl_updaterate 101",
+	"cl_cmdrate 101",
+	"rate 25000",
+	"ex_interp 0.01",
+	"fps_max 100",
+	"fps_override 1",
+	"developer 1",
+	"gl_vsync 0",
+	"hud_fastswitch 1",
+	"cl_minmodels 0",
+	"echo \"Welcome to the server\"",
+	"echo Round started",
+	"say /rtv",
+	"say_team \"need backup\"",
+	"name \"Player\"",
+	"bind w +forward",
+	"bind mouse1 \"+attack\"",
+	"unbindall",
+	"alias +bhop \"+jump;wait;-jump\"",
+	"exec mapcycle.cfg",
+	"exec \"skins/default.cfg\"",
+	"exec autoexec.cfg",
+	"writecfg hacked",
+	"motdfile autoexec.cfg",
+	"motd_write bind mouse1 quit",
+	"rcon_password 123",
+	"quit",
+	"exit",
+	"kill",
+	"clear",
+	"reconnect",
+	"connect 127.0.0.1:27015",
+	"retry",
+	"snapshot",
+	"screenshot",
+	"stopsound",
+	"cd fadeout",
+	"lambert 1.5",
+	"room_type 0",
+	"_vgui_menus 1",
+	"r_drawviewmodel 1",
+	"default_fov 90",
+	"brightness 3",
+	"gamma 3",
+	"volume 0.5",
+	"MP3Volume 0.1",
+	"cl_timer_sync",
+	"dem_forcehltv 1",
+	"spec_mode 3",
+	"+showscores",
+	"-showscores",
+	"+attack",
+	"-attack",
+	"FPS_MAX 1000",
+	"Bind k kill",
+};
+
+// Cvars requested by servers with svc_sendcvarvalue
+const char *s_Cvars[] = {
+	"fps_max",
+	"fps_override",
+	"cl_updaterate",
+	"cl_cmdrate",
+	"rate",
+	"ex_interp",
+	"gl_vsync",
+	"developer",
+	"sensitivity",
+	"m_rawinput",
+	"name",
+	"volume",
+	"MP3Volume",
+	"rcon_password",
+	"rcon_address",
+	"cl_lw",
+	"cl_lc",
+	"hud_fastswitch",
+	"r_fullbright",
+	"gl_monolights",
+	"lambert",
+	"brightness",
+	"gamma",
+	"model",
+	"topcolor",
+	"bottomcolor",
+};
+
+/**
+ * Old implementation: compiles the pattern on every check.
+ */
+bool RegexMatchUncached(const char *str, const char *regex)
+{
+	if (regex[0] == 0)
+		return false;
+
+	const char *error;
+	int erroffset;
+	int ovector[30];
+
+	pcre *re = pcre_compile(regex, PCRE_CASELESS, &error, &erroffset, NULL);
+	if (!re)
+		return false;
+
+	int rc = pcre_exec(re, NULL, str, strlen(str), 0, 0, ovector, sizeof(ovector) / sizeof(ovector[0]));
+	pcre_free(re);
+
+	return rc >= 0;
+}
+
+/**
+ * Returns the command name, like COM_ParseFile does for simple commands.
+ */
+std::string GetCommandName(const char *cmd)
+{
+	const char *end = cmd;
+
+	while (*end && *end != ' ')
+		end++;
+
+	return std::string(cmd, end);
+}
+
+}
+
+class CProtectTest
+{
+public:
+	int Run();
+	[[noreturn]] void FatalError(const std::string &msg);
+
+private:
+	CRegexFilter m_BlockList;
+	CRegexFilter m_BlockListCvar;
+	CRegexFilter m_UserBlockList;
+	CRegexFilter m_UserAllowList;
+	CRegexFilter m_UserBlockListCvar;
+
+	std::vector<std::string> m_CommandNames;
+
+	void CompileFilters();
+	void TestPatternChange();
+	void TestInvalidPattern();
+	void TestCorpus();
+	void RunBenchmark();
+
+	bool IsCommandGoodUncached(size_t i);
+	bool IsCommandGood(size_t i);
+	bool IsCvarGoodUncached(size_t i);
+	bool IsCvarGood(size_t i);
+};
+
+int main()
+{
+	CProtectTest test;
+	return test.Run();
+}
+
+int CProtectTest::Run()
+{
+	for (const char *cmd : s_Commands)
+		m_CommandNames.push_back(GetCommandName(cmd));
+
+	CompileFilters();
+	TestPatternChange();
+	TestInvalidPattern();
+	TestCorpus();
+	RunBenchmark();
+
+	return 0;
+}
+
+void CProtectTest::FatalError(const std::string &msg)
+{
+	fprintf(stderr, "Fatal Error: %s\n", msg.c_str());
+	exit(1);
+}
+
+void CProtectTest::CompileFilters()
+{
+	if (!m_BlockList.SetPattern(s_BlockList) || !m_BlockListCvar.SetPattern(s_BlockListCvar))
+		FatalError("Failed to compile built-in filters");
+
+	if (!m_UserBlockList.SetPattern(s_UserBlock) || !m_UserAllowList.SetPattern(s_UserAllow) || !m_UserBlockListCvar.SetPattern(s_UserBlockCvar))
+		FatalError("Failed to compile user filters");
+}
+
+void CProtectTest::TestPatternChange()
+{
+	fprintf(stderr, "Checking that filters are only recompiled on change\n");
+
+	CRegexFilter filter;
+
+	if (filter.Match("anything") || filter.IsValid())
+		FatalError("Empty filter must not match");
+
+	filter.SetPattern("^a+$");
+	filter.SetPattern("^a+$");
+
+	if (filter.GetStats().compiles != 1)
+		FatalError("Same pattern was recompiled");
+
+	if (!filter.Match("AAA") || filter.Match("ab"))
+		FatalError("Filter ^a+$ gives wrong results");
+
+	filter.SetPattern("^b+$");
+
+	if (filter.GetStats().compiles != 2 || filter.Match("AAA") || !filter.Match("bb"))
+		FatalError("Filter wasn't recompiled");
+
+	filter.SetPattern("");
+
+	if (filter.IsValid() || filter.Match("bb"))
+		FatalError("Cleared filter must not match");
+
+	fprintf(stderr, "Good\n\n");
+}
+
+void CProtectTest::TestInvalidPattern()
+{
+	fprintf(stderr, "Checking invalid patterns\n");
+
+	CRegexFilter filter;
+
+	if (filter.SetPattern("^(unclosed") || filter.IsValid() || filter.GetError()[0] == '\0')
+		FatalError("Invalid pattern must fail to compile");
+
+	if (filter.Match("unclosed"))
+		FatalError("Invalid pattern must not match");
+
+	if (!filter.SetPattern("^closed$") || !filter.IsValid() || filter.GetError()[0] != '\0')
+		FatalError("Valid pattern after invalid one must compile");
+
+	fprintf(stderr, "Good\n\n");
+}
+
+bool CProtectTest::IsCommandGoodUncached(size_t i)
+{
+	const char *name = m_CommandNames[i].c_str();
+	return !((RegexMatchUncached(name, s_BlockList) || RegexMatchUncached(name, s_UserBlock)) && !RegexMatchUncached(s_Commands[i], s_UserAllow));
+}
+
+bool CProtectTest::IsCommandGood(size_t i)
+{
+	const std::string &name = m_CommandNames[i];
+	return !((m_BlockList.Match(name.c_str(), name.size()) || m_UserBlockList.Match(name.c_str(), name.size())) && !m_UserAllowList.Match(s_Commands[i]));
+}
+
+bool CProtectTest::IsCvarGoodUncached(size_t i)
+{
+	return !(RegexMatchUncached(s_Cvars[i], s_BlockListCvar) || RegexMatchUncached(s_Cvars[i], s_UserBlockCvar));
+}
+
+bool CProtectTest::IsCvarGood(size_t i)
+{
+	return !(m_BlockListCvar.Match(s_Cvars[i]) || m_UserBlockListCvar.Match(s_Cvars[i]));
+}
+
+void CProtectTest::TestCorpus()
+{
+	fprintf(stderr, "Checking corpus\n");
+
+	int blocked = 0;
+
+	for (size_t i = 0; i < std::size(s_Commands); i++)
+	{
+		bool good = IsCommandGood(i);
+
+		if (good != IsCommandGoodUncached(i))
+			FatalError(std::string("Results differ for command: ") + s_Commands[i]);
+
+		if (!good)
+			blocked++;
+	}
+
+	fprintf(stderr, "%d of %d commands blocked\n", blocked, (int)std::size(s_Commands));
+	blocked = 0;
+
+	for (size_t i = 0; i < std::size(s_Cvars); i++)
+	{
+		bool good = IsCvarGood(i);
+
+		if (good != IsCvarGoodUncached(i))
+			FatalError(std::string("Results differ for cvar: ") + s_Cvars[i]);
+
+		if (!good)
+			blocked++;
+	}
+
+	fprintf(stderr, "%d of %d cvars blocked\n", blocked, (int)std::size(s_Cvars));
+
+	// Spot checks of the built-in list
+	struct
+	{
+		const char *cmd;
+		bool good;
+	} checks[] = {
+		{ "quit", false },
+		{ "FPS_MAX 1000", false },
+		{ "fps_max 100", true }, // allowed by user list
+		{ "exec autoexec.cfg", false },
+		{ "exec mapcycle.cfg", true },
+		{ "spk \"vox/five\"", true },
+		{ "cl_updaterate 101", false }, // blocked by user list
+		{ "hud_fastswitch 1", true },
+	};
+
+	for (auto &check : checks)
+	{
+		size_t i = 0;
+
+		while (i < std::size(s_Commands) && strcmp(s_Commands[i], check.cmd))
+			i++;
+
+		if (i == std::size(s_Commands))
+			FatalError(std::string("Command is not in the corpus: ") + check.cmd);
+
+		if (IsCommandGood(i) != check.good)
+			FatalError(std::string("Wrong result for command: ") + check.cmd);
+	}
+
+	fprintf(stderr, "Good\n\n");
+}
+
+void CProtectTest::RunBenchmark()
+{
+	fprintf(stderr, "Benchmark (%d iterations over the corpus)\n", BENCH_ITERATIONS);
+
+	using Clock = std::chrono::high_resolution_clock;
+	int checks = BENCH_ITERATIONS * (int)(std::size(s_Commands) + std::size(s_Cvars));
+	volatile int sink = 0;
+
+	auto start = Clock::now();
+
+	for (int it = 0; it < BENCH_ITERATIONS; it++)
+	{
+		for (size_t i = 0; i < std::size(s_Commands); i++)
+			sink += IsCommandGoodUncached(i);
+
+		for (size_t i = 0; i < std::size(s_Cvars); i++)
+			sink += IsCvarGoodUncached(i);
+	}
+
+	auto mid = Clock::now();
+
+	for (int it = 0; it < BENCH_ITERATIONS; it++)
+	{
+		for (size_t i = 0; i < std::size(s_Commands); i++)
+			sink += IsCommandGood(i);
+
+		for (size_t i = 0; i < std::size(s_Cvars); i++)
+			sink += IsCvarGood(i);
+	}
+
+	auto end = Clock::now();
+
+	double uncached = std::chrono::duration<double, std::nano>(mid - start).count() / checks;
+	double cached = std::chrono::duration<double, std::nano>(end - mid).count() / checks;
+
+	fprintf(stderr, "Compile on every check: %8.0f ns per check\n", uncached);
+	fprintf(stderr, "Precompiled:            %8.0f ns per check\n", cached);
+	fprintf(stderr, "Speedup: %.1fx\n", uncached / cached);
+}
@@ -0,0 +1,546 @@
+//
+// Save/restore field table test and benchmark.
+//
+// Generates entity classes with TYPEDESCRIPTION tables like the ones of
+// monsters, checks that CSaveFieldTable finds the same fields as the linear
+// case-insensitive scan of CRestore::ReadField, and round-trips a level worth
+// of entities through the save format with the old and the compiled lookups.
+// Saved data must be byte-identical.
+//
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <strings.h>
+#include <vector>
+#include "extdll.h"
+#include <save_fields.h>
+
+class CSaveFieldsTest
+{
+public:
+	int Run();
+	[[noreturn]] void FatalError(const std::string &msg);
+
+private:
+	static constexpr int CLASS_COUNT = 40;
+	static constexpr int ENTITY_COUNT = 1500;
+	static constexpr int TOKEN_COUNT = 0xfff;
+	static constexpr float LEVEL_TIME = 120.0f;
+
+	struct EntityClass
+	{
+		std::string name;
+		std::vector<std::string> fieldNames;
+		std::vector<TYPEDESCRIPTION> fields;
+		int dataSize;
+		CSaveFieldTable table;
+	};
+
+	struct Entity
+	{
+		int classIndex;
+		std::vector<char> data;
+	};
+
+	struct SaveData
+	{
+		std::vector<char> buffer;
+		int pos = 0;
+		std::vector<const char *> tokens;
+		Vector landmark;
+	};
+
+	std::mt19937 m_Rng { 1234 };
+	std::vector<EntityClass> m_Classes;
+	std::vector<Entity> m_Entities;
+	int m_TypeSizes[FIELD_TYPECOUNT];
+
+	void CreateClasses();
+	void CreateEntities();
+
+	// Old code of util.cpp
+	static unsigned int OldHashString(const char *pszToken);
+	static int OldFindField(const TYPEDESCRIPTION *pFields, int fieldCount, int startField, const char *pName);
+
+	unsigned short TokenHash(SaveData &save, const char *pszToken, unsigned int stringHash);
+	void BufferData(SaveData &save, const void *pdata, int size);
+	void BufferHeader(SaveData &save, unsigned short token, int size);
+
+	void SaveEntity(SaveData &save, const Entity &ent, bool compiled);
+	void RestoreEntity(SaveData &save, Entity &ent, bool compiled);
+
+	void TestHash();
+	void TestFind();
+	void TestRoundTrip();
+};
+
+int main()
+{
+	CSaveFieldsTest test;
+	return test.Run();
+}
+
+int CSaveFieldsTest::Run()
+{
+	CreateClasses();
+	CreateEntities();
+
+	TestHash();
+	TestFind();
+	TestRoundTrip();
+	return 0;
+}
+
+void CSaveFieldsTest::FatalError(const std::string &msg)
+{
+	fprintf(stderr, "Fatal Error: %s\n", msg.c_str());
+	exit(1);
+}
+
+void CSaveFieldsTest::CreateClasses()
+{
+	const int typeSizes[FIELD_TYPECOUNT] = { 4, 4, 4, 4, 4, 4, 4, 12, 12, 4, 4, 4, 4, 2, 1, 4, 4, 4 };
+	memcpy(m_TypeSizes, typeSizes, sizeof(m_TypeSizes));
+
+	// Types that don't need the engine
+	const FIELDTYPE types[] = { FIELD_FLOAT, FIELD_FLOAT, FIELD_INTEGER, FIELD_INTEGER, FIELD_BOOLEAN, FIELD_VECTOR, FIELD_POSITION_VECTOR, FIELD_TIME, FIELD_TIME, FIELD_SHORT, FIELD_CHARACTER };
+	const char *prefixes[] = { "m_fl", "m_i", "m_vec", "m_b", "m_n", "m_f" };
+
+	m_Classes.resize(CLASS_COUNT);
+
+	for (int c = 0; c < CLASS_COUNT; c++)
+	{
+		EntityClass &cls = m_Classes[c];
+		cls.name = "CMonster" + std::to_string(c);
+
+		// Base entvars-like table is big, derived ones are small
+		int fieldCount = c == 0 ? 150 : 5 + m_Rng() % 60;
+		int offset = 0;
+
+		for (int i = 0; i < fieldCount; i++)
+		{
+			std::string name = std::string(prefixes[m_Rng() % 6]) + "Field" + std::to_string(m_Rng() % 70);
+
+			// Same name with different case
+			if (i > 0 && m_Rng() % 15 == 0)
+			{
+				name = cls.fieldNames[m_Rng() % i];
+
+				for (char &ch : name)
+					ch = (m_Rng() % 2) ? toupper(ch) : ch;
+			}
+
+			cls.fieldNames.push_back(name);
+		}
+
+		for (int i = 0; i < fieldCount; i++)
+		{
+			TYPEDESCRIPTION desc;
+			desc.fieldType = types[m_Rng() % (sizeof(types) / sizeof(types[0]))];
+			desc.fieldName = (char *)cls.fieldNames[i].c_str();
+			desc.fieldOffset = offset;
+			desc.fieldSize = m_Rng() % 8 == 0 ? 1 + m_Rng() % 4 : 1;
+			desc.flags = 0;
+			offset += (desc.fieldSize * m_TypeSizes[desc.fieldType] + 3) & ~3;
+			cls.fields.push_back(desc);
+		}
+
+		cls.dataSize = offset;
+		cls.table.Compile(cls.fields.data(), fieldCount, m_TypeSizes);
+	}
+}
+
+void CSaveFieldsTest::CreateEntities()
+{
+	// Every entity saves entvars and then its own class
+	m_Entities.resize(ENTITY_COUNT * 2);
+
+	for (size_t i = 0; i < m_Entities.size(); i++)
+	{
+		Entity &ent = m_Entities[i];
+		ent.classIndex = i % 2 ? 1 + m_Rng() % (CLASS_COUNT - 1) : 0;
+		const EntityClass &cls = m_Classes[ent.classIndex];
+		ent.data.assign(cls.dataSize, 0);
+
+		// Most fields are empty and not saved
+		for (const TYPEDESCRIPTION &desc : cls.fields)
+		{
+			if (m_Rng() % (ent.classIndex == 0 ? 8 : 3) != 0)
+				continue;
+
+			char *p = ent.data.data() + desc.fieldOffset;
+
+			for (int i = 0; i < desc.fieldSize * m_TypeSizes[desc.fieldType]; i += 4)
+			{
+				float f = std::uniform_real_distribution<float>(-1000, 1000)(m_Rng);
+				memcpy(p + i, &f, std::min(4, desc.fieldSize * m_TypeSizes[desc.fieldType] - i));
+			}
+		}
+	}
+}
+
+unsigned int CSaveFieldsTest::OldHashString(const char *pszToken)
+{
+	unsigned int hash = 0;
+
+	while (*pszToken)
+	{
+		// _rotr(hash, 4)
+		unsigned num = hash;
+
+		for (int shift = 4; shift--;)
+		{
+			unsigned lobit = num & 1;
+			num >>= 1;
+			if (lobit)
+				num |= 0x80000000;
+		}
+
+		hash = num ^ *pszToken++;
+	}
+
+	return hash;
+}
+
+int CSaveFieldsTest::OldFindField(const TYPEDESCRIPTION *pFields, int fieldCount, int startField, const char *pName)
+{
+	for (int i = 0; i < fieldCount; i++)
+	{
+		int fieldNumber = (i + startField) % fieldCount;
+
+		if (!strcasecmp(pFields[fieldNumber].fieldName, pName))
+			return fieldNumber;
+	}
+
+	return -1;
+}
+
+unsigned short CSaveFieldsTest::TokenHash(SaveData &save, const char *pszToken, unsigned int stringHash)
+{
+	unsigned short hash = (unsigned short)(stringHash % (unsigned)TOKEN_COUNT);
+
+	for (int i = 0; i < TOKEN_COUNT; i++)
+	{
+		int index = hash + i;
+		if (index >= TOKEN_COUNT)
+			index -= TOKEN_COUNT;
+
+		if (!save.tokens[index] || save.tokens[index] == pszToken || strcmp(pszToken, save.tokens[index]) == 0)
+		{
+			save.tokens[index] = pszToken;
+			return index;
+		}
+	}
+
+	FatalError("Token table is full");
+}
+
+void CSaveFieldsTest::BufferData(SaveData &save, const void *pdata, int size)
+{
+	if (save.pos + size > (int)save.buffer.size())
+		FatalError("Save buffer overflow");
+
+	memcpy(save.buffer.data() + save.pos, pdata, size);
+	save.pos += size;
+}
+
+void CSaveFieldsTest::BufferHeader(SaveData &save, unsigned short token, int size)
+{
+	short shortSize = (short)size;
+	BufferData(save, &shortSize, sizeof(short));
+	BufferData(save, &token, sizeof(short));
+}
+
+void CSaveFieldsTest::SaveEntity(SaveData &save, const Entity &ent, bool compiled)
+{
+	const EntityClass &cls = m_Classes[ent.classIndex];
+	int fieldCount = (int)cls.fields.size();
+
+	auto isEmpty = [&](int i) {
+		const char *p = ent.data.data() + cls.fields[i].fieldOffset;
+		int size = cls.fields[i].fieldSize * m_TypeSizes[cls.fields[i].fieldType];
+
+		for (int j = 0; j < size; j++)
+		{
+			if (p[j])
+				return false;
+		}
+
+		return true;
+	};
+
+	int actualCount = 0;
+	std::vector<char> emptyFields(fieldCount);
+
+	for (int i = 0; i < fieldCount; i++)
+	{
+		emptyFields[i] = isEmpty(i);
+
+		if (!emptyFields[i])
+			actualCount++;
+	}
+
+	BufferHeader(save, TokenHash(save, cls.name.c_str(), OldHashString(cls.name.c_str())), sizeof(int));
+	BufferData(save, &actualCount, sizeof(int));
+
+	for (int i = 0; i < fieldCount; i++)
+	{
+		const TYPEDESCRIPTION &desc = cls.fields[i];
+		const char *pOutputData = ent.data.data() + desc.fieldOffset;
+
+		// Old code checked it again
+		if (compiled ? emptyFields[i] : isEmpty(i))
+			continue;
+
+		unsigned int hash = compiled ? cls.table.GetNameHash(i) : OldHashString(desc.fieldName);
+		unsigned short token = TokenHash(save, desc.fieldName, hash);
+		int size = desc.fieldSize * m_TypeSizes[desc.fieldType];
+
+		if (compiled && cls.table.IsPlainData(i))
+		{
+			BufferHeader(save, token, cls.table.GetDataSize(i));
+			BufferData(save, pOutputData, cls.table.GetDataSize(i));
+			continue;
+		}
+
+		BufferHeader(save, token, size);
+
+		for (int j = 0; j < desc.fieldSize; j++)
+		{
+			const float *v = (const float *)pOutputData + j * (m_TypeSizes[desc.fieldType] / 4);
+
+			switch (desc.fieldType)
+			{
+			case FIELD_TIME:
+			{
+				float time = v[0] - LEVEL_TIME;
+				BufferData(save, &time, sizeof(float));
+				break;
+			}
+			case FIELD_POSITION_VECTOR:
+			{
+				float pos[3] = { v[0] - save.landmark.x, v[1] - save.landmark.y, v[2] - save.landmark.z };
+				BufferData(save, pos, sizeof(pos));
+				break;
+			}
+			default:
+				BufferData(save, pOutputData + j * m_TypeSizes[desc.fieldType], m_TypeSizes[desc.fieldType]);
+				break;
+			}
+		}
+	}
+}
+
+void CSaveFieldsTest::RestoreEntity(SaveData &save, Entity &ent, bool compiled)
+{
+	const EntityClass &cls = m_Classes[ent.classIndex];
+	int fieldCount = (int)cls.fields.size();
+	char *p = save.buffer.data() + save.pos;
+
+	auto readShort = [&]() { unsigned short s; memcpy(&s, p, 2); p += 2; return s; };
+
+	readShort();
+
+	if (save.tokens[readShort()] != cls.name.c_str())
+		FatalError("Expected " + cls.name);
+
+	int fileCount;
+	memcpy(&fileCount, p, sizeof(int));
+	p += sizeof(int);
+
+	ent.data.assign(cls.dataSize, 0);
+	int lastField = 0;
+
+	for (int i = 0; i < fileCount; i++)
+	{
+		int size = readShort();
+		const char *pName = save.tokens[readShort()];
+		const char *pData = p;
+		p += size;
+
+		int fieldNumber = compiled ? cls.table.FindField(pName, lastField) : OldFindField(cls.fields.data(), fieldCount, lastField, pName);
+		lastField = fieldNumber + 1;
+
+		if (fieldNumber == -1)
+			continue;
+
+		const TYPEDESCRIPTION &desc = cls.fields[fieldNumber];
+		char *pOutput = ent.data.data() + desc.fieldOffset;
+
+		if (compiled && cls.table.IsPlainData(fieldNumber))
+		{
+			memcpy(pOutput, pData, cls.table.GetDataSize(fieldNumber));
+			continue;
+		}
+
+		int typeSize = m_TypeSizes[desc.fieldType];
+
+		for (int j = 0; j < desc.fieldSize; j++)
+		{
+			// Save data is not aligned
+			float *out = (float *)(pOutput + j * typeSize);
+			float in[3];
+			memcpy(in, pData + j * typeSize, typeSize);
+
+			switch (desc.fieldType)
+			{
+			case FIELD_TIME:
+				out[0] = in[0] + LEVEL_TIME;
+				break;
+			case FIELD_POSITION_VECTOR:
+				out[0] = in[0] + save.landmark.x;
+				out[1] = in[1] + save.landmark.y;
+				out[2] = in[2] + save.landmark.z;
+				break;
+			case FIELD_FLOAT:
+				out[0] = in[0];
+				break;
+			case FIELD_VECTOR:
+				out[0] = in[0];
+				out[1] = in[1];
+				out[2] = in[2];
+				break;
+			case FIELD_INTEGER:
+			case FIELD_BOOLEAN:
+				*(int *)out = *(const int *)in;
+				break;
+			case FIELD_SHORT:
+				*(short *)out = *(const short *)in;
+				break;
+			case FIELD_CHARACTER:
+				*(char *)out = *(const char *)in;
+				break;
+			default:
+				FatalError("Bad field type");
+			}
+		}
+	}
+
+	save.pos = (int)(p - save.buffer.data());
+}
+
+void CSaveFieldsTest::TestHash()
+{
+	fprintf(stderr, "Checking save token hashes\n");
+
+	for (const EntityClass &cls : m_Classes)
+	{
+		for (int i = 0; i < cls.table.GetFieldCount(); i++)
+		{
+			if (cls.table.GetNameHash(i) != OldHashString(cls.fields[i].fieldName))
+				FatalError("Hash of " + cls.fieldNames[i] + " doesn't match");
+		}
+	}
+
+	// Characters above 127 are sign-extended
+	const char *strings[] = { "", "a", "m_flNextAttack", "\xe9\xe8\xff", "Some very long string to check the rotation of all bits" };
+
+	for (const char *s : strings)
+	{
+		if (CSaveFieldTable::HashString(s) != OldHashString(s))
+			FatalError(std::string("Hash of '") + s + "' doesn't match");
+	}
+
+	fprintf(stderr, "Good\n\n");
+}
+
+void CSaveFieldsTest::TestFind()
+{
+	fprintf(stderr, "Checking field lookup\n");
+
+	for (const EntityClass &cls : m_Classes)
+	{
+		int fieldCount = (int)cls.fields.size();
+		std::vector<std::string> names = cls.fieldNames;
+		names.push_back("m_flUnknown");
+		names.push_back("");
+
+		for (std::string name : names)
+		{
+			// Lookup ignores case
+			if (m_Rng() % 2)
+			{
+				for (char &ch : name)
+					ch = toupper(ch);
+			}
+
+			for (int start = 0; start <= fieldCount; start++)
+			{
+				int expected = OldFindField(cls.fields.data(), fieldCount, start, name.c_str());
+				int found = cls.table.FindField(name.c_str(), start);
+
+				if (found != expected)
+					FatalError(cls.name + ": " + name + " from " + std::to_string(start) + ": expected " + std::to_string(expected) + ", got " + std::to_string(found));
+			}
+		}
+	}
+
+	fprintf(stderr, "Good\n\n");
+}
+
+void CSaveFieldsTest::TestRoundTrip()
+{
+	constexpr int REPEAT_COUNT = 20;
+
+	fprintf(stderr, "Checking save/restore round trip\n");
+
+	SaveData saves[2];
+	std::vector<Entity> restored[2];
+	double saveTime[2] = {};
+	double restoreTime[2] = {};
+
+	for (int compiled = 0; compiled < 2; compiled++)
+	{
+		SaveData &save = saves[compiled];
+		save.buffer.resize(16 * 1024 * 1024);
+		save.landmark = Vector(128, -64, 32);
+
+		for (int repeat = 0; repeat < REPEAT_COUNT; repeat++)
+		{
+			save.pos = 0;
+			save.tokens.assign(TOKEN_COUNT, nullptr);
+
+			auto t0 = std::chrono::steady_clock::now();
+
+			for (const Entity &ent : m_Entities)
+				SaveEntity(save, ent, compiled);
+
+			auto t1 = std::chrono::steady_clock::now();
+
+			int size = save.pos;
+			save.pos = 0;
+			restored[compiled] = m_Entities;
+
+			for (Entity &ent : restored[compiled])
+				RestoreEntity(save, ent, compiled);
+
+			auto t2 = std::chrono::steady_clock::now();
+
+			if (save.pos != size)
+				FatalError("Restore didn't read all data");
+
+			saveTime[compiled] += std::chrono::duration<double, std::milli>(t1 - t0).count();
+			restoreTime[compiled] += std::chrono::duration<double, std::milli>(t2 - t1).count();
+		}
+
+		save.buffer.resize(save.pos);
+	}
+
+	if (saves[0].buffer != saves[1].buffer)
+		FatalError("Saved data is different");
+
+	for (size_t i = 0; i < m_Entities.size(); i++)
+	{
+		if (restored[0][i].data != restored[1][i].data)
+			FatalError("Restored entity " + std::to_string(i) + " is different");
+	}
+
+	fprintf(stderr, "%d entities, %d bytes\n", ENTITY_COUNT, (int)saves[1].buffer.size());
+	fprintf(stderr, "Good\n\n");
+
+	fprintf(stderr, "Old lookups:      save %7.3f ms, restore %7.3f ms\n", saveTime[0] / REPEAT_COUNT, restoreTime[0] / REPEAT_COUNT);
+	fprintf(stderr, "Compiled tables:  save %7.3f ms, restore %7.3f ms\n", saveTime[1] / REPEAT_COUNT, restoreTime[1] / REPEAT_COUNT);
+}
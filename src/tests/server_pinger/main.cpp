@@ -0,0 +1,578 @@
+//
+// Server pinger test.
+//
+// Runs a fleet of stand-in servers on local UDP ports and checks that
+// CServerPinger gets info and rules of all of them at once, including
+// servers with challenges, split rules, old info format and silent ones.
+// Then compares query throughput with sequential NetSendReceiveUdp calls.
+//
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <server_pinger.h>
+
+namespace
+{
+
+using Clock = std::chrono::high_resolution_clock;
+
+constexpr int CHALLENGE = 0x5EED1234;
+constexpr int SPLIT_PAYLOAD = 1400 - 9;
+constexpr int FLEET_THREADS = 4;
+constexpr int BENCH_SERVERS = 256;
+constexpr int BENCH_ROUNDS = 5;
+constexpr int BENCH_LATENCY_MS = 10;
+
+unsigned long LoopbackAddr()
+{
+	const unsigned char bytes[4] = { 127, 0, 0, 1 };
+	uint32_t addr;
+	memcpy(&addr, bytes, sizeof(addr));
+	return addr;
+}
+
+int ToNetPort(int port)
+{
+	const unsigned char bytes[2] = { (unsigned char)(port >> 8), (unsigned char)port };
+	uint16_t netPort;
+	memcpy(&netPort, bytes, sizeof(netPort));
+	return netPort;
+}
+
+void AppendString(std::vector<char> &buf, const std::string &str)
+{
+	buf.insert(buf.end(), str.c_str(), str.c_str() + str.size() + 1);
+}
+
+}
+
+/**
+ * Many stand-in servers, each on its own local port.
+ * Behavior of a server depends on its index, see the Is* methods.
+ */
+class CStandInFleet
+{
+public:
+	static bool IsSilent(int i) { return i % 10 == 9; }
+	static bool UsesChallenge(int i) { return i % 4 == 1; }
+	static bool UsesOldInfo(int i) { return i % 3 == 0; }
+	static bool HasLargeRules(int i) { return i % 5 == 2; }
+	static bool IsAG(int i) { return i % 2 == 0; }
+
+	static std::string GetName(int i) { return "Stand-in server #" + std::to_string(i); }
+	static std::string GetMap(int i) { return i % 7 == 0 ? "crossfire" : "stalkyard_" + std::to_string(i); }
+	static int GetPlayers(int i) { return i % 33; }
+
+	std::atomic<int> requestCount { 0 };
+
+	/**
+	 * @param	allAnswer	Whether silent servers answer too.
+	 * @param	latencyMs	Delay of every answer, like a server on the internet.
+	 */
+	CStandInFleet(int count, bool allAnswer = false, int latencyMs = 0)
+	    : m_bAllAnswer(allAnswer)
+	    , m_Latency(latencyMs)
+	{
+		for (int i = 0; i < count; i++)
+		{
+			auto server = std::make_unique<Server>();
+			server->index = i;
+			server->socket = NetOpenUdpSocket();
+			server->port = NetGetSocketPort(server->socket);
+			m_Servers.push_back(std::move(server));
+		}
+
+		for (int i = 0; i < FLEET_THREADS; i++)
+			m_Threads.emplace_back([this, i]() { ThreadFunc(i); });
+	}
+
+	~CStandInFleet()
+	{
+		m_bStop = true;
+
+		for (auto &i : m_Threads)
+			i.join();
+
+		for (auto &i : m_Servers)
+			NetCloseSocket(i->socket);
+	}
+
+	int GetCount() const { return (int)m_Servers.size(); }
+	bool IsValid(int i) const { return m_Servers[i]->socket != 0; }
+	int GetPort(int i) const { return m_Servers[i]->port; }
+
+	bool IsServerSilent(int i) const { return !m_bAllAnswer && IsSilent(i); }
+
+private:
+	struct Packet
+	{
+		Clock::time_point time;
+		unsigned long addr;
+		int port;
+		std::vector<char> data;
+	};
+
+	struct Server
+	{
+		int index;
+		NetSocket socket;
+		int port;
+		int responseID = 1;
+		std::deque<Packet> delayed;
+	};
+
+	std::vector<std::unique_ptr<Server>> m_Servers;
+	std::vector<std::thread> m_Threads;
+	std::atomic<bool> m_bStop { false };
+	bool m_bAllAnswer;
+	std::chrono::milliseconds m_Latency;
+
+	void ThreadFunc(int thread)
+	{
+		char buffer[2048];
+
+		while (!m_bStop)
+		{
+			bool isIdle = true;
+
+			for (size_t i = thread; i < m_Servers.size(); i += FLEET_THREADS)
+			{
+				Server &server = *m_Servers[i];
+				unsigned long addr;
+				int port;
+				int len;
+
+				while ((len = NetWaitReceiveUdp(server.socket, buffer, sizeof(buffer), &addr, &port, 0)) > 0)
+				{
+					isIdle = false;
+					requestCount++;
+					ProcessRequest(server, addr, port, buffer, len);
+				}
+
+				while (!server.delayed.empty() && server.delayed.front().time <= Clock::now())
+				{
+					Packet &packet = server.delayed.front();
+					NetSocket s = server.socket;
+					NetSendUdp(packet.addr, packet.port, packet.data.data(), (int)packet.data.size(), &s);
+					server.delayed.pop_front();
+				}
+
+				if (!server.delayed.empty())
+					isIdle = false;
+			}
+
+			if (isIdle)
+				std::this_thread::sleep_for(std::chrono::microseconds(200));
+		}
+	}
+
+	void Send(Server &server, unsigned long addr, int port, const std::vector<char> &data)
+	{
+		if (m_Latency.count() > 0)
+		{
+			server.delayed.push_back({ Clock::now() + m_Latency, addr, port, data });
+			return;
+		}
+
+		NetSocket s = server.socket;
+		NetSendUdp(addr, port, data.data(), (int)data.size(), &s);
+	}
+
+	void ProcessRequest(Server &server, unsigned long addr, int port, const char *request, int len)
+	{
+		int i = server.index;
+
+		if (IsServerSilent(i) || len < 9)
+			return;
+
+		bool isInfo = request[4] == 'T' && len >= 25 && !strcmp(request + 5, "Source Engine Query");
+		bool isRules = request[4] == 'V' && len == 9;
+
+		if (!isInfo && !isRules)
+			return;
+
+		if (UsesChallenge(i))
+		{
+			int challenge = -1;
+
+			if (isInfo && len == 25 + 4)
+				memcpy(&challenge, request + 25, 4);
+			else if (isRules)
+				memcpy(&challenge, request + 5, 4);
+
+			if (challenge != CHALLENGE)
+			{
+				std::vector<char> reply = { '\xFF', '\xFF', '\xFF', '\xFF', 'A' };
+				reply.insert(reply.end(), (const char *)&CHALLENGE, (const char *)&CHALLENGE + 4);
+				Send(server, addr, port, reply);
+				return;
+			}
+		}
+
+		if (isInfo)
+			Send(server, addr, port, MakeInfo(i));
+		else
+			SendSplit(server, addr, port, MakeRules(i));
+	}
+
+	std::vector<char> MakeInfo(int i)
+	{
+		std::vector<char> buf = { '\xFF', '\xFF', '\xFF', '\xFF' };
+
+		if (UsesOldInfo(i))
+		{
+			buf.push_back('m');
+			AppendString(buf, "127.0.0.1:" + std::to_string(m_Servers[i]->port));
+			AppendString(buf, GetName(i));
+			AppendString(buf, GetMap(i));
+			AppendString(buf, "valve");
+			AppendString(buf, "Half-Life");
+			buf.push_back((char)GetPlayers(i));
+			buf.push_back(32);
+			buf.push_back(47); // Protocol
+			buf.push_back('d');
+			buf.push_back('l');
+			buf.push_back(0); // Visibility
+			buf.push_back(1); // Mod
+			AppendString(buf, "http://example.com");
+			AppendString(buf, "");
+			buf.insert(buf.end(), 11, 0);
+			buf.push_back(1); // VAC
+			buf.push_back(2); // Bots
+		}
+		else
+		{
+			buf.push_back('I');
+			buf.push_back(48);
+			AppendString(buf, GetName(i));
+			AppendString(buf, GetMap(i));
+			AppendString(buf, "valve");
+			AppendString(buf, "Half-Life");
+			buf.push_back(70); // App ID
+			buf.push_back(0);
+			buf.push_back((char)GetPlayers(i));
+			buf.push_back(32);
+			buf.push_back(2); // Bots
+			buf.push_back('d');
+			buf.push_back('l');
+			buf.push_back(0); // Visibility
+			buf.push_back(1); // VAC
+			AppendString(buf, "1.1.2.7/Stdio");
+		}
+
+		return buf;
+	}
+
+	std::vector<char> MakeRules(int i)
+	{
+		std::vector<char> buf = { '\xFF', '\xFF', '\xFF', '\xFF', 'E', 0, 0 };
+		AppendString(buf, "mp_timelimit");
+		AppendString(buf, std::to_string(i % 60));
+		AppendString(buf, "mp_timeleft");
+		AppendString(buf, "0");
+
+		for (int j = 0; j < (HasLargeRules(i) ? 300 : 10); j++)
+		{
+			AppendString(buf, "sv_rule_" + std::to_string(j));
+			AppendString(buf, "value_" + std::to_string(j));
+		}
+
+		if (IsAG(i))
+		{
+			AppendString(buf, "sv_ag_version");
+			AppendString(buf, "6.6");
+		}
+
+		return buf;
+	}
+
+	void SendSplit(Server &server, unsigned long addr, int port, const std::vector<char> &response)
+	{
+		if ((int)response.size() <= SPLIT_PAYLOAD)
+		{
+			Send(server, addr, port, response);
+			return;
+		}
+
+		int total = ((int)response.size() + SPLIT_PAYLOAD - 1) / SPLIT_PAYLOAD;
+
+		// Last part first to check reordering
+		for (int j = total - 1; j >= 0; j--)
+		{
+			std::vector<char> packet = { '\xFE', '\xFF', '\xFF', '\xFF' };
+			packet.insert(packet.end(), (char *)&server.responseID, (char *)&server.responseID + 4);
+			packet.push_back((char)((j << 4) | total));
+			packet.insert(packet.end(), response.begin() + j * SPLIT_PAYLOAD,
+			    response.begin() + std::min((int)response.size(), (j + 1) * SPLIT_PAYLOAD));
+			Send(server, addr, port, packet);
+		}
+
+		server.responseID++;
+	}
+};
+
+class CServerPingerTest
+{
+public:
+	int Run();
+	[[noreturn]] void FatalError(const std::string &msg);
+
+private:
+	/**
+	 * Updates the pinger until the refresh is finished.
+	 * @returns number of updates
+	 */
+	int WaitForRefresh(CServerPinger &pinger);
+
+	void AddFleet(CServerPinger &pinger, const CStandInFleet &fleet);
+	void CheckResults(const CServerPinger &pinger, const CStandInFleet &fleet, bool queryRules);
+	void TestAddresses();
+	void TestFleet(int count);
+	void TestRestart();
+	void RunBenchmark();
+};
+
+int main()
+{
+	CServerPingerTest test;
+	return test.Run();
+}
+
+int CServerPingerTest::Run()
+{
+	TestAddresses();
+	TestFleet(100);
+	TestFleet(600); // More queries than the queue size
+	TestRestart();
+	RunBenchmark();
+	return 0;
+}
+
+void CServerPingerTest::FatalError(const std::string &msg)
+{
+	fprintf(stderr, "Fatal Error: %s\n", msg.c_str());
+	exit(1);
+}
+
+int CServerPingerTest::WaitForRefresh(CServerPinger &pinger)
+{
+	auto timeout = Clock::now() + std::chrono::seconds(20);
+	int updates = 0;
+
+	while (pinger.IsRefreshing())
+	{
+		if (Clock::now() > timeout)
+			FatalError("Refresh is not finished");
+
+		// Like a game frame
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		pinger.Update();
+		updates++;
+	}
+
+	return updates;
+}
+
+void CServerPingerTest::AddFleet(CServerPinger &pinger, const CStandInFleet &fleet)
+{
+	for (int i = 0; i < fleet.GetCount(); i++)
+	{
+		if (!fleet.IsValid(i))
+			FatalError("Can't open server socket");
+
+		std::string address = "127.0.0.1:" + std::to_string(fleet.GetPort(i));
+
+		if (!pinger.AddServer(address.c_str()))
+			FatalError("AddServer failed for " + address);
+	}
+}
+
+void CServerPingerTest::CheckResults(const CServerPinger &pinger, const CStandInFleet &fleet, bool queryRules)
+{
+	if (pinger.GetServerCount() != fleet.GetCount())
+		FatalError("Wrong server count " + std::to_string(pinger.GetServerCount()));
+
+	for (int i = 0; i < fleet.GetCount(); i++)
+	{
+		const CServerPinger::Server &server = pinger.GetServer(i);
+		std::string address = "127.0.0.1:" + std::to_string(fleet.GetPort(i));
+		std::string name = "Server " + std::to_string(i) + ": ";
+
+		if (server.address != address || server.isLan)
+			FatalError(name + "wrong address " + server.address);
+
+		if (fleet.IsServerSilent(i))
+		{
+			if (server.hasInfo || server.hasRules || !server.isTimedOut)
+				FatalError(name + "silent server has results");
+
+			continue;
+		}
+
+		if (!server.hasInfo || server.isTimedOut)
+			FatalError(name + "no info");
+
+		const CNetServerInfo &info = server.info;
+
+		if (info.name != CStandInFleet::GetName(i) || info.map != CStandInFleet::GetMap(i) || info.gameDir != "valve"
+		    || info.players != CStandInFleet::GetPlayers(i) || info.maxPlayers != 32 || info.bots != 2 || !info.isSecure)
+			FatalError(name + "wrong info");
+
+		if (server.ping <= 0 || server.ping > 5)
+			FatalError(name + "wrong ping " + std::to_string(server.ping));
+
+		if (server.hasRules != queryRules)
+			FatalError(name + "wrong rules state");
+
+		if (!queryRules)
+			continue;
+
+		const char *timelimit = server.rules.GetValue("mp_timelimit");
+		const char *agVersion = server.rules.GetValue("sv_ag_version");
+		int ruleCount = (CStandInFleet::HasLargeRules(i) ? 302 : 12) + (CStandInFleet::IsAG(i) ? 1 : 0);
+
+		if (!timelimit || atoi(timelimit) != i % 60 || (agVersion != nullptr) != CStandInFleet::IsAG(i) || server.rules.GetCount() != ruleCount)
+			FatalError(name + "wrong rules");
+	}
+}
+
+void CServerPingerTest::TestAddresses()
+{
+	fprintf(stderr, "Checking addresses\n");
+
+	CServerPinger pinger;
+	const char *valid[] = { "10.0.0.1", "10.0.0.1:27016", "192.168.1.20:27015", "10.0.0.1:27015" };
+	const char *invalid[] = { "", "example.com", "10.0.0.1:", "10.0.0.1:0", "10.0.0.1:70000", "10.0.0.1:27015x", "255.255.255.255", ":27015" };
+
+	for (const char *i : valid)
+	{
+		if (!pinger.AddServer(i))
+			FatalError(std::string("Valid address rejected: ") + i);
+	}
+
+	for (const char *i : invalid)
+	{
+		if (pinger.AddServer(i))
+			FatalError(std::string("Invalid address accepted: ") + i);
+	}
+
+	// 10.0.0.1 is the same as 10.0.0.1:27015
+	if (pinger.GetServerCount() != 3 || pinger.GetServer(0).address != "10.0.0.1:27015" || pinger.GetServer(1).address != "10.0.0.1:27016")
+		FatalError("Wrong server list");
+
+	pinger.ClearServers();
+
+	if (pinger.GetServerCount() != 0)
+		FatalError("ClearServers failed");
+
+	fprintf(stderr, "Good\n\n");
+}
+
+void CServerPingerTest::TestFleet(int count)
+{
+	fprintf(stderr, "Checking a fleet of %d servers\n", count);
+
+	CStandInFleet fleet(count);
+	CServerPinger pinger;
+	int finishedCount = 0;
+
+	AddFleet(pinger, fleet);
+	pinger.SetFinishedCallback([&]() { finishedCount++; });
+
+	for (bool queryRules : { false, true })
+	{
+		auto start = Clock::now();
+		finishedCount = 0;
+		pinger.Refresh(queryRules, false);
+		int updates = WaitForRefresh(pinger);
+		float time = std::chrono::duration<float>(Clock::now() - start).count();
+
+		if (finishedCount != 1)
+			FatalError("Finished callback is called " + std::to_string(finishedCount) + " times");
+
+		CheckResults(pinger, fleet, queryRules);
+
+		// Silent servers keep it running until the timeout
+		fprintf(stderr, "%s: %.2f s, %d updates\n", queryRules ? "Info and rules" : "Info", time, updates);
+	}
+
+	pinger.Shutdown();
+	fprintf(stderr, "Good\n\n");
+}
+
+void CServerPingerTest::TestRestart()
+{
+	fprintf(stderr, "Checking refresh restart\n");
+
+	CStandInFleet fleet(50, true);
+	CServerPinger pinger;
+	AddFleet(pinger, fleet);
+
+	// Results of the first refresh must not be counted in the second one
+	pinger.Refresh(true, false);
+	pinger.Update();
+	std::this_thread::sleep_for(std::chrono::milliseconds(5));
+	pinger.Refresh(true, false);
+	WaitForRefresh(pinger);
+	CheckResults(pinger, fleet, true);
+
+	fprintf(stderr, "Good\n\n");
+}
+
+void CServerPingerTest::RunBenchmark()
+{
+	fprintf(stderr, "Benchmark (%d servers with %d ms latency, info queries)\n", BENCH_SERVERS, BENCH_LATENCY_MS);
+
+	CStandInFleet fleet(BENCH_SERVERS, true, BENCH_LATENCY_MS);
+	double oldTime;
+
+	// Old way: one blocking call with a new socket per server
+	{
+		char buffer[2048];
+		auto start = Clock::now();
+
+		for (int i = 0; i < BENCH_SERVERS; i++)
+		{
+			if (NetSendReceiveUdp(LoopbackAddr(), ToNetPort(fleet.GetPort(i)), "\xFF\xFF\xFF\xFFTSource Engine Query", 25, buffer, sizeof(buffer)) <= 0)
+				FatalError("NetSendReceiveUdp failed");
+		}
+
+		double time = std::chrono::duration<double>(Clock::now() - start).count();
+		oldTime = time;
+		fprintf(stderr, "NetSendReceiveUdp in a loop: %7.1f ms per list, %8.0f queries/s\n", time * 1000, BENCH_SERVERS / time);
+	}
+
+	// Pinger updated without frame sleeps
+	{
+		CServerPinger pinger;
+		AddFleet(pinger, fleet);
+
+		auto start = Clock::now();
+
+		for (int round = 0; round < BENCH_ROUNDS; round++)
+		{
+			pinger.Refresh(false, false);
+
+			while (pinger.IsRefreshing())
+				pinger.Update();
+
+			for (int i = 0; i < BENCH_SERVERS; i++)
+			{
+				if (!pinger.GetServer(i).hasInfo)
+					FatalError("No info in benchmark");
+			}
+		}
+
+		double time = std::chrono::duration<double>(Clock::now() - start).count() / BENCH_ROUNDS;
+		fprintf(stderr, "CServerPinger:               %7.1f ms per list, %8.0f queries/s\n", time * 1000, BENCH_SERVERS / time);
+		fprintf(stderr, "Speedup: %.1fx\n", oldTime / time);
+	}
+}
@@ -0,0 +1,512 @@
+//
+// Shadow volume kernel test.
+//
+// Checks that all shadow volume kernels supported by the CPU produce the same
+// vertex and index buffers as the reference implementation (the original
+// DrawShadowVolume loop) and prints their timings.
+//
+// Usage: test_shadow [model.mdl...]
+// Without arguments only synthetic models are tested.
+//
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+#include <studio_shadow.h>
+
+// studio.h only needs these to describe the file layout
+typedef unsigned char byte;
+typedef int32_t int32;
+struct Vector
+{
+	float x, y, z;
+};
+#include <studio.h>
+
+namespace
+{
+
+constexpr int BENCH_ITERATIONS = 200;
+constexpr float PI = 3.14159265358979f;
+
+/**
+ * Geometry of one submodel.
+ */
+struct ShadowTestModel
+{
+	std::string name;
+	std::vector<float> verts; // 3 floats per vertex
+	std::vector<uint8_t> vertBones;
+	std::vector<std::vector<short>> tricmds; // for each mesh
+	int numBones = 1;
+};
+
+/**
+ * Output of a kernel.
+ */
+struct VolumeResult
+{
+	std::vector<float> verts;
+	std::vector<uint16_t> indexes;
+};
+
+}
+
+class CShadowTest
+{
+public:
+	int Run(int argc, char **argv);
+	[[noreturn]] void FatalError(const std::string &msg);
+
+private:
+	std::mt19937 m_Rand { 1337 };
+	std::vector<uint8_t> m_FaceLight = std::vector<uint8_t>(ShadowFaceLightSize);
+	int m_iSubModelCount = 0;
+	double m_flTotalTime[(int)ShadowKernel::Count] = {};
+
+	/**
+	 * Creates a sphere-like mesh made of triangle strips and fans.
+	 * Open mesh has no bottom cap, so some edges only have one face.
+	 */
+	ShadowTestModel CreateSyntheticModel(int rings, int segments, int numBones, bool closed);
+
+	/**
+	 * Loads all submodels of a studio model.
+	 */
+	void LoadStudioModel(const char *path, std::vector<ShadowTestModel> &out);
+
+	/**
+	 * Runs all kernels on a submodel with several light directions and compares them with the reference.
+	 */
+	void TestModel(const ShadowTestModel &model);
+
+	/**
+	 * Original scalar implementation from DrawShadowVolume.
+	 */
+	void BuildReference(const ShadowVolumeParams &params, const SubModelData &data, VolumeResult &out);
+
+	void BuildKernel(ShadowKernel kernel, const ShadowVolumeParams &params, const SubModelData &data, VolumeResult &out);
+	void CompareResults(const VolumeResult &ref, const VolumeResult &res, const ShadowTestModel &model, ShadowKernel kernel);
+	void FillRandomBones(std::vector<float> &bones, int numBones);
+};
+
+int main(int argc, char **argv)
+{
+	CShadowTest test;
+	return test.Run(argc, argv);
+}
+
+int CShadowTest::Run(int argc, char **argv)
+{
+	std::vector<ShadowTestModel> models;
+
+	models.push_back(CreateSyntheticModel(4, 6, 1, true));
+	models.push_back(CreateSyntheticModel(5, 7, 2, false));
+	models.push_back(CreateSyntheticModel(16, 24, 8, true));
+	models.push_back(CreateSyntheticModel(40, 60, 64, false));
+
+	for (int i = 1; i < argc; i++)
+		LoadStudioModel(argv[i], models);
+
+	for (int i = 0; i < (int)ShadowKernel::Count; i++)
+	{
+		ShadowKernel kernel = (ShadowKernel)i;
+		fprintf(stderr, "Kernel %s: %s\n", ShadowGetKernelName(kernel), ShadowIsKernelSupported(kernel) ? "supported" : "not supported");
+	}
+
+	fprintf(stderr, "Best kernel: %s\n\n", ShadowGetKernelName(ShadowGetBestKernel()));
+
+	for (const ShadowTestModel &model : models)
+		TestModel(model);
+
+	fprintf(stderr, "\nAverage time per submodel:\n");
+
+	for (int i = 0; i < (int)ShadowKernel::Count; i++)
+	{
+		if (!ShadowIsKernelSupported((ShadowKernel)i))
+			continue;
+
+		double ns = m_flTotalTime[i] / (m_iSubModelCount * BENCH_ITERATIONS);
+		fprintf(stderr, "  %-8s %10.0f ns\n", ShadowGetKernelName((ShadowKernel)i), ns);
+	}
+
+	fprintf(stderr, "\nAll %d submodels match\n", m_iSubModelCount);
+	return 0;
+}
+
+void CShadowTest::FatalError(const std::string &msg)
+{
+	fprintf(stderr, "Fatal Error: %s\n", msg.c_str());
+	exit(1);
+}
+
+ShadowTestModel CShadowTest::CreateSyntheticModel(int rings, int segments, int numBones, bool closed)
+{
+	ShadowTestModel model;
+	model.name = "synthetic " + std::to_string(rings) + "x" + std::to_string(segments) + (closed ? " closed" : " open");
+	model.numBones = numBones;
+
+	std::uniform_real_distribution<float> jitter(-0.05f, 0.05f);
+	std::uniform_int_distribution<int> bone(0, numBones - 1);
+
+	auto fnAddVertex = [&](float x, float y, float z) {
+		model.verts.push_back(x * 16 + jitter(m_Rand));
+		model.verts.push_back(y * 16 + jitter(m_Rand));
+		model.verts.push_back(z * 32 + jitter(m_Rand));
+		model.vertBones.push_back((uint8_t)bone(m_Rand));
+	};
+
+	// Poles, then rings from top to bottom
+	fnAddVertex(0, 0, 1);
+	fnAddVertex(0, 0, -1);
+
+	for (int r = 0; r < rings; r++)
+	{
+		float phi = PI * (r + 1) / (rings + 1);
+
+		for (int s = 0; s < segments; s++)
+		{
+			float theta = 2 * PI * s / segments;
+			fnAddVertex(sinf(phi) * cosf(theta), sinf(phi) * sinf(theta), cosf(phi));
+		}
+	}
+
+	auto fnRingVertex = [&](int r, int s) {
+		return (short)(2 + r * segments + (s % segments));
+	};
+
+	// Each tricmd vertex is 4 shorts: vertex, normal, s, t
+	auto fnPush = [](std::vector<short> &cmds, short vert) {
+		cmds.push_back(vert);
+		cmds.push_back(0);
+		cmds.push_back(0);
+		cmds.push_back(0);
+	};
+
+	// Top cap fan in one mesh, body strips in another, bottom fan in the last
+	std::vector<short> top, body, bottom;
+
+	top.push_back((short)-(segments + 2));
+	fnPush(top, 0);
+	for (int s = 0; s <= segments; s++)
+		fnPush(top, fnRingVertex(0, s));
+	top.push_back(0);
+
+	for (int r = 0; r + 1 < rings; r++)
+	{
+		body.push_back((short)(2 * (segments + 1)));
+		for (int s = 0; s <= segments; s++)
+		{
+			fnPush(body, fnRingVertex(r, s));
+			fnPush(body, fnRingVertex(r + 1, s));
+		}
+	}
+	body.push_back(0);
+
+	if (closed)
+	{
+		bottom.push_back((short)-(segments + 2));
+		fnPush(bottom, 1);
+		for (int s = 0; s <= segments; s++)
+			fnPush(bottom, fnRingVertex(rings - 1, segments - s));
+	}
+	bottom.push_back(0);
+
+	model.tricmds.push_back(std::move(top));
+	model.tricmds.push_back(std::move(body));
+	model.tricmds.push_back(std::move(bottom));
+	return model;
+}
+
+void CShadowTest::LoadStudioModel(const char *path, std::vector<ShadowTestModel> &out)
+{
+	std::ifstream file(path, std::ios::binary);
+	if (!file)
+		FatalError(std::string("Failed to open ") + path);
+
+	std::vector<uint8_t> buf((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+	if (buf.size() < sizeof(studiohdr_t))
+		FatalError(std::string(path) + " is too small");
+
+	const byte *base = buf.data();
+	const studiohdr_t *hdr = (const studiohdr_t *)base;
+
+	if (memcmp(&hdr->id, "IDST", 4) != 0 || hdr->version != 10 || hdr->length > (int)buf.size())
+		FatalError(std::string(path) + " is not a studio model");
+
+	// Offsets aren't validated, test models are trusted
+	const mstudiobodyparts_t *bp = (const mstudiobodyparts_t *)(base + hdr->bodypartindex);
+	int count = 0;
+
+	for (int i = 0; i < hdr->numbodyparts; i++)
+	{
+		const mstudiomodel_t *sm = (const mstudiomodel_t *)(base + bp[i].modelindex);
+
+		for (int j = 0; j < bp[i].nummodels; j++)
+		{
+			if (sm[j].numverts == 0 || sm[j].nummesh == 0)
+				continue;
+
+			ShadowTestModel model;
+			model.name = std::string(path) + ": " + sm[j].name;
+			model.numBones = hdr->numbones > 0 ? hdr->numbones : 1;
+
+			const float *verts = (const float *)(base + sm[j].vertindex);
+			const byte *vertBones = base + sm[j].vertinfoindex;
+			model.verts.assign(verts, verts + sm[j].numverts * 3);
+			model.vertBones.assign(vertBones, vertBones + sm[j].numverts);
+
+			const mstudiomesh_t *pmeshes = (const mstudiomesh_t *)(base + sm[j].meshindex);
+
+			for (int k = 0; k < sm[j].nummesh; k++)
+			{
+				const short *start = (const short *)(base + pmeshes[k].triindex);
+				const short *ptricmds = start;
+				int n;
+
+				while ((n = *(ptricmds++)))
+					ptricmds += 4 * std::abs(n);
+
+				model.tricmds.emplace_back(start, ptricmds);
+			}
+
+			out.push_back(std::move(model));
+			count++;
+		}
+	}
+
+	fprintf(stderr, "Loaded %d submodels from %s\n", count, path);
+}
+
+void CShadowTest::TestModel(const ShadowTestModel &model)
+{
+	std::vector<const short *> tricmds;
+
+	for (const std::vector<short> &i : model.tricmds)
+		tricmds.push_back(i.data());
+
+	SubModelData data;
+	ShadowBuildSubModel(data, tricmds.data(), (int)tricmds.size());
+
+	if (data.faces.empty())
+		return;
+
+	// Data loaded from the cache must give the same result
+	ModelExtraData extra, cached;
+	std::vector<uint8_t> cache;
+	extra.submodels.push_back(data);
+	ShadowCacheWrite(extra, 1234, cache);
+
+	std::vector<int> numVerts = { (int)model.vertBones.size() };
+
+	if (!ShadowCacheRead(cache.data(), cache.size(), 1234, numVerts, cached))
+		FatalError(model.name + ": failed to read shadow cache");
+
+	// Cache of another model with the same length but fewer vertices
+	ModelExtraData foreign;
+	numVerts[0]--;
+
+	if (ShadowCacheRead(cache.data(), cache.size(), 1234, numVerts, foreign))
+		FatalError(model.name + ": shadow cache with out of range vertices was accepted");
+
+	std::vector<float> bones;
+	FillRandomBones(bones, model.numBones);
+
+	ShadowVolumeParams params;
+	params.verts = (const float(*)[3])model.verts.data();
+	params.vertBones = model.vertBones.data();
+	params.numVerts = (int)model.vertBones.size();
+	params.bones = (const float(*)[3][4])bones.data();
+	params.numBones = model.numBones;
+
+	std::uniform_real_distribution<float> dir(-1.0f, 1.0f);
+	VolumeResult ref, res;
+
+	for (int light = 0; light < 8; light++)
+	{
+		float len;
+
+		do
+		{
+			params.lightDir[0] = dir(m_Rand);
+			params.lightDir[1] = dir(m_Rand);
+			params.lightDir[2] = dir(m_Rand);
+			len = sqrtf(params.lightDir[0] * params.lightDir[0] + params.lightDir[1] * params.lightDir[1] + params.lightDir[2] * params.lightDir[2]);
+		} while (len < 0.1f);
+
+		for (int i = 0; i < 3; i++)
+		{
+			params.lightDir[i] /= len;
+			params.extrude[i] = params.lightDir[i] * 256;
+		}
+
+		BuildReference(params, data, ref);
+
+		for (int i = 0; i < (int)ShadowKernel::Count; i++)
+		{
+			ShadowKernel kernel = (ShadowKernel)i;
+
+			if (!ShadowIsKernelSupported(kernel))
+				continue;
+
+			BuildKernel(kernel, params, data, res);
+			CompareResults(ref, res, model, kernel);
+
+			BuildKernel(kernel, params, cached.submodels[0], res);
+			CompareResults(ref, res, model, kernel);
+		}
+	}
+
+	// Benchmark with the last light direction
+	fprintf(stderr, "%s: %d verts, %d faces, %d edges, %d indexes\n", model.name.c_str(), params.numVerts,
+	    (int)data.faces.size(), (int)data.edges.size(), (int)ref.indexes.size());
+
+	for (int i = 0; i < (int)ShadowKernel::Count; i++)
+	{
+		ShadowKernel kernel = (ShadowKernel)i;
+
+		if (!ShadowIsKernelSupported(kernel))
+			continue;
+
+		auto start = std::chrono::high_resolution_clock::now();
+
+		for (int j = 0; j < BENCH_ITERATIONS; j++)
+			ShadowBuildVolume(kernel, params, data, (float(*)[3])res.verts.data(), res.indexes.data(), m_FaceLight.data());
+
+		auto end = std::chrono::high_resolution_clock::now();
+		m_flTotalTime[i] += std::chrono::duration<double, std::nano>(end - start).count();
+	}
+
+	m_iSubModelCount++;
+}
+
+void CShadowTest::BuildReference(const ShadowVolumeParams &params, const SubModelData &data, VolumeResult &out)
+{
+	out.verts.assign(params.numVerts * 2 * 3, 0.0f);
+	out.indexes.clear();
+
+	float(*vertexdata)[3] = (float(*)[3])out.verts.data();
+
+	int i, j;
+	for (i = 0, j = 0; i < params.numVerts; i++, j += 2)
+	{
+		const float *in = params.verts[i];
+		const float(*m)[4] = params.bones[params.vertBones[i] < params.numBones ? params.vertBones[i] : 0];
+
+		// VectorTransform
+		for (int k = 0; k < 3; k++)
+			vertexdata[j][k] = (in[0] * m[k][0] + in[1] * m[k][1] + in[2] * m[k][2]) + m[k][3];
+
+		// VectorSubtract
+		for (int k = 0; k < 3; k++)
+			vertexdata[j + 1][k] = vertexdata[j][k] - params.extrude[k];
+	}
+
+	std::vector<bool> facelight(data.faces.size());
+
+	for (i = 0; i < (int)data.faces.size(); i++)
+	{
+		const Face &f = data.faces[i];
+		float v1[3], v2[3], norm[3];
+
+		for (int k = 0; k < 3; k++)
+		{
+			v1[k] = vertexdata[f.vertex1][k] - vertexdata[f.vertex0][k];
+			v2[k] = vertexdata[f.vertex2][k] - vertexdata[f.vertex1][k];
+		}
+
+		// CrossProduct(v2, v1, norm)
+		norm[0] = v2[1] * v1[2] - v2[2] * v1[1];
+		norm[1] = v2[2] * v1[0] - v2[0] * v1[2];
+		norm[2] = v2[0] * v1[1] - v2[1] * v1[0];
+
+		float dot = norm[0] * params.lightDir[0] + norm[1] * params.lightDir[1] + norm[2] * params.lightDir[2];
+		facelight[i] = (dot >= 0);
+	}
+
+	for (const Edge &e : data.edges)
+	{
+		uint16_t a, b;
+
+		if (facelight[e.face0])
+		{
+			if ((e.face1 != ShadowEdgeNoFace) && facelight[e.face1])
+				continue;
+
+			a = e.vertex0;
+			b = e.vertex1;
+		}
+		else
+		{
+			if ((e.face1 == ShadowEdgeNoFace) || !facelight[e.face1])
+				continue;
+
+			a = e.vertex1;
+			b = e.vertex0;
+		}
+
+		uint16_t quad[6] = { a, b, (uint16_t)(a + 1), (uint16_t)(a + 1), b, (uint16_t)(b + 1) };
+		out.indexes.insert(out.indexes.end(), quad, quad + 6);
+	}
+}
+
+void CShadowTest::BuildKernel(ShadowKernel kernel, const ShadowVolumeParams &params, const SubModelData &data, VolumeResult &out)
+{
+	out.verts.assign(params.numVerts * 2 * 3, 0.0f);
+	out.indexes.assign(6 * (data.edges.size() + 1), 0);
+
+	// Garbage in the scratch buffer must not affect the result
+	memset(m_FaceLight.data(), 0xCD, m_FaceLight.size());
+
+	int numIndexes = ShadowBuildVolume(kernel, params, data, (float(*)[3])out.verts.data(), out.indexes.data(), m_FaceLight.data());
+	out.indexes.resize(numIndexes);
+}
+
+void CShadowTest::CompareResults(const VolumeResult &ref, const VolumeResult &res, const ShadowTestModel &model, ShadowKernel kernel)
+{
+	std::string prefix = model.name + " (" + ShadowGetKernelName(kernel) + "): ";
+
+	if (ref.verts.size() != res.verts.size() || memcmp(ref.verts.data(), res.verts.data(), ref.verts.size() * sizeof(float)) != 0)
+		FatalError(prefix + "vertex buffer doesn't match");
+
+	if (ref.indexes.size() != res.indexes.size())
+		FatalError(prefix + "index count " + std::to_string(res.indexes.size()) + " != " + std::to_string(ref.indexes.size()));
+
+	if (memcmp(ref.indexes.data(), res.indexes.data(), ref.indexes.size() * sizeof(uint16_t)) != 0)
+		FatalError(prefix + "index buffer doesn't match");
+}
+
+void CShadowTest::FillRandomBones(std::vector<float> &bones, int numBones)
+{
+	std::uniform_real_distribution<float> angle(-PI, PI);
+	std::uniform_real_distribution<float> origin(-512.0f, 512.0f);
+
+	bones.resize(numBones * 12);
+
+	for (int i = 0; i < numBones; i++)
+	{
+		// Rotation around Z then X, like a bone of an animated model
+		float yaw = angle(m_Rand), pitch = angle(m_Rand);
+		float sy = sinf(yaw), cy = cosf(yaw), sp = sinf(pitch), cp = cosf(pitch);
+		float *m = &bones[i * 12];
+
+		m[0] = cy;
+		m[1] = -sy * cp;
+		m[2] = sy * sp;
+		m[3] = origin(m_Rand);
+		m[4] = sy;
+		m[5] = cy * cp;
+		m[6] = -cy * sp;
+		m[7] = origin(m_Rand);
+		m[8] = 0;
+		m[9] = sp;
+		m[10] = cp;
+		m[11] = origin(m_Rand);
+	}
+}
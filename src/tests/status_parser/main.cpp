@@ -0,0 +1,552 @@
+//
+// Status parser test.
+//
+// Feeds CStatusParser with "status" responses of HLDS and ReHLDS servers
+// the way they arrive in svc_print messages, checks parsed rows and
+// that any other split of the same text gives the same result.
+//
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+#include <status_parser.h>
+
+namespace
+{
+
+constexpr int RANDOM_SPLITS = 200;
+constexpr int BENCH_ITERATIONS = 2000;
+
+struct ExpectedRow
+{
+	int index;
+	const char *name;
+	int userid;
+	const char *uniqueid;
+};
+
+struct Response
+{
+	const char *title;
+	std::vector<std::string> messages; //!< svc_print messages, starting with "hostname:  "
+	std::vector<ExpectedRow> rows;
+	size_t endMessage; //!< Index of the message with the end of the table
+};
+
+struct Player
+{
+	const char *name;
+	int userid;
+	const char *uniqueid;
+	bool fake;
+};
+
+std::string Format(const char *fmt, ...)
+{
+	char buf[1024];
+	va_list args;
+	va_start(args, fmt);
+	vsnprintf(buf, sizeof(buf), fmt, args);
+	va_end(args);
+	return buf;
+}
+
+/**
+ * Builds messages the way Host_Status_f prints them: every print call is a separate svc_print,
+ * so each row is split into several messages.
+ */
+Response MakeHldsResponse(const char *title, const char *version, const char *map, const std::vector<Player> &players)
+{
+	Response r;
+	r.title = title;
+
+	r.messages.push_back("hostname:  Half-Life Deathmatch #1 | 24/7 crossfire\n");
+	r.messages.push_back(Format("version :  %s\n", version));
+	r.messages.push_back("tcp/ip  :  192.168.1.2:27015\n");
+	r.messages.push_back(Format("map     :  %s at: 0 x, 0 y, 0 z\n", map));
+	r.messages.push_back(Format("players :  %d active (32 max)\n\n", (int)players.size()));
+	r.messages.push_back("#      name userid uniqueid frag time ping loss adr\n");
+
+	int index = 1;
+
+	for (const Player &p : players)
+	{
+		std::string quoted = Format("\"%s\"", p.name);
+		r.messages.push_back(Format("#%2i %8s %i %s", index, quoted.c_str(), p.userid, p.uniqueid));
+		r.messages.push_back(Format(" %3i", index * 3));
+		r.messages.push_back(Format(" %s", "12:34"));
+		r.messages.push_back(Format(" %4i", p.fake ? 0 : 40 + index));
+		r.messages.push_back(Format(" %4i", 0));
+
+		if (!p.fake)
+			r.messages.push_back(Format(" %s\n", "10.0.0.7:27005"));
+		else
+			r.messages.push_back("\n");
+
+		r.rows.push_back({ index, p.name, p.userid, p.uniqueid });
+		index++;
+	}
+
+	r.messages.push_back(Format("%i users\n", (int)players.size()));
+	r.endMessage = r.messages.size() - 1;
+
+	return r;
+}
+
+std::vector<Response> MakeCorpus()
+{
+	std::vector<Response> corpus;
+
+	corpus.push_back(MakeHldsResponse("HLDS, two players and a bot", "48/1.1.2.7/Stdio 8684 secure  (70)", "crossfire",
+	    {
+	        { "Player", 2, "STEAM_0:1:12345", false },
+	        { "[POD]Bot", 3, "BOT", true },
+	        { "sheriff", 5, "STEAM_0:0:9876543", false },
+	    }));
+
+	corpus.push_back(MakeHldsResponse("HLDS, empty server", "48/1.1.2.7/Stdio 8684 secure  (70)", "stalkyard", {}));
+
+	corpus.push_back(MakeHldsResponse("HLDS LAN, spaces and UTF-8 in names", "48/1.1.2.7/Stdio 8684 insecure  (70)", "datacore",
+	    {
+	        { "a b  c", 12, "VALVE_ID_LAN", false },
+	        { "  leading", 13, "STEAM_ID_LAN", false },
+	        { "\xd0\x98\xd0\xb3\xd1\x80\xd0\xbe\xd0\xba", 14, "STEAM_ID_PENDING", false },
+	        { "#1 \"quoted\"", 15, "VALVE_0:1:555", false },
+	        { "", 16, "STEAM_0:1:1", false },
+	    }));
+
+	{
+		// Slots above 9 and a full-length name
+		std::vector<Player> players;
+		static char names[14][32];
+		static char ids[14][32];
+
+		for (int i = 0; i < 14; i++)
+		{
+			snprintf(names[i], sizeof(names[i]), "player%02d_with_a_long_name_xx", i);
+			snprintf(ids[i], sizeof(ids[i]), "STEAM_0:%d:%d", i & 1, 100000 + i * 7919);
+			players.push_back({ names[i], 100 + i, ids[i], false });
+		}
+
+		corpus.push_back(MakeHldsResponse("ReHLDS, 14 players", "48/1.1.2.7/Stdio 3.13.0.788-dev secure  (70)", "boot_camp", players));
+	}
+
+	{
+		// AMX Mod X status replacement and HLTV proxy: whole rows in one message
+		Response r;
+		r.title = "Single message rows with HLTV";
+		r.messages = {
+			"hostname:  [EU] Bugfixed HL\n"
+			"version :  48/1.1.2.7/Stdio 3.13.0.788 secure  (70)\n"
+			"tcp/ip  :  45.13.12.11:27015\n"
+			"map     :  rapidcore at: 0 x, 0 y, 0 z\n"
+			"players :  3 active (18 max)\n"
+			"\n"
+			"#      name userid uniqueid frag time ping loss adr\n"
+			"# 1 \"HLTV\" 1 HLTV hltv:2/128 delay:30 1:02:03 10.0.0.1:27020\n",
+			"# 2 \"Shield\" 4 STEAM_0:0:40001   7 05:11   61    0 10.0.0.2:27005\n"
+			"#10 \"late joiner\" 41 STEAM_0:1:7   0 00:05  120    2 10.0.0.3:27005\n"
+			"3 users\n",
+		};
+		r.rows = {
+			{ 1, "HLTV", 1, "HLTV" },
+			{ 2, "Shield", 4, "STEAM_0:0:40001" },
+			{ 10, "late joiner", 41, "STEAM_0:1:7" },
+		};
+		r.endMessage = 1;
+		corpus.push_back(r);
+	}
+
+	{
+		// Row split in the middle of the name and the uniqueid
+		Response r;
+		r.title = "Rows split at arbitrary points";
+		r.messages = {
+			"hostname:  test\n",
+			"#      name userid uniqueid frag ti",
+			"me ping loss adr\n# 1 \"Spl",
+			"it Name\" 7 STEAM_0:1:",
+			"424242 3 00:10 50 0 10.0.0.9:27005",
+			"\n# 2 \"x\" 8 BOT",
+			"   0 00:10    0    0\n",
+			"2 users\n",
+		};
+		r.rows = {
+			{ 1, "Split Name", 7, "STEAM_0:1:424242" },
+			{ 2, "x", 8, "BOT" },
+		};
+		r.endMessage = 7;
+		corpus.push_back(r);
+	}
+
+	return corpus;
+}
+
+std::string Concat(const Response &r)
+{
+	std::string text;
+
+	for (const std::string &msg : r.messages)
+		text += msg;
+
+	return text;
+}
+
+}
+
+class CStatusParserTest
+{
+public:
+	int Run();
+	[[noreturn]] void FatalError(const std::string &msg);
+
+private:
+	std::vector<Response> m_Corpus;
+
+	void TestCorpus();
+	void TestRandomSplits();
+	void TestRows();
+	void TestLongLines();
+	void TestInterleavedPrints();
+	void RunBenchmark();
+
+	/**
+	 * Feeds messages into the parser.
+	 * @returns index of the message with the end of the table or -1.
+	 */
+	int Parse(CStatusParser &parser, const std::vector<std::string> &messages, std::vector<CStatusParser::Row> &rows);
+
+	void CheckRows(const Response &r, const std::vector<CStatusParser::Row> &rows);
+};
+
+int main()
+{
+	CStatusParserTest test;
+	return test.Run();
+}
+
+int CStatusParserTest::Run()
+{
+	m_Corpus = MakeCorpus();
+
+	TestRows();
+	TestCorpus();
+	TestRandomSplits();
+	TestLongLines();
+	TestInterleavedPrints();
+	RunBenchmark();
+
+	return 0;
+}
+
+void CStatusParserTest::FatalError(const std::string &msg)
+{
+	fprintf(stderr, "Fatal Error: %s\n", msg.c_str());
+	exit(1);
+}
+
+int CStatusParserTest::Parse(CStatusParser &parser, const std::vector<std::string> &messages, std::vector<CStatusParser::Row> &rows)
+{
+	rows.clear();
+	parser.Begin();
+
+	for (size_t i = 0; i < messages.size(); i++)
+	{
+		if (parser.Feed(messages[i].c_str(), [&](const CStatusParser::Row &row) { rows.push_back(row); }) == CStatusParser::FeedResult::End)
+		{
+			if (parser.IsActive())
+				FatalError("Parser is active after the end of the table");
+
+			return (int)i;
+		}
+	}
+
+	return -1;
+}
+
+void CStatusParserTest::CheckRows(const Response &r, const std::vector<CStatusParser::Row> &rows)
+{
+	if (rows.size() != r.rows.size())
+		FatalError(std::string(r.title) + ": expected " + std::to_string(r.rows.size()) + " rows, got " + std::to_string(rows.size()));
+
+	for (size_t i = 0; i < rows.size(); i++)
+	{
+		const ExpectedRow &e = r.rows[i];
+		const CStatusParser::Row &row = rows[i];
+
+		if (row.index != e.index || row.userid != e.userid || strcmp(row.name, e.name) || strcmp(row.uniqueid, e.uniqueid))
+		{
+			FatalError(std::string(r.title) + ": row " + std::to_string(i) + " is #" + std::to_string(row.index) + " \""
+			    + row.name + "\" " + std::to_string(row.userid) + " " + row.uniqueid + ", expected \"" + e.name + "\"");
+		}
+	}
+}
+
+void CStatusParserTest::TestRows()
+{
+	fprintf(stderr, "Checking single rows\n");
+
+	struct
+	{
+		const char *line;
+		bool isRow;
+	} checks[] = {
+		{ "#      name userid uniqueid frag time ping loss adr", false },
+		{ "# 1 \"Player\" 2 STEAM_0:1:12345   0 00:10   10    0 127.0.0.1:27005", true },
+		{ "#32 \"Player\" 2 STEAM_0:1:12345", true },
+		{ "# 1 \"Player\" 2 ", false }, // No uniqueid
+		{ "# 1 \"Player\" STEAM_0:1:1", false }, // No userid
+		{ "# 1 \"Player 2 STEAM_0:1:1", false }, // Unterminated name
+		{ "# 1 Player 2 STEAM_0:1:1", false },
+		{ "#1 \"Player\" 2 STEAM_0:1:1", false },
+		{ "3 users", false },
+		{ "", false },
+		{ "#", false },
+	};
+
+	for (auto &check : checks)
+	{
+		CStatusParser::Row row;
+
+		if (CStatusParser::ParseRow(check.line, row) != check.isRow)
+			FatalError(std::string("Wrong result for line: ") + check.line);
+	}
+
+	fprintf(stderr, "Good\n\n");
+}
+
+void CStatusParserTest::TestCorpus()
+{
+	fprintf(stderr, "Checking corpus\n");
+
+	CStatusParser parser;
+	std::vector<CStatusParser::Row> rows;
+
+	for (const Response &r : m_Corpus)
+	{
+		int end = Parse(parser, r.messages, rows);
+
+		if (end != (int)r.endMessage)
+			FatalError(std::string(r.title) + ": end of the table in message " + std::to_string(end));
+
+		CheckRows(r, rows);
+
+		fprintf(stderr, "%-40s %2d rows, %3d lines, %3d messages, %6.1f us\n", r.title, parser.GetRowCount(),
+		    parser.GetLineCount(), parser.GetMessageCount(), parser.GetParseTime());
+	}
+
+	// Text after the end of the table belongs to other output
+	std::vector<std::string> messages = m_Corpus[0].messages;
+	messages.push_back("# 9 \"Ghost\" 99 STEAM_0:0:1\n");
+	Parse(parser, messages, rows);
+	CheckRows(m_Corpus[0], rows);
+
+	if (parser.Feed("# 9 \"Ghost\" 99 STEAM_0:0:1\n", [&](const CStatusParser::Row &row) { rows.push_back(row); }) != CStatusParser::FeedResult::Ignored)
+		FatalError("Inactive parser didn't ignore text");
+
+	fprintf(stderr, "Good\n\n");
+}
+
+void CStatusParserTest::TestRandomSplits()
+{
+	fprintf(stderr, "Checking random splits of the corpus\n");
+
+	std::mt19937 rng(1234);
+	CStatusParser parser;
+	std::vector<CStatusParser::Row> rows;
+	std::vector<std::string> messages;
+	int checks = 0;
+
+	for (const Response &r : m_Corpus)
+	{
+		std::string text = Concat(r);
+
+		// Every split into two messages
+		for (size_t i = 1; i < text.size(); i++)
+		{
+			messages = { text.substr(0, i), text.substr(i) };
+
+			if (Parse(parser, messages, rows) < 0)
+				FatalError(std::string(r.title) + ": end of the table not found, split at " + std::to_string(i));
+
+			CheckRows(r, rows);
+			checks++;
+		}
+
+		// Random splits, some messages are a single character
+		for (int it = 0; it < RANDOM_SPLITS; it++)
+		{
+			messages.clear();
+			size_t pos = 0;
+
+			while (pos < text.size())
+			{
+				size_t len = 1 + rng() % ((it & 1) ? 4 : 64);
+				messages.push_back(text.substr(pos, len));
+				pos += len;
+			}
+
+			if (Parse(parser, messages, rows) < 0)
+				FatalError(std::string(r.title) + ": end of the table not found in random split");
+
+			CheckRows(r, rows);
+			checks++;
+		}
+	}
+
+	fprintf(stderr, "%d splits checked\n", checks);
+	fprintf(stderr, "Good\n\n");
+}
+
+void CStatusParserTest::TestLongLines()
+{
+	fprintf(stderr, "Checking long lines\n");
+
+	CStatusParser parser;
+	std::vector<CStatusParser::Row> rows;
+
+	// Long name is truncated, long line doesn't overflow the buffer
+	std::string longName(200, 'n');
+	std::string longAddr(4 * CStatusParser::MAX_LINE_LENGTH, '1');
+	std::vector<std::string> messages = {
+		"hostname:  long\n",
+		"#      name userid uniqueid frag time ping loss adr\n",
+		"# 1 \"" + longName + "\" 5 STEAM_0:0:5 0 00:01 5 0 ",
+		longAddr,
+		longAddr + "\n",
+		"# 2 \"short\" 6 STEAM_0:0:6\n",
+		"2 users\n",
+	};
+
+	if (Parse(parser, messages, rows) != 6)
+		FatalError("End of the table not found after a long line");
+
+	if (rows.size() != 2)
+		FatalError("Expected 2 rows after a long line, got " + std::to_string(rows.size()));
+
+	if (strlen(rows[0].name) != CStatusParser::MAX_NAME_LENGTH - 1 || strcmp(rows[0].uniqueid, "STEAM_0:0:5"))
+		FatalError("Long name is not truncated correctly");
+
+	if (strcmp(rows[1].name, "short"))
+		FatalError("Row after a long line is wrong");
+
+	fprintf(stderr, "Good\n\n");
+}
+
+void CStatusParserTest::TestInterleavedPrints()
+{
+	fprintf(stderr, "Checking other prints between parts of rows\n");
+
+	// Print comes before each message after the table header: between parts of a row or between rows
+	const Response &r = m_Corpus[0];
+	const char *prints[] = {
+		"Bob: hello\n",
+		"Player connected\n",
+		"[AMXX] Next map: crossfire\n",
+		"*** 5 minutes left ***\n",
+		" :(\n",
+	};
+
+	CStatusParser parser;
+	std::vector<CStatusParser::Row> rows;
+	auto onRow = [&](const CStatusParser::Row &row) { rows.push_back(row); };
+
+	for (const char *print : prints)
+	{
+		for (size_t at = 6; at < r.messages.size(); at++)
+		{
+			rows.clear();
+			parser.Begin();
+
+			int end = -1;
+			bool isPrintIgnored = false;
+			bool isPartAfterRow = false;
+
+			for (size_t i = 0; i < r.messages.size() && end == -1; i++)
+			{
+				if (i == at)
+				{
+					size_t rowCount = rows.size();
+					isPrintIgnored = parser.Feed(print, onRow) == CStatusParser::FeedResult::Ignored;
+
+					if (rows.size() != rowCount)
+						FatalError(std::string("Print made a row: ") + print);
+
+					// A row is kept if the print came between rows
+					isPartAfterRow = r.messages[i - 1].back() == '\n';
+				}
+
+				if (parser.Feed(r.messages[i].c_str(), onRow) == CStatusParser::FeedResult::End)
+					end = (int)i;
+			}
+
+			if (end != (int)r.endMessage)
+				FatalError(std::string("End of the table not found with a print: ") + print);
+
+			// Rows are either right or the one with the print is dropped
+			size_t expected = 0;
+
+			for (const CStatusParser::Row &row : rows)
+			{
+				while (expected < r.rows.size() && r.rows[expected].index != row.index)
+					expected++;
+
+				if (expected == r.rows.size() || strcmp(row.name, r.rows[expected].name) || strcmp(row.uniqueid, r.rows[expected].uniqueid))
+					FatalError(std::string("Wrong row with a print: ") + print);
+			}
+
+			if (!isPrintIgnored)
+				FatalError(std::string("Print isn't ignored: ") + print);
+
+			if (isPartAfterRow && rows.size() != r.rows.size())
+				FatalError(std::string("Print between rows dropped a row: ") + print);
+
+			if (!isPartAfterRow && rows.size() != r.rows.size() - 1)
+				FatalError(std::string("Row with a print isn't dropped: ") + print);
+		}
+	}
+
+	fprintf(stderr, "Good\n\n");
+}
+
+void CStatusParserTest::RunBenchmark()
+{
+	fprintf(stderr, "Benchmark (%d iterations over the corpus)\n", BENCH_ITERATIONS);
+
+	using Clock = std::chrono::high_resolution_clock;
+	CStatusParser parser;
+	volatile int sink = 0;
+	int responses = 0;
+	int rowCount = 0;
+	double parseTime = 0;
+
+	auto start = Clock::now();
+
+	for (int it = 0; it < BENCH_ITERATIONS; it++)
+	{
+		for (const Response &r : m_Corpus)
+		{
+			parser.Begin();
+
+			for (const std::string &msg : r.messages)
+			{
+				if (parser.Feed(msg.c_str(), [&](const CStatusParser::Row &row) { sink += row.userid; }) == CStatusParser::FeedResult::End)
+					break;
+			}
+
+			responses++;
+			rowCount += parser.GetRowCount();
+			parseTime += parser.GetParseTime();
+		}
+	}
+
+	auto end = Clock::now();
+	double total = std::chrono::duration<double, std::micro>(end - start).count();
+
+	fprintf(stderr, "Per response: %6.2f us (%6.2f us reported by the parser)\n", total / responses, parseTime / responses);
+	fprintf(stderr, "Per row:      %6.0f ns\n", total * 1000 / rowCount);
+}
@@ -0,0 +1,473 @@
+//
+// World shadow receiver test and benchmark.
+//
+// Generates the BSP tree of a big map with brush entity subtrees next to it, checks
+// that the triangles collected by CWorldShadowReceivers are the same polygons that
+// RecursiveDrawWorld drew and compares the number of GL calls and CPU time.
+//
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+#include <world_shadow_receivers.h>
+
+class CWorldShadowTest
+{
+public:
+	int Run();
+	[[noreturn]] void FatalError(const std::string &msg);
+
+private:
+	static constexpr int VERTEXSIZE = 7;
+	static constexpr int PLANE_COUNT = 3000;
+	static constexpr int WORLD_NODE_COUNT = 12000;
+	static constexpr int WORLD_SURFACE_COUNT = 20000;
+	static constexpr int BRUSH_MODEL_COUNT = 100;
+	static constexpr int BRUSH_MODEL_NODES = 6;
+
+	struct Plane
+	{
+		float normal[3];
+		int type;
+	};
+
+	struct Surface
+	{
+		bool planeBack;
+		int visframe;
+		std::vector<float> verts;
+	};
+
+	// Same as mnode_t, children below 0 are leaves
+	struct Node
+	{
+		int visframe;
+		int plane;
+		int parent;
+		int children[2];
+		int firstSurface;
+		int numSurfaces;
+	};
+
+	using Triangle = std::array<float, 9>;
+
+	std::mt19937 m_Rng { 1234 };
+	std::vector<Plane> m_Planes;
+	std::vector<Surface> m_Surfaces;
+	std::vector<Node> m_Nodes; // World tree starts at 0, brush models follow it
+	int m_iWorldNodeCount = 0;
+	int m_iVisibleNodes = 0;
+	CWorldShadowReceivers m_Receivers;
+
+	float RandomFloat(float min, float max);
+	void CreateTree(int nodeCount, int surfaceCount);
+	void CreateWorld();
+	void AddReceiverNode(int nodeIndex, std::vector<CWorldShadowReceivers::Node> &nodes, std::vector<CWorldShadowReceivers::Surface> &surfaces);
+
+	/**
+	 * Marks nodes above random leaves as in PVS and some of their surfaces as visible.
+	 * Surfaces of brush models and of nodes outside the PVS are marked too.
+	 */
+	void MarkVisible(int framecount, int percent);
+
+	// RecursiveDrawWorld, returns number of drawn surfaces
+	int OldDraw(int nodeIndex, int framecount, const float *lightvec, std::vector<Triangle> *triangles);
+	void GetTriangles(std::vector<Triangle> &triangles);
+
+	void TestCulling();
+	void RunBenchmark();
+};
+
+int main()
+{
+	CWorldShadowTest test;
+	return test.Run();
+}
+
+int CWorldShadowTest::Run()
+{
+	CreateWorld();
+
+	TestCulling();
+	RunBenchmark();
+	return 0;
+}
+
+void CWorldShadowTest::FatalError(const std::string &msg)
+{
+	fprintf(stderr, "Fatal Error: %s\n", msg.c_str());
+	exit(1);
+}
+
+float CWorldShadowTest::RandomFloat(float min, float max)
+{
+	return std::uniform_real_distribution<float>(min, max)(m_Rng);
+}
+
+void CWorldShadowTest::CreateTree(int nodeCount, int surfaceCount)
+{
+	int first = (int)m_Nodes.size();
+
+	// Grow the tree by replacing random leaves with nodes
+	for (int i = 0; i < nodeCount; i++)
+	{
+		Node node;
+		node.visframe = 0;
+		node.plane = m_Rng() % PLANE_COUNT;
+		node.parent = -1;
+		node.children[0] = -1;
+		node.children[1] = -1;
+		node.firstSurface = 0;
+		node.numSurfaces = 0;
+
+		int index = (int)m_Nodes.size();
+
+		// First node is the head node
+		if (i > 0)
+		{
+			for (;;)
+			{
+				int p = first + m_Rng() % i;
+				int side = m_Rng() % 2;
+
+				if (m_Nodes[p].children[side] < 0)
+				{
+					m_Nodes[p].children[side] = index;
+					node.parent = p;
+					break;
+				}
+			}
+		}
+
+		m_Nodes.push_back(node);
+	}
+
+	// Surfaces of a node are consecutive, like in the engine
+	std::vector<int> counts(nodeCount);
+
+	for (int i = 0; i < surfaceCount; i++)
+		counts[m_Rng() % nodeCount]++;
+
+	for (int i = 0; i < nodeCount; i++)
+	{
+		Node &node = m_Nodes[first + i];
+		node.firstSurface = (int)m_Surfaces.size();
+		node.numSurfaces = counts[i];
+
+		for (int j = 0; j < counts[i]; j++)
+		{
+			Surface surf;
+			surf.planeBack = m_Rng() % 2;
+			surf.visframe = 0;
+
+			int numVerts = 3 + m_Rng() % 8;
+
+			for (int k = 0; k < numVerts * VERTEXSIZE; k++)
+				surf.verts.push_back(RandomFloat(-4096, 4096));
+
+			m_Surfaces.push_back(std::move(surf));
+		}
+	}
+}
+
+void CWorldShadowTest::CreateWorld()
+{
+	// Most planes of a map are axial
+	for (int i = 0; i < PLANE_COUNT; i++)
+	{
+		Plane plane {};
+		plane.type = m_Rng() % 5;
+
+		if (plane.type <= CWorldShadowReceivers::PLANE_Z)
+		{
+			plane.normal[plane.type] = 1;
+		}
+		else
+		{
+			float len = 0;
+
+			for (float &f : plane.normal)
+			{
+				f = RandomFloat(-1, 1);
+				len += f * f;
+			}
+
+			for (float &f : plane.normal)
+				f /= std::sqrt(len);
+		}
+
+		m_Planes.push_back(plane);
+	}
+
+	CreateTree(WORLD_NODE_COUNT, WORLD_SURFACE_COUNT);
+	m_iWorldNodeCount = (int)m_Nodes.size();
+
+	for (int i = 0; i < BRUSH_MODEL_COUNT; i++)
+		CreateTree(BRUSH_MODEL_NODES, BRUSH_MODEL_NODES * 2);
+
+	std::vector<CWorldShadowReceivers::Node> nodes;
+	std::vector<CWorldShadowReceivers::Surface> surfaces;
+	AddReceiverNode(0, nodes, surfaces);
+	m_Receivers.Build(nodes, surfaces);
+
+	if (m_Receivers.GetNodeCount() != m_iWorldNodeCount)
+		FatalError("Brush model nodes were added to the world");
+}
+
+void CWorldShadowTest::AddReceiverNode(int nodeIndex, std::vector<CWorldShadowReceivers::Node> &nodes, std::vector<CWorldShadowReceivers::Surface> &surfaces)
+{
+	// Same as AddWorldShadowNode in tri.cpp
+	if (nodeIndex < 0)
+		return;
+
+	Node &node = m_Nodes[nodeIndex];
+	size_t index = nodes.size();
+	nodes.emplace_back();
+
+	CWorldShadowReceivers::Node desc;
+	desc.normal = m_Planes[node.plane].normal;
+	desc.planeType = m_Planes[node.plane].type;
+	desc.pVisframe = &node.visframe;
+	desc.firstSurface = (int)surfaces.size();
+
+	for (int i = 0; i < node.numSurfaces; i++)
+	{
+		Surface &surf = m_Surfaces[node.firstSurface + i];
+		CWorldShadowReceivers::Surface surfDesc;
+		surfDesc.verts = surf.verts.data();
+		surfDesc.numVerts = (int)surf.verts.size() / VERTEXSIZE;
+		surfDesc.vertexStride = VERTEXSIZE;
+		surfDesc.planeBack = surf.planeBack;
+		surfDesc.pVisframe = &surf.visframe;
+		surfaces.push_back(surfDesc);
+	}
+
+	desc.surfaceCount = node.numSurfaces;
+
+	AddReceiverNode(node.children[0], nodes, surfaces);
+	AddReceiverNode(node.children[1], nodes, surfaces);
+
+	desc.subtreeSize = (int)(nodes.size() - index);
+	nodes[index] = desc;
+}
+
+void CWorldShadowTest::MarkVisible(int framecount, int percent)
+{
+	m_iVisibleNodes = 0;
+
+	// Leaves in the PVS mark their parents like R_MarkLeaves
+	for (int i = 0; i < m_iWorldNodeCount; i++)
+	{
+		for (int side = 0; side < 2; side++)
+		{
+			if (m_Nodes[i].children[side] >= 0 || (int)(m_Rng() % 100) >= percent)
+				continue;
+
+			for (int n = i; n >= 0 && m_Nodes[n].visframe != framecount; n = m_Nodes[n].parent)
+			{
+				m_Nodes[n].visframe = framecount;
+				m_iVisibleNodes++;
+			}
+		}
+	}
+
+	// Frustum culling of surfaces in the PVS, stale marks outside of it and drawn brush models
+	for (size_t i = 0; i < m_Nodes.size(); i++)
+	{
+		const Node &node = m_Nodes[i];
+		bool isWorld = (int)i < m_iWorldNodeCount;
+		int chance = isWorld ? (node.visframe == framecount ? 70 : 5) : 50;
+
+		for (int j = 0; j < node.numSurfaces; j++)
+		{
+			if ((int)(m_Rng() % 100) < chance)
+				m_Surfaces[node.firstSurface + j].visframe = framecount;
+		}
+	}
+}
+
+int CWorldShadowTest::OldDraw(int nodeIndex, int framecount, const float *lightvec, std::vector<Triangle> *triangles)
+{
+	if (nodeIndex < 0)
+		return 0;
+
+	const Node &node = m_Nodes[nodeIndex];
+
+	if (node.visframe != framecount)
+		return 0;
+
+	int count = OldDraw(node.children[0], framecount, lightvec, triangles);
+	count += OldDraw(node.children[1], framecount, lightvec, triangles);
+
+	for (int c = 0; c < node.numSurfaces; c++)
+	{
+		const Surface &surf = m_Surfaces[node.firstSurface + c];
+
+		if (surf.visframe != framecount)
+			continue;
+
+		float dot;
+		const Plane &plane = m_Planes[node.plane];
+
+		switch (plane.type)
+		{
+		case CWorldShadowReceivers::PLANE_X:
+			dot = lightvec[0];
+			break;
+		case CWorldShadowReceivers::PLANE_Y:
+			dot = lightvec[1];
+			break;
+		case CWorldShadowReceivers::PLANE_Z:
+			dot = lightvec[2];
+			break;
+		default:
+			dot = lightvec[0] * plane.normal[0] + lightvec[1] * plane.normal[1] + lightvec[2] * plane.normal[2];
+			break;
+		}
+
+		if ((dot > 0) && surf.planeBack)
+			continue;
+
+		if ((dot < 0) && !surf.planeBack)
+			continue;
+
+		count++;
+
+		if (!triangles)
+			continue;
+
+		// GL_POLYGON of a convex polygon
+		const float *v = surf.verts.data();
+		int numVerts = (int)surf.verts.size() / VERTEXSIZE;
+
+		for (int i = 2; i < numVerts; i++)
+		{
+			Triangle tri;
+			std::copy(v, v + 3, tri.begin());
+			std::copy(v + (i - 1) * VERTEXSIZE, v + (i - 1) * VERTEXSIZE + 3, tri.begin() + 3);
+			std::copy(v + i * VERTEXSIZE, v + i * VERTEXSIZE + 3, tri.begin() + 6);
+			triangles->push_back(tri);
+		}
+	}
+
+	return count;
+}
+
+void CWorldShadowTest::GetTriangles(std::vector<Triangle> &triangles)
+{
+	const float *verts = m_Receivers.GetVertices();
+	const unsigned *indices = m_Receivers.GetVisibleIndices();
+
+	for (int i = 0; i < m_Receivers.GetVisibleIndexCount(); i += 3)
+	{
+		Triangle tri;
+
+		for (int j = 0; j < 3; j++)
+		{
+			if ((int)indices[i + j] >= m_Receivers.GetVertexCount())
+				FatalError("Index is out of range");
+
+			std::copy(verts + indices[i + j] * 3, verts + indices[i + j] * 3 + 3, tri.begin() + j * 3);
+		}
+
+		triangles.push_back(tri);
+	}
+}
+
+void CWorldShadowTest::TestCulling()
+{
+	fprintf(stderr, "Checking that visible triangles match the old walk\n");
+
+	const float lights[][3] = {
+		{ 0, 0, -1 },
+		{ 0.5f, 0.3f, -0.8f },
+		{ -0.2f, 0, 0.9f },
+		{ 0, 0, 0 },
+	};
+
+	int framecount = 0;
+
+	for (int i = 0; i < 40; i++)
+	{
+		framecount++;
+		MarkVisible(framecount, 1 + i);
+
+		float randomLight[3] = { RandomFloat(-1, 1), RandomFloat(-1, 1), RandomFloat(-1, 1) };
+		const float *lightvec = i < 4 ? lights[i] : randomLight;
+
+		std::vector<Triangle> expected, triangles;
+		int surfaces = OldDraw(0, framecount, lightvec, &expected);
+
+		// The engine uses the same number for both in this test
+		m_Receivers.BuildVisibleList(framecount, framecount, lightvec);
+		GetTriangles(triangles);
+
+		if (m_Receivers.GetVisibleSurfaceCount() != surfaces)
+			FatalError("Frame " + std::to_string(framecount) + ": expected " + std::to_string(surfaces) + " surfaces, got " + std::to_string(m_Receivers.GetVisibleSurfaceCount()));
+
+		// Order of surfaces doesn't matter for multiplicative blending
+		std::sort(expected.begin(), expected.end());
+		std::sort(triangles.begin(), triangles.end());
+
+		if (expected != triangles)
+			FatalError("Frame " + std::to_string(framecount) + ": triangles don't match");
+	}
+
+	fprintf(stderr, "%d world nodes, %d surfaces, %d vertices\n", m_Receivers.GetNodeCount(), m_Receivers.GetSurfaceCount(), m_Receivers.GetVertexCount());
+	fprintf(stderr, "Good\n\n");
+}
+
+void CWorldShadowTest::RunBenchmark()
+{
+	constexpr int FRAME_COUNT = 500;
+	constexpr int FRAME = 1000;
+	const float lightvec[3] = { 0.3f, 0.2f, -0.9f };
+
+	for (Node &node : m_Nodes)
+		node.visframe = 0;
+
+	for (Surface &surf : m_Surfaces)
+		surf.visframe = 0;
+
+	MarkVisible(FRAME, 10);
+
+	fprintf(stderr, "Benchmark: %d world nodes, %d in PVS, %d frames\n", m_iWorldNodeCount, m_iVisibleNodes, FRAME_COUNT);
+
+	// GL calls of the old walk: glBegin, glEnd and two per vertex
+	std::vector<Triangle> triangles;
+	int oldSurfaces = OldDraw(0, FRAME, lightvec, &triangles);
+	int oldCalls = 2 * oldSurfaces + 2 * ((int)triangles.size() + 2 * oldSurfaces);
+
+	int oldSum = 0;
+	int newSum = 0;
+
+	auto t0 = std::chrono::steady_clock::now();
+
+	for (int i = 0; i < FRAME_COUNT; i++)
+		oldSum += OldDraw(0, FRAME, lightvec, nullptr);
+
+	auto t1 = std::chrono::steady_clock::now();
+
+	for (int i = 0; i < FRAME_COUNT; i++)
+	{
+		m_Receivers.BuildVisibleList(FRAME, FRAME, lightvec);
+		newSum += m_Receivers.GetVisibleSurfaceCount();
+	}
+
+	auto t2 = std::chrono::steady_clock::now();
+
+	if (oldSum != newSum)
+		FatalError("Benchmark results don't match");
+
+	auto us = [](auto a, auto b) { return std::chrono::duration<double, std::micro>(b - a).count(); };
+	double oldTime = us(t0, t1) / FRAME_COUNT;
+	double newTime = us(t1, t2) / FRAME_COUNT;
+	fprintf(stderr, "Old walk culling:  %8.1f us per frame, %d GL calls\n", oldTime, oldCalls);
+	fprintf(stderr, "Visible list:      %8.1f us per frame, 1 glDrawElements with %d indices\n", newTime, m_Receivers.GetVisibleIndexCount());
+	fprintf(stderr, "Speedup: %.1fx\n", oldTime / newTime);
+}
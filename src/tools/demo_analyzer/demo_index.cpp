@@ -0,0 +1,319 @@
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <thread>
+#include "demo.h"
+#include "mapped_file.h"
+#include "demo_index.h"
+
+namespace
+{
+
+constexpr int HEADER_PATH_SIZE = 260;
+constexpr int HEADER_DIRECTORY_OFFSET = 540;
+
+// Sizes of frame data
+constexpr size_t FRAME_HEADER_SIZE = 9; // Type, time and frame number
+constexpr size_t NETWORK_INFO_SIZE = 436 + 28; // Demo info and sequence info
+constexpr size_t CONSOLE_COMMAND_SIZE = 64;
+constexpr size_t CLIENT_DATA_SIZE = 32;
+constexpr size_t EVENT_SIZE = 84;
+constexpr size_t WEAPON_ANIM_SIZE = 8;
+constexpr size_t SOUND_TAIL_SIZE = 16; // Attenuation, volume, flags and pitch after the sample name
+
+constexpr size_t CUSTOM_TIMER_SIZE = sizeof(float) * 2 + sizeof(bool);
+
+int ReadInt(const uint8_t *p)
+{
+	int32_t value;
+	memcpy(&value, p, sizeof(value));
+	return value;
+}
+
+float ReadFloat(const uint8_t *p)
+{
+	float value;
+	memcpy(&value, p, sizeof(value));
+	return value;
+}
+
+std::string ReadString(const uint8_t *p, size_t maxLen)
+{
+	const char *str = reinterpret_cast<const char *>(p);
+	return std::string(str, strnlen(str, maxLen));
+}
+
+}
+
+//-----------------------------------------------------------------
+// CDemoIndex
+//-----------------------------------------------------------------
+bool CDemoIndex::Build(const uint8_t *data, size_t size)
+{
+	Clear();
+	fileSize = size;
+
+	if (size < (size_t)HEADER_SIZE || memcmp(data, "HLDEMO", 6))
+	{
+		error = "not a demo";
+		return false;
+	}
+
+	demoProtocol = ReadInt(data + 8);
+	netProtocol = ReadInt(data + 12);
+	map = ReadString(data + 16, HEADER_PATH_SIZE);
+	gameDir = ReadString(data + 16 + HEADER_PATH_SIZE, HEADER_PATH_SIZE);
+	mapCRC = (uint32_t)ReadInt(data + 16 + HEADER_PATH_SIZE * 2);
+
+	// Frames end at the directory, it's written when recording is stopped
+	size_t directoryOffset = (uint32_t)ReadInt(data + HEADER_DIRECTORY_OFFSET);
+	size_t end = size;
+
+	if (directoryOffset >= HEADER_SIZE && directoryOffset < size)
+		end = directoryOffset;
+	else
+		isTruncated = true;
+
+	size_t pos = HEADER_SIZE;
+	bool isInSegment = false;
+
+	while (pos < end)
+	{
+		size_t framePos = pos;
+		bool isComplete = end - pos >= FRAME_HEADER_SIZE;
+
+		if (isComplete)
+		{
+			int type = data[pos];
+			float time = ReadFloat(data + pos + 1);
+			pos += FRAME_HEADER_SIZE;
+
+			if (type >= FRAME_TYPE_COUNT)
+			{
+				error = "unknown frame type " + std::to_string(type) + " at offset " + std::to_string(framePos);
+				return false;
+			}
+
+			isComplete = ProcessFrame(type, time, data, end, pos);
+
+			if (isComplete)
+			{
+				if (!isInSegment)
+				{
+					segmentCount++;
+					isInSegment = true;
+				}
+
+				if (type == FRAME_NEXT_SECTION)
+					isInSegment = false;
+
+				frameCount++;
+				frameTypeCounts[type]++;
+				duration = std::max(duration, time);
+			}
+		}
+
+		if (!isComplete)
+		{
+			// Last frame of an unfinished recording may be cut
+			if (isTruncated)
+				break;
+
+			error = "damaged frame at offset " + std::to_string(framePos);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool CDemoIndex::BuildFromFile(const char *path)
+{
+	CMappedFile file;
+
+	if (!file.Open(path))
+	{
+		Clear();
+		error = "failed to open";
+		return false;
+	}
+
+	return Build(file.GetData(), file.GetSize());
+}
+
+void CDemoIndex::Clear()
+{
+	*this = CDemoIndex();
+}
+
+float CDemoIndex::GameToDemoTime(float gameTime) const
+{
+	// Game time starts again after a map change, so the latest point is taken
+	for (auto it = syncPoints.rbegin(); it != syncPoints.rend(); ++it)
+	{
+		if (it->gameTime <= gameTime)
+			return it->demoTime + (gameTime - it->gameTime);
+	}
+
+	return syncPoints.empty() ? -1 : syncPoints.front().demoTime;
+}
+
+bool CDemoIndex::ProcessFrame(int type, float time, const uint8_t *data, size_t size, size_t &pos)
+{
+	auto fnSkip = [&](size_t len) {
+		if (size - pos < len)
+			return false;
+
+		pos += len;
+		return true;
+	};
+
+	// Reads a length and checks that the data fits
+	auto fnReadLength = [&](int &len) {
+		if (size - pos < sizeof(int))
+			return false;
+
+		len = ReadInt(data + pos);
+		pos += sizeof(int);
+		return len >= 0 && size - pos >= (size_t)len;
+	};
+
+	int len;
+
+	switch (type)
+	{
+	case FRAME_NETWORK_START:
+	case FRAME_NETWORK:
+		return fnSkip(NETWORK_INFO_SIZE) && fnReadLength(len) && fnSkip(len);
+	case FRAME_START:
+	case FRAME_NEXT_SECTION:
+		return true;
+	case FRAME_CONSOLE_COMMAND:
+		return fnSkip(CONSOLE_COMMAND_SIZE);
+	case FRAME_CLIENT_DATA:
+		return fnSkip(CLIENT_DATA_SIZE);
+	case FRAME_EVENT:
+		return fnSkip(EVENT_SIZE);
+	case FRAME_WEAPON_ANIM:
+		return fnSkip(WEAPON_ANIM_SIZE);
+	case FRAME_SOUND:
+		return fnSkip(sizeof(int)) && fnReadLength(len) && fnSkip(len) && fnSkip(SOUND_TAIL_SIZE);
+	case FRAME_DEMO_BUFFER:
+		if (!fnReadLength(len))
+			return false;
+
+		ProcessDemoBuffer(time, data + pos, len);
+		pos += len;
+		return true;
+	}
+
+	return false;
+}
+
+void CDemoIndex::ProcessDemoBuffer(float time, const uint8_t *data, int len)
+{
+	// Same layout as Demo_ReadBuffer and the readers it calls
+	if (len < (int)sizeof(int))
+	{
+		unknownRecordCount++;
+		return;
+	}
+
+	int type = ReadInt(data);
+	data += sizeof(int);
+	len -= sizeof(int);
+
+	switch (type)
+	{
+	case TYPE_SNIPERDOT:
+		if (len < (int)sizeof(int))
+			break;
+
+		if (ReadInt(data))
+			sniperDotCount++;
+
+		return;
+	case TYPE_ZOOM:
+		if (len < (int)sizeof(float))
+			break;
+
+		zoomCount++;
+		return;
+	case TYPE_TIME:
+		if (len < (int)sizeof(float))
+			break;
+
+		syncPoints.push_back({ time, ReadFloat(data) });
+		return;
+	case TYPE_TIMER:
+		if (len < (int)(sizeof(float) + sizeof(int)))
+			break;
+
+		timers.push_back({ time, ReadFloat(data), ReadInt(data + sizeof(float)) });
+		return;
+	case TYPE_CUSTOM_TIMER:
+	{
+		if (len < (int)sizeof(int))
+			break;
+
+		// Timers that don't fit into the record are dropped
+		int count = std::min(ReadInt(data), (int)((len - sizeof(int)) / CUSTOM_TIMER_SIZE));
+		const uint8_t *p = data + sizeof(int);
+
+		for (int number = 0; number < count; number++, p += CUSTOM_TIMER_SIZE)
+			customTimers.push_back({ time, number, ReadFloat(p), ReadFloat(p + sizeof(float)) });
+
+		return;
+	}
+	case TYPE_NEXTMAP:
+		nextmaps.push_back({ time, ReadString(data, len) });
+		return;
+	case TYPE_SVC_STATUS:
+		if (len < (int)sizeof(unsigned) || (unsigned)ReadInt(data) != DEMO_SVC_STATUS_MAGIC)
+			break;
+
+		statusRequests.push_back(time);
+		return;
+	}
+
+	unknownRecordCount++;
+}
+
+//-----------------------------------------------------------------
+// CDemoIndexer
+//-----------------------------------------------------------------
+void CDemoIndexer::IndexFiles(std::vector<File> &files, int threads, const FileCallback &fnCallback)
+{
+	std::atomic<size_t> nextFile(0);
+
+	if (threads <= 0)
+		threads = (int)std::thread::hardware_concurrency();
+
+	threads = std::max(1, std::min(threads, (int)files.size()));
+
+	auto fnWorker = [&]() {
+		for (;;)
+		{
+			size_t i = nextFile.fetch_add(1, std::memory_order_relaxed);
+
+			if (i >= files.size())
+				break;
+
+			File &file = files[i];
+			file.isIndexed = file.index.BuildFromFile(file.path.c_str());
+
+			if (fnCallback)
+				fnCallback(i);
+		}
+	};
+
+	std::vector<std::thread> pool;
+
+	for (int i = 1; i < threads; i++)
+		pool.emplace_back(fnWorker);
+
+	fnWorker();
+
+	for (std::thread &thread : pool)
+		thread.join();
+}
@@ -0,0 +1,152 @@
+//
+// demo_index.h
+//
+// One-pass index of GoldSrc demo files and records written by Demo_WriteBuffer.
+//
+#ifndef DEMO_INDEX_H
+#define DEMO_INDEX_H
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+/**
+ * Index of a demo file: header, frame counts and decoded client DLL records.
+ * Frames are walked in file order without copying, so a mapped file of any size
+ * is read once. Times are demo times in seconds, as stored in frame headers.
+ */
+class CDemoIndex
+{
+public:
+	static constexpr int HEADER_SIZE = 544;
+	static constexpr int FRAME_TYPE_COUNT = 10;
+
+	//! Engine demo frame types
+	enum FrameType
+	{
+		FRAME_NETWORK_START = 0,
+		FRAME_NETWORK = 1,
+		FRAME_START = 2,
+		FRAME_CONSOLE_COMMAND = 3,
+		FRAME_CLIENT_DATA = 4,
+		FRAME_NEXT_SECTION = 5,
+		FRAME_EVENT = 6,
+		FRAME_WEAPON_ANIM = 7,
+		FRAME_SOUND = 8,
+		FRAME_DEMO_BUFFER = 9, //!< Demo_WriteBuffer
+	};
+
+	//! TYPE_TIME: game time at a demo time
+	struct SyncPoint
+	{
+		float demoTime;
+		float gameTime;
+	};
+
+	//! TYPE_TIMER
+	struct Timer
+	{
+		float demoTime;
+		float endTime; //!< Game time, 0 if there is no time limit
+		int agVersion; //!< CHudTimer::SV_AG_*
+	};
+
+	//! TYPE_CUSTOM_TIMER, one for every timer in the record
+	struct CustomTimer
+	{
+		float demoTime;
+		int number;
+		float startTime; //!< Game time
+		float endTime;
+	};
+
+	//! TYPE_NEXTMAP
+	struct Nextmap
+	{
+		float demoTime;
+		std::string map;
+	};
+
+	// Header
+	uint64_t fileSize = 0; //!< Size of the demo in bytes
+	int demoProtocol = 0;
+	int netProtocol = 0;
+	std::string map;
+	std::string gameDir;
+	uint32_t mapCRC = 0;
+
+	// Frames
+	int segmentCount = 0;
+	int frameCount = 0;
+	int frameTypeCounts[FRAME_TYPE_COUNT] = {};
+	float duration = 0; //!< Time of the last frame
+	bool isTruncated = false; //!< Recording wasn't finished, there is no directory
+
+	// Client DLL records
+	std::vector<SyncPoint> syncPoints;
+	std::vector<Timer> timers;
+	std::vector<CustomTimer> customTimers;
+	std::vector<Nextmap> nextmaps;
+	std::vector<float> statusRequests; //!< TYPE_SVC_STATUS
+	int zoomCount = 0; //!< TYPE_ZOOM
+	int sniperDotCount = 0; //!< TYPE_SNIPERDOT with the dot on
+	int unknownRecordCount = 0;
+
+	std::string error; //!< Set if Build failed
+
+	/**
+	 * Indexes a demo in memory. Frames up to a damaged one are kept.
+	 * @returns false if it isn't a demo or a frame is damaged.
+	 */
+	bool Build(const uint8_t *data, size_t size);
+
+	/**
+	 * Maps a file and indexes it.
+	 * @param	path	Path to the file in UTF-8.
+	 */
+	bool BuildFromFile(const char *path);
+
+	void Clear();
+
+	/**
+	 * Converts a game time to a demo time using the last sync point before it.
+	 * @returns -1 if there are no sync points.
+	 */
+	float GameToDemoTime(float gameTime) const;
+
+private:
+	bool ProcessFrame(int type, float time, const uint8_t *data, size_t size, size_t &pos);
+	void ProcessDemoBuffer(float time, const uint8_t *data, int len);
+};
+
+/**
+ * Indexes many demos in parallel, one file per thread at a time.
+ */
+class CDemoIndexer
+{
+public:
+	struct File
+	{
+		std::string path; //!< UTF-8
+
+		// Results
+		CDemoIndex index;
+		bool isIndexed = false;
+	};
+
+	/**
+	 * Called from a worker thread when a file is indexed or failed.
+	 * @param	index	Index of the file in the list
+	 */
+	using FileCallback = std::function<void(size_t index)>;
+
+	/**
+	 * Indexes all files in the list. Returns when all files are done.
+	 * @param	threads		Number of threads, 0 to use the number of CPU cores
+	 * @param	fnCallback	Called after every file, can be empty
+	 */
+	static void IndexFiles(std::vector<File> &files, int threads, const FileCallback &fnCallback);
+};
+
+#endif
@@ -0,0 +1,188 @@
+//
+// Demo analyzer.
+//
+// Indexes demos recorded with the client and prints the map, timer sync points
+// and the timeline of records written by Demo_WriteBuffer.
+// Directories are searched for .dem files recursively. Files are indexed in parallel.
+//
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <vector>
+#include "demo_index.h"
+
+namespace fs = std::filesystem;
+
+namespace
+{
+
+void PrintUsage()
+{
+	fprintf(stderr, "usage: demo_analyzer [-j <threads>] [-v] <demo or directory>...\n");
+	fprintf(stderr, "  -j  number of threads, default is the number of CPU cores\n");
+	fprintf(stderr, "  -v  print every sync point and record\n");
+}
+
+const char *GetAgVersionName(int version)
+{
+	switch (version)
+	{
+	case -1:
+		return "no AG";
+	case 1:
+		return "AG mini";
+	case 2:
+		return "AG full";
+	default:
+		return "AG unknown";
+	}
+}
+
+void AddPath(const fs::path &path, std::vector<CDemoIndexer::File> &files)
+{
+	std::error_code ec;
+
+	if (!fs::is_directory(path, ec))
+	{
+		files.emplace_back();
+		files.back().path = path.u8string();
+		return;
+	}
+
+	std::vector<std::string> paths;
+
+	for (fs::recursive_directory_iterator it(path, ec), end; !ec && it != end; it.increment(ec))
+	{
+		if (it->is_regular_file(ec) && it->path().extension() == ".dem")
+			paths.push_back(it->path().u8string());
+	}
+
+	if (ec)
+		fprintf(stderr, "%s: %s\n", path.u8string().c_str(), ec.message().c_str());
+
+	// Directory order isn't defined
+	std::sort(paths.begin(), paths.end());
+
+	for (std::string &i : paths)
+	{
+		files.emplace_back();
+		files.back().path = std::move(i);
+	}
+}
+
+void PrintIndex(const CDemoIndex &index, bool isVerbose)
+{
+	printf("  map %s, %s, protocol %d/%d, %.1f s, %d frames in %d segments%s\n",
+	    index.map.c_str(), index.gameDir.c_str(), index.demoProtocol, index.netProtocol,
+	    index.duration, index.frameCount, index.segmentCount, index.isTruncated ? ", truncated" : "");
+
+	if (!index.syncPoints.empty())
+	{
+		const CDemoIndex::SyncPoint &first = index.syncPoints.front();
+		const CDemoIndex::SyncPoint &last = index.syncPoints.back();
+		printf("  sync: %d points, game time %.1f at %.1f s .. %.1f at %.1f s\n",
+		    (int)index.syncPoints.size(), first.gameTime, first.demoTime, last.gameTime, last.demoTime);
+
+		if (isVerbose)
+		{
+			for (const CDemoIndex::SyncPoint &i : index.syncPoints)
+				printf("    %.3f s: game time %.3f\n", i.demoTime, i.gameTime);
+		}
+	}
+
+	for (const CDemoIndex::Timer &i : index.timers)
+	{
+		if (i.endTime > 0)
+			printf("  timer at %.1f s: match ends at %.1f s (game time %.1f), %s\n",
+			    i.demoTime, index.GameToDemoTime(i.endTime), i.endTime, GetAgVersionName(i.agVersion));
+		else
+			printf("  timer at %.1f s: no time limit, %s\n", i.demoTime, GetAgVersionName(i.agVersion));
+	}
+
+	for (const CDemoIndex::CustomTimer &i : index.customTimers)
+	{
+		// Unused timers are written too
+		if (i.endTime > 0 || isVerbose)
+			printf("  custom timer %d at %.1f s: game time %.1f .. %.1f\n", i.number + 1, i.demoTime, i.startTime, i.endTime);
+	}
+
+	for (const CDemoIndex::Nextmap &i : index.nextmaps)
+		printf("  nextmap at %.1f s: %s\n", i.demoTime, i.map.c_str());
+
+	if (!index.statusRequests.empty())
+	{
+		printf("  status: %d requests, %.1f s .. %.1f s\n",
+		    (int)index.statusRequests.size(), index.statusRequests.front(), index.statusRequests.back());
+
+		if (isVerbose)
+		{
+			for (float i : index.statusRequests)
+				printf("    %.3f s\n", i);
+		}
+	}
+
+	if (index.zoomCount || index.sniperDotCount || index.unknownRecordCount)
+		printf("  zoom: %d, sniper dot: %d, unknown: %d records\n", index.zoomCount, index.sniperDotCount, index.unknownRecordCount);
+}
+
+}
+
+int main(int argc, char **argv)
+{
+	std::vector<CDemoIndexer::File> files;
+	int threads = 0;
+	bool isVerbose = false;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (!strcmp(argv[i], "-j") && i + 1 < argc)
+			threads = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "-v"))
+			isVerbose = true;
+		else if (argv[i][0] == '-')
+		{
+			PrintUsage();
+			return 1;
+		}
+		else
+			AddPath(fs::u8path(argv[i]), files);
+	}
+
+	if (files.empty())
+	{
+		PrintUsage();
+		return 1;
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	CDemoIndexer::IndexFiles(files, threads, nullptr);
+	double time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	uint64_t totalSize = 0;
+	int failedCount = 0;
+
+	for (const CDemoIndexer::File &file : files)
+	{
+		totalSize += file.index.fileSize;
+		printf("%s\n", file.path.c_str());
+
+		if (!file.isIndexed)
+		{
+			printf("  error: %s\n", file.index.error.c_str());
+			failedCount++;
+			continue;
+		}
+
+		PrintIndex(file.index, isVerbose);
+	}
+
+	double sizeMB = totalSize / (1024.0 * 1024.0);
+	fprintf(stderr, "%d demos (%d failed), %.1f MB in %.2f s (%.0f MB/s)\n",
+	    (int)files.size(), failedCount, sizeMB, time, time > 0 ? sizeMB / time : 0.0);
+
+	return failedCount ? 1 : 0;
+}